@@ -0,0 +1,54 @@
+#!/bin/bash
+# Time dashboard requests against a flashed device, for gzip and identity
+# clients, cold and revalidated by ETag. The host counterpart with a
+# modelled link is host_test/test_web_assets.
+# Usage: ./bench_nap_local.sh [base URL] [rounds]
+
+set -e
+
+BASE=${1:-http://nap.local}
+ROUNDS=${2:-10}
+
+if ! command -v curl &> /dev/null; then
+    echo "Error: curl not found."
+    exit 1
+fi
+
+# Asset URLs as the page references them, versioned CSS and JS included
+PAGE=$(curl -s --compressed "$BASE/")
+ASSETS="/ $(echo "$PAGE" | grep -o '/[a-z]*\.\(css\|js\)?v=[0-9a-f]*' | sort -u | tr '\n' ' ')"
+
+# bench <label> <curl options...>: median time_total and bytes per asset
+bench() {
+    local label=$1
+    shift
+    local total_ms=0 total_bytes=0
+    for asset in $ASSETS; do
+        local etag_opt=()
+        if [ "$REVALIDATE" = 1 ]; then
+            local etag
+            etag=$(curl -s -o /dev/null -D - "$@" "$BASE$asset" | tr -d '\r' | sed -n 's/^[Ee][Tt][Aa][Gg]: //p')
+            etag_opt=(-H "If-None-Match: $etag")
+        fi
+        local times=()
+        local bytes=0
+        for _ in $(seq "$ROUNDS"); do
+            read -r t b < <(curl -s -o /dev/null -w '%{time_total} %{size_download}\n' "${etag_opt[@]}" "$@" "$BASE$asset")
+            times+=("$t")
+            bytes=$b
+        done
+        local median
+        median=$(printf '%s\n' "${times[@]}" | sort -n | awk '{a[NR]=$1} END {print a[int((NR+1)/2)] * 1000}')
+        printf "  %-30s %-20s %6d bytes  %7.1f ms\n" "$label" "${asset%%\?*}" "$bytes" "$median"
+        total_ms=$(awk "BEGIN {print $total_ms + $median}")
+        total_bytes=$((total_bytes + bytes))
+    done
+    printf "  %-30s %-20s %6d bytes  %7.1f ms\n\n" "$label" "(page load)" "$total_bytes" "$total_ms"
+}
+
+echo "Dashboard request times against $BASE, median of $ROUNDS"
+echo ""
+REVALIDATE=0 bench "cold, gzip client" -H "Accept-Encoding: gzip, deflate, br"
+REVALIDATE=0 bench "cold, identity client"
+REVALIDATE=1 bench "reload (304), gzip client" -H "Accept-Encoding: gzip, deflate, br"
+REVALIDATE=1 bench "reload (304), identity client"
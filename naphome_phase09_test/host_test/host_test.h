@@ -0,0 +1,31 @@
+/**
+ * @file host_test.h
+ * @brief Minimal assertion helpers shared by the host tests
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+static int host_test_failures = 0;
+
+// Record a failure and keep going, so one run reports every broken check
+#define CHECK(cond, ...) do {                                           \
+        if (!(cond)) {                                                  \
+            host_test_failures++;                                       \
+            fprintf(stderr, "FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__);                               \
+            fputc('\n', stderr);                                        \
+        }                                                               \
+    } while (0)
+
+// Exit status for main()
+static inline int host_test_result(const char *name)
+{
+    if (host_test_failures) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, host_test_failures);
+        return 1;
+    }
+    printf("%s: all checks passed\n", name);
+    return 0;
+}
@@ -0,0 +1,21 @@
+/**
+ * @file intent_handlers.c
+ * @brief Handlers for local_intents[] in the intent tests, which only match
+ */
+
+#include "local_intents.h"
+
+bool intent_demo(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_play_wav(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_play_mp3(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_lights_on(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_lights_off(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_set_color(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_background_audio_start(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_background_audio_stop(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_temperature(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_humidity(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_air_quality(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_co2(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_light_level(const intent_def_t *intent, int command_id, const char *text) { return true; }
+bool intent_say(const intent_def_t *intent, int command_id, const char *text) { return true; }
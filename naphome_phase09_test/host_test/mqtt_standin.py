@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""
+Minimal MQTT 3.1.1 broker for the host tests, and a runner around a broker
+
+Speaks the subset the publisher and the test subscriber use: CONNECT,
+SUBSCRIBE (QoS 0/1, + and # wildcards), PUBLISH QoS 0/1 with PUBACK,
+PINGREQ and DISCONNECT. No retained messages, no persistent sessions.
+It stands in for mosquitto where that is not installed; with --mosquitto
+the runner starts the real broker instead.
+
+--exec runs a command once the broker listens, with {uri} in its
+arguments replaced by mqtt://127.0.0.1:<port>, stops the broker when the
+command exits and returns its exit status. That is how ctest runs
+test_mqtt_publisher.
+
+Usage: python3 mqtt_standin.py [--port 1883] [--mosquitto PATH] [--exec CMD ARGS...]
+"""
+
+import argparse
+import socket
+import socketserver
+import struct
+import subprocess
+import sys
+import threading
+import time
+
+CONNECT, CONNACK, PUBLISH, PUBACK = 0x10, 0x20, 0x30, 0x40
+SUBSCRIBE, SUBACK, PINGREQ, PINGRESP, DISCONNECT = 0x80, 0x90, 0xC0, 0xD0, 0xE0
+
+sessions_lock = threading.Lock()
+sessions = set()
+
+
+def topic_matches(topic_filter, topic):
+    parts, levels = topic_filter.split("/"), topic.split("/")
+    for i, part in enumerate(parts):
+        if part == "#":
+            return True
+        if i >= len(levels) or (part != "+" and part != levels[i]):
+            return False
+    return len(parts) == len(levels)
+
+
+def encode(header, body):
+    length, out = len(body), bytearray([header])
+    while True:
+        byte, length = length % 128, length // 128
+        out.append(byte | (0x80 if length else 0))
+        if not length:
+            return bytes(out) + body
+
+
+def utf8(s):
+    data = s.encode()
+    return struct.pack(">H", len(data)) + data
+
+
+class Session(socketserver.BaseRequestHandler):
+    def setup(self):
+        self.request.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.send_lock = threading.Lock()
+        self.subscriptions = {}  # filter -> granted QoS
+        self.next_id = 1
+
+    def send(self, header, body=b""):
+        with self.send_lock:
+            self.request.sendall(encode(header, body))
+
+    def read(self, n):
+        data = b""
+        while len(data) < n:
+            chunk = self.request.recv(n - len(data))
+            if not chunk:
+                raise ConnectionError
+            data += chunk
+        return data
+
+    def read_packet(self):
+        header = self.read(1)[0]
+        length, shift = 0, 0
+        while True:
+            byte = self.read(1)[0]
+            length |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+        return header, self.read(length) if length else b""
+
+    def deliver(self, topic, payload, qos):
+        granted = max((q for f, q in self.subscriptions.items() if topic_matches(f, topic)), default=None)
+        if granted is None:
+            return
+        qos = min(qos, granted)
+        body = utf8(topic)
+        if qos:
+            body += struct.pack(">H", self.next_id)
+            self.next_id = self.next_id % 0xFFFF + 1
+        try:
+            self.send(PUBLISH | (qos << 1), body + payload)
+        except OSError:
+            pass
+
+    def handle(self):
+        try:
+            header, _ = self.read_packet()
+            if header & 0xF0 != CONNECT:
+                return
+            self.send(CONNACK, b"\x00\x00")
+            with sessions_lock:
+                sessions.add(self)
+            while True:
+                header, body = self.read_packet()
+                kind = header & 0xF0
+                if kind == PUBLISH:
+                    qos = (header >> 1) & 3
+                    topic_len = struct.unpack(">H", body[:2])[0]
+                    topic = body[2:2 + topic_len].decode()
+                    offset = 2 + topic_len
+                    if qos:
+                        self.send(PUBACK, body[offset:offset + 2])
+                        offset += 2
+                    with sessions_lock:
+                        targets = list(sessions)
+                    for session in targets:
+                        session.deliver(topic, body[offset:], qos)
+                elif kind == SUBSCRIBE:
+                    packet_id, offset, granted = body[:2], 2, b""
+                    while offset < len(body):
+                        filter_len = struct.unpack(">H", body[offset:offset + 2])[0]
+                        topic_filter = body[offset + 2:offset + 2 + filter_len].decode()
+                        qos = min(body[offset + 2 + filter_len], 1)
+                        self.subscriptions[topic_filter] = qos
+                        granted += bytes([qos])
+                        offset += 3 + filter_len
+                    self.send(SUBACK, packet_id + granted)
+                elif kind == PINGREQ:
+                    self.send(PINGRESP)
+                elif kind == DISCONNECT:
+                    return
+        except (ConnectionError, OSError):
+            pass
+        finally:
+            with sessions_lock:
+                sessions.discard(self)
+
+
+class Broker(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+
+def wait_for_port(port, timeout_s=5.0):
+    deadline = time.monotonic() + timeout_s
+    while time.monotonic() < deadline:
+        try:
+            socket.create_connection(("127.0.0.1", port), timeout=0.2).close()
+            return True
+        except OSError:
+            time.sleep(0.05)
+    return False
+
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--port", type=int, default=1883, help="0 picks a free port")
+    parser.add_argument("--mosquitto", help="run this mosquitto binary instead of the stand-in")
+    parser.add_argument("--exec", nargs=argparse.REMAINDER, dest="command",
+                        help="command to run against the broker; {uri} is replaced")
+    args = parser.parse_args()
+
+    port = args.port or free_port()
+    mosquitto = None
+    if args.mosquitto:
+        mosquitto = subprocess.Popen([args.mosquitto, "-p", str(port)],
+                                     stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        broker_name = "mosquitto"
+    else:
+        broker = Broker(("127.0.0.1", port), Session)
+        threading.Thread(target=broker.serve_forever, daemon=True).start()
+        broker_name = "mqtt_standin"
+    if not wait_for_port(port):
+        print(f"{broker_name} did not start on port {port}", file=sys.stderr)
+        return 1
+    print(f"{broker_name} listening on 127.0.0.1:{port}", flush=True)
+
+    try:
+        if not args.command:
+            threading.Event().wait()
+        uri = f"mqtt://127.0.0.1:{port}"
+        return subprocess.call([arg.replace("{uri}", uri) for arg in args.command])
+    except KeyboardInterrupt:
+        return 0
+    finally:
+        if mosquitto:
+            mosquitto.terminate()
+            mosquitto.wait()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
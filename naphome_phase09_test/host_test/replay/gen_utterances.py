@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""
+Synthesize utterances and decision traces for test_detect_replay.
+
+Each utterance is 10 s of 16 kHz stereo (channel 0 is what the AFE would
+output, channel 1 a quieter copy): background noise at a level that varies
+by a few dB between utterances, as in one room, a wake word made of
+three voiced bursts at 2 s, then a command of 3-9 voiced syllables. A
+third of the commands start up to 1 s after the wake word. Every third
+utterance each is a local command, a command MultiNet matches but the
+firmware does not handle, and a phrase MultiNet never matches (cloud).
+
+The trace next to each WAV tells the replay what WakeNet and MultiNet
+decide and where the speech really is:
+
+    wake <ms>                   WakeNet fires in the frame holding <ms>
+    detected <ms> <id> <kind>   MultiNet matches command <id>; kind is
+                                local (handled) or unhandled
+    speech <start_ms> <end_ms>  The command as spoken, for checking the
+                                STT window
+
+Output is deterministic. Usage: gen_utterances.py OUT_DIR [COUNT]
+"""
+
+import math
+import os
+import random
+import struct
+import sys
+import wave
+
+SAMPLE_RATE = 16000
+DURATION_S = 10
+LOCAL_COMMAND_ID = 13
+UNHANDLED_COMMAND_ID = 3
+
+
+def voiced(x, start, end, amplitude, rng):
+    """Add a four-harmonic vowel-like burst with a sine envelope."""
+    f0 = rng.uniform(100, 250)
+    length = end - start
+    step = [2 * math.pi * f0 * h / SAMPLE_RATE for h in (1, 2, 3, 4)]
+    for n in range(length):
+        env = math.sin(math.pi * n / length)
+        x[start + n] += amplitude * env * (math.sin(step[0] * n) + math.sin(step[1] * n) / 2 +
+                                           math.sin(step[2] * n) / 3 + math.sin(step[3] * n) / 4)
+
+
+def utterance(index, rng):
+    n = SAMPLE_RATE * DURATION_S
+    noise = rng.uniform(80, 160)
+    x = [rng.gauss(0, noise) for _ in range(n)]
+    amplitude = rng.uniform(1500, 6000)
+
+    wake_start = SAMPLE_RATE * 2
+    wake_end = wake_start + int(SAMPLE_RATE * 0.7)
+    for s in range(wake_start, wake_end, int(SAMPLE_RATE * 0.23)):
+        voiced(x, s, s + int(SAMPLE_RATE * 0.2), amplitude, rng)
+    wake = wake_end + int(SAMPLE_RATE * 0.1)
+
+    pos = wake_end + int(SAMPLE_RATE * 0.05)
+    if index % 3 == 0:
+        pos += int(SAMPLE_RATE * rng.uniform(0, 1))     # Pause before the command
+    command_start = pos
+    for _ in range(rng.randint(3, 9)):
+        length = int(SAMPLE_RATE * rng.uniform(0.12, 0.3))
+        voiced(x, pos, pos + length, amplitude * rng.uniform(0.5, 1.1), rng)
+        command_end = pos + length
+        pos += length + int(SAMPLE_RATE * rng.uniform(0.03, 0.25))
+
+    kind = ('local', 'unhandled', 'cloud')[index % 3]
+    trace = ['wake %d' % (wake * 1000 // SAMPLE_RATE)]
+    if kind != 'cloud':
+        command_id = LOCAL_COMMAND_ID if kind == 'local' else UNHANDLED_COMMAND_ID
+        detected = (command_end + int(SAMPLE_RATE * 0.3)) * 1000 // SAMPLE_RATE
+        trace.append('detected %d %d %s' % (detected, command_id, kind))
+    trace.append('speech %d %d' % (command_start * 1000 // SAMPLE_RATE, command_end * 1000 // SAMPLE_RATE))
+    return x, trace
+
+
+def clamp(v):
+    return max(-32768, min(32767, int(v)))
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__.strip().splitlines()[-1])
+    out_dir = sys.argv[1]
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else 24
+    os.makedirs(out_dir, exist_ok=True)
+    rng = random.Random(3)
+    for index in range(count):
+        x, trace = utterance(index, rng)
+        name = os.path.join(out_dir, 'u%02d' % index)
+        with wave.open(name + '.wav', 'wb') as w:
+            w.setnchannels(2)
+            w.setsampwidth(2)
+            w.setframerate(SAMPLE_RATE)
+            w.writeframes(b''.join(struct.pack('<hh', clamp(v), clamp(v * 0.8)) for v in x))
+        with open(name + '.txt', 'w') as f:
+            f.write('\n'.join(trace) + '\n')
+    print('%d utterances in %s' % (count, out_dir))
+
+
+if __name__ == '__main__':
+    main()
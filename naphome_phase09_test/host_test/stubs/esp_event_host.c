@@ -0,0 +1,175 @@
+/**
+ * @file esp_event_host.c
+ * @brief Default event loop stand-in: one dispatch thread, handler call timing
+ */
+
+#include "esp_event.h"
+#include "esp_timer.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EVENT_HOST_MAX_HANDLERS 16
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+} event_host_handler_t;
+
+typedef struct event_host_item {
+    struct event_host_item *next;
+    esp_event_base_t base;
+    int32_t id;
+    size_t len;
+    uint8_t data[];
+} event_host_item_t;
+
+static pthread_mutex_t loop_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t loop_wake = PTHREAD_COND_INITIALIZER;
+static bool loop_created = false;
+static event_host_handler_t handlers[EVENT_HOST_MAX_HANDLERS];
+static size_t handler_count = 0;
+static event_host_item_t *queue_head = NULL;
+static event_host_item_t *queue_tail = NULL;
+
+static _Atomic int64_t max_handler_us = 0;
+static _Atomic uint32_t dispatched = 0;
+
+static void dispatch(const event_host_item_t *item)
+{
+    event_host_handler_t matched[EVENT_HOST_MAX_HANDLERS];
+    size_t count = 0;
+    pthread_mutex_lock(&loop_lock);
+    for (size_t i = 0; i < handler_count; i++) {
+        if (handlers[i].base == item->base && (handlers[i].id == ESP_EVENT_ANY_ID || handlers[i].id == item->id)) {
+            matched[count++] = handlers[i];
+        }
+    }
+    pthread_mutex_unlock(&loop_lock);
+
+    for (size_t i = 0; i < count; i++) {
+        int64_t start = esp_timer_get_time();
+        matched[i].handler(matched[i].arg, item->base, item->id, item->len ? (void *)item->data : NULL);
+        int64_t took = esp_timer_get_time() - start;
+        int64_t seen = atomic_load(&max_handler_us);
+        while (took > seen && !atomic_compare_exchange_weak(&max_handler_us, &seen, took)) {
+        }
+    }
+    atomic_fetch_add(&dispatched, 1);
+}
+
+static void *loop_thread(void *unused)
+{
+    pthread_mutex_lock(&loop_lock);
+    for (;;) {
+        while (!queue_head) {
+            pthread_cond_wait(&loop_wake, &loop_lock);
+        }
+        event_host_item_t *item = queue_head;
+        queue_head = item->next;
+        if (!queue_head) {
+            queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&loop_lock);
+        dispatch(item);
+        free(item);
+        pthread_mutex_lock(&loop_lock);
+    }
+    return NULL;
+}
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    pthread_mutex_lock(&loop_lock);
+    if (loop_created) {
+        pthread_mutex_unlock(&loop_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    loop_created = true;
+    pthread_mutex_unlock(&loop_lock);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, loop_thread, NULL);
+    pthread_detach(thread);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+                                     esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    if (!event_handler) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&loop_lock);
+    if (!loop_created) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else if (handler_count == EVENT_HOST_MAX_HANDLERS) {
+        ret = ESP_ERR_NO_MEM;
+    } else {
+        handlers[handler_count++] = (event_host_handler_t){ event_base, event_id, event_handler, event_handler_arg };
+    }
+    pthread_mutex_unlock(&loop_lock);
+    return ret;
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t event_base, int32_t event_id,
+                                       esp_event_handler_t event_handler)
+{
+    pthread_mutex_lock(&loop_lock);
+    for (size_t i = 0; i < handler_count; i++) {
+        if (handlers[i].base == event_base && handlers[i].id == event_id && handlers[i].handler == event_handler) {
+            memmove(&handlers[i], &handlers[i + 1], (handler_count - i - 1) * sizeof(handlers[0]));
+            handler_count--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&loop_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void *event_data,
+                         size_t event_data_size, TickType_t ticks_to_wait)
+{
+    event_host_item_t *item = malloc(sizeof(*item) + event_data_size);
+    if (!item) {
+        return ESP_ERR_NO_MEM;
+    }
+    item->next = NULL;
+    item->base = event_base;
+    item->id = event_id;
+    item->len = event_data_size;
+    if (event_data_size) {
+        memcpy(item->data, event_data, event_data_size);
+    }
+
+    pthread_mutex_lock(&loop_lock);
+    if (!loop_created) {
+        pthread_mutex_unlock(&loop_lock);
+        free(item);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (queue_tail) {
+        queue_tail->next = item;
+    } else {
+        queue_head = item;
+    }
+    queue_tail = item;
+    pthread_cond_signal(&loop_wake);
+    pthread_mutex_unlock(&loop_lock);
+    return ESP_OK;
+}
+
+int64_t host_esp_event_max_handler_us(void)
+{
+    return atomic_load(&max_handler_us);
+}
+
+uint32_t host_esp_event_dispatched(void)
+{
+    return atomic_load(&dispatched);
+}
@@ -0,0 +1,425 @@
+/**
+ * @file esp_host.c
+ * @brief esp_err, esp_log, esp_timer, heap_caps, chip info and mDNS for host builds
+ */
+
+#include "esp_chip_info.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_rom_crc.h"
+#include "esp_rom_sys.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "mdns.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ---------------------------------------------------------------------------
+// esp_err
+// ---------------------------------------------------------------------------
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                    return "ESP_OK";
+    case ESP_FAIL:                  return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:            return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:       return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:     return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:         return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:     return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:           return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE:  return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:       return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION:   return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_NOT_FINISHED:      return "ESP_ERR_NOT_FINISHED";
+    case ESP_ERR_NOT_ALLOWED:       return "ESP_ERR_NOT_ALLOWED";
+    default:                        return "UNKNOWN ERROR";
+    }
+}
+
+void host_abort_on_error(esp_err_t err, const char *file, int line, const char *expr)
+{
+    fprintf(stderr, "ESP_ERROR_CHECK failed: %s (0x%x) at %s:%d\nexpression: %s\n",
+            esp_err_to_name(err), err, file, line, expr);
+    abort();
+}
+
+// ---------------------------------------------------------------------------
+// esp_log
+// ---------------------------------------------------------------------------
+
+static esp_log_level_t log_level = ESP_LOG_INFO;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    log_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    if (level > log_level) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    flockfile(stderr);
+    fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(esp_timer_get_time() / 1000), tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    funlockfile(stderr);
+    va_end(args);
+}
+
+void esp_log_buffer_hexdump_internal(const char *tag, const void *buffer, size_t len, esp_log_level_t level)
+{
+    const uint8_t *bytes = buffer;
+    for (size_t i = 0; i < len; i += 16) {
+        char line[64];
+        size_t n = 0;
+        for (size_t j = i; j < len && j < i + 16; j++) {
+            n += snprintf(line + n, sizeof(line) - n, "%02x ", bytes[j]);
+        }
+        esp_log_write(level, tag, "%p: %s", (const void *)(bytes + i), line);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// esp_timer: one dispatch thread runs every callback, as ESP_TIMER_TASK does
+// ---------------------------------------------------------------------------
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t alarm_us;           // 0: not armed
+    uint64_t period_us;         // 0: one-shot
+    struct esp_timer *next;
+};
+
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_changed = PTHREAD_COND_INITIALIZER;
+static struct esp_timer *timers = NULL;
+static pthread_once_t timer_thread_once = PTHREAD_ONCE_INIT;
+
+static struct timespec start_time;
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+
+static void set_start_time(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    pthread_once(&start_once, set_start_time);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - start_time.tv_sec) * 1000000 + (now.tv_nsec - start_time.tv_nsec) / 1000;
+}
+
+static void *timer_thread(void *unused)
+{
+    pthread_mutex_lock(&timer_lock);
+    for (;;) {
+        struct esp_timer *due = NULL;
+        int64_t now = esp_timer_get_time();
+        int64_t next_alarm = 0;
+        for (struct esp_timer *t = timers; t; t = t->next) {
+            if (t->alarm_us == 0) {
+                continue;
+            }
+            if (t->alarm_us <= now) {
+                due = t;
+                break;
+            }
+            if (next_alarm == 0 || t->alarm_us < next_alarm) {
+                next_alarm = t->alarm_us;
+            }
+        }
+        if (due) {
+            due->alarm_us = due->period_us ? due->alarm_us + (int64_t)due->period_us : 0;
+            esp_timer_cb_t callback = due->callback;
+            void *arg = due->arg;
+            pthread_mutex_unlock(&timer_lock);
+            callback(arg);
+            pthread_mutex_lock(&timer_lock);
+            continue;
+        }
+        if (next_alarm == 0) {
+            pthread_cond_wait(&timer_changed, &timer_lock);
+        } else {
+            // Convert the monotonic alarm into a CLOCK_REALTIME deadline
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            int64_t wait_us = next_alarm - now;
+            deadline.tv_sec += wait_us / 1000000;
+            deadline.tv_nsec += (wait_us % 1000000) * 1000;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&timer_changed, &timer_lock, &deadline);
+        }
+    }
+    return NULL;
+}
+
+static void start_timer_thread(void)
+{
+    pthread_t thread;
+    pthread_create(&thread, NULL, timer_thread, NULL);
+    pthread_detach(thread);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (!args || !args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct esp_timer *timer = calloc(1, sizeof(*timer));
+    if (!timer) {
+        return ESP_ERR_NO_MEM;
+    }
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    pthread_once(&timer_thread_once, start_timer_thread);
+    pthread_mutex_lock(&timer_lock);
+    timer->next = timers;
+    timers = timer;
+    pthread_mutex_unlock(&timer_lock);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us)
+{
+    pthread_mutex_lock(&timer_lock);
+    if (timer->alarm_us != 0) {
+        pthread_mutex_unlock(&timer_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->alarm_us = esp_timer_get_time() + (int64_t)(timeout_us ? timeout_us : 1);
+    timer->period_us = period_us;
+    pthread_cond_signal(&timer_changed);
+    pthread_mutex_unlock(&timer_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return timer_arm(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer_lock);
+    esp_err_t ret = timer->alarm_us != 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+    timer->alarm_us = 0;
+    pthread_mutex_unlock(&timer_lock);
+    return ret;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer_lock);
+    bool active = timer->alarm_us != 0;
+    pthread_mutex_unlock(&timer_lock);
+    return active;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer_lock);
+    for (struct esp_timer **p = &timers; *p; p = &(*p)->next) {
+        if (*p == timer) {
+            *p = timer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&timer_lock);
+    free(timer);
+    return ESP_OK;
+}
+
+// ---------------------------------------------------------------------------
+// heap_caps: plain malloc, with a per-capability tally for tests
+// ---------------------------------------------------------------------------
+
+#define HEAP_CAPS_TRACKED 16
+
+static size_t requested[HEAP_CAPS_TRACKED];
+
+static void tally(size_t size, uint32_t caps)
+{
+    for (int bit = 0; bit < HEAP_CAPS_TRACKED; bit++) {
+        if (caps & (1u << bit)) {
+            __atomic_add_fetch(&requested[bit], size, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+size_t host_heap_caps_requested(uint32_t cap)
+{
+    if (cap == 0) {
+        return 0;
+    }
+    return __atomic_load_n(&requested[__builtin_ctz(cap)], __ATOMIC_RELAXED);
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    tally(size, caps);
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    tally(n * size, caps);
+    return calloc(n, size);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    tally(size, caps);
+    return realloc(ptr, size);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return caps & MALLOC_CAP_SPIRAM ? 8u << 20 : 256u << 10;
+}
+
+size_t heap_caps_get_total_size(uint32_t caps)
+{
+    return caps & MALLOC_CAP_SPIRAM ? 8u << 20 : 320u << 10;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return heap_caps_get_free_size(caps);
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return heap_caps_get_free_size(caps);
+}
+
+void heap_caps_get_info(multi_heap_info_t *info, uint32_t caps)
+{
+    memset(info, 0, sizeof(*info));
+    info->total_free_bytes = heap_caps_get_free_size(caps);
+    info->total_allocated_bytes = heap_caps_get_total_size(caps) - info->total_free_bytes;
+    info->largest_free_block = heap_caps_get_largest_free_block(caps);
+    info->minimum_free_bytes = heap_caps_get_minimum_free_size(caps);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+}
+
+// ---------------------------------------------------------------------------
+// Chip info and mDNS
+// ---------------------------------------------------------------------------
+
+void esp_chip_info(esp_chip_info_t *out_info)
+{
+    *out_info = (esp_chip_info_t){ .model = CHIP_ESP32S3, .revision = 2, .cores = 2 };
+}
+
+esp_err_t mdns_init(void)
+{
+    return ESP_OK;
+}
+
+void mdns_free(void)
+{
+}
+
+esp_err_t mdns_hostname_set(const char *hostname)
+{
+    return hostname ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t mdns_instance_name_set(const char *instance_name)
+{
+    return instance_name ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t mdns_service_add(const char *instance_name, const char *service_type, const char *proto,
+                           uint16_t port, mdns_txt_item_t txt[], size_t num_items)
+{
+    return service_type && proto ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// ---------------------------------------------------------------------------
+// esp_random
+// ---------------------------------------------------------------------------
+
+uint32_t esp_random(void)
+{
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    static uint64_t state = 0x9E3779B97F4A7C15ull;
+    pthread_mutex_lock(&lock);
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    uint32_t value = (uint32_t)(state >> 32);
+    pthread_mutex_unlock(&lock);
+    return value;
+}
+
+void esp_fill_random(void *buf, size_t len)
+{
+    uint8_t *bytes = buf;
+    for (size_t i = 0; i < len; i++) {
+        bytes[i] = (uint8_t)esp_random();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// esp_rom
+// ---------------------------------------------------------------------------
+
+void esp_rom_delay_us(uint32_t us)
+{
+    // Busy-wait like the ROM routine, so callers still burn CPU
+    int64_t end = esp_timer_get_time() + us;
+    while (esp_timer_get_time() < end) {
+    }
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
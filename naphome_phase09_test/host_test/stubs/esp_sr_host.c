@@ -0,0 +1,109 @@
+/**
+ * @file esp_sr_host.c
+ * @brief MultiNet command registration for host builds
+ */
+
+#include "esp_mn_speech_commands.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MN_HOST_MAX_COMMANDS    200
+
+typedef struct {
+    int id;
+    char *phonemes;
+} mn_host_command_t;
+
+static pthread_mutex_t mn_lock = PTHREAD_MUTEX_INITIALIZER;
+static mn_host_command_t staged[MN_HOST_MAX_COMMANDS];
+static size_t staged_count = 0;
+static mn_host_command_t active[MN_HOST_MAX_COMMANDS];
+static size_t active_count = 0;
+static bool allocated = false;
+static esp_mn_error_t no_errors = { 0, NULL };
+
+static void clear(mn_host_command_t *list, size_t *count)
+{
+    for (size_t i = 0; i < *count; i++) {
+        free(list[i].phonemes);
+    }
+    *count = 0;
+}
+
+esp_err_t esp_mn_commands_alloc(esp_mn_iface_t *multinet, model_iface_data_t *model_data)
+{
+    pthread_mutex_lock(&mn_lock);
+    clear(staged, &staged_count);
+    allocated = true;
+    pthread_mutex_unlock(&mn_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_mn_commands_add(int command_id, const char *phoneme_string)
+{
+    if (!phoneme_string || command_id < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&mn_lock);
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    if (allocated && staged_count < MN_HOST_MAX_COMMANDS) {
+        staged[staged_count].id = command_id;
+        staged[staged_count].phonemes = strdup(phoneme_string);
+        staged_count++;
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&mn_lock);
+    return ret;
+}
+
+esp_err_t esp_mn_commands_clear(void)
+{
+    pthread_mutex_lock(&mn_lock);
+    clear(staged, &staged_count);
+    pthread_mutex_unlock(&mn_lock);
+    return ESP_OK;
+}
+
+esp_mn_error_t *esp_mn_commands_update(void)
+{
+    pthread_mutex_lock(&mn_lock);
+    clear(active, &active_count);
+    memcpy(active, staged, staged_count * sizeof(staged[0]));
+    active_count = staged_count;
+    staged_count = 0;
+    pthread_mutex_unlock(&mn_lock);
+    return &no_errors;
+}
+
+esp_err_t esp_mn_commands_free(void)
+{
+    pthread_mutex_lock(&mn_lock);
+    clear(staged, &staged_count);
+    clear(active, &active_count);
+    allocated = false;
+    pthread_mutex_unlock(&mn_lock);
+    return ESP_OK;
+}
+
+size_t host_mn_command_count(void)
+{
+    pthread_mutex_lock(&mn_lock);
+    size_t count = active_count;
+    pthread_mutex_unlock(&mn_lock);
+    return count;
+}
+
+const char *host_mn_command_phonemes(int command_id)
+{
+    const char *phonemes = NULL;
+    pthread_mutex_lock(&mn_lock);
+    for (size_t i = 0; i < active_count && !phonemes; i++) {
+        if (active[i].id == command_id) {
+            phonemes = active[i].phonemes;
+        }
+    }
+    pthread_mutex_unlock(&mn_lock);
+    return phonemes;
+}
@@ -0,0 +1,667 @@
+/**
+ * @file freertos_host.c
+ * @brief FreeRTOS task, semaphore, event group and queue API on pthreads
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct host_task {
+    TaskFunction_t code;
+    void *arg;
+    char name[configMAX_TASK_NAME_LEN];
+    BaseType_t core_id;
+    UBaseType_t priority;
+    uint32_t stack_depth;
+    pthread_mutex_t lock;
+    pthread_cond_t notified;
+    uint32_t notify_value;
+    bool notify_pending;
+
+    // Run-time stats: the thread's CPU clock stands in for the FreeRTOS counter
+    struct host_task *next;     // Registry of live tasks
+    UBaseType_t number;
+    bool idle;                  // Synthetic per-core idle task
+    clockid_t cpu_clock;
+    bool cpu_clock_ok;
+    uint32_t idle_counter;      // Idle tasks: last reported counter, kept monotonic
+};
+
+static __thread struct host_task *current_task = NULL;
+static struct host_task main_task = {
+    .name = "main",
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .notified = PTHREAD_COND_INITIALIZER,
+    .priority = 1,
+};
+static struct host_task idle_tasks[portNUM_PROCESSORS] = {
+    { .name = "IDLE0", .idle = true, .core_id = 0 },
+    { .name = "IDLE1", .idle = true, .core_id = 1 },
+};
+static int next_core = 0;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct host_task *registry = NULL;
+static UBaseType_t registry_count = 0;
+static UBaseType_t next_task_number = 1;
+
+// Absolute CLOCK_REALTIME deadline for a wait of ticks (portMAX_DELAY: none)
+static struct timespec deadline_after(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ticks / 1000;
+    ts.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+// Wait on cond until woken or the deadline passes; false on timeout
+static bool cond_wait_until(pthread_cond_t *cond, pthread_mutex_t *mutex, TickType_t ticks,
+                            const struct timespec *deadline)
+{
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, mutex);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, mutex, deadline) != ETIMEDOUT;
+}
+
+// ---------------------------------------------------------------------------
+// Tasks
+// ---------------------------------------------------------------------------
+
+static struct host_task *self(void)
+{
+    return current_task ? current_task : &main_task;
+}
+
+static void registry_add(struct host_task *task)
+{
+    task->cpu_clock_ok = pthread_getcpuclockid(pthread_self(), &task->cpu_clock) == 0;
+    pthread_mutex_lock(&registry_lock);
+    task->number = next_task_number++;
+    task->next = registry;
+    registry = task;
+    registry_count++;
+    pthread_mutex_unlock(&registry_lock);
+}
+
+static void registry_remove(struct host_task *task)
+{
+    pthread_mutex_lock(&registry_lock);
+    for (struct host_task **p = &registry; *p; p = &(*p)->next) {
+        if (*p == task) {
+            *p = task->next;
+            registry_count--;
+            break;
+        }
+    }
+    task->cpu_clock_ok = false;
+    pthread_mutex_unlock(&registry_lock);
+}
+
+// The process's first thread runs app_main or the test's main()
+__attribute__((constructor))
+static void register_main_task(void)
+{
+    registry_add(&main_task);
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        registry_add(&idle_tasks[core]);
+        idle_tasks[core].cpu_clock_ok = false;
+    }
+}
+
+static void *task_trampoline(void *p)
+{
+    struct host_task *task = p;
+    current_task = task;
+    registry_add(task);
+    task->code(task->arg);
+    registry_remove(task);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *out_handle,
+                                   BaseType_t core_id)
+{
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (!task) {
+        return pdFAIL;
+    }
+    task->code = code;
+    task->arg = arg;
+    strncpy(task->name, name ? name : "", sizeof(task->name) - 1);
+    task->priority = priority;
+    task->stack_depth = stack_depth;
+    task->core_id = core_id == tskNO_AFFINITY ? (__atomic_fetch_add(&next_core, 1, __ATOMIC_RELAXED) & 1) : core_id;
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_cond_init(&task->notified, NULL);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, task_trampoline, task) != 0) {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+    if (out_handle) {
+        *out_handle = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stack_depth,
+                       void *arg, UBaseType_t priority, TaskHandle_t *out_handle)
+{
+    return xTaskCreatePinnedToCore(code, name, stack_depth, arg, priority, out_handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    // Only self-deletion is supported; the handle stays valid for late notifies
+    if (task == NULL || task == current_task) {
+        registry_remove(self());
+        pthread_exit(NULL);
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = { ticks / 1000, (long)(ticks % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t period)
+{
+    *previous_wake += period;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(*previous_wake - now) > 0) {
+        vTaskDelay(*previous_wake - now);
+        return pdTRUE;
+    }
+    return pdFALSE;
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t period)
+{
+    xTaskDelayUntil(previous_wake, period);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return self();
+}
+
+const char *pcTaskGetName(TaskHandle_t task)
+{
+    return (task ? task : self())->name;
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return self()->core_id;
+}
+
+// ---------------------------------------------------------------------------
+// Run-time stats: per-thread CPU clocks as the run-time counters (in us, like
+// ESP-IDF's esp_timer-based counter). Host threads float across real CPUs,
+// so a "core" is the one FreeRTOS would have pinned the task to, and its idle
+// task gets whatever wall time the tasks on it did not use.
+// ---------------------------------------------------------------------------
+
+static uint64_t thread_cpu_us(const struct host_task *task)
+{
+    struct timespec ts;
+    if (!task->cpu_clock_ok || clock_gettime(task->cpu_clock, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+    pthread_mutex_lock(&registry_lock);
+    UBaseType_t n = registry_count;
+    pthread_mutex_unlock(&registry_lock);
+    return n;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t array_size,
+                                 configRUN_TIME_COUNTER_TYPE *total_run_time)
+{
+    uint64_t now_us = (uint64_t)esp_timer_get_time();
+    uint64_t busy_us[portNUM_PROCESSORS] = {0};
+
+    pthread_mutex_lock(&registry_lock);
+    if (array_size < registry_count) {
+        pthread_mutex_unlock(&registry_lock);
+        return 0;
+    }
+    UBaseType_t n = 0;
+    for (struct host_task *task = registry; task; task = task->next, n++) {
+        TaskStatus_t *out = &status[n];
+        memset(out, 0, sizeof(*out));
+        out->xHandle = task;
+        out->pcTaskName = task->name;
+        out->xTaskNumber = task->number;
+        out->eCurrentState = task == self() ? eRunning : (task->idle ? eReady : eBlocked);
+        out->uxCurrentPriority = task->priority;
+        out->uxBasePriority = task->priority;
+        out->xCoreID = task->core_id;
+        out->usStackHighWaterMark = task->stack_depth;  // Not measurable here: the whole stack
+        if (!task->idle) {
+            uint64_t cpu_us = thread_cpu_us(task);
+            out->ulRunTimeCounter = (configRUN_TIME_COUNTER_TYPE)cpu_us;
+            busy_us[task->core_id & 1] += cpu_us;
+        }
+    }
+    for (UBaseType_t i = 0; i < n; i++) {
+        struct host_task *task = status[i].xHandle;
+        if (task->idle) {
+            uint64_t idle_us = now_us > busy_us[task->core_id] ? now_us - busy_us[task->core_id] : 0;
+            if ((uint32_t)idle_us > task->idle_counter) {
+                task->idle_counter = (uint32_t)idle_us;
+            }
+            status[i].ulRunTimeCounter = task->idle_counter;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+    if (total_run_time) {
+        *total_run_time = (configRUN_TIME_COUNTER_TYPE)now_us;
+    }
+    return n;
+}
+
+TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t core_id)
+{
+    return &idle_tasks[core_id & 1];
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    pthread_mutex_lock(&task->lock);
+    switch (action) {
+    case eSetBits:
+        task->notify_value |= value;
+        break;
+    case eIncrement:
+        task->notify_value++;
+        break;
+    case eSetValueWithOverwrite:
+        task->notify_value = value;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (task->notify_pending) {
+            pthread_mutex_unlock(&task->lock);
+            return pdFAIL;
+        }
+        task->notify_value = value;
+        break;
+    case eNoAction:
+        break;
+    }
+    task->notify_pending = true;
+    pthread_cond_broadcast(&task->notified);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks)
+{
+    struct host_task *task = self();
+    struct timespec deadline = deadline_after(ticks);
+    pthread_mutex_lock(&task->lock);
+    if (!task->notify_pending) {
+        task->notify_value &= ~clear_on_entry;
+    }
+    while (!task->notify_pending) {
+        if (!cond_wait_until(&task->notified, &task->lock, ticks, &deadline)) {
+            break;
+        }
+    }
+    BaseType_t got = task->notify_pending ? pdTRUE : pdFALSE;
+    if (value) {
+        *value = task->notify_value;
+    }
+    if (got) {
+        task->notify_value &= ~clear_on_exit;
+        task->notify_pending = false;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return got;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct host_task *task = self();
+    struct timespec deadline = deadline_after(ticks);
+    pthread_mutex_lock(&task->lock);
+    while (task->notify_value == 0) {
+        if (!cond_wait_until(&task->notified, &task->lock, ticks, &deadline)) {
+            break;
+        }
+    }
+    uint32_t value = task->notify_value;
+    if (value) {
+        task->notify_value = clear_on_exit ? 0 : value - 1;
+    }
+    task->notify_pending = false;
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+// ---------------------------------------------------------------------------
+// Semaphores (mutexes are binary semaphores that start given)
+// ---------------------------------------------------------------------------
+
+struct host_sem {
+    pthread_mutex_t lock;
+    pthread_cond_t given;
+    UBaseType_t count;
+    UBaseType_t max;
+};
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    struct host_sem *sem = calloc(1, sizeof(*sem));
+    if (!sem) {
+        return NULL;
+    }
+    pthread_mutex_init(&sem->lock, NULL);
+    pthread_cond_init(&sem->given, NULL);
+    sem->count = initial_count;
+    sem->max = max_count;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    struct timespec deadline = deadline_after(ticks);
+    pthread_mutex_lock(&sem->lock);
+    while (sem->count == 0) {
+        if (ticks == 0 || !cond_wait_until(&sem->given, &sem->lock, ticks, &deadline)) {
+            break;
+        }
+    }
+    BaseType_t taken = pdFALSE;
+    if (sem->count > 0) {
+        sem->count--;
+        taken = pdTRUE;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return taken;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    BaseType_t given = pdFALSE;
+    if (sem->count < sem->max) {
+        sem->count++;
+        given = pdTRUE;
+        pthread_cond_signal(&sem->given);
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return given;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    UBaseType_t count = sem->count;
+    pthread_mutex_unlock(&sem->lock);
+    return count;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    if (sem) {
+        pthread_mutex_destroy(&sem->lock);
+        pthread_cond_destroy(&sem->given);
+        free(sem);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Event groups
+// ---------------------------------------------------------------------------
+
+struct host_event_group {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    struct host_event_group *group = calloc(1, sizeof(*group));
+    if (!group) {
+        return NULL;
+    }
+    pthread_mutex_init(&group->lock, NULL);
+    pthread_cond_init(&group->changed, NULL);
+    return group;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group)
+{
+    if (group) {
+        pthread_mutex_destroy(&group->lock);
+        pthread_cond_destroy(&group->changed);
+        free(group);
+    }
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock(&group->lock);
+    group->bits |= bits;
+    EventBits_t now = group->bits;
+    pthread_cond_broadcast(&group->changed);
+    pthread_mutex_unlock(&group->lock);
+    return now;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock(&group->lock);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    pthread_mutex_unlock(&group->lock);
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    pthread_mutex_lock(&group->lock);
+    EventBits_t now = group->bits;
+    pthread_mutex_unlock(&group->lock);
+    return now;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks)
+{
+    struct timespec deadline = deadline_after(ticks);
+    pthread_mutex_lock(&group->lock);
+    for (;;) {
+        EventBits_t hit = group->bits & bits;
+        if (wait_for_all ? hit == bits : hit != 0) {
+            break;
+        }
+        if (ticks == 0 || !cond_wait_until(&group->changed, &group->lock, ticks, &deadline)) {
+            break;
+        }
+    }
+    EventBits_t now = group->bits;
+    EventBits_t hit = now & bits;
+    if (clear_on_exit && (wait_for_all ? hit == bits : hit != 0)) {
+        group->bits &= ~bits;
+    }
+    pthread_mutex_unlock(&group->lock);
+    return now;
+}
+
+// ---------------------------------------------------------------------------
+// Queues
+// ---------------------------------------------------------------------------
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t *items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct host_queue *queue = calloc(1, sizeof(*queue));
+    if (!queue) {
+        return NULL;
+    }
+    queue->items = calloc(length, item_size ? item_size : 1);
+    if (!queue->items) {
+        free(queue);
+        return NULL;
+    }
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->changed, NULL);
+    queue->length = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    if (queue) {
+        pthread_mutex_destroy(&queue->lock);
+        pthread_cond_destroy(&queue->changed);
+        free(queue->items);
+        free(queue);
+    }
+}
+
+static BaseType_t queue_put(QueueHandle_t queue, const void *item, TickType_t ticks, bool front)
+{
+    struct timespec deadline = deadline_after(ticks);
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->length) {
+        if (ticks == 0 || !cond_wait_until(&queue->changed, &queue->lock, ticks, &deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return errQUEUE_FULL;
+        }
+    }
+    UBaseType_t slot;
+    if (front) {
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        slot = queue->head;
+    } else {
+        slot = (queue->head + queue->count) % queue->length;
+    }
+    memcpy(queue->items + slot * queue->item_size, item, queue->item_size);
+    queue->count++;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    return queue_put(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    return queue_put(queue, item, ticks, true);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->head = 0;
+    queue->count = 1;
+    memcpy(queue->items, item, queue->item_size);
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    struct timespec deadline = deadline_after(ticks);
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0) {
+        if (ticks == 0 || !cond_wait_until(&queue->changed, &queue->lock, ticks, &deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return errQUEUE_EMPTY;
+        }
+    }
+    memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->head = 0;
+    queue->count = 0;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t spaces = queue->length - queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return spaces;
+}
@@ -0,0 +1,410 @@
+/**
+ * @file http_client_host.c
+ * @brief esp_http_client stand-in for host builds: HTTP/1.1 with keep-alive over TCP
+ */
+
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *TAG = "http_host";
+
+#define HTTP_HOST_MAX_HEADERS   8
+#define HTTP_HOST_HEADER_MAX    1024    // Request or response header block
+#define HTTP_HOST_RX_BUFFER     2048
+
+typedef struct {
+    char key[48];
+    char value[128];
+} http_host_header_t;
+
+struct esp_http_client {
+    char host[64];
+    char port[8];
+    char path[256];
+    esp_http_client_method_t method;
+    int timeout_ms;
+    http_event_handle_cb event_handler;
+    void *user_data;
+    http_host_header_t headers[HTTP_HOST_MAX_HEADERS];
+    int header_count;
+
+    int sock;                           // -1: not connected
+    int status;
+    int64_t content_length;
+    int64_t body_left;
+    uint8_t rx[HTTP_HOST_RX_BUFFER];
+    size_t rx_pos;
+    size_t rx_len;
+};
+
+static _Atomic uint32_t connect_delay_ms = 0;
+static _Atomic uint32_t next_connect_extra_ms = 0;
+static _Atomic uint32_t connections = 0;
+
+static void dispatch(esp_http_client_handle_t client, esp_http_client_event_id_t id, void *data, int len,
+                     char *key, char *value)
+{
+    if (!client->event_handler) {
+        return;
+    }
+    esp_http_client_event_t evt = {
+        .event_id = id,
+        .client = client,
+        .data = data,
+        .data_len = len,
+        .user_data = client->user_data,
+        .header_key = key,
+        .header_value = value,
+    };
+    client->event_handler(&evt);
+}
+
+static esp_err_t parse_url(esp_http_client_handle_t client, const char *url)
+{
+    if (strncmp(url, "http://", 7) != 0) {
+        ESP_LOGE(TAG, "Only http:// on the host: %s", url);
+        return ESP_ERR_HTTP_INVALID_TRANSPORT;
+    }
+    const char *host = url + 7;
+    const char *path = strchr(host, '/');
+    size_t host_len = path ? (size_t)(path - host) : strlen(host);
+    const char *colon = memchr(host, ':', host_len);
+    size_t name_len = colon ? (size_t)(colon - host) : host_len;
+    if (name_len == 0 || name_len >= sizeof(client->host)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(client->host, host, name_len);
+    client->host[name_len] = '\0';
+    snprintf(client->port, sizeof(client->port), "%.*s", colon ? (int)(host_len - name_len - 1) : 2,
+             colon ? colon + 1 : "80");
+    snprintf(client->path, sizeof(client->path), "%s", path ? path : "/");
+    return ESP_OK;
+}
+
+static void set_socket_timeout(esp_http_client_handle_t client)
+{
+    struct timeval tv = { client->timeout_ms / 1000, (client->timeout_ms % 1000) * 1000 };
+    setsockopt(client->sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(client->sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static esp_err_t connect_client(esp_http_client_handle_t client)
+{
+    if (client->sock >= 0) {
+        return ESP_OK;
+    }
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(client->host, client->port, &hints, &res) != 0 || !res) {
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    int sock = socket(res->ai_family, res->ai_socktype, 0);
+    int connected = sock >= 0 && connect(sock, res->ai_addr, res->ai_addrlen) == 0;
+    freeaddrinfo(res);
+    if (!connected) {
+        if (sock >= 0) {
+            close(sock);
+        }
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    client->sock = sock;
+    client->rx_pos = client->rx_len = 0;
+    set_socket_timeout(client);
+    atomic_fetch_add(&connections, 1);
+
+    uint32_t delay_ms = atomic_load(&connect_delay_ms) + atomic_exchange(&next_connect_extra_ms, 0);
+    if (delay_ms) {
+        struct timespec ts = { delay_ms / 1000, (long)(delay_ms % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    dispatch(client, HTTP_EVENT_ON_CONNECTED, NULL, 0, NULL, NULL);
+    return ESP_OK;
+}
+
+static bool send_all(esp_http_client_handle_t client, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len > 0) {
+        ssize_t n = send(client->sock, p, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Refill the receive buffer; false on close, error or timeout
+static bool fill(esp_http_client_handle_t client)
+{
+    ssize_t n = recv(client->sock, client->rx, sizeof(client->rx), 0);
+    if (n <= 0) {
+        return false;
+    }
+    client->rx_pos = 0;
+    client->rx_len = (size_t)n;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Client API
+// ---------------------------------------------------------------------------
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    if (!config || !config->url) {
+        return NULL;
+    }
+    esp_http_client_handle_t client = calloc(1, sizeof(*client));
+    if (!client) {
+        return NULL;
+    }
+    if (parse_url(client, config->url) != ESP_OK) {
+        free(client);
+        return NULL;
+    }
+    client->method = config->method;
+    client->timeout_ms = config->timeout_ms ? config->timeout_ms : 5000;
+    client->event_handler = config->event_handler;
+    client->user_data = config->user_data;
+    client->sock = -1;
+    return client;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url)
+{
+    char host[sizeof(client->host)];
+    char port[sizeof(client->port)];
+    strcpy(host, client->host);
+    strcpy(port, client->port);
+    esp_err_t ret = parse_url(client, url);
+    if (ret == ESP_OK && (strcmp(host, client->host) != 0 || strcmp(port, client->port) != 0)) {
+        esp_http_client_close(client);
+    }
+    return ret;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method)
+{
+    client->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t client, int timeout_ms)
+{
+    client->timeout_ms = timeout_ms;
+    if (client->sock >= 0) {
+        set_socket_timeout(client);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    for (int i = 0; i < client->header_count; i++) {
+        if (strcasecmp(client->headers[i].key, key) == 0) {
+            snprintf(client->headers[i].value, sizeof(client->headers[i].value), "%s", value);
+            return ESP_OK;
+        }
+    }
+    if (client->header_count == HTTP_HOST_MAX_HEADERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    http_host_header_t *h = &client->headers[client->header_count++];
+    snprintf(h->key, sizeof(h->key), "%s", key);
+    snprintf(h->value, sizeof(h->value), "%s", value);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_user_data(esp_http_client_handle_t client, void *data)
+{
+    client->user_data = data;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len)
+{
+    static const char *const methods[] = { "GET", "POST", "PUT", "PATCH", "DELETE", "HEAD" };
+    esp_err_t ret = connect_client(client);
+    if (ret != ESP_OK) {
+        dispatch(client, HTTP_EVENT_ERROR, NULL, 0, NULL, NULL);
+        return ret;
+    }
+    char request[HTTP_HOST_HEADER_MAX];
+    int n = snprintf(request, sizeof(request), "%s %s HTTP/1.1\r\nHost: %s\r\nContent-Length: %d\r\n",
+                     methods[client->method], client->path, client->host, write_len);
+    for (int i = 0; i < client->header_count && n < (int)sizeof(request); i++) {
+        n += snprintf(request + n, sizeof(request) - n, "%s: %s\r\n", client->headers[i].key,
+                      client->headers[i].value);
+    }
+    if (n < (int)sizeof(request)) {
+        n += snprintf(request + n, sizeof(request) - n, "\r\n");
+    }
+    if (n >= (int)sizeof(request)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!send_all(client, request, n)) {
+        esp_http_client_close(client);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+    client->status = 0;
+    client->content_length = 0;
+    client->body_left = 0;
+    dispatch(client, HTTP_EVENT_HEADERS_SENT, NULL, 0, NULL, NULL);
+    return ESP_OK;
+}
+
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len)
+{
+    if (client->sock < 0) {
+        return -1;
+    }
+    return send_all(client, buffer, len) ? len : -1;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client)
+{
+    if (client->sock < 0) {
+        return ESP_FAIL;
+    }
+    char block[HTTP_HOST_HEADER_MAX];
+    size_t len = 0;
+    while (len < 4 || memcmp(block + len - 4, "\r\n\r\n", 4) != 0) {
+        if (len == sizeof(block) - 1 || (client->rx_pos == client->rx_len && !fill(client))) {
+            return ESP_FAIL;
+        }
+        block[len++] = (char)client->rx[client->rx_pos++];
+    }
+    block[len] = '\0';
+
+    if (sscanf(block, "HTTP/1.%*d %d", &client->status) != 1) {
+        return ESP_FAIL;
+    }
+    client->content_length = 0;
+    char *saveptr = NULL;
+    strtok_r(block, "\r\n", &saveptr);  // Status line
+    for (char *line = strtok_r(NULL, "\r\n", &saveptr); line; line = strtok_r(NULL, "\r\n", &saveptr)) {
+        char *colon = strchr(line, ':');
+        if (!colon) {
+            continue;
+        }
+        *colon = '\0';
+        char *value = colon + 1;
+        while (*value == ' ') {
+            value++;
+        }
+        if (strcasecmp(line, "Content-Length") == 0) {
+            client->content_length = atoll(value);
+        }
+        dispatch(client, HTTP_EVENT_ON_HEADER, NULL, 0, line, value);
+    }
+    client->body_left = client->method == HTTP_METHOD_HEAD ? 0 : client->content_length;
+    return client->body_left;
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len)
+{
+    if (client->sock < 0 || client->body_left <= 0) {
+        return 0;
+    }
+    if (client->rx_pos == client->rx_len && !fill(client)) {
+        return -1;
+    }
+    size_t n = client->rx_len - client->rx_pos;
+    n = n < (size_t)len ? n : (size_t)len;
+    n = (int64_t)n < client->body_left ? n : (size_t)client->body_left;
+    memcpy(buffer, client->rx + client->rx_pos, n);
+    client->rx_pos += n;
+    client->body_left -= (int64_t)n;
+    dispatch(client, HTTP_EVENT_ON_DATA, buffer, (int)n, NULL, NULL);
+    return (int)n;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
+{
+    esp_err_t ret = esp_http_client_open(client, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (esp_http_client_fetch_headers(client) < 0) {
+        esp_http_client_close(client);
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    char chunk[256];
+    while (client->body_left > 0) {
+        if (esp_http_client_read(client, chunk, sizeof(chunk)) <= 0) {
+            esp_http_client_close(client);
+            return ESP_FAIL;
+        }
+    }
+    dispatch(client, HTTP_EVENT_ON_FINISH, NULL, 0, NULL, NULL);
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status;
+}
+
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t client)
+{
+    return client->content_length;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    if (client->sock >= 0) {
+        close(client->sock);
+        client->sock = -1;
+        client->rx_pos = client->rx_len = 0;
+        dispatch(client, HTTP_EVENT_DISCONNECTED, NULL, 0, NULL, NULL);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    if (!client) {
+        return ESP_FAIL;
+    }
+    esp_http_client_close(client);
+    free(client);
+    return ESP_OK;
+}
+
+void host_http_client_set_connect_delay_ms(uint32_t delay_ms)
+{
+    atomic_store(&connect_delay_ms, delay_ms);
+}
+
+void host_http_client_delay_next_connect_ms(uint32_t extra_ms)
+{
+    atomic_store(&next_connect_extra_ms, extra_ms);
+}
+
+uint32_t host_http_client_connections(void)
+{
+    return atomic_load(&connections);
+}
+
+void host_http_client_drop(esp_http_client_handle_t client)
+{
+    if (client->sock >= 0) {
+        shutdown(client->sock, SHUT_RDWR);
+    }
+}
@@ -0,0 +1,617 @@
+/**
+ * @file httpd_host.c
+ * @brief In-memory esp_http_server requests and responses for host builds
+ *
+ * The server half has no sockets: one httpd task runs queued work, and the
+ * WebSocket sessions the test opens, feeds and closes are run on it too, so
+ * handlers, close_fn and work items never overlap as on the device.
+ */
+
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+static const char *TAG = "httpd_host";
+
+static void hdr_set(host_httpd_hdr_t *hdrs, size_t *count, const char *name, const char *value)
+{
+    if (*count < HOST_HTTPD_MAX_HDRS) {
+        hdrs[*count].name = strdup(name);
+        hdrs[*count].value = strdup(value);
+        (*count)++;
+    }
+}
+
+static const char *hdr_find(const host_httpd_hdr_t *hdrs, size_t count, const char *name)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (strcasecmp(hdrs[i].name, name) == 0) {
+            return hdrs[i].value;
+        }
+    }
+    return NULL;
+}
+
+static void body_append(httpd_req_t *r, const char *buf, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    r->resp.body = realloc(r->resp.body, r->resp.body_len + len);
+    memcpy(r->resp.body + r->resp.body_len, buf, len);
+    r->resp.body_len += len;
+}
+
+void host_httpd_req_init(httpd_req_t *r, httpd_method_t method, const char *uri,
+                         const void *body, size_t body_len, void *user_ctx)
+{
+    memset(r, 0, sizeof(*r));
+    r->method = method;
+    snprintf(r->uri, sizeof(r->uri), "%s", uri);
+    r->req_body = body;
+    r->content_len = body_len;
+    r->user_ctx = user_ctx;
+    r->fd = -1;
+    strcpy(r->resp.status, "200 OK");
+    strcpy(r->resp.content_type, "text/html");
+}
+
+void host_httpd_req_add_hdr(httpd_req_t *r, const char *name, const char *value)
+{
+    hdr_set(r->req_hdrs, &r->req_hdr_count, name, value);
+}
+
+const char *host_httpd_resp_hdr(const httpd_req_t *r, const char *name)
+{
+    return hdr_find(r->resp.hdrs, r->resp.hdr_count, name);
+}
+
+size_t host_httpd_resp_wire_len(const httpd_req_t *r)
+{
+    char line[160];
+    size_t len = snprintf(line, sizeof(line), "HTTP/1.1 %s\r\nContent-Type: %s\r\n",
+                          r->resp.status, r->resp.content_type);
+    if (r->resp.chunks) {
+        len += strlen("Transfer-Encoding: chunked\r\n");
+    } else {
+        len += snprintf(line, sizeof(line), "Content-Length: %zu\r\n", r->resp.body_len);
+    }
+    for (size_t i = 0; i < r->resp.hdr_count; i++) {
+        len += strlen(r->resp.hdrs[i].name) + strlen(r->resp.hdrs[i].value) + 4;
+    }
+    len += 2 + r->resp.body_len;
+    if (r->resp.chunks) {
+        len += r->resp.chunks * 8;      // "<hex>\r\n" and trailing "\r\n" per chunk, roughly
+    }
+    return len;
+}
+
+void host_httpd_req_free(httpd_req_t *r)
+{
+    for (size_t i = 0; i < r->req_hdr_count; i++) {
+        free(r->req_hdrs[i].name);
+        free(r->req_hdrs[i].value);
+    }
+    for (size_t i = 0; i < r->resp.hdr_count; i++) {
+        free(r->resp.hdrs[i].name);
+        free(r->resp.hdrs[i].value);
+    }
+    free(r->resp.body);
+    memset(r, 0, sizeof(*r));
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    snprintf(r->resp.content_type, sizeof(r->resp.content_type), "%s", type);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    snprintf(r->resp.status, sizeof(r->resp.status), "%s", status);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    if (r->resp.hdr_count == HOST_HTTPD_MAX_HDRS) {
+        return ESP_ERR_NO_MEM;
+    }
+    hdr_set(r->resp.hdrs, &r->resp.hdr_count, field, value);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    if (r->resp.sent) {
+        return ESP_FAIL;
+    }
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf ? strlen(buf) : 0;
+    }
+    body_append(r, buf, buf_len);
+    r->resp.sent = true;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    if (r->resp.sent) {
+        return ESP_FAIL;
+    }
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf ? strlen(buf) : 0;
+    }
+    r->resp.chunks++;
+    if (buf == NULL || buf_len == 0) {
+        r->resp.sent = true;        // Terminating chunk
+        return ESP_OK;
+    }
+    body_append(r, buf, buf_len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_sendstr(httpd_req_t *r, const char *str)
+{
+    return httpd_resp_send(r, str, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *r, httpd_err_code_t error, const char *msg)
+{
+    const char *reason;
+    switch (error) {
+    case HTTPD_400_BAD_REQUEST:           reason = "Bad Request"; break;
+    case HTTPD_401_UNAUTHORIZED:          reason = "Unauthorized"; break;
+    case HTTPD_403_FORBIDDEN:             reason = "Forbidden"; break;
+    case HTTPD_404_NOT_FOUND:             reason = "Not Found"; break;
+    case HTTPD_408_REQ_TIMEOUT:           reason = "Request Timeout"; break;
+    default:                              reason = "Internal Server Error"; break;
+    }
+    snprintf(r->resp.status, sizeof(r->resp.status), "%d %s", (int)error, reason);
+    httpd_resp_set_type(r, "text/html");
+    return httpd_resp_send(r, msg ? msg : reason, HTTPD_RESP_USE_STRLEN);
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+{
+    const char *value = hdr_find(r->req_hdrs, r->req_hdr_count, field);
+    return value ? strlen(value) : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+    const char *value = hdr_find(r->req_hdrs, r->req_hdr_count, field);
+    if (value == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    snprintf(val, val_size, "%s", value);
+    return strlen(value) < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    size_t left = r->content_len - r->req_body_pos;
+    size_t n = left < buf_len ? left : buf_len;
+    memcpy(buf, r->req_body + r->req_body_pos, n);
+    r->req_body_pos += n;
+    return (int)n;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    const char *query = strchr(r->uri, '?');
+    if (query == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    snprintf(buf, buf_len, "%s", query + 1);
+    return strlen(query + 1) < buf_len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size)
+{
+    size_t key_len = strlen(key);
+    for (const char *p = qry; p && *p; p = strchr(p, '&') ? strchr(p, '&') + 1 : NULL) {
+        if (strncmp(p, key, key_len) == 0 && p[key_len] == '=') {
+            const char *value = p + key_len + 1;
+            size_t len = strcspn(value, "&");
+            snprintf(val, val_size, "%.*s", (int)len, value);
+            return len < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// ---------------------------------------------------------------------------
+// Server: the httpd task, URI handlers and WebSocket sessions
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    bool used;                          // Has held a session; frames stay readable after close
+    bool open;
+    int fd;
+    const httpd_uri_t *uri;
+    const char *rx;                     // Frame being delivered to the handler
+    size_t rx_len;
+    size_t frame_count;
+    host_httpd_ws_sent_t frames[HOST_HTTPD_MAX_FRAMES];
+} host_session_t;
+
+typedef struct {
+    httpd_work_fn_t fn;
+    void *arg;
+    SemaphoreHandle_t done;             // Host operations wait for their item; queued work does not
+} host_work_t;
+
+typedef struct {
+    httpd_config_t config;
+    httpd_uri_t uris[HOST_HTTPD_MAX_URIS];
+    size_t uri_count;
+    QueueHandle_t work;
+    SemaphoreHandle_t stopped;
+    pthread_mutex_t lock;               // Sessions and stats, read by the test while the task runs
+    host_session_t sessions[HOST_HTTPD_MAX_SESSIONS];
+    uint32_t work_seq;                  // Queued work item running, 0 between items
+    int64_t work_us;
+    uint32_t work_items;
+    uint64_t work_cpu_us;
+} host_server_t;
+
+static host_server_t *running;
+
+static uint64_t thread_cpu_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void httpd_task(void *arg)
+{
+    host_server_t *server = arg;
+    host_work_t item;
+    while (xQueueReceive(server->work, &item, portMAX_DELAY) == pdTRUE) {
+        if (item.fn == NULL) {
+            break;                      // httpd_stop()
+        }
+        if (item.done) {
+            item.fn(item.arg);
+            xSemaphoreGive(item.done);
+            continue;
+        }
+        pthread_mutex_lock(&server->lock);
+        server->work_seq = server->work_items + 1;
+        server->work_us = esp_timer_get_time();
+        pthread_mutex_unlock(&server->lock);
+        uint64_t cpu = thread_cpu_us();
+        item.fn(item.arg);
+        cpu = thread_cpu_us() - cpu;
+        pthread_mutex_lock(&server->lock);
+        server->work_items++;
+        server->work_cpu_us += cpu;
+        server->work_seq = 0;
+        pthread_mutex_unlock(&server->lock);
+    }
+    xSemaphoreGive(server->stopped);
+    vTaskDelete(NULL);
+}
+
+// Run fn on the httpd task and wait for it
+static void run_on_httpd(host_server_t *server, httpd_work_fn_t fn, void *arg)
+{
+    host_work_t item = { fn, arg, xSemaphoreCreateBinary() };
+    xQueueSend(server->work, &item, portMAX_DELAY);
+    xSemaphoreTake(item.done, portMAX_DELAY);
+    vSemaphoreDelete(item.done);
+}
+
+static host_session_t *session_find(host_server_t *server, int fd)
+{
+    host_session_t *closed = NULL;
+    for (int i = 0; i < HOST_HTTPD_MAX_SESSIONS; i++) {
+        host_session_t *s = &server->sessions[i];
+        if (s->used && s->fd == fd) {
+            if (s->open) {
+                return s;
+            }
+            closed = s;
+        }
+    }
+    return closed;
+}
+
+// A session for fd, in its last slot if it had one, else an unused slot, else a closed one
+static host_session_t *open_session(host_server_t *server, int fd)
+{
+    pthread_mutex_lock(&server->lock);
+    host_session_t *slot = session_find(server, fd);
+    if (slot && slot->open) {
+        pthread_mutex_unlock(&server->lock);
+        return NULL;
+    }
+    for (int i = 0; !slot && i < HOST_HTTPD_MAX_SESSIONS; i++) {
+        slot = server->sessions[i].used ? NULL : &server->sessions[i];
+    }
+    for (int i = 0; !slot && i < HOST_HTTPD_MAX_SESSIONS; i++) {
+        slot = server->sessions[i].open ? NULL : &server->sessions[i];
+    }
+    if (slot) {
+        for (size_t i = 0; i < slot->frame_count && i < HOST_HTTPD_MAX_FRAMES; i++) {
+            free(slot->frames[i].payload);
+        }
+        memset(slot, 0, sizeof(*slot));
+        slot->used = true;
+        slot->open = true;
+        slot->fd = fd;
+    }
+    pthread_mutex_unlock(&server->lock);
+    return slot;
+}
+
+static void close_session(host_server_t *server, host_session_t *session)
+{
+    if (server->config.close_fn) {
+        server->config.close_fn(server, session->fd);
+    }
+    pthread_mutex_lock(&server->lock);
+    session->open = false;
+    pthread_mutex_unlock(&server->lock);
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    host_server_t *server = calloc(1, sizeof(*server));
+    if (!server) {
+        return ESP_ERR_NO_MEM;
+    }
+    server->config = *config;
+    server->work = xQueueCreate(16, sizeof(host_work_t));
+    server->stopped = xSemaphoreCreateBinary();
+    pthread_mutex_init(&server->lock, NULL);
+    if (xTaskCreate(httpd_task, "httpd", config->stack_size, server, config->task_priority, NULL) != pdPASS) {
+        vQueueDelete(server->work);
+        vSemaphoreDelete(server->stopped);
+        free(server);
+        return ESP_FAIL;
+    }
+    __atomic_store_n(&running, server, __ATOMIC_RELEASE);
+    *handle = server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    host_server_t *server = handle;
+    if (!server) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_work_t stop = { 0 };
+    xQueueSend(server->work, &stop, portMAX_DELAY);
+    xSemaphoreTake(server->stopped, portMAX_DELAY);
+    __atomic_compare_exchange_n(&running, &server, NULL, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    for (int i = 0; i < HOST_HTTPD_MAX_SESSIONS; i++) {
+        for (size_t f = 0; f < server->sessions[i].frame_count && f < HOST_HTTPD_MAX_FRAMES; f++) {
+            free(server->sessions[i].frames[f].payload);
+        }
+    }
+    vQueueDelete(server->work);
+    vSemaphoreDelete(server->stopped);
+    pthread_mutex_destroy(&server->lock);
+    free(server);
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    host_server_t *server = handle;
+    for (size_t i = 0; i < server->uri_count; i++) {
+        if (strcmp(server->uris[i].uri, uri_handler->uri) == 0 && server->uris[i].method == uri_handler->method) {
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
+    }
+    if (server->uri_count == server->config.max_uri_handlers || server->uri_count == HOST_HTTPD_MAX_URIS) {
+        ESP_LOGW(TAG, "No slot left for URI handler %s", uri_handler->uri);
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+    server->uris[server->uri_count++] = *uri_handler;
+    return ESP_OK;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg)
+{
+    host_server_t *server = handle;
+    if (!server || !work) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_work_t item = { work, arg, NULL };
+    return xQueueSend(server->work, &item, 0) == pdTRUE ? ESP_OK : ESP_FAIL;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    return r->fd;
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd)
+{
+    host_server_t *server = hd;
+    pthread_mutex_lock(&server->lock);
+    host_session_t *session = session_find(server, fd);
+    bool open = session && session->open;
+    pthread_mutex_unlock(&server->lock);
+    return open ? HTTPD_WS_CLIENT_WEBSOCKET : HTTPD_WS_CLIENT_INVALID;
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    host_server_t *server = hd;
+    esp_err_t ret = ESP_FAIL;
+    pthread_mutex_lock(&server->lock);
+    host_session_t *session = session_find(server, fd);
+    if (session && session->open) {
+        if (session->frame_count < HOST_HTTPD_MAX_FRAMES) {
+            host_httpd_ws_sent_t *sent = &session->frames[session->frame_count];
+            sent->payload = malloc(frame->len + 1);
+            memcpy(sent->payload, frame->payload, frame->len);
+            sent->payload[frame->len] = '\0';
+            sent->len = frame->len;
+            sent->source = frame->payload;
+            sent->work_us = server->work_seq ? server->work_us : esp_timer_get_time();
+            sent->work_seq = server->work_seq;
+        }
+        session->frame_count++;
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&server->lock);
+    return ret;
+}
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len)
+{
+    host_server_t *server = __atomic_load_n(&running, __ATOMIC_ACQUIRE);
+    host_session_t *session = server ? session_find(server, req->fd) : NULL;
+    if (!session || !session->rx) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pkt->final = true;
+    pkt->type = HTTPD_WS_TYPE_TEXT;
+    pkt->len = session->rx_len;
+    if (max_len == 0) {
+        return ESP_OK;
+    }
+    if (max_len < session->rx_len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(pkt->payload, session->rx, session->rx_len);
+    return ESP_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Host-only client side
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    host_server_t *server;
+    const char *uri;
+    int fd;
+    const char *payload;                // NULL for the handshake
+    size_t len;
+    esp_err_t result;
+} host_ws_op_t;
+
+static const httpd_uri_t *ws_uri_find(host_server_t *server, const char *uri)
+{
+    for (size_t i = 0; i < server->uri_count; i++) {
+        if (server->uris[i].is_websocket && strcmp(server->uris[i].uri, uri) == 0) {
+            return &server->uris[i];
+        }
+    }
+    return NULL;
+}
+
+// Runs the handler for a session: the handshake GET or an incoming frame
+static void ws_call_handler(host_ws_op_t *op, host_session_t *session)
+{
+    httpd_req_t *req = calloc(1, sizeof(*req));     // Large: URI and header storage
+    host_httpd_req_init(req, op->payload ? 0 : HTTP_GET, session->uri->uri, NULL, 0, session->uri->user_ctx);
+    req->fd = session->fd;
+    session->rx = op->payload;
+    session->rx_len = op->len;
+    op->result = session->uri->handler(req);
+    session->rx = NULL;
+    host_httpd_req_free(req);
+    free(req);
+    if (op->result != ESP_OK) {
+        close_session(op->server, session);
+    }
+}
+
+static void ws_open_op(void *arg)
+{
+    host_ws_op_t *op = arg;
+    const httpd_uri_t *uri = ws_uri_find(op->server, op->uri);
+    if (!uri) {
+        op->result = ESP_ERR_NOT_FOUND;
+        return;
+    }
+    host_session_t *session = open_session(op->server, op->fd);
+    if (!session) {
+        op->result = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    session->uri = uri;
+    ws_call_handler(op, session);
+}
+
+static void ws_receive_op(void *arg)
+{
+    host_ws_op_t *op = arg;
+    host_session_t *session = session_find(op->server, op->fd);
+    if (!session || !session->open) {
+        op->result = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    ws_call_handler(op, session);
+}
+
+static void close_op(void *arg)
+{
+    host_ws_op_t *op = arg;
+    host_session_t *session = session_find(op->server, op->fd);
+    if (session && session->open) {
+        close_session(op->server, session);
+    }
+}
+
+httpd_handle_t host_httpd_running(void)
+{
+    return __atomic_load_n(&running, __ATOMIC_ACQUIRE);
+}
+
+esp_err_t host_httpd_ws_open(httpd_handle_t hd, const char *uri, int fd)
+{
+    host_ws_op_t op = { .server = hd, .uri = uri, .fd = fd };
+    run_on_httpd(hd, ws_open_op, &op);
+    return op.result;
+}
+
+esp_err_t host_httpd_ws_receive(httpd_handle_t hd, int fd, const char *payload, size_t len)
+{
+    host_ws_op_t op = { .server = hd, .fd = fd, .payload = payload, .len = len };
+    run_on_httpd(hd, ws_receive_op, &op);
+    return op.result;
+}
+
+void host_httpd_close(httpd_handle_t hd, int fd)
+{
+    host_ws_op_t op = { .server = hd, .fd = fd };
+    run_on_httpd(hd, close_op, &op);
+}
+
+const host_httpd_ws_sent_t *host_httpd_ws_frames(httpd_handle_t hd, int fd, size_t *count)
+{
+    host_server_t *server = hd;
+    pthread_mutex_lock(&server->lock);
+    host_session_t *session = session_find(server, fd);
+    *count = session ? session->frame_count : 0;
+    pthread_mutex_unlock(&server->lock);
+    return session ? session->frames : NULL;
+}
+
+void host_httpd_work_stats(httpd_handle_t hd, uint32_t *items, uint64_t *cpu_us)
+{
+    host_server_t *server = hd;
+    pthread_mutex_lock(&server->lock);
+    *items = server->work_items;
+    *cpu_us = server->work_cpu_us;
+    pthread_mutex_unlock(&server->lock);
+}
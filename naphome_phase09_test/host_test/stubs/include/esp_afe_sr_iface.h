@@ -0,0 +1,49 @@
+/**
+ * @file esp_afe_sr_iface.h
+ * @brief Host stand-in for the ESP-SR AFE types
+ *
+ * Only what detect_fsm.c reads from a fetch result; host tests fill
+ * afe_fetch_result_t themselves from WAV files and decision traces.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_afe_sr_data_t esp_afe_sr_data_t;
+
+typedef enum {
+    WAKENET_NO_DETECT = 0,
+    WAKENET_CHANNEL_VERIFIED = -1,
+    WAKENET_DETECTED = 1,
+} wakenet_state_t;
+
+typedef enum {
+    AFE_VAD_SILENCE = 0,
+    AFE_VAD_SPEECH = 1,
+} afe_vad_state_t;
+
+typedef struct {
+    int16_t *data;
+    int data_size;
+    int vad_cache_size;
+    int16_t *vad_cache;
+    float data_volume;
+    wakenet_state_t wakeup_state;
+    int wake_word_index;
+    int wakenet_model_index;
+    afe_vad_state_t vad_state;
+    int trigger_channel_id;
+    int wake_word_length;
+    int ret_value;
+    int raw_data_channels;
+} afe_fetch_result_t;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,49 @@
+/**
+ * @file esp_event.h
+ * @brief Host stand-in for the default event loop
+ *
+ * Posted events are copied and dispatched in order on one loop thread, like
+ * the sys_evt task. The loop times every handler call, so tests can check
+ * that nothing slow runs on it.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *handler_args, esp_event_base_t base,
+                                    int32_t event_id, void *event_data);
+
+#define ESP_EVENT_ANY_ID        -1
+#define ESP_EVENT_DECLARE_BASE(id) extern esp_event_base_t const id
+#define ESP_EVENT_DEFINE_BASE(id)  esp_event_base_t const id = #id
+
+esp_err_t esp_event_loop_create_default(void);
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+                                     esp_event_handler_t event_handler, void *event_handler_arg);
+esp_err_t esp_event_handler_unregister(esp_event_base_t event_base, int32_t event_id,
+                                       esp_event_handler_t event_handler);
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void *event_data,
+                         size_t event_data_size, TickType_t ticks_to_wait);
+
+/**
+ * @brief Longest single handler call on the loop so far, in microseconds (host only)
+ */
+int64_t host_esp_event_max_handler_us(void);
+
+/**
+ * @brief Events dispatched so far (host only)
+ */
+uint32_t host_esp_event_dispatched(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,238 @@
+/**
+ * @file esp_http_server.h
+ * @brief Host stand-in for esp_http_server: requests built in memory by the test
+ *
+ * Handlers run unchanged against an httpd_req_t the test fills with a
+ * method, URI, headers and body; everything they send is recorded in the
+ * request's response for the test to inspect.
+ *
+ * httpd_start() runs a server with no sockets: an httpd task that runs
+ * httpd_queue_work() items, and WebSocket sessions the test opens, feeds
+ * and closes on numbered fds. Frames sent to a session are recorded per fd.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_ERR_HTTPD_BASE              0xb000
+#define ESP_ERR_HTTPD_HANDLERS_FULL     (ESP_ERR_HTTPD_BASE + 1)
+#define ESP_ERR_HTTPD_HANDLER_EXISTS    (ESP_ERR_HTTPD_BASE + 2)
+#define ESP_ERR_HTTPD_RESULT_TRUNC      (ESP_ERR_HTTPD_BASE + 3)
+
+#define HTTPD_RESP_USE_STRLEN   -1
+#define HTTPD_SOCK_ERR_TIMEOUT  -3
+
+#define HOST_HTTPD_MAX_HDRS     16
+#define HOST_HTTPD_MAX_URIS     32
+#define HOST_HTTPD_MAX_SESSIONS 16      // Open at once, on any fd numbers the test picks
+#define HOST_HTTPD_MAX_FRAMES   64      // Recorded per fd; later frames are counted only
+
+typedef void *httpd_handle_t;
+typedef void (*httpd_work_fn_t)(void *arg);
+typedef void (*httpd_close_func_t)(httpd_handle_t hd, int sockfd);
+
+typedef enum {
+    HTTP_DELETE = 0,
+    HTTP_GET = 1,
+    HTTP_HEAD = 2,
+    HTTP_POST = 3,
+    HTTP_PUT = 4,
+} httpd_method_t;
+
+typedef enum {
+    HTTPD_400_BAD_REQUEST = 400,
+    HTTPD_401_UNAUTHORIZED = 401,
+    HTTPD_403_FORBIDDEN = 403,
+    HTTPD_404_NOT_FOUND = 404,
+    HTTPD_408_REQ_TIMEOUT = 408,
+    HTTPD_500_INTERNAL_SERVER_ERROR = 500,
+} httpd_err_code_t;
+
+typedef enum {
+    HTTPD_WS_TYPE_CONTINUE = 0x0,
+    HTTPD_WS_TYPE_TEXT = 0x1,
+    HTTPD_WS_TYPE_BINARY = 0x2,
+    HTTPD_WS_TYPE_CLOSE = 0x8,
+    HTTPD_WS_TYPE_PING = 0x9,
+    HTTPD_WS_TYPE_PONG = 0xA,
+} httpd_ws_type_t;
+
+typedef enum {
+    HTTPD_WS_CLIENT_INVALID = 0x0,
+    HTTPD_WS_CLIENT_HTTP = 0x1,
+    HTTPD_WS_CLIENT_WEBSOCKET = 0x2,
+} httpd_ws_client_info_t;
+
+typedef struct httpd_ws_frame {
+    bool final;
+    bool fragmented;
+    httpd_ws_type_t type;
+    uint8_t *payload;
+    size_t len;
+} httpd_ws_frame_t;
+
+typedef struct {
+    unsigned task_priority;
+    size_t stack_size;
+    uint16_t server_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    httpd_close_func_t close_fn;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() {        \
+        .task_priority = 5,             \
+        .stack_size = 4096,             \
+        .server_port = 80,              \
+        .max_open_sockets = 7,          \
+        .max_uri_handlers = 8,          \
+        .close_fn = NULL,               \
+    }
+
+typedef struct {
+    char *name;
+    char *value;
+} host_httpd_hdr_t;
+
+// What a handler sent; status is "200 OK" unless it set another
+typedef struct {
+    char status[32];
+    char content_type[64];
+    host_httpd_hdr_t hdrs[HOST_HTTPD_MAX_HDRS];
+    size_t hdr_count;
+    uint8_t *body;
+    size_t body_len;
+    size_t chunks;
+    bool sent;
+} host_httpd_resp_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int method;
+    char uri[513];
+    size_t content_len;
+    void *user_ctx;
+    // Host only
+    host_httpd_hdr_t req_hdrs[HOST_HTTPD_MAX_HDRS];
+    size_t req_hdr_count;
+    const uint8_t *req_body;
+    size_t req_body_pos;
+    host_httpd_resp_t resp;
+    int fd;                             // Session, -1 for requests built by host_httpd_req_init()
+} httpd_req_t;
+
+typedef struct httpd_uri {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *r);
+    void *user_ctx;
+    bool is_websocket;
+    bool handle_ws_control_frames;
+} httpd_uri_t;
+
+// A frame sent to a session, as recorded by the host server
+typedef struct {
+    char *payload;                      // NUL-terminated copy
+    size_t len;
+    const void *source;                 // The payload pointer the sender passed
+    int64_t work_us;                    // When the httpd work item that sent it started
+    uint32_t work_seq;                  // Which work item, 0 if sent from outside one
+} host_httpd_ws_sent_t;
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type);
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value);
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_sendstr(httpd_req_t *r, const char *str);
+esp_err_t httpd_resp_send_err(httpd_req_t *r, httpd_err_code_t error, const char *msg);
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size);
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len);
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size);
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg);
+int httpd_req_to_sockfd(httpd_req_t *r);
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd);
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame);
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len);
+
+/**
+ * @brief Start a request; body may be NULL (host only)
+ */
+void host_httpd_req_init(httpd_req_t *r, httpd_method_t method, const char *uri,
+                         const void *body, size_t body_len, void *user_ctx);
+
+/**
+ * @brief Add a request header (host only)
+ */
+void host_httpd_req_add_hdr(httpd_req_t *r, const char *name, const char *value);
+
+/**
+ * @brief Response header set by the handler, or NULL (host only)
+ */
+const char *host_httpd_resp_hdr(const httpd_req_t *r, const char *name);
+
+/**
+ * @brief Bytes the response would put on the wire: status line, headers
+ *        and body, as esp_http_server formats them (host only)
+ */
+size_t host_httpd_resp_wire_len(const httpd_req_t *r);
+
+/**
+ * @brief Free the headers and body recorded for a request (host only)
+ */
+void host_httpd_req_free(httpd_req_t *r);
+
+/**
+ * @brief The server httpd_start() last started and not yet stopped, or NULL (host only)
+ */
+httpd_handle_t host_httpd_running(void);
+
+/**
+ * @brief Open a WebSocket session on fd: the handshake GET to the uri's
+ *        handler, run on the httpd task (host only)
+ * @return The handler's result; on failure the session is closed again
+ */
+esp_err_t host_httpd_ws_open(httpd_handle_t hd, const char *uri, int fd);
+
+/**
+ * @brief Deliver a text frame from the client on fd to its handler, on the
+ *        httpd task; the session is closed if the handler fails (host only)
+ */
+esp_err_t host_httpd_ws_receive(httpd_handle_t hd, int fd, const char *payload, size_t len);
+
+/**
+ * @brief Close the session on fd as a client disconnect would: close_fn
+ *        runs on the httpd task (host only)
+ */
+void host_httpd_close(httpd_handle_t hd, int fd);
+
+/**
+ * @brief Frames sent to fd since it was opened (host only)
+ * @param count Receives the number of frames sent, which may exceed the
+ *        HOST_HTTPD_MAX_FRAMES recorded
+ */
+const host_httpd_ws_sent_t *host_httpd_ws_frames(httpd_handle_t hd, int fd, size_t *count);
+
+/**
+ * @brief httpd_queue_work() items run so far, and the httpd task CPU time they took (host only)
+ */
+void host_httpd_work_stats(httpd_handle_t hd, uint32_t *items, uint64_t *cpu_us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,9 @@
+/**
+ * @file esp_mac.h
+ * @brief Host stand-in for the MAC address formatting macros
+ */
+
+#pragma once
+
+#define MACSTR "%02x:%02x:%02x:%02x:%02x:%02x"
+#define MAC2STR(a) (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
@@ -0,0 +1,42 @@
+/**
+ * @file esp_mn_speech_commands.h
+ * @brief Host stand-in for MultiNet command registration
+ *
+ * Commands added between esp_mn_commands_alloc() and
+ * esp_mn_commands_update() become the active set a test can inspect.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_mn_iface.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int num;
+    void **phrases;
+} esp_mn_error_t;
+
+esp_err_t esp_mn_commands_alloc(esp_mn_iface_t *multinet, model_iface_data_t *model_data);
+esp_err_t esp_mn_commands_add(int command_id, const char *phoneme_string);
+esp_err_t esp_mn_commands_clear(void);
+esp_mn_error_t *esp_mn_commands_update(void);
+esp_err_t esp_mn_commands_free(void);
+
+/**
+ * @brief Commands active after the last esp_mn_commands_update() (host only)
+ */
+size_t host_mn_command_count(void);
+
+/**
+ * @brief Phonemes registered for a command ID in the active set, or NULL (host only)
+ */
+const char *host_mn_command_phonemes(int command_id);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,21 @@
+/**
+ * @file esp_rom_crc.h
+ * @brief Host stand-in for the ROM CRC routines
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief CRC-32 as the ROM computes it; esp_rom_crc32_le(0, ...) equals zlib's crc32()
+ */
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
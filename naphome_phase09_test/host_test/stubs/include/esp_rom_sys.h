@@ -0,0 +1,25 @@
+/**
+ * @file esp_rom_sys.h
+ * @brief Host stand-in for the ROM helpers
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HOST_CPU_TICKS_PER_US   240     // Reported as the ESP32-S3's 240 MHz
+
+void esp_rom_delay_us(uint32_t us);
+
+static inline uint32_t esp_rom_get_cpu_ticks_per_us(void)
+{
+    return HOST_CPU_TICKS_PER_US;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,18 @@
+/**
+ * @file timers.h
+ * @brief Host stand-in for FreeRTOS software timers (the handle type only; use esp_timer)
+ */
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_timer *TimerHandle_t;
+
+#ifdef __cplusplus
+}
+#endif
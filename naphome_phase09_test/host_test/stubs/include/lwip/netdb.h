@@ -0,0 +1,8 @@
+/**
+ * @file netdb.h
+ * @brief Host stand-in for lwIP's resolver API: the host's getaddrinfo()
+ */
+
+#pragma once
+
+#include <netdb.h>
@@ -0,0 +1,13 @@
+/**
+ * @file sockets.h
+ * @brief Host stand-in for lwIP's BSD socket API: the host's own sockets
+ */
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
@@ -0,0 +1,120 @@
+/**
+ * @file mqtt_client.h
+ * @brief Host stand-in for esp-mqtt: MQTT 3.1.1 over plain TCP
+ *
+ * Covers what the firmware uses: QoS0/1 publish, an outbox that resends
+ * unacknowledged publishes after message_retransmit_timeout and after each
+ * reconnect, outbox expiry with MQTT_EVENT_DELETED, and manual reconnects.
+ * Events run on one client thread, like esp-mqtt's task.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+typedef enum {
+    MQTT_EVENT_ANY = -1,
+    MQTT_EVENT_ERROR = 0,
+    MQTT_EVENT_CONNECTED,
+    MQTT_EVENT_DISCONNECTED,
+    MQTT_EVENT_SUBSCRIBED,
+    MQTT_EVENT_UNSUBSCRIBED,
+    MQTT_EVENT_PUBLISHED,
+    MQTT_EVENT_DATA,
+    MQTT_EVENT_BEFORE_CONNECT,
+    MQTT_EVENT_DELETED,
+} esp_mqtt_event_id_t;
+
+typedef struct {
+    esp_mqtt_event_id_t event_id;
+    esp_mqtt_client_handle_t client;
+    char *data;
+    int data_len;
+    int total_data_len;
+    int current_data_offset;
+    char *topic;
+    int topic_len;
+    int msg_id;
+    int session_present;
+    void *error_handle;
+    bool retain;
+    int qos;
+    bool dup;
+} esp_mqtt_event_t;
+
+typedef esp_mqtt_event_t *esp_mqtt_event_handle_t;
+
+typedef struct {
+    struct {
+        struct {
+            const char *uri;
+        } address;
+    } broker;
+    struct {
+        const char *username;
+        const char *client_id;
+        struct {
+            const char *password;
+        } authentication;
+    } credentials;
+    struct {
+        int keepalive;
+        bool disable_clean_session;
+        int message_retransmit_timeout;
+    } session;
+    struct {
+        int timeout_ms;
+        bool disable_auto_reconnect;
+    } network;
+    struct {
+        int size;
+        int out_size;
+    } buffer;
+} esp_mqtt_client_config_t;
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config);
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t handler, void *handler_args);
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client);
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client);
+esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t client);
+esp_err_t esp_mqtt_client_disconnect(esp_mqtt_client_handle_t client);
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data,
+                            int len, int qos, int retain);
+
+/**
+ * @brief Delay every packet from the broker by this long (host only)
+ *
+ * Stands in for the network round trip, so in-flight windows matter.
+ */
+void host_mqtt_set_rx_delay_ms(uint32_t delay_ms);
+
+/**
+ * @brief Age at which unacknowledged publishes leave the outbox (host only)
+ *
+ * CONFIG_MQTT_OUTBOX_EXPIRED_TIMEOUT_MS on the device; 30 s by default.
+ */
+void host_mqtt_set_outbox_expiry_ms(uint32_t expiry_ms);
+
+/**
+ * @brief Make connection attempts fail, as with no route to the broker (host only)
+ */
+void host_mqtt_set_reachable(bool reachable);
+
+/**
+ * @brief Publishes the outbox has sent again with the DUP flag (host only)
+ */
+uint32_t host_mqtt_outbox_resends(void);
+
+#ifdef __cplusplus
+}
+#endif
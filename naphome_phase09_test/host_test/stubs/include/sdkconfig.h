@@ -0,0 +1,12 @@
+/**
+ * @file sdkconfig.h
+ * @brief Host build configuration: the options the firmware's sdkconfig sets
+ */
+
+#pragma once
+
+#define CONFIG_IDF_TARGET                           "linux"
+#define CONFIG_FREERTOS_HZ                          1000
+#define CONFIG_FREERTOS_USE_TRACE_FACILITY          1
+#define CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS     1
+#define CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID    1
@@ -0,0 +1,658 @@
+/**
+ * @file mqtt_host.c
+ * @brief esp-mqtt stand-in for host builds: MQTT 3.1.1 client over TCP
+ *
+ * A reader thread per connection timestamps incoming packets; the client
+ * thread handles them once the simulated link delay has passed, runs the
+ * outbox and dispatches every event, so handlers see esp-mqtt's threading.
+ */
+
+#include "mqtt_client.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const char *TAG = "mqtt_host";
+
+#define MQTT_HOST_TICK_MS       5       // Client thread period when idle
+#define MQTT_HOST_RETRANSMIT_MS 1000    // esp-mqtt's default retransmit timeout
+
+#define MQTT_CONNECT    0x10
+#define MQTT_CONNACK    0x20
+#define MQTT_PUBLISH    0x30
+#define MQTT_PUBACK     0x40
+#define MQTT_PINGREQ    0xC0
+#define MQTT_PINGRESP   0xD0
+#define MQTT_DISCONNECT 0xE0
+#define MQTT_LINK_LOST  0x00            // Internal: the reader saw the socket close
+
+typedef struct rx_packet {
+    struct rx_packet *next;
+    uint32_t generation;
+    int64_t due_us;
+    uint8_t type;
+    size_t len;
+    uint8_t body[];
+} rx_packet_t;
+
+typedef struct outbox_item {
+    struct outbox_item *next;
+    int msg_id;
+    int64_t created_us;
+    int64_t sent_us;                    // 0 until sent on the current connection
+    uint32_t transmissions;
+    size_t len;
+    uint8_t packet[];
+} outbox_item_t;
+
+typedef struct {
+    esp_mqtt_client_handle_t client;
+    int sock;
+    uint32_t generation;
+} reader_args_t;
+
+struct esp_mqtt_client {
+    char host[128];
+    char port[8];
+    char client_id[64];
+    char *username;
+    char *password;
+    int keepalive_s;
+    int retransmit_ms;
+    bool clean_session;
+
+    esp_event_handler_t handler;
+    void *handler_args;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    bool started;
+    bool want_connect;
+    bool want_disconnect;
+    int sock;
+    uint32_t generation;                // Bumped on every new connection
+    bool connected;
+    int64_t last_tx_us;
+    uint16_t next_msg_id;
+    rx_packet_t *rx_head;
+    rx_packet_t *rx_tail;
+    outbox_item_t *outbox;
+};
+
+static uint32_t rx_delay_ms = 0;
+static uint32_t outbox_expiry_ms = 30000;
+static bool broker_reachable = true;
+static uint32_t outbox_resends = 0;
+
+// ---------------------------------------------------------------------------
+// Encoding
+// ---------------------------------------------------------------------------
+
+static size_t put_remaining_length(uint8_t *out, size_t len)
+{
+    size_t n = 0;
+    do {
+        uint8_t byte = len % 128;
+        len /= 128;
+        out[n++] = byte | (len ? 0x80 : 0);
+    } while (len);
+    return n;
+}
+
+static size_t put_string(uint8_t *out, const char *s, size_t len)
+{
+    out[0] = len >> 8;
+    out[1] = len & 0xFF;
+    memcpy(out + 2, s, len);
+    return len + 2;
+}
+
+static uint8_t *build_packet(uint8_t header, const uint8_t *body, size_t body_len, size_t *out_len)
+{
+    uint8_t *packet = malloc(body_len + 5);
+    packet[0] = header;
+    size_t n = 1 + put_remaining_length(packet + 1, body_len);
+    memcpy(packet + n, body, body_len);
+    *out_len = n + body_len;
+    return packet;
+}
+
+static bool send_all(int sock, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t sent = send(sock, data, len, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+// Caller holds client->lock
+static void send_locked(esp_mqtt_client_handle_t client, const uint8_t *packet, size_t len)
+{
+    if (client->sock >= 0 && send_all(client->sock, packet, len)) {
+        client->last_tx_us = esp_timer_get_time();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Connection
+// ---------------------------------------------------------------------------
+
+static bool recv_all(int sock, uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t got = recv(sock, buf, len, 0);
+        if (got <= 0) {
+            return false;
+        }
+        buf += got;
+        len -= got;
+    }
+    return true;
+}
+
+static void rx_push(esp_mqtt_client_handle_t client, uint32_t generation, uint8_t type,
+                    const uint8_t *body, size_t len)
+{
+    rx_packet_t *packet = malloc(sizeof(*packet) + len);
+    packet->next = NULL;
+    packet->generation = generation;
+    packet->due_us = esp_timer_get_time() + (int64_t)rx_delay_ms * 1000;
+    packet->type = type;
+    packet->len = len;
+    if (len > 0) {
+        memcpy(packet->body, body, len);
+    }
+
+    pthread_mutex_lock(&client->lock);
+    if (client->rx_tail) {
+        client->rx_tail->next = packet;
+    } else {
+        client->rx_head = packet;
+    }
+    client->rx_tail = packet;
+    pthread_cond_signal(&client->wake);
+    pthread_mutex_unlock(&client->lock);
+}
+
+static void *reader_thread(void *arg)
+{
+    reader_args_t args = *(reader_args_t *)arg;
+    free(arg);
+    uint8_t *body = malloc(65536 + 256);
+    while (1) {
+        uint8_t header;
+        if (!recv_all(args.sock, &header, 1)) {
+            break;
+        }
+        size_t len = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+            if (!recv_all(args.sock, &byte, 1)) {
+                goto closed;
+            }
+            len |= (size_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while ((byte & 0x80) && shift < 28);
+        if (len > 65536 + 256 || !recv_all(args.sock, body, len)) {
+            break;
+        }
+        rx_push(args.client, args.generation, header, body, len);
+    }
+closed:
+    free(body);
+    // Closed under the lock so drop_link_locked never shuts down a reused fd
+    pthread_mutex_lock(&args.client->lock);
+    close(args.sock);
+    if (args.client->generation == args.generation) {
+        args.client->sock = -1;
+    }
+    pthread_mutex_unlock(&args.client->lock);
+    rx_push(args.client, args.generation, MQTT_LINK_LOST, NULL, 0);
+    return NULL;
+}
+
+static int open_socket(esp_mqtt_client_handle_t client)
+{
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(client->host, client->port, &hints, &res) != 0) {
+        return -1;
+    }
+    int sock = -1;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock < 0) {
+            continue;
+        }
+        if (connect(sock, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+        close(sock);
+        sock = -1;
+    }
+    freeaddrinfo(res);
+    if (sock >= 0) {
+        int one = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return sock;
+}
+
+static void dispatch(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t id, int msg_id)
+{
+    esp_mqtt_event_t event = {
+        .event_id = id,
+        .client = client,
+        .msg_id = msg_id,
+    };
+    if (client->handler) {
+        client->handler(client->handler_args, "MQTT_EVENTS", id, &event);
+    }
+}
+
+static void do_connect(esp_mqtt_client_handle_t client)
+{
+    int sock = broker_reachable ? open_socket(client) : -1;
+    if (sock < 0) {
+        ESP_LOGW(TAG, "Connect to %s:%s failed", client->host, client->port);
+        dispatch(client, MQTT_EVENT_ERROR, -1);
+        dispatch(client, MQTT_EVENT_DISCONNECTED, -1);
+        return;
+    }
+
+    uint8_t body[512];
+    size_t n = put_string(body, "MQTT", 4);
+    body[n++] = 4;      // Protocol level 3.1.1
+    uint8_t flags = client->clean_session ? 0x02 : 0;
+    if (client->username) {
+        flags |= 0x80;
+    }
+    if (client->password) {
+        flags |= 0x40;
+    }
+    body[n++] = flags;
+    body[n++] = client->keepalive_s >> 8;
+    body[n++] = client->keepalive_s & 0xFF;
+    n += put_string(body + n, client->client_id, strlen(client->client_id));
+    if (client->username) {
+        n += put_string(body + n, client->username, strlen(client->username));
+    }
+    if (client->password) {
+        n += put_string(body + n, client->password, strlen(client->password));
+    }
+    size_t len;
+    uint8_t *packet = build_packet(MQTT_CONNECT, body, n, &len);
+
+    reader_args_t *args = malloc(sizeof(*args));
+    pthread_mutex_lock(&client->lock);
+    client->sock = sock;
+    client->generation++;
+    *args = (reader_args_t){ client, sock, client->generation };
+    send_locked(client, packet, len);
+    pthread_mutex_unlock(&client->lock);
+    free(packet);
+
+    pthread_t reader;
+    pthread_create(&reader, NULL, reader_thread, args);
+    pthread_detach(reader);
+}
+
+// Caller holds client->lock; the reader closes the socket once it sees EOF
+static void drop_link_locked(esp_mqtt_client_handle_t client)
+{
+    if (client->sock >= 0) {
+        shutdown(client->sock, SHUT_RDWR);
+        client->sock = -1;
+    }
+    client->generation++;
+    client->connected = false;
+}
+
+// ---------------------------------------------------------------------------
+// Client thread
+// ---------------------------------------------------------------------------
+
+static void handle_packet(esp_mqtt_client_handle_t client, rx_packet_t *packet)
+{
+    switch (packet->type & 0xF0) {
+    case MQTT_CONNACK: {
+        bool accepted = packet->len >= 2 && packet->body[1] == 0;
+        pthread_mutex_lock(&client->lock);
+        if (accepted) {
+            client->connected = true;
+            // Everything still in the outbox goes out again on this connection
+            for (outbox_item_t *item = client->outbox; item; item = item->next) {
+                item->sent_us = 0;
+            }
+        } else {
+            drop_link_locked(client);
+        }
+        pthread_mutex_unlock(&client->lock);
+        if (accepted) {
+            dispatch(client, MQTT_EVENT_CONNECTED, -1);
+        } else {
+            ESP_LOGW(TAG, "Broker refused connection: %d", packet->len >= 2 ? packet->body[1] : -1);
+            dispatch(client, MQTT_EVENT_ERROR, -1);
+            dispatch(client, MQTT_EVENT_DISCONNECTED, -1);
+        }
+        break;
+    }
+    case MQTT_PUBACK: {
+        if (packet->len < 2) {
+            break;
+        }
+        int msg_id = (packet->body[0] << 8) | packet->body[1];
+        bool found = false;
+        pthread_mutex_lock(&client->lock);
+        for (outbox_item_t **p = &client->outbox; *p; p = &(*p)->next) {
+            if ((*p)->msg_id == msg_id) {
+                outbox_item_t *item = *p;
+                *p = item->next;
+                free(item);
+                found = true;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&client->lock);
+        // esp-mqtt reports PUBACKs only for publishes still in its outbox
+        if (found) {
+            dispatch(client, MQTT_EVENT_PUBLISHED, msg_id);
+        }
+        break;
+    }
+    case MQTT_LINK_LOST:
+        pthread_mutex_lock(&client->lock);
+        drop_link_locked(client);
+        pthread_mutex_unlock(&client->lock);
+        dispatch(client, MQTT_EVENT_DISCONNECTED, -1);
+        break;
+    default:
+        break;      // PINGRESP, and nothing else is subscribed to
+    }
+}
+
+static void run_outbox(esp_mqtt_client_handle_t client)
+{
+    int64_t now = esp_timer_get_time();
+    int expired[64];
+    size_t expired_count = 0;
+
+    pthread_mutex_lock(&client->lock);
+    for (outbox_item_t **p = &client->outbox; *p;) {
+        outbox_item_t *item = *p;
+        if (now - item->created_us > (int64_t)outbox_expiry_ms * 1000 &&
+            expired_count < sizeof(expired) / sizeof(expired[0])) {
+            expired[expired_count++] = item->msg_id;
+            *p = item->next;
+            free(item);
+            continue;
+        }
+        if (client->connected &&
+            (item->sent_us == 0 || now - item->sent_us > (int64_t)client->retransmit_ms * 1000)) {
+            if (item->transmissions > 0) {
+                item->packet[0] |= 0x08;    // DUP once it has been on the wire
+                outbox_resends++;
+            }
+            send_locked(client, item->packet, item->len);
+            item->sent_us = now;
+            item->transmissions++;
+        }
+        p = &item->next;
+    }
+    if (client->connected && client->keepalive_s > 0 &&
+        now - client->last_tx_us > (int64_t)client->keepalive_s * 500000) {
+        uint8_t ping[2] = { MQTT_PINGREQ, 0 };
+        send_locked(client, ping, sizeof(ping));
+    }
+    pthread_mutex_unlock(&client->lock);
+
+    for (size_t i = 0; i < expired_count; i++) {
+        dispatch(client, MQTT_EVENT_DELETED, expired[i]);
+    }
+}
+
+static void *client_thread(void *arg)
+{
+    esp_mqtt_client_handle_t client = arg;
+    pthread_mutex_lock(&client->lock);
+    while (client->started) {
+        if (client->want_connect) {
+            client->want_connect = false;
+            bool idle = client->sock < 0;
+            pthread_mutex_unlock(&client->lock);
+            if (idle) {
+                do_connect(client);
+            }
+            pthread_mutex_lock(&client->lock);
+            continue;
+        }
+        if (client->want_disconnect) {
+            client->want_disconnect = false;
+            if (client->sock >= 0) {
+                uint8_t disconnect[2] = { MQTT_DISCONNECT, 0 };
+                send_locked(client, disconnect, sizeof(disconnect));
+                drop_link_locked(client);
+                pthread_mutex_unlock(&client->lock);
+                dispatch(client, MQTT_EVENT_DISCONNECTED, -1);
+                pthread_mutex_lock(&client->lock);
+            }
+            continue;
+        }
+
+        int64_t now = esp_timer_get_time();
+        rx_packet_t *packet = client->rx_head;
+        if (packet && packet->due_us <= now) {
+            client->rx_head = packet->next;
+            if (!client->rx_head) {
+                client->rx_tail = NULL;
+            }
+            bool current = packet->generation == client->generation;
+            pthread_mutex_unlock(&client->lock);
+            if (current) {
+                handle_packet(client, packet);
+            }
+            free(packet);
+            pthread_mutex_lock(&client->lock);
+            continue;
+        }
+
+        pthread_mutex_unlock(&client->lock);
+        run_outbox(client);
+        pthread_mutex_lock(&client->lock);
+
+        int64_t wait_us = MQTT_HOST_TICK_MS * 1000;
+        if (client->rx_head && client->rx_head->due_us - now < wait_us) {
+            wait_us = client->rx_head->due_us - now;
+        }
+        if (wait_us > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += wait_us * 1000;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&client->wake, &client->lock, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&client->lock);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    const char *uri = config->broker.address.uri;
+    if (!uri || strncmp(uri, "mqtt://", 7) != 0) {
+        ESP_LOGE(TAG, "Only mqtt:// URIs are supported on the host: %s", uri ? uri : "(null)");
+        return NULL;
+    }
+    esp_mqtt_client_handle_t client = calloc(1, sizeof(*client));
+    const char *host = uri + 7;
+    const char *colon = strrchr(host, ':');
+    size_t host_len = colon ? (size_t)(colon - host) : strlen(host);
+    snprintf(client->host, sizeof(client->host), "%.*s", (int)host_len, host);
+    snprintf(client->port, sizeof(client->port), "%s", colon ? colon + 1 : "1883");
+
+    static int instance = 0;
+    if (config->credentials.client_id) {
+        snprintf(client->client_id, sizeof(client->client_id), "%s", config->credentials.client_id);
+    } else {
+        snprintf(client->client_id, sizeof(client->client_id), "host_%d_%d", (int)getpid(), instance++);
+    }
+    client->username = config->credentials.username ? strdup(config->credentials.username) : NULL;
+    client->password = config->credentials.authentication.password ?
+                       strdup(config->credentials.authentication.password) : NULL;
+    client->keepalive_s = config->session.keepalive ? config->session.keepalive : 120;
+    client->retransmit_ms = config->session.message_retransmit_timeout ?
+                            config->session.message_retransmit_timeout : MQTT_HOST_RETRANSMIT_MS;
+    client->clean_session = !config->session.disable_clean_session;
+    client->sock = -1;
+    client->next_msg_id = 1;
+    pthread_mutex_init(&client->lock, NULL);
+    pthread_cond_init(&client->wake, NULL);
+    return client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t handler, void *handler_args)
+{
+    client->handler = handler;
+    client->handler_args = handler_args;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    pthread_mutex_lock(&client->lock);
+    if (client->started) {
+        pthread_mutex_unlock(&client->lock);
+        return ESP_FAIL;
+    }
+    client->started = true;
+    client->want_connect = true;
+    pthread_mutex_unlock(&client->lock);
+    pthread_create(&client->thread, NULL, client_thread, client);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client)
+{
+    pthread_mutex_lock(&client->lock);
+    client->started = false;
+    drop_link_locked(client);
+    pthread_cond_signal(&client->wake);
+    pthread_mutex_unlock(&client->lock);
+    pthread_join(client->thread, NULL);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t client)
+{
+    pthread_mutex_lock(&client->lock);
+    client->want_connect = true;
+    pthread_cond_signal(&client->wake);
+    pthread_mutex_unlock(&client->lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_disconnect(esp_mqtt_client_handle_t client)
+{
+    pthread_mutex_lock(&client->lock);
+    client->want_disconnect = true;
+    pthread_cond_signal(&client->wake);
+    pthread_mutex_unlock(&client->lock);
+    return ESP_OK;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data,
+                            int len, int qos, int retain)
+{
+    if (len <= 0 && data) {
+        len = strlen(data);
+    }
+    size_t topic_len = strlen(topic);
+    uint8_t *body = malloc(topic_len + 4 + len);
+    size_t n = put_string(body, topic, topic_len);
+
+    pthread_mutex_lock(&client->lock);
+    if (qos == 0 && !client->connected) {
+        pthread_mutex_unlock(&client->lock);
+        free(body);
+        return -1;
+    }
+    int msg_id = 0;
+    if (qos > 0) {
+        msg_id = client->next_msg_id;
+        client->next_msg_id = client->next_msg_id == 0xFFFF ? 1 : client->next_msg_id + 1;
+        body[n++] = msg_id >> 8;
+        body[n++] = msg_id & 0xFF;
+    }
+    memcpy(body + n, data, len);
+    n += len;
+    size_t packet_len;
+    uint8_t *packet = build_packet(MQTT_PUBLISH | (qos << 1) | (retain ? 1 : 0), body, n, &packet_len);
+    free(body);
+
+    if (qos > 0) {
+        // Queued while disconnected, like esp-mqtt; sent on the next connection
+        outbox_item_t *item = malloc(sizeof(*item) + packet_len);
+        item->next = NULL;
+        item->msg_id = msg_id;
+        item->created_us = esp_timer_get_time();
+        item->sent_us = client->connected ? item->created_us : 0;
+        item->transmissions = client->connected ? 1 : 0;
+        item->len = packet_len;
+        memcpy(item->packet, packet, packet_len);
+        outbox_item_t **tail = &client->outbox;
+        while (*tail) {
+            tail = &(*tail)->next;
+        }
+        *tail = item;
+    }
+    if (client->connected) {
+        send_locked(client, packet, packet_len);
+    }
+    pthread_mutex_unlock(&client->lock);
+    free(packet);
+    return msg_id;
+}
+
+void host_mqtt_set_rx_delay_ms(uint32_t delay_ms)
+{
+    rx_delay_ms = delay_ms;
+}
+
+void host_mqtt_set_outbox_expiry_ms(uint32_t expiry_ms)
+{
+    outbox_expiry_ms = expiry_ms;
+}
+
+void host_mqtt_set_reachable(bool reachable)
+{
+    broker_reachable = reachable;
+}
+
+uint32_t host_mqtt_outbox_resends(void)
+{
+    return outbox_resends;
+}
@@ -0,0 +1,254 @@
+/**
+ * @file nvs_host.c
+ * @brief In-memory NVS for host builds, with commit tracking and write latency
+ */
+
+#include "nvs.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NVS_HOST_MAX_NAMESPACES 16
+#define NVS_HOST_KEY_MAX        16      // Including terminator, as on the device
+
+typedef enum {
+    NVS_HOST_U8,
+    NVS_HOST_U32,
+    NVS_HOST_STR,
+    NVS_HOST_BLOB,
+} nvs_host_type_t;
+
+typedef struct {
+    bool present;
+    nvs_host_type_t type;
+    uint8_t *data;
+    size_t len;
+} nvs_host_value_t;
+
+typedef struct nvs_host_entry {
+    struct nvs_host_entry *next;
+    nvs_handle_t ns;
+    char key[NVS_HOST_KEY_MAX];
+    nvs_host_value_t live;
+    nvs_host_value_t committed;
+} nvs_host_entry_t;
+
+static pthread_mutex_t nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+static char namespaces[NVS_HOST_MAX_NAMESPACES][NVS_HOST_KEY_MAX];
+static size_t namespace_count = 0;
+static nvs_host_entry_t *entries = NULL;
+static uint32_t write_delay_ms = 0;
+static uint32_t write_count = 0;
+
+static void write_latency(void)
+{
+    __atomic_fetch_add(&write_count, 1, __ATOMIC_RELAXED);
+    if (write_delay_ms > 0) {
+        struct timespec ts = { write_delay_ms / 1000, (long)(write_delay_ms % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void value_set(nvs_host_value_t *value, nvs_host_type_t type, const void *data, size_t len)
+{
+    free(value->data);
+    value->data = malloc(len ? len : 1);
+    memcpy(value->data, data, len);
+    value->len = len;
+    value->type = type;
+    value->present = true;
+}
+
+static void value_clear(nvs_host_value_t *value)
+{
+    free(value->data);
+    memset(value, 0, sizeof(*value));
+}
+
+static nvs_host_entry_t *entry_find(nvs_handle_t ns, const char *key, bool create)
+{
+    for (nvs_host_entry_t *e = entries; e; e = e->next) {
+        if (e->ns == ns && strcmp(e->key, key) == 0) {
+            return e;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    nvs_host_entry_t *e = calloc(1, sizeof(*e));
+    e->ns = ns;
+    strncpy(e->key, key, sizeof(e->key) - 1);
+    e->next = entries;
+    entries = e;
+    return e;
+}
+
+static esp_err_t nvs_set(nvs_handle_t handle, const char *key, nvs_host_type_t type,
+                         const void *data, size_t len)
+{
+    if (handle == 0 || !key || strlen(key) >= NVS_HOST_KEY_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    write_latency();
+    pthread_mutex_lock(&nvs_lock);
+    value_set(&entry_find(handle, key, true)->live, type, data, len);
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+static esp_err_t nvs_get(nvs_handle_t handle, const char *key, nvs_host_type_t type,
+                         void *out, size_t *len, bool exact)
+{
+    pthread_mutex_lock(&nvs_lock);
+    nvs_host_entry_t *e = entry_find(handle, key, false);
+    esp_err_t ret = ESP_OK;
+    if (!e || !e->live.present || e->live.type != type) {
+        ret = ESP_ERR_NVS_NOT_FOUND;
+    } else if (!out) {
+        *len = e->live.len;
+    } else if (exact ? *len != e->live.len : *len < e->live.len) {
+        ret = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        memcpy(out, e->live.data, e->live.len);
+        *len = e->live.len;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (!namespace_name || !out_handle || strlen(namespace_name) >= NVS_HOST_KEY_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&nvs_lock);
+    size_t i;
+    for (i = 0; i < namespace_count; i++) {
+        if (strcmp(namespaces[i], namespace_name) == 0) {
+            break;
+        }
+    }
+    if (i == namespace_count) {
+        if (namespace_count == NVS_HOST_MAX_NAMESPACES || open_mode == NVS_READONLY) {
+            pthread_mutex_unlock(&nvs_lock);
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        strcpy(namespaces[namespace_count++], namespace_name);
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    *out_handle = i + 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    write_latency();
+    pthread_mutex_lock(&nvs_lock);
+    for (nvs_host_entry_t *e = entries; e; e = e->next) {
+        if (e->ns != handle) {
+            continue;
+        }
+        if (e->live.present) {
+            value_set(&e->committed, e->live.type, e->live.data, e->live.len);
+        } else {
+            value_clear(&e->committed);
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    pthread_mutex_lock(&nvs_lock);
+    nvs_host_entry_t *e = entry_find(handle, key, false);
+    bool found = e && e->live.present;
+    if (found) {
+        value_clear(&e->live);
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return found ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&nvs_lock);
+    for (nvs_host_entry_t *e = entries; e; e = e->next) {
+        if (e->ns == handle) {
+            value_clear(&e->live);
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value)
+{
+    return nvs_set(handle, key, NVS_HOST_U8, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value)
+{
+    size_t len = sizeof(*out_value);
+    return nvs_get(handle, key, NVS_HOST_U8, out_value, &len, true);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return nvs_set(handle, key, NVS_HOST_U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    size_t len = sizeof(*out_value);
+    return nvs_get(handle, key, NVS_HOST_U32, out_value, &len, true);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return nvs_set(handle, key, NVS_HOST_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return nvs_get(handle, key, NVS_HOST_STR, out_value, length, false);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return nvs_set(handle, key, NVS_HOST_BLOB, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return nvs_get(handle, key, NVS_HOST_BLOB, out_value, length, false);
+}
+
+void host_nvs_set_write_delay_ms(uint32_t delay_ms)
+{
+    write_delay_ms = delay_ms;
+}
+
+void host_nvs_power_cycle(void)
+{
+    pthread_mutex_lock(&nvs_lock);
+    for (nvs_host_entry_t *e = entries; e; e = e->next) {
+        if (e->committed.present) {
+            value_set(&e->live, e->committed.type, e->committed.data, e->committed.len);
+        } else {
+            value_clear(&e->live);
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+}
+
+uint32_t host_nvs_write_count(void)
+{
+    return write_count;
+}
@@ -0,0 +1,423 @@
+/**
+ * @file wifi_host.c
+ * @brief Wi-Fi station and DHCP stand-in: one simulated AP, air time as real time
+ *
+ * Connect requests become a timeline of driver steps (scan, association,
+ * DHCP) on a driver thread, which checks the AP at each step and posts the
+ * outcome to the default event loop. Taking the AP down or moving it
+ * cancels the steps of the current association and reports beacon loss.
+ */
+
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+
+#define WIFI_HOST_START_MS          50
+#define WIFI_HOST_PROBE_MS          120     // Active scan dwell per channel
+#define WIFI_HOST_ASSOC_MS          150     // Authentication, association, 4-way handshake
+#define WIFI_HOST_DHCP_FULL_MS      800     // DISCOVER/OFFER/REQUEST/ACK on a home router
+#define WIFI_HOST_DHCP_REUSE_MS     120     // REQUEST/ACK for the remembered lease
+#define WIFI_HOST_BEACON_LOSS_MS    300     // Shortened from the driver's 6 s inactive time
+#define WIFI_HOST_MAX_STEPS         8
+#define WIFI_HOST_LEASE_ADDR        "192.168.1.57"
+
+typedef enum {
+    STEP_START,
+    STEP_SCAN_DONE,
+    STEP_ASSOCIATED,
+    STEP_BOUND,
+    STEP_LINK_LOST,
+} step_kind_t;
+
+typedef struct {
+    bool used;
+    step_kind_t kind;
+    int64_t due_us;
+    uint32_t generation;        // Steps of a cancelled association are dropped
+    uint8_t reason;
+} step_t;
+
+typedef enum {
+    STA_IDLE,
+    STA_CONNECTING,
+    STA_ASSOCIATED,
+    STA_BOUND,
+} sta_phase_t;
+
+struct esp_netif_obj {
+    bool dhcp;
+    bool lease_known;
+    esp_netif_ip_info_t ip_info;
+};
+
+static pthread_mutex_t wifi_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wifi_wake = PTHREAD_COND_INITIALIZER;
+static step_t steps[WIFI_HOST_MAX_STEPS];
+static uint32_t generation = 0;
+static bool driver_running = false;
+
+static struct {
+    bool up;
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+} ap;
+
+static wifi_sta_config_t sta_config;
+static sta_phase_t phase = STA_IDLE;
+static bool started = false;
+static uint8_t nchan = 13;
+static uint8_t joined_bssid[6];
+static uint8_t joined_channel = 0;
+static struct esp_netif_obj sta_netif = { .dhcp = true };
+static _Atomic uint32_t channels_probed = 0;
+
+// Called with wifi_lock held
+static void schedule(step_kind_t kind, uint32_t delay_ms, uint8_t reason)
+{
+    for (int i = 0; i < WIFI_HOST_MAX_STEPS; i++) {
+        if (!steps[i].used) {
+            steps[i] = (step_t){ true, kind, esp_timer_get_time() + (int64_t)delay_ms * 1000, generation, reason };
+            pthread_cond_signal(&wifi_wake);
+            return;
+        }
+    }
+}
+
+static bool ap_matches(void)
+{
+    if (!ap.up || strncmp(ap.ssid, (const char *)sta_config.ssid, sizeof(sta_config.ssid)) != 0) {
+        return false;
+    }
+    if (sta_config.bssid_set && memcmp(sta_config.bssid, ap.bssid, sizeof(ap.bssid)) != 0) {
+        return false;
+    }
+    return sta_config.scan_method != WIFI_FAST_SCAN || sta_config.channel == 0 || sta_config.channel == ap.channel;
+}
+
+static bool ap_unchanged(void)
+{
+    return ap.up && ap.channel == joined_channel && memcmp(ap.bssid, joined_bssid, sizeof(ap.bssid)) == 0;
+}
+
+// Called with wifi_lock held; the events are posted once it is released
+static void run_step(const step_t *step, wifi_event_t *wifi_id, ip_event_got_ip_t *got_ip,
+                     wifi_event_sta_connected_t *connected, wifi_event_sta_disconnected_t *disconnected)
+{
+    switch (step->kind) {
+    case STEP_START:
+        *wifi_id = WIFI_EVENT_STA_START;
+        break;
+    case STEP_SCAN_DONE:
+        if (!ap_matches()) {
+            phase = STA_IDLE;
+            disconnected->reason = WIFI_REASON_NO_AP_FOUND;
+            *wifi_id = WIFI_EVENT_STA_DISCONNECTED;
+            break;
+        }
+        memcpy(joined_bssid, ap.bssid, sizeof(joined_bssid));
+        joined_channel = ap.channel;
+        schedule(STEP_ASSOCIATED, WIFI_HOST_ASSOC_MS, 0);
+        break;
+    case STEP_ASSOCIATED:
+        if (!ap_unchanged()) {
+            phase = STA_IDLE;
+            disconnected->reason = WIFI_REASON_NO_AP_FOUND;
+            *wifi_id = WIFI_EVENT_STA_DISCONNECTED;
+            break;
+        }
+        phase = STA_ASSOCIATED;
+        connected->ssid_len = strnlen(ap.ssid, sizeof(connected->ssid));
+        memcpy(connected->ssid, ap.ssid, connected->ssid_len);
+        memcpy(connected->bssid, ap.bssid, sizeof(connected->bssid));
+        connected->channel = ap.channel;
+        connected->authmode = WIFI_AUTH_WPA2_PSK;
+        *wifi_id = WIFI_EVENT_STA_CONNECTED;
+        if (!sta_netif.dhcp) {
+            schedule(STEP_BOUND, 0, 0);
+        } else {
+            schedule(STEP_BOUND, sta_netif.lease_known ? WIFI_HOST_DHCP_REUSE_MS : WIFI_HOST_DHCP_FULL_MS, 0);
+        }
+        break;
+    case STEP_BOUND:
+        phase = STA_BOUND;
+        if (sta_netif.dhcp) {
+            sta_netif.lease_known = true;
+            sta_netif.ip_info.ip.addr = inet_addr(WIFI_HOST_LEASE_ADDR);
+        }
+        got_ip->esp_netif = &sta_netif;
+        got_ip->ip_info = sta_netif.ip_info;
+        break;
+    case STEP_LINK_LOST:
+        phase = STA_IDLE;
+        disconnected->reason = step->reason;
+        memcpy(disconnected->bssid, joined_bssid, sizeof(disconnected->bssid));
+        *wifi_id = WIFI_EVENT_STA_DISCONNECTED;
+        break;
+    }
+}
+
+static void *driver_thread(void *unused)
+{
+    pthread_mutex_lock(&wifi_lock);
+    for (;;) {
+        step_t *next = NULL;
+        for (int i = 0; i < WIFI_HOST_MAX_STEPS; i++) {
+            if (steps[i].used && steps[i].generation != generation) {
+                steps[i].used = false;
+            } else if (steps[i].used && (!next || steps[i].due_us < next->due_us)) {
+                next = &steps[i];
+            }
+        }
+        if (!next) {
+            pthread_cond_wait(&wifi_wake, &wifi_lock);
+            continue;
+        }
+        int64_t wait_us = next->due_us - esp_timer_get_time();
+        if (wait_us > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += wait_us / 1000000;
+            deadline.tv_nsec += (wait_us % 1000000) * 1000;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&wifi_wake, &wifi_lock, &deadline);
+            continue;
+        }
+        step_t step = *next;
+        next->used = false;
+
+        wifi_event_t wifi_id = 0;
+        ip_event_got_ip_t got_ip = {0};
+        wifi_event_sta_connected_t connected = {0};
+        wifi_event_sta_disconnected_t disconnected = {0};
+        run_step(&step, &wifi_id, &got_ip, &connected, &disconnected);
+        pthread_mutex_unlock(&wifi_lock);
+
+        if (wifi_id == WIFI_EVENT_STA_CONNECTED) {
+            esp_event_post(WIFI_EVENT, wifi_id, &connected, sizeof(connected), portMAX_DELAY);
+        } else if (wifi_id == WIFI_EVENT_STA_DISCONNECTED) {
+            esp_event_post(WIFI_EVENT, wifi_id, &disconnected, sizeof(disconnected), portMAX_DELAY);
+        } else if (wifi_id) {
+            esp_event_post(WIFI_EVENT, wifi_id, NULL, 0, portMAX_DELAY);
+        } else if (step.kind == STEP_BOUND) {
+            esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, &got_ip, sizeof(got_ip), portMAX_DELAY);
+        }
+        pthread_mutex_lock(&wifi_lock);
+    }
+    return NULL;
+}
+
+// Called with wifi_lock held
+static void drop_link(uint8_t reason, uint32_t after_ms)
+{
+    if (phase == STA_ASSOCIATED || phase == STA_BOUND) {
+        generation++;
+        phase = STA_CONNECTING;     // Until the loss is reported
+        schedule(STEP_LINK_LOST, after_ms, reason);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Driver API
+// ---------------------------------------------------------------------------
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    pthread_mutex_lock(&wifi_lock);
+    if (!driver_running) {
+        driver_running = true;
+        pthread_t thread;
+        pthread_create(&thread, NULL, driver_thread, NULL);
+        pthread_detach(thread);
+    }
+    pthread_mutex_unlock(&wifi_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    return mode == WIFI_MODE_STA ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_wifi_set_country(const wifi_country_t *country)
+{
+    if (!country || country->schan != 1 || country->nchan == 0 || country->nchan > 14) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&wifi_lock);
+    nchan = country->nchan;
+    pthread_mutex_unlock(&wifi_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    pthread_mutex_lock(&wifi_lock);
+    sta_config = conf->sta;
+    pthread_mutex_unlock(&wifi_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    pthread_mutex_lock(&wifi_lock);
+    esp_err_t ret = driver_running ? ESP_OK : ESP_ERR_WIFI_NOT_INIT;
+    if (ret == ESP_OK && !started) {
+        started = true;
+        schedule(STEP_START, WIFI_HOST_START_MS, 0);
+    }
+    pthread_mutex_unlock(&wifi_lock);
+    return ret;
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+    pthread_mutex_lock(&wifi_lock);
+    esp_err_t ret = ESP_OK;
+    if (!started) {
+        ret = ESP_ERR_WIFI_NOT_STARTED;
+    } else if (phase != STA_IDLE) {
+        ret = ESP_ERR_WIFI_CONN;
+    } else {
+        bool directed = sta_config.scan_method == WIFI_FAST_SCAN && sta_config.channel != 0;
+        uint32_t channels = directed ? 1 : nchan;
+        atomic_fetch_add(&channels_probed, channels);
+        phase = STA_CONNECTING;
+        generation++;
+        schedule(STEP_SCAN_DONE, channels * WIFI_HOST_PROBE_MS, 0);
+    }
+    pthread_mutex_unlock(&wifi_lock);
+    return ret;
+}
+
+esp_err_t esp_wifi_disconnect(void)
+{
+    pthread_mutex_lock(&wifi_lock);
+    drop_link(WIFI_REASON_ASSOC_LEAVE, 0);
+    pthread_mutex_unlock(&wifi_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info)
+{
+    pthread_mutex_lock(&wifi_lock);
+    esp_err_t ret = phase == STA_ASSOCIATED || phase == STA_BOUND ? ESP_OK : ESP_ERR_WIFI_NOT_CONNECT;
+    if (ret == ESP_OK) {
+        memset(ap_info, 0, sizeof(*ap_info));
+        memcpy(ap_info->bssid, joined_bssid, sizeof(ap_info->bssid));
+        memcpy(ap_info->ssid, ap.ssid, sizeof(ap_info->ssid));
+        ap_info->primary = joined_channel;
+        ap_info->rssi = -50;
+        ap_info->authmode = WIFI_AUTH_WPA2_PSK;
+    }
+    pthread_mutex_unlock(&wifi_lock);
+    return ret;
+}
+
+void host_wifi_set_ap(const char *ssid, const uint8_t bssid[6], uint8_t channel)
+{
+    pthread_mutex_lock(&wifi_lock);
+    bool moved = ap.up && (ap.channel != channel || memcmp(ap.bssid, bssid, sizeof(ap.bssid)) != 0);
+    ap.up = true;
+    strncpy(ap.ssid, ssid, sizeof(ap.ssid) - 1);
+    memcpy(ap.bssid, bssid, sizeof(ap.bssid));
+    ap.channel = channel;
+    if (moved) {
+        drop_link(WIFI_REASON_BEACON_TIMEOUT, WIFI_HOST_BEACON_LOSS_MS);
+    }
+    pthread_mutex_unlock(&wifi_lock);
+}
+
+void host_wifi_ap_down(void)
+{
+    pthread_mutex_lock(&wifi_lock);
+    ap.up = false;
+    drop_link(WIFI_REASON_BEACON_TIMEOUT, WIFI_HOST_BEACON_LOSS_MS);
+    pthread_mutex_unlock(&wifi_lock);
+}
+
+uint32_t host_wifi_channels_probed(void)
+{
+    return atomic_load(&channels_probed);
+}
+
+// ---------------------------------------------------------------------------
+// Station netif
+// ---------------------------------------------------------------------------
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_sta(void)
+{
+    return &sta_netif;
+}
+
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *if_key)
+{
+    return strcmp(if_key, "WIFI_STA_DEF") == 0 ? &sta_netif : NULL;
+}
+
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t *esp_netif)
+{
+    pthread_mutex_lock(&wifi_lock);
+    esp_err_t ret = esp_netif->dhcp ? ESP_OK : ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED;
+    esp_netif->dhcp = false;
+    pthread_mutex_unlock(&wifi_lock);
+    return ret;
+}
+
+esp_err_t esp_netif_dhcpc_start(esp_netif_t *esp_netif)
+{
+    pthread_mutex_lock(&wifi_lock);
+    esp_netif->dhcp = true;
+    pthread_mutex_unlock(&wifi_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_ip_info(esp_netif_t *esp_netif, const esp_netif_ip_info_t *ip_info)
+{
+    pthread_mutex_lock(&wifi_lock);
+    esp_err_t ret = esp_netif->dhcp ? ESP_ERR_ESP_NETIF_INVALID_PARAMS : ESP_OK;
+    if (ret == ESP_OK) {
+        esp_netif->ip_info = *ip_info;
+    }
+    pthread_mutex_unlock(&wifi_lock);
+    return ret;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *esp_netif, esp_netif_ip_info_t *ip_info)
+{
+    pthread_mutex_lock(&wifi_lock);
+    *ip_info = esp_netif->ip_info;
+    pthread_mutex_unlock(&wifi_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_dns_info(esp_netif_t *esp_netif, esp_netif_dns_type_t type, esp_netif_dns_info_t *dns)
+{
+    return dns ? ESP_OK : ESP_ERR_ESP_NETIF_INVALID_PARAMS;
+}
+
+uint32_t esp_ip4addr_aton(const char *addr)
+{
+    struct in_addr parsed;
+    return inet_pton(AF_INET, addr, &parsed) == 1 ? parsed.s_addr : 0;
+}
@@ -0,0 +1,262 @@
+/**
+ * @file test_audio_ctl.c
+ * @brief audio_ctl pause-to-silence and resume latency against the flag poll it replaced
+ *
+ * A producer plays a long buffer through a write that blocks for as long
+ * as the samples it is given take to play, like i2s_channel_write() on a
+ * full DMA queue. The main task pauses it at random points, waits, and
+ * resumes it. Pause-to-silence is measured in audio: how much of what was
+ * written after the pause (or was still playing when it came) reaches the
+ * speaker. That cannot exceed one AUDIO_CTL_CHUNK_MS slice with
+ * audio_ctl_play(), however late the producer is scheduled. Resume latency
+ * is the wall time to the next write.
+ *
+ * The same pauses run against the loop audio_ctl replaced (a volatile flag
+ * polled every 50 ms, 2 KB chunks), at 16 kHz and 44.1 kHz. Pause reasons
+ * are checked to be independent.
+ */
+
+#include "audio_ctl.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PAUSES              40
+#define PLAY_MIN_MS         30      // Played between pauses ...
+#define PLAY_MAX_MS         90      // ... a random time in this range
+#define PAUSED_MS           60
+#define MAX_WRITES          4096
+#define LEGACY_CHUNK_BYTES  2048    // The old play_wav_file() loop
+#define LEGACY_POLL_MS      50
+#define LEGACY_GAP_MS       5
+#define RESUME_LIMIT_MS     AUDIO_CTL_CHUNK_MS  // Median wake after a resume
+
+typedef struct {
+    int64_t start_us;
+    _Atomic int64_t returned_us;    // 0 while blocked
+    uint32_t samples;
+} write_t;
+
+// What the producer wrote; appended by the producer only
+static write_t writes[MAX_WRITES];
+static _Atomic size_t write_count;
+static uint32_t play_rate;
+
+static int16_t *buffer;
+static size_t buffer_samples;
+static volatile bool draining;      // Set once the pauses are done: play out the rest at once
+static SemaphoreHandle_t producer_done;
+
+// Blocks for the duration of the samples, like a full I2S DMA queue
+static esp_err_t blocking_write(const int16_t *data, size_t len, uint32_t sample_rate)
+{
+    if (draining) {
+        return ESP_OK;
+    }
+    size_t n = atomic_load(&write_count);
+    uint32_t samples = len / sizeof(int16_t);
+    if (n < MAX_WRITES) {
+        writes[n].start_us = esp_timer_get_time();
+        writes[n].samples = samples;
+        atomic_store(&writes[n].returned_us, 0);
+        atomic_store(&write_count, n + 1);
+    }
+    int64_t ns = (int64_t)samples * 1000000000LL / sample_rate;
+    struct timespec ts = { ns / 1000000000LL, ns % 1000000000LL };
+    nanosleep(&ts, NULL);
+    if (n < MAX_WRITES) {
+        atomic_store(&writes[n].returned_us, esp_timer_get_time());
+    }
+    return ESP_OK;
+}
+
+// Nominal end of a write: the speaker plays at the sample rate, however late the call returns
+static int64_t write_end_us(const write_t *w)
+{
+    return w->start_us + (int64_t)w->samples * 1000000 / play_rate;
+}
+
+// ---------------------------------------------------------------------------
+// Producers
+// ---------------------------------------------------------------------------
+
+static volatile bool legacy_paused;
+
+static void legacy_producer(void *arg)
+{
+    const size_t chunk = LEGACY_CHUNK_BYTES / sizeof(int16_t);
+    for (size_t i = 0; i < buffer_samples;) {
+        if (legacy_paused) {
+            vTaskDelay(pdMS_TO_TICKS(LEGACY_POLL_MS));
+            continue;
+        }
+        size_t n = buffer_samples - i < chunk ? buffer_samples - i : chunk;
+        blocking_write(buffer + i, n * sizeof(int16_t), play_rate);
+        i += n;
+        vTaskDelay(pdMS_TO_TICKS(LEGACY_GAP_MS));
+    }
+    xSemaphoreGive(producer_done);
+    vTaskDelete(NULL);
+}
+
+static void ctl_producer(void *arg)
+{
+    audio_ctl_play(buffer, buffer_samples, play_rate, AUDIO_CTL_PAUSE_ALL, blocking_write);
+    xSemaphoreGive(producer_done);
+    vTaskDelete(NULL);
+}
+
+static void legacy_pause(void)
+{
+    legacy_paused = true;
+}
+
+static void legacy_resume(void)
+{
+    legacy_paused = false;
+}
+
+static void ctl_pause(void)
+{
+    audio_ctl_pause(AUDIO_CTL_PAUSE_LISTENING);
+}
+
+static void ctl_resume(void)
+{
+    audio_ctl_resume(AUDIO_CTL_PAUSE_LISTENING);
+}
+
+// ---------------------------------------------------------------------------
+// Pauses
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    double audio_max_ms;
+    double resume_median_ms;
+} run_t;
+
+static int compare_ms(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void summarize(double *ms, double *mean, double *median, double *max)
+{
+    double sum = 0;
+    for (int i = 0; i < PAUSES; i++) {
+        sum += ms[i];
+    }
+    qsort(ms, PAUSES, sizeof(ms[0]), compare_ms);
+    *mean = sum / PAUSES;
+    *median = ms[PAUSES / 2];
+    *max = ms[PAUSES - 1];
+}
+
+static run_t run(const char *name, uint32_t sample_rate, TaskFunction_t producer, void (*pause)(void),
+                 void (*resume)(void))
+{
+    static double audio_ms[PAUSES];     // Played after the pause
+    static double silent_ms[PAUSES];    // Wall time from the pause to the last write returning
+    static double resume_ms[PAUSES];    // Wall time from the resume to the next write
+    play_rate = sample_rate;
+    draining = false;
+    atomic_store(&write_count, 0);
+    // Long enough for every pause and the play time between them
+    buffer_samples = (size_t)sample_rate * PAUSES * (PLAY_MAX_MS + PAUSED_MS + LEGACY_POLL_MS) / 1000;
+    buffer = calloc(buffer_samples, sizeof(int16_t));
+    xTaskCreate(producer, name, 4096, NULL, 6, NULL);
+
+    for (int p = 0; p < PAUSES; p++) {
+        vTaskDelay(pdMS_TO_TICKS(PLAY_MIN_MS + rand() % (PLAY_MAX_MS - PLAY_MIN_MS)));
+        pause();
+        int64_t paused_at = esp_timer_get_time();
+        vTaskDelay(pdMS_TO_TICKS(PAUSED_MS));
+
+        // Whatever was still playing at the pause, and anything written after it
+        size_t n = atomic_load(&write_count);
+        double audio_us = 0;
+        int64_t silent_at = paused_at;
+        for (size_t i = n; i-- > 0;) {
+            int64_t end = write_end_us(&writes[i]);
+            int64_t returned = atomic_load(&writes[i].returned_us);
+            if (returned == 0) {
+                returned = esp_timer_get_time();  // Still blocked
+            }
+            if (returned > silent_at) {
+                silent_at = returned;
+            }
+            if (end <= paused_at) {
+                break;
+            }
+            int64_t from = writes[i].start_us > paused_at ? writes[i].start_us : paused_at;
+            audio_us += end - from;
+        }
+        audio_ms[p] = audio_us / 1000.0;
+        silent_ms[p] = (silent_at - paused_at) / 1000.0;
+
+        int64_t resumed_at = esp_timer_get_time();
+        resume();
+        while (atomic_load(&write_count) == n && esp_timer_get_time() - resumed_at < 1000000) {
+            vTaskDelay(1);
+        }
+        resume_ms[p] = atomic_load(&write_count) > n ? (writes[n].start_us - resumed_at) / 1000.0 : 1000.0;
+    }
+    draining = true;
+    xSemaphoreTake(producer_done, portMAX_DELAY);
+    free(buffer);
+
+    double mean, median, max, resume_mean, resume_median, resume_max, silent_mean, silent_median, silent_max;
+    summarize(audio_ms, &mean, &median, &max);
+    summarize(silent_ms, &silent_mean, &silent_median, &silent_max);
+    summarize(resume_ms, &resume_mean, &resume_median, &resume_max);
+    printf("  %5.1f kHz  %-9s  audio after pause mean %5.1f / max %5.1f ms  (wall %5.1f / %5.1f)  "
+           "resume mean %5.1f / max %5.1f ms\n",
+           sample_rate / 1000.0, name, mean, max, silent_mean, silent_max, resume_mean, resume_max);
+    return (run_t){ max, resume_median };
+}
+
+static void check_reasons(void)
+{
+    audio_ctl_pause(AUDIO_CTL_PAUSE_USER);
+    CHECK(audio_ctl_paused(AUDIO_CTL_PAUSE_USER) && !audio_ctl_paused(AUDIO_CTL_PAUSE_LISTENING),
+          "user pause leaked into listening");
+    CHECK(audio_ctl_wait_running(AUDIO_CTL_PAUSE_LISTENING, 0), "listening-only producer blocked by a user pause");
+    audio_ctl_pause(AUDIO_CTL_PAUSE_LISTENING);
+    audio_ctl_resume(AUDIO_CTL_PAUSE_LISTENING);
+    CHECK(audio_ctl_paused(AUDIO_CTL_PAUSE_ALL), "resuming listening cleared the user pause");
+    int64_t start = esp_timer_get_time();
+    CHECK(!audio_ctl_wait_running(AUDIO_CTL_PAUSE_ALL, 30), "waited through a user pause");
+    CHECK(esp_timer_get_time() - start >= 25000, "wait_running timed out early");
+    audio_ctl_resume(AUDIO_CTL_PAUSE_USER);
+    CHECK(!audio_ctl_paused(AUDIO_CTL_PAUSE_ALL), "still paused after both resumes");
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    srand(42);
+    producer_done = xSemaphoreCreateBinary();
+    CHECK(audio_ctl_init() == ESP_OK, "audio_ctl_init failed");
+    check_reasons();
+
+    printf("%d random pauses of %d ms against a producer whose write blocks for its audio:\n", PAUSES, PAUSED_MS);
+    static const uint32_t rates[] = { 16000, 44100 };
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        run("poll", rates[i], legacy_producer, legacy_pause, legacy_resume);
+        run_t ctl = run("audio_ctl", rates[i], ctl_producer, ctl_pause, ctl_resume);
+        CHECK(ctl.audio_max_ms <= AUDIO_CTL_CHUNK_MS, "%lu Hz: %.1f ms played after a pause",
+              (unsigned long)rates[i], ctl.audio_max_ms);
+        CHECK(ctl.resume_median_ms < RESUME_LIMIT_MS, "%lu Hz: resume took %.1f ms (median)",
+              (unsigned long)rates[i], ctl.resume_median_ms);
+    }
+    return host_test_result("test_audio_ctl");
+}
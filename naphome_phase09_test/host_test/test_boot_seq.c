@@ -0,0 +1,289 @@
+/**
+ * @file test_boot_seq.c
+ * @brief boot_seq step graph, skips, readiness milestones and worker exit
+ *
+ * app_main's step graph with sleeps standing in for each step's bring-up
+ * time: Wi-Fi hands out its IP address ASSOCIATE_MS after its step
+ * returns, and the first AFE frame arrives FIRST_FRAME_MS after the afe
+ * step. The boot must respect every dependency, run independent steps on
+ * all BOOT_WORKERS at once, reach wake_ready before network_ready, and
+ * wake a task waiting for the network as soon as the address arrives.
+ *
+ * Before that, the same graph runs with a failing board step (first, as
+ * readiness bits are never cleared): everything behind it is skipped, the
+ * rest still runs, the workers exit once nothing is left to run, and
+ * waiting for wake_ready returns false at once instead of timing out.
+ */
+
+#include "boot_seq.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#define ASSOCIATE_MS        2500    // Wi-Fi step returned to IP_EVENT_STA_GOT_IP
+#define FIRST_FRAME_MS      30      // afe step returned to detect_Task's first frame
+#define WAIT_WAKE_MS        100     // Reaction to a readiness bit
+#define UNAVAILABLE_MS      20      // boot_seq_wait_ready on an unavailable bit
+
+// naphome_test_suite.c's steps, in its order
+enum {
+    STEP_MODELS,
+    STEP_BOARD,
+    STEP_WIFI,
+    STEP_AFE,
+    STEP_LED,
+    STEP_BG_AUDIO,
+    STEP_TASK_STATS,
+    STEP_TELEMETRY,
+    STEP_WEB,
+    STEP_MQTT,
+    STEP_COUNT,
+};
+
+// Bring-up estimates, ms
+static const uint32_t step_ms[STEP_COUNT] = {
+    [STEP_MODELS] = 150, [STEP_BOARD] = 400, [STEP_WIFI] = 250, [STEP_AFE] = 600, [STEP_LED] = 20,
+    [STEP_BG_AUDIO] = 50, [STEP_TASK_STATS] = 5, [STEP_TELEMETRY] = 50, [STEP_WEB] = 150, [STEP_MQTT] = 100,
+};
+
+static int failing_step = -1;
+static bool associate;          // Whether Wi-Fi gets an address this run
+
+static void ready_after_task(void *arg)
+{
+    uint32_t ready = (uint32_t)(uintptr_t)arg;
+    vTaskDelay(pdMS_TO_TICKS(ready == BOOT_READY_NETWORK ? ASSOCIATE_MS : FIRST_FRAME_MS));
+    boot_seq_ready(ready);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t run_step(int step)
+{
+    vTaskDelay(pdMS_TO_TICKS(step_ms[step]));
+    if (step == failing_step) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (step == STEP_WIFI && associate) {
+        xTaskCreate(ready_after_task, "got_ip", 2048, (void *)(uintptr_t)BOOT_READY_NETWORK, 5, NULL);
+    } else if (step == STEP_AFE) {
+        xTaskCreate(ready_after_task, "first_frame", 2048, (void *)(uintptr_t)BOOT_READY_WAKE, 5, NULL);
+    }
+    return ESP_OK;
+}
+
+#define STEP_FN(name, step) \
+    static esp_err_t name(void) { return run_step(step); }
+STEP_FN(boot_models, STEP_MODELS)
+STEP_FN(boot_board, STEP_BOARD)
+STEP_FN(boot_wifi, STEP_WIFI)
+STEP_FN(boot_afe, STEP_AFE)
+STEP_FN(boot_led, STEP_LED)
+STEP_FN(boot_bg_audio, STEP_BG_AUDIO)
+STEP_FN(boot_task_stats, STEP_TASK_STATS)
+STEP_FN(boot_telemetry, STEP_TELEMETRY)
+STEP_FN(boot_web, STEP_WEB)
+STEP_FN(boot_mqtt, STEP_MQTT)
+
+static const boot_step_t boot_steps[STEP_COUNT] = {
+    [STEP_MODELS]     = { "models",     boot_models,     0 },
+    [STEP_BOARD]      = { "board",      boot_board,      0 },
+    [STEP_WIFI]       = { "wifi",       boot_wifi,       0, BOOT_READY_NETWORK },
+    [STEP_AFE]        = { "afe",        boot_afe,        BOOT_DEP(STEP_MODELS) | BOOT_DEP(STEP_BOARD), BOOT_READY_WAKE },
+    [STEP_LED]        = { "led",        boot_led,        0 },
+    [STEP_BG_AUDIO]   = { "bg_audio",   boot_bg_audio,   BOOT_DEP(STEP_BOARD) },
+    [STEP_TASK_STATS] = { "task_stats", boot_task_stats, 0 },
+    [STEP_TELEMETRY]  = { "telemetry",  boot_telemetry,  BOOT_DEP(STEP_BOARD) },
+    [STEP_WEB]        = { "web",        boot_web,        BOOT_DEP(STEP_WIFI) | BOOT_DEP(STEP_BOARD) },
+    [STEP_MQTT]       = { "mqtt",       boot_mqtt,       BOOT_DEP(STEP_WIFI) | BOOT_DEP(STEP_TELEMETRY) },
+};
+
+// ---------------------------------------------------------------------------
+// Reading the table back
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    boot_record_t steps[BOOT_MAX_STEPS];
+    size_t step_count;
+    int64_t network_us;     // 0 if no milestone
+    int64_t wake_us;
+} table_t;
+
+static void collect(const boot_record_t *record, void *ctx)
+{
+    table_t *t = ctx;
+    if (record->state != BOOT_MILESTONE) {
+        t->steps[t->step_count++] = *record;
+    } else if (strcmp(record->name, "network_ready") == 0) {
+        t->network_us = record->start_us;
+    } else if (strcmp(record->name, "wake_ready") == 0) {
+        t->wake_us = record->start_us;
+    }
+}
+
+static table_t read_table(void)
+{
+    table_t t = {0};
+    boot_seq_foreach(collect, &t);
+    return t;
+}
+
+// Boot workers still alive, waiting up to a second for them to exit
+static int boot_workers_alive(void)
+{
+    static TaskStatus_t status[64];
+    int alive = 0;
+    for (int waited = 0; waited < 1000; waited += 10) {
+        UBaseType_t n = uxTaskGetSystemState(status, 64, NULL);
+        alive = 0;
+        for (UBaseType_t i = 0; i < n; i++) {
+            alive += strcmp(status[i].pcTaskName, "boot") == 0;
+        }
+        if (alive == 0) {
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return alive;
+}
+
+// Most steps running at the same moment
+static int peak_parallel(const table_t *t)
+{
+    int peak = 0;
+    for (size_t i = 0; i < t->step_count; i++) {
+        int running = 0;
+        for (size_t j = 0; j < t->step_count; j++) {
+            running += t->steps[j].start_us <= t->steps[i].start_us && t->steps[i].start_us < t->steps[j].end_us;
+        }
+        peak = running > peak ? running : peak;
+    }
+    return peak;
+}
+
+// ---------------------------------------------------------------------------
+// Runs
+// ---------------------------------------------------------------------------
+
+static void check_invalid(void)
+{
+    static const boot_step_t backwards[] = {
+        { "first", boot_led, BOOT_DEP(1) },
+        { "second", boot_led, 0 },
+    };
+    CHECK(boot_seq_run(backwards, 2) == ESP_ERR_INVALID_ARG, "dependency on a later step accepted");
+    CHECK(boot_seq_run(boot_steps, 0) == ESP_ERR_INVALID_ARG, "empty boot accepted");
+    CHECK(boot_seq_run(boot_steps, BOOT_MAX_STEPS + 1) == ESP_ERR_INVALID_ARG, "%d steps accepted",
+          BOOT_MAX_STEPS + 1);
+}
+
+static void check_failed_board(void)
+{
+    failing_step = STEP_BOARD;
+    associate = false;
+    CHECK(boot_seq_run(boot_steps, STEP_COUNT) == ESP_FAIL, "boot with a failed step returned OK");
+    table_t t = read_table();
+    static const boot_state_t expected[STEP_COUNT] = {
+        [STEP_MODELS] = BOOT_STEP_DONE, [STEP_BOARD] = BOOT_STEP_FAILED, [STEP_WIFI] = BOOT_STEP_DONE,
+        [STEP_AFE] = BOOT_STEP_SKIPPED, [STEP_LED] = BOOT_STEP_DONE, [STEP_BG_AUDIO] = BOOT_STEP_SKIPPED,
+        [STEP_TASK_STATS] = BOOT_STEP_DONE, [STEP_TELEMETRY] = BOOT_STEP_SKIPPED, [STEP_WEB] = BOOT_STEP_SKIPPED,
+        [STEP_MQTT] = BOOT_STEP_SKIPPED,
+    };
+    CHECK(t.step_count == STEP_COUNT, "%zu steps in the table", t.step_count);
+    for (size_t i = 0; i < t.step_count && i < STEP_COUNT; i++) {
+        CHECK(t.steps[i].state == expected[i], "%s %s, expected %s", t.steps[i].name,
+              boot_state_name(t.steps[i].state), boot_state_name(expected[i]));
+    }
+    CHECK(t.steps[STEP_BOARD].err == ESP_ERR_NOT_FOUND, "board failed with %s",
+          esp_err_to_name(t.steps[STEP_BOARD].err));
+    CHECK(boot_workers_alive() == 0, "boot workers still running with nothing left to do");
+
+    // afe was skipped: nobody waits for its first frame
+    int64_t start = esp_timer_get_time();
+    bool wake = boot_seq_wait_ready(BOOT_READY_WAKE, 5000);
+    double wake_ms = (esp_timer_get_time() - start) / 1000.0;
+    CHECK(!wake && wake_ms < UNAVAILABLE_MS, "wait for wake_ready returned %d after %.1f ms", wake, wake_ms);
+    // wifi succeeded, so its address may still come: that wait runs to its timeout
+    start = esp_timer_get_time();
+    bool network = boot_seq_wait_ready(BOOT_READY_NETWORK, 100);
+    double network_ms = (esp_timer_get_time() - start) / 1000.0;
+    CHECK(!network && network_ms >= 95, "wait for network_ready returned %d after %.1f ms", network, network_ms);
+    printf("Board failed: afe, bg_audio, telemetry, web and mqtt skipped; wake_ready wait gave up in %.2f ms, "
+           "network_ready wait timed out after %.0f ms\n", wake_ms, network_ms);
+}
+
+static _Atomic int64_t network_waiter_us;
+
+// The welcome task: waits for the network, then speaks
+static void network_waiter_task(void *arg)
+{
+    if (boot_seq_wait_ready(BOOT_READY_NETWORK, 10000)) {
+        atomic_store(&network_waiter_us, esp_timer_get_time());
+    }
+    vTaskDelete(NULL);
+}
+
+static void check_boot(void)
+{
+    failing_step = -1;
+    associate = true;
+    xTaskCreate(network_waiter_task, "welcome", 4096, NULL, 5, NULL);
+    int64_t start = esp_timer_get_time();
+    CHECK(boot_seq_run(boot_steps, STEP_COUNT) == ESP_OK, "boot failed");
+    double run_ms = (esp_timer_get_time() - start) / 1000.0;
+    CHECK(boot_workers_alive() == 0, "boot workers still running after the boot");
+    vTaskDelay(pdMS_TO_TICKS(ASSOCIATE_MS + WAIT_WAKE_MS));
+    table_t t = read_table();
+
+    uint32_t sequential_ms = 0;
+    for (size_t i = 0; i < t.step_count; i++) {
+        const boot_record_t *r = &t.steps[i];
+        sequential_ms += step_ms[i];
+        CHECK(r->state == BOOT_STEP_DONE, "%s %s", r->name, boot_state_name(r->state));
+        CHECK(r->end_us - r->start_us >= step_ms[i] * 1000, "%s took %lld us, sleeps %u ms", r->name,
+              (long long)(r->end_us - r->start_us), (unsigned)step_ms[i]);
+        for (size_t d = 0; d < i; d++) {
+            if (boot_steps[i].deps & BOOT_DEP(d)) {
+                CHECK(r->start_us >= t.steps[d].end_us, "%s started before %s ended", r->name, t.steps[d].name);
+            }
+        }
+    }
+    int peak = peak_parallel(&t);
+    CHECK(peak == BOOT_WORKERS, "at most %d steps ran at once", peak);
+    CHECK(run_ms < sequential_ms, "boot took %.0f ms, the steps %u ms back to back", run_ms,
+          (unsigned)sequential_ms);
+
+    // Milestones come from their sources, after the steps that provide them
+    CHECK(t.wake_us >= t.steps[STEP_AFE].end_us + FIRST_FRAME_MS * 1000, "wake_ready %lld us, afe ended %lld us",
+          (long long)t.wake_us, (long long)t.steps[STEP_AFE].end_us);
+    CHECK(t.network_us >= t.steps[STEP_WIFI].end_us + ASSOCIATE_MS * 1000,
+          "network_ready %lld us, wifi ended %lld us", (long long)t.network_us,
+          (long long)t.steps[STEP_WIFI].end_us);
+    CHECK(t.wake_us < t.network_us, "wake_ready after network_ready: detection waited on Wi-Fi");
+    int64_t waiter = atomic_load(&network_waiter_us);
+    CHECK(waiter >= t.network_us && waiter - t.network_us < WAIT_WAKE_MS * 1000,
+          "welcome task woke %lld us after network_ready", (long long)(waiter - t.network_us));
+
+    printf("Boot graph on %d workers: %.0f ms (steps back to back %u ms), up to %d steps at once\n", BOOT_WORKERS,
+           run_ms, (unsigned)sequential_ms, peak);
+    printf("  %-12s %8s %8s\n", "step", "start", "end");
+    for (size_t i = 0; i < t.step_count; i++) {
+        printf("  %-12s %6.0f ms %6.0f ms\n", t.steps[i].name, (t.steps[i].start_us - start) / 1000.0,
+               (t.steps[i].end_us - start) / 1000.0);
+    }
+    printf("  wake_ready   %6.0f ms\n  network_ready %5.0f ms (welcome task woke %.2f ms later)\n",
+           (t.wake_us - start) / 1000.0, (t.network_us - start) / 1000.0, (waiter - t.network_us) / 1000.0);
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);  // The failing step and the skips log errors on purpose
+    CHECK(boot_seq_init() == ESP_OK, "boot_seq_init failed");
+    check_invalid();
+    check_failed_board();
+    check_boot();
+    return host_test_result("test_boot_seq");
+}
@@ -0,0 +1,307 @@
+/**
+ * @file test_circuit_breaker.c
+ * @brief circuit_breaker through an upstream outage injected into cloud_standin.py
+ *
+ * One TTS announcement per second, made the way google_tts_speak makes it
+ * (breaker_allow, POST, breaker_record), with naphome_test_suite.c's HEAD
+ * health probe. The stand-in is this process's parent (ctest runs it with
+ * --exec); SIGUSR1 switches it off, so calls hang until their timeout, and
+ * back on. The same outage is run without a breaker and with one: time
+ * spent blocked in calls, how fast refusals are, and how soon after the
+ * upstream returns the first announcement gets through.
+ *
+ * How fast a refusal is comes from a separate breaker held open, refusing
+ * many calls in a row: the median is checked, since a single refusal can
+ * be descheduled for milliseconds when ctest runs tests in parallel.
+ *
+ * Usage: test_circuit_breaker <stand-in URL>   (ctest starts the stand-in)
+ */
+
+#include "circuit_breaker.h"
+#include "metrics.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TICKS               20      // Announcements, one per second
+#define OFF_AT_S            3       // Upstream switched off ...
+#define ON_AT_S             13      // ... and back on
+#define CALL_TIMEOUT_MS     2000    // google_tts_speak uses 15000
+#define PROBE_TIMEOUT_MS    1000    // CLOUD_PROBE_TIMEOUT_MS
+#define OPEN_MIN_MS         500
+#define OPEN_MAX_MS         4000
+#define REFUSAL_LIMIT_US    1000    // Median
+#define REFUSALS            1001
+#define METRICS_TEXT_MAX    8192
+
+#define CALL_REJECTED       (-2)
+
+static const char *base_url;
+
+// naphome_test_suite.c's cloud_probe: HEAD to the API host, any status will do
+static bool cloud_probe(void *ctx)
+{
+    esp_http_client_config_t config = {
+        .url = (const char *)ctx,
+        .method = HTTP_METHOD_HEAD,
+        .timeout_ms = PROBE_TIMEOUT_MS,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) {
+        return false;
+    }
+    esp_err_t err = esp_http_client_perform(client);
+    esp_http_client_cleanup(client);
+    return err == ESP_OK;
+}
+
+// Shape of google_tts_speak: allow, post, record
+static int tts_call(breaker_t *breaker)
+{
+    if (!breaker_allow(breaker)) {
+        return CALL_REJECTED;
+    }
+    char url[256];
+    snprintf(url, sizeof(url), "%s/v1/text:synthesize?key=k", base_url);
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = CALL_TIMEOUT_MS,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    int status = -1;
+    if (client) {
+        const char *body = "{\"input\":{\"text\":\"hi\"}}";
+        int len = strlen(body);
+        if (esp_http_client_open(client, len) == ESP_OK && esp_http_client_write(client, body, len) == len &&
+            esp_http_client_fetch_headers(client) >= 0) {
+            status = esp_http_client_get_status_code(client);
+            char chunk[512];
+            while (esp_http_client_read(client, chunk, sizeof(chunk)) > 0) {
+            }
+        }
+        esp_http_client_cleanup(client);
+    }
+    breaker_record(breaker, status > 0 && status < 500);
+    return status;
+}
+
+// ---------------------------------------------------------------------------
+// Metrics
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char text[METRICS_TEXT_MAX];
+    size_t len;
+} capture_t;
+
+static esp_err_t capture_flush(const char *data, size_t len, void *ctx)
+{
+    capture_t *c = ctx;
+    if (c->len + len >= sizeof(c->text)) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(c->text + c->len, data, len);
+    c->len += len;
+    c->text[c->len] = '\0';
+    return ESP_OK;
+}
+
+static double metric_value(const char *series)
+{
+    static capture_t c;
+    static char buf[1024];
+    c.len = 0;
+    c.text[0] = '\0';
+    if (metrics_write_prometheus(buf, sizeof(buf), capture_flush, &c) != ESP_OK) {
+        return -1;
+    }
+    size_t len = strlen(series);
+    for (const char *line = c.text; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+        if (strncmp(line, series, len) == 0 && line[len] == ' ') {
+            return strtod(line + len + 1, NULL);
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Refusals
+// ---------------------------------------------------------------------------
+
+static bool probe_fails(void *ctx)
+{
+    return false;
+}
+
+static int compare_us(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Median time for breaker_allow() to refuse, -1 if the breaker let a call through
+static double refusal_median_us(void)
+{
+    breaker_config_t config = BREAKER_DEFAULT_CONFIG();
+    config.name = "refusals";
+    config.labels = "api=\"refusals\"";
+    config.open_min_ms = 60000;
+    config.probe = probe_fails;
+    breaker_t *breaker = breaker_create(&config);
+    if (!breaker) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < config.consecutive; i++) {
+        breaker_allow(breaker);
+        breaker_record(breaker, false);
+    }
+    static double us[REFUSALS];
+    for (int i = 0; i < REFUSALS; i++) {
+        int64_t start = esp_timer_get_time();
+        bool allowed = breaker_allow(breaker);
+        us[i] = esp_timer_get_time() - start;
+        if (allowed) {
+            return -1;
+        }
+    }
+    qsort(us, REFUSALS, sizeof(us[0]), compare_us);
+    return us[REFUSALS / 2];
+}
+
+// ---------------------------------------------------------------------------
+// Outage
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int run;            // Announcements started
+    int dropped;        // Skipped: still stuck in an earlier call at their tick
+    int ok;
+    int failed;
+    int rejected;
+    double blocked_ms;  // Time spent in calls that went out
+    double worst_ms;
+    double refusal_max_us;
+    double recovered_s; // Upstream back to the first success; -1 if none
+} outage_t;
+
+static void switch_upstream(void)
+{
+    kill(getppid(), SIGUSR1);
+}
+
+static outage_t outage(breaker_t *breaker)
+{
+    outage_t o = { .recovered_s = -1 };
+    int64_t start = esp_timer_get_time();
+    bool off = false;
+    bool back = false;
+    for (int tick = 0; tick < TICKS; tick++) {
+        int64_t at = start + tick * 1000000LL;
+        while (esp_timer_get_time() < at) {
+            vTaskDelay(pdMS_TO_TICKS(5));
+        }
+        if (!off && tick >= OFF_AT_S) {
+            switch_upstream();
+            off = true;
+        }
+        if (off && !back && tick >= ON_AT_S) {
+            switch_upstream();
+            back = true;
+        }
+        if (esp_timer_get_time() - at > 1000000LL) {
+            o.dropped++;
+            continue;
+        }
+        int64_t call_start = esp_timer_get_time();
+        int status = tts_call(breaker);
+        double us = esp_timer_get_time() - call_start;
+        o.run++;
+        if (status == CALL_REJECTED) {
+            o.rejected++;
+            if (us > o.refusal_max_us) {
+                o.refusal_max_us = us;
+            }
+            continue;
+        }
+        o.blocked_ms += us / 1000;
+        if (us / 1000 > o.worst_ms) {
+            o.worst_ms = us / 1000;
+        }
+        if (status == 200) {
+            o.ok++;
+            if (back && o.recovered_s < 0) {
+                o.recovered_s = (esp_timer_get_time() - start) / 1e6 - ON_AT_S;
+            }
+        } else {
+            o.failed++;
+        }
+    }
+    return o;
+}
+
+static void print_outage(const char *name, const outage_t *o)
+{
+    printf("  %-10s %2d run, %2d dropped, %2d ok, %2d timed out (%5.0f ms blocked, worst %4.0f ms), "
+           "%2d refused (max %3.0f us); first success %.1f s after the upstream returned\n",
+           name, o->run, o->dropped, o->ok, o->failed, o->blocked_ms, o->worst_ms, o->rejected, o->refusal_max_us,
+           o->recovered_s);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <cloud stand-in URL>\n", argv[0]);
+        return 2;
+    }
+    base_url = argv[1];
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    signal(SIGPIPE, SIG_IGN);
+    CHECK(breaker_init() == ESP_OK, "breaker task did not start");
+
+    char probe_url[256];
+    snprintf(probe_url, sizeof(probe_url), "%s/", base_url);
+    breaker_config_t config = BREAKER_DEFAULT_CONFIG();
+    config.name = "tts";
+    config.labels = "api=\"tts\"";
+    config.open_min_ms = OPEN_MIN_MS;
+    config.open_max_ms = OPEN_MAX_MS;
+    config.probe = cloud_probe;
+    config.probe_ctx = probe_url;
+    breaker_t *breaker = breaker_create(&config);
+    CHECK(breaker != NULL, "no breaker");
+
+    outage_t without = outage(NULL);
+    outage_t with = outage(breaker);
+    printf("%d announcements, upstream off from %d s to %d s, %d ms call timeout:\n", TICKS, OFF_AT_S, ON_AT_S,
+           CALL_TIMEOUT_MS);
+    print_outage("no breaker", &without);
+    print_outage("breaker", &with);
+    double refusal_us = refusal_median_us();
+    printf("%d refusals from an open breaker: median %.1f us\n", REFUSALS, refusal_us);
+
+    CHECK(with.rejected > 0, "the breaker never opened");
+    CHECK(refusal_us >= 0 && refusal_us < REFUSAL_LIMIT_US, "refusals took %.1f us (median)", refusal_us);
+    CHECK(with.failed <= (int)config.consecutive + 1, "%d calls timed out with the breaker", with.failed);
+    CHECK(with.blocked_ms * 2 < without.blocked_ms, "blocked %.0f ms with the breaker, %.0f ms without",
+          with.blocked_ms, without.blocked_ms);
+    CHECK(without.recovered_s >= 0 && with.recovered_s >= 0, "no success after the upstream returned");
+    // The probe interval and one probe, then the next tick
+    CHECK(with.recovered_s < (OPEN_MAX_MS + PROBE_TIMEOUT_MS) / 1000.0 + 1, "recovered after %.1f s",
+          with.recovered_s);
+    CHECK(breaker_state(breaker) == BREAKER_CLOSED, "breaker %s after the outage",
+          breaker_state_name(breaker_state(breaker)));
+    double rejected_total = metric_value("naphome_breaker_rejected_total{api=\"tts\"}");
+    CHECK(rejected_total == with.rejected, "naphome_breaker_rejected_total %.0f, %d refused", rejected_total,
+          with.rejected);
+    CHECK(metric_value("naphome_breaker_state{api=\"tts\"}") == BREAKER_CLOSED, "naphome_breaker_state not closed");
+    return host_test_result("test_circuit_breaker");
+}
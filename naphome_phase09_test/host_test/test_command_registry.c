@@ -0,0 +1,261 @@
+/**
+ * @file test_command_registry.c
+ * @brief Command registry parsing, persistence, and lookups during swaps
+ *
+ * Loads the default registry gen_command_registry.py builds from
+ * commands.yaml, rejects malformed blobs, persists an uploaded one across
+ * a simulated reboot, and registers it with the MultiNet stand-in. Reader
+ * tasks then look up commands while the registry is swapped underneath
+ * them; every entry they get must be whole and from a single registry
+ * (the target is built with AddressSanitizer where available, so reading
+ * a freed registry fails the run).
+ */
+
+#include "command_registry.h"
+#include "esp_log.h"
+#include "esp_mn_speech_commands.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include "nvs.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#define GEN_COMMANDS        40
+#define SWAPS               400
+#define READERS             3
+
+extern const uint8_t command_registry_default[];
+extern const size_t command_registry_default_len;
+
+// Registry blob in the gen_command_registry.py layout: every string of
+// command <id> in generation <gen> encodes both, e.g. phonemes "a7",
+// phrase "alpha 7", intent "intent_a7"
+static size_t build_blob(uint8_t *out, size_t cap, char gen, int count)
+{
+    static const char *const names[] = { "alpha", "bravo" };
+    uint8_t pool[4096];
+    size_t pool_len = 0;
+    uint8_t *table = out + 12;
+    for (int i = 0; i < count; i++) {
+        uint16_t offsets[3];
+        char text[3][32];
+        snprintf(text[0], sizeof(text[0]), "%c%d", gen, i);
+        snprintf(text[1], sizeof(text[1]), "%s %d", names[gen - 'a'], i);
+        snprintf(text[2], sizeof(text[2]), "intent_%c%d", gen, i);
+        for (int s = 0; s < 3; s++) {
+            offsets[s] = (uint16_t)pool_len;
+            size_t len = strlen(text[s]) + 1;
+            memcpy(pool + pool_len, text[s], len);
+            pool_len += len;
+        }
+        uint8_t *e = table + i * 8;
+        e[0] = (uint8_t)i;
+        e[1] = 0;
+        for (int s = 0; s < 3; s++) {
+            e[2 + 2 * s] = offsets[s] & 0xFF;
+            e[3 + 2 * s] = offsets[s] >> 8;
+        }
+    }
+    memcpy(table + count * 8, pool, pool_len);
+    size_t body_len = count * 8 + pool_len;
+    CHECK(12 + body_len <= cap, "blob too large");
+    memcpy(out, "NCMD", 4);
+    out[4] = 1;
+    out[5] = (uint8_t)count;
+    out[6] = pool_len & 0xFF;
+    out[7] = pool_len >> 8;
+    uint32_t crc = esp_rom_crc32_le(0, table, body_len);
+    for (int b = 0; b < 4; b++) {
+        out[8 + b] = (uint8_t)(crc >> (8 * b));
+    }
+    return 12 + body_len;
+}
+
+// An entry is whole if all three strings name the same generation and ID
+static bool entry_consistent(const command_entry_t *entry, char *gen_out)
+{
+    char gen;
+    int id_ph, id_phrase, id_intent;
+    char word[16], intent_gen;
+    if (!entry->phonemes || !entry->phrase || !entry->intent ||
+        sscanf(entry->phonemes, "%c%d", &gen, &id_ph) != 2 ||
+        sscanf(entry->phrase, "%15s %d", word, &id_phrase) != 2 ||
+        sscanf(entry->intent, "intent_%c%d", &intent_gen, &id_intent) != 2) {
+        return false;
+    }
+    if (gen_out) {
+        *gen_out = gen;
+    }
+    return word[0] == gen && intent_gen == gen && id_ph == entry->id && id_phrase == entry->id &&
+           id_intent == entry->id;
+}
+
+static void check_default(void)
+{
+    CHECK(command_registry_init() == ESP_OK, "init failed");
+    size_t entries = 0;
+    int first_id = -1;
+    for (int id = 0; id < COMMAND_REGISTRY_MAX_ID; id++) {
+        command_entry_t entry;
+        char buf[192];
+        esp_err_t ret = command_registry_get(id, &entry, buf, sizeof(buf));
+        if (ret == ESP_OK) {
+            CHECK(entry.id == id && entry.phonemes && entry.phonemes[0], "default command %d malformed", id);
+            if (first_id < 0) {
+                first_id = id;
+            }
+            entries++;
+        } else {
+            CHECK(ret == ESP_ERR_NOT_FOUND, "command %d: %s", id, esp_err_to_name(ret));
+        }
+    }
+    CHECK(entries > 0, "default registry is empty");
+    printf("default registry: %zu commands, %zu bytes\n", entries, command_registry_default_len);
+
+    command_entry_t entry;
+    char tiny[2];
+    CHECK(command_registry_get(first_id, &entry, tiny, sizeof(tiny)) == ESP_ERR_INVALID_SIZE,
+          "strings copied into a 2-byte buffer");
+    CHECK(command_registry_get(-1, &entry, tiny, sizeof(tiny)) == ESP_ERR_NOT_FOUND, "negative ID found");
+    CHECK(command_registry_get(COMMAND_REGISTRY_MAX_ID, &entry, tiny, sizeof(tiny)) == ESP_ERR_NOT_FOUND,
+          "ID past the table found");
+}
+
+static void check_malformed(void)
+{
+    uint8_t blob[2048];
+    size_t len = build_blob(blob, sizeof(blob), 'a', 4);
+
+    uint8_t bad[2048];
+    memcpy(bad, blob, len);
+    bad[len - 1] ^= 1;
+    CHECK(command_registry_store(bad, len) == ESP_ERR_INVALID_CRC, "corrupted pool accepted");
+    memcpy(bad, blob, len);
+    bad[0] = 'X';
+    CHECK(command_registry_store(bad, len) == ESP_ERR_INVALID_ARG, "bad magic accepted");
+    CHECK(command_registry_store(blob, len - 1) == ESP_ERR_INVALID_SIZE, "truncated blob accepted");
+    memcpy(bad, blob, len);
+    bad[12] = 3;    // First entry's ID now after the second's: not sorted
+    uint32_t crc = esp_rom_crc32_le(0, bad + 12, len - 12);
+    for (int b = 0; b < 4; b++) {
+        bad[8 + b] = (uint8_t)(crc >> (8 * b));
+    }
+    CHECK(command_registry_store(bad, len) == ESP_ERR_INVALID_ARG, "unsorted entries accepted");
+    CHECK(!command_registry_update_pending(), "a rejected blob was queued");
+}
+
+static void count_entry(const command_entry_t *entry, void *ctx)
+{
+    (*(size_t *)ctx)++;
+}
+
+static void check_store_apply(void)
+{
+    uint8_t blob[2048];
+    size_t len = build_blob(blob, sizeof(blob), 'b', GEN_COMMANDS);
+    CHECK(command_registry_store(blob, len) == ESP_OK, "valid blob rejected");
+    CHECK(command_registry_update_pending(), "store did not queue the registry");
+    size_t listed = 0;
+    command_registry_foreach(count_entry, &listed);
+    CHECK(listed == GEN_COMMANDS, "foreach listed %zu, the queued registry has %d", listed, GEN_COMMANDS);
+
+    CHECK(command_registry_apply(NULL, NULL) == ESP_OK, "apply failed");
+    CHECK(!command_registry_update_pending(), "still pending after apply");
+    CHECK(host_mn_command_count() == GEN_COMMANDS, "MultiNet has %zu commands", host_mn_command_count());
+    CHECK(host_mn_command_phonemes(7) && strcmp(host_mn_command_phonemes(7), "b7") == 0,
+          "command 7 registered as %s", host_mn_command_phonemes(7));
+
+    // A reboot finds the uploaded registry in NVS
+    host_nvs_power_cycle();
+    CHECK(command_registry_init() == ESP_OK, "init after reboot failed");
+    command_entry_t entry;
+    char buf[96];
+    CHECK(command_registry_get(GEN_COMMANDS - 1, &entry, buf, sizeof(buf)) == ESP_OK &&
+          entry_consistent(&entry, NULL) && entry.phonemes[0] == 'b', "uploaded registry lost across reboot");
+}
+
+static atomic_bool readers_stop;
+static atomic_int readers_running;
+
+typedef struct {
+    uint32_t lookups;
+    uint32_t found[2];      // Per generation
+    uint32_t torn;
+} reader_stats_t;
+
+static void reader_task(void *arg)
+{
+    reader_stats_t *stats = arg;
+    uint32_t id = (uint32_t)(uintptr_t)stats;
+    while (!atomic_load(&readers_stop)) {
+        id = id * 1103515245u + 12345u;
+        command_entry_t entry;
+        char buf[96];
+        if (command_registry_get((id >> 8) % GEN_COMMANDS, &entry, buf, sizeof(buf)) == ESP_OK) {
+            char gen = 0;
+            if (entry_consistent(&entry, &gen) && (gen == 'a' || gen == 'b')) {
+                stats->found[gen - 'a']++;
+            } else {
+                stats->torn++;
+            }
+        }
+        stats->lookups++;
+    }
+    atomic_fetch_sub(&readers_running, 1);
+    vTaskDelete(NULL);
+}
+
+static void check_concurrent_swaps(void)
+{
+    uint8_t blobs[2][2048];
+    size_t lens[2] = {
+        build_blob(blobs[0], sizeof(blobs[0]), 'a', GEN_COMMANDS),
+        build_blob(blobs[1], sizeof(blobs[1]), 'b', GEN_COMMANDS),
+    };
+
+    reader_stats_t stats[READERS] = {0};
+    atomic_store(&readers_running, READERS);
+    for (int r = 0; r < READERS; r++) {
+        xTaskCreatePinnedToCore(reader_task, "reader", 4096, &stats[r], 5, NULL, r & 1);
+    }
+    int64_t start = esp_timer_get_time();
+    for (int swap = 0; swap < SWAPS; swap++) {
+        CHECK(command_registry_store(blobs[swap & 1], lens[swap & 1]) == ESP_OK, "store %d failed", swap);
+        CHECK(command_registry_apply(NULL, NULL) == ESP_OK, "apply %d failed", swap);
+        if (swap % 16 < 2) {
+            vTaskDelay(1);  // Let the readers run between bursts, once on each registry
+        }
+    }
+    double elapsed_ms = (esp_timer_get_time() - start) / 1000.0;
+    atomic_store(&readers_stop, true);
+    while (atomic_load(&readers_running) > 0) {
+        vTaskDelay(1);
+    }
+
+    reader_stats_t total = {0};
+    for (int r = 0; r < READERS; r++) {
+        total.lookups += stats[r].lookups;
+        total.found[0] += stats[r].found[0];
+        total.found[1] += stats[r].found[1];
+        total.torn += stats[r].torn;
+    }
+    CHECK(total.torn == 0, "%u of %u lookups returned a torn entry", (unsigned)total.torn, (unsigned)total.lookups);
+    CHECK(total.found[0] > 0 && total.found[1] > 0, "readers never saw both registries (%u / %u)",
+          (unsigned)total.found[0], (unsigned)total.found[1]);
+    printf("%d swaps in %.0f ms under %d readers: %u lookups (%u alpha, %u bravo), 0 torn\n", SWAPS, elapsed_ms,
+           READERS, (unsigned)total.lookups, (unsigned)total.found[0], (unsigned)total.found[1]);
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    check_default();
+    check_malformed();
+    check_store_apply();
+    check_concurrent_swaps();
+    return host_test_result("test_command_registry");
+}
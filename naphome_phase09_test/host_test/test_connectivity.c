@@ -0,0 +1,240 @@
+/**
+ * @file test_connectivity.c
+ * @brief connectivity bits through link flaps, and how soon a waiter runs after GOT_IP
+ *
+ * wifi_manager and the simulated driver (wifi_host.c) bring the station up
+ * and back after each flap. The reachability probe resolves through a
+ * wrapped getaddrinfo() that answers with a local listener after a DNS
+ * round trip, or fails while the "upstream" is down. For every flap a task
+ * waits the way tts_task used to (poll esp_wifi_sta_get_ap_info() every
+ * 100 ms, then settle for 500 ms) next to one blocked in
+ * connectivity_wait(CONN_INTERNET); both are timed from GOT_IP.
+ */
+
+#include "connectivity.h"
+#include "wifi_manager.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define SSID                "naphome-test"
+#define DNS_MS              30      // Resolver round trip
+#define FLAPS               8
+#define OUTAGE_MAX_MS       400     // AP off the air for 0..this after the loss is seen
+#define WAIT_MS             10000   // tts_task's TTS_NETWORK_WAIT_MS
+#define WAKE_LIMIT_MS       (DNS_MS + 50)
+
+static const uint8_t bssid[6] = { 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01 };
+
+static atomic_bool upstream = true;
+static int listen_port = 0;
+static _Atomic int64_t got_ip_us = 0;
+
+int __real_getaddrinfo(const char *node, const char *service, const struct addrinfo *hints,
+                       struct addrinfo **res);
+
+// Every name resolves to the local listener while the upstream is up
+int __wrap_getaddrinfo(const char *node, const char *service, const struct addrinfo *hints,
+                       struct addrinfo **res)
+{
+    vTaskDelay(pdMS_TO_TICKS(DNS_MS));
+    if (!atomic_load(&upstream)) {
+        return EAI_AGAIN;
+    }
+    char port[8];
+    snprintf(port, sizeof(port), "%d", listen_port);
+    return __real_getaddrinfo("127.0.0.1", port, hints, res);
+}
+
+static void *accept_thread(void *arg)
+{
+    int listener = (int)(intptr_t)arg;
+    for (;;) {
+        int sock = accept(listener, NULL, NULL);
+        if (sock >= 0) {
+            close(sock);
+        }
+    }
+    return NULL;
+}
+
+static bool start_listener(void)
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 16) != 0 ||
+        getsockname(listener, (struct sockaddr *)&addr, &len) != 0) {
+        return false;
+    }
+    listen_port = ntohs(addr.sin_port);
+    pthread_t thread;
+    pthread_create(&thread, NULL, accept_thread, (void *)(intptr_t)listener);
+    pthread_detach(thread);
+    return true;
+}
+
+static void on_got_ip(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    atomic_store(&got_ip_us, esp_timer_get_time());
+}
+
+// ---------------------------------------------------------------------------
+// Waiters
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    WAIT_POLL,          // tts_task before connectivity.c
+    WAIT_EVENT,         // connectivity_wait(CONN_INTERNET)
+} wait_kind_t;
+
+typedef struct {
+    wait_kind_t kind;
+    SemaphoreHandle_t done;
+    bool ready;
+    bool internet;      // CONN_INTERNET was set when the waiter went ahead
+    int64_t ran_us;
+} waiter_t;
+
+static bool poll_wait(void)
+{
+    for (int retry = 0; retry < WAIT_MS / 100; retry++) {
+        wifi_ap_record_t ap_info;
+        if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
+            vTaskDelay(pdMS_TO_TICKS(500));
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    return false;
+}
+
+static void waiter_task(void *arg)
+{
+    waiter_t *waiter = arg;
+    waiter->ready = waiter->kind == WAIT_POLL ? poll_wait() : connectivity_wait(CONN_INTERNET, WAIT_MS);
+    waiter->ran_us = esp_timer_get_time();
+    waiter->internet = connectivity_has(CONN_INTERNET);
+    xSemaphoreGive(waiter->done);
+    vTaskDelete(NULL);
+}
+
+typedef struct {
+    double sum_ms;
+    double max_ms;
+    int early;          // Went ahead before the internet was reachable
+} wake_stats_t;
+
+static void record(wake_stats_t *stats, const waiter_t *waiter)
+{
+    double ms = (waiter->ran_us - atomic_load(&got_ip_us)) / 1000.0;
+    stats->sum_ms += ms;
+    if (ms > stats->max_ms) {
+        stats->max_ms = ms;
+    }
+    if (!waiter->internet) {
+        stats->early++;
+    }
+}
+
+static bool wait_state(uint32_t state, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 5) {
+        if (connectivity_state() == state) {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    return false;
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    srand(46);
+    CHECK(start_listener(), "no local listener");
+    CHECK(esp_event_loop_create_default() == ESP_OK, "event loop not created");
+    esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_got_ip, NULL);
+    CHECK(connectivity_init() == ESP_OK, "connectivity did not start");
+    host_wifi_set_ap(SSID, bssid, 6);
+    wifi_manager_config_t config = WIFI_MANAGER_DEFAULT_CONFIG();
+    config.ssid = SSID;
+    config.password = "password";
+    CHECK(wifi_manager_start(&config) == ESP_OK, "manager did not start");
+
+    CHECK(connectivity_wait(CONN_INTERNET, WAIT_MS), "internet not reached after boot");
+    CHECK(connectivity_has(CONN_LINK | CONN_IP | CONN_DNS | CONN_INTERNET), "state %s after boot",
+          connectivity_state_name(connectivity_state()));
+
+    // Link flaps: every bit drops with the link, and comes back with the probe
+    wake_stats_t poll_stats = {0};
+    wake_stats_t event_stats = {0};
+    for (int flap = 0; flap < FLAPS; flap++) {
+        host_wifi_ap_down();
+        CHECK(wait_state(0, 2000), "flap %d: state %s after the link dropped", flap,
+              connectivity_state_name(connectivity_state()));
+
+        waiter_t waiters[2] = {
+            { .kind = WAIT_POLL, .done = xSemaphoreCreateBinary() },
+            { .kind = WAIT_EVENT, .done = xSemaphoreCreateBinary() },
+        };
+        xTaskCreate(waiter_task, "poll_wait", 4096, &waiters[0], 5, NULL);
+        xTaskCreate(waiter_task, "event_wait", 4096, &waiters[1], 5, NULL);
+        vTaskDelay(pdMS_TO_TICKS(rand() % (OUTAGE_MAX_MS + 1)));
+        host_wifi_set_ap(SSID, bssid, 6);
+
+        for (int i = 0; i < 2; i++) {
+            xSemaphoreTake(waiters[i].done, portMAX_DELAY);
+            vSemaphoreDelete(waiters[i].done);
+            CHECK(waiters[i].ready, "flap %d: waiter %d timed out", flap, i);
+        }
+        record(&poll_stats, &waiters[0]);
+        record(&event_stats, &waiters[1]);
+        CHECK(waiters[1].internet, "flap %d: connectivity_wait returned without the internet", flap);
+    }
+    double poll_mean = poll_stats.sum_ms / FLAPS;
+    double event_mean = event_stats.sum_ms / FLAPS;
+    CHECK(event_stats.max_ms < WAKE_LIMIT_MS, "connectivity_wait ran %.0f ms after GOT_IP", event_stats.max_ms);
+    CHECK(event_mean < poll_mean, "event wait %.0f ms, poll %.0f ms", event_mean, poll_mean);
+
+    // Already online: the check itself
+    int64_t start = esp_timer_get_time();
+    CHECK(connectivity_wait(CONN_INTERNET, WAIT_MS), "online, yet connectivity_wait timed out");
+    int64_t online_us = esp_timer_get_time() - start;
+    CHECK(online_us < 1000, "online check took %lld us", (long long)online_us);
+
+    // Upstream gone with the link up: a failed call clears the bits, a probe retry restores them
+    atomic_store(&upstream, false);
+    connectivity_report(false);
+    CHECK(wait_state(CONN_LINK | CONN_IP, 1000), "state %s with the upstream down",
+          connectivity_state_name(connectivity_state()));
+    atomic_store(&upstream, true);
+    start = esp_timer_get_time();
+    CHECK(connectivity_wait(CONN_INTERNET, WAIT_MS), "internet not back after the upstream returned");
+    int64_t recover_ms = (esp_timer_get_time() - start) / 1000;
+    CHECK(recover_ms < 2 * CONNECTIVITY_RETRY_MIN_MS + DNS_MS, "upstream back after %lld ms", (long long)recover_ms);
+
+    printf("%d link flaps (AP off 0-%d ms, DNS %d ms), GOT_IP to the waiter running:\n", FLAPS, OUTAGE_MAX_MS,
+           DNS_MS);
+    printf("  poll + settle       mean %4.0f ms  max %4.0f ms  %d ran before the internet was up\n", poll_mean,
+           poll_stats.max_ms, poll_stats.early);
+    printf("  connectivity_wait   mean %4.0f ms  max %4.0f ms  %d ran before the internet was up\n", event_mean,
+           event_stats.max_ms, event_stats.early);
+    printf("already online: connectivity_wait %lld us; upstream back: internet after %lld ms\n",
+           (long long)online_us, (long long)recover_ms);
+    return host_test_result("test_connectivity");
+}
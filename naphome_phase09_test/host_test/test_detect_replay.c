@@ -0,0 +1,435 @@
+/**
+ * @file test_detect_replay.c
+ * @brief detect_fsm_step() driven by WAV files and scripted WakeNet/MultiNet
+ *
+ * replay/gen_utterances.py writes each utterance as a WAV file plus a
+ * decision trace: when WakeNet fires, whether and when MultiNet matches a
+ * command, and where the command really is. The replay feeds the audio
+ * through the real state machine, capture ring and endpointer in AFE-sized
+ * frames, answers the ops from the trace, and reports every transition,
+ * allocation and fallback window.
+ *
+ * Checks: no allocation after audio_capture_init(); handled commands never
+ * reach STT; unhandled and unmatched utterances reach it exactly once with
+ * the whole command inside the window; unmatched ones are ended by the
+ * endpointer before MultiNet's timeout; every utterance returns to idle.
+ *
+ * The corpus is replayed twice: once with the intent handler called inline
+ * in detect_fsm_step(), as detect_Task used to, and once posted to the real
+ * action executor. The handler stand-in blocks for HANDLER_MS, a hundredth
+ * of a smile plus a spoken reply. The slowest step in each pass is the
+ * before/after detect-loop stall.
+ *
+ * Usage: test_detect_replay <corpus dir>
+ */
+
+#include "detect_fsm.h"
+#include "action_executor.h"
+#include "audio_capture.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include "wav_reader.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FRAME_SAMPLES       512     // AFE fetch chunk
+#define MULTINET_TIMEOUT_MS 6000    // Matches the duration detect_Task creates MultiNet with
+#define LOCAL_COMMAND_ID    13      // The one command id the script handles locally
+#define MAX_UTTERANCES      64
+#define HANDLER_MS          22      // Smile and reply (2.2 s on device) at 1/100 scale
+#define LOG_LEN             512
+
+#define POSITION_MS(p)      ((int64_t)((p) * 1000 / CAPTURE_SAMPLE_RATE))
+
+// Counted through -Wl,--wrap so every allocation the firmware code makes shows up
+static size_t alloc_calls = 0;
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    alloc_calls++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    alloc_calls++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    alloc_calls++;
+    return __real_realloc(ptr, size);
+}
+
+typedef enum {
+    KIND_CLOUD,                 // MultiNet never matches
+    KIND_LOCAL,                 // Matches a command the script handles
+    KIND_UNHANDLED,             // Matches a command the script does not handle
+} utterance_kind_t;
+
+typedef enum {
+    HANDLERS_INLINE,            // Before: the handler runs in detect_fsm_step()
+    HANDLERS_EXECUTOR,          // After: action_executor_post()
+} handler_mode_t;
+
+static handler_mode_t handler_mode;
+static atomic_int handlers_run;
+
+static bool stand_in_handler(const intent_def_t *intent, int command_id, const char *text)
+{
+    vTaskDelay(pdMS_TO_TICKS(HANDLER_MS));
+    atomic_fetch_add(&handlers_run, 1);
+    return true;
+}
+
+static const intent_def_t local_intent = {
+    .name = "local",
+    .ids = { LOCAL_COMMAND_ID },
+    .num_ids = 1,
+    .handler = stand_in_handler,
+};
+
+static const char *const kind_names[] = { "cloud", "local", "unhandled" };
+static const char *const event_names[] = { "wake", "command", "end_of_speech", "timeout" };
+
+// Trace times are relative to the file; the replay offsets them by where it starts in the ring
+typedef struct {
+    utterance_kind_t kind;
+    int64_t wake_ms;
+    int64_t detected_ms;        // 0 if MultiNet never matches
+    int command_id;
+    int64_t speech_start_ms;
+    int64_t speech_end_ms;
+} trace_t;
+
+typedef struct {
+    trace_t trace;
+    int64_t timeout_ms;         // MultiNet timeout, from the last clean()
+    bool detected;
+    esp_mn_results_t results;
+    int fallbacks;
+    int64_t fallback_start_ms;
+    int64_t fallback_end_ms;
+    int64_t fallback_at_ms;
+    size_t clip_samples;
+    bool clip_ok;
+    int commands_run;
+    detect_event_t last_event;
+    detect_state_t state;
+    char log[LOG_LEN];
+} replay_t;
+
+// One state machine for the whole corpus, as detect_Task keeps one, so the
+// endpointer's noise floor carries over from file to file
+static replay_t current;
+static detect_fsm_t fsm;
+
+static void log_append(replay_t *r, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void log_append(replay_t *r, const char *fmt, ...)
+{
+    size_t len = strlen(r->log);
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(r->log + len, sizeof(r->log) - len, fmt, args);
+    va_end(args);
+}
+
+static int64_t now_ms(void)
+{
+    return POSITION_MS(audio_capture_position());
+}
+
+static esp_mn_state_t replay_detect(void *ctx, int16_t *samples)
+{
+    replay_t *r = ctx;
+    int64_t now = now_ms();
+    if (r->trace.detected_ms && !r->detected && now >= r->trace.detected_ms) {
+        r->detected = true;
+        return ESP_MN_STATE_DETECTED;
+    }
+    return now >= r->timeout_ms ? ESP_MN_STATE_TIMEOUT : ESP_MN_STATE_DETECTING;
+}
+
+static esp_mn_results_t *replay_results(void *ctx)
+{
+    replay_t *r = ctx;
+    r->results = (esp_mn_results_t){ .state = ESP_MN_STATE_DETECTED };
+    if (r->detected) {
+        r->results.num = 1;
+        r->results.command_id[0] = r->trace.command_id;
+        r->results.prob[0] = 0.9f;
+    }
+    return &r->results;
+}
+
+static void replay_clean(void *ctx)
+{
+    replay_t *r = ctx;
+    r->timeout_ms = now_ms() + MULTINET_TIMEOUT_MS;
+}
+
+static void replay_enable_wakenet(void *ctx)
+{
+}
+
+static bool replay_run_command(void *ctx, esp_mn_results_t *results)
+{
+    replay_t *r = ctx;
+    r->commands_run++;
+    log_append(r, " %lldms:cmd%d", (long long)now_ms(), results->command_id[0]);
+    if (results->command_id[0] != LOCAL_COMMAND_ID) {
+        return false;
+    }
+    if (handler_mode == HANDLERS_INLINE) {
+        return local_intent.handler(&local_intent, results->command_id[0], results->string);
+    }
+    return action_executor_post(&local_intent, results->command_id[0], results->string) == ESP_OK;
+}
+
+// Take and release the clip as start_stt_fallback() and the STT task would
+static void replay_fallback(void *ctx, uint64_t start, uint64_t end)
+{
+    replay_t *r = ctx;
+    audio_clip_t *clip = audio_capture_clip(start, end);
+    size_t count = 0;
+    r->clip_ok = clip && audio_clip_samples(clip, &count) && count == end - start;
+    r->clip_samples = count;
+    if (clip) {
+        audio_clip_release(clip);
+    }
+    if (r->fallbacks++ == 0) {
+        r->fallback_start_ms = POSITION_MS(start);
+        r->fallback_end_ms = POSITION_MS(end);
+        r->fallback_at_ms = now_ms();
+    }
+    log_append(r, " %lldms:stt[%lld-%lld]", (long long)now_ms(),
+               (long long)POSITION_MS(start), (long long)POSITION_MS(end));
+}
+
+static void replay_transition(void *ctx, detect_event_t event, detect_state_t state)
+{
+    replay_t *r = ctx;
+    r->last_event = event;
+    r->state = state;
+    log_append(r, " %lldms:%s->%s", (long long)now_ms(), event_names[event],
+               state == DETECT_IDLE ? "IDLE" : "LISTENING");
+}
+
+static const detect_ops_t replay_ops = {
+    .ctx = &current,
+    .detect = replay_detect,
+    .get_results = replay_results,
+    .clean = replay_clean,
+    .enable_wakenet = replay_enable_wakenet,
+    .run_command = replay_run_command,
+    .fallback = replay_fallback,
+    .transition = replay_transition,
+};
+
+static bool read_trace(const char *path, trace_t *trace)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    memset(trace, 0, sizeof(*trace));
+    trace->kind = KIND_CLOUD;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        long long a, b;
+        int id;
+        char kind[16];
+        if (sscanf(line, "wake %lld", &a) == 1) {
+            trace->wake_ms = a;
+        } else if (sscanf(line, "detected %lld %d %15s", &a, &id, kind) == 3) {
+            trace->detected_ms = a;
+            trace->command_id = id;
+            trace->kind = strcmp(kind, "local") == 0 ? KIND_LOCAL : KIND_UNHANDLED;
+        } else if (sscanf(line, "speech %lld %lld", &a, &b) == 2) {
+            trace->speech_start_ms = a;
+            trace->speech_end_ms = b;
+        }
+    }
+    fclose(f);
+    return trace->wake_ms > 0 && trace->speech_end_ms > trace->speech_start_ms;
+}
+
+typedef struct {
+    int utterances;
+    int64_t audio_ms;
+    double cpu_ms;
+    int64_t max_step_us;
+    int local_commands;
+    size_t allocs;
+    int sent_to_stt;
+    int truncated;
+    int ended_by_endpointer;
+    int64_t saved_ms;           // Before the MultiNet timeout, summed over those
+} totals_t;
+
+static void replay_utterance(const char *name, const wav_t *wav, const trace_t *trace, totals_t *totals,
+                             bool print)
+{
+    replay_t *r = &current;
+    *r = (replay_t){ .trace = *trace, .timeout_ms = INT64_MAX, .state = fsm.state };
+    int64_t base_ms = now_ms();
+    r->trace.wake_ms += base_ms;
+    r->trace.detected_ms += trace->detected_ms ? base_ms : 0;
+    r->trace.speech_start_ms += base_ms;
+    r->trace.speech_end_ms += base_ms;
+
+    int16_t frame[FRAME_SAMPLES];
+    afe_fetch_result_t res = { .data = frame, .data_size = sizeof(frame), .raw_data_channels = 1 };
+    size_t allocs_before = alloc_calls;
+    clock_t cpu_start = clock();
+    for (size_t i = 0; i + FRAME_SAMPLES <= wav->count; i += FRAME_SAMPLES) {
+        memcpy(frame, &wav->samples[i], sizeof(frame));
+        int64_t frame_ms = now_ms();
+        int64_t frame_end_ms = POSITION_MS(audio_capture_position() + FRAME_SAMPLES);
+        res.wakeup_state = r->trace.wake_ms >= frame_ms && r->trace.wake_ms < frame_end_ms
+                           ? WAKENET_DETECTED : WAKENET_NO_DETECT;
+        int64_t start = esp_timer_get_time();
+        detect_fsm_step(&fsm, &res, FRAME_SAMPLES);
+        int64_t step_us = esp_timer_get_time() - start;
+        if (step_us > totals->max_step_us) {
+            totals->max_step_us = step_us;
+        }
+    }
+    double cpu_ms = (double)(clock() - cpu_start) * 1000.0 / CLOCKS_PER_SEC;
+    size_t allocs = alloc_calls - allocs_before;
+
+    totals->utterances++;
+    totals->audio_ms += (int64_t)wav->count * 1000 / CAPTURE_SAMPLE_RATE;
+    totals->cpu_ms += cpu_ms;
+    totals->allocs += allocs;
+    totals->local_commands += trace->kind == KIND_LOCAL;
+    if (print) {
+        printf("%s %-9s%s | %zu allocs\n", name, kind_names[trace->kind], r->log, allocs);
+    }
+
+    CHECK(allocs == 0, "%s: %zu allocations while replaying", name, allocs);
+    CHECK(r->state == DETECT_IDLE, "%s: still listening at the end of the file", name);
+    switch (trace->kind) {
+    case KIND_LOCAL:
+        CHECK(r->commands_run == 1, "%s: %d commands run", name, r->commands_run);
+        CHECK(r->fallbacks == 0, "%s: handled command sent to STT %d times", name, r->fallbacks);
+        return;
+    case KIND_UNHANDLED:
+        CHECK(r->commands_run == 1, "%s: %d commands run", name, r->commands_run);
+        break;
+    case KIND_CLOUD:
+        CHECK(r->commands_run == 0, "%s: %d commands run", name, r->commands_run);
+        CHECK(r->last_event == DETECT_EVENT_END_OF_SPEECH, "%s: ended by %s, not the endpointer",
+              name, event_names[r->last_event]);
+        if (r->last_event == DETECT_EVENT_END_OF_SPEECH) {
+            totals->ended_by_endpointer++;
+            totals->saved_ms += r->trace.wake_ms + MULTINET_TIMEOUT_MS - r->fallback_at_ms;
+        }
+        break;
+    }
+
+    CHECK(r->fallbacks == 1, "%s: sent to STT %d times", name, r->fallbacks);
+    CHECK(r->clip_ok, "%s: clip of %zu samples for the window", name, r->clip_samples);
+    bool whole = r->fallback_start_ms <= r->trace.speech_start_ms && r->fallback_end_ms >= r->trace.speech_end_ms;
+    CHECK(whole, "%s: STT window %lld-%lld ms cuts speech at %lld-%lld ms", name,
+          (long long)r->fallback_start_ms, (long long)r->fallback_end_ms,
+          (long long)r->trace.speech_start_ms, (long long)r->trace.speech_end_ms);
+    totals->sent_to_stt += r->fallbacks > 0;
+    totals->truncated += !whole;
+}
+
+// Utterances are seconds apart on the device, far longer than a handler;
+// replayed faster than real time, the queue has to be drained between files
+static void wait_for_handlers(int count)
+{
+    for (int waited = 0; atomic_load(&handlers_run) < count && waited < 1000; waited += 5) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+}
+
+static void replay_corpus(const char *dir, totals_t *totals, bool print)
+{
+    for (int i = 0; i < MAX_UTTERANCES; i++) {
+        char name[16], path[512];
+        snprintf(name, sizeof(name), "u%02d", i);
+        wav_t wav;
+        snprintf(path, sizeof(path), "%s/%s.wav", dir, name);
+        if (wav_read(path, &wav) != 0) {
+            break;
+        }
+        trace_t trace;
+        snprintf(path, sizeof(path), "%s/%s.txt", dir, name);
+        bool traced = read_trace(path, &trace);
+        CHECK(traced, "%s: no decision trace", name);
+        CHECK(wav.sample_rate == CAPTURE_SAMPLE_RATE, "%s: %u Hz", name, (unsigned)wav.sample_rate);
+        if (traced && wav.sample_rate == CAPTURE_SAMPLE_RATE) {
+            replay_utterance(name, &wav, &trace, totals, print);
+            if (handler_mode == HANDLERS_EXECUTOR) {
+                wait_for_handlers(totals->local_commands);
+            }
+        }
+        wav_free(&wav);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    esp_log_level_set("*", ESP_LOG_ERROR);    // Every handled command ends in a MultiNet timeout warning
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <corpus dir>\n", argv[0]);
+        return 2;
+    }
+
+    size_t init_allocs = alloc_calls;
+    CHECK(audio_capture_init() == ESP_OK, "capture ring not allocated");
+    init_allocs = alloc_calls - init_allocs;
+
+    CHECK(action_executor_init() == ESP_OK, "action executor not started");
+    detect_fsm_init(&fsm, &replay_ops);
+
+    totals_t inline_totals = {0};
+    handler_mode = HANDLERS_INLINE;
+    replay_corpus(argv[1], &inline_totals, false);
+
+    totals_t totals = {0};
+    handler_mode = HANDLERS_EXECUTOR;
+    atomic_store(&handlers_run, 0);
+    replay_corpus(argv[1], &totals, true);
+    CHECK(totals.utterances > 0, "no utterances in %s", argv[1]);
+    if (totals.utterances == 0) {
+        return host_test_result("test_detect_replay");
+    }
+    CHECK(atomic_load(&handlers_run) == totals.local_commands, "executor ran %d of %d handlers",
+          atomic_load(&handlers_run), totals.local_commands);
+    CHECK(inline_totals.max_step_us >= HANDLER_MS * 1000, "inline handler took %lld us",
+          (long long)inline_totals.max_step_us);
+    CHECK(totals.max_step_us < HANDLER_MS * 1000 / 2, "detect step of %lld us with handlers on the executor",
+          (long long)totals.max_step_us);
+
+    double speed = totals.cpu_ms > 0 ? totals.audio_ms / totals.cpu_ms : 0;
+    CHECK(speed > 1.0, "replay slower than real time (%.1fx)", speed);
+    printf("\n%d utterances, %.1f s of audio replayed in %.1f ms CPU (%.0fx real time)\n",
+           totals.utterances, totals.audio_ms / 1000.0, totals.cpu_ms, speed);
+    printf("slowest detect_fsm_step per %d ms frame, %d local commands, handler %d ms (1/100 scale):\n",
+           FRAME_SAMPLES * 1000 / CAPTURE_SAMPLE_RATE, totals.local_commands, HANDLER_MS);
+    printf("  handler inline (before):  %8.3f ms  (~%.1f s on device)\n",
+           inline_totals.max_step_us / 1000.0, inline_totals.max_step_us / 10000.0);
+    printf("  action executor (after):  %8.3f ms\n", totals.max_step_us / 1000.0);
+    printf("allocations: %zu at audio_capture_init, %zu while replaying\n", init_allocs, totals.allocs);
+    printf("sent to STT: %d utterances, %d with the command cut; %d ended by the endpointer, "
+           "mean %.2f s before the MultiNet timeout\n",
+           totals.sent_to_stt, totals.truncated, totals.ended_by_endpointer,
+           totals.ended_by_endpointer ? totals.saved_ms / 1000.0 / totals.ended_by_endpointer : 0.0);
+    return host_test_result("test_detect_replay");
+}
@@ -0,0 +1,197 @@
+/**
+ * @file test_flac_encoder.c
+ * @brief flac_encoder size and speed on the replay corpus and edge signals
+ *
+ * For each corpus utterance the 5.5 s the STT fallback would send (from
+ * 500 ms before the wake word) is encoded as stt_request_body() does, and
+ * the recognize body size is compared with base64 LINEAR16. Edge signals
+ * cover silence, full-scale noise, clipping and lengths around the block
+ * size. Every stream must fit flac_max_encoded_size() and come out the
+ * same whether the samples arrive at once or in uneven pieces.
+ *
+ * Usage: test_flac_encoder <corpus dir>   (uNN.wav/uNN.txt from gen_utterances.py)
+ */
+
+#include "flac_encoder.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host_test.h"
+#include "wav_reader.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SAMPLE_RATE         16000
+#define CLIP_SAMPLES        88000   // 5.5 s
+#define PRE_WAKE_SAMPLES    8000    // Clip starts 500 ms before the wake word
+#define MAX_UTTERANCES      100
+#define TIMING_MIN_US       200000  // Each clip is re-encoded for at least this long
+#define SPEECH_RATIO_MAX    0.75    // Mean FLAC / PCM size on the corpus
+#define STT_BODY_OVERHEAD   160     // JSON around the base64 audio
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+} sink_t;
+
+static esp_err_t sink_write(const uint8_t *data, size_t len, void *ctx)
+{
+    sink_t *sink = ctx;
+    if (len > sink->cap - sink->len) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(sink->buf + sink->len, data, len);
+    sink->len += len;
+    return ESP_OK;
+}
+
+// Encoded size, or 0 on error; chunked feeds pieces of 1..3000 samples
+static size_t encode(flac_encoder_t *enc, const int16_t *samples, size_t count, sink_t *sink, bool chunked)
+{
+    sink->len = 0;
+    esp_err_t err = flac_encoder_init(enc, SAMPLE_RATE, sink_write, sink);
+    for (size_t i = 0; i < count && err == ESP_OK;) {
+        size_t n = chunked ? 1 + (size_t)rand() % 3000 : count - i;
+        if (n > count - i) {
+            n = count - i;
+        }
+        err = flac_encoder_feed(enc, samples + i, n);
+        i += n;
+    }
+    if (err == ESP_OK) {
+        err = flac_encoder_finish(enc);
+    }
+    return err == ESP_OK ? sink->len : 0;
+}
+
+static size_t base64_len(size_t bytes)
+{
+    return ((bytes + 2) / 3) * 4;
+}
+
+typedef struct {
+    int clips;
+    double pcm;
+    double flac;
+    double body_linear16;
+    double body_flac;
+    double encode_us;
+    double audio_s;
+} totals_t;
+
+// Encode one signal, check it, and add it to the totals
+static void bench(flac_encoder_t *enc, const char *name, const int16_t *samples, size_t count, totals_t *totals)
+{
+    size_t bound = flac_max_encoded_size(count);
+    sink_t whole = { .buf = malloc(bound), .cap = bound };
+    sink_t chunked = { .buf = malloc(bound), .cap = bound };
+    size_t len = encode(enc, samples, count, &whole, false);
+    size_t chunked_len = encode(enc, samples, count, &chunked, true);
+    CHECK(len > 0, "%s: encoding failed or outgrew flac_max_encoded_size()", name);
+    CHECK(len == chunked_len && memcmp(whole.buf, chunked.buf, len) == 0,
+          "%s: %zu bytes fed at once, %zu in pieces", name, len, chunked_len);
+
+    int reps = 0;
+    int64_t start = esp_timer_get_time();
+    do {
+        encode(enc, samples, count, &whole, false);
+        reps++;
+    } while (esp_timer_get_time() - start < TIMING_MIN_US);
+    double us = (double)(esp_timer_get_time() - start) / reps;
+    double audio_s = (double)count / SAMPLE_RATE;
+
+    if (totals) {
+        totals->clips++;
+        totals->pcm += count * sizeof(int16_t);
+        totals->flac += len;
+        totals->body_linear16 += STT_BODY_OVERHEAD + base64_len(count * sizeof(int16_t));
+        totals->body_flac += STT_BODY_OVERHEAD + base64_len(len);
+        totals->encode_us += us;
+        totals->audio_s += audio_s;
+    } else {
+        printf("  %-22s %6zu samples  pcm %6zu B  flac %6zu B (bound %6zu)  ratio %5.3f  %4.0f us per s of audio\n",
+               name, count, count * sizeof(int16_t), len, bound, (double)len / (count * sizeof(int16_t)),
+               audio_s > 0 ? us / audio_s : 0);
+    }
+    free(whole.buf);
+    free(chunked.buf);
+}
+
+// Start of the clip the fallback would send: 500 ms before "wake <ms>"
+static size_t clip_start(const char *txt_path, size_t count)
+{
+    FILE *f = fopen(txt_path, "r");
+    unsigned wake_ms = 0;
+    if (!f) {
+        return 0;
+    }
+    if (fscanf(f, "wake %u", &wake_ms) != 1) {
+        wake_ms = 0;
+    }
+    fclose(f);
+    size_t wake = (size_t)wake_ms * (SAMPLE_RATE / 1000);
+    size_t start = wake > PRE_WAKE_SAMPLES ? wake - PRE_WAKE_SAMPLES : 0;
+    return start < count ? start : count;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <corpus dir>\n", argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    srand(50);
+    flac_encoder_t *enc = malloc(sizeof(flac_encoder_t));
+    printf("Encoder state %zu bytes\n", sizeof(flac_encoder_t));
+
+    printf("Edge signals:\n");
+    static int16_t signal[5 * FLAC_BLOCK_SIZE];
+    memset(signal, 0, sizeof(signal));
+    bench(enc, "silence, 1 s", signal, SAMPLE_RATE, NULL);
+    for (int i = 0; i < SAMPLE_RATE; i++) {
+        signal[i] = (int16_t)(rand() % 65536 - 32768);
+    }
+    bench(enc, "full-scale noise, 1 s", signal, SAMPLE_RATE, NULL);
+    for (int i = 0; i < SAMPLE_RATE; i++) {
+        double v = 40000 * sin(2 * M_PI * 440 * i / SAMPLE_RATE);
+        signal[i] = (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+    }
+    bench(enc, "clipped 440 Hz, 1 s", signal, SAMPLE_RATE, NULL);
+    const size_t lengths[] = { 1, 4, 17, 255, 256, 257, FLAC_BLOCK_SIZE - 1, FLAC_BLOCK_SIZE,
+                               FLAC_BLOCK_SIZE + 1, 2 * FLAC_BLOCK_SIZE + 100 };
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%zu samples", lengths[i]);
+        bench(enc, name, signal, lengths[i], NULL);
+    }
+
+    totals_t speech = {0};
+    for (int i = 0; i < MAX_UTTERANCES; i++) {
+        char path[512];
+        wav_t wav;
+        snprintf(path, sizeof(path), "%s/u%02d.wav", argv[1], i);
+        if (wav_read(path, &wav) != 0) {
+            break;
+        }
+        snprintf(path, sizeof(path), "%s/u%02d.txt", argv[1], i);
+        size_t start = clip_start(path, wav.count);
+        size_t count = wav.count - start < CLIP_SAMPLES ? wav.count - start : CLIP_SAMPLES;
+        snprintf(path, sizeof(path), "u%02d", i);
+        bench(enc, path, wav.samples + start, count, &speech);
+        wav_free(&wav);
+    }
+    CHECK(speech.clips > 0, "no utterances in %s", argv[1]);
+    if (speech.clips > 0) {
+        double ratio = speech.flac / speech.pcm;
+        printf("%d STT clips (%.1f s of audio): pcm %.0f B, flac %.0f B per clip, ratio %.3f; recognize body "
+               "%.0f B as base64 LINEAR16, %.0f B as base64 FLAC; encode %.0f us per s of audio\n",
+               speech.clips, speech.audio_s / speech.clips, speech.pcm / speech.clips, speech.flac / speech.clips,
+               ratio, speech.body_linear16 / speech.clips, speech.body_flac / speech.clips,
+               speech.encode_us / speech.audio_s);
+        CHECK(ratio < SPEECH_RATIO_MAX, "speech compresses to %.3f of PCM", ratio);
+    }
+    free(enc);
+    return host_test_result("test_flac_encoder");
+}
@@ -0,0 +1,222 @@
+/**
+ * @file test_http_hedge.c
+ * @brief Adaptive timeouts and TTS hedging (http_json.c) against injected latency
+ *
+ * cloud_standin.py answers each POST after a log-normal delay with a
+ * stalled tail (ctest passes --latency-ms, --jitter, --tail and a seed).
+ * Requests are made the way google_tts_speak makes them: the timeout from
+ * the latency tracker, http_post_json_streamed() with the audioContent
+ * reader, hedged after the p95. The same load runs with the fixed timeout,
+ * with adaptive timeouts and with hedging; p50/p95/max are printed.
+ *
+ * A first, scripted request checks what the tracker is fed: the primary's
+ * connection is held up, the hedge answers, and the loser's late answer
+ * must not reach the p95.
+ *
+ * Usage: test_http_hedge <stand-in URL>   (ctest starts the stand-in)
+ */
+
+#include "http_json.h"
+#include "latency_tracker.h"
+#include "metrics.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TTS_TIMEOUT_MS      15000   // naphome_test_suite.c
+#define REQUESTS            120     // Per run: enough to fill the p95 window
+#define TAIL_MS             1500    // Must match the stand-in's --tail
+#define SEED_LATENCY_MS     200     // Scripted request: p95 it starts from
+#define STALL_MS            1000    // Scripted request: primary's connection held up
+#define METRICS_TEXT_MAX    8192
+
+static const char *base_url;
+static metrics_metric_t *hedges_sent;
+static metrics_metric_t *hedges_won;
+
+// http_json.c reports every outcome; nothing here watches the network
+void connectivity_report(bool reachable)
+{
+}
+
+static void audio_cb(int path, const char *data, size_t len, bool done, void *ctx)
+{
+    *(size_t *)ctx += len;
+}
+
+// google_tts_speak's request path
+static int tts_request(latency_tracker_t *latency, bool hedge, size_t *audio_len)
+{
+    char url[256];
+    snprintf(url, sizeof(url), "%s/v1/text:synthesize?key=k", base_url);
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = latency_timeout_ms(latency, TTS_TIMEOUT_MS),
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) {
+        return -1;
+    }
+    esp_http_client_set_header(client, "Content-Type", "application/json");
+    static const char *const paths[] = {"audioContent"};
+    json_reader_t reader;
+    *audio_len = 0;
+    json_reader_init(&reader, paths, 1, audio_cb, audio_len);
+    http_hedge_config_t hedge_config = {
+        .client = &config,
+        .sent = hedges_sent,
+        .won = hedges_won,
+    };
+    const char *body = "{\"input\":{\"text\":\"hello\"}}";
+    int status = http_post_json_streamed(&client, body, strlen(body), &reader, false, latency,
+                                         hedge ? &hedge_config : NULL);
+    esp_http_client_cleanup(client);
+    return status;
+}
+
+// ---------------------------------------------------------------------------
+// Metrics
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char text[METRICS_TEXT_MAX];
+    size_t len;
+} capture_t;
+
+static esp_err_t capture_flush(const char *data, size_t len, void *ctx)
+{
+    capture_t *c = ctx;
+    if (c->len + len >= sizeof(c->text)) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(c->text + c->len, data, len);
+    c->len += len;
+    c->text[c->len] = '\0';
+    return ESP_OK;
+}
+
+static double metric_value(const char *series)
+{
+    static capture_t c;
+    static char buf[1024];
+    c.len = 0;
+    c.text[0] = '\0';
+    if (metrics_write_prometheus(buf, sizeof(buf), capture_flush, &c) != ESP_OK) {
+        return -1;
+    }
+    size_t len = strlen(series);
+    for (const char *line = c.text; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+        if (strncmp(line, series, len) == 0 && line[len] == ' ') {
+            return strtod(line + len + 1, NULL);
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Runs
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    double p50_ms;
+    double p95_ms;
+    double max_ms;
+    double mean_ms;
+    int failed;
+    double hedges;
+    double won;
+    uint32_t tracker_p95_ms;
+} run_t;
+
+static int compare_ms(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static run_t run(const char *name, latency_tracker_t *latency, bool hedge)
+{
+    static double ms[REQUESTS];
+    run_t r = {0};
+    double sent_before = metric_value("naphome_tts_hedge_total{result=\"sent\"}");
+    double won_before = metric_value("naphome_tts_hedge_total{result=\"won\"}");
+    double sum = 0;
+    for (int i = 0; i < REQUESTS; i++) {
+        size_t audio_len;
+        int64_t start = esp_timer_get_time();
+        int status = tts_request(latency, hedge, &audio_len);
+        ms[i] = (esp_timer_get_time() - start) / 1000.0;
+        sum += ms[i];
+        if (status != 200 || audio_len == 0) {
+            r.failed++;
+        }
+    }
+    qsort(ms, REQUESTS, sizeof(ms[0]), compare_ms);
+    r.p50_ms = ms[REQUESTS / 2];
+    r.p95_ms = ms[(REQUESTS * 95) / 100];
+    r.max_ms = ms[REQUESTS - 1];
+    r.mean_ms = sum / REQUESTS;
+    r.hedges = metric_value("naphome_tts_hedge_total{result=\"sent\"}") - sent_before;
+    r.won = metric_value("naphome_tts_hedge_total{result=\"won\"}") - won_before;
+    r.tracker_p95_ms = latency_p95_ms(latency);
+    printf("  %-20s p50 %5.0f  p95 %5.0f  max %5.0f  mean %5.0f ms  failed %d  hedges %.0f (won %.0f)  "
+           "tracker p95 %lu ms\n",
+           name, r.p50_ms, r.p95_ms, r.max_ms, r.mean_ms, r.failed, r.hedges, r.won,
+           (unsigned long)r.tracker_p95_ms);
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <cloud stand-in URL>\n", argv[0]);
+        return 2;
+    }
+    base_url = argv[1];
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    signal(SIGPIPE, SIG_IGN);
+    hedges_sent = metrics_counter("naphome_tts_hedge_total", "result=\"sent\"", "Hedges sent");
+    hedges_won = metrics_counter("naphome_tts_hedge_total", "result=\"won\"", "Hedges that answered first");
+
+    // Scripted: the primary is stuck connecting, the hedge answers, the primary answers late
+    latency_tracker_t *scripted = latency_tracker_create("scripted", NULL);
+    for (int i = 0; i < LATENCY_MIN_SAMPLES; i++) {
+        latency_record(scripted, SEED_LATENCY_MS);
+    }
+    host_http_client_delay_next_connect_ms(STALL_MS);
+    size_t audio_len;
+    int64_t start = esp_timer_get_time();
+    int status = tts_request(scripted, true, &audio_len);
+    double scripted_ms = (esp_timer_get_time() - start) / 1000.0;
+    vTaskDelay(pdMS_TO_TICKS(STALL_MS + TAIL_MS));  // The loser finishes
+    uint32_t scripted_p95 = latency_p95_ms(scripted);
+    printf("Hedged request, primary connection held up %d ms: %.0f ms, tracker p95 %lu ms after the loser "
+           "answered\n", STALL_MS, scripted_ms, (unsigned long)scripted_p95);
+    CHECK(status == 200 && audio_len > 0, "scripted request: status %d", status);
+    CHECK(metric_value("naphome_tts_hedge_total{result=\"won\"}") == 1, "the hedge did not win");
+    CHECK(scripted_ms < STALL_MS, "scripted request took %.0f ms", scripted_ms);
+    CHECK(scripted_p95 == SEED_LATENCY_MS, "tracker p95 %lu ms: the losing attempt was recorded",
+          (unsigned long)scripted_p95);
+
+    printf("%d TTS requests per run against the injected latency:\n", REQUESTS);
+    run_t fixed = run("fixed 15 s timeout", NULL, false);
+    run_t adaptive = run("adaptive timeout", latency_tracker_create("adaptive", NULL), false);
+    run_t hedged = run("adaptive + hedging", latency_tracker_create("hedged", NULL), true);
+
+    CHECK(fixed.failed == 0 && adaptive.failed == 0 && hedged.failed == 0, "failed %d / %d / %d", fixed.failed,
+          adaptive.failed, hedged.failed);
+    CHECK(fixed.max_ms > TAIL_MS, "no request hit the tail: the injection is not working");
+    CHECK(hedged.hedges > 0 && hedged.won > 0, "%.0f hedges, %.0f won", hedged.hedges, hedged.won);
+    CHECK(hedged.max_ms < TAIL_MS, "hedged max %.0f ms: a stall was waited out", hedged.max_ms);
+    // Only the answers that were used are recorded: hedged stalls stay out of the p95
+    CHECK(hedged.tracker_p95_ms < TAIL_MS, "hedged tracker p95 %lu ms", (unsigned long)hedged.tracker_p95_ms);
+    return host_test_result("test_http_hedge");
+}
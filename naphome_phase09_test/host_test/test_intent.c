@@ -0,0 +1,454 @@
+/**
+ * @file test_intent.c
+ * @brief intent_table_match() against the if/else cascade it replaced
+ *
+ * The cascade speech_commands_action_with_string() ran before the intent
+ * table is kept here as the reference, with its command ID tests read from
+ * a binding set. Every phrase in intents/phrases.txt is matched with every
+ * command ID from -1 to 39, with and without its text, by the cascade and
+ * by the table built from local_intents[], under two bindings:
+ *   - the IDs the table shipped with, listed on each definition, colours
+ *     before volume and TV, so IDs 5-10 select the colours as they did in
+ *     the cascade, and
+ *   - the IDs the firmware binds now from commands.yaml through the command
+ *     registry, which puts 5-10 on volume and TV.
+ * Then the time per match of the cascade and of the table.
+ */
+
+#include "intent.h"
+#include "local_intents.h"
+#include "command_registry.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host_test.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PHRASES     64
+#define MIN_ID          -1
+#define MAX_ID          39
+#define TIMING_MIN_US   200000
+#define TIMING_RUNS     5       // Best of
+
+// ---------------------------------------------------------------------------
+// The cascade
+// ---------------------------------------------------------------------------
+
+// Command IDs (bit n = ID n) each of the cascade's ID tests accepts
+typedef struct {
+    uint64_t demo, lights_on, lights_off;
+    uint64_t color_red, color_green, color_blue, color_white, color_yellow, color_orange, color_purple, color_cyan;
+    uint64_t volume_highest, volume_lowest, volume_up, volume_down;
+    uint64_t tv_on, tv_off, ac_on, ac_off;
+} id_set_t;
+
+#define BIT(id) (1ull << (id))
+
+// The cascade's own `command_id == n` tests
+static const id_set_t legacy_ids = {
+    .demo = BIT(0) | BIT(32) | BIT(33),
+    .lights_on = BIT(13) | BIT(17),
+    .lights_off = BIT(14) | BIT(18),
+    .color_red = BIT(15),
+    .color_green = BIT(16),
+    .color_blue = BIT(5),
+    .color_white = BIT(6),
+    .color_yellow = BIT(7),
+    .color_orange = BIT(8),
+    .color_purple = BIT(9),
+    .color_cyan = BIT(10),
+    .volume_highest = BIT(5),
+    .volume_lowest = BIT(6),
+    .volume_up = BIT(7),
+    .volume_down = BIT(8),
+    .tv_on = BIT(9),
+    .tv_off = BIT(10),
+    .ac_on = BIT(19),
+    .ac_off = BIT(20),
+};
+
+// Intent name -> its id_set_t field
+static const struct {
+    const char *intent;
+    size_t offset;
+} id_fields[] = {
+#define ID_FIELD(name) { #name, offsetof(id_set_t, name) }
+    ID_FIELD(demo), ID_FIELD(lights_on), ID_FIELD(lights_off),
+    ID_FIELD(color_red), ID_FIELD(color_green), ID_FIELD(color_blue), ID_FIELD(color_white),
+    ID_FIELD(color_yellow), ID_FIELD(color_orange), ID_FIELD(color_purple), ID_FIELD(color_cyan),
+    ID_FIELD(volume_highest), ID_FIELD(volume_lowest), ID_FIELD(volume_up), ID_FIELD(volume_down),
+    ID_FIELD(tv_on), ID_FIELD(tv_off), ID_FIELD(ac_on), ID_FIELD(ac_off),
+#undef ID_FIELD
+};
+
+static uint64_t *id_field(id_set_t *ids, const char *intent)
+{
+    for (size_t i = 0; i < sizeof(id_fields) / sizeof(id_fields[0]); i++) {
+        if (strcmp(id_fields[i].intent, intent) == 0) {
+            return (uint64_t *)((char *)ids + id_fields[i].offset);
+        }
+    }
+    return NULL;
+}
+
+// As it was: lowercases at most 63 characters of each
+static bool string_contains(const char *str, const char *substr)
+{
+    if (!str || !substr) return false;
+    char str_lower[64], substr_lower[64];
+    int i = 0;
+    while (str[i] && i < 63) {
+        str_lower[i] = (str[i] >= 'A' && str[i] <= 'Z') ? str[i] + 32 : str[i];
+        i++;
+    }
+    str_lower[i] = '\0';
+    i = 0;
+    while (substr[i] && i < 63) {
+        substr_lower[i] = (substr[i] >= 'A' && substr[i] <= 'Z') ? substr[i] + 32 : substr[i];
+        i++;
+    }
+    substr_lower[i] = '\0';
+    return strstr(str_lower, substr_lower) != NULL;
+}
+
+#define ID(name) (command_id >= 0 && command_id < 64 && (ids->name & BIT(command_id)))
+
+// speech_commands_action_with_string() before the intent table, block for
+// block, returning the intent each block became instead of running it
+static const char *cascade_match(const id_set_t *ids, int command_id, const char *command_string)
+{
+    if (ID(demo) || (command_string && string_contains(command_string, "demo"))) {
+        return "demo";
+    }
+    if (command_string && string_contains(command_string, "playing") && string_contains(command_string, "wav")) {
+        return "play_wav";
+    }
+    if (command_string && string_contains(command_string, "playing") && string_contains(command_string, "mp3")) {
+        return "play_mp3";
+    }
+    if (ID(lights_on) ||
+        (command_string && string_contains(command_string, "turn on") && string_contains(command_string, "light"))) {
+        return "lights_on";
+    }
+    if (ID(lights_off) ||
+        (command_string && string_contains(command_string, "turn off") && string_contains(command_string, "light"))) {
+        return "lights_off";
+    }
+    if (ID(color_red) || (command_string && string_contains(command_string, "red"))) {
+        return "color_red";
+    } else if (ID(color_green) || (command_string && string_contains(command_string, "green"))) {
+        return "color_green";
+    } else if (ID(color_blue) || (command_string && string_contains(command_string, "blue"))) {
+        return "color_blue";
+    } else if (ID(color_white) || (command_string && string_contains(command_string, "white"))) {
+        return "color_white";
+    } else if (ID(color_yellow) || (command_string && string_contains(command_string, "yellow"))) {
+        return "color_yellow";
+    } else if (ID(color_orange) || (command_string && string_contains(command_string, "orange"))) {
+        return "color_orange";
+    } else if (ID(color_purple) || (command_string && string_contains(command_string, "purple"))) {
+        return "color_purple";
+    } else if (ID(color_cyan) || (command_string && string_contains(command_string, "cyan"))) {
+        return "color_cyan";
+    }
+    if (ID(volume_highest) || (command_string && string_contains(command_string, "highest") &&
+                               string_contains(command_string, "volume"))) {
+        return "volume_highest";
+    } else if (ID(volume_lowest) || (command_string && string_contains(command_string, "lowest") &&
+                                     string_contains(command_string, "volume"))) {
+        return "volume_lowest";
+    } else if (ID(volume_up) || (command_string && string_contains(command_string, "increase") &&
+                                 string_contains(command_string, "volume"))) {
+        return "volume_up";
+    } else if (ID(volume_down) || (command_string && string_contains(command_string, "decrease") &&
+                                   string_contains(command_string, "volume"))) {
+        return "volume_down";
+    }
+    if (command_string && (string_contains(command_string, "play") || string_contains(command_string, "start")) &&
+        (string_contains(command_string, "music") || string_contains(command_string, "background") ||
+         string_contains(command_string, "audio"))) {
+        return "background_audio_start";
+    }
+    if (command_string && (string_contains(command_string, "stop") || string_contains(command_string, "pause")) &&
+        (string_contains(command_string, "music") || string_contains(command_string, "background") ||
+         string_contains(command_string, "audio"))) {
+        return "background_audio_stop";
+    }
+    if (ID(tv_on) || (command_string && string_contains(command_string, "turn on") &&
+                      string_contains(command_string, "tv"))) {
+        return "tv_on";
+    } else if (ID(tv_off) || (command_string && string_contains(command_string, "turn off") &&
+                              string_contains(command_string, "tv"))) {
+        return "tv_off";
+    }
+    if (ID(ac_on) || (command_string && string_contains(command_string, "turn on") &&
+                      string_contains(command_string, "air conditioner"))) {
+        return "ac_on";
+    } else if (ID(ac_off) || (command_string && string_contains(command_string, "turn off") &&
+                              string_contains(command_string, "air conditioner"))) {
+        return "ac_off";
+    }
+    if (command_string && (string_contains(command_string, "what") || string_contains(command_string, "tell me")) &&
+        string_contains(command_string, "temperature")) {
+        return "temperature";
+    }
+    if (command_string && (string_contains(command_string, "what") || string_contains(command_string, "tell me")) &&
+        string_contains(command_string, "humidity")) {
+        return "humidity";
+    }
+    if (command_string && (string_contains(command_string, "what") || string_contains(command_string, "tell me")) &&
+        (string_contains(command_string, "air quality") || string_contains(command_string, "voc"))) {
+        return "air_quality";
+    }
+    if (command_string && (string_contains(command_string, "what") || string_contains(command_string, "tell me")) &&
+        string_contains(command_string, "co2")) {
+        return "co2";
+    }
+    if (command_string && (string_contains(command_string, "what") || string_contains(command_string, "tell me")) &&
+        (string_contains(command_string, "light level") || string_contains(command_string, "brightness"))) {
+        return "light_level";
+    }
+    if (command_string && (string_contains(command_string, "what") || string_contains(command_string, "tell me")) &&
+        string_contains(command_string, "weather")) {
+        return "weather";
+    }
+    if (command_string && string_contains(command_string, "read sensors")) {
+        return "read_sensors";
+    }
+    if (command_string && string_contains(command_string, "publish telemetry")) {
+        return "publish_telemetry";
+    }
+    if (command_string && (string_contains(command_string, "play") && string_contains(command_string, "music"))) {
+        return "music_play";
+    }
+    if (command_string && (string_contains(command_string, "stop") && string_contains(command_string, "music"))) {
+        return "music_stop";
+    }
+    if (command_string && (string_contains(command_string, "pause") && string_contains(command_string, "music"))) {
+        return "music_pause";
+    }
+    if (command_string && (string_contains(command_string, "next") && string_contains(command_string, "song"))) {
+        return "next_song";
+    }
+    if (command_string && (string_contains(command_string, "previous") && string_contains(command_string, "song"))) {
+        return "previous_song";
+    }
+    if (command_string && string_contains(command_string, "test audio")) {
+        return "test_audio";
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Corpus and tables
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char expected[32];      // The cascade's text-only pick, "-" for none
+    char text[64];
+} phrase_t;
+
+static phrase_t phrases[MAX_PHRASES];
+static size_t phrase_count;
+
+static bool load_phrases(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), f) && phrase_count < MAX_PHRASES) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *tab = strchr(line, '\t');
+        if (line[0] == '#' || !tab) {
+            continue;
+        }
+        *tab = '\0';
+        phrase_t *p = &phrases[phrase_count++];
+        snprintf(p->expected, sizeof(p->expected), "%.31s", line);
+        snprintf(p->text, sizeof(p->text), "%s", tab + 1);
+        CHECK(strlen(tab + 1) < sizeof(p->text), "'%s' is longer than the cascade read", tab + 1);
+    }
+    fclose(f);
+    return phrase_count > 0;
+}
+
+// local_intents[] with IDs listed on the definitions, as the table shipped
+static intent_def_t listed_defs[INTENT_MAX_INTENTS];
+
+static esp_err_t build_listed(intent_table_t **table, const id_set_t *ids)
+{
+    for (size_t i = 0; i < local_intents_count; i++) {
+        listed_defs[i] = local_intents[i];
+        uint64_t *field = id_field((id_set_t *)ids, local_intents[i].name);
+        for (int id = 0; field && id < 64; id++) {
+            if ((*field & BIT(id)) && listed_defs[i].num_ids < INTENT_MAX_IDS) {
+                listed_defs[i].ids[listed_defs[i].num_ids++] = id;
+            }
+        }
+    }
+    return intent_table_build(table, listed_defs, local_intents_count);
+}
+
+typedef struct {
+    intent_table_t *table;
+    id_set_t *ids;
+} registry_ctx_t;
+
+// What local_intents_bind_commands() does, and the same binding as cascade ID tests
+static void bind_entry(const command_entry_t *entry, void *arg)
+{
+    registry_ctx_t *ctx = arg;
+    if (!entry->intent) {
+        return;
+    }
+    CHECK(intent_table_set_id(ctx->table, entry->id, entry->intent) == ESP_OK,
+          "command %u: no local intent '%s'", entry->id, entry->intent);
+    uint64_t *field = id_field(ctx->ids, entry->intent);
+    CHECK(field, "command %u: intent '%s' has no ID test in the cascade", entry->id, entry->intent);
+    if (field && entry->id < 64) {
+        *field |= BIT(entry->id);
+    }
+}
+
+static const char *name_of(const intent_def_t *intent)
+{
+    return intent ? intent->name : NULL;
+}
+
+static bool same(const char *a, const char *b)
+{
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+// Every phrase x every ID, with and without its text
+static size_t compare(const char *label, const intent_table_t *table, const id_set_t *ids)
+{
+    size_t cases = 0;
+    size_t mismatches = 0;
+    for (size_t p = 0; p < phrase_count; p++) {
+        for (int id = MIN_ID; id <= MAX_ID; id++) {
+            for (int with_text = 0; with_text < 2; with_text++) {
+                const char *text = with_text ? phrases[p].text : NULL;
+                const char *want = cascade_match(ids, id, text);
+                const char *got = name_of(intent_table_match(table, id, text));
+                cases++;
+                if (!same(want, got)) {
+                    mismatches++;
+                    CHECK(same(want, got), "%s: id %d '%s': cascade %s, table %s", label, id,
+                          text ? text : "(null)", want ? want : "-", got ? got : "-");
+                }
+            }
+        }
+    }
+    printf("  %-10s %zu cases, %zu differ from the cascade\n", label, cases, mismatches);
+    return cases;
+}
+
+// ---------------------------------------------------------------------------
+// Timing
+// ---------------------------------------------------------------------------
+
+static volatile uintptr_t sink;
+
+static double cascade_ns(const id_set_t *ids)
+{
+    double best = 0;
+    for (int run = 0; run < TIMING_RUNS; run++) {
+        size_t calls = 0;
+        int64_t start = esp_timer_get_time();
+        do {
+            for (size_t p = 0; p < phrase_count; p++) {
+                for (int id = MIN_ID; id <= MAX_ID; id++) {
+                    sink ^= (uintptr_t)cascade_match(ids, id, phrases[p].text);
+                    sink ^= (uintptr_t)cascade_match(ids, id, NULL);
+                    calls += 2;
+                }
+            }
+        } while (esp_timer_get_time() - start < TIMING_MIN_US);
+        double ns = (esp_timer_get_time() - start) * 1000.0 / calls;
+        if (run == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+static double table_ns(const intent_table_t *table)
+{
+    double best = 0;
+    for (int run = 0; run < TIMING_RUNS; run++) {
+        size_t calls = 0;
+        int64_t start = esp_timer_get_time();
+        do {
+            for (size_t p = 0; p < phrase_count; p++) {
+                for (int id = MIN_ID; id <= MAX_ID; id++) {
+                    sink ^= (uintptr_t)intent_table_match(table, id, phrases[p].text);
+                    sink ^= (uintptr_t)intent_table_match(table, id, NULL);
+                    calls += 2;
+                }
+            }
+        } while (esp_timer_get_time() - start < TIMING_MIN_US);
+        double ns = (esp_timer_get_time() - start) * 1000.0 / calls;
+        if (run == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <phrases.txt>\n", argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+    CHECK(load_phrases(argv[1]), "no phrases in %s", argv[1]);
+
+    // The corpus says what the cascade picked for each text alone
+    for (size_t p = 0; p < phrase_count; p++) {
+        const char *want = strcmp(phrases[p].expected, "-") == 0 ? NULL : phrases[p].expected;
+        const char *got = cascade_match(&legacy_ids, -1, phrases[p].text);
+        CHECK(same(want, got), "'%s': corpus says %s, cascade %s", phrases[p].text, phrases[p].expected,
+              got ? got : "-");
+    }
+
+    intent_table_t *listed = NULL;
+    CHECK(build_listed(&listed, &legacy_ids) == ESP_OK, "table with listed IDs did not build");
+    intent_table_t *registry = NULL;
+    CHECK(intent_table_build(&registry, local_intents, local_intents_count) == ESP_OK, "table did not build");
+    CHECK(command_registry_init() == ESP_OK, "command registry did not load");
+    id_set_t registry_ids = { 0 };
+    registry_ctx_t ctx = { registry, &registry_ids };
+    command_registry_foreach(bind_entry, &ctx);
+    if (!listed || !registry) {
+        return host_test_result("test_intent");
+    }
+
+    printf("%zu phrases x command IDs %d..%d, with and without text:\n", phrase_count, MIN_ID, MAX_ID);
+    compare("listed", listed, &legacy_ids);
+    compare("registry", registry, &registry_ids);
+
+    // The one deliberate difference: IDs 5-10 leave the colours
+    CHECK(same(name_of(intent_table_match(listed, 5, NULL)), "color_blue"), "listed ID 5 not on blue");
+    CHECK(same(name_of(intent_table_match(listed, 10, NULL)), "color_cyan"), "listed ID 10 not on cyan");
+    CHECK(same(name_of(intent_table_match(registry, 5, NULL)), "volume_highest"), "registry ID 5 not on volume");
+    CHECK(same(name_of(intent_table_match(registry, 10, NULL)), "tv_off"), "registry ID 10 not on the TV");
+    // An earlier intent's keywords still beat an ID
+    CHECK(same(name_of(intent_table_match(registry, 5, "turn on the light")), "lights_on"),
+          "ID 5 won over an earlier keyword match");
+
+    double cascade = cascade_ns(&legacy_ids);
+    double table = table_ns(listed);
+    printf("  cascade %6.0f ns/match\n", cascade);
+    printf("  table   %6.0f ns/match  (%.1fx)\n", table, cascade / table);
+    CHECK(table < cascade, "table %.0f ns, cascade %.0f ns", table, cascade);
+
+    intent_table_free(listed);
+    intent_table_free(registry);
+    return host_test_result("test_intent");
+}
@@ -0,0 +1,203 @@
+/**
+ * @file test_intent_classify.c
+ * @brief Which STT transcripts intent_table_classify() keeps off the LLM
+ *
+ * Every transcript in intents/transcripts.txt is classified against
+ * local_intents[] with local_synonyms[] and routed as
+ * speech_commands_action_with_transcript() routes it: local when the best
+ * intent scores INTENT_FUZZY_THRESHOLD or more, the LLM otherwise. Each
+ * route must match the corpus; the share of transcripts still sent to the
+ * LLM is printed (before the classifier, all of them were).
+ *
+ * Targeted cases then pin down what the routes depend on: the threshold
+ * (it must lie in the range that routes the whole corpus right), stopwords,
+ * the synonym list (a table without it loses transcripts) and the edit
+ * distance allowed for STT misspellings by word length.
+ */
+
+#include "intent.h"
+#include "local_intents.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host_test.h"
+#include <string.h>
+
+#define MAX_TRANSCRIPTS 128
+#define TIMING_MIN_US   200000
+
+typedef struct {
+    char expected[32];      // Intent name, or "llm"
+    char text[96];
+} transcript_t;
+
+static transcript_t transcripts[MAX_TRANSCRIPTS];
+static size_t transcript_count;
+
+static bool load_transcripts(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    char line[160];
+    while (fgets(line, sizeof(line), f) && transcript_count < MAX_TRANSCRIPTS) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *tab = strchr(line, '\t');
+        if (line[0] == '#' || !tab) {
+            continue;
+        }
+        *tab = '\0';
+        transcript_t *t = &transcripts[transcript_count++];
+        snprintf(t->expected, sizeof(t->expected), "%.31s", line);
+        snprintf(t->text, sizeof(t->text), "%.95s", tab + 1);
+    }
+    fclose(f);
+    return transcript_count > 0;
+}
+
+// speech_commands_action_with_transcript()'s decision: the intent, or NULL for the LLM
+static const char *route(const intent_table_t *table, const char *text, float *confidence)
+{
+    const intent_def_t *intent = intent_table_classify(table, text, confidence);
+    return intent && *confidence >= INTENT_FUZZY_THRESHOLD ? intent->name : NULL;
+}
+
+static bool routed_to(const intent_table_t *table, const char *text, const char *want)
+{
+    float confidence;
+    const char *got = route(table, text, &confidence);
+    bool ok = want ? got && strcmp(got, want) == 0 : got == NULL;
+    CHECK(ok, "'%s': want %s, got %s (%.2f)", text, want ? want : "llm", got ? got : "llm", confidence);
+    return ok;
+}
+
+static void check_corpus(const intent_table_t *table)
+{
+    static float confidence[MAX_TRANSCRIPTS];
+    static bool intent_right[MAX_TRANSCRIPTS];  // Best intent is the expected one
+    size_t llm = 0;
+    for (size_t i = 0; i < transcript_count; i++) {
+        const transcript_t *t = &transcripts[i];
+        bool want_llm = strcmp(t->expected, "llm") == 0;
+        routed_to(table, t->text, want_llm ? NULL : t->expected);
+        const intent_def_t *intent = intent_table_classify(table, t->text, &confidence[i]);
+        intent_right[i] = !want_llm && intent && strcmp(intent->name, t->expected) == 0;
+        llm += want_llm;
+    }
+    printf("%zu transcripts: %zu answered locally, %zu sent to the LLM\n", transcript_count,
+           transcript_count - llm, llm);
+    printf("  LLM calls %.0f%% of transcripts (100%% without the classifier, %.0f%% fewer)\n",
+           100.0 * llm / transcript_count, 100.0 * (transcript_count - llm) / transcript_count);
+
+    // The thresholds that route the whole corpus right must include INTENT_FUZZY_THRESHOLD
+    int lowest = -1, highest = -1;
+    for (int percent = 50; percent <= 100; percent++) {
+        size_t wrong = 0;
+        for (size_t i = 0; i < transcript_count; i++) {
+            bool local = confidence[i] >= percent / 100.0f;
+            bool want_local = strcmp(transcripts[i].expected, "llm") != 0;
+            wrong += local != want_local || (local && !intent_right[i]);
+        }
+        if (wrong == 0) {
+            lowest = lowest < 0 ? percent : lowest;
+            highest = percent;
+        }
+    }
+    CHECK(lowest >= 0 && lowest / 100.0f <= INTENT_FUZZY_THRESHOLD && INTENT_FUZZY_THRESHOLD <= highest / 100.0f,
+          "threshold %.2f outside %.2f-%.2f", INTENT_FUZZY_THRESHOLD, lowest / 100.0f, highest / 100.0f);
+    printf("  every route right for thresholds %.2f-%.2f (INTENT_FUZZY_THRESHOLD %.2f)\n", lowest / 100.0f,
+           highest / 100.0f, INTENT_FUZZY_THRESHOLD);
+}
+
+// Filler words must not count against a match, and alone must match nothing
+static void check_stopwords(const intent_table_t *table)
+{
+    float confidence;
+    routed_to(table, "could you please tell me the humidity right now", "humidity");
+    CHECK(intent_table_classify(table, "is it the", &confidence) == NULL, "stopwords alone matched");
+    CHECK(intent_table_classify(table, "", &confidence) == NULL, "empty transcript matched");
+}
+
+// Transcripts that only route locally through local_synonyms[]
+static void check_synonyms(const intent_table_t *table)
+{
+    static const char *const needs_synonyms[] = {
+        "how hot is it", "skip this track", "turn on the ac", "turn on the lamp", "make it quieter",
+    };
+    intent_table_t *bare = NULL;
+    CHECK(intent_table_build(&bare, local_intents, local_intents_count) == ESP_OK, "table did not build");
+    if (!bare) {
+        return;
+    }
+    for (size_t i = 0; i < sizeof(needs_synonyms) / sizeof(needs_synonyms[0]); i++) {
+        float with, without;
+        CHECK(route(table, needs_synonyms[i], &with) != NULL, "'%s' not local with synonyms", needs_synonyms[i]);
+        CHECK(route(bare, needs_synonyms[i], &without) == NULL, "'%s' local without synonyms (%.2f)",
+              needs_synonyms[i], without);
+    }
+    size_t lost = 0;
+    for (size_t i = 0; i < transcript_count; i++) {
+        float confidence;
+        if (strcmp(transcripts[i].expected, "llm") != 0 && !route(bare, transcripts[i].text, &confidence)) {
+            lost++;
+        }
+    }
+    printf("  without synonyms %zu of those local transcripts would go to the LLM\n", lost);
+    intent_table_free(bare);
+}
+
+// One edit allowed in words of 4-6 letters, two from 7; none below 4
+static void check_edit_distance(const intent_table_t *table)
+{
+    float confidence;
+    routed_to(table, "what is the humidty", "humidity");        // 7 letters, 1 edit
+    routed_to(table, "what is the temprture", "temperature");   // 9 letters, 2 edits
+    routed_to(table, "what is the wether", "weather");          // 6 letters, 1 edit
+    routed_to(table, "what is the wethr", NULL);                // 5 letters, 2 edits
+    routed_to(table, "what is the hmdty", NULL);                // 5 letters, 3 edits
+    routed_to(table, "what is the co3", NULL);                  // 3 letters: exact only
+    // A near miss scores below an exact word
+    float exact;
+    intent_table_classify(table, "what is the humidity", &exact);
+    intent_table_classify(table, "what is the humidty", &confidence);
+    CHECK(confidence < exact, "misspelling scored %.2f, the word itself %.2f", confidence, exact);
+}
+
+static void bench(const intent_table_t *table)
+{
+    size_t calls = 0;
+    int64_t start = esp_timer_get_time();
+    do {
+        for (size_t i = 0; i < transcript_count; i++) {
+            float confidence;
+            intent_table_classify(table, transcripts[i].text, &confidence);
+            calls++;
+        }
+    } while (esp_timer_get_time() - start < TIMING_MIN_US);
+    printf("  %.1f us per transcript\n", (esp_timer_get_time() - start) / (double)calls);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <transcripts.txt>\n", argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+    CHECK(load_transcripts(argv[1]), "no transcripts in %s", argv[1]);
+
+    intent_table_t *table = NULL;
+    CHECK(intent_table_build(&table, local_intents, local_intents_count) == ESP_OK, "table did not build");
+    if (!table) {
+        return host_test_result("test_intent_classify");
+    }
+    intent_table_set_synonyms(table, local_synonyms, local_synonyms_count);
+
+    check_corpus(table);
+    check_stopwords(table);
+    check_synonyms(table);
+    check_edit_distance(table);
+    bench(table);
+    intent_table_free(table);
+    return host_test_result("test_intent_classify");
+}
@@ -0,0 +1,523 @@
+/**
+ * @file test_json_reader.c
+ * @brief json_reader on Google STT, Gemini and TTS responses, and cost against cJSON
+ *
+ * Each response in host_test/responses/ is fed through the reader with the
+ * path the firmware asks for, whole, split at every byte offset, one byte
+ * at a time and cut short at every offset. The extracted string must match
+ * the known-good value in <name>.txt (no .txt: the path is absent) however
+ * the body is split, and a cut-short body must never report a complete
+ * value it did not receive. Hand-written documents cover what the
+ * responses do not: broken surrogate pairs, scalar or missing values on
+ * the path, long keys, nesting past the limit and malformed JSON.
+ *
+ * Then ns per response and heap use against cJSON_Parse plus the same
+ * lookup, with malloc wrapped to count allocations (cJSON as for
+ * test_telemetry; without it only the reader is timed).
+ *
+ * Usage: test_json_reader <responses dir>
+ */
+
+#include "json_reader.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host_test.h"
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CJSON
+#include "cJSON.h"
+#endif
+
+#define MAX_RESPONSE        16384
+#define HTTP_CHUNK          512     // http_json.c reads the body in pieces this size
+#define TIMING_MIN_US       200000  // Each response is parsed for at least this long
+
+#define PATH_LLM    "candidates[0].content.parts[0].text"
+#define PATH_STT    "results[0].alternatives[0].transcript"
+#define PATH_TTS    "audioContent"
+
+typedef struct {
+    const char *name;
+    const char *path;       // What naphome_test_suite.c extracts from this API
+} response_t;
+
+static const response_t responses[] = {
+    {"gemini_weather", PATH_LLM},
+    {"gemini_escaped_unicode", PATH_LLM},
+    {"gemini_two_candidates", PATH_LLM},
+    {"gemini_empty_candidates", PATH_LLM},
+    {"gemini_blocked", PATH_LLM},
+    {"gemini_finish_safety", PATH_LLM},
+    {"gemini_error", PATH_LLM},
+    {"stt_recognize", PATH_STT},
+    {"stt_two_results", PATH_STT},
+    {"stt_no_speech", PATH_STT},
+    {"tts_synthesize", PATH_TTS},
+};
+#define NUM_RESPONSES (sizeof(responses) / sizeof(responses[0]))
+
+// ---------------------------------------------------------------------------
+// Allocation counting
+// ---------------------------------------------------------------------------
+
+static size_t alloc_calls;
+static size_t heap_live;
+static size_t heap_peak;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static void heap_grow(void *p)
+{
+    if (p) {
+        heap_live += malloc_usable_size(p);
+        if (heap_live > heap_peak) {
+            heap_peak = heap_live;
+        }
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    alloc_calls++;
+    void *p = __real_malloc(size);
+    heap_grow(p);
+    return p;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    alloc_calls++;
+    void *p = __real_calloc(n, size);
+    heap_grow(p);
+    return p;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    alloc_calls++;
+    if (ptr) {
+        heap_live -= malloc_usable_size(ptr);
+    }
+    void *p = __real_realloc(ptr, size);
+    heap_grow(p ? p : ptr);
+    return p;
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr) {
+        heap_live -= malloc_usable_size(ptr);
+    }
+    __real_free(ptr);
+}
+
+static void heap_reset(void)
+{
+    alloc_calls = 0;
+    heap_peak = heap_live;
+}
+
+// ---------------------------------------------------------------------------
+// Extraction
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char text[MAX_RESPONSE];
+    size_t len;
+    int path;               // Path of the last piece
+    int done;               // Values completed
+    size_t max_piece;
+} value_t;
+
+static void value_cb(int path, const char *data, size_t len, bool done, void *ctx)
+{
+    value_t *v = ctx;
+    if (v->len + len < sizeof(v->text)) {
+        memcpy(v->text + v->len, data, len);
+        v->len += len;
+        v->text[v->len] = '\0';
+    }
+    if (len > v->max_piece) {
+        v->max_piece = len;
+    }
+    v->path = path;
+    if (done) {
+        v->done++;
+    }
+}
+
+typedef struct {
+    esp_err_t feed;
+    esp_err_t finish;
+} result_t;
+
+// Feed data in pieces: cut (if nonzero) is the first piece's length, then
+// step bytes at a time; stop after limit bytes
+static result_t extract(const char *path, const char *data, size_t len, size_t cut, size_t step, size_t limit,
+                        value_t *v)
+{
+    memset(v, 0, sizeof(*v));
+    json_reader_t r;
+    const char *paths[] = {path};
+    json_reader_init(&r, paths, 1, value_cb, v);
+    result_t res = {ESP_OK, ESP_OK};
+    size_t end = limit < len ? limit : len;
+    for (size_t i = 0; i < end && res.feed == ESP_OK;) {
+        size_t n = (i == 0 && cut) ? cut : step;
+        if (n > end - i) {
+            n = end - i;
+        }
+        res.feed = json_reader_feed(&r, data + i, n);
+        i += n;
+    }
+    res.finish = json_reader_finish(&r);
+    return res;
+}
+
+static char *read_file(const char *dir, const char *name, const char *ext, size_t *len)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s%s", dir, name, ext);
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    char *data = malloc(MAX_RESPONSE);
+    *len = fread(data, 1, MAX_RESPONSE - 1, f);
+    data[*len] = '\0';
+    fclose(f);
+    return data;
+}
+
+static bool only_whitespace(const char *s, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] != ' ' && s[i] != '\n' && s[i] != '\r' && s[i] != '\t') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void check_response(const char *dir, const response_t *resp)
+{
+    size_t len, expected_len = 0;
+    char *body = read_file(dir, resp->name, ".json", &len);
+    char *expected = read_file(dir, resp->name, ".txt", &expected_len);
+    CHECK(body != NULL, "%s/%s.json missing", dir, resp->name);
+    if (!body) {
+        free(expected);
+        return;
+    }
+    static value_t v;
+
+    // Whole body, as one read
+    result_t res = extract(resp->path, body, len, 0, len, len, &v);
+    CHECK(res.feed == ESP_OK && res.finish == ESP_OK, "%s: %s / %s", resp->name, esp_err_to_name(res.feed),
+          esp_err_to_name(res.finish));
+    if (expected) {
+        CHECK(v.done == 1 && v.len == expected_len && memcmp(v.text, expected, expected_len) == 0,
+              "%s: %s extracted as '%s'", resp->name, resp->path, v.text);
+        CHECK(v.max_piece <= JSON_READER_CHUNK, "%s: %zu-byte piece", resp->name, v.max_piece);
+    } else {
+        CHECK(v.done == 0 && v.len == 0, "%s: %s found ('%s') in a response without it", resp->name, resp->path,
+              v.text);
+    }
+    printf("  %-24s %5zu bytes  %s\n", resp->name, len, expected ? "value extracted" : "path absent, no value");
+
+    // Split in two at every offset, and one byte at a time
+    int bad_splits = 0;
+    for (size_t cut = 1; cut <= len; cut++) {
+        res = extract(resp->path, body, len, cut, len, len, &v);
+        bool ok = res.feed == ESP_OK && res.finish == ESP_OK &&
+                  (expected ? v.done == 1 && v.len == expected_len && memcmp(v.text, expected, expected_len) == 0
+                            : v.done == 0 && v.len == 0);
+        if (!ok && bad_splits++ < 3) {
+            fprintf(stderr, "  %s split at %zu: '%s'\n", resp->name, cut, v.text);
+        }
+    }
+    CHECK(bad_splits == 0, "%s: %d of %zu splits changed the result", resp->name, bad_splits, len);
+    res = extract(resp->path, body, len, 0, 1, len, &v);
+    CHECK(res.feed == ESP_OK && res.finish == ESP_OK && v.done == (expected ? 1 : 0) &&
+          (!expected || memcmp(v.text, expected, expected_len) == 0),
+          "%s: byte-at-a-time gave '%s'", resp->name, v.text);
+
+    // Cut short at every offset: never complete, never a value that was not sent
+    int bad_truncations = 0;
+    for (size_t limit = 0; limit < len; limit++) {
+        res = extract(resp->path, body, len, 0, HTTP_CHUNK, limit, &v);
+        bool closed = only_whitespace(body + limit, len - limit);
+        bool ok = res.feed == ESP_OK && (res.finish == ESP_OK) == closed &&
+                  (expected ? v.len <= expected_len && memcmp(v.text, expected, v.len) == 0 &&
+                              (!v.done || v.len == expected_len)
+                            : v.len == 0 && v.done == 0);
+        if (!ok && bad_truncations++ < 3) {
+            fprintf(stderr, "  %s cut at %zu: finish %s, %d done, '%s'\n", resp->name, limit,
+                    esp_err_to_name(res.finish), v.done, v.text);
+        }
+    }
+    CHECK(bad_truncations == 0, "%s: %d truncated bodies misreported", resp->name, bad_truncations);
+    free(body);
+    free(expected);
+}
+
+// ---------------------------------------------------------------------------
+// Hand-written documents
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const char *doc;
+    const char *path;
+    esp_err_t feed;         // Expected from feeding the whole document
+    const char *value;      // Expected value, NULL if none
+} case_t;
+
+static const case_t cases[] = {
+    // Surrogates: a pair, a high one followed by text, by another high one,
+    // at the end of the string, and a lone low one; broken ones become U+FFFD
+    {"{\"t\":\"\\ud83d\\ude80\"}", "t", ESP_OK, "\xf0\x9f\x9a\x80"},
+    {"{\"t\":\"\\ud83dx\"}", "t", ESP_OK, "\xef\xbf\xbdx"},
+    {"{\"t\":\"\\ud83d\\ud83d\\ude80\"}", "t", ESP_OK, "\xef\xbf\xbd\xf0\x9f\x9a\x80"},
+    {"{\"t\":\"a\\ud83d\"}", "t", ESP_OK, "a\xef\xbf\xbd"},
+    {"{\"t\":\"\\ude80b\"}", "t", ESP_OK, "\xef\xbf\xbd" "b"},
+    {"{\"t\":\"\\ud83d\\n\"}", "t", ESP_OK, "\xef\xbf\xbd\n"},
+    {"{\"t\":\"\\u00e9\\u20AC\\u0041\"}", "t", ESP_OK, "\xc3\xa9\xe2\x82\xac" "A"},
+    // Escaped quotes and backslashes around the key and value
+    {"{\"te\\\"xt\":\"no\",\"text\":\"say \\\"hi\\\" \\\\o/\"}", "text", ESP_OK, "say \"hi\" \\o/"},
+    {"{\"text\\\\\":\"no\"}", "text", ESP_OK, NULL},
+    // The path leads somewhere that is not a string, or nowhere
+    {"{\"candidates\":[{\"content\":{\"parts\":[{\"text\":42}]}}]}", PATH_LLM, ESP_OK, NULL},
+    {"{\"candidates\":[{\"content\":{\"parts\":[{\"text\":null}]}}]}", PATH_LLM, ESP_OK, NULL},
+    {"{\"candidates\":[\"text\"]}", PATH_LLM, ESP_OK, NULL},
+    {"{\"candidates\":{\"content\":{\"parts\":[{\"text\":\"x\"}]}}}", PATH_LLM, ESP_OK, NULL},
+    {"{\"candidates\":[{\"content\":{\"parts\":{\"text\":\"x\"}}}]}", PATH_LLM, ESP_OK, NULL},
+    {"{\"candidates\":[{\"text\":\"x\",\"content\":{\"text\":\"y\",\"parts\":[[],{\"text\":\"z\"}]}}]}",
+     PATH_LLM, ESP_OK, NULL},
+    {"{\"candidates\":[{},{\"content\":{\"parts\":[{\"text\":\"second\"}]}}]}", PATH_LLM, ESP_OK, NULL},
+    {"{\"candidates\":[{\"content\":{\"parts\":[{\"text\":\"a\"}]},\"x\":[1,2.5e-3,true,false,null]}]}",
+     PATH_LLM, ESP_OK, "a"},
+    {"[{\"text\":\"top-level array\"}]", "[0].text", ESP_OK, "top-level array"},
+    // Keys: prefixes and extensions do not match, overlong keys are skipped
+    {"{\"tex\":\"a\",\"textual\":\"b\",\"text\":\"c\"}", "text", ESP_OK, "c"},
+    {"{\"a_key_longer_than_the_32_byte_key_buffer\":\"x\",\"text\":\"y\"}", "text", ESP_OK, "y"},
+    // Malformed documents fail the feed
+    {"{\"text\":\"a\",}", "text", ESP_ERR_INVALID_RESPONSE, "a"},
+    {"{\"text\" \"a\"}", "text", ESP_ERR_INVALID_RESPONSE, NULL},
+    {"{\"text\":\"a\nb\"}", "text", ESP_ERR_INVALID_RESPONSE, NULL},
+    {"{\"text\":\"\\x\"}", "text", ESP_ERR_INVALID_RESPONSE, NULL},
+    {"{\"text\":\"\\u12g4\"}", "text", ESP_ERR_INVALID_RESPONSE, NULL},
+    {"{\"text\":\"a\"]", "text", ESP_ERR_INVALID_RESPONSE, "a"},
+    {"{\"text\":\"a\"} {}", "text", ESP_ERR_INVALID_RESPONSE, "a"},
+    {"{text:\"a\"}", "text", ESP_ERR_INVALID_RESPONSE, NULL},
+    {"[[[[[[[[[[[[[[[[[\"deep\"]]]]]]]]]]]]]]]]]", "[0]", ESP_ERR_INVALID_RESPONSE, NULL},
+};
+#define NUM_CASES (sizeof(cases) / sizeof(cases[0]))
+
+static void check_cases(void)
+{
+    static value_t v;
+    for (size_t i = 0; i < NUM_CASES; i++) {
+        const case_t *c = &cases[i];
+        size_t len = strlen(c->doc);
+        for (size_t cut = 0; cut <= len; cut++) {
+            result_t res = extract(c->path, c->doc, len, cut, len, len, &v);
+            bool ok = res.feed == c->feed && (c->feed != ESP_OK || res.finish == ESP_OK) &&
+                      (c->value ? v.done == 1 && strcmp(v.text, c->value) == 0 : v.done == 0 && v.len == 0);
+            if (!ok) {
+                CHECK(ok, "%s at %s, split at %zu: %s, %d done, '%s'", c->doc, c->path, cut,
+                      esp_err_to_name(res.feed), v.done, v.text);
+                break;
+            }
+        }
+    }
+}
+
+static void check_paths(const char *dir)
+{
+    static const char *const bad[] = {"", ".text", "a[", "a[x]", "a[1", "a..b", "a.b.c.d.e.f.g.h.i",
+                                      "key_of_thirty_three_bytes_long_xx"};
+    const char *const good[] = {"candidates[0].content.parts[0].text", "[3][4]", "a.b.c.d.e.f.g.h"};
+    json_reader_t r;
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        CHECK(json_reader_init(&r, &bad[i], 1, value_cb, NULL) == ESP_ERR_INVALID_ARG, "path '%s' accepted",
+              bad[i]);
+    }
+    for (size_t i = 0; i < sizeof(good) / sizeof(good[0]); i++) {
+        CHECK(json_reader_init(&r, &good[i], 1, value_cb, NULL) == ESP_OK, "path '%s' rejected", good[i]);
+    }
+    const char *five[] = {"a", "b", "c", "d", "e"};
+    CHECK(json_reader_init(&r, five, 5, value_cb, NULL) == ESP_ERR_INVALID_ARG, "5 paths accepted");
+
+    // Several paths at once report which one each value belongs to
+    size_t len;
+    char *body = read_file(dir, "gemini_two_candidates", ".json", &len);
+    if (!body) {
+        return;
+    }
+    static const char *const paths[] = {"modelVersion", "candidates[1].content.parts[0].text",
+                                        "candidates[0].finishReason", "candidates[0].content.parts[1].text"};
+    static const char *const expected[] = {"gemini-2.0-flash", "Second candidate.", "STOP",
+                                           "Second part, which the firmware does not read."};
+    char values[4][128] = {{0}};
+    json_reader_t reader;
+    static value_t v;
+    memset(&v, 0, sizeof(v));
+    json_reader_init(&reader, paths, 4, value_cb, &v);
+    // Feed in pieces small enough that every value spans several
+    for (size_t i = 0; i < len; i += 7) {
+        size_t before = v.len;
+        json_reader_feed(&reader, body + i, len - i < 7 ? len - i : 7);
+        if (v.len > before) {
+            strncat(values[v.path], v.text + before, v.len - before);
+        }
+    }
+    CHECK(json_reader_finish(&reader) == ESP_OK && v.done == 4, "%d of 4 values", v.done);
+    for (int p = 0; p < 4; p++) {
+        CHECK(strcmp(values[p], expected[p]) == 0, "%s: '%s'", paths[p], values[p]);
+    }
+    free(body);
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    double ns;
+    double allocs;
+    size_t peak;
+} cost_t;
+
+static void discard_cb(int path, const char *data, size_t len, bool done, void *ctx)
+{
+    *(size_t *)ctx += len;
+}
+
+static cost_t bench_reader(const char *path, const char *body, size_t len)
+{
+    cost_t cost = {0};
+    int reps = 0;
+    size_t sink = 0;
+    heap_reset();
+    size_t base = heap_live;
+    int64_t start = esp_timer_get_time();
+    do {
+        json_reader_t r;
+        const char *paths[] = {path};
+        json_reader_init(&r, paths, 1, discard_cb, &sink);
+        for (size_t i = 0; i < len; i += HTTP_CHUNK) {
+            json_reader_feed(&r, body + i, len - i < HTTP_CHUNK ? len - i : HTTP_CHUNK);
+        }
+        json_reader_finish(&r);
+        reps++;
+    } while (esp_timer_get_time() - start < TIMING_MIN_US);
+    cost.ns = (esp_timer_get_time() - start) * 1000.0 / reps;
+    cost.allocs = (double)alloc_calls / reps;
+    cost.peak = heap_peak - base;
+    return cost;
+}
+
+#ifdef HAVE_CJSON
+// Walk "a[0].b"-style paths as the firmware did with cJSON_GetObjectItem
+static const cJSON *cjson_lookup(const cJSON *node, const char *path)
+{
+    char key[64];
+    while (node && *path) {
+        if (*path == '[') {
+            int index = (int)strtol(path + 1, (char **)&path, 10);
+            path++;  // ']'
+            node = cJSON_GetArrayItem(node, index);
+        } else {
+            if (*path == '.') {
+                path++;
+            }
+            size_t n = strcspn(path, ".[");
+            snprintf(key, sizeof(key), "%.*s", (int)n, path);
+            path += n;
+            node = cJSON_GetObjectItem(node, key);
+        }
+    }
+    return node;
+}
+
+// What the handlers did before: the whole body in one buffer, then a tree
+static cost_t bench_cjson(const char *path, const char *body, size_t len)
+{
+    cost_t cost = {0};
+    int reps = 0;
+    size_t found = 0;
+    heap_reset();
+    size_t base = heap_live;
+    int64_t start = esp_timer_get_time();
+    do {
+        char *buf = malloc(len + 1);
+        memcpy(buf, body, len + 1);
+        cJSON *root = cJSON_Parse(buf);
+        const cJSON *value = cjson_lookup(root, path);
+        if (cJSON_IsString(value)) {
+            found += strlen(value->valuestring);
+        }
+        cJSON_Delete(root);
+        free(buf);
+        reps++;
+    } while (esp_timer_get_time() - start < TIMING_MIN_US);
+    cost.ns = (esp_timer_get_time() - start) * 1000.0 / reps;
+    cost.allocs = (double)alloc_calls / reps;
+    cost.peak = heap_peak - base;
+    return cost;
+}
+#endif
+
+static void bench(const char *dir)
+{
+    printf("Per response, %d-byte reads (json_reader, state on the stack: %zu bytes) vs the body buffered "
+           "for cJSON_Parse:\n", HTTP_CHUNK, sizeof(json_reader_t));
+    for (size_t i = 0; i < NUM_RESPONSES; i++) {
+        const response_t *resp = &responses[i];
+        if (strcmp(resp->name, "gemini_weather") != 0 && strcmp(resp->name, "stt_recognize") != 0 &&
+            strcmp(resp->name, "tts_synthesize") != 0) {
+            continue;
+        }
+        size_t len;
+        char *body = read_file(dir, resp->name, ".json", &len);
+        if (!body) {
+            continue;
+        }
+        cost_t reader = bench_reader(resp->path, body, len);
+        printf("  %-16s %5zu bytes  json_reader %8.0f ns  %4.1f allocations  peak heap %6zu bytes\n", resp->name,
+               len, reader.ns, reader.allocs, reader.peak);
+        CHECK(reader.allocs == 0 && reader.peak == 0, "%s: json_reader allocated %.1f times", resp->name,
+              reader.allocs);
+#ifdef HAVE_CJSON
+        cost_t cjson = bench_cjson(resp->path, body, len);
+        printf("  %-16s %5s        cJSON       %8.0f ns  %4.1f allocations  peak heap %6zu bytes\n", "", "",
+               cjson.ns, cjson.allocs, cjson.peak);
+#endif
+        free(body);
+    }
+#ifndef HAVE_CJSON
+    printf("  (cJSON not found: set IDF_PATH or CJSON_DIR for the baseline)\n");
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <responses dir>\n", argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    printf("Responses, whole, split at every offset, byte by byte and cut short at every offset:\n");
+    for (size_t i = 0; i < NUM_RESPONSES; i++) {
+        check_response(argv[1], &responses[i]);
+    }
+    check_cases();
+    check_paths(argv[1]);
+    bench(argv[1]);
+    return host_test_result("test_json_reader");
+}
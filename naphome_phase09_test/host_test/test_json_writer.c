@@ -0,0 +1,748 @@
+/**
+ * @file test_json_writer.c
+ * @brief json_writer output, error handling, and cost against cJSON
+ *
+ * Checks escaping, separators, the nesting limit, overflow of a fixed
+ * buffer and flushing through buffers of every size from 1 byte up. Then
+ * renders the two documents json_writer replaced cJSON for - /api/status
+ * as web_server.c writes it, and Test 12's per-sample telemetry snapshot -
+ * and reports ns, allocations and peak heap per document. malloc and free
+ * are wrapped, so the writer's zero allocations are counted, not assumed.
+ * cJSON comes from ESP-IDF's json component; without it only the writer is
+ * timed.
+ */
+
+#include "json_writer.h"
+#include "json_reader.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host_test.h"
+#include <malloc.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CJSON
+#include "cJSON.h"
+#endif
+
+#define CHUNK_SIZE          512     // web_server.c JSON_CHUNK_SIZE
+#define MAX_DOC             8192
+#define STATUS_TASKS        24      // A busy device's task list
+#define STATUS_TESTS        12      // web_server.c MAX_TESTS
+#define TIMING_MIN_US       200000  // Each document is rendered for at least this long
+
+// ---------------------------------------------------------------------------
+// Allocation counting
+// ---------------------------------------------------------------------------
+
+static size_t alloc_calls;
+static size_t heap_live;
+static size_t heap_peak;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static void heap_grow(void *p)
+{
+    if (p) {
+        heap_live += malloc_usable_size(p);
+        if (heap_live > heap_peak) {
+            heap_peak = heap_live;
+        }
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    alloc_calls++;
+    void *p = __real_malloc(size);
+    heap_grow(p);
+    return p;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    alloc_calls++;
+    void *p = __real_calloc(n, size);
+    heap_grow(p);
+    return p;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    alloc_calls++;
+    if (ptr) {
+        heap_live -= malloc_usable_size(ptr);
+    }
+    void *p = __real_realloc(ptr, size);
+    heap_grow(p ? p : ptr);
+    return p;
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr) {
+        heap_live -= malloc_usable_size(ptr);
+    }
+    __real_free(ptr);
+}
+
+static void heap_reset(void)
+{
+    alloc_calls = 0;
+    heap_peak = heap_live;
+}
+
+// ---------------------------------------------------------------------------
+// Output capture
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char text[MAX_DOC];
+    size_t len;
+    size_t flushes;
+    size_t short_flushes;   // Flushes smaller than the buffer
+    size_t cap;
+    int fail_at;            // Flush number that returns an error, 0: never
+} capture_t;
+
+static esp_err_t capture_flush(const char *data, size_t len, void *ctx)
+{
+    capture_t *c = ctx;
+    c->flushes++;
+    if (c->fail_at && (int)c->flushes == c->fail_at) {
+        return ESP_FAIL;
+    }
+    if (len < c->cap) {
+        c->short_flushes++;
+    }
+    if (c->len + len < sizeof(c->text)) {
+        memcpy(c->text + c->len, data, len);
+        c->len += len;
+        c->text[c->len] = '\0';
+    }
+    return ESP_OK;
+}
+
+// Like an HTTP chunk sender, minus the socket
+static esp_err_t discard_flush(const char *data, size_t len, void *ctx)
+{
+    *(size_t *)ctx += len;
+    return ESP_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Documents
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t free, total, largest_free_block, min_free;
+} heap_caps_t;
+
+typedef struct {
+    char name[16];
+    const char *state;
+    uint32_t priority;
+    uint32_t stack_high_water;
+    int core_id;
+    double cpu_percent;
+} status_task_t;
+
+typedef struct {
+    uint32_t cores, revision, cpu_freq_mhz, uptime_seconds;
+    uint32_t free_heap, total_heap, largest_free_block, min_free_heap, psram_free, psram_total;
+    heap_caps_t internal, spiram, dma;
+    status_task_t tasks[STATUS_TASKS];
+    double core_usage[2];
+    uint32_t interval_ms;
+    uint32_t timestamp;
+    double temperature_c, humidity_rh, lux, co2_ppm;
+    uint32_t tvoc_ppb, eco2_ppm;
+    struct {
+        const char *name;
+        int status;
+    } tests[STATUS_TESTS];
+} status_t;
+
+static const char *const test_names[STATUS_TESTS] = {
+    "ESP32-S3 System Initialization", "SHT30 Temperature/Humidity Sensor", "SGP30 VOC Sensor",
+    "BH1750 Light Sensor", "SCD30 CO2 Sensor", "PCA9685 RGB LED Control", "WiFi Connectivity",
+    "AWS IoT Core MQTT Connectivity", "ESP-SR Wake Word Detection", "IR Blaster Functionality",
+    "Audio Output System (TPA3116D2)", "Sensor Telemetry Publishing",
+};
+
+// What the dashboard sees mid-session: every section filled in
+static void status_init(status_t *s)
+{
+    static const char *const task_names[] = {
+        "IDLE0", "IDLE1", "detect", "feed", "afe_fetch", "stt_llm_tts", "httpd", "web_server", "mqtt_task",
+        "telemetry", "task_stats", "led_render", "action_exec", "event_bus", "esp_timer", "wifi", "tiT",
+        "sys_evt", "ipc0", "ipc1", "audio_play", "breaker", "prewarm", "Tmr Svc",
+    };
+    static const char *const states[] = {"Running", "Ready", "Blocked", "Suspended"};
+    memset(s, 0, sizeof(*s));
+    s->cores = 2;
+    s->revision = 2;
+    s->cpu_freq_mhz = 240;
+    s->uptime_seconds = 86417;
+    s->free_heap = 142312;
+    s->total_heap = 327680;
+    s->largest_free_block = 65536;
+    s->min_free_heap = 98304;
+    s->psram_free = 7012352;
+    s->psram_total = 8388608;
+    s->internal = (heap_caps_t){142312, 327680, 65536, 98304};
+    s->spiram = (heap_caps_t){7012352, 8388608, 6815744, 6291456};
+    s->dma = (heap_caps_t){120832, 262144, 61440, 90112};
+    for (int i = 0; i < STATUS_TASKS; i++) {
+        status_task_t *t = &s->tasks[i];
+        snprintf(t->name, sizeof(t->name), "%s", task_names[i]);
+        t->state = states[i % 4];
+        t->priority = (i * 7) % 24;
+        t->stack_high_water = 512 + i * 97;
+        t->core_id = i % 3 == 2 ? -1 : i % 2;
+        t->cpu_percent = 40.0 / (i + 1);
+    }
+    s->core_usage[0] = 37.4;
+    s->core_usage[1] = 12.9;
+    s->interval_ms = 2000;
+    s->timestamp = 1760781600;
+    s->temperature_c = 21.53;
+    s->humidity_rh = 44.18;
+    s->tvoc_ppb = 38;
+    s->eco2_ppm = 431;
+    s->lux = 182.5;
+    s->co2_ppm = 612.0;
+    for (int i = 0; i < STATUS_TESTS; i++) {
+        s->tests[i].name = test_names[i];
+        s->tests[i].status = i < 9 ? i % 3 : 3;
+    }
+}
+
+static void write_heap_caps(json_writer_t *w, const heap_caps_t *h)
+{
+    json_writer_object_begin(w);
+    json_kv_uint(w, "free", h->free);
+    json_kv_uint(w, "total", h->total);
+    json_kv_uint(w, "largest_free_block", h->largest_free_block);
+    json_kv_uint(w, "min_free", h->min_free);
+    json_writer_object_end(w);
+}
+
+// web_server.c api_status_handler: write_status_sections(STATUS_SECTION_ALL)
+static void write_status(json_writer_t *w, const status_t *s)
+{
+    json_writer_object_begin(w);
+    json_kv_object(w, "system");
+    json_kv_string(w, "chip_model", "ESP32-S3");
+    json_kv_uint(w, "cores", s->cores);
+    json_kv_uint(w, "revision", s->revision);
+    json_kv_uint(w, "cpu_freq_mhz", s->cpu_freq_mhz);
+    json_kv_uint(w, "uptime_seconds", s->uptime_seconds);
+    json_writer_object_end(w);
+
+    json_kv_object(w, "memory");
+    json_kv_uint(w, "free_heap", s->free_heap);
+    json_kv_uint(w, "total_heap", s->total_heap);
+    json_kv_uint(w, "largest_free_block", s->largest_free_block);
+    json_kv_uint(w, "min_free_heap", s->min_free_heap);
+    json_kv_uint(w, "psram_free", s->psram_free);
+    json_kv_uint(w, "psram_total", s->psram_total);
+    json_key(w, "internal");
+    write_heap_caps(w, &s->internal);
+    json_key(w, "spiram");
+    write_heap_caps(w, &s->spiram);
+    json_key(w, "dma");
+    write_heap_caps(w, &s->dma);
+    json_writer_object_end(w);
+
+    json_kv_array(w, "tasks");
+    for (int i = 0; i < STATUS_TASKS; i++) {
+        const status_task_t *t = &s->tasks[i];
+        json_writer_object_begin(w);
+        json_kv_string(w, "name", t->name);
+        json_kv_string(w, "state", t->state);
+        json_kv_uint(w, "priority", t->priority);
+        json_kv_uint(w, "stack_high_water", t->stack_high_water);
+        json_kv_int(w, "core_id", t->core_id);
+        json_kv_double(w, "cpu_percent", t->cpu_percent, 1);
+        json_writer_object_end(w);
+    }
+    json_writer_array_end(w);
+
+    json_kv_object(w, "cpu");
+    json_kv_bool(w, "valid", true);
+    json_kv_double(w, "core0_usage", s->core_usage[0], 1);
+    json_kv_double(w, "core1_usage", s->core_usage[1], 1);
+    json_kv_uint(w, "interval_ms", s->interval_ms);
+    json_kv_uint(w, "total_tasks", STATUS_TASKS);
+    json_writer_object_end(w);
+
+    json_kv_object(w, "sensors");
+    json_kv_uint(w, "timestamp", s->timestamp);
+    json_kv_double(w, "temperature_c", s->temperature_c, 2);
+    json_kv_double(w, "humidity_rh", s->humidity_rh, 2);
+    json_kv_uint(w, "tvoc_ppb", s->tvoc_ppb);
+    json_kv_uint(w, "eco2_ppm", s->eco2_ppm);
+    json_kv_double(w, "lux", s->lux, 1);
+    json_kv_double(w, "co2_ppm", s->co2_ppm, 1);
+    json_writer_object_end(w);
+
+    json_kv_array(w, "tests");
+    for (int i = 0; i < STATUS_TESTS; i++) {
+        json_writer_object_begin(w);
+        json_kv_int(w, "test_num", i + 1);
+        json_kv_string(w, "name", s->tests[i].name);
+        json_kv_int(w, "status", s->tests[i].status);
+        json_writer_object_end(w);
+    }
+    json_writer_array_end(w);
+    json_writer_object_end(w);
+}
+
+typedef struct {
+    uint32_t timestamp;
+    double temperature_c, humidity_rh, lux, co2_ppm, scd30_temperature_c, scd30_humidity_rh;
+    uint32_t tvoc_ppb, eco2_ppm;
+} snapshot_t;
+
+static const snapshot_t snapshot = {1760781600, 21.53, 44.18, 182.5, 612.0, 22.1, 43.6, 38, 431};
+
+// Test 12's per-sample snapshot, compact
+static void write_snapshot(json_writer_t *w, const snapshot_t *s)
+{
+    char timestamp[16];
+    snprintf(timestamp, sizeof(timestamp), "%lu", (unsigned long)s->timestamp);
+    json_writer_object_begin(w);
+    json_kv_string(w, "timestamp", timestamp);
+    json_kv_string(w, "device_id", "naphome-0.9");
+    json_kv_object(w, "sht30");
+    json_kv_double(w, "temperature_c", s->temperature_c, 2);
+    json_kv_double(w, "humidity_rh", s->humidity_rh, 2);
+    json_kv_bool(w, "hardware_present", true);
+    json_writer_object_end(w);
+    json_kv_object(w, "sgp30");
+    json_kv_uint(w, "tvoc_ppb", s->tvoc_ppb);
+    json_kv_uint(w, "eco2_ppm", s->eco2_ppm);
+    json_kv_bool(w, "hardware_present", true);
+    json_writer_object_end(w);
+    json_kv_object(w, "bh1750");
+    json_kv_double(w, "lux", s->lux, 1);
+    json_kv_bool(w, "hardware_present", true);
+    json_writer_object_end(w);
+    json_kv_object(w, "scd30");
+    json_kv_double(w, "co2_ppm", s->co2_ppm, 1);
+    json_kv_double(w, "temperature_c", s->scd30_temperature_c, 2);
+    json_kv_double(w, "humidity_rh", s->scd30_humidity_rh, 2);
+    json_kv_bool(w, "hardware_present", true);
+    json_writer_object_end(w);
+    json_writer_object_end(w);
+}
+
+#ifdef HAVE_CJSON
+static cJSON *cjson_heap_caps(const heap_caps_t *h)
+{
+    cJSON *o = cJSON_CreateObject();
+    cJSON_AddNumberToObject(o, "free", h->free);
+    cJSON_AddNumberToObject(o, "total", h->total);
+    cJSON_AddNumberToObject(o, "largest_free_block", h->largest_free_block);
+    cJSON_AddNumberToObject(o, "min_free", h->min_free);
+    return o;
+}
+
+// The same document built the way the handler did before json_writer
+static char *cjson_status(const status_t *s)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON *system = cJSON_CreateObject();
+    cJSON_AddStringToObject(system, "chip_model", "ESP32-S3");
+    cJSON_AddNumberToObject(system, "cores", s->cores);
+    cJSON_AddNumberToObject(system, "revision", s->revision);
+    cJSON_AddNumberToObject(system, "cpu_freq_mhz", s->cpu_freq_mhz);
+    cJSON_AddNumberToObject(system, "uptime_seconds", s->uptime_seconds);
+    cJSON_AddItemToObject(root, "system", system);
+
+    cJSON *memory = cJSON_CreateObject();
+    cJSON_AddNumberToObject(memory, "free_heap", s->free_heap);
+    cJSON_AddNumberToObject(memory, "total_heap", s->total_heap);
+    cJSON_AddNumberToObject(memory, "largest_free_block", s->largest_free_block);
+    cJSON_AddNumberToObject(memory, "min_free_heap", s->min_free_heap);
+    cJSON_AddNumberToObject(memory, "psram_free", s->psram_free);
+    cJSON_AddNumberToObject(memory, "psram_total", s->psram_total);
+    cJSON_AddItemToObject(memory, "internal", cjson_heap_caps(&s->internal));
+    cJSON_AddItemToObject(memory, "spiram", cjson_heap_caps(&s->spiram));
+    cJSON_AddItemToObject(memory, "dma", cjson_heap_caps(&s->dma));
+    cJSON_AddItemToObject(root, "memory", memory);
+
+    cJSON *tasks = cJSON_CreateArray();
+    for (int i = 0; i < STATUS_TASKS; i++) {
+        const status_task_t *t = &s->tasks[i];
+        cJSON *task = cJSON_CreateObject();
+        cJSON_AddStringToObject(task, "name", t->name);
+        cJSON_AddStringToObject(task, "state", t->state);
+        cJSON_AddNumberToObject(task, "priority", t->priority);
+        cJSON_AddNumberToObject(task, "stack_high_water", t->stack_high_water);
+        cJSON_AddNumberToObject(task, "core_id", t->core_id);
+        cJSON_AddNumberToObject(task, "cpu_percent", t->cpu_percent);
+        cJSON_AddItemToArray(tasks, task);
+    }
+    cJSON_AddItemToObject(root, "tasks", tasks);
+
+    cJSON *cpu = cJSON_CreateObject();
+    cJSON_AddBoolToObject(cpu, "valid", true);
+    cJSON_AddNumberToObject(cpu, "core0_usage", s->core_usage[0]);
+    cJSON_AddNumberToObject(cpu, "core1_usage", s->core_usage[1]);
+    cJSON_AddNumberToObject(cpu, "interval_ms", s->interval_ms);
+    cJSON_AddNumberToObject(cpu, "total_tasks", STATUS_TASKS);
+    cJSON_AddItemToObject(root, "cpu", cpu);
+
+    cJSON *sensors = cJSON_CreateObject();
+    cJSON_AddNumberToObject(sensors, "timestamp", s->timestamp);
+    cJSON_AddNumberToObject(sensors, "temperature_c", s->temperature_c);
+    cJSON_AddNumberToObject(sensors, "humidity_rh", s->humidity_rh);
+    cJSON_AddNumberToObject(sensors, "tvoc_ppb", s->tvoc_ppb);
+    cJSON_AddNumberToObject(sensors, "eco2_ppm", s->eco2_ppm);
+    cJSON_AddNumberToObject(sensors, "lux", s->lux);
+    cJSON_AddNumberToObject(sensors, "co2_ppm", s->co2_ppm);
+    cJSON_AddItemToObject(root, "sensors", sensors);
+
+    cJSON *tests = cJSON_CreateArray();
+    for (int i = 0; i < STATUS_TESTS; i++) {
+        cJSON *test = cJSON_CreateObject();
+        cJSON_AddNumberToObject(test, "test_num", i + 1);
+        cJSON_AddStringToObject(test, "name", s->tests[i].name);
+        cJSON_AddNumberToObject(test, "status", s->tests[i].status);
+        cJSON_AddItemToArray(tests, test);
+    }
+    cJSON_AddItemToObject(root, "tests", tests);
+
+    char *text = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return text;
+}
+
+static char *cjson_snapshot(const snapshot_t *s)
+{
+    char timestamp[16];
+    snprintf(timestamp, sizeof(timestamp), "%lu", (unsigned long)s->timestamp);
+    cJSON *telemetry = cJSON_CreateObject();
+    cJSON_AddStringToObject(telemetry, "timestamp", timestamp);
+    cJSON_AddStringToObject(telemetry, "device_id", "naphome-0.9");
+    cJSON *sht30 = cJSON_CreateObject();
+    cJSON_AddNumberToObject(sht30, "temperature_c", s->temperature_c);
+    cJSON_AddNumberToObject(sht30, "humidity_rh", s->humidity_rh);
+    cJSON_AddBoolToObject(sht30, "hardware_present", true);
+    cJSON_AddItemToObject(telemetry, "sht30", sht30);
+    cJSON *sgp30 = cJSON_CreateObject();
+    cJSON_AddNumberToObject(sgp30, "tvoc_ppb", s->tvoc_ppb);
+    cJSON_AddNumberToObject(sgp30, "eco2_ppm", s->eco2_ppm);
+    cJSON_AddBoolToObject(sgp30, "hardware_present", true);
+    cJSON_AddItemToObject(telemetry, "sgp30", sgp30);
+    cJSON *bh1750 = cJSON_CreateObject();
+    cJSON_AddNumberToObject(bh1750, "lux", s->lux);
+    cJSON_AddBoolToObject(bh1750, "hardware_present", true);
+    cJSON_AddItemToObject(telemetry, "bh1750", bh1750);
+    cJSON *scd30 = cJSON_CreateObject();
+    cJSON_AddNumberToObject(scd30, "co2_ppm", s->co2_ppm);
+    cJSON_AddNumberToObject(scd30, "temperature_c", s->scd30_temperature_c);
+    cJSON_AddNumberToObject(scd30, "humidity_rh", s->scd30_humidity_rh);
+    cJSON_AddBoolToObject(scd30, "hardware_present", true);
+    cJSON_AddItemToObject(telemetry, "scd30", scd30);
+    char *text = cJSON_PrintUnformatted(telemetry);
+    cJSON_Delete(telemetry);
+    return text;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Checks
+// ---------------------------------------------------------------------------
+
+// Render into one buffer large enough for the whole document
+static esp_err_t render_fixed(void (*write)(json_writer_t *, const void *), const void *doc, char *out,
+                              size_t cap, size_t *len)
+{
+    json_writer_t w;
+    json_writer_init(&w, out, cap, NULL, NULL);
+    write(&w, doc);
+    esp_err_t err = json_writer_finish(&w);
+    *len = w.len;
+    return err;
+}
+
+static void write_status_doc(json_writer_t *w, const void *doc)   { write_status(w, doc); }
+static void write_snapshot_doc(json_writer_t *w, const void *doc) { write_snapshot(w, doc); }
+
+static void check_escaping(void)
+{
+    char buf[256];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), NULL, NULL);
+    json_writer_object_begin(&w);
+    json_writer_key(&w, "k\"ey\n");
+    json_writer_string(&w, "q\" b\\ n\n r\r t\t bs\b ff\f 01\x01 1f\x1f del\x7f \xc3\xa9");
+    json_key(&w, "n");
+    json_writer_string_n(&w, "a\0b", 3);
+    json_writer_object_end(&w);
+    CHECK(json_writer_finish(&w) == ESP_OK, "escaping document failed");
+    static const char expected[] =
+        "{\"k\\\"ey\\n\":\"q\\\" b\\\\ n\\n r\\r t\\t bs\\u0008 ff\\u000c 01\\u0001 1f\\u001f del\x7f \xc3\xa9\","
+        "\"n\":\"a\\u0000b\"}";
+    CHECK(w.len == strlen(expected) && memcmp(buf, expected, w.len) == 0, "escaped as %.*s", (int)w.len, buf);
+}
+
+static void check_values(void)
+{
+    char buf[256];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), NULL, NULL);
+    json_writer_array_begin(&w);
+    json_writer_object_begin(&w);
+    json_writer_object_end(&w);
+    json_writer_array_begin(&w);
+    json_writer_array_end(&w);
+    json_writer_int(&w, INT64_MIN);
+    json_writer_uint(&w, UINT64_MAX);
+    json_writer_double(&w, -0.25, 2);
+    json_writer_double(&w, NAN, 1);
+    json_writer_double(&w, INFINITY, 1);
+    json_writer_double(&w, 1e300, 2);     // Too long for the number buffer
+    json_writer_bool(&w, false);
+    json_writer_string(&w, NULL);
+    json_writer_object_begin(&w);
+    json_kv_array(&w, "a");
+    json_writer_null(&w);
+    json_writer_array_end(&w);
+    json_kv_int(&w, "b", 1);
+    json_writer_object_end(&w);
+    json_writer_array_end(&w);
+    CHECK(json_writer_finish(&w) == ESP_OK, "values document failed");
+    static const char expected[] = "[{},[],-9223372036854775808,18446744073709551615,-0.25,null,null,null,false,"
+                                   "null,{\"a\":[null],\"b\":1}]";
+    CHECK(w.len == strlen(expected) && memcmp(buf, expected, w.len) == 0, "got %.*s", (int)w.len, buf);
+    CHECK(w.total == w.len, "total %zu, len %zu", w.total, w.len);
+}
+
+static void check_depth(void)
+{
+    char buf[128];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), NULL, NULL);
+    for (int i = 0; i < JSON_WRITER_MAX_DEPTH; i++) {
+        json_writer_array_begin(&w);
+    }
+    for (int i = 0; i < JSON_WRITER_MAX_DEPTH; i++) {
+        json_writer_array_end(&w);
+    }
+    CHECK(json_writer_finish(&w) == ESP_OK && w.len == 2 * JSON_WRITER_MAX_DEPTH,
+          "%d levels: %s, %zu bytes", JSON_WRITER_MAX_DEPTH, esp_err_to_name(w.err), w.len);
+
+    json_writer_init(&w, buf, sizeof(buf), NULL, NULL);
+    for (int i = 0; i <= JSON_WRITER_MAX_DEPTH; i++) {
+        json_writer_object_begin(&w);
+        json_key(&w, "x");
+    }
+    size_t len_at_error = w.len;
+    json_writer_int(&w, 1);  // Sticky: nothing more is written
+    for (int i = 0; i <= JSON_WRITER_MAX_DEPTH; i++) {
+        json_writer_object_end(&w);
+    }
+    CHECK(json_writer_finish(&w) == ESP_ERR_INVALID_STATE, "%d levels: %s", JSON_WRITER_MAX_DEPTH + 1,
+          esp_err_to_name(w.err));
+    CHECK(w.len == len_at_error, "wrote %zu bytes after the depth error", w.len - len_at_error);
+
+    json_writer_init(&w, buf, sizeof(buf), NULL, NULL);
+    json_writer_object_begin(&w);
+    CHECK(json_writer_finish(&w) == ESP_ERR_INVALID_STATE, "unclosed object: %s", esp_err_to_name(w.err));
+    json_writer_init(&w, buf, sizeof(buf), NULL, NULL);
+    json_writer_array_end(&w);
+    CHECK(json_writer_finish(&w) == ESP_ERR_INVALID_STATE, "unbalanced close: %s", esp_err_to_name(w.err));
+}
+
+static void check_overflow(const status_t *status, size_t status_len)
+{
+    static char buf[MAX_DOC];
+    size_t len;
+    CHECK(render_fixed(write_status_doc, status, buf, status_len, &len) == ESP_OK && len == status_len,
+          "status in an exact-size buffer: %zu bytes", len);
+    for (size_t cap = 1; cap < status_len; cap += 97) {
+        memset(buf, 0, sizeof(buf));
+        esp_err_t err = render_fixed(write_status_doc, status, buf, cap, &len);
+        CHECK(err == ESP_ERR_NO_MEM, "status in %zu bytes without a flush callback: %s", cap, esp_err_to_name(err));
+        CHECK(len == cap && buf[cap] == 0, "status in %zu bytes: wrote %zu", cap, len);
+    }
+    json_writer_t w;
+    json_writer_init(&w, NULL, 0, NULL, NULL);
+    json_writer_null(&w);
+    CHECK(json_writer_finish(&w) == ESP_ERR_INVALID_ARG, "no buffer: %s", esp_err_to_name(w.err));
+}
+
+// Every buffer size must give the same bytes, in full buffers plus one tail
+static void check_chunked(const status_t *status, const char *whole, size_t whole_len)
+{
+    static capture_t c;
+    int mismatches = 0;
+    for (size_t cap = 1; cap <= CHUNK_SIZE; cap = cap < 64 ? cap + 1 : cap * 2) {
+        char buf[CHUNK_SIZE];
+        memset(&c, 0, sizeof(c));
+        c.cap = cap;
+        json_writer_t w;
+        json_writer_init(&w, buf, cap, capture_flush, &c);
+        write_status(&w, status);
+        esp_err_t err = json_writer_finish(&w);
+        size_t expected_flushes = (whole_len + cap - 1) / cap;
+        if (err != ESP_OK || c.len != whole_len || memcmp(c.text, whole, whole_len) != 0 ||
+            w.total != whole_len || c.flushes != expected_flushes || c.short_flushes > 1) {
+            mismatches++;
+            fprintf(stderr, "  %zu-byte buffer: %s, %zu bytes in %zu flushes (%zu short)\n", cap,
+                    esp_err_to_name(err), c.len, c.flushes, c.short_flushes);
+        }
+    }
+    CHECK(mismatches == 0, "%d buffer sizes changed the output", mismatches);
+
+    // A failed flush (client gone) stops the document and is reported
+    char buf[64];
+    memset(&c, 0, sizeof(c));
+    c.cap = sizeof(buf);
+    c.fail_at = 3;
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), capture_flush, &c);
+    write_status(&w, status);
+    CHECK(json_writer_finish(&w) == ESP_FAIL, "failed flush reported as %s", esp_err_to_name(w.err));
+    CHECK(c.flushes == 3, "%zu flushes after the failed one", c.flushes - 3);
+}
+
+static void status_text(int path, const char *data, size_t len, bool done, void *ctx)
+{
+    char *text = ((char **)ctx)[path];
+    size_t have = strlen(text);
+    if (have + len < 64) {
+        memcpy(text + have, data, len);
+        text[have + len] = '\0';
+    }
+}
+
+// The streamed document is valid JSON with the values where the dashboard reads them
+static void check_parses(const char *doc, size_t len)
+{
+    static const char *const paths[] = {"tasks[23].name", "tests[11].name", "system.chip_model", "tasks[5].state"};
+    char values[4][64] = {{0}};
+    char *texts[4] = {values[0], values[1], values[2], values[3]};
+    json_reader_t r;
+    json_reader_init(&r, paths, 4, status_text, texts);
+    CHECK(json_reader_feed(&r, doc, len) == ESP_OK && json_reader_finish(&r) == ESP_OK,
+          "status document does not parse at byte %zu", r.offset);
+    CHECK(strcmp(values[0], "Tmr Svc") == 0, "tasks[23].name '%s'", values[0]);
+    CHECK(strcmp(values[1], "Sensor Telemetry Publishing") == 0, "tests[11].name '%s'", values[1]);
+    CHECK(strcmp(values[2], "ESP32-S3") == 0, "system.chip_model '%s'", values[2]);
+    CHECK(strcmp(values[3], "Ready") == 0, "tasks[5].state '%s'", values[3]);
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    double ns;
+    double allocs;
+    size_t peak;
+    size_t bytes;
+} cost_t;
+
+static cost_t bench_writer(void (*write)(json_writer_t *, const void *), const void *doc)
+{
+    cost_t cost = {0};
+    char buf[CHUNK_SIZE];
+    size_t sent = 0;
+    int reps = 0;
+    heap_reset();
+    size_t base = heap_live;
+    int64_t start = esp_timer_get_time();
+    do {
+        json_writer_t w;
+        sent = 0;
+        json_writer_init(&w, buf, sizeof(buf), discard_flush, &sent);
+        write(&w, doc);
+        json_writer_finish(&w);
+        reps++;
+    } while (esp_timer_get_time() - start < TIMING_MIN_US);
+    cost.ns = (esp_timer_get_time() - start) * 1000.0 / reps;
+    cost.allocs = (double)alloc_calls / reps;
+    cost.peak = heap_peak - base;
+    cost.bytes = sent;
+    return cost;
+}
+
+#ifdef HAVE_CJSON
+static cost_t bench_cjson(char *(*build)(const void *), const void *doc)
+{
+    cost_t cost = {0};
+    int reps = 0;
+    heap_reset();
+    size_t base = heap_live;
+    int64_t start = esp_timer_get_time();
+    do {
+        char *text = build(doc);
+        cost.bytes = text ? strlen(text) : 0;
+        cJSON_free(text);
+        reps++;
+    } while (esp_timer_get_time() - start < TIMING_MIN_US);
+    cost.ns = (esp_timer_get_time() - start) * 1000.0 / reps;
+    cost.allocs = (double)alloc_calls / reps;
+    cost.peak = heap_peak - base;
+    return cost;
+}
+
+static char *cjson_status_doc(const void *doc)   { return cjson_status(doc); }
+static char *cjson_snapshot_doc(const void *doc) { return cjson_snapshot(doc); }
+#endif
+
+static void print_cost(const char *name, const cost_t *c)
+{
+    printf("  %-26s %5zu bytes  %8.0f ns/doc  %6.1f allocations  peak heap %6zu bytes\n", name, c->bytes, c->ns,
+           c->allocs, c->peak);
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    static status_t status;
+    status_init(&status);
+
+    check_escaping();
+    check_values();
+    check_depth();
+
+    static char whole[MAX_DOC];
+    size_t status_len;
+    CHECK(render_fixed(write_status_doc, &status, whole, sizeof(whole), &status_len) == ESP_OK,
+          "status document failed");
+    check_overflow(&status, status_len);
+    check_chunked(&status, whole, status_len);
+    check_parses(whole, status_len);
+
+    printf("Documents through a %d-byte buffer and flush callback (json_writer) vs a cJSON tree "
+           "printed unformatted:\n", CHUNK_SIZE);
+    cost_t status_writer = bench_writer(write_status_doc, &status);
+    print_cost("/api/status json_writer", &status_writer);
+    cost_t snapshot_writer = bench_writer(write_snapshot_doc, &snapshot);
+    print_cost("telemetry json_writer", &snapshot_writer);
+    CHECK(status_writer.bytes == status_len, "streamed %zu bytes, rendered %zu", status_writer.bytes, status_len);
+    CHECK(status_writer.allocs == 0 && snapshot_writer.allocs == 0, "json_writer allocated: %.1f / %.1f per doc",
+          status_writer.allocs, snapshot_writer.allocs);
+    CHECK(status_writer.peak == 0 && snapshot_writer.peak == 0, "json_writer heap: %zu / %zu bytes",
+          status_writer.peak, snapshot_writer.peak);
+#ifdef HAVE_CJSON
+    cost_t status_cjson = bench_cjson(cjson_status_doc, &status);
+    print_cost("/api/status cJSON", &status_cjson);
+    cost_t snapshot_cjson = bench_cjson(cjson_snapshot_doc, &snapshot);
+    print_cost("telemetry cJSON", &snapshot_cjson);
+    CHECK(status_cjson.allocs > 0, "allocation counting missed cJSON");
+#else
+    printf("  (cJSON not found: set IDF_PATH or CJSON_DIR for the baseline)\n");
+#endif
+    return host_test_result("test_json_writer");
+}
@@ -0,0 +1,410 @@
+/**
+ * @file test_led_engine.c
+ * @brief LED face timelines through the real render task, dumped and checked
+ *
+ * led_engine.c and the face timelines from led_faces.c run unchanged, render
+ * task included. esp_timer and the task's notification wait are wrapped
+ * (-Wl,--wrap) so the test owns the clock: it advances simulated time to the
+ * next frame timer or scripted layer change, wakes the task and waits until
+ * it blocks again. Every pushed frame is recorded with its simulated time
+ * and dumped as text (one line per push) and as a PPM strip (one row per
+ * 16 ms, four pixels per LED) in the working directory.
+ *
+ * Checks: the colours of each layer at scripted times, layers clearing
+ * themselves, fades at no more than 60 fps, no frame pushed twice, and no
+ * wakeups while a static face covers an animated one.
+ */
+
+#include "led_engine.h"
+#include "led_faces.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_FRAMES          8192
+#define DUMP_ROW_MS         16      // PPM rows: one per LED_ENGINE_FRAME_MS of time
+#define DUMP_LED_WIDTH      4
+#define COMPOSE_ITERATIONS  1000000
+
+static const led_rgb_t off = { 0, 0, 0 };
+static const led_rgb_t cyan = { 0, 255, 255 };
+static const led_rgb_t cyan_dim = { 0, 100, 100 };
+static const led_rgb_t green = { 0, 255, 0 };
+
+// ---------------------------------------------------------------------------
+// Simulated clock and frame timer, owned by the test
+// ---------------------------------------------------------------------------
+
+static _Atomic int64_t sim_us = 0;
+static esp_timer_cb_t timer_callback = NULL;
+static void *timer_arg = NULL;
+static bool timer_armed = false;
+static int64_t timer_deadline_us = 0;
+static uint64_t min_timer_us = UINT64_MAX;
+static char timer_handle;
+static SemaphoreHandle_t render_blocked;
+
+uint32_t __real_ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+
+int64_t __wrap_esp_timer_get_time(void)
+{
+    return atomic_load(&sim_us);
+}
+
+esp_err_t __wrap_esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    timer_callback = args->callback;
+    timer_arg = args->arg;
+    *out_handle = (esp_timer_handle_t)&timer_handle;
+    return ESP_OK;
+}
+
+esp_err_t __wrap_esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    timer_armed = true;
+    timer_deadline_us = atomic_load(&sim_us) + (int64_t)timeout_us;
+    if (timeout_us < min_timer_us) {
+        min_timer_us = timeout_us;
+    }
+    return ESP_OK;
+}
+
+esp_err_t __wrap_esp_timer_stop(esp_timer_handle_t timer)
+{
+    timer_armed = false;
+    return ESP_OK;
+}
+
+bool __wrap_esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer_armed;
+}
+
+esp_err_t __wrap_esp_timer_delete(esp_timer_handle_t timer)
+{
+    timer_armed = false;
+    return ESP_OK;
+}
+
+// The render task is about to block: the test may move the clock
+uint32_t __wrap_ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    xSemaphoreGive(render_blocked);
+    return __real_ulTaskNotifyTake(clear_on_exit, ticks);
+}
+
+// ---------------------------------------------------------------------------
+// Recorded frames
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int64_t t_ms;
+    led_rgb_t px[FACE_LED_COUNT];
+} frame_t;
+
+static frame_t *frames;
+static size_t frame_count = 0;
+static uint32_t wakeups = 0;
+
+static void record_push(void *ctx, const led_rgb_t *frame, size_t count)
+{
+    if (frame_count < MAX_FRAMES && count == FACE_LED_COUNT) {
+        frames[frame_count].t_ms = atomic_load(&sim_us) / 1000;
+        memcpy(frames[frame_count].px, frame, sizeof(frames[frame_count].px));
+        frame_count++;
+    }
+}
+
+static void wait_until_blocked(void)
+{
+    xSemaphoreTake(render_blocked, portMAX_DELAY);
+    wakeups++;
+}
+
+// Frame on the strip at t_ms: the last one pushed at or before it
+static const frame_t *frame_at(int64_t t_ms)
+{
+    const frame_t *shown = NULL;
+    for (size_t i = 0; i < frame_count && frames[i].t_ms <= t_ms; i++) {
+        shown = &frames[i];
+    }
+    return shown;
+}
+
+static size_t pushes_between(int64_t from_ms, int64_t to_ms)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < frame_count; i++) {
+        n += frames[i].t_ms > from_ms && frames[i].t_ms < to_ms;
+    }
+    return n;
+}
+
+static bool same(led_rgb_t a, led_rgb_t b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+// Pixels in mask must show color at t_ms
+static void check_pixels(const char *what, int64_t t_ms, uint32_t mask, led_rgb_t color)
+{
+    const frame_t *f = frame_at(t_ms);
+    CHECK(f != NULL, "%s: nothing pushed by %lld ms", what, (long long)t_ms);
+    if (!f) {
+        return;
+    }
+    for (int p = 0; p < FACE_LED_COUNT; p++) {
+        if (mask & LED_PIXEL(p)) {
+            CHECK(same(f->px[p], color), "%s at %lld ms: LED %d is %02x%02x%02x, expected %02x%02x%02x",
+                  what, (long long)t_ms, p, f->px[p].r, f->px[p].g, f->px[p].b, color.r, color.g, color.b);
+        }
+    }
+}
+
+static void dump(const char *name, int64_t end_ms)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "%s.txt", name);
+    FILE *txt = fopen(path, "w");
+    snprintf(path, sizeof(path), "%s.ppm", name);
+    FILE *ppm = fopen(path, "wb");
+    if (!txt || !ppm) {
+        CHECK(false, "cannot write the %s dumps", name);
+        if (txt) {
+            fclose(txt);
+        }
+        if (ppm) {
+            fclose(ppm);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < frame_count; i++) {
+        fprintf(txt, "%6lld ms:", (long long)frames[i].t_ms);
+        for (int p = 0; p < FACE_LED_COUNT; p++) {
+            fprintf(txt, " %02x%02x%02x", frames[i].px[p].r, frames[i].px[p].g, frames[i].px[p].b);
+        }
+        fputc('\n', txt);
+    }
+
+    int rows = (int)(end_ms / DUMP_ROW_MS);
+    fprintf(ppm, "P6\n%d %d\n255\n", FACE_LED_COUNT * DUMP_LED_WIDTH, rows);
+    for (int row = 0; row < rows; row++) {
+        const frame_t *f = frame_at((int64_t)row * DUMP_ROW_MS);
+        for (int p = 0; p < FACE_LED_COUNT; p++) {
+            led_rgb_t c = f ? f->px[p] : off;
+            for (int k = 0; k < DUMP_LED_WIDTH; k++) {
+                fwrite(&c, sizeof(c), 1, ppm);
+            }
+        }
+    }
+    fclose(txt);
+    fclose(ppm);
+}
+
+// ---------------------------------------------------------------------------
+// Scripted scenarios
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    PLAY,
+    CLEAR,
+    FILL,
+} action_kind_t;
+
+typedef struct {
+    int64_t t_ms;
+    action_kind_t kind;
+    led_layer_t layer;
+    const led_timeline_t *timeline;
+    led_rgb_t color;
+    uint32_t duration_ms;
+} scripted_t;
+
+// Run the render task from the current time to end_ms, applying script
+// actions at their times; each action and each frame timer is one wakeup
+static void run(const scripted_t *script, size_t count, int64_t end_ms)
+{
+    size_t next = 0;
+    while (true) {
+        int64_t now = atomic_load(&sim_us);
+        int64_t action_us = next < count ? script[next].t_ms * 1000 : INT64_MAX;
+        int64_t timer_us = timer_armed ? timer_deadline_us : INT64_MAX;
+        int64_t at = action_us < timer_us ? action_us : timer_us;
+        if (at >= end_ms * 1000) {
+            atomic_store(&sim_us, end_ms * 1000);
+            return;
+        }
+        atomic_store(&sim_us, at > now ? at : now);
+
+        if (action_us <= timer_us) {
+            const scripted_t *a = &script[next++];
+            switch (a->kind) {
+            case PLAY:
+                led_engine_play(a->layer, a->timeline);
+                break;
+            case CLEAR:
+                led_engine_clear(a->layer);
+                break;
+            case FILL:
+                led_engine_fill(a->layer, a->color, a->duration_ms);
+                break;
+            }
+        } else {
+            timer_armed = false;
+            timer_callback(timer_arg);
+        }
+        wait_until_blocked();
+    }
+}
+
+static void reset(void)
+{
+    for (int l = 0; l < LED_LAYER_COUNT; l++) {
+        led_engine_clear(l);
+        wait_until_blocked();
+    }
+    frame_count = 0;
+    wakeups = 0;
+}
+
+// A voice interaction, a passing test and the lights, over the idle eyes
+static void check_interaction(void)
+{
+    const scripted_t script[] = {
+        { 0, PLAY, LED_LAYER_IDLE, &led_face_idle },
+        { 3000, PLAY, LED_LAYER_LISTEN, &led_face_listen },
+        { 5000, PLAY, LED_LAYER_SMILE, &led_face_smile },
+        { 7500, CLEAR, LED_LAYER_LISTEN },
+        { 9000, FILL, LED_LAYER_STATUS, NULL, { 0, 255, 0 }, 1000 },
+        { 12000, PLAY, LED_LAYER_LIGHTS, &led_face_lights },
+        { 15000, CLEAR, LED_LAYER_LIGHTS },
+    };
+    const int64_t end_ms = 20000;
+    atomic_store(&sim_us, 0);
+    reset();
+    run(script, sizeof(script) / sizeof(script[0]), end_ms);
+    dump("led_interaction", end_ms);
+
+    const uint32_t rest = FACE_ALL & ~(FACE_EYES | FACE_EARS | FACE_SMILE);
+    check_pixels("idle", 100, LED_PIXEL(LED_LEFT_EYE), cyan);
+    check_pixels("idle", 100, LED_PIXEL(LED_RIGHT_EYE), cyan_dim);
+    check_pixels("idle", 100, FACE_ALL & ~FACE_EYES, off);
+    check_pixels("idle looking right", 2000, LED_PIXEL(LED_LEFT_EYE), cyan_dim);
+    check_pixels("idle looking right", 2000, LED_PIXEL(LED_RIGHT_EYE), cyan);
+
+    // The 1300-1500 ms cross-fade: every step darker, about one per frame
+    int fade_steps = 0;
+    int last_g = 255;
+    for (size_t i = 0; i < frame_count; i++) {
+        if (frames[i].t_ms > 1300 && frames[i].t_ms <= 1500) {
+            int g = frames[i].px[LED_LEFT_EYE].g;
+            CHECK(g < last_g, "left eye brightens during its fade at %lld ms", (long long)frames[i].t_ms);
+            last_g = g;
+            fade_steps++;
+        }
+    }
+    CHECK(fade_steps >= 200 / LED_ENGINE_FRAME_MS - 1 && fade_steps <= 200 / LED_ENGINE_FRAME_MS + 1,
+          "%d steps in a 200 ms fade", fade_steps);
+
+    check_pixels("listen", 3000, FACE_EARS, (led_rgb_t){ 150, 150, 0 });
+    check_pixels("listen", 3000, FACE_EYES, cyan);
+    check_pixels("listen", 3000, rest | FACE_SMILE, off);
+    const frame_t *peak = frame_at(3200);
+    CHECK(peak && peak->px[LED_EAR_LEFT].r >= 240, "ears not pulsing towards orange at 3200 ms");
+
+    check_pixels("smile", 5000, FACE_SMILE, green);
+    check_pixels("smile", 5000, FACE_EYES, cyan);
+    check_pixels("smile", 5000, FACE_EARS | rest, off);
+    check_pixels("smile", 6990, FACE_SMILE, green);
+    CHECK(pushes_between(5000, 7000) == 0, "%zu pushes while the smile holds", pushes_between(5000, 7000));
+
+    // The smile clears itself after two seconds, uncovering the ears
+    const frame_t *after_smile = frame_at(7000);
+    CHECK(after_smile && after_smile->t_ms == 7000, "smile not cleared at 7000 ms");
+    check_pixels("listen after the smile", 7000, FACE_SMILE, off);
+    CHECK(after_smile && after_smile->px[LED_EAR_LEFT].r >= 150, "ears not back after the smile");
+    check_pixels("idle after listening", 7500, FACE_EARS, off);
+
+    check_pixels("test passed", 9000, FACE_ALL, green);
+    check_pixels("test passed", 9990, FACE_ALL, green);
+    check_pixels("idle after status", 10000, FACE_ALL & ~FACE_EYES, off);
+    CHECK(frame_at(10000)->t_ms == 10000, "status not cleared at 10000 ms");
+
+    check_pixels("lights", 12000, FACE_SMILE, green);
+    check_pixels("lights", 12000, FACE_EYES, cyan);
+    check_pixels("lights", 12000, FACE_EARS, (led_rgb_t){ 0, 150, 0 });
+    check_pixels("lights", 12000, rest, off);
+    CHECK(pushes_between(12000, 15000) == 0, "%zu pushes under the static lights face",
+          pushes_between(12000, 15000));
+    check_pixels("idle after lights", 15000, FACE_ALL & ~FACE_EYES, off);
+
+    for (size_t i = 1; i < frame_count; i++) {
+        CHECK(memcmp(frames[i].px, frames[i - 1].px, sizeof(frames[i].px)) != 0,
+              "frame at %lld ms pushed twice", (long long)frames[i].t_ms);
+    }
+    CHECK(min_timer_us >= LED_ENGINE_FRAME_MS * 1000, "frame timer armed for %llu us",
+          (unsigned long long)min_timer_us);
+    printf("20 s interaction: %u wakeups, %zu frames pushed -> led_interaction.txt/.ppm\n",
+           wakeups, frame_count);
+}
+
+// Wakeups and pushes for a minute of one face
+static void check_minute(const char *name, led_layer_t layer, const led_timeline_t *timeline,
+                         uint32_t max_wakeups)
+{
+    const scripted_t script[] = {
+        { 0, PLAY, LED_LAYER_IDLE, &led_face_idle },
+        { 0, PLAY, layer, timeline },
+    };
+    const int64_t end_ms = 60000;
+    atomic_store(&sim_us, 0);
+    reset();
+    run(script, layer == LED_LAYER_IDLE ? 1 : 2, end_ms);
+    CHECK(wakeups <= max_wakeups, "%s: %u wakeups in 60 s", name, wakeups);
+    CHECK(frame_count <= wakeups, "%s: %zu pushes for %u wakeups", name, frame_count, wakeups);
+    printf("60 s %-9s %5u wakeups, %5zu frames pushed (60 fps throughout would be %d)\n",
+           name, wakeups, frame_count, 60000 / LED_ENGINE_FRAME_MS);
+}
+
+static void bench_compose(void)
+{
+    led_engine_play(LED_LAYER_IDLE, &led_face_idle);
+    wait_until_blocked();
+    led_rgb_t frame[FACE_LED_COUNT];
+    int64_t base_ms = atomic_load(&sim_us) / 1000;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < COMPOSE_ITERATIONS; i++) {
+        led_engine_compose(base_ms + i % 3000, frame);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / COMPOSE_ITERATIONS;
+    printf("led_engine_compose: %.0f ns/frame (host)\n", ns);
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    frames = calloc(MAX_FRAMES, sizeof(*frames));
+    render_blocked = xSemaphoreCreateCounting(4, 0);
+    CHECK(led_engine_init(FACE_LED_COUNT, record_push, NULL) == ESP_OK, "engine did not start");
+    wait_until_blocked();
+
+    check_interaction();
+    // Idle eyes: two 200 ms fades per 3 s loop, a wakeup per frame while fading
+    check_minute("idle", LED_LAYER_IDLE, &led_face_idle, 60000 / 3000 * 2 * (200 / LED_ENGINE_FRAME_MS + 3));
+    // Lights cover the idle eyes completely: nothing to animate
+    check_minute("lights", LED_LAYER_LIGHTS, &led_face_lights, 2);
+    bench_compose();
+
+    free(frames);
+    return host_test_result("test_led_engine");
+}
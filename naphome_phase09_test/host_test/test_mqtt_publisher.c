@@ -0,0 +1,499 @@
+/**
+ * @file test_mqtt_publisher.c
+ * @brief MQTT publisher against a real broker: delivery, recovery and spill cost
+ *
+ * Run through mqtt_standin.py, which starts mosquitto or the Python stand-in
+ * and passes its URI as the only argument. A QoS1 subscriber on a second
+ * connection checks that every message arrives, and how often twice.
+ * Each scenario runs in its own process because the publisher is a
+ * singleton; the esp-mqtt stand-in delays broker packets to model the
+ * round trip and the NVS stand-in makes each flash write take time.
+ */
+
+#include "mqtt_publisher.h"
+#include "mqtt_client.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_SEQ             128
+#define LINK_RTT_MS         20      // Broker round trip for the throughput runs
+#define THROUGHPUT_MESSAGES 60
+#define SPILL_MESSAGES      40      // Published while the broker is unreachable
+#define NVS_WRITE_MS        10      // Per nvs_set_* / nvs_commit, a slow flash page write
+#define SPILL_PERIOD_MS     50      // Publish period while spilling: a spill is four NVS writes
+
+typedef struct {
+    double msgs_per_sec[MQTT_PUB_MAX_INFLIGHT + 1];
+} shared_results_t;
+
+static const char *broker_uri;
+static shared_results_t *results;
+
+// ---------------------------------------------------------------------------
+// QoS1 subscriber on its own connection
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int sock;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    int counts[MAX_SEQ];
+    int order[MAX_SEQ * 4];
+    size_t deliveries;
+} subscriber_t;
+
+static bool sock_read(int sock, uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t got = recv(sock, buf, len, 0);
+        if (got <= 0) {
+            return false;
+        }
+        buf += got;
+        len -= got;
+    }
+    return true;
+}
+
+static bool read_packet(int sock, uint8_t *header, uint8_t *body, size_t *len)
+{
+    uint8_t byte;
+    size_t n = 0;
+    int shift = 0;
+    if (!sock_read(sock, header, 1)) {
+        return false;
+    }
+    do {
+        if (!sock_read(sock, &byte, 1)) {
+            return false;
+        }
+        n |= (size_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    *len = n;
+    return n <= 2048 && sock_read(sock, body, n);
+}
+
+static void *subscriber_thread(void *arg)
+{
+    subscriber_t *sub = arg;
+    uint8_t header;
+    uint8_t body[2048 + 1];
+    size_t len;
+    while (read_packet(sub->sock, &header, body, &len)) {
+        if ((header & 0xF0) != 0x30) {
+            continue;
+        }
+        int qos = (header >> 1) & 3;
+        size_t offset = 2 + ((body[0] << 8) | body[1]);
+        if (qos) {
+            uint8_t puback[4] = { 0x40, 2, body[offset], body[offset + 1] };
+            send(sub->sock, puback, sizeof(puback), MSG_NOSIGNAL);
+            offset += 2;
+        }
+        body[len] = '\0';
+        int seq = -1;
+        sscanf((const char *)body + offset, "seq=%d", &seq);
+        pthread_mutex_lock(&sub->lock);
+        if (seq >= 0 && seq < MAX_SEQ) {
+            sub->counts[seq]++;
+        }
+        if (sub->deliveries < sizeof(sub->order) / sizeof(sub->order[0])) {
+            sub->order[sub->deliveries++] = seq;
+        }
+        pthread_mutex_unlock(&sub->lock);
+    }
+    return NULL;
+}
+
+static bool subscriber_start(subscriber_t *sub, const char *topic)
+{
+    memset(sub, 0, sizeof(*sub));
+    pthread_mutex_init(&sub->lock, NULL);
+
+    char host[128];
+    const char *port = strrchr(broker_uri, ':') + 1;
+    snprintf(host, sizeof(host), "%.*s", (int)(port - 1 - (broker_uri + 7)), broker_uri + 7);
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res;
+    if (getaddrinfo(host, port, &hints, &res) != 0) {
+        return false;
+    }
+    sub->sock = socket(res->ai_family, res->ai_socktype, 0);
+    bool ok = connect(sub->sock, res->ai_addr, res->ai_addrlen) == 0;
+    freeaddrinfo(res);
+    if (!ok) {
+        return false;
+    }
+    int one = 1;
+    setsockopt(sub->sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    static const uint8_t connect_packet[] = {
+        0x10, 17, 0, 4, 'M', 'Q', 'T', 'T', 4, 0x02, 0, 60, 0, 5, 's', 'u', 'b', 'e', 'r',
+    };
+    uint8_t packet[128];
+    size_t topic_len = strlen(topic);
+    size_t n = 0;
+    packet[n++] = 0x82;
+    packet[n++] = 2 + 2 + topic_len + 1;
+    packet[n++] = 0;
+    packet[n++] = 1;
+    packet[n++] = 0;
+    packet[n++] = topic_len;
+    memcpy(packet + n, topic, topic_len);
+    n += topic_len;
+    packet[n++] = 1;    // QoS1
+
+    uint8_t header;
+    uint8_t body[16];
+    size_t len;
+    if (send(sub->sock, connect_packet, sizeof(connect_packet), 0) < 0 ||
+        !read_packet(sub->sock, &header, body, &len) || header != 0x20 ||
+        send(sub->sock, packet, n, 0) < 0 ||
+        !read_packet(sub->sock, &header, body, &len) || header != 0x90) {
+        return false;
+    }
+    pthread_create(&sub->thread, NULL, subscriber_thread, sub);
+    return true;
+}
+
+// Wait until every seq below n has arrived at least once
+static bool subscriber_wait(subscriber_t *sub, int n, int timeout_ms)
+{
+    for (int waited = 0; waited <= timeout_ms; waited += 10) {
+        pthread_mutex_lock(&sub->lock);
+        int missing = 0;
+        for (int i = 0; i < n; i++) {
+            missing += sub->counts[i] == 0;
+        }
+        pthread_mutex_unlock(&sub->lock);
+        if (missing == 0) {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return false;
+}
+
+static void subscriber_tally(subscriber_t *sub, int n, int *missing, int *duplicates)
+{
+    *missing = 0;
+    *duplicates = 0;
+    pthread_mutex_lock(&sub->lock);
+    for (int i = 0; i < n; i++) {
+        *missing += sub->counts[i] == 0;
+        *duplicates += sub->counts[i] > 1 ? sub->counts[i] - 1 : 0;
+    }
+    pthread_mutex_unlock(&sub->lock);
+}
+
+// ---------------------------------------------------------------------------
+// Scenarios (each in a fresh process)
+// ---------------------------------------------------------------------------
+
+static bool start_publisher(size_t max_inflight, uint32_t ack_timeout_ms)
+{
+    mqtt_publisher_config_t config = MQTT_PUBLISHER_DEFAULT_CONFIG();
+    config.broker_uri = broker_uri;
+    config.max_inflight = max_inflight;
+    config.ack_timeout_ms = ack_timeout_ms;
+    config.backoff_min_ms = 200;
+    config.backoff_max_ms = 800;
+    CHECK(mqtt_publisher_start(&config) == ESP_OK, "publisher did not start");
+    for (int i = 0; i < 200 && !mqtt_publisher_is_connected(); i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    CHECK(mqtt_publisher_is_connected(), "no connection to %s", broker_uri);
+    return mqtt_publisher_is_connected();
+}
+
+static int64_t publish_seq(const char *topic, int seq)
+{
+    char payload[32];
+    int len = snprintf(payload, sizeof(payload), "seq=%d", seq);
+    int64_t start = esp_timer_get_time();
+    CHECK(mqtt_publisher_publish(topic, payload, len) == ESP_OK, "publish %d", seq);
+    return esp_timer_get_time() - start;
+}
+
+// Keep the RAM queue below the spill threshold, as Test 8 does
+static void wait_ram_below(uint32_t depth)
+{
+    mqtt_publisher_stats_t stats;
+    mqtt_publisher_get_stats(&stats);
+    while (stats.ram_depth >= depth) {
+        usleep(200);
+        mqtt_publisher_get_stats(&stats);
+    }
+}
+
+static void scenario_throughput(size_t max_inflight)
+{
+    static const char *topic = "naphome/test/throughput";
+    host_mqtt_set_rx_delay_ms(LINK_RTT_MS);
+    subscriber_t sub;
+    CHECK(subscriber_start(&sub, topic), "subscriber could not connect");
+    if (!start_publisher(max_inflight, 10000)) {
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < THROUGHPUT_MESSAGES; i++) {
+        wait_ram_below(MQTT_PUB_SPILL_THRESHOLD / 2);
+        publish_seq(topic, i);
+    }
+    bool drained = mqtt_publisher_wait_drained(20000);
+    int64_t elapsed = esp_timer_get_time() - start;
+    CHECK(drained, "inflight %zu: queue did not drain", max_inflight);
+    CHECK(subscriber_wait(&sub, THROUGHPUT_MESSAGES, 2000), "inflight %zu: messages missing", max_inflight);
+
+    mqtt_publisher_stats_t stats;
+    mqtt_publisher_get_stats(&stats);
+    int missing, duplicates;
+    subscriber_tally(&sub, THROUGHPUT_MESSAGES, &missing, &duplicates);
+    CHECK(stats.spilled == 0, "inflight %zu: %u messages went through flash", max_inflight, (unsigned)stats.spilled);
+    CHECK(stats.retried == 0 && duplicates == 0, "inflight %zu: %u retried, %d duplicates",
+          max_inflight, (unsigned)stats.retried, duplicates);
+    CHECK(stats.acked == THROUGHPUT_MESSAGES, "inflight %zu: %u acked", max_inflight, (unsigned)stats.acked);
+
+    double rate = THROUGHPUT_MESSAGES * 1e6 / elapsed;
+    results->msgs_per_sec[max_inflight] = rate;
+    printf("throughput, %zu in flight, %d ms round trip: %6.1f msg/s (%d messages in %lld ms, none spilled)\n",
+           max_inflight, LINK_RTT_MS, rate, THROUGHPUT_MESSAGES, (long long)(elapsed / 1000));
+}
+
+static void scenario_slow_acks(void)
+{
+    // PUBACKs take longer than the retransmit timeout: esp-mqtt resends on
+    // its own and the publisher must not queue the same message again
+    static const char *topic = "naphome/test/slow_acks";
+    const int n = 16;
+    host_mqtt_set_rx_delay_ms(150);
+    subscriber_t sub;
+    CHECK(subscriber_start(&sub, topic), "subscriber could not connect");
+    if (!start_publisher(MQTT_PUB_MAX_INFLIGHT, 100)) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        wait_ram_below(MQTT_PUB_SPILL_THRESHOLD / 2);
+        publish_seq(topic, i);
+    }
+    CHECK(mqtt_publisher_wait_drained(10000), "queue did not drain");
+    CHECK(subscriber_wait(&sub, n, 2000), "messages missing");
+
+    mqtt_publisher_stats_t stats;
+    mqtt_publisher_get_stats(&stats);
+    int missing, duplicates;
+    subscriber_tally(&sub, n, &missing, &duplicates);
+    CHECK(stats.retried == 0, "publisher re-queued %u messages the outbox was already resending",
+          (unsigned)stats.retried);
+    CHECK(stats.acked == (uint32_t)n, "%u of %d acked", (unsigned)stats.acked, n);
+    printf("slow acks (150 ms, retransmit after 100 ms): %u outbox resends, %d duplicates delivered, "
+           "%u publisher retries\n", (unsigned)host_mqtt_outbox_resends(), duplicates, (unsigned)stats.retried);
+}
+
+static void scenario_link_loss(void)
+{
+    static const char *topic = "naphome/test/link_loss";
+    const int before_loss = MQTT_PUB_MAX_INFLIGHT;
+    const int during_loss = 10;
+    const int n = before_loss + during_loss;
+    host_mqtt_set_rx_delay_ms(LINK_RTT_MS);
+    subscriber_t sub;
+    CHECK(subscriber_start(&sub, topic), "subscriber could not connect");
+    if (!start_publisher(MQTT_PUB_MAX_INFLIGHT, 10000)) {
+        return;
+    }
+
+    // Drop the link with a full window awaiting PUBACK
+    for (int i = 0; i < before_loss; i++) {
+        publish_seq(topic, i);
+    }
+    vTaskDelay(pdMS_TO_TICKS(LINK_RTT_MS / 4));
+    mqtt_publisher_simulate_link_loss();
+    for (int i = before_loss; i < n; i++) {
+        publish_seq(topic, i);
+    }
+    CHECK(mqtt_publisher_wait_drained(10000), "queue did not drain after the outage");
+    CHECK(subscriber_wait(&sub, n, 2000), "messages lost in the outage");
+
+    mqtt_publisher_stats_t stats;
+    mqtt_publisher_get_stats(&stats);
+    int missing, duplicates;
+    subscriber_tally(&sub, n, &missing, &duplicates);
+    CHECK(stats.reconnects == 1, "%u reconnects", (unsigned)stats.reconnects);
+    CHECK(stats.retried == 0, "%u publisher retries", (unsigned)stats.retried);
+    CHECK(duplicates <= MQTT_PUB_MAX_INFLIGHT, "%d duplicates, more than the window", duplicates);
+    CHECK(stats.acked == (uint32_t)n, "%u of %d acked", (unsigned)stats.acked, n);
+    printf("link loss: recovered in %u ms (backoff 200 ms +/-25%%), %d/%d delivered, %d duplicates "
+           "from the outbox, %u publisher retries\n",
+           (unsigned)stats.last_recovery_ms, n - missing, n, duplicates, (unsigned)stats.retried);
+}
+
+static void scenario_outbox_expiry(void)
+{
+    // An outage longer than the outbox keeps messages: esp-mqtt deletes them
+    // and the publisher has to send them again
+    static const char *topic = "naphome/test/expiry";
+    const int n = MQTT_PUB_MAX_INFLIGHT;
+    host_mqtt_set_rx_delay_ms(50);
+    host_mqtt_set_outbox_expiry_ms(300);
+    subscriber_t sub;
+    CHECK(subscriber_start(&sub, topic), "subscriber could not connect");
+    if (!start_publisher(MQTT_PUB_MAX_INFLIGHT, 10000)) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        publish_seq(topic, i);
+    }
+    vTaskDelay(pdMS_TO_TICKS(5));
+    host_mqtt_set_reachable(false);
+    mqtt_publisher_simulate_link_loss();
+    vTaskDelay(pdMS_TO_TICKS(600));
+    host_mqtt_set_reachable(true);
+
+    CHECK(mqtt_publisher_wait_drained(10000), "queue did not drain");
+    CHECK(subscriber_wait(&sub, n, 2000), "expired messages were not sent again");
+    mqtt_publisher_stats_t stats;
+    mqtt_publisher_get_stats(&stats);
+    int missing, duplicates;
+    subscriber_tally(&sub, n, &missing, &duplicates);
+    CHECK(stats.retried > 0, "no outbox expiry seen; the scenario did not exercise MQTT_EVENT_DELETED");
+    CHECK(stats.acked == (uint32_t)n, "%u of %d acked", (unsigned)stats.acked, n);
+    printf("outbox expiry: %u messages re-sent after MQTT_EVENT_DELETED, %d/%d delivered\n",
+           (unsigned)stats.retried, n - missing, n);
+}
+
+static void scenario_spill(void)
+{
+    // Broker unreachable: messages beyond the spill threshold go to NVS, on
+    // the publisher task, while publish() keeps returning at RAM speed
+    static const char *topic = "naphome/test/spill";
+    host_mqtt_set_rx_delay_ms(5);
+    subscriber_t sub;
+    CHECK(subscriber_start(&sub, topic), "subscriber could not connect");
+    if (!start_publisher(MQTT_PUB_MAX_INFLIGHT, 10000)) {
+        return;
+    }
+    host_nvs_set_write_delay_ms(NVS_WRITE_MS);
+    host_mqtt_set_reachable(false);
+    mqtt_publisher_simulate_link_loss();
+    vTaskDelay(pdMS_TO_TICKS(20));
+
+    int64_t worst_us = 0;
+    int64_t total_us = 0;
+    for (int i = 0; i < SPILL_MESSAGES; i++) {
+        int64_t us = publish_seq(topic, i);
+        total_us += us;
+        if (us > worst_us) {
+            worst_us = us;
+        }
+        usleep(SPILL_PERIOD_MS * 1000);
+    }
+    mqtt_publisher_stats_t stats;
+    mqtt_publisher_get_stats(&stats);
+    CHECK(stats.spilled > 0, "nothing spilled to flash");
+    CHECK(stats.dropped == 0, "%u messages dropped", (unsigned)stats.dropped);
+    CHECK(worst_us < NVS_WRITE_MS * 1000 / 2, "publish() took %lld us while spilling; NVS write is %d ms",
+          (long long)worst_us, NVS_WRITE_MS);
+    uint32_t spilled = stats.spilled;
+    printf("spill: %u of %d messages to flash (%d ms per NVS write), publish() mean %.1f us, worst %lld us\n",
+           (unsigned)spilled, SPILL_MESSAGES, NVS_WRITE_MS, (double)total_us / SPILL_MESSAGES, (long long)worst_us);
+
+    // Let the last spill finish so only the drain's writes are counted
+    while (stats.ram_depth >= MQTT_PUB_SPILL_THRESHOLD) {
+        vTaskDelay(pdMS_TO_TICKS(NVS_WRITE_MS));
+        mqtt_publisher_get_stats(&stats);
+    }
+    vTaskDelay(pdMS_TO_TICKS(NVS_WRITE_MS * 4));
+    uint32_t writes_before = host_nvs_write_count();
+    host_mqtt_set_reachable(true);
+    CHECK(mqtt_publisher_wait_drained(20000), "queue did not drain from flash");
+    CHECK(subscriber_wait(&sub, SPILL_MESSAGES, 2000), "spilled messages missing");
+    uint32_t drain_writes = host_nvs_write_count() - writes_before;
+
+    // Oldest first: flash, then RAM
+    int missing, duplicates;
+    subscriber_tally(&sub, SPILL_MESSAGES, &missing, &duplicates);
+    pthread_mutex_lock(&sub.lock);
+    int out_of_order = 0;
+    for (size_t i = 1; i < sub.deliveries; i++) {
+        out_of_order += sub.order[i] < sub.order[i - 1];
+    }
+    pthread_mutex_unlock(&sub.lock);
+    CHECK(out_of_order == 0 && duplicates == 0, "%d out of order, %d duplicates", out_of_order, duplicates);
+
+    // Head index committed every 8 reads (3 NVS writes each) plus once when empty
+    uint32_t commit_limit = 3 * (spilled / 8 + 1);
+    CHECK(drain_writes <= commit_limit, "%u NVS writes to drain %u messages, expected at most %u",
+          (unsigned)drain_writes, (unsigned)spilled, (unsigned)commit_limit);
+    printf("spill drain: %d/%d delivered in order, %u NVS writes for %u flash reads\n",
+           SPILL_MESSAGES - missing, SPILL_MESSAGES, (unsigned)drain_writes, (unsigned)spilled);
+}
+
+static void run_isolated(const char *name, void (*scenario)(void *), void *arg)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        esp_log_level_set("*", ESP_LOG_WARN);
+        scenario(arg);
+        fflush(stdout);
+        fflush(stderr);
+        _exit(host_test_failures ? 1 : 0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0, "scenario %s failed", name);
+}
+
+static void run_throughput(void *arg)
+{
+    scenario_throughput((size_t)(uintptr_t)arg);
+}
+
+static void run_plain(void *arg)
+{
+    ((void (*)(void))arg)();
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s mqtt://host:port  (or run through mqtt_standin.py --exec)\n", argv[0]);
+        return 2;
+    }
+    broker_uri = argv[1];
+    results = mmap(NULL, sizeof(*results), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    run_isolated("throughput/1", run_throughput, (void *)(uintptr_t)1);
+    run_isolated("throughput/8", run_throughput, (void *)(uintptr_t)MQTT_PUB_MAX_INFLIGHT);
+    run_isolated("slow_acks", run_plain, (void *)scenario_slow_acks);
+    run_isolated("link_loss", run_plain, (void *)scenario_link_loss);
+    run_isolated("outbox_expiry", run_plain, (void *)scenario_outbox_expiry);
+    run_isolated("spill", run_plain, (void *)scenario_spill);
+
+    double one = results->msgs_per_sec[1];
+    double window = results->msgs_per_sec[MQTT_PUB_MAX_INFLIGHT];
+    CHECK(one > 0 && window > 3 * one, "%d in flight gave %.1f msg/s against %.1f with one",
+          MQTT_PUB_MAX_INFLIGHT, window, one);
+    if (one > 0) {
+        printf("pipelining: %.1fx the throughput of one publish at a time\n", window / one);
+    }
+    return host_test_result("test_mqtt_publisher");
+}
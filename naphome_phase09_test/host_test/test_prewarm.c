@@ -0,0 +1,288 @@
+/**
+ * @file test_prewarm.c
+ * @brief prewarm against cloud_standin.py: cloud path time, and the used/wasted/saved metrics
+ *
+ * cloud_standin.py answers the STT, LLM and TTS requests; the host
+ * esp_http_client spends HANDSHAKE_MS on every new connection, as DNS and
+ * TLS to Google would. Each interaction is a wake word (prewarm_start), an
+ * utterance, then the three requests made the way naphome_test_suite.c
+ * makes them: prewarm_take() or a new client, one retry if the warm
+ * connection was dropped. Every utterance length is run cold and warm.
+ *
+ * Usage: test_prewarm <stand-in URL>   (ctest starts the stand-in)
+ */
+
+#include "prewarm.h"
+#include "connectivity.h"
+#include "metrics.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define HANDSHAKE_MS        500     // DNS + TCP + TLS to the cloud host
+#define LLM_THINK_MS        400     // STT reply to LLM request
+#define REQUEST_TIMEOUT_MS  15000
+#define METRICS_TEXT_MAX    8192
+
+static const char *const paths[PREWARM_TARGET_COUNT] = {
+    "/v1/speech:recognize?key=k",
+    "/v1beta/models/gemini:generateContent?key=k",
+    "/v1/text:synthesize?key=k",
+};
+
+static const char *const bodies[PREWARM_TARGET_COUNT] = {
+    "{\"config\":{\"encoding\":\"LINEAR16\"},\"audio\":{\"content\":\"AAAA\"}}",
+    "{\"contents\":[{\"parts\":[{\"text\":\"hi\"}]}]}",
+    "{\"input\":{\"text\":\"hi\"}}",
+};
+
+static const char *base_url;
+
+// The firmware only prewarms with the internet up
+bool connectivity_has(uint32_t state)
+{
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Request path, as in naphome_test_suite.c
+// ---------------------------------------------------------------------------
+
+static esp_http_client_handle_t cloud_client_init(prewarm_target_t target, const esp_http_client_config_t *config,
+                                                  bool *warm)
+{
+    esp_http_client_handle_t client = prewarm_take(target);
+    *warm = (client != NULL);
+    if (!client) {
+        return esp_http_client_init(config);
+    }
+    esp_http_client_set_url(client, config->url);
+    esp_http_client_set_method(client, config->method);
+    esp_http_client_set_timeout_ms(client, config->timeout_ms);
+    return client;
+}
+
+static esp_err_t http_send_json(esp_http_client_handle_t client, const char *body, size_t body_len)
+{
+    esp_err_t err = esp_http_client_open(client, body_len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    int written = esp_http_client_write(client, body, body_len);
+    if (written < 0 || (size_t)written != body_len) {
+        esp_http_client_close(client);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (esp_http_client_fetch_headers(client) < 0) {
+        esp_http_client_close(client);
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    return ESP_OK;
+}
+
+typedef struct {
+    double ms;
+    bool warm;
+    int status;
+} request_t;
+
+static request_t cloud_request(prewarm_target_t target, bool drop_warm)
+{
+    char url[256];
+    snprintf(url, sizeof(url), "%s%s", base_url, paths[target]);
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = REQUEST_TIMEOUT_MS,
+    };
+    request_t r = { .status = -1 };
+    int64_t start = esp_timer_get_time();
+    esp_http_client_handle_t client = cloud_client_init(target, &config, &r.warm);
+    if (!client) {
+        return r;
+    }
+    esp_http_client_set_header(client, "Content-Type", "application/json");
+    if (drop_warm && r.warm) {
+        host_http_client_drop(client);
+    }
+    const char *body = bodies[target];
+    esp_err_t err = http_send_json(client, body, strlen(body));
+    if (err != ESP_OK && r.warm) {
+        // Pre-warmed connection went stale: reconnect once
+        esp_http_client_close(client);
+        err = http_send_json(client, body, strlen(body));
+    }
+    if (err == ESP_OK) {
+        r.status = esp_http_client_get_status_code(client);
+        char chunk[512];
+        while (esp_http_client_read(client, chunk, sizeof(chunk)) > 0) {
+        }
+    }
+    esp_http_client_cleanup(client);
+    r.ms = (esp_timer_get_time() - start) / 1000.0;
+    return r;
+}
+
+// ---------------------------------------------------------------------------
+// Metrics
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char text[METRICS_TEXT_MAX];
+    size_t len;
+} capture_t;
+
+static esp_err_t capture_flush(const char *data, size_t len, void *ctx)
+{
+    capture_t *c = ctx;
+    if (c->len + len >= sizeof(c->text)) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(c->text + c->len, data, len);
+    c->len += len;
+    c->text[c->len] = '\0';
+    return ESP_OK;
+}
+
+static double metric_value(const char *series)
+{
+    static capture_t c;
+    static char buf[1024];
+    c.len = 0;
+    c.text[0] = '\0';
+    if (metrics_write_prometheus(buf, sizeof(buf), capture_flush, &c) != ESP_OK) {
+        return -1;
+    }
+    size_t len = strlen(series);
+    for (const char *line = c.text; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+        if (strncmp(line, series, len) == 0 && line[len] == ' ') {
+            return strtod(line + len + 1, NULL);
+        }
+    }
+    return 0;
+}
+
+typedef struct {
+    double used;
+    double wasted;
+    double failed;
+    double saved_s;
+    double saved_count;
+} prewarm_counts_t;
+
+static prewarm_counts_t prewarm_counts(void)
+{
+    return (prewarm_counts_t){
+        .used = metric_value("naphome_prewarm_total{result=\"used\"}"),
+        .wasted = metric_value("naphome_prewarm_total{result=\"wasted\"}"),
+        .failed = metric_value("naphome_prewarm_total{result=\"failed\"}"),
+        .saved_s = metric_value("naphome_prewarm_saved_seconds_sum"),
+        .saved_count = metric_value("naphome_prewarm_saved_seconds_count"),
+    };
+}
+
+// ---------------------------------------------------------------------------
+// Interactions
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    request_t stt;
+    request_t llm;
+    request_t tts;
+    double path_ms;     // Time spent in the three requests
+} interaction_t;
+
+static interaction_t interaction(uint32_t utterance_ms, bool prewarm)
+{
+    interaction_t i;
+    if (prewarm) {
+        prewarm_start(PREWARM_ALL);     // Wake word
+    }
+    vTaskDelay(pdMS_TO_TICKS(utterance_ms));
+    i.stt = cloud_request(PREWARM_STT, false);
+    vTaskDelay(pdMS_TO_TICKS(LLM_THINK_MS));
+    i.llm = cloud_request(PREWARM_LLM, false);
+    i.tts = cloud_request(PREWARM_TTS, false);
+    i.path_ms = i.stt.ms + i.llm.ms + i.tts.ms;
+    CHECK(i.stt.status == 200 && i.llm.status == 200 && i.tts.status == 200, "statuses %d %d %d", i.stt.status,
+          i.llm.status, i.tts.status);
+    return i;
+}
+
+static void print_interaction(const char *name, const interaction_t *i)
+{
+    printf("  %-26s stt %4.0f%s llm %4.0f%s tts %4.0f%s  cloud path %5.0f ms\n", name, i->stt.ms,
+           i->stt.warm ? "w" : " ", i->llm.ms, i->llm.warm ? "w" : " ", i->tts.ms, i->tts.warm ? "w" : " ",
+           i->path_ms);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <cloud stand-in URL>\n", argv[0]);
+        return 2;
+    }
+    base_url = argv[1];
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    host_http_client_set_connect_delay_ms(HANDSHAKE_MS);
+    CHECK(prewarm_init() == ESP_OK, "prewarm did not start");
+    for (int t = 0; t < PREWARM_TARGET_COUNT; t++) {
+        CHECK(prewarm_set_target(t, base_url, REQUEST_TIMEOUT_MS) == ESP_OK, "target %d not set", t);
+    }
+
+    printf("Cloud path (STT, LLM, TTS; w = warm connection), %d ms per new connection:\n", HANDSHAKE_MS);
+    interaction_t cold_long = interaction(1500, false);
+    print_interaction("cold, 1.5 s utterance", &cold_long);
+    interaction_t warm_long = interaction(1500, true);
+    print_interaction("prewarmed, 1.5 s utterance", &warm_long);
+    interaction_t cold_short = interaction(300, false);
+    print_interaction("cold, 0.3 s utterance", &cold_short);
+    interaction_t warm_short = interaction(300, true);
+    print_interaction("prewarmed, 0.3 s utterance", &warm_short);
+
+    CHECK(!cold_long.stt.warm && !cold_long.llm.warm && !cold_long.tts.warm, "warm connection without a wake word");
+    CHECK(warm_long.stt.warm && warm_long.llm.warm && warm_long.tts.warm, "1.5 s utterance: a request went cold");
+    CHECK(warm_long.path_ms + 2 * HANDSHAKE_MS < cold_long.path_ms, "prewarmed %.0f ms, cold %.0f ms",
+          warm_long.path_ms, cold_long.path_ms);
+    // The handshakes run one after another: later ones may still be in flight
+    CHECK(warm_short.path_ms < cold_short.path_ms, "prewarmed %.0f ms, cold %.0f ms", warm_short.path_ms,
+          cold_short.path_ms);
+    prewarm_counts_t after_cloud = prewarm_counts();
+    CHECK(after_cloud.used == 6 && after_cloud.wasted == 0 && after_cloud.failed == 0,
+          "used %.0f, wasted %.0f, failed %.0f", after_cloud.used, after_cloud.wasted, after_cloud.failed);
+
+    // Handled locally: STT and LLM are cancelled, the spoken reply uses TTS
+    prewarm_start(PREWARM_ALL);
+    vTaskDelay(pdMS_TO_TICKS(4 * HANDSHAKE_MS));
+    prewarm_cancel(PREWARM_BIT(PREWARM_STT) | PREWARM_BIT(PREWARM_LLM));
+    request_t local_tts = cloud_request(PREWARM_TTS, false);
+    prewarm_counts_t after_local = prewarm_counts();
+    CHECK(local_tts.warm && local_tts.status == 200 && local_tts.ms < HANDSHAKE_MS, "local reply: tts %.0f ms warm %d",
+          local_tts.ms, local_tts.warm);
+    CHECK(after_local.wasted - after_cloud.wasted == 2, "%.0f wasted by a local command",
+          after_local.wasted - after_cloud.wasted);
+
+    // The server dropped the idle connection: one retry on a new one
+    prewarm_start(PREWARM_BIT(PREWARM_STT));
+    vTaskDelay(pdMS_TO_TICKS(2 * HANDSHAKE_MS));
+    uint32_t connections = host_http_client_connections();
+    request_t dropped = cloud_request(PREWARM_STT, true);
+    CHECK(dropped.warm && dropped.status == 200, "dropped warm connection: status %d", dropped.status);
+    CHECK(host_http_client_connections() == connections + 1, "retry did not reconnect once");
+
+    prewarm_counts_t counts = prewarm_counts();
+    printf("  local command: tts %.0f ms on the warm connection; dropped warm connection: stt %.0f ms (retried)\n",
+           local_tts.ms, dropped.ms);
+    printf("naphome_prewarm_total used %.0f, wasted %.0f, failed %.0f; saved %.0f ms per used connection\n",
+           counts.used, counts.wasted, counts.failed,
+           counts.saved_count ? counts.saved_s * 1000 / counts.saved_count : 0);
+    CHECK(counts.saved_count == counts.used, "%.0f saved observations, %.0f used", counts.saved_count, counts.used);
+    CHECK(counts.saved_s * 1000 / counts.saved_count > HANDSHAKE_MS / 4, "saved %.0f ms per connection",
+          counts.saved_s * 1000 / counts.saved_count);
+    return host_test_result("test_prewarm");
+}
@@ -0,0 +1,195 @@
+/**
+ * @file test_task_stats.c
+ * @brief task_stats CPU figures against tasks with a known duty cycle
+ *
+ * The host FreeRTOS stand-in reports each thread's CPU clock as its
+ * run-time counter, so the sampler's arithmetic (deltas, per-core idle,
+ * ranking) runs unchanged. Two tasks burn a fixed share of CPU time on
+ * different cores; the reported per-task and per-core usage must match.
+ * What each burner really got is read from its CPU clock at every sample,
+ * so the figures are checked against that rather than the nominal duty
+ * cycle, which a loaded machine (ctest -j) does not hold.
+ */
+
+#include "task_stats.h"
+#include "event_bus.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#define SAMPLE_INTERVAL_MS  200
+#define SAMPLES             10      // Averaged once CPU figures are valid
+#define TASK_TOLERANCE      8.0f    // Percentage points
+#define CORE_TOLERANCE      10.0f
+
+typedef struct {
+    uint32_t busy_ms;
+    uint32_t period_ms;
+    clockid_t clock;            // The burner's thread CPU clock
+    volatile bool started;
+    uint64_t last_cpu_us;       // At the previous sample
+    float measured[SAMPLES];    // Percent of each sample interval it ran
+} duty_t;
+
+static duty_t half = { 5, 10 };
+static duty_t fifth = { 2, 10 };
+
+static SemaphoreHandle_t samples_lock;
+static task_stats_snapshot_t samples[SAMPLES];
+static size_t sample_count = 0;
+static int64_t last_sample_us;
+
+static uint64_t thread_cpu_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static uint64_t clock_us(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static void burn_task(void *arg)
+{
+    duty_t *duty = arg;
+    pthread_getcpuclockid(pthread_self(), &duty->clock);
+    duty->started = true;
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        uint64_t until = thread_cpu_us() + duty->busy_ms * 1000;
+        while (thread_cpu_us() < until) {
+        }
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(duty->period_ms));
+    }
+}
+
+static void sleep_task(void *arg)
+{
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+}
+
+static void on_metrics(event_bus_topic_t topic, const void *data, size_t len, void *ctx)
+{
+    const task_stats_snapshot_t *snapshot = data;
+    int64_t now = esp_timer_get_time();
+    uint64_t half_us = clock_us(half.clock);
+    uint64_t fifth_us = clock_us(fifth.clock);
+    xSemaphoreTake(samples_lock, portMAX_DELAY);
+    if (snapshot->cpu_valid && sample_count < SAMPLES) {
+        float wall_us = (float)(now - last_sample_us);
+        half.measured[sample_count] = 100.0f * (half_us - half.last_cpu_us) / wall_us;
+        fifth.measured[sample_count] = 100.0f * (fifth_us - fifth.last_cpu_us) / wall_us;
+        samples[sample_count++] = *snapshot;
+    }
+    last_sample_us = now;
+    half.last_cpu_us = half_us;
+    fifth.last_cpu_us = fifth_us;
+    xSemaphoreGive(samples_lock);
+}
+
+static float mean_task_cpu(const char *name)
+{
+    float sum = 0.0f;
+    for (size_t i = 0; i < SAMPLES; i++) {
+        for (uint32_t t = 0; t < samples[i].num_tasks; t++) {
+            if (strcmp(samples[i].tasks[t].name, name) == 0) {
+                sum += samples[i].tasks[t].cpu_percent;
+            }
+        }
+    }
+    return sum / SAMPLES;
+}
+
+static float mean_measured(const duty_t *duty)
+{
+    float sum = 0.0f;
+    for (size_t i = 0; i < SAMPLES; i++) {
+        sum += duty->measured[i];
+    }
+    return sum / SAMPLES;
+}
+
+static float mean_core(int core)
+{
+    float sum = 0.0f;
+    for (size_t i = 0; i < SAMPLES; i++) {
+        sum += samples[i].core_usage[core];
+    }
+    return sum / SAMPLES;
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    samples_lock = xSemaphoreCreateMutex();
+    event_bus_subscribe(EVENT_BUS_TOPIC_BIT(EVENT_BUS_TOPIC_METRICS), on_metrics, NULL);
+
+    xTaskCreatePinnedToCore(burn_task, "burn_half", 2048, (void *)&half, 5, NULL, 1);
+    xTaskCreatePinnedToCore(burn_task, "burn_fifth", 2048, (void *)&fifth, 5, NULL, 0);
+    xTaskCreatePinnedToCore(sleep_task, "sleeper", 2048, NULL, 5, NULL, 0);
+    while (!half.started || !fifth.started) {
+        vTaskDelay(1);
+    }
+    CHECK(task_stats_start(SAMPLE_INTERVAL_MS) == ESP_OK, "sampler did not start");
+
+    for (int waited = 0; waited < (SAMPLES + 5) * SAMPLE_INTERVAL_MS; waited += 50) {
+        xSemaphoreTake(samples_lock, portMAX_DELAY);
+        size_t n = sample_count;
+        xSemaphoreGive(samples_lock);
+        if (n == SAMPLES) {
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    CHECK(sample_count == SAMPLES, "only %zu valid samples", sample_count);
+    if (sample_count < SAMPLES) {
+        return host_test_result("test_task_stats");
+    }
+
+    const task_stats_snapshot_t *last = &samples[SAMPLES - 1];
+    for (uint32_t t = 1; t < last->num_tasks; t++) {
+        CHECK(last->tasks[t - 1].cpu_percent >= last->tasks[t].cpu_percent,
+              "tasks not ranked by CPU: %s before %s", last->tasks[t - 1].name, last->tasks[t].name);
+    }
+    CHECK(last->interval_ms >= SAMPLE_INTERVAL_MS - 20 && last->interval_ms <= SAMPLE_INTERVAL_MS + 50,
+          "interval %u ms", (unsigned)last->interval_ms);
+    CHECK(last->heap_internal.total > 0 && last->heap_spiram.total > 0, "heap totals missing");
+
+    float cpu_half = mean_task_cpu("burn_half");
+    float cpu_fifth = mean_task_cpu("burn_fifth");
+    float cpu_sleeper = mean_task_cpu("sleeper");
+    float cpu_sampler = mean_task_cpu("task_stats");
+    float core0 = mean_core(0);
+    float core1 = mean_core(1);
+    float expected_half = mean_measured(&half);
+    float expected_fifth = mean_measured(&fifth);
+    CHECK(fabsf(cpu_half - expected_half) < TASK_TOLERANCE, "burn_half at %.1f%%, its clock says %.1f%%", cpu_half,
+          expected_half);
+    CHECK(fabsf(cpu_fifth - expected_fifth) < TASK_TOLERANCE, "burn_fifth at %.1f%%, its clock says %.1f%%",
+          cpu_fifth, expected_fifth);
+    CHECK(cpu_sleeper < 1.0f, "sleeper at %.1f%%", cpu_sleeper);
+    CHECK(fabsf(core1 - cpu_half) < CORE_TOLERANCE, "core 1 at %.1f%%, its task at %.1f%%", core1, cpu_half);
+    CHECK(fabsf(core0 - cpu_fifth) < CORE_TOLERANCE, "core 0 at %.1f%%, its tasks at %.1f%%", core0, cpu_fifth);
+
+    printf("%u tasks over %d samples of %d ms (thread CPU clocks)\n",
+           (unsigned)last->total_tasks, SAMPLES, SAMPLE_INTERVAL_MS);
+    printf("  burn_half   %5.1f%%  (its clock %.1f%%, nominal 50%%)\n", cpu_half, expected_half);
+    printf("  burn_fifth  %5.1f%%  (its clock %.1f%%, nominal 20%%)\n", cpu_fifth, expected_fifth);
+    printf("  sleeper     %5.1f%%\n", cpu_sleeper);
+    printf("  task_stats  %5.2f%%  (the sampler itself)\n", cpu_sampler);
+    printf("  core 0      %5.1f%%   core 1 %5.1f%%\n", core0, core1);
+    return host_test_result("test_task_stats");
+}
@@ -0,0 +1,258 @@
+/**
+ * @file test_telemetry.c
+ * @brief Telemetry batch bounds, and bytes and encode time per sample
+ *
+ * Checks that no batch exceeds max_bytes even for worst-case samples, then
+ * compares bytes and CPU time per sample for columnar CBOR, compact JSON
+ * and (when built with cJSON) the pretty-printed cJSON snapshot Test 12
+ * used to build for every sample.
+ */
+
+#include "telemetry.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host_test.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CJSON
+#include "cJSON.h"
+#endif
+
+#define BENCH_BATCHES   2000    // Batches encoded per timed format
+
+// Mirrors the worst-case sizes in telemetry.c
+#define CBOR_HEADER_MAX 112
+#define CBOR_SAMPLE_MAX 49
+#define SAMPLE_PERIOD_S 30      // Matches TELEMETRY_SAMPLE_INTERVAL_MS
+
+typedef struct {
+    size_t batches;
+    size_t samples;
+    size_t bytes;
+    size_t max_len;
+} sink_tally_t;
+
+static void tally_sink(const uint8_t *data, size_t len, telemetry_format_t format, void *ctx)
+{
+    sink_tally_t *tally = ctx;
+    tally->batches++;
+    tally->bytes += len;
+    if (len > tally->max_len) {
+        tally->max_len = len;
+    }
+}
+
+// Slowly drifting readings from all four sensors, as the sampler produces
+static void realistic_sample(telemetry_sample_t *s, uint32_t i)
+{
+    memset(s, 0, sizeof(*s));
+    s->timestamp = 1700000000u + i * SAMPLE_PERIOD_S;
+    s->valid_mask = TELEMETRY_SENSOR_SHT30 | TELEMETRY_SENSOR_SGP30 | TELEMETRY_SENSOR_BH1750 | TELEMETRY_SENSOR_SCD30;
+    s->hardware_mask = s->valid_mask;
+    s->temperature_c = 21.5f + 0.8f * sinf(i / 40.0f) + (rand() % 5) * 0.01f;
+    s->humidity_rh = 44.0f + 3.0f * sinf(i / 55.0f) + (rand() % 9) * 0.01f;
+    s->tvoc_ppb = 30 + (uint16_t)(rand() % 20);
+    s->eco2_ppm = 420 + (uint16_t)(rand() % 40);
+    s->lux = 180.0f + 60.0f * sinf(i / 90.0f) + (rand() % 7);
+    s->co2_ppm = 610.0f + 80.0f * sinf(i / 70.0f) + (rand() % 5);
+    s->scd30_temperature_c = s->temperature_c + 0.4f;
+    s->scd30_humidity_rh = s->humidity_rh - 1.5f;
+}
+
+// Largest encoding of every field: alternating extremes, all mask bits set,
+// timestamps far enough apart that each delta needs a 32-bit integer
+static void worst_sample(telemetry_sample_t *s, uint32_t i)
+{
+    float sign = (i & 1) ? 1.0f : -1.0f;
+    memset(s, 0, sizeof(*s));
+    s->timestamp = 1000000000u + i * 100000u;
+    s->valid_mask = 0xFF;
+    s->hardware_mask = 0xFF;
+    s->temperature_c = sign * 2.0e7f;
+    s->humidity_rh = sign * 2.0e7f;
+    s->tvoc_ppb = (i & 1) ? 0xFFFF : 0;
+    s->eco2_ppm = (i & 1) ? 0xFFFF : 0;
+    s->lux = sign * 1.0e9f;
+    s->co2_ppm = sign * 1.0e9f;
+    s->scd30_temperature_c = sign * 2.0e7f;
+    s->scd30_humidity_rh = sign * 2.0e7f;
+}
+
+static void check_size_bounds(void)
+{
+    // Worst-case batch of every size against the bound telemetry.c flushes on
+    const char *device_id = ((telemetry_config_t)TELEMETRY_DEFAULT_CONFIG()).device_id;
+    size_t min_slack = SIZE_MAX;
+    size_t min_slack_at = 0;
+    size_t first_len = 0;
+    size_t full_len = 0;
+    for (size_t n = 1; n <= TELEMETRY_MAX_BATCH_SAMPLES; n++) {
+        sink_tally_t tally = {0};
+        telemetry_config_t config = TELEMETRY_DEFAULT_CONFIG();
+        config.max_bytes = TELEMETRY_MAX_BATCH_BYTES;
+        config.sink = tally_sink;
+        config.sink_ctx = &tally;
+        telemetry_init(&config);
+        for (uint32_t i = 0; i < n; i++) {
+            telemetry_sample_t s;
+            worst_sample(&s, i);
+            telemetry_add_sample(&s);
+        }
+        telemetry_flush();
+
+        size_t bound = CBOR_HEADER_MAX + strlen(device_id) + n * CBOR_SAMPLE_MAX;
+        CHECK(tally.max_len <= bound, "%zu worst-case samples encode to %zu bytes, bound is %zu",
+              n, tally.max_len, bound);
+        if (tally.max_len <= bound && bound - tally.max_len < min_slack) {
+            min_slack = bound - tally.max_len;
+            min_slack_at = n;
+        }
+        if (n == 1) {
+            first_len = tally.max_len;
+        }
+        full_len = tally.max_len;
+    }
+    printf("worst-case CBOR: %zu bytes for 1 sample, %zu for %d; tightest bound at n=%zu (%zu bytes spare)\n",
+           first_len, full_len, TELEMETRY_MAX_BATCH_SAMPLES, min_slack_at, min_slack);
+
+    // The flush decision must keep every batch under max_bytes, for any limit
+    for (size_t max_bytes = 320; max_bytes <= 1600; max_bytes += 7) {
+        for (int format = TELEMETRY_FORMAT_CBOR; format <= TELEMETRY_FORMAT_JSON; format++) {
+            sink_tally_t tally = {0};
+            telemetry_config_t config = TELEMETRY_DEFAULT_CONFIG();
+            config.format = format;
+            config.max_bytes = max_bytes;
+            config.sink = tally_sink;
+            config.sink_ctx = &tally;
+            telemetry_init(&config);
+            telemetry_stats_t before;
+            telemetry_get_stats(&before);
+            for (uint32_t i = 0; i < 100; i++) {
+                telemetry_sample_t s;
+                worst_sample(&s, i);
+                telemetry_add_sample(&s);
+            }
+            telemetry_flush();
+            telemetry_stats_t stats;
+            telemetry_get_stats(&stats);
+            CHECK(stats.dropped == before.dropped, "%s max_bytes %zu: %u batches dropped",
+                  format ? "JSON" : "CBOR", max_bytes, (unsigned)(stats.dropped - before.dropped));
+            CHECK(tally.max_len <= max_bytes, "%s max_bytes %zu: batch of %zu bytes",
+                  format ? "JSON" : "CBOR", max_bytes, tally.max_len);
+            CHECK(stats.samples - before.samples == 100, "%s max_bytes %zu: %u of 100 samples flushed",
+                  format ? "JSON" : "CBOR", max_bytes, (unsigned)(stats.samples - before.samples));
+        }
+    }
+}
+
+static void bench_format(telemetry_format_t format, const char *label)
+{
+    sink_tally_t tally = {0};
+    telemetry_config_t config = TELEMETRY_DEFAULT_CONFIG();
+    config.format = format;
+    config.max_bytes = TELEMETRY_MAX_BATCH_BYTES;
+    config.sink = tally_sink;
+    config.sink_ctx = &tally;
+    telemetry_init(&config);
+    telemetry_stats_t before;
+    telemetry_get_stats(&before);
+
+    srand(1);
+    uint32_t i = 0;
+    int64_t start = esp_timer_get_time();
+    for (int b = 0; b < BENCH_BATCHES; b++) {
+        for (int k = 0; k < TELEMETRY_MAX_BATCH_SAMPLES; k++) {
+            telemetry_sample_t s;
+            realistic_sample(&s, i++);
+            telemetry_add_sample(&s);
+        }
+        telemetry_flush();
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    telemetry_stats_t stats;
+    telemetry_get_stats(&stats);
+    CHECK(stats.samples - before.samples == i, "%s: %u of %u samples flushed",
+          label, (unsigned)(stats.samples - before.samples), (unsigned)i);
+    printf("%-34s %6.1f bytes/sample  %6.3f us/sample  (%zu-sample batches of %zu bytes)\n",
+           label, (double)tally.bytes / i, (double)elapsed / i,
+           (size_t)TELEMETRY_MAX_BATCH_SAMPLES, tally.bytes / tally.batches);
+}
+
+#ifdef HAVE_CJSON
+// The per-sample snapshot Test 12 built before the telemetry pipeline
+static size_t cjson_snapshot(const telemetry_sample_t *s)
+{
+    cJSON *telemetry = cJSON_CreateObject();
+    char timestamp_str[64];
+    snprintf(timestamp_str, sizeof(timestamp_str), "%ld", (long)s->timestamp);
+    cJSON_AddStringToObject(telemetry, "timestamp", timestamp_str);
+    cJSON_AddStringToObject(telemetry, "device_id", "naphome-0.9");
+
+    cJSON *sht30 = cJSON_CreateObject();
+    cJSON_AddNumberToObject(sht30, "temperature_c", s->temperature_c);
+    cJSON_AddNumberToObject(sht30, "humidity_rh", s->humidity_rh);
+    cJSON_AddBoolToObject(sht30, "hardware_present", true);
+    cJSON_AddItemToObject(telemetry, "sht30", sht30);
+
+    cJSON *sgp30 = cJSON_CreateObject();
+    cJSON_AddNumberToObject(sgp30, "tvoc_ppb", s->tvoc_ppb);
+    cJSON_AddNumberToObject(sgp30, "eco2_ppm", s->eco2_ppm);
+    cJSON_AddBoolToObject(sgp30, "hardware_present", true);
+    cJSON_AddItemToObject(telemetry, "sgp30", sgp30);
+
+    cJSON *bh1750 = cJSON_CreateObject();
+    cJSON_AddNumberToObject(bh1750, "lux", s->lux);
+    cJSON_AddBoolToObject(bh1750, "hardware_present", true);
+    cJSON_AddItemToObject(telemetry, "bh1750", bh1750);
+
+    cJSON *scd30 = cJSON_CreateObject();
+    cJSON_AddNumberToObject(scd30, "co2_ppm", s->co2_ppm);
+    cJSON_AddNumberToObject(scd30, "temperature_c", s->scd30_temperature_c);
+    cJSON_AddNumberToObject(scd30, "humidity_rh", s->scd30_humidity_rh);
+    cJSON_AddBoolToObject(scd30, "hardware_present", true);
+    cJSON_AddItemToObject(telemetry, "scd30", scd30);
+
+    char *json_string = cJSON_Print(telemetry);
+    size_t len = json_string ? strlen(json_string) : 0;
+    cJSON_free(json_string);
+    cJSON_Delete(telemetry);
+    return len;
+}
+
+static void bench_cjson(void)
+{
+    srand(1);
+    size_t bytes = 0;
+    uint32_t n = BENCH_BATCHES * TELEMETRY_MAX_BATCH_SAMPLES;
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < n; i++) {
+        telemetry_sample_t s;
+        realistic_sample(&s, i);
+        bytes += cjson_snapshot(&s);
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    printf("%-34s %6.1f bytes/sample  %6.3f us/sample  (one document per sample)\n",
+           "cJSON_Print snapshot (before)", (double)bytes / n, (double)elapsed / n);
+}
+#endif
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    check_size_bounds();
+
+#ifdef HAVE_CJSON
+    bench_cjson();
+#else
+    printf("cJSON_Print snapshot (before)      not built: point CJSON_DIR at ESP-IDF's components/json/cJSON\n");
+#endif
+    bench_format(TELEMETRY_FORMAT_JSON, "compact JSON batch (debug)");
+    bench_format(TELEMETRY_FORMAT_CBOR, "columnar CBOR batch (uplink)");
+
+    return host_test_result("test_telemetry");
+}
@@ -0,0 +1,316 @@
+/**
+ * @file test_trace.c
+ * @brief Trace ring under a simulated voice pipeline and under contention
+ *
+ * Detect, cloud and audio tasks replay the stages the firmware records
+ * (endpoint, flac, stt, llm, tts, audio_play) with fixed simulated
+ * latencies; each interaction must read back whole, in order and with
+ * the simulated durations, no shorter than simulated and no longer than
+ * the stage had run once it was recorded (a loaded machine oversleeps, so
+ * there is no fixed allowance). Four writers then hammer the ring while a
+ * reader walks it: no event may come back torn, and the overwrite count
+ * must account for everything that was pushed out.
+ */
+
+#include "trace.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#define INTERACTIONS        4
+#define AUDIO_WRITES        4
+
+#define STRESS_WRITERS      4
+#define STRESS_SPANS        200000  // Per writer
+#define BENCH_SPANS         2000000
+
+// Simulated stage latencies, in ms
+typedef struct {
+    const char *name;
+    uint32_t ms;
+} stage_t;
+
+static const stage_t endpoint_stage = { "endpoint", 40 };
+static const stage_t cloud_stages[] = { { "flac", 10 }, { "stt", 60 }, { "llm", 80 } };
+static const stage_t first_audio_stage = { "tts_first_audio", 30 };
+static const stage_t audio_stage = { "audio_play", 5 };
+
+// Order the events of one interaction are recorded in (spans at their end)
+static const char *const expected_order[] = {
+    "wake_word", "endpoint", "flac", "stt", "llm", "tts_first_audio",
+    "audio_play", "audio_play", "audio_play", "audio_play", "tts", "stt_llm_tts_task",
+};
+#define EXPECTED_EVENTS (sizeof(expected_order) / sizeof(expected_order[0]))
+
+// Per interaction, in recording order: how long each stage had run once
+// trace_span_since() returned, the most its span may report
+static int64_t observed_us[INTERACTIONS + 1][EXPECTED_EVENTS];
+static size_t observed_count[INTERACTIONS + 1];
+
+static QueueHandle_t cloud_queue;
+static QueueHandle_t audio_queue;
+static SemaphoreHandle_t audio_done;
+static SemaphoreHandle_t interaction_done;
+static SemaphoreHandle_t pipeline_done;
+
+// trace_span_since(), noting the time it returned; the tasks take turns
+// within an interaction, so events are noted in the order they are recorded
+static void stage_end(uint32_t interaction, const char *name, int64_t start)
+{
+    trace_span_since(interaction, name, start);
+    size_t slot = interaction % (INTERACTIONS + 1);
+    if (observed_count[slot] < EXPECTED_EVENTS) {
+        observed_us[slot][observed_count[slot]] = esp_timer_get_time() - start;
+    }
+    observed_count[slot]++;
+}
+
+static void instant(uint32_t interaction, const char *name)
+{
+    trace_instant(interaction, name);
+    observed_count[interaction % (INTERACTIONS + 1)]++;
+}
+
+static void audio_task(void *arg)
+{
+    uint32_t interaction;
+    while (xQueueReceive(audio_queue, &interaction, portMAX_DELAY) == pdTRUE) {
+        for (int i = 0; i < AUDIO_WRITES; i++) {
+            int64_t start = esp_timer_get_time();
+            vTaskDelay(pdMS_TO_TICKS(audio_stage.ms));
+            stage_end(interaction, audio_stage.name, start);
+        }
+        xSemaphoreGive(audio_done);
+    }
+}
+
+static void cloud_task(void *arg)
+{
+    uint32_t interaction;
+    while (xQueueReceive(cloud_queue, &interaction, portMAX_DELAY) == pdTRUE) {
+        int64_t task_start = esp_timer_get_time();
+        for (size_t i = 0; i < sizeof(cloud_stages) / sizeof(cloud_stages[0]); i++) {
+            int64_t start = esp_timer_get_time();
+            vTaskDelay(pdMS_TO_TICKS(cloud_stages[i].ms));
+            stage_end(interaction, cloud_stages[i].name, start);
+        }
+        int64_t tts_start = esp_timer_get_time();
+        vTaskDelay(pdMS_TO_TICKS(first_audio_stage.ms));
+        instant(interaction, first_audio_stage.name);
+        xQueueSend(audio_queue, &interaction, portMAX_DELAY);
+        xSemaphoreTake(audio_done, portMAX_DELAY);
+        stage_end(interaction, "tts", tts_start);
+        stage_end(interaction, "stt_llm_tts_task", task_start);
+        xSemaphoreGive(interaction_done);
+    }
+}
+
+static void detect_task(void *arg)
+{
+    uint32_t *ids = arg;
+    for (int i = 0; i < INTERACTIONS; i++) {
+        ids[i] = trace_begin_interaction();
+        observed_count[ids[i] % (INTERACTIONS + 1)] = 1;  // wake_word
+        int64_t wake_us = esp_timer_get_time();
+        vTaskDelay(pdMS_TO_TICKS(endpoint_stage.ms));
+        stage_end(ids[i], endpoint_stage.name, wake_us);
+        xQueueSend(cloud_queue, &ids[i], portMAX_DELAY);
+        xSemaphoreTake(interaction_done, portMAX_DELAY);
+    }
+    xSemaphoreGive(pipeline_done);
+    vTaskDelete(NULL);
+}
+
+typedef struct {
+    trace_event_t events[EXPECTED_EVENTS + 4];
+    size_t count;
+} collected_t;
+
+static void collect(const trace_event_t *event, void *ctx)
+{
+    collected_t *c = ctx;
+    if (c->count < sizeof(c->events) / sizeof(c->events[0])) {
+        c->events[c->count] = *event;
+    }
+    c->count++;
+}
+
+static uint32_t simulated_ms(const char *name)
+{
+    if (strcmp(name, endpoint_stage.name) == 0) {
+        return endpoint_stage.ms;
+    }
+    for (size_t i = 0; i < sizeof(cloud_stages) / sizeof(cloud_stages[0]); i++) {
+        if (strcmp(name, cloud_stages[i].name) == 0) {
+            return cloud_stages[i].ms;
+        }
+    }
+    if (strcmp(name, audio_stage.name) == 0) {
+        return audio_stage.ms;
+    }
+    if (strcmp(name, "tts") == 0) {
+        return first_audio_stage.ms + AUDIO_WRITES * audio_stage.ms;
+    }
+    return 0;
+}
+
+static void check_pipeline(void)
+{
+    uint32_t ids[INTERACTIONS];
+    cloud_queue = xQueueCreate(2, sizeof(uint32_t));
+    audio_queue = xQueueCreate(2, sizeof(uint32_t));
+    audio_done = xSemaphoreCreateBinary();
+    interaction_done = xSemaphoreCreateBinary();
+    pipeline_done = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(audio_task, "audio", 4096, NULL, 6, NULL, 0);
+    xTaskCreatePinnedToCore(cloud_task, "cloud", 4096, NULL, 5, NULL, 1);
+    xTaskCreatePinnedToCore(detect_task, "detect", 4096, ids, 5, NULL, 1);
+    xSemaphoreTake(pipeline_done, portMAX_DELAY);
+
+    printf("%-18s", "stage (ms)");
+    for (int i = 0; i < INTERACTIONS; i++) {
+        printf("  #%-6u", (unsigned)ids[i]);
+    }
+    printf("\n");
+
+    collected_t per[INTERACTIONS];
+    for (int i = 0; i < INTERACTIONS; i++) {
+        memset(&per[i], 0, sizeof(per[i]));
+        trace_foreach(ids[i], collect, &per[i]);
+        CHECK(per[i].count == EXPECTED_EVENTS, "interaction %u: %zu events, expected %zu",
+              (unsigned)ids[i], per[i].count, EXPECTED_EVENTS);
+        if (per[i].count != EXPECTED_EVENTS) {
+            continue;
+        }
+        const trace_event_t *ev = per[i].events;
+        for (size_t e = 0; e < EXPECTED_EVENTS; e++) {
+            CHECK(strcmp(ev[e].name, expected_order[e]) == 0, "interaction %u event %zu: %s, expected %s",
+                  (unsigned)ids[i], e, ev[e].name, expected_order[e]);
+            CHECK(ev[e].interaction == ids[i], "event tagged %u", (unsigned)ev[e].interaction);
+            uint32_t ms = simulated_ms(ev[e].name);
+            if (ms) {
+                int64_t observed = observed_us[ids[i] % (INTERACTIONS + 1)][e];
+                CHECK(ev[e].phase == TRACE_SPAN && ev[e].dur_us >= ms * 1000 && ev[e].dur_us <= observed,
+                      "%s took %u us, simulated %u ms, %lld us by the time it was recorded", ev[e].name,
+                      (unsigned)ev[e].dur_us, (unsigned)ms, (long long)observed);
+            }
+        }
+        CHECK(ev[0].phase == TRACE_INSTANT && ev[5].phase == TRACE_INSTANT, "wake_word/tts_first_audio not instants");
+        CHECK(ev[1].core == 1 && ev[6].core == 0, "cores: endpoint on %u, audio_play on %u", ev[1].core, ev[6].core);
+        // The task span encloses every cloud stage, and the endpoint ends before it starts
+        const trace_event_t *task = &ev[EXPECTED_EVENTS - 1];
+        for (size_t e = 2; e < EXPECTED_EVENTS - 1; e++) {
+            int64_t end = ev[e].start_us + ev[e].dur_us;
+            CHECK(ev[e].start_us >= task->start_us && end <= task->start_us + task->dur_us,
+                  "%s outside stt_llm_tts_task", ev[e].name);
+        }
+        CHECK(ev[1].start_us + ev[1].dur_us <= task->start_us, "endpoint overlaps the cloud task");
+    }
+
+    static const char *const rows[] = { "endpoint", "flac", "stt", "llm", "tts", "stt_llm_tts_task" };
+    for (size_t r = 0; r < sizeof(rows) / sizeof(rows[0]); r++) {
+        printf("%-18s", rows[r]);
+        for (int i = 0; i < INTERACTIONS; i++) {
+            double ms = 0;
+            for (size_t e = 0; e < per[i].count && e < EXPECTED_EVENTS; e++) {
+                if (strcmp(per[i].events[e].name, rows[r]) == 0) {
+                    ms = per[i].events[e].dur_us / 1000.0;
+                }
+            }
+            printf("  %7.1f", ms);
+        }
+        printf("\n");
+    }
+}
+
+// Each writer records spans whose fields are all derived from its index,
+// so any mix of two writes in one slot is detectable
+static const char *const writer_names[STRESS_WRITERS] = { "w0", "w1", "w2", "w3" };
+static atomic_int writers_running;
+
+static void writer_task(void *arg)
+{
+    uint32_t w = (uint32_t)(uintptr_t)arg;
+    for (uint32_t i = 0; i < STRESS_SPANS; i++) {
+        int64_t start = (int64_t)i * STRESS_WRITERS + w;
+        trace_span(1000 + w, writer_names[w], start, start + 10 * (w + 1));
+    }
+    atomic_fetch_sub(&writers_running, 1);
+    vTaskDelete(NULL);
+}
+
+typedef struct {
+    uint32_t visited;
+    uint32_t torn;
+} stress_scan_t;
+
+static void stress_visit(const trace_event_t *event, void *ctx)
+{
+    stress_scan_t *scan = ctx;
+    scan->visited++;
+    if (event->interaction < 1000) {
+        return;     // Pipeline events still in the ring
+    }
+    uint32_t w = event->interaction - 1000;
+    if (w >= STRESS_WRITERS || event->name != writer_names[w] || event->dur_us != 10 * (w + 1) ||
+        event->start_us % STRESS_WRITERS != w || event->phase != TRACE_SPAN) {
+        scan->torn++;
+    }
+}
+
+static void check_stress(void)
+{
+    atomic_store(&writers_running, STRESS_WRITERS);
+    for (uint32_t w = 0; w < STRESS_WRITERS; w++) {
+        xTaskCreatePinnedToCore(writer_task, "writer", 4096, (void *)(uintptr_t)w, 5, NULL, w & 1);
+    }
+
+    stress_scan_t scan = {0};
+    uint32_t scans = 0;
+    while (atomic_load(&writers_running) > 0) {
+        trace_foreach(0, stress_visit, &scan);
+        scans++;
+    }
+    CHECK(scan.torn == 0, "%u torn events in %u scans", (unsigned)scan.torn, (unsigned)scans);
+
+    stress_scan_t final = {0};
+    uint32_t dropped = trace_foreach(0, stress_visit, &final);
+    CHECK(final.visited == TRACE_RING_SIZE, "%u events retained, ring holds %d", (unsigned)final.visited, TRACE_RING_SIZE);
+    CHECK(final.torn == 0, "%u torn events at rest", (unsigned)final.torn);
+    uint32_t pushed = INTERACTIONS * EXPECTED_EVENTS + STRESS_WRITERS * STRESS_SPANS;
+    CHECK(dropped == pushed - TRACE_RING_SIZE, "%u overwritten, expected %u",
+          (unsigned)dropped, (unsigned)(pushed - TRACE_RING_SIZE));
+    printf("%d writers x %d spans, %u concurrent scans (%u events read): 0 torn, %u overwritten\n",
+           STRESS_WRITERS, STRESS_SPANS, (unsigned)scans, (unsigned)scan.visited, (unsigned)dropped);
+}
+
+static void bench(void)
+{
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCH_SPANS; i++) {
+        trace_span(1, "bench", i, i + 10);
+    }
+    double ns = (esp_timer_get_time() - start) * 1000.0 / BENCH_SPANS;
+    printf("trace_span               %5.1f ns/event\n", ns);
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    trace_span(1, "before_init", 0, 10);
+    CHECK(trace_foreach(0, collect, &(collected_t){0}) == 0, "recorded before trace_init");
+    CHECK(trace_current() == 0, "interaction before the first wake word");
+    CHECK(trace_init() == ESP_OK, "trace_init failed");
+
+    check_pipeline();
+    check_stress();
+    bench();
+    return host_test_result("test_trace");
+}
@@ -0,0 +1,188 @@
+/**
+ * @file test_web_assets.c
+ * @brief Dashboard asset negotiation, and request time per client encoding
+ *
+ * Runs web_asset_get_handler on the table gen_web_assets.py builds from
+ * main/www. Clients that accept gzip get the compressed stream, others the
+ * identity copy; both carry Vary: Accept-Encoding and their own ETag.
+ * The benchmark times the handler and adds the transfer time of the bytes
+ * it sends over a modelled Wi-Fi link, for a cold page load and a reload
+ * that revalidates by ETag.
+ */
+
+#include "web_asset_handler.h"
+#include "web_assets.h"
+#include "esp_timer.h"
+#include "host_test.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define BENCH_ROUNDS    20000   // Handler calls per timed case
+#define LINK_KBPS       2000    // Sustained TCP throughput of the device's httpd over Wi-Fi
+#define LINK_RTT_MS     8       // One request/response turn on a home network
+
+typedef struct {
+    const char *accept_encoding;
+    bool gzip;
+} accept_case_t;
+
+static const accept_case_t accept_cases[] = {
+    { NULL, false },                        // curl, wget, scripts
+    { "", false },
+    { "identity", false },
+    { "gzip", true },
+    { "gzip, deflate, br, zstd", true },    // Current browsers
+    { "GZIP", true },
+    { "x-gzip", true },
+    { "deflate, br", false },
+    { "gzip;q=0", false },
+    { "gzip; q=0.5, br", true },
+    { "gzipx", false },
+    { "*", true },
+    { "*;q=0", false },
+    { "br, *;q=0.1", true },
+    { "gzip;q=0, *", false },               // An explicit refusal beats the wildcard
+};
+
+static void request(httpd_req_t *req, const web_asset_t *asset, const char *accept_encoding,
+                    const char *if_none_match)
+{
+    host_httpd_req_init(req, HTTP_GET, asset->uri, NULL, 0, (void *)asset);
+    if (accept_encoding) {
+        host_httpd_req_add_hdr(req, "Accept-Encoding", accept_encoding);
+    }
+    if (if_none_match) {
+        host_httpd_req_add_hdr(req, "If-None-Match", if_none_match);
+    }
+    CHECK(web_asset_get_handler(req) == ESP_OK, "%s: handler failed", asset->uri);
+}
+
+static void check_accept_encoding(void)
+{
+    for (size_t i = 0; i < sizeof(accept_cases) / sizeof(accept_cases[0]); i++) {
+        const accept_case_t *c = &accept_cases[i];
+        CHECK(web_asset_accepts_gzip(c->accept_encoding) == c->gzip, "Accept-Encoding \"%s\": expected %s",
+              c->accept_encoding ? c->accept_encoding : "(none)", c->gzip ? "gzip" : "identity");
+    }
+}
+
+static void check_asset(const web_asset_t *asset)
+{
+    httpd_req_t req;
+    const char *vary;
+
+    CHECK(strcmp(asset->etag, asset->identity_etag) != 0, "%s: both copies share ETag %s", asset->uri, asset->etag);
+
+    request(&req, asset, "gzip, deflate, br", NULL);
+    vary = host_httpd_resp_hdr(&req, "Vary");
+    CHECK(strcmp(req.resp.status, "200 OK") == 0, "%s gzip: status %s", asset->uri, req.resp.status);
+    CHECK(vary && strcmp(vary, "Accept-Encoding") == 0, "%s gzip: Vary %s", asset->uri, vary ? vary : "missing");
+    CHECK(host_httpd_resp_hdr(&req, "Content-Encoding") &&
+          strcmp(host_httpd_resp_hdr(&req, "Content-Encoding"), "gzip") == 0, "%s gzip: no Content-Encoding", asset->uri);
+    CHECK(req.resp.body_len == asset->len && memcmp(req.resp.body, asset->data, asset->len) == 0,
+          "%s gzip: body is not the gzip stream", asset->uri);
+    CHECK(strcmp(host_httpd_resp_hdr(&req, "ETag"), asset->etag) == 0, "%s gzip: wrong ETag", asset->uri);
+    host_httpd_req_free(&req);
+
+    request(&req, asset, NULL, NULL);
+    vary = host_httpd_resp_hdr(&req, "Vary");
+    CHECK(strcmp(req.resp.status, "200 OK") == 0, "%s identity: status %s", asset->uri, req.resp.status);
+    CHECK(vary && strcmp(vary, "Accept-Encoding") == 0, "%s identity: Vary %s", asset->uri, vary ? vary : "missing");
+    CHECK(host_httpd_resp_hdr(&req, "Content-Encoding") == NULL, "%s identity: sent Content-Encoding", asset->uri);
+    CHECK(req.resp.body_len == asset->identity_len && memcmp(req.resp.body, asset->identity, asset->identity_len) == 0,
+          "%s identity: body is not the identity copy", asset->uri);
+    CHECK(strcmp(host_httpd_resp_hdr(&req, "ETag"), asset->identity_etag) == 0, "%s identity: wrong ETag", asset->uri);
+    CHECK(strcmp(req.resp.content_type, asset->content_type) == 0, "%s identity: type %s", asset->uri, req.resp.content_type);
+    host_httpd_req_free(&req);
+
+    // Revalidation matches only the copy the client would get
+    request(&req, asset, "gzip", asset->etag);
+    CHECK(strcmp(req.resp.status, "304 Not Modified") == 0 && req.resp.body_len == 0,
+          "%s gzip revalidation: status %s", asset->uri, req.resp.status);
+    CHECK(host_httpd_resp_hdr(&req, "Vary") != NULL, "%s 304 without Vary", asset->uri);
+    host_httpd_req_free(&req);
+
+    request(&req, asset, NULL, asset->etag);
+    CHECK(strcmp(req.resp.status, "200 OK") == 0 && req.resp.body_len == asset->identity_len,
+          "%s: gzip ETag revalidated an identity request (%s)", asset->uri, req.resp.status);
+    host_httpd_req_free(&req);
+
+    request(&req, asset, NULL, asset->identity_etag);
+    CHECK(strcmp(req.resp.status, "304 Not Modified") == 0, "%s identity revalidation: status %s",
+          asset->uri, req.resp.status);
+    host_httpd_req_free(&req);
+
+#ifdef HAVE_ZLIB
+    // The identity copy must be exactly what the gzip stream decodes to
+    uint8_t *inflated = malloc(asset->identity_len + 1);
+    z_stream zs = {0};
+    inflateInit2(&zs, 16 + MAX_WBITS);
+    zs.next_in = (Bytef *)asset->data;
+    zs.avail_in = asset->len;
+    zs.next_out = inflated;
+    zs.avail_out = asset->identity_len + 1;
+    int zret = inflate(&zs, Z_FINISH);
+    CHECK(zret == Z_STREAM_END && zs.total_out == asset->identity_len &&
+          memcmp(inflated, asset->identity, asset->identity_len) == 0,
+          "%s: gzip stream does not decode to the identity copy", asset->uri);
+    inflateEnd(&zs);
+    free(inflated);
+#endif
+}
+
+typedef struct {
+    size_t wire_bytes;
+    double handler_us;
+} load_cost_t;
+
+// One visit: every asset requested once, optionally revalidating by ETag
+static load_cost_t page_load(const char *accept_encoding, bool revalidate)
+{
+    load_cost_t cost = {0};
+    bool gzip = web_asset_accepts_gzip(accept_encoding);
+    for (size_t i = 0; i < web_assets_count; i++) {
+        const web_asset_t *asset = &web_assets[i];
+        const char *etag = revalidate ? (gzip ? asset->etag : asset->identity_etag) : NULL;
+
+        httpd_req_t req;
+        request(&req, asset, accept_encoding, etag);
+        cost.wire_bytes += host_httpd_resp_wire_len(&req);
+        host_httpd_req_free(&req);
+
+        int64_t start = esp_timer_get_time();
+        for (int r = 0; r < BENCH_ROUNDS; r++) {
+            request(&req, asset, accept_encoding, etag);
+            host_httpd_req_free(&req);
+        }
+        cost.handler_us += (double)(esp_timer_get_time() - start) / BENCH_ROUNDS;
+    }
+    return cost;
+}
+
+static void bench(const char *label, const char *accept_encoding, bool revalidate)
+{
+    load_cost_t cost = page_load(accept_encoding, revalidate);
+    double transfer_ms = cost.wire_bytes * 8.0 / LINK_KBPS;
+    double total_ms = web_assets_count * LINK_RTT_MS + transfer_ms + cost.handler_us / 1000.0;
+    printf("%-30s %6zu bytes  handler %5.2f us  transfer %5.1f ms  total %5.1f ms\n",
+           label, cost.wire_bytes, cost.handler_us, transfer_ms, total_ms);
+}
+
+int main(void)
+{
+    check_accept_encoding();
+    for (size_t i = 0; i < web_assets_count; i++) {
+        check_asset(&web_assets[i]);
+    }
+
+    printf("%zu assets, %d kbit/s link, %d ms per request turn\n", web_assets_count, LINK_KBPS, LINK_RTT_MS);
+    bench("cold load, gzip client", "gzip, deflate, br", false);
+    bench("cold load, identity client", NULL, false);
+    bench("reload (304), gzip client", "gzip, deflate, br", true);
+    bench("reload (304), identity client", NULL, true);
+    return host_test_result("test_web_assets");
+}
@@ -0,0 +1,419 @@
+/**
+ * @file test_web_ws.c
+ * @brief The dashboard's WebSocket push: event_bus to ws_push_work() to many clients
+ *
+ * web_server.c runs unchanged against the host httpd in stubs/httpd_host.c,
+ * with clients on fake fds (from 1000, so close_fn's close() touches no real
+ * descriptor). Test results and sensor readings are published on the event
+ * bus as the test runner and telemetry sampler publish them; task_stats is
+ * not started, so nothing else arrives. Every frame a client is sent is
+ * recorded with the push (httpd work item) that sent it.
+ *
+ * Checked: a snapshot per client on connect and the fifth client refused;
+ * a delta carrying only the sections and tests that changed, encoded once
+ * and shared by every client with the same pending set; the per-client rate
+ * limit under a burst of sensor readings, with the latest reading the one
+ * that goes out; a closed client's slot freed at once, and a reconnect on
+ * the same fd never pushed to twice; an oversized incoming frame closing
+ * its client. The httpd task's CPU time per push and per frame is printed.
+ */
+
+#include "web_server.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "event_bus.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "json_writer.h"
+#include "telemetry.h"
+#include "host_test.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WS_MAX_CLIENTS      4       // As in web_server.c
+#define WS_MIN_INTERVAL_MS  1000    // As in web_server.c
+#define TESTS_ALL           0xfff   // 12 dashboard tests
+#define FIRST_FD            1000
+#define RATE_SLACK_US       5000    // Frames are stamped at work start, the limit is checked just after
+#define BURST_EVENTS        60
+#define BURST_MS            3000
+#define WAIT_MS             2000    // For a frame that is due
+
+// Referenced by the dashboard's "run tests" handler
+atomic_bool test_suite_triggered = false;
+
+void run_test_suite(void *pvParameters)
+{
+    test_suite_triggered = false;
+    vTaskDelete(NULL);
+}
+
+// Updates encoded: ws_build_update() writes each into a fixed buffer
+static atomic_int builds;
+static _Atomic(const char *) built_into;
+
+void __real_json_writer_init(json_writer_t *w, char *buf, size_t cap, json_writer_flush_t flush, void *ctx);
+
+void __wrap_json_writer_init(json_writer_t *w, char *buf, size_t cap, json_writer_flush_t flush, void *ctx)
+{
+    if (flush == NULL) {
+        atomic_fetch_add(&builds, 1);
+        atomic_store(&built_into, buf);
+    }
+    __real_json_writer_init(w, buf, cap, flush, ctx);
+}
+
+static httpd_handle_t server;
+
+// ---------------------------------------------------------------------------
+// Frames
+// ---------------------------------------------------------------------------
+
+static size_t frame_count(int fd)
+{
+    size_t count;
+    host_httpd_ws_frames(server, fd, &count);
+    return count;
+}
+
+static const host_httpd_ws_sent_t *frame(int fd, size_t i)
+{
+    size_t count;
+    const host_httpd_ws_sent_t *frames = host_httpd_ws_frames(server, fd, &count);
+    return frames && i < count && i < HOST_HTTPD_MAX_FRAMES ? &frames[i] : NULL;
+}
+
+// Waits until fd has been sent at least count frames
+static bool wait_frames(int fd, size_t count, int timeout_ms)
+{
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    while (frame_count(fd) < count) {
+        if (esp_timer_get_time() > deadline) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    return true;
+}
+
+static bool has_key(const char *json, const char *key)
+{
+    char quoted[48];
+    snprintf(quoted, sizeof(quoted), "\"%s\":", key);
+    return strstr(json, quoted) != NULL;
+}
+
+static bool is_type(const char *json, const char *type)
+{
+    char kv[48];
+    snprintf(kv, sizeof(kv), "\"type\":\"%s\"", type);
+    return strstr(json, kv) != NULL;
+}
+
+// The tests listed in the frame, as a mask
+static uint32_t tests_in(const char *json)
+{
+    uint32_t mask = 0;
+    for (const char *p = json; (p = strstr(p, "\"test_num\":")) != NULL;) {
+        p += strlen("\"test_num\":");
+        mask |= 1u << (atoi(p) - 1);
+    }
+    return mask;
+}
+
+static double number(const char *json, const char *key)
+{
+    char quoted[48];
+    snprintf(quoted, sizeof(quoted), "\"%s\":", key);
+    const char *p = strstr(json, quoted);
+    return p ? strtod(p + strlen(quoted), NULL) : -1.0;
+}
+
+// ---------------------------------------------------------------------------
+// Publishers
+// ---------------------------------------------------------------------------
+
+static void publish_test(int test_num, int status)
+{
+    char name[16];
+    snprintf(name, sizeof(name), "Bus test %d", test_num);
+    event_bus_test_status_t evt = { .test_num = test_num, .status = status, .name = name };
+    event_bus_publish(EVENT_BUS_TOPIC_TEST_STATUS, &evt, sizeof(evt));
+}
+
+static void publish_temperature(float temperature_c)
+{
+    telemetry_sample_t sample = {
+        .timestamp = 1760000000,
+        .valid_mask = TELEMETRY_SENSOR_SHT30,
+        .temperature_c = temperature_c,
+        .humidity_rh = 40.0f,
+    };
+    event_bus_publish(EVENT_BUS_TOPIC_SENSORS, &sample, sizeof(sample));
+}
+
+// ---------------------------------------------------------------------------
+// Scenarios
+// ---------------------------------------------------------------------------
+
+static int clients[WS_MAX_CLIENTS];
+
+// Four clients get a full snapshot each; a fifth is refused and sent nothing
+static void check_connect(void)
+{
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        clients[i] = FIRST_FD + i;
+        esp_err_t ret;
+        // web_server_task registers /ws just after httpd_start()
+        while ((ret = host_httpd_ws_open(server, "/ws", clients[i])) == ESP_ERR_NOT_FOUND) {
+            vTaskDelay(pdMS_TO_TICKS(5));
+        }
+        CHECK(ret == ESP_OK, "client %d refused", clients[i]);
+    }
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        CHECK(wait_frames(clients[i], 1, WAIT_MS), "no snapshot for client %d", clients[i]);
+        const host_httpd_ws_sent_t *f = frame(clients[i], 0);
+        if (!f) {
+            continue;
+        }
+        CHECK(is_type(f->payload, "snapshot"), "client %d: first frame not a snapshot", clients[i]);
+        CHECK(has_key(f->payload, "system") && has_key(f->payload, "memory") && has_key(f->payload, "cpu") &&
+              has_key(f->payload, "sensors"), "client %d: snapshot missing sections: %s", clients[i], f->payload);
+        CHECK(tests_in(f->payload) == TESTS_ALL, "client %d: snapshot tests %#x", clients[i],
+              (unsigned)tests_in(f->payload));
+    }
+
+    int extra = FIRST_FD + WS_MAX_CLIENTS;
+    CHECK(host_httpd_ws_open(server, "/ws", extra) == ESP_FAIL, "client %d accepted past the limit", extra);
+    CHECK(httpd_ws_get_fd_info(server, extra) == HTTPD_WS_CLIENT_INVALID, "refused client %d left open", extra);
+    vTaskDelay(pdMS_TO_TICKS(300));
+    CHECK(frame_count(extra) == 0, "refused client %d sent %zu frames", extra, frame_count(extra));
+    printf("%d clients connected, snapshot %zu bytes, client %d refused\n", WS_MAX_CLIENTS,
+           frame(clients[0], 0) ? frame(clients[0], 0)->len : 0, extra);
+}
+
+// One test result: the same tests-only delta, encoded once, to every client
+static void check_shared_delta(void)
+{
+    vTaskDelay(pdMS_TO_TICKS(WS_MIN_INTERVAL_MS + 100));
+    size_t before[WS_MAX_CLIENTS];
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        before[i] = frame_count(clients[i]);
+    }
+    atomic_store(&builds, 0);
+    publish_test(3, 0);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        CHECK(wait_frames(clients[i], before[i] + 1, WAIT_MS), "no delta for client %d", clients[i]);
+    }
+    vTaskDelay(pdMS_TO_TICKS(300));
+
+    const host_httpd_ws_sent_t *first = frame(clients[0], before[0]);
+    for (int i = 0; first && i < WS_MAX_CLIENTS; i++) {
+        const host_httpd_ws_sent_t *f = frame(clients[i], before[i]);
+        CHECK(frame_count(clients[i]) == before[i] + 1, "client %d: %zu frames for one change", clients[i],
+              frame_count(clients[i]) - before[i]);
+        if (!f) {
+            continue;
+        }
+        CHECK(strcmp(f->payload, first->payload) == 0, "client %d: different delta", clients[i]);
+        CHECK(f->source == first->source && f->work_seq == first->work_seq, "client %d: not the shared frame",
+              clients[i]);
+        CHECK(f->source == atomic_load(&built_into), "client %d: not sent from the update buffer", clients[i]);
+    }
+    if (first) {
+        CHECK(is_type(first->payload, "delta"), "not a delta: %s", first->payload);
+        CHECK(tests_in(first->payload) == 1u << 2, "delta tests %#x", (unsigned)tests_in(first->payload));
+        CHECK(strstr(first->payload, "\"name\":\"Bus test 3\"") && number(first->payload, "status") == 0,
+              "test 3 result not in the delta: %s", first->payload);
+        CHECK(!has_key(first->payload, "system") && !has_key(first->payload, "sensors"),
+              "unchanged sections in the delta: %s", first->payload);
+        printf("test result: %zu-byte delta to %d clients, %d encoding(s)\n", first->len, WS_MAX_CLIENTS,
+               atomic_load(&builds));
+    }
+    CHECK(atomic_load(&builds) == 1, "delta encoded %d times for %d clients", atomic_load(&builds), WS_MAX_CLIENTS);
+}
+
+// A burst of readings: at most one frame a second per client, the latest reading in each
+static void check_rate_limit(void)
+{
+    size_t before[WS_MAX_CLIENTS];
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        before[i] = frame_count(clients[i]);
+    }
+    atomic_store(&builds, 0);
+    float last = 0;
+    int64_t start = esp_timer_get_time();
+    for (int n = 0; n < BURST_EVENTS; n++) {
+        last = 20.0f + n * 0.1f;
+        publish_temperature(last);
+        vTaskDelay(pdMS_TO_TICKS(BURST_MS / BURST_EVENTS));
+    }
+    int64_t burst_ms = (esp_timer_get_time() - start) / 1000;
+    // The reading left pending at the end goes out once each client is due again
+    int64_t deadline = esp_timer_get_time() + (int64_t)WAIT_MS * 1000;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        const host_httpd_ws_sent_t *f;
+        while (!((f = frame(clients[i], frame_count(clients[i]) - 1)) &&
+                 number(f->payload, "temperature_c") > last - 0.006) && esp_timer_get_time() < deadline) {
+            vTaskDelay(pdMS_TO_TICKS(5));
+        }
+    }
+    vTaskDelay(pdMS_TO_TICKS(300));     // Anything sent after the latest reading would show up here
+
+    uint32_t pushes = 0;
+    uint32_t last_seq = 0;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        size_t count = frame_count(clients[i]);
+        size_t sent = count - before[i];
+        // One frame at most per interval over the burst, plus the one left pending at its end
+        CHECK(sent >= 2 && sent <= burst_ms / WS_MIN_INTERVAL_MS + 2, "client %d: %zu frames for %d readings",
+              clients[i], sent, BURST_EVENTS);
+        for (size_t f = before[i]; f < count; f++) {
+            const host_httpd_ws_sent_t *cur = frame(clients[i], f);
+            const host_httpd_ws_sent_t *prev = frame(clients[i], f - 1);
+            if (!cur || !prev) {
+                continue;
+            }
+            CHECK(cur->work_us - prev->work_us >= (int64_t)WS_MIN_INTERVAL_MS * 1000 - RATE_SLACK_US,
+                  "client %d: frames %lld ms apart", clients[i], (long long)(cur->work_us - prev->work_us) / 1000);
+            CHECK(is_type(cur->payload, "delta") && has_key(cur->payload, "sensors") &&
+                  !has_key(cur->payload, "tests") && !has_key(cur->payload, "system"),
+                  "client %d: not a sensors-only delta: %s", clients[i], cur->payload);
+            if (i == 0 && cur->work_seq != last_seq) {
+                pushes++;
+                last_seq = cur->work_seq;
+            }
+        }
+        const host_httpd_ws_sent_t *final = frame(clients[i], count - 1);
+        if (final) {
+            double sent_c = number(final->payload, "temperature_c");
+            CHECK(sent_c > last - 0.006 && sent_c < last + 0.006, "client %d: last frame has %.2f C, latest %.2f C",
+                  clients[i], sent_c, last);
+        }
+    }
+    CHECK(atomic_load(&builds) == (int)pushes, "%d encodings for %u pushes", atomic_load(&builds), (unsigned)pushes);
+    printf("%d readings in %lld ms: %zu frames per client, %d encodings\n", BURST_EVENTS, (long long)burst_ms,
+           frame_count(clients[0]) - before[0], atomic_load(&builds));
+}
+
+// A client that drops and reconnects on the same fd gets a fresh snapshot,
+// then its own pending set; nothing goes to it twice
+static void check_reconnect(void)
+{
+    int fd = clients[1];
+    host_httpd_close(server, fd);
+    CHECK(httpd_ws_get_fd_info(server, fd) == HTTPD_WS_CLIENT_INVALID, "client %d still open", fd);
+    CHECK(host_httpd_ws_open(server, "/ws", fd) == ESP_OK, "client %d refused on reconnect (slot not freed)", fd);
+    CHECK(wait_frames(fd, 1, WAIT_MS), "no snapshot after reconnect");
+    const host_httpd_ws_sent_t *snapshot = frame(fd, 0);
+    CHECK(snapshot && is_type(snapshot->payload, "snapshot"), "first frame after reconnect not a snapshot");
+
+    // The others are due: they get test 5 alone, while the reconnected client is held
+    size_t before[WS_MAX_CLIENTS];
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        before[i] = frame_count(clients[i]);
+    }
+    publish_test(5, 2);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (clients[i] != fd) {
+            CHECK(wait_frames(clients[i], before[i] + 1, WAIT_MS), "no test 5 delta for client %d", clients[i]);
+            const host_httpd_ws_sent_t *f = frame(clients[i], before[i]);
+            CHECK(f && tests_in(f->payload) == 1u << 4 && !has_key(f->payload, "sensors"),
+                  "client %d: not test 5 alone: %s", clients[i], f ? f->payload : "");
+        }
+    }
+    CHECK(snapshot && esp_timer_get_time() - snapshot->work_us < (WS_MIN_INTERVAL_MS - 200) * 1000,
+          "reconnected client due before the sensors were published; timing too loose to check");
+    CHECK(frame_count(fd) == 1, "reconnected client sent %zu frames inside its interval", frame_count(fd));
+
+    publish_temperature(30.5f);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        size_t want = clients[i] == fd ? 2 : before[i] + 2;
+        CHECK(wait_frames(clients[i], want, WAIT_MS), "no sensors delta for client %d", clients[i]);
+        const host_httpd_ws_sent_t *f = frame(clients[i], want - 1);
+        if (!f) {
+            continue;
+        }
+        if (clients[i] == fd) {
+            CHECK(tests_in(f->payload) == 1u << 4 && has_key(f->payload, "sensors"),
+                  "reconnected client: want test 5 and sensors: %s", f->payload);
+        } else {
+            CHECK(!has_key(f->payload, "tests") && has_key(f->payload, "sensors"),
+                  "client %d: want sensors alone: %s", clients[i], f->payload);
+        }
+        CHECK(number(f->payload, "temperature_c") == 30.5, "client %d: sensors not current: %s", clients[i],
+              f->payload);
+    }
+
+    // Never two frames to one client in one push
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        size_t count = frame_count(clients[i]);
+        for (size_t f = 1; f < count; f++) {
+            const host_httpd_ws_sent_t *cur = frame(clients[i], f);
+            const host_httpd_ws_sent_t *prev = frame(clients[i], f - 1);
+            CHECK(!cur || !prev || cur->work_seq != prev->work_seq, "client %d: two frames in push %u",
+                  clients[i], (unsigned)cur->work_seq);
+        }
+    }
+}
+
+// Clients only listen: a small frame is read and ignored, a large one closes the socket
+static void check_incoming(void)
+{
+    static const char ping[] = "ping";
+    char big[100];
+    memset(big, 'x', sizeof(big));
+    CHECK(host_httpd_ws_receive(server, clients[0], ping, strlen(ping)) == ESP_OK, "small frame rejected");
+    CHECK(httpd_ws_get_fd_info(server, clients[0]) == HTTPD_WS_CLIENT_WEBSOCKET, "small frame closed the client");
+    CHECK(host_httpd_ws_receive(server, clients[2], big, sizeof(big)) != ESP_OK, "oversized frame accepted");
+    CHECK(httpd_ws_get_fd_info(server, clients[2]) == HTTPD_WS_CLIENT_INVALID, "oversized frame left client open");
+
+    // Its slot is free at once: one new client fits, the next does not
+    int next = FIRST_FD + WS_MAX_CLIENTS + 1;
+    CHECK(host_httpd_ws_open(server, "/ws", next) == ESP_OK, "slot of the closed client not freed");
+    CHECK(wait_frames(next, 1, WAIT_MS), "no snapshot for client %d", next);
+    CHECK(host_httpd_ws_open(server, "/ws", next + 1) == ESP_FAIL, "client %d accepted past the limit", next + 1);
+    clients[2] = next;
+}
+
+static void report_cpu(void)
+{
+    uint32_t pushes;
+    uint64_t cpu_us;
+    host_httpd_work_stats(server, &pushes, &cpu_us);
+    size_t frames = 0;
+    for (int fd = FIRST_FD; fd <= FIRST_FD + WS_MAX_CLIENTS + 2; fd++) {
+        frames += frame_count(fd);
+    }
+    CHECK(pushes > 0 && frames > 0, "no pushes recorded");
+    if (pushes > 0 && frames > 0) {
+        printf("httpd task: %u pushes, %zu frames, %.1f us CPU per push, %.1f us per frame\n", (unsigned)pushes,
+               frames, (double)cpu_us / pushes, (double)cpu_us / frames);
+    }
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    CHECK(web_server_start() == ESP_OK, "web_server_start failed");
+    // web_server_task waits for the network before it starts the server
+    int64_t deadline = esp_timer_get_time() + 10 * 1000000;
+    while (!(server = host_httpd_running()) && esp_timer_get_time() < deadline) {
+        vTaskDelay(pdMS_TO_TICKS(20));
+    }
+    CHECK(server != NULL, "server not started");
+    if (!server) {
+        return host_test_result("test_web_ws");
+    }
+
+    check_connect();
+    check_shared_delta();
+    check_rate_limit();
+    check_reconnect();
+    check_incoming();
+    report_cpu();
+    CHECK(web_server_stop() == ESP_OK, "web_server_stop failed");
+    return host_test_result("test_web_ws");
+}
@@ -0,0 +1,157 @@
+/**
+ * @file test_wifi_manager.c
+ * @brief wifi_manager against the simulated station driver: connect paths and event-loop stalls
+ *
+ * wifi_host.c plays the AP and the air time of scans, association and
+ * DHCP; NVS writes take as long as a flash erase. The manager goes through
+ * a cold full scan, a link flap back to the cached AP, the AP moving to
+ * another channel, and an outage long enough for the backoff to grow. The
+ * event loop times every handler call: the AP cache commit must not be
+ * among them.
+ */
+
+#include "wifi_manager.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_test.h"
+#include "nvs.h"
+
+#define SSID                "naphome-test"
+#define NVS_WRITE_DELAY_MS  40      // Per set and per commit: a sector erase
+#define HANDLER_LIMIT_US    10000   // Longest handler call allowed on the loop
+#define CONNECT_TIMEOUT_MS  10000
+#define OUTAGE_MS           3000
+#define CACHE_NVS_KEY       "ap"    // wifi_manager.c's entry
+
+static const uint8_t bssid_a[6] = { 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01 };
+static const uint8_t bssid_b[6] = { 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x02 };
+
+static bool wait_disconnected(uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 10) {
+        if (!wifi_manager_connected()) {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return false;
+}
+
+static bool wait_nvs_writes(uint32_t count, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 10) {
+        if (host_nvs_write_count() >= count) {
+            // The count moves as a write starts: let the last one finish
+            vTaskDelay(pdMS_TO_TICKS(2 * NVS_WRITE_DELAY_MS));
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return false;
+}
+
+// What a reboot would find in NVS
+static bool cache_committed(void)
+{
+    host_nvs_power_cycle();
+    nvs_handle_t handle;
+    if (nvs_open(WIFI_MANAGER_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    size_t len = 0;
+    bool found = nvs_get_blob(handle, CACHE_NVS_KEY, NULL, &len) == ESP_OK && len > 0;
+    nvs_close(handle);
+    return found;
+}
+
+static void report(const char *phase, uint32_t probed_before)
+{
+    wifi_manager_stats_t stats;
+    wifi_manager_get_stats(&stats);
+    printf("  %-10s %5lu ms  channel %2u  %s  %2lu channels probed  %lu NVS writes\n", phase,
+           (unsigned long)stats.last_connect_ms, stats.channel, stats.fast ? "directed " : "full scan",
+           (unsigned long)(host_wifi_channels_probed() - probed_before), (unsigned long)host_nvs_write_count());
+}
+
+int main(void)
+{
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    host_nvs_set_write_delay_ms(NVS_WRITE_DELAY_MS);
+    CHECK(esp_event_loop_create_default() == ESP_OK, "event loop not created");
+    host_wifi_set_ap(SSID, bssid_a, 6);
+
+    wifi_manager_config_t config = WIFI_MANAGER_DEFAULT_CONFIG();
+    config.ssid = SSID;
+    config.password = "password";
+    config.backoff_min_ms = 250;
+    config.backoff_max_ms = 2000;
+    CHECK(wifi_manager_start(&config) == ESP_OK, "manager did not start");
+    printf("Connect time, request or link loss to IP (NVS writes take %d ms):\n", NVS_WRITE_DELAY_MS);
+
+    // Nothing cached: all channels, full DHCP exchange, then the AP is written
+    uint32_t probed = host_wifi_channels_probed();
+    CHECK(wifi_manager_wait_connected(CONNECT_TIMEOUT_MS), "no address after a cold start");
+    CHECK(wait_nvs_writes(2, 1000), "AP not written after the first connection");
+    CHECK(cache_committed(), "AP cache not committed");
+    report("cold", probed);
+    wifi_manager_stats_t stats;
+    wifi_manager_get_stats(&stats);
+    CHECK(stats.full_scans == 1 && stats.fast_attempts == 0, "%lu full scans, %lu directed",
+          (unsigned long)stats.full_scans, (unsigned long)stats.fast_attempts);
+    uint32_t cold_ms = stats.last_connect_ms;
+
+    // Link flap: back to the cached AP with one probe and the remembered lease
+    uint32_t writes = host_nvs_write_count();
+    probed = host_wifi_channels_probed();
+    host_wifi_ap_down();
+    CHECK(wait_disconnected(2000), "beacon loss not reported");
+    host_wifi_set_ap(SSID, bssid_a, 6);
+    CHECK(wifi_manager_wait_connected(CONNECT_TIMEOUT_MS), "no address after a link flap");
+    report("flap", probed);
+    wifi_manager_get_stats(&stats);
+    CHECK(stats.fast && stats.fast_hits == 1 && stats.reconnects == 1, "flap: fast %d, %lu hits, %lu reconnects",
+          stats.fast, (unsigned long)stats.fast_hits, (unsigned long)stats.reconnects);
+    CHECK(stats.last_connect_ms * 2 < cold_ms, "flap took %lu ms, cold start %lu ms",
+          (unsigned long)stats.last_connect_ms, (unsigned long)cold_ms);
+    vTaskDelay(pdMS_TO_TICKS(200));
+    CHECK(host_nvs_write_count() == writes, "same AP written again");
+
+    // AP moved: the directed probe misses, the scan finds it, the cache follows
+    probed = host_wifi_channels_probed();
+    host_wifi_set_ap(SSID, bssid_b, 11);
+    CHECK(wait_disconnected(2000), "move not reported");
+    CHECK(wifi_manager_wait_connected(CONNECT_TIMEOUT_MS), "no address after the AP moved");
+    CHECK(wait_nvs_writes(writes + 2, 1000), "moved AP not written");
+    report("moved", probed);
+    wifi_manager_get_stats(&stats);
+    CHECK(stats.channel == 11 && !stats.fast && stats.full_scans == 2, "moved: channel %u, %lu full scans",
+          stats.channel, (unsigned long)stats.full_scans);
+
+    // Outage: attempts back off while the AP is gone, then the cached AP again
+    writes = host_nvs_write_count();
+    probed = host_wifi_channels_probed();
+    host_wifi_ap_down();
+    CHECK(wait_disconnected(2000), "outage not reported");
+    vTaskDelay(pdMS_TO_TICKS(OUTAGE_MS));
+    uint32_t attempts = stats.fast_attempts + stats.full_scans;
+    host_wifi_set_ap(SSID, bssid_b, 11);
+    CHECK(wifi_manager_wait_connected(CONNECT_TIMEOUT_MS), "no address after the outage");
+    report("outage", probed);
+    wifi_manager_get_stats(&stats);
+    uint32_t outage_attempts = stats.fast_attempts + stats.full_scans - attempts;
+    CHECK(outage_attempts >= 3 && outage_attempts <= 12, "%lu attempts over a %d ms outage",
+          (unsigned long)outage_attempts, OUTAGE_MS);
+    CHECK(stats.reconnects == 3, "%lu reconnects", (unsigned long)stats.reconnects);
+    CHECK(host_nvs_write_count() == writes, "unchanged AP written again after the outage");
+
+    int64_t longest_us = host_esp_event_max_handler_us();
+    CHECK(longest_us < HANDLER_LIMIT_US, "a handler held the event loop for %lld us", (long long)longest_us);
+    printf("%lu events, longest handler call on the loop %lld us; %lu connect attempts over a %d ms outage\n",
+           (unsigned long)host_esp_event_dispatched(), (long long)longest_us, (unsigned long)outage_attempts,
+           OUTAGE_MS);
+    return host_test_result("test_wifi_manager");
+}
@@ -0,0 +1,85 @@
+/**
+ * @file wav_reader.c
+ * @brief 16-bit PCM WAV files for host tests that replay recorded audio
+ */
+
+#include "wav_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t le32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint16_t le16(const uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+int wav_read(const char *path, wav_t *wav)
+{
+    memset(wav, 0, sizeof(*wav));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return -1;
+    }
+
+    uint8_t header[12];
+    if (fread(header, 1, sizeof(header), f) != sizeof(header) ||
+        memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+        fclose(f);
+        return -1;
+    }
+
+    uint16_t format = 0, bits = 0;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, sizeof(chunk), f) == sizeof(chunk)) {
+        uint32_t size = le32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            uint8_t fmt[16];
+            if (fread(fmt, 1, sizeof(fmt), f) != sizeof(fmt)) {
+                break;
+            }
+            format = le16(fmt);
+            wav->channels = le16(fmt + 2);
+            wav->sample_rate = le32(fmt + 4);
+            bits = le16(fmt + 14);
+            fseek(f, (size - 16) + (size & 1), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (format != 1 || bits != 16 || wav->channels == 0) {
+                break;
+            }
+            size_t frames = size / (2u * wav->channels);
+            int16_t *interleaved = malloc(frames * 2u * wav->channels);
+            wav->samples = malloc(frames * sizeof(int16_t));
+            if (!interleaved || !wav->samples) {
+                free(interleaved);
+                break;
+            }
+            frames = fread(interleaved, 2u * wav->channels, frames, f);
+            for (size_t i = 0; i < frames; i++) {
+                const uint8_t *p = (const uint8_t *)&interleaved[i * wav->channels];
+                wav->samples[i] = (int16_t)le16(p);
+            }
+            wav->count = frames;
+            free(interleaved);
+            fclose(f);
+            return 0;
+        } else {
+            fseek(f, size + (size & 1), SEEK_CUR);
+        }
+    }
+
+    free(wav->samples);
+    memset(wav, 0, sizeof(*wav));
+    fclose(f);
+    return -1;
+}
+
+void wav_free(wav_t *wav)
+{
+    free(wav->samples);
+    memset(wav, 0, sizeof(*wav));
+}
@@ -0,0 +1,28 @@
+/**
+ * @file wav_reader.h
+ * @brief 16-bit PCM WAV files for host tests that replay recorded audio
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    int16_t *samples;           // Channel 0 only, as the AFE would output it
+    size_t count;
+    uint32_t sample_rate;
+    uint16_t channels;          // In the file
+} wav_t;
+
+/**
+ * @brief Read channel 0 of a 16-bit PCM WAV file
+ *
+ * Walks the RIFF chunks, so files with LIST or fact chunks before the data
+ * read the same as bare 44-byte headers.
+ *
+ * @return 0 on success, -1 if the file is missing or not 16-bit PCM
+ */
+int wav_read(const char *path, wav_t *wav);
+
+void wav_free(wav_t *wav);
@@ -0,0 +1,79 @@
+/**
+ * @file action_executor.c
+ * @brief Queue and task for local intent handlers
+ */
+
+#include "action_executor.h"
+#include "trace.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "action";
+
+typedef struct {
+    const intent_def_t *intent;
+    int command_id;
+    uint32_t interaction;       // Trace interaction the action belongs to
+    int64_t posted_us;
+    char text[ACTION_TEXT_MAX];
+} action_t;
+
+static QueueHandle_t action_queue = NULL;
+
+static void action_executor_task(void *arg)
+{
+    action_t action;
+    while (true) {
+        if (xQueueReceive(action_queue, &action, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        int64_t start = esp_timer_get_time();
+        ESP_LOGI(TAG, "Running %s (queued %lld us)", action.intent->name,
+                 (long long)(start - action.posted_us));
+        action.intent->handler(action.intent, action.command_id, action.text);
+        trace_span_since(action.interaction, "action", start);
+    }
+}
+
+esp_err_t action_executor_init(void)
+{
+    if (action_queue) {
+        return ESP_OK;
+    }
+    action_queue = xQueueCreate(ACTION_QUEUE_LEN, sizeof(action_t));
+    if (!action_queue) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(action_executor_task, "action", ACTION_TASK_STACK, NULL,
+                                ACTION_TASK_PRIORITY, NULL, 0) != pdPASS) {
+        vQueueDelete(action_queue);
+        action_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t action_executor_post(const intent_def_t *intent, int command_id, const char *text)
+{
+    if (!action_queue || !intent) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    action_t action = {
+        .intent = intent,
+        .command_id = command_id,
+        .interaction = trace_current(),
+        .posted_us = esp_timer_get_time(),
+    };
+    if (text) {
+        strncpy(action.text, text, sizeof(action.text) - 1);
+    }
+    if (xQueueSend(action_queue, &action, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Action queue full, dropping %s", intent->name);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
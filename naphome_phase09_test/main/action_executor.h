@@ -0,0 +1,42 @@
+/**
+ * @file action_executor.h
+ * @brief Runs local intent handlers off the detect task
+ *
+ * Intent handlers block: they speak, play whole WAV/MP3 files or wait for
+ * a sensor measurement. Run inline in detect_Task, nothing fetches from the
+ * AFE meanwhile, the feed ring overflows and the next wake word is missed.
+ *
+ * Matching stays synchronous (it decides whether the STT fallback runs);
+ * action_executor_post() only copies the matched intent into a queue and
+ * returns. One executor task runs the handlers in order, so actions from
+ * MultiNet and from STT transcripts never overlap.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "intent.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ACTION_QUEUE_LEN        4       // Pending actions before posts are rejected
+#define ACTION_TEXT_MAX         128     // Command text passed to the handler, truncated
+#define ACTION_TASK_STACK       16384   // Handlers decode MP3 and call HTTP APIs
+#define ACTION_TASK_PRIORITY    4       // Below the detect and feed tasks
+
+/**
+ * @brief Create the action queue and executor task
+ */
+esp_err_t action_executor_init(void);
+
+/**
+ * @brief Queue an intent handler call without blocking
+ * @return ESP_ERR_INVALID_STATE before init, ESP_ERR_NO_MEM if the queue is full
+ */
+esp_err_t action_executor_post(const intent_def_t *intent, int command_id, const char *text);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,171 @@
+/**
+ * @file audio_capture.c
+ * @brief Mirrored PSRAM capture ring with reference-counted clips
+ */
+
+#include "audio_capture.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "audio_capture";
+
+#define RING_SAMPLES    ((size_t)CAPTURE_MS_TO_SAMPLES(CAPTURE_RING_MS))
+#define MIRROR_SAMPLES  ((size_t)CAPTURE_MS_TO_SAMPLES(CAPTURE_MAX_CLIP_MS))
+
+struct audio_clip {
+    _Atomic int refs;           // 0 = slot free
+    uint64_t start;             // Absolute sample position
+    size_t count;
+    const int16_t *samples;     // Points into the ring
+};
+
+// RING_SAMPLES of history followed by a copy of the first MIRROR_SAMPLES
+static int16_t *ring = NULL;
+static uint64_t written = 0;            // Samples written since boot (detect task only)
+static bool overrun_logged = false;
+static _Atomic uint32_t overruns = 0;
+static audio_clip_t clips[CAPTURE_MAX_CLIPS];
+
+_Static_assert(MIRROR_SAMPLES <= RING_SAMPLES, "clips must fit in the ring");
+
+esp_err_t audio_capture_init(void)
+{
+    if (ring) {
+        return ESP_OK;
+    }
+    size_t bytes = (RING_SAMPLES + MIRROR_SAMPLES) * sizeof(int16_t);
+    int16_t *buf = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) {
+        buf = malloc(bytes);
+    }
+    if (!buf) {
+        ESP_LOGE(TAG, "Failed to allocate capture ring (%u bytes)", (unsigned)bytes);
+        return ESP_ERR_NO_MEM;
+    }
+    ring = buf;
+    ESP_LOGI(TAG, "Capture ring: %d ms history, %d ms pre-roll (%u bytes)",
+             CAPTURE_RING_MS, CAPTURE_PREROLL_MS, (unsigned)bytes);
+    return ESP_OK;
+}
+
+// Oldest sample a held clip still needs, UINT64_MAX if none is held
+static uint64_t oldest_held_sample(void)
+{
+    uint64_t oldest = UINT64_MAX;
+    for (int i = 0; i < CAPTURE_MAX_CLIPS; i++) {
+        if (atomic_load_explicit(&clips[i].refs, memory_order_acquire) > 0 && clips[i].start < oldest) {
+            oldest = clips[i].start;
+        }
+    }
+    return oldest;
+}
+
+void audio_capture_write(const int16_t *samples, size_t count)
+{
+    if (!ring || !samples || count == 0 || count > RING_SAMPLES) {
+        return;
+    }
+    uint64_t held = oldest_held_sample();
+    if (held != UINT64_MAX && written + count > held + RING_SAMPLES) {
+        atomic_fetch_add_explicit(&overruns, 1, memory_order_relaxed);
+        if (!overrun_logged) {
+            ESP_LOGW(TAG, "Ring full behind a held clip - dropping audio until STT releases it");
+            overrun_logged = true;
+        }
+        return;
+    }
+    overrun_logged = false;
+
+    while (count > 0) {
+        size_t slot = (size_t)(written % RING_SAMPLES);
+        size_t n = RING_SAMPLES - slot;
+        if (n > count) {
+            n = count;
+        }
+        memcpy(ring + slot, samples, n * sizeof(int16_t));
+        if (slot < MIRROR_SAMPLES) {
+            size_t m = MIRROR_SAMPLES - slot;
+            memcpy(ring + RING_SAMPLES + slot, samples, (m < n ? m : n) * sizeof(int16_t));
+        }
+        samples += n;
+        count -= n;
+        written += n;
+    }
+}
+
+uint64_t audio_capture_position(void)
+{
+    return written;
+}
+
+audio_clip_t *audio_capture_clip(uint64_t start, uint64_t end)
+{
+    if (!ring) {
+        return NULL;
+    }
+    uint64_t oldest = written > RING_SAMPLES ? written - RING_SAMPLES : 0;
+    if (start < oldest) {
+        start = oldest;
+    }
+    if (end > written) {
+        end = written;
+    }
+    if (end > start + MIRROR_SAMPLES) {
+        end = start + MIRROR_SAMPLES;
+    }
+    if (end <= start) {
+        return NULL;
+    }
+
+    for (int i = 0; i < CAPTURE_MAX_CLIPS; i++) {
+        audio_clip_t *clip = &clips[i];
+        if (atomic_load_explicit(&clip->refs, memory_order_acquire) == 0) {
+            // Only the detect task claims clips, so the slot cannot be taken meanwhile
+            clip->start = start;
+            clip->count = (size_t)(end - start);
+            clip->samples = ring + (size_t)(start % RING_SAMPLES);
+            atomic_store_explicit(&clip->refs, 1, memory_order_release);
+            return clip;
+        }
+    }
+    ESP_LOGW(TAG, "All %d clips are held, STT fallback skipped", CAPTURE_MAX_CLIPS);
+    return NULL;
+}
+
+const int16_t *audio_clip_samples(const audio_clip_t *clip, size_t *count)
+{
+    if (!clip) {
+        if (count) {
+            *count = 0;
+        }
+        return NULL;
+    }
+    if (count) {
+        *count = clip->count;
+    }
+    return clip->samples;
+}
+
+void audio_clip_retain(audio_clip_t *clip)
+{
+    if (clip) {
+        atomic_fetch_add_explicit(&clip->refs, 1, memory_order_relaxed);
+    }
+}
+
+void audio_clip_release(audio_clip_t *clip)
+{
+    // Release ordering: the writer may reuse the samples once it sees 0
+    if (clip) {
+        atomic_fetch_sub_explicit(&clip->refs, 1, memory_order_release);
+    }
+}
+
+uint32_t audio_capture_overruns(void)
+{
+    return atomic_load_explicit(&overruns, memory_order_relaxed);
+}
@@ -0,0 +1,82 @@
+/**
+ * @file audio_capture.h
+ * @brief Always-on capture ring for the STT fallback
+ *
+ * Every AFE fetch is written into one circular PSRAM buffer allocated at
+ * boot, whether or not the wake word has fired. When MultiNet gives up, the
+ * detect task takes a clip covering a short pre-roll before the wake word
+ * through the end of speech and hands it to the STT task by reference: no
+ * allocation or copy per utterance.
+ *
+ * Clips are reference counted. The ring keeps a mirror of its first
+ * CAPTURE_MAX_CLIP_MS after the end, so every clip is one contiguous
+ * sample array even when it wraps. While a clip is held the writer will not
+ * overwrite it; if the ring catches up with a held clip, new frames are
+ * dropped (and counted) until it is released.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAPTURE_SAMPLE_RATE     16000   // AFE output, mono 16-bit
+#define CAPTURE_RING_MS         10000   // History kept in the ring
+#define CAPTURE_PREROLL_MS      500     // Audio kept from before the wake word
+#define CAPTURE_MAX_CLIP_MS     (CAPTURE_PREROLL_MS + 5000)  // Longest clip handed to STT
+#define CAPTURE_MAX_CLIPS       2       // Clips that can be held at once
+
+#define CAPTURE_MS_TO_SAMPLES(ms)   ((uint64_t)(ms) * CAPTURE_SAMPLE_RATE / 1000)
+
+typedef struct audio_clip audio_clip_t;
+
+/**
+ * @brief Allocate the ring (PSRAM when available)
+ *
+ * Writes before this succeeds are dropped and no clips are returned.
+ */
+esp_err_t audio_capture_init(void);
+
+/**
+ * @brief Append AFE output to the ring (detect task only)
+ */
+void audio_capture_write(const int16_t *samples, size_t count);
+
+/**
+ * @brief Total samples written since boot (detect task only); clip
+ * boundaries are in these units
+ */
+uint64_t audio_capture_position(void);
+
+/**
+ * @brief Reference the audio in [start, end) (detect task only)
+ *
+ * start is clamped to what the ring still holds and the clip to
+ * CAPTURE_MAX_CLIP_MS from its start.
+ *
+ * @return A clip holding one reference, or NULL if there is no audio or all
+ *         CAPTURE_MAX_CLIPS clips are in use
+ */
+audio_clip_t *audio_capture_clip(uint64_t start, uint64_t end);
+
+/**
+ * @brief Contiguous samples of a clip, valid until its last release
+ */
+const int16_t *audio_clip_samples(const audio_clip_t *clip, size_t *count);
+
+void audio_clip_retain(audio_clip_t *clip);
+void audio_clip_release(audio_clip_t *clip);
+
+/**
+ * @brief Frames dropped because a held clip blocked the writer
+ */
+uint32_t audio_capture_overruns(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,83 @@
+/**
+ * @file audio_ctl.c
+ * @brief Event group backed pause/resume for audio producers
+ */
+
+#include "audio_ctl.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+static const char *TAG = "audio_ctl";
+
+// Each reason has a "clear" bit set while that reason is not paused, so
+// producers can wait for all of theirs with one xEventGroupWaitBits()
+#define CLEAR_BITS(reasons)     ((EventBits_t)((reasons) & AUDIO_CTL_PAUSE_ALL) << 8)
+
+static EventGroupHandle_t ctl_events = NULL;
+
+esp_err_t audio_ctl_init(void)
+{
+    if (ctl_events) {
+        return ESP_OK;
+    }
+    ctl_events = xEventGroupCreate();
+    if (!ctl_events) {
+        ESP_LOGE(TAG, "Failed to create audio control event group");
+        return ESP_ERR_NO_MEM;
+    }
+    xEventGroupSetBits(ctl_events, CLEAR_BITS(AUDIO_CTL_PAUSE_ALL));
+    return ESP_OK;
+}
+
+void audio_ctl_pause(audio_ctl_reason_t reason)
+{
+    if (ctl_events) {
+        xEventGroupClearBits(ctl_events, CLEAR_BITS(reason));
+    }
+}
+
+void audio_ctl_resume(audio_ctl_reason_t reason)
+{
+    if (ctl_events) {
+        xEventGroupSetBits(ctl_events, CLEAR_BITS(reason));
+    }
+}
+
+bool audio_ctl_paused(uint32_t reasons)
+{
+    if (!ctl_events) {
+        return false;
+    }
+    return (xEventGroupGetBits(ctl_events) & CLEAR_BITS(reasons)) != CLEAR_BITS(reasons);
+}
+
+bool audio_ctl_wait_running(uint32_t reasons, uint32_t timeout_ms)
+{
+    if (!ctl_events || CLEAR_BITS(reasons) == 0) {
+        return true;
+    }
+    TickType_t ticks = timeout_ms == AUDIO_CTL_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    EventBits_t bits = xEventGroupWaitBits(ctl_events, CLEAR_BITS(reasons), pdFALSE, pdTRUE, ticks);
+    return (bits & CLEAR_BITS(reasons)) == CLEAR_BITS(reasons);
+}
+
+esp_err_t audio_ctl_play(const int16_t *samples, size_t count, uint32_t sample_rate, uint32_t reasons,
+                         audio_ctl_write_fn write)
+{
+    size_t slice = (size_t)sample_rate * AUDIO_CTL_CHUNK_MS / 1000;
+    if (slice == 0) {
+        slice = count;
+    }
+    while (count > 0) {
+        audio_ctl_wait_running(reasons, AUDIO_CTL_WAIT_FOREVER);
+        size_t n = count < slice ? count : slice;
+        esp_err_t ret = write(samples, n * sizeof(int16_t), sample_rate);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        samples += n;
+        count -= n;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file audio_ctl.h
+ * @brief Pause/resume for background audio producers
+ *
+ * WAV and MP3 playback used to spin on a volatile flag with 50 ms sleeps,
+ * so a resume could lag by 50 ms and a pause by a whole 2 KB chunk. Here
+ * the pause state lives in an event group: audio_ctl_play() writes PCM in
+ * AUDIO_CTL_CHUNK_MS slices and blocks before each one until no pause
+ * reason is set, so a pause is silent after at most one slice and a resume
+ * wakes the producer immediately.
+ *
+ * Pause reasons are independent: a wake word pauses for listening, the
+ * "stop background audio" command pauses for the user, and resuming one
+ * does not clear the other. Producers name the reasons they honour, so a
+ * WAV the user asked for still plays while background audio is stopped.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_CTL_CHUNK_MS      20      // PCM written per slice, bounds pause-to-silence latency
+#define AUDIO_CTL_WAIT_FOREVER  UINT32_MAX
+
+typedef enum {
+    AUDIO_CTL_PAUSE_LISTENING = 1 << 0, // Wake word heard, ESP-SR is matching a command
+    AUDIO_CTL_PAUSE_USER      = 1 << 1, // "Stop background audio" command
+} audio_ctl_reason_t;
+
+#define AUDIO_CTL_PAUSE_ALL     (AUDIO_CTL_PAUSE_LISTENING | AUDIO_CTL_PAUSE_USER)
+
+// Blocking PCM write (mono 16-bit), e.g. audio_play()
+typedef esp_err_t (*audio_ctl_write_fn)(const int16_t *data, size_t len, uint32_t sample_rate);
+
+esp_err_t audio_ctl_init(void);
+
+void audio_ctl_pause(audio_ctl_reason_t reason);
+void audio_ctl_resume(audio_ctl_reason_t reason);
+
+/**
+ * @brief True while any of the given pause reasons is set
+ */
+bool audio_ctl_paused(uint32_t reasons);
+
+/**
+ * @brief Block until none of the given pause reasons is set
+ * @return false on timeout
+ */
+bool audio_ctl_wait_running(uint32_t reasons, uint32_t timeout_ms);
+
+/**
+ * @brief Write count mono samples in AUDIO_CTL_CHUNK_MS slices, waiting out pauses between slices
+ * @param reasons Pause reasons this producer honours
+ */
+esp_err_t audio_ctl_play(const int16_t *samples, size_t count, uint32_t sample_rate, uint32_t reasons,
+                         audio_ctl_write_fn write);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,295 @@
+/**
+ * @file boot_seq.c
+ * @brief Boot step scheduler, readiness events and timing table
+ */
+
+#include "boot_seq.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+static const char *TAG = "boot";
+
+#define READY_BITS(ready)       ((EventBits_t)(ready) & 0xff)
+#define UNAVAILABLE_BITS(ready) ((EventBits_t)((ready) & 0xff) << 8)
+
+static const boot_step_t *steps = NULL;
+static size_t step_count = 0;
+static boot_record_t records[BOOT_MAX_STEPS];
+static boot_record_t milestones[BOOT_MAX_MILESTONES];
+static size_t milestone_count = 0;
+
+static SemaphoreHandle_t boot_mutex = NULL;     // Guards records and milestones
+static EventGroupHandle_t step_events = NULL;   // Bit i: step i finished, whatever the outcome
+static EventGroupHandle_t ready_events = NULL;  // READY_BITS / UNAVAILABLE_BITS
+
+esp_err_t boot_seq_init(void)
+{
+    if (boot_mutex) {
+        return ESP_OK;
+    }
+    boot_mutex = xSemaphoreCreateMutex();
+    step_events = xEventGroupCreate();
+    ready_events = xEventGroupCreate();
+    if (!boot_mutex || !step_events || !ready_events) {
+        ESP_LOGE(TAG, "Failed to create boot events");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+const char *boot_state_name(boot_state_t state)
+{
+    switch (state) {
+    case BOOT_STEP_PENDING:   return "pending";
+    case BOOT_STEP_RUNNING:   return "running";
+    case BOOT_STEP_DONE:      return "done";
+    case BOOT_STEP_FAILED:    return "failed";
+    case BOOT_STEP_SKIPPED:   return "skipped";
+    case BOOT_MILESTONE:      return "milestone";
+    }
+    return "unknown";
+}
+
+// Steps that ended in a state their dependents can't run after (caller holds boot_mutex)
+static uint32_t broken_steps_locked(void)
+{
+    uint32_t broken = 0;
+    for (size_t i = 0; i < step_count; i++) {
+        if (records[i].state == BOOT_STEP_FAILED || records[i].state == BOOT_STEP_SKIPPED) {
+            broken |= BOOT_DEP(i);
+        }
+    }
+    return broken;
+}
+
+static void finish_step(size_t i, boot_state_t state, esp_err_t err)
+{
+    xSemaphoreTake(boot_mutex, portMAX_DELAY);
+    records[i].state = state;
+    records[i].err = err;
+    records[i].end_us = esp_timer_get_time();
+    xSemaphoreGive(boot_mutex);
+
+    if (state != BOOT_STEP_DONE && steps[i].provides) {
+        xEventGroupSetBits(ready_events, UNAVAILABLE_BITS(steps[i].provides));
+    }
+    xEventGroupSetBits(step_events, BOOT_DEP(i));
+}
+
+// Claim the next runnable step, skipping those behind a failure.
+// Returns -1 when none is runnable; *running is the mask still in flight.
+static int claim_step(uint32_t *running)
+{
+    int claimed = -1;
+    bool skipped;
+    do {
+        skipped = false;
+        xSemaphoreTake(boot_mutex, portMAX_DELAY);
+        uint32_t broken = broken_steps_locked();
+        uint32_t done = 0;
+        *running = 0;
+        for (size_t i = 0; i < step_count; i++) {
+            if (records[i].state == BOOT_STEP_DONE) {
+                done |= BOOT_DEP(i);
+            } else if (records[i].state == BOOT_STEP_RUNNING) {
+                *running |= BOOT_DEP(i);
+            }
+        }
+        int skip = -1;
+        for (size_t i = 0; i < step_count && claimed < 0 && skip < 0; i++) {
+            if (records[i].state != BOOT_STEP_PENDING) {
+                continue;
+            }
+            if (steps[i].deps & broken) {
+                skip = (int)i;
+            } else if ((steps[i].deps & ~done) == 0) {
+                records[i].state = BOOT_STEP_RUNNING;
+                records[i].start_us = esp_timer_get_time();
+                records[i].core = xPortGetCoreID();
+                *running |= BOOT_DEP(i);
+                claimed = (int)i;
+            }
+        }
+        xSemaphoreGive(boot_mutex);
+
+        if (skip >= 0) {
+            ESP_LOGW(TAG, "Skipping %s: a dependency failed", steps[skip].name);
+            finish_step(skip, BOOT_STEP_SKIPPED, ESP_ERR_INVALID_STATE);
+            skipped = true;
+        }
+    } while (skipped && claimed < 0);
+    return claimed;
+}
+
+static void boot_worker_task(void *arg)
+{
+    while (true) {
+        uint32_t running;
+        int i = claim_step(&running);
+        if (i >= 0) {
+            esp_err_t err = steps[i].run();
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Step %s failed: %s", steps[i].name, esp_err_to_name(err));
+            }
+            finish_step(i, err == ESP_OK ? BOOT_STEP_DONE : BOOT_STEP_FAILED, err);
+            continue;
+        }
+        if (!running) {
+            break;  // Nothing runnable and nothing in flight to unblock a step
+        }
+        // A finishing step may make another one runnable
+        EventBits_t pending = running & ~xEventGroupGetBits(step_events);
+        if (pending) {
+            xEventGroupWaitBits(step_events, pending, pdFALSE, pdFALSE, portMAX_DELAY);
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+esp_err_t boot_seq_run(const boot_step_t *boot_steps, size_t count)
+{
+    if (!boot_mutex || count == 0 || count > BOOT_MAX_STEPS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Dependencies only on earlier steps: the graph can't cycle, and the
+    // first pending step is always runnable once those before it finished
+    for (size_t i = 0; i < count; i++) {
+        if (boot_steps[i].deps & ~(BOOT_DEP(i) - 1)) {
+            ESP_LOGE(TAG, "Step %s depends on a later step", boot_steps[i].name);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    steps = boot_steps;
+    step_count = count;
+    for (size_t i = 0; i < count; i++) {
+        records[i] = (boot_record_t){ .name = boot_steps[i].name, .state = BOOT_STEP_PENDING, .core = -1 };
+    }
+    EventBits_t all = BOOT_DEP(count) - 1;
+    xEventGroupClearBits(step_events, all);
+
+    for (int w = 0; w < BOOT_WORKERS; w++) {
+        if (xTaskCreatePinnedToCore(boot_worker_task, "boot", BOOT_WORKER_STACK, NULL,
+                                    BOOT_WORKER_PRIORITY, NULL, tskNO_AFFINITY) != pdPASS) {
+            ESP_LOGW(TAG, "Boot worker %d not created", w);
+            if (w == 0) {
+                return ESP_ERR_NO_MEM;
+            }
+        }
+    }
+    xEventGroupWaitBits(step_events, all, pdFALSE, pdTRUE, portMAX_DELAY);
+
+    boot_seq_log();
+    for (size_t i = 0; i < count; i++) {
+        if (records[i].state != BOOT_STEP_DONE) {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+static const char *ready_name(uint32_t bit)
+{
+    switch (bit) {
+    case BOOT_READY_NETWORK:  return "network_ready";
+    case BOOT_READY_WAKE:     return "wake_ready";
+    }
+    return "ready";
+}
+
+void boot_seq_ready(uint32_t ready)
+{
+    if (!ready_events) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    // Only the first time each bit is set is a milestone
+    xSemaphoreTake(boot_mutex, portMAX_DELAY);
+    uint32_t fresh = READY_BITS(ready) & ~xEventGroupGetBits(ready_events);
+    xEventGroupSetBits(ready_events, READY_BITS(ready));
+    for (uint32_t bit = 1; bit <= fresh; bit <<= 1) {
+        if ((fresh & bit) && milestone_count < BOOT_MAX_MILESTONES) {
+            milestones[milestone_count++] = (boot_record_t){
+                .name = ready_name(bit),
+                .state = BOOT_MILESTONE,
+                .start_us = now,
+                .end_us = now,
+                .core = xPortGetCoreID(),
+            };
+        }
+    }
+    xSemaphoreGive(boot_mutex);
+
+    for (uint32_t bit = 1; bit <= fresh; bit <<= 1) {
+        if (fresh & bit) {
+            ESP_LOGI(TAG, "%s at %lld ms after power-on", ready_name(bit), (long long)(now / 1000));
+        }
+    }
+}
+
+bool boot_seq_wait_ready(uint32_t ready, uint32_t timeout_ms)
+{
+    if (!ready_events) {
+        return false;
+    }
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+    while (true) {
+        EventBits_t bits = xEventGroupGetBits(ready_events);
+        if ((bits & READY_BITS(ready)) == READY_BITS(ready)) {
+            return true;
+        }
+        if (bits & UNAVAILABLE_BITS(ready)) {
+            return false;
+        }
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(deadline - now) <= 0) {
+            return false;
+        }
+        // Wake on any change to the bits we care about
+        EventBits_t missing = READY_BITS(ready) & ~bits;
+        xEventGroupWaitBits(ready_events, missing | UNAVAILABLE_BITS(ready), pdFALSE, pdFALSE, deadline - now);
+    }
+}
+
+void boot_seq_foreach(boot_visit_t visit, void *ctx)
+{
+    if (!boot_mutex) {
+        return;
+    }
+    boot_record_t copy[BOOT_MAX_STEPS + BOOT_MAX_MILESTONES];
+    xSemaphoreTake(boot_mutex, portMAX_DELAY);
+    size_t n = 0;
+    for (size_t i = 0; i < step_count; i++) {
+        copy[n++] = records[i];
+    }
+    for (size_t i = 0; i < milestone_count; i++) {
+        copy[n++] = milestones[i];
+    }
+    xSemaphoreGive(boot_mutex);
+
+    for (size_t i = 0; i < n; i++) {
+        visit(&copy[i], ctx);
+    }
+}
+
+static void log_record(const boot_record_t *r, void *ctx)
+{
+    if (r->state == BOOT_MILESTONE) {
+        ESP_LOGI(TAG, "  %-14s %7lld ms", r->name, (long long)(r->start_us / 1000));
+    } else if (r->state == BOOT_STEP_PENDING || r->state == BOOT_STEP_SKIPPED) {
+        ESP_LOGI(TAG, "  %-14s %10s %s", r->name, "", boot_state_name(r->state));
+    } else {
+        ESP_LOGI(TAG, "  %-14s %7lld ms +%5lld ms  core %d  %s", r->name,
+                 (long long)(r->start_us / 1000), (long long)((r->end_us - r->start_us) / 1000),
+                 r->core, r->state == BOOT_STEP_FAILED ? esp_err_to_name(r->err) : boot_state_name(r->state));
+    }
+}
+
+void boot_seq_log(void)
+{
+    ESP_LOGI(TAG, "Boot steps (start since power-on, duration):");
+    boot_seq_foreach(log_record, NULL);
+}
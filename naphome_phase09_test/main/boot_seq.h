@@ -0,0 +1,109 @@
+/**
+ * @file boot_seq.h
+ * @brief Dependency-ordered, parallel boot with a timing table
+ *
+ * app_main declares its init steps with the steps each depends on, and
+ * boot_seq_run() executes them on BOOT_WORKERS worker tasks: a step starts
+ * as soon as its dependencies have succeeded, so Wi-Fi association, model
+ * loading and codec init overlap instead of running back to back. A step
+ * whose dependency failed is skipped.
+ *
+ * Things that finish after their step returns (an IP address, the first AFE
+ * frame) are readiness bits. Code that used to sleep a fixed time waits on
+ * them instead; a step that provides a readiness bit and fails or is
+ * skipped marks it unavailable, so nobody waits for it in vain.
+ *
+ * Every step's start and end time and every readiness milestone is kept in
+ * a table, logged on the console and served at /api/boot. The figure to
+ * drive down is the "wake_ready" milestone: power-on to the first frame the
+ * wake word detector sees.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOT_MAX_STEPS          16
+#define BOOT_MAX_MILESTONES     8
+#define BOOT_WORKERS            3       // Steps running at once
+#define BOOT_WORKER_STACK       12288   // AFE creation and Wi-Fi init run on these
+#define BOOT_WORKER_PRIORITY    4
+
+#define BOOT_DEP(step)          (1u << (step))
+
+typedef enum {
+    BOOT_READY_NETWORK  = 1 << 0,       // Station has an IP address
+    BOOT_READY_WAKE     = 1 << 1,       // detect_Task fetched its first AFE frame
+} boot_ready_t;
+
+typedef struct {
+    const char *name;
+    esp_err_t (*run)(void);
+    uint32_t deps;                      // BOOT_DEP() of steps that must succeed first
+    uint32_t provides;                  // boot_ready_t bits marked unavailable if this step fails
+} boot_step_t;
+
+typedef enum {
+    BOOT_STEP_PENDING,
+    BOOT_STEP_RUNNING,
+    BOOT_STEP_DONE,
+    BOOT_STEP_FAILED,
+    BOOT_STEP_SKIPPED,                  // A dependency failed or was skipped
+    BOOT_MILESTONE,                     // Readiness bit set, start_us == end_us
+} boot_state_t;
+
+typedef struct {
+    const char *name;
+    boot_state_t state;
+    esp_err_t err;
+    int64_t start_us;                   // esp_timer time, i.e. since power-on
+    int64_t end_us;
+    int core;
+} boot_record_t;
+
+typedef void (*boot_visit_t)(const boot_record_t *record, void *ctx);
+
+/**
+ * @brief Create the readiness events; call first thing in app_main
+ */
+esp_err_t boot_seq_init(void);
+
+/**
+ * @brief Run steps[count] on the worker pool and block until all finished
+ * @return ESP_FAIL if any step failed or was skipped
+ */
+esp_err_t boot_seq_run(const boot_step_t *steps, size_t count);
+
+/**
+ * @brief Set readiness bits and record a milestone for each
+ */
+void boot_seq_ready(uint32_t ready);
+
+/**
+ * @brief Wait until all given readiness bits are set
+ * @return false on timeout or if one of them became unavailable
+ */
+bool boot_seq_wait_ready(uint32_t ready, uint32_t timeout_ms);
+
+/**
+ * @brief Visit steps in declaration order, then milestones in the order they happened
+ */
+void boot_seq_foreach(boot_visit_t visit, void *ctx);
+
+/**
+ * @brief Print the timing table on the console
+ */
+void boot_seq_log(void);
+
+const char *boot_state_name(boot_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,292 @@
+/**
+ * @file circuit_breaker.c
+ * @brief Rolling-window circuit breakers with a background health probe
+ */
+
+#include "circuit_breaker.h"
+#include "metrics.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "breaker";
+
+#define WAKE_BIT    (1 << 0)    // A breaker opened: recompute the next probe time
+
+typedef struct {
+    uint32_t epoch;             // Window slice this bucket counts
+    uint32_t calls;
+    uint32_t failures;
+} breaker_bucket_t;
+
+struct breaker {
+    breaker_config_t config;
+    portMUX_TYPE lock;
+    breaker_state_t state;
+    breaker_bucket_t buckets[BREAKER_BUCKETS];
+    uint32_t failure_run;       // Consecutive failures
+    uint32_t open_ms;           // Current probe interval
+    int64_t next_probe_us;      // OPEN: when the task probes next
+    int64_t trial_us;           // HALF_OPEN: when the trial call started (0: not yet)
+    metrics_metric_t *state_gauge;
+    metrics_metric_t *rejected;
+};
+
+static breaker_t breakers[BREAKER_MAX];
+static size_t breaker_count = 0;
+static portMUX_TYPE pool_lock = portMUX_INITIALIZER_UNLOCKED;
+static EventGroupHandle_t breaker_events = NULL;
+
+const char *breaker_state_name(breaker_state_t state)
+{
+    switch (state) {
+    case BREAKER_CLOSED:      return "closed";
+    case BREAKER_OPEN:        return "open";
+    case BREAKER_HALF_OPEN:   return "half-open";
+    }
+    return "unknown";
+}
+
+static uint32_t slice_ms(const breaker_t *b)
+{
+    uint32_t slice = b->config.window_ms / BREAKER_BUCKETS;
+    return slice ? slice : 1;
+}
+
+// Open and schedule the next probe (caller holds b->lock)
+static void open_locked(breaker_t *b, int64_t now, uint32_t interval_ms)
+{
+    b->state = BREAKER_OPEN;
+    b->open_ms = interval_ms < b->config.open_max_ms ? interval_ms : b->config.open_max_ms;
+    b->next_probe_us = now + (int64_t)b->open_ms * 1000;
+    b->trial_us = 0;
+    b->failure_run = 0;
+    memset(b->buckets, 0, sizeof(b->buckets));
+}
+
+static void close_locked(breaker_t *b)
+{
+    b->state = BREAKER_CLOSED;
+    b->open_ms = b->config.open_min_ms;
+    b->trial_us = 0;
+    b->failure_run = 0;
+    memset(b->buckets, 0, sizeof(b->buckets));
+}
+
+static void log_transition(breaker_t *b, breaker_state_t before, breaker_state_t after, uint32_t open_ms)
+{
+    metrics_gauge_set(b->state_gauge, after);
+    if (after == BREAKER_OPEN) {
+        ESP_LOGW(TAG, "%s: %s -> open, probing in %lu ms", b->config.name, breaker_state_name(before),
+                 (unsigned long)open_ms);
+        xEventGroupSetBits(breaker_events, WAKE_BIT);
+    } else {
+        ESP_LOGI(TAG, "%s: %s -> %s", b->config.name, breaker_state_name(before), breaker_state_name(after));
+    }
+}
+
+bool breaker_allow(breaker_t *b)
+{
+    if (!b) {
+        return true;
+    }
+    int64_t now = esp_timer_get_time();
+    bool allowed = false;
+    portENTER_CRITICAL(&b->lock);
+    switch (b->state) {
+    case BREAKER_CLOSED:
+        allowed = true;
+        break;
+    case BREAKER_OPEN:
+        break;
+    case BREAKER_HALF_OPEN:
+        // One trial at a time; a trial that never reported doesn't block forever
+        if (!b->trial_us || now - b->trial_us > (int64_t)BREAKER_TRIAL_TIMEOUT_MS * 1000) {
+            b->trial_us = now;
+            allowed = true;
+        }
+        break;
+    }
+    portEXIT_CRITICAL(&b->lock);
+
+    if (!allowed) {
+        metrics_inc(b->rejected);
+    }
+    return allowed;
+}
+
+void breaker_record(breaker_t *b, bool success)
+{
+    if (!b) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    uint32_t epoch = (uint32_t)(now / 1000 / slice_ms(b));
+    portENTER_CRITICAL(&b->lock);
+    breaker_state_t before = b->state;
+    if (b->state == BREAKER_HALF_OPEN) {
+        if (success) {
+            close_locked(b);
+        } else {
+            open_locked(b, now, b->open_ms * 2);
+        }
+    } else if (b->state == BREAKER_CLOSED) {
+        breaker_bucket_t *bucket = &b->buckets[epoch % BREAKER_BUCKETS];
+        if (bucket->epoch != epoch) {
+            *bucket = (breaker_bucket_t){ .epoch = epoch };
+        }
+        bucket->calls++;
+        bucket->failures += success ? 0 : 1;
+        b->failure_run = success ? 0 : b->failure_run + 1;
+
+        uint32_t calls = 0;
+        uint32_t failures = 0;
+        for (int i = 0; i < BREAKER_BUCKETS; i++) {
+            if (epoch - b->buckets[i].epoch < BREAKER_BUCKETS) {
+                calls += b->buckets[i].calls;
+                failures += b->buckets[i].failures;
+            }
+        }
+        bool rate_tripped = calls >= b->config.min_calls && failures * 100 >= b->config.error_pct * calls;
+        bool run_tripped = b->config.consecutive && b->failure_run >= b->config.consecutive;
+        if (!success && (rate_tripped || run_tripped)) {
+            open_locked(b, now, b->config.open_min_ms);
+        }
+    }
+    // Calls that were already in flight when the breaker opened don't count
+    breaker_state_t after = b->state;
+    uint32_t open_ms = b->open_ms;
+    portEXIT_CRITICAL(&b->lock);
+
+    if (after != before) {
+        log_transition(b, before, after, open_ms);
+    }
+}
+
+breaker_state_t breaker_state(breaker_t *b)
+{
+    if (!b) {
+        return BREAKER_CLOSED;
+    }
+    portENTER_CRITICAL(&b->lock);
+    breaker_state_t state = b->state;
+    portEXIT_CRITICAL(&b->lock);
+    return state;
+}
+
+// Probe one open breaker that is due
+static void probe_breaker(breaker_t *b)
+{
+    bool healthy = b->config.probe ? b->config.probe(b->config.probe_ctx) : true;
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&b->lock);
+    breaker_state_t before = b->state;
+    if (b->state == BREAKER_OPEN) {
+        if (healthy) {
+            b->state = BREAKER_HALF_OPEN;
+            b->trial_us = 0;
+        } else {
+            open_locked(b, now, b->open_ms * 2);
+        }
+    }
+    breaker_state_t after = b->state;
+    uint32_t open_ms = b->open_ms;
+    portEXIT_CRITICAL(&b->lock);
+
+    if (after != before) {
+        log_transition(b, before, after, open_ms);
+    } else if (after == BREAKER_OPEN) {
+        ESP_LOGD(TAG, "%s: probe failed, next in %lu ms", b->config.name, (unsigned long)open_ms);
+    }
+}
+
+static void breaker_task(void *arg)
+{
+    while (true) {
+        int64_t now = esp_timer_get_time();
+        int64_t next_us = INT64_MAX;
+        portENTER_CRITICAL(&pool_lock);
+        size_t count = breaker_count;
+        portEXIT_CRITICAL(&pool_lock);
+
+        for (size_t i = 0; i < count; i++) {
+            breaker_t *b = &breakers[i];
+            portENTER_CRITICAL(&b->lock);
+            bool open = (b->state == BREAKER_OPEN);
+            int64_t due_us = b->next_probe_us;
+            portEXIT_CRITICAL(&b->lock);
+            if (!open) {
+                continue;
+            }
+            if (due_us <= now) {
+                probe_breaker(b);
+                now = esp_timer_get_time();
+                portENTER_CRITICAL(&b->lock);
+                open = (b->state == BREAKER_OPEN);
+                due_us = b->next_probe_us;
+                portEXIT_CRITICAL(&b->lock);
+            }
+            if (open && due_us < next_us) {
+                next_us = due_us;
+            }
+        }
+
+        TickType_t wait = portMAX_DELAY;
+        if (next_us != INT64_MAX) {
+            int64_t left_ms = (next_us - now) / 1000;
+            wait = left_ms > 0 ? pdMS_TO_TICKS(left_ms) + 1 : 0;
+        }
+        xEventGroupWaitBits(breaker_events, WAKE_BIT, pdTRUE, pdFALSE, wait);
+    }
+}
+
+esp_err_t breaker_init(void)
+{
+    if (breaker_events) {
+        return ESP_OK;
+    }
+    breaker_events = xEventGroupCreate();
+    if (!breaker_events) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(breaker_task, "breaker", BREAKER_TASK_STACK, NULL,
+                                BREAKER_TASK_PRIORITY, NULL, 0) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+breaker_t *breaker_create(const breaker_config_t *config)
+{
+    if (!config || !breaker_events) {
+        return NULL;
+    }
+    portENTER_CRITICAL(&pool_lock);
+    breaker_t *b = breaker_count < BREAKER_MAX ? &breakers[breaker_count] : NULL;
+    portEXIT_CRITICAL(&pool_lock);
+    if (!b) {
+        ESP_LOGE(TAG, "No breaker left for %s", config->name ? config->name : "?");
+        return NULL;
+    }
+
+    b->config = *config;
+    if (!b->config.name) {
+        b->config.name = "breaker";
+    }
+    b->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    close_locked(b);
+    b->state_gauge = metrics_gauge("naphome_breaker_state", b->config.labels,
+                                   "Cloud API circuit breaker: 0 closed, 1 open, 2 half-open");
+    b->rejected = metrics_counter("naphome_breaker_rejected_total", b->config.labels,
+                                  "Calls refused at once because the circuit was open");
+
+    // Publish only once set up: the task walks breakers[0..breaker_count)
+    portENTER_CRITICAL(&pool_lock);
+    breaker_count++;
+    portEXIT_CRITICAL(&pool_lock);
+    return b;
+}
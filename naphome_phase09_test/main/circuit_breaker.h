@@ -0,0 +1,106 @@
+/**
+ * @file circuit_breaker.h
+ * @brief Per-endpoint circuit breakers for the cloud APIs
+ *
+ * A breaker counts call outcomes in a rolling window. It opens when the
+ * failure rate in the window crosses a threshold, or after a run of
+ * consecutive failures (so earlier successes in the window don't hide an
+ * outage that has just started). While open, breaker_allow() refuses calls
+ * at once instead of letting each one wait out its HTTP timeout. While open, a background
+ * task runs the breaker's health probe with exponential backoff; when the
+ * probe succeeds the breaker goes half-open and lets one real call through
+ * as a trial. Its outcome closes the breaker or opens it again.
+ *
+ * breaker_allow() and breaker_record() take a spinlock and touch a few
+ * counters, so checking a known-down endpoint costs microseconds. State
+ * and refusals are exported as naphome_breaker_state (0 closed, 1 open,
+ * 2 half-open) and naphome_breaker_rejected_total.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BREAKER_MAX                 4       // Breakers breaker_create() can hand out
+#define BREAKER_BUCKETS             6       // Slices of the rolling window
+#define BREAKER_TRIAL_TIMEOUT_MS    60000   // Half-open trial given up if never recorded
+#define BREAKER_TASK_STACK          6144    // Probes may do a TLS handshake
+#define BREAKER_TASK_PRIORITY       2
+
+typedef enum {
+    BREAKER_CLOSED,     // Calls go through
+    BREAKER_OPEN,       // Calls are refused; the probe decides when to try again
+    BREAKER_HALF_OPEN,  // One trial call goes through
+} breaker_state_t;
+
+/**
+ * @brief Health check run from the breaker task while open; may block
+ * @return true if the endpoint answered
+ */
+typedef bool (*breaker_probe_t)(void *ctx);
+
+typedef struct {
+    const char *name;           // For logs
+    const char *labels;         // Metric labels, e.g. "api=\"tts\"" (must stay valid)
+    uint32_t window_ms;         // Rolling window the error rate is taken over
+    uint32_t min_calls;         // Calls in the window before the rate can open the breaker
+    uint32_t error_pct;         // Failure percentage that opens it
+    uint32_t consecutive;       // Failures in a row that open it regardless of the rate
+    uint32_t open_min_ms;       // First probe after opening
+    uint32_t open_max_ms;       // Probe interval cap (doubles on each failure)
+    breaker_probe_t probe;      // NULL: half-open whenever the interval ends
+    void *probe_ctx;
+} breaker_config_t;
+
+#define BREAKER_DEFAULT_CONFIG() {              \
+    .name = NULL,                               \
+    .labels = NULL,                             \
+    .window_ms = 60000,                         \
+    .min_calls = 2,                             \
+    .error_pct = 50,                            \
+    .consecutive = 2,                           \
+    .open_min_ms = 5000,                        \
+    .open_max_ms = 60000,                       \
+    .probe = NULL,                              \
+    .probe_ctx = NULL,                          \
+}
+
+typedef struct breaker breaker_t;
+
+/**
+ * @brief Start the probe task
+ */
+esp_err_t breaker_init(void);
+
+/**
+ * @brief Set up a breaker; the config is copied. Call at startup, from one task.
+ * @return NULL if all BREAKER_MAX are in use (a NULL breaker allows every call)
+ */
+breaker_t *breaker_create(const breaker_config_t *config);
+
+/**
+ * @brief Whether a call may go ahead; never blocks
+ *
+ * A call that is allowed should report its outcome with breaker_record().
+ */
+bool breaker_allow(breaker_t *breaker);
+
+/**
+ * @brief Outcome of a call: success means the endpoint answered, whatever
+ *        the status (a 4xx is the caller's problem, not an outage)
+ */
+void breaker_record(breaker_t *breaker, bool success);
+
+breaker_state_t breaker_state(breaker_t *breaker);
+
+const char *breaker_state_name(breaker_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
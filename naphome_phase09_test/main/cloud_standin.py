@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""
+Local stand-in for the Google STT, Gemini and TTS endpoints
+
+Answers the three requests the firmware makes with canned responses, and
+delays every new connection by --handshake-ms before reading from it, to
+stand in for DNS plus the TLS handshake to Google. Requests on a kept-alive
+connection are answered without the delay, so the log shows which requests
+used a connection pre-warmed at the wake word.
+
+Point GOOGLE_STT_HOST, GEMINI_LLM_HOST and GOOGLE_TTS_HOST in
+naphome_test_suite.c at http://<this machine>:8080, flash, and say the wake
+word followed by something the speech commands don't cover. With --cert and
+--key the stand-in speaks TLS (use https:// and
+CONFIG_ESP_TLS_SKIP_SERVER_CERT_VERIFY), and the delay comes before the
+real handshake.
+
+kill -USR1 <pid> switches the stand-in off and on again. While off it
+accepts connections but never answers, like an upstream that is down
+behind a working Wi-Fi network.
+
+--latency-ms, --jitter and --tail shape how long each POST takes to be
+answered: a log-normal delay with the given median and sigma, plus, for a
+fraction of requests, a stall (e.g. --tail 0.05:2000 for 5% taking 2 s
+longer), to exercise the adaptive timeouts and TTS hedging.
+--uplink-kbps reads request bodies no faster than a slow Wi-Fi uplink,
+which shows what the STT upload size costs in time; the log gives each
+STT request's encoding and audio size.
+
+--exec runs a command once the stand-in listens, with {url} in its
+arguments replaced by http://127.0.0.1:<port>, and returns its exit
+status; that is how ctest runs the host tests against it. --port 0 picks
+a free port.
+
+Usage: python3 cloud_standin.py [--port 8080] [--handshake-ms 600] [--cert C --key K]
+                                [--latency-ms 0] [--jitter 0] [--tail P:MS] [--uplink-kbps 0] [--seed N]
+                                [--exec CMD ARGS...]
+"""
+
+import argparse
+import base64
+import json
+import os
+import random
+import signal
+import ssl
+import subprocess
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+TTS_SAMPLE_RATE = 44100
+serving = threading.Event()  # Cleared while switched off
+
+
+class StandinHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"  # Keep-alive
+    handshake_ms = 600
+    tls = None  # ssl.SSLContext when serving https
+    latency_ms = 0
+    jitter = 0.0
+    tail = (0.0, 0)  # (fraction, extra ms)
+    uplink_kbps = 0  # 0: unthrottled
+    transcript = "what is the weather like on mars"
+    reply = "Cold, dusty and about minus sixty degrees."
+
+    def setup(self):
+        serving.wait()
+        time.sleep(self.handshake_ms / 1000.0)
+        if self.tls:
+            self.request = self.tls.wrap_socket(self.request, server_side=True)
+        super().setup()
+        self.connected = time.monotonic()
+        self.requests = 0
+        self.log_message("new connection, %d ms setup", self.handshake_ms)
+
+    def handle(self):
+        # A request held while switched off outlives the client's timeout
+        try:
+            super().handle()
+        except (BrokenPipeError, ConnectionResetError):
+            self.close_connection = True
+
+    def response_delay(self):
+        delay = self.latency_ms * random.lognormvariate(0, self.jitter) if self.jitter else self.latency_ms
+        if random.random() < self.tail[0]:
+            delay += self.tail[1]
+        return delay / 1000.0
+
+    def read_body(self, length):
+        if not self.uplink_kbps:
+            return self.rfile.read(length)
+        chunks = []
+        start = time.monotonic()
+        received = 0
+        while received < length:
+            chunk = self.rfile.read(min(1460, length - received))
+            if not chunk:
+                break
+            chunks.append(chunk)
+            received += len(chunk)
+            due = start + received * 8 / (self.uplink_kbps * 1000.0)
+            time.sleep(max(0.0, due - time.monotonic()))
+        return b"".join(chunks)
+
+    def send_json(self, status, body):
+        data = json.dumps(body).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def do_HEAD(self):
+        # What prewarm and the circuit breaker probe send: any answer will do
+        serving.wait()
+        self.requests += 1
+        self.send_response(404)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+    def do_POST(self):
+        self.requests += 1
+        length = int(self.headers.get("Content-Length", 0))
+        started = time.monotonic()
+        body = self.read_body(length)
+        if "speech:recognize" in self.path:
+            request = json.loads(body)
+            audio = base64.b64decode(request["audio"]["content"])
+            self.log_message("STT %s: %d audio bytes, %d byte body received in %.0f ms",
+                             request["config"]["encoding"], len(audio), length,
+                             (time.monotonic() - started) * 1000)
+        serving.wait()
+        time.sleep(self.response_delay())
+        age_ms = (time.monotonic() - self.connected) * 1000
+        self.log_message("%s on %s connection (%.0f ms old)", self.path.split("?")[0],
+                         "a new" if self.requests == 1 else "a reused", age_ms)
+
+        if "speech:recognize" in self.path:
+            self.send_json(200, {"results": [{"alternatives": [{"transcript": self.transcript}]}]})
+        elif "generateContent" in self.path:
+            self.send_json(200, {"candidates": [{"content": {"parts": [{"text": self.reply}]}}]})
+        elif "text:synthesize" in self.path:
+            silence = bytes(2 * TTS_SAMPLE_RATE // 4)  # 250 ms of LINEAR16
+            self.send_json(200, {"audioContent": base64.b64encode(silence).decode()})
+        else:
+            self.send_json(404, {"error": {"message": "unknown endpoint"}})
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--port", type=int, default=8080, help="0 picks a free port")
+    parser.add_argument("--handshake-ms", type=int, default=600,
+                        help="delay before serving a new connection")
+    parser.add_argument("--cert", help="PEM certificate: serve https")
+    parser.add_argument("--key", help="PEM private key for --cert")
+    parser.add_argument("--latency-ms", type=float, default=0,
+                        help="median delay before a POST is answered")
+    parser.add_argument("--jitter", type=float, default=0,
+                        help="sigma of the log-normal spread around --latency-ms")
+    parser.add_argument("--tail", default="0:0",
+                        help="P:MS - fraction of POSTs stalled for MS more")
+    parser.add_argument("--uplink-kbps", type=float, default=0,
+                        help="read request bodies at most this fast")
+    parser.add_argument("--seed", type=int, help="seed the latency draws, for repeatable runs")
+    parser.add_argument("--exec", nargs=argparse.REMAINDER, dest="command",
+                        help="command to run against the stand-in; {url} is replaced")
+    args = parser.parse_args()
+
+    StandinHandler.handshake_ms = args.handshake_ms
+    StandinHandler.latency_ms = args.latency_ms
+    StandinHandler.jitter = args.jitter
+    StandinHandler.uplink_kbps = args.uplink_kbps
+    fraction, extra_ms = args.tail.split(":")
+    StandinHandler.tail = (float(fraction), float(extra_ms))
+    if args.seed is not None:
+        random.seed(args.seed)
+    if args.cert:
+        StandinHandler.tls = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        StandinHandler.tls.load_cert_chain(args.cert, args.key)
+    def toggle(signum, frame):
+        if serving.is_set():
+            serving.clear()
+        else:
+            serving.set()
+        print("Switched " + ("on" if serving.is_set() else "off"), flush=True)
+
+    serving.set()
+    signal.signal(signal.SIGUSR1, toggle)
+    server = ThreadingHTTPServer(("", args.port), StandinHandler)
+    server.daemon_threads = True
+    port = server.server_address[1]
+    print(f"Cloud stand-in on port {port} ({'https' if args.cert else 'http'}), "
+          f"{args.handshake_ms} ms per new connection, pid {os.getpid()}", flush=True)
+    if not args.command:
+        server.serve_forever()
+        return 0
+
+    def serve():
+        # SIGUSR1 must reach the main thread: its toggle only runs there, and
+        # the main thread is blocked waiting for the command
+        signal.pthread_sigmask(signal.SIG_BLOCK, {signal.SIGUSR1})
+        server.serve_forever()
+
+    threading.Thread(target=serve, daemon=True).start()
+    scheme = "https" if args.cert else "http"
+    url = f"{scheme}://127.0.0.1:{port}"
+    try:
+        return subprocess.call([arg.replace("{url}", url) for arg in args.command])
+    except KeyboardInterrupt:
+        return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
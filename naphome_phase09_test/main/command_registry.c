@@ -0,0 +1,311 @@
+/**
+ * @file command_registry.c
+ * @brief Speech command registry: blob parsing, NVS persistence, MultiNet registration
+ */
+
+#include "command_registry.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_mn_speech_commands.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "cmd_registry";
+
+#define REGISTRY_NVS_NAMESPACE  "cmd_reg"
+#define REGISTRY_NVS_KEY        "blob"
+#define REGISTRY_MAGIC          "NCMD"
+#define REGISTRY_VERSION        1
+#define REGISTRY_HEADER_LEN     12
+#define REGISTRY_ENTRY_LEN      8
+#define REGISTRY_NO_STRING      0xFFFF
+
+// Built from commands.yaml by gen_command_registry.py
+extern const uint8_t command_registry_default[];
+extern const size_t command_registry_default_len;
+
+typedef struct {
+    uint8_t *blob;              // Owned copy; entry strings point into it
+    size_t count;
+    command_entry_t *entries;   // Sorted by ID
+    int16_t by_id[COMMAND_REGISTRY_MAX_ID];     // Index into entries, -1 if unused
+} registry_t;
+
+static registry_t *active = NULL;       // Swapped and freed under registry_mutex
+static registry_t *pending = NULL;      // Stored but not yet applied
+static SemaphoreHandle_t registry_mutex = NULL;
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void registry_free(registry_t *reg)
+{
+    if (reg) {
+        free(reg->entries);
+        free(reg->blob);
+        free(reg);
+    }
+}
+
+// Resolve a string offset; NULL for "none", sets *ok = false if out of bounds
+static const char *pool_string(const uint8_t *pool, size_t pool_len, uint16_t offset, bool *ok)
+{
+    if (offset == REGISTRY_NO_STRING) {
+        return NULL;
+    }
+    if (offset >= pool_len || !memchr(pool + offset, '\0', pool_len - offset)) {
+        *ok = false;
+        return NULL;
+    }
+    return (const char *)pool + offset;
+}
+
+static esp_err_t registry_parse(const uint8_t *data, size_t len, registry_t **out)
+{
+    if (!data || len < REGISTRY_HEADER_LEN || len > COMMAND_REGISTRY_MAX_BLOB ||
+        memcmp(data, REGISTRY_MAGIC, 4) != 0 || data[4] != REGISTRY_VERSION) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t count = data[5];
+    size_t pool_len = read_u16(data + 6);
+    if (REGISTRY_HEADER_LEN + count * REGISTRY_ENTRY_LEN + pool_len != len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (esp_rom_crc32_le(0, data + REGISTRY_HEADER_LEN, len - REGISTRY_HEADER_LEN) != read_u32(data + 8)) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    registry_t *reg = calloc(1, sizeof(registry_t));
+    if (!reg) {
+        return ESP_ERR_NO_MEM;
+    }
+    reg->blob = heap_caps_malloc(len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!reg->blob) {
+        reg->blob = malloc(len);
+    }
+    reg->entries = calloc(count ? count : 1, sizeof(command_entry_t));
+    if (!reg->blob || !reg->entries) {
+        registry_free(reg);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(reg->blob, data, len);
+    memset(reg->by_id, 0xFF, sizeof(reg->by_id));
+
+    const uint8_t *table = reg->blob + REGISTRY_HEADER_LEN;
+    const uint8_t *pool = table + count * REGISTRY_ENTRY_LEN;
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++) {
+        const uint8_t *e = table + i * REGISTRY_ENTRY_LEN;
+        command_entry_t *entry = &reg->entries[i];
+        entry->id = e[0];
+        entry->phonemes = pool_string(pool, pool_len, read_u16(e + 2), &ok);
+        entry->phrase = pool_string(pool, pool_len, read_u16(e + 4), &ok);
+        entry->intent = pool_string(pool, pool_len, read_u16(e + 6), &ok);
+        if (entry->id >= COMMAND_REGISTRY_MAX_ID || reg->by_id[entry->id] >= 0 ||
+            !entry->phonemes || (i > 0 && entry->id < reg->entries[i - 1].id)) {
+            ok = false;  // Bad ID, duplicate, missing phonemes or not sorted
+            break;
+        }
+        reg->by_id[entry->id] = (int16_t)i;
+    }
+    if (!ok) {
+        registry_free(reg);
+        return ESP_ERR_INVALID_ARG;
+    }
+    reg->count = count;
+    *out = reg;
+    return ESP_OK;
+}
+
+// Registry blob saved by a previous command_registry_store(), if any
+static registry_t *registry_load_nvs(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(REGISTRY_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return NULL;
+    }
+    registry_t *reg = NULL;
+    size_t len = 0;
+    if (nvs_get_blob(handle, REGISTRY_NVS_KEY, NULL, &len) == ESP_OK && len <= COMMAND_REGISTRY_MAX_BLOB) {
+        uint8_t *data = malloc(len);
+        if (data && nvs_get_blob(handle, REGISTRY_NVS_KEY, data, &len) == ESP_OK) {
+            esp_err_t ret = registry_parse(data, len, &reg);
+            if (ret != ESP_OK) {
+                ESP_LOGW(TAG, "Ignoring stored registry: %s", esp_err_to_name(ret));
+            }
+        }
+        free(data);
+    }
+    nvs_close(handle);
+    return reg;
+}
+
+esp_err_t command_registry_init(void)
+{
+    if (!registry_mutex) {
+        registry_mutex = xSemaphoreCreateMutex();
+        if (!registry_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    const char *source = "NVS";
+    registry_t *reg = registry_load_nvs();
+    if (!reg) {
+        source = "built-in default";
+        esp_err_t ret = registry_parse(command_registry_default, command_registry_default_len, &reg);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Built-in registry is invalid: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+    xSemaphoreTake(registry_mutex, portMAX_DELAY);
+    registry_free(active);
+    active = reg;
+    xSemaphoreGive(registry_mutex);
+    ESP_LOGI(TAG, "Loaded %u speech commands from %s", (unsigned)reg->count, source);
+    return ESP_OK;
+}
+
+bool command_registry_update_pending(void)
+{
+    return pending != NULL;
+}
+
+esp_err_t command_registry_apply(esp_mn_iface_t *multinet, model_iface_data_t *model_data)
+{
+    if (!registry_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(registry_mutex, portMAX_DELAY);
+    if (pending) {
+        registry_free(active);
+        active = pending;
+        pending = NULL;
+    }
+    registry_t *reg = active;
+    xSemaphoreGive(registry_mutex);
+    if (!reg) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = esp_mn_commands_alloc(multinet, model_data);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    for (size_t i = 0; i < reg->count; i++) {
+        ret = esp_mn_commands_add(reg->entries[i].id, reg->entries[i].phonemes);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Rejected command %u '%s'", reg->entries[i].id, reg->entries[i].phonemes);
+        }
+    }
+    esp_mn_error_t *errors = esp_mn_commands_update();
+    if (errors && errors->num > 0) {
+        ESP_LOGW(TAG, "MultiNet rejected %d phrases", errors->num);
+    }
+    ESP_LOGI(TAG, "Registered %u speech commands with MultiNet", (unsigned)reg->count);
+    return ESP_OK;
+}
+
+// Append src to buf; NULL stays NULL, *ret becomes ESP_ERR_INVALID_SIZE if it does not fit
+static const char *copy_string(const char *src, char *buf, size_t buf_len, size_t *used, esp_err_t *ret)
+{
+    if (!src) {
+        return NULL;
+    }
+    size_t len = strlen(src) + 1;
+    if (len > buf_len - *used) {
+        *ret = ESP_ERR_INVALID_SIZE;
+        return NULL;
+    }
+    char *dst = buf + *used;
+    memcpy(dst, src, len);
+    *used += len;
+    return dst;
+}
+
+esp_err_t command_registry_get(int id, command_entry_t *entry, char *buf, size_t buf_len)
+{
+    if (!registry_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!entry || (!buf && buf_len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (id < 0 || id >= COMMAND_REGISTRY_MAX_ID) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(registry_mutex, portMAX_DELAY);
+    registry_t *reg = active;
+    if (reg && reg->by_id[id] >= 0) {
+        const command_entry_t *src = &reg->entries[reg->by_id[id]];
+        size_t used = 0;
+        ret = ESP_OK;
+        entry->id = src->id;
+        entry->phonemes = copy_string(src->phonemes, buf, buf_len, &used, &ret);
+        entry->phrase = copy_string(src->phrase, buf, buf_len, &used, &ret);
+        entry->intent = copy_string(src->intent, buf, buf_len, &used, &ret);
+    }
+    xSemaphoreGive(registry_mutex);
+    return ret;
+}
+
+void command_registry_foreach(command_visit_t visit, void *ctx)
+{
+    if (!registry_mutex || !visit) {
+        return;
+    }
+    xSemaphoreTake(registry_mutex, portMAX_DELAY);
+    // A queued registry is what the device will run, so show that one
+    registry_t *reg = pending ? pending : active;
+    for (size_t i = 0; reg && i < reg->count; i++) {
+        visit(&reg->entries[i], ctx);
+    }
+    xSemaphoreGive(registry_mutex);
+}
+
+esp_err_t command_registry_store(const uint8_t *blob, size_t len)
+{
+    if (!registry_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    registry_t *reg = NULL;
+    esp_err_t ret = registry_parse(blob, len, &reg);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    nvs_handle_t handle;
+    ret = nvs_open(REGISTRY_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, REGISTRY_NVS_KEY, blob, len);
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Registry not persisted (%s) - active until reboot", esp_err_to_name(ret));
+    }
+
+    xSemaphoreTake(registry_mutex, portMAX_DELAY);
+    registry_free(pending);
+    pending = reg;
+    xSemaphoreGive(registry_mutex);
+    ESP_LOGI(TAG, "Queued registry with %u commands", (unsigned)reg->count);
+    return ESP_OK;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file command_registry.h
+ * @brief Runtime speech command registry
+ *
+ * MultiNet commands (ID, phonemes, phrase and local intent) come from a
+ * compact binary registry compiled from commands.yaml by
+ * gen_command_registry.py. At boot the registry stored in NVS is used if
+ * present and valid, otherwise the copy embedded at build time. Lookups by
+ * command ID are a direct index.
+ *
+ * command_registry_store() accepts a new blob at runtime (e.g. from
+ * POST /api/commands) and persists it; the detect task picks it up with
+ * command_registry_apply() between utterances, so new commands take effect
+ * without reflashing or rebooting.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_mn_iface.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COMMAND_REGISTRY_MAX_ID         200     // MultiNet command IDs are 0..199
+#define COMMAND_REGISTRY_MAX_BLOB       8192    // Largest registry accepted
+
+typedef struct {
+    uint8_t id;
+    const char *phonemes;
+    const char *phrase;         // May be NULL
+    const char *intent;         // Local intent name, NULL to use STT/LLM
+} command_entry_t;
+
+typedef void (*command_visit_t)(const command_entry_t *entry, void *ctx);
+
+/**
+ * @brief Load the registry from NVS, falling back to the built-in default
+ */
+esp_err_t command_registry_init(void);
+
+/**
+ * @brief Register the current commands with MultiNet
+ *
+ * Swaps in a registry queued by command_registry_store() first. Call from
+ * the task that owns model_data.
+ */
+esp_err_t command_registry_apply(esp_mn_iface_t *multinet, model_iface_data_t *model_data);
+
+/**
+ * @brief true if command_registry_store() queued a registry not yet applied
+ */
+bool command_registry_update_pending(void);
+
+/**
+ * @brief Copy the entry for a command ID out of the active registry (any task)
+ *
+ * The strings are copied into buf, so the entry stays valid after a later
+ * command_registry_apply() frees the registry it came from.
+ *
+ * @param entry Filled in on success; its strings point into buf
+ * @param buf Storage for phonemes, phrase and intent
+ * @return ESP_ERR_NOT_FOUND for an unused ID, ESP_ERR_INVALID_SIZE if the
+ *         strings do not fit in buf
+ */
+esp_err_t command_registry_get(int id, command_entry_t *entry, char *buf, size_t buf_len);
+
+/**
+ * @brief Visit every entry of the active registry in ID order (any task)
+ */
+void command_registry_foreach(command_visit_t visit, void *ctx);
+
+/**
+ * @brief Validate, persist and queue a new registry blob
+ * @return ESP_ERR_INVALID_ARG / ESP_ERR_INVALID_CRC for malformed blobs
+ */
+esp_err_t command_registry_store(const uint8_t *blob, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
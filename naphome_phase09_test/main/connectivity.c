@@ -0,0 +1,212 @@
+/**
+ * @file connectivity.c
+ * @brief Network readiness bits from Wi-Fi/IP events plus a reachability probe
+ */
+
+#include "connectivity.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+
+static const char *TAG = "connectivity";
+
+#define CONN_ALL        (CONN_LINK | CONN_IP | CONN_DNS | CONN_INTERNET)
+#define PROBE_BIT       (1 << 8)    // Ask the probe task to check reachability
+
+static EventGroupHandle_t conn_events = NULL;
+static atomic_uint link_generation = 0;    // Bumped whenever the address is lost
+
+const char *connectivity_state_name(uint32_t state)
+{
+    if (state & CONN_INTERNET) {
+        return "internet";
+    }
+    if (state & CONN_DNS) {
+        return "dns";
+    }
+    if (state & CONN_IP) {
+        return "ip";
+    }
+    if (state & CONN_LINK) {
+        return "link";
+    }
+    return "offline";
+}
+
+static void set_state(uint32_t set, uint32_t clear)
+{
+    uint32_t before = xEventGroupGetBits(conn_events) & CONN_ALL;
+    if (clear) {
+        xEventGroupClearBits(conn_events, clear);
+    }
+    if (set) {
+        xEventGroupSetBits(conn_events, set);
+    }
+    uint32_t after = xEventGroupGetBits(conn_events) & CONN_ALL;
+    if (after != before) {
+        ESP_LOGI(TAG, "%s -> %s", connectivity_state_name(before), connectivity_state_name(after));
+    }
+}
+
+static void connectivity_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (event_base == WIFI_EVENT) {
+        if (event_id == WIFI_EVENT_STA_CONNECTED) {
+            set_state(CONN_LINK, 0);
+        } else if (event_id == WIFI_EVENT_STA_DISCONNECTED) {
+            atomic_fetch_add(&link_generation, 1);
+            set_state(0, CONN_ALL);
+        }
+    } else if (event_base == IP_EVENT) {
+        if (event_id == IP_EVENT_STA_GOT_IP) {
+            set_state(CONN_IP, 0);
+            xEventGroupSetBits(conn_events, PROBE_BIT);
+        } else if (event_id == IP_EVENT_STA_LOST_IP) {
+            atomic_fetch_add(&link_generation, 1);
+            set_state(0, CONN_IP | CONN_DNS | CONN_INTERNET);
+        }
+    }
+}
+
+// Resolve the probe host and open a TCP connection to it
+static uint32_t probe_reachability(void)
+{
+    struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_STREAM,
+    };
+    struct addrinfo *res = NULL;
+    char port[8];
+    snprintf(port, sizeof(port), "%d", CONNECTIVITY_PROBE_PORT);
+    if (getaddrinfo(CONNECTIVITY_PROBE_HOST, port, &hints, &res) != 0 || !res) {
+        return 0;
+    }
+
+    uint32_t reached = CONN_DNS;
+    int sock = socket(res->ai_family, res->ai_socktype, 0);
+    if (sock >= 0) {
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+        int ret = connect(sock, res->ai_addr, res->ai_addrlen);
+        if (ret == 0) {
+            reached |= CONN_INTERNET;
+        } else if (errno == EINPROGRESS) {
+            fd_set writable;
+            FD_ZERO(&writable);
+            FD_SET(sock, &writable);
+            struct timeval timeout = {
+                .tv_sec = CONNECTIVITY_PROBE_TIMEOUT_MS / 1000,
+                .tv_usec = (CONNECTIVITY_PROBE_TIMEOUT_MS % 1000) * 1000,
+            };
+            int error = 0;
+            socklen_t len = sizeof(error);
+            if (select(sock + 1, NULL, &writable, NULL, &timeout) == 1 &&
+                getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0) {
+                reached |= CONN_INTERNET;
+            }
+        }
+        close(sock);
+    }
+    freeaddrinfo(res);
+    return reached;
+}
+
+static void connectivity_task(void *arg)
+{
+    uint32_t retry_ms = 0;  // 0: only probe when asked
+    while (true) {
+        TickType_t wait = retry_ms ? pdMS_TO_TICKS(retry_ms) : portMAX_DELAY;
+        xEventGroupWaitBits(conn_events, PROBE_BIT, pdTRUE, pdFALSE, wait);
+        if (!(xEventGroupGetBits(conn_events) & CONN_IP)) {
+            retry_ms = 0;  // GOT_IP asks again
+            continue;
+        }
+
+        unsigned generation = atomic_load(&link_generation);
+        uint32_t reached = probe_reachability();
+        if (generation != atomic_load(&link_generation)) {
+            continue;  // The address went away mid-probe; the result is stale
+        }
+        set_state(reached, (CONN_DNS | CONN_INTERNET) & ~reached);
+
+        if (reached & CONN_INTERNET) {
+            retry_ms = 0;
+        } else {
+            retry_ms = retry_ms ? retry_ms * 2 : CONNECTIVITY_RETRY_MIN_MS;
+            if (retry_ms > CONNECTIVITY_RETRY_MAX_MS) {
+                retry_ms = CONNECTIVITY_RETRY_MAX_MS;
+            }
+            ESP_LOGW(TAG, "%s unreachable, probing again in %lu ms", CONNECTIVITY_PROBE_HOST,
+                     (unsigned long)retry_ms);
+        }
+    }
+}
+
+esp_err_t connectivity_init(void)
+{
+    if (conn_events) {
+        return ESP_OK;
+    }
+    conn_events = xEventGroupCreate();
+    if (!conn_events) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, connectivity_event_handler, NULL);
+    if (ret == ESP_OK) {
+        ret = esp_event_handler_register(IP_EVENT, ESP_EVENT_ANY_ID, connectivity_event_handler, NULL);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register event handlers: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    if (xTaskCreatePinnedToCore(connectivity_task, "connectivity", CONNECTIVITY_TASK_STACK, NULL,
+                                CONNECTIVITY_TASK_PRIORITY, NULL, 0) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+uint32_t connectivity_state(void)
+{
+    return conn_events ? xEventGroupGetBits(conn_events) & CONN_ALL : 0;
+}
+
+bool connectivity_has(uint32_t state)
+{
+    return (connectivity_state() & state) == state;
+}
+
+bool connectivity_wait(uint32_t state, uint32_t timeout_ms)
+{
+    if (!conn_events) {
+        return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(conn_events, state & CONN_ALL, pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(timeout_ms));
+    return (bits & state) == state;
+}
+
+void connectivity_report(bool reachable)
+{
+    if (!conn_events) {
+        return;
+    }
+    if (reachable) {
+        if (xEventGroupGetBits(conn_events) & CONN_IP) {
+            set_state(CONN_DNS | CONN_INTERNET, 0);
+        }
+    } else if (xEventGroupGetBits(conn_events) & CONN_INTERNET) {
+        set_state(0, CONN_INTERNET);
+        xEventGroupSetBits(conn_events, PROBE_BIT);
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * @file connectivity.h
+ * @brief Event-driven network readiness: link, IP, DNS and internet reachability
+ *
+ * The state is kept in an event group from Wi-Fi and IP events, so asking
+ * "can I make a cloud call?" is one bit test instead of a round of netif
+ * and driver queries, and code that needs the network blocks on
+ * connectivity_wait() and wakes on the event instead of polling.
+ *
+ * Link and IP follow the driver. DNS and internet are set by a probe that
+ * resolves CONNECTIVITY_PROBE_HOST and opens a TCP connection to it after
+ * every new address, and are kept current by cloud calls reporting their
+ * outcome with connectivity_report(): a failed call clears internet and
+ * re-runs the probe with backoff.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONNECTIVITY_PROBE_HOST         "texttospeech.googleapis.com"
+#define CONNECTIVITY_PROBE_PORT         443
+#define CONNECTIVITY_PROBE_TIMEOUT_MS   3000
+#define CONNECTIVITY_RETRY_MIN_MS       1000    // Probe retry after a failure, doubling
+#define CONNECTIVITY_RETRY_MAX_MS       60000
+#define CONNECTIVITY_TASK_STACK         4096
+#define CONNECTIVITY_TASK_PRIORITY      3
+
+typedef enum {
+    CONN_LINK       = 1 << 0,   // Associated with an AP
+    CONN_IP         = 1 << 1,   // Station has an IPv4 address
+    CONN_DNS        = 1 << 2,   // Names resolve
+    CONN_INTERNET   = 1 << 3,   // The probe host or a cloud call answered
+} conn_state_t;
+
+/**
+ * @brief Register for Wi-Fi and IP events and start the probe task
+ *
+ * The default event loop must exist; call before Wi-Fi is started so the
+ * first events aren't missed.
+ */
+esp_err_t connectivity_init(void);
+
+/**
+ * @brief Current conn_state_t bits (cached, never blocks)
+ */
+uint32_t connectivity_state(void);
+
+/**
+ * @brief Whether all of the given conn_state_t bits are set
+ */
+bool connectivity_has(uint32_t state);
+
+/**
+ * @brief Block until all of the given conn_state_t bits are set
+ * @return false on timeout or before connectivity_init
+ */
+bool connectivity_wait(uint32_t state, uint32_t timeout_ms);
+
+/**
+ * @brief Outcome of a cloud request: true once a response arrived, false if
+ *        the connection could not be made
+ */
+void connectivity_report(bool reachable);
+
+const char *connectivity_state_name(uint32_t state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,134 @@
+/**
+ * @file detect_fsm.c
+ * @brief Wake word / command state machine
+ */
+
+#include "detect_fsm.h"
+#include "audio_capture.h"
+#include "esp_log.h"
+
+static const char *TAG = "detect";
+
+void detect_fsm_init(detect_fsm_t *fsm, const detect_ops_t *ops)
+{
+    *fsm = (detect_fsm_t){ .ops = ops, .state = DETECT_IDLE };
+    endpoint_init(&fsm->endpointer);
+}
+
+uint32_t detect_fsm_ms_since_wake(const detect_fsm_t *fsm)
+{
+    return (uint32_t)((audio_capture_position() - fsm->wake_position) * 1000 / CAPTURE_SAMPLE_RATE);
+}
+
+static void transition(detect_fsm_t *fsm, detect_event_t event, detect_state_t state)
+{
+    fsm->state = state;
+    if (fsm->ops->transition) {
+        fsm->ops->transition(fsm->ops->ctx, event, state);
+    }
+}
+
+// Hand the utterance to STT, trimmed to the speech the endpointer saw
+static void start_fallback(detect_fsm_t *fsm)
+{
+    uint64_t start = fsm->utterance_start;
+    uint64_t end = audio_capture_position();
+    uint64_t speech_start, speech_end;
+    if (endpoint_window(&fsm->endpointer, &speech_start, &speech_end)) {
+        start = speech_start > start ? speech_start : start;
+        end = speech_end < end ? speech_end : end;
+    }
+    fsm->ops->fallback(fsm->ops->ctx, start, end);
+}
+
+static void on_wake(detect_fsm_t *fsm, afe_fetch_result_t *res)
+{
+    uint64_t preroll = CAPTURE_MS_TO_SAMPLES(CAPTURE_PREROLL_MS);
+    fsm->wake_position = audio_capture_position();
+    fsm->utterance_start = fsm->wake_position > preroll ? fsm->wake_position - preroll : 0;
+    fsm->detecting_frames = 0;
+    fsm->commands = 0;
+    endpoint_arm(&fsm->endpointer, fsm->wake_position, fsm->utterance_start);
+    fsm->ops->clean(fsm->ops->ctx);
+
+    // A multi-channel AFE has to verify the channel before commands are matched
+    detect_state_t state = res->raw_data_channels == 1 ? DETECT_LISTENING : fsm->state;
+    transition(fsm, DETECT_EVENT_WAKE, state);
+}
+
+static void on_command(detect_fsm_t *fsm)
+{
+    esp_mn_results_t *results = fsm->ops->get_results(fsm->ops->ctx);
+    if (!fsm->ops->run_command(fsm->ops->ctx, results)) {
+        ESP_LOGI(TAG, "Command not handled locally, using STT/LLM/TTS fallback");
+        start_fallback(fsm);
+    }
+
+    // MultiNet keeps listening; audio for a later timeout starts after this command
+    fsm->utterance_start = audio_capture_position();
+    fsm->detecting_frames = 0;
+    fsm->commands++;
+    endpoint_arm(&fsm->endpointer, fsm->utterance_start, fsm->utterance_start);
+    transition(fsm, DETECT_EVENT_COMMAND, DETECT_LISTENING);
+}
+
+static void on_give_up(detect_fsm_t *fsm, detect_event_t event)
+{
+    if (event == DETECT_EVENT_END_OF_SPEECH) {
+        ESP_LOGI(TAG, "=== End of speech after %u ms, no local match ===",
+                 (unsigned)detect_fsm_ms_since_wake(fsm));
+        fsm->ops->clean(fsm->ops->ctx);
+    } else {
+        esp_mn_results_t *results = fsm->ops->get_results(fsm->ops->ctx);
+        ESP_LOGW(TAG, "=== Command Detection Timeout ===");
+        ESP_LOGW(TAG, "Timeout string: '%s'", results->string);
+        for (int i = 0; i < results->num; i++) {
+            ESP_LOGW(TAG, "  Result %d: command_id=%d, phrase_id=%d, prob=%.3f",
+                     i + 1, results->command_id[i], results->phrase_id[i], results->prob[i]);
+        }
+    }
+
+    // Try the STT/LLM fallback when MultiNet gives up; this handles phrases
+    // like "demo" that aren't recognized locally. After a command, only if
+    // the user said something more: otherwise it would upload silence.
+    uint64_t speech_start, speech_end;
+    if (fsm->commands == 0 || endpoint_window(&fsm->endpointer, &speech_start, &speech_end)) {
+        start_fallback(fsm);
+    } else {
+        ESP_LOGI(TAG, "No speech after the last command, skipping STT fallback");
+    }
+    endpoint_disarm(&fsm->endpointer);
+    fsm->ops->enable_wakenet(fsm->ops->ctx);
+    transition(fsm, event, DETECT_IDLE);
+}
+
+void detect_fsm_step(detect_fsm_t *fsm, afe_fetch_result_t *res, int chunksize)
+{
+    uint64_t frame_position = audio_capture_position();
+    audio_capture_write(res->data, chunksize);
+    endpoint_event_t endpoint_event = endpoint_feed(&fsm->endpointer, frame_position, res->data, chunksize,
+                                                    res->vad_state == AFE_VAD_SPEECH);
+
+    if (res->wakeup_state == WAKENET_DETECTED) {
+        on_wake(fsm, res);
+    } else if (res->wakeup_state == WAKENET_CHANNEL_VERIFIED && res->raw_data_channels > 1) {
+        ESP_LOGI(TAG, "AFE channel verified, index: %d", res->trigger_channel_id);
+        fsm->state = DETECT_LISTENING;
+    }
+
+    if (fsm->state != DETECT_LISTENING) {
+        return;
+    }
+
+    esp_mn_state_t mn_state = fsm->ops->detect(fsm->ops->ctx, res->data);
+    if (mn_state == ESP_MN_STATE_DETECTED) {
+        on_command(fsm);
+    } else if (mn_state == ESP_MN_STATE_TIMEOUT) {
+        on_give_up(fsm, DETECT_EVENT_TIMEOUT);
+    } else if (endpoint_event == ENDPOINT_END) {
+        // The user stopped talking and MultiNet has no match: don't wait out its timeout
+        on_give_up(fsm, DETECT_EVENT_END_OF_SPEECH);
+    } else if (++fsm->detecting_frames % 20 == 1) {  // Log every 20 frames to avoid spam
+        ESP_LOGI(TAG, "Still detecting... (frame %u)", (unsigned)fsm->detecting_frames);
+    }
+}
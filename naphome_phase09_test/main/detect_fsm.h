@@ -0,0 +1,80 @@
+/**
+ * @file detect_fsm.h
+ * @brief Wake word / command state machine behind detect_Task
+ *
+ * detect_Task fetches AFE frames and hands each one to detect_fsm_step().
+ * The state machine owns the capture ring writes, the endpointer and the
+ * idle/listening state; everything with a side effect outside it (MultiNet,
+ * re-enabling WakeNet, running a command, starting the STT fallback, LEDs
+ * and background audio) goes through detect_ops_t.
+ *
+ * Nothing here touches FreeRTOS or the clock: time is the capture ring
+ * sample position. The same code therefore runs off-target with scripted
+ * ops and AFE results read from WAV files, faster than real time.
+ */
+
+#pragma once
+
+#include "esp_afe_sr_iface.h"
+#include "esp_mn_iface.h"
+#include "endpoint.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    DETECT_IDLE,                // Waiting for the wake word
+    DETECT_LISTENING,           // MultiNet is matching a command
+} detect_state_t;
+
+typedef enum {
+    DETECT_EVENT_WAKE,          // Wake word detected
+    DETECT_EVENT_COMMAND,       // MultiNet matched a command, still listening
+    DETECT_EVENT_END_OF_SPEECH, // Trailing silence without a match, back to idle
+    DETECT_EVENT_TIMEOUT,       // MultiNet timed out, back to idle
+} detect_event_t;
+
+typedef struct {
+    void *ctx;
+    // MultiNet
+    esp_mn_state_t (*detect)(void *ctx, int16_t *samples);
+    esp_mn_results_t *(*get_results)(void *ctx);
+    void (*clean)(void *ctx);
+    // AFE
+    void (*enable_wakenet)(void *ctx);
+    // Run a MultiNet result; false to send the utterance to the STT fallback
+    bool (*run_command)(void *ctx, esp_mn_results_t *results);
+    // Send capture ring samples [start, end) to STT/LLM/TTS
+    void (*fallback)(void *ctx, uint64_t start, uint64_t end);
+    // Called after every event with the new state (LEDs, audio, status, metrics)
+    void (*transition)(void *ctx, detect_event_t event, detect_state_t state);
+} detect_ops_t;
+
+typedef struct {
+    const detect_ops_t *ops;
+    detect_state_t state;
+    uint64_t wake_position;     // Capture position at the wake word
+    uint64_t utterance_start;   // Start of the utterance, including pre-roll
+    uint32_t detecting_frames;  // Frames MultiNet has been matching
+    uint32_t commands;          // Commands matched since the wake word
+    endpoint_t endpointer;
+} detect_fsm_t;
+
+void detect_fsm_init(detect_fsm_t *fsm, const detect_ops_t *ops);
+
+/**
+ * @brief Process one AFE fetch result of chunksize samples
+ */
+void detect_fsm_step(detect_fsm_t *fsm, afe_fetch_result_t *res, int chunksize);
+
+/**
+ * @brief Milliseconds of audio since the last wake word
+ */
+uint32_t detect_fsm_ms_since_wake(const detect_fsm_t *fsm);
+
+#ifdef __cplusplus
+}
+#endif
@@ -11,6 +11,8 @@
 #include <string.h>
 #include <math.h>
 #include "driver/i2c.h"
+#include "esp_timer.h"
+#include "metrics.h"
 
 static const char *TAG = "bh1750_driver";
 
@@ -95,7 +97,7 @@ void bh1750_deinit(bh1750_handle_t *handle)
     }
 }
 
-bool bh1750_read(bh1750_handle_t *handle, bh1750_data_t *data)
+static bool bh1750_read_sample(bh1750_handle_t *handle, bh1750_data_t *data)
 {
     if (handle == NULL || data == NULL || !handle->initialized) {
         ESP_LOGE(TAG, "Invalid parameters or not initialized");
@@ -156,6 +158,31 @@ bool bh1750_read(bh1750_handle_t *handle, bh1750_data_t *data)
     return true;
 }
 
+// Bus time (including conversion delay) and failures are exported as metrics;
+// synthetic readings are not timed
+bool bh1750_read(bh1750_handle_t *handle, bh1750_data_t *data)
+{
+    static metrics_metric_t *read_time = NULL;
+    static metrics_metric_t *read_errors = NULL;
+    if (!read_time) {
+        read_time = metrics_histogram("naphome_i2c_read_seconds", "sensor=\"bh1750\"",
+                                      "Sensor read time over I2C");
+        read_errors = metrics_counter("naphome_i2c_errors_total", "sensor=\"bh1750\"",
+                                      "Sensor reads that fell back to synthetic data");
+    }
+
+    bool on_bus = handle && handle->hardware_present;
+    int64_t start = esp_timer_get_time();
+    bool ok = bh1750_read_sample(handle, data);
+    if (on_bus) {
+        metrics_observe_since(read_time, start);
+        if (!handle->hardware_present) {
+            metrics_inc(read_errors);
+        }
+    }
+    return ok;
+}
+
 bool bh1750_is_hardware_present(bh1750_handle_t *handle)
 {
     return handle != NULL && handle->hardware_present;
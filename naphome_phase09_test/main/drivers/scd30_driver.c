@@ -11,6 +11,8 @@
 #include <string.h>
 #include <math.h>
 #include "driver/i2c.h"
+#include "esp_timer.h"
+#include "metrics.h"
 
 static const char *TAG = "scd30_driver";
 
@@ -129,7 +131,7 @@ void scd30_deinit(scd30_handle_t *handle)
     }
 }
 
-bool scd30_read(scd30_handle_t *handle, scd30_data_t *data)
+static bool scd30_read_sample(scd30_handle_t *handle, scd30_data_t *data)
 {
     if (handle == NULL || data == NULL || !handle->initialized) {
         ESP_LOGE(TAG, "Invalid parameters or not initialized");
@@ -249,6 +251,31 @@ bool scd30_read(scd30_handle_t *handle, scd30_data_t *data)
     return true;
 }
 
+// Bus time (including conversion delay) and failures are exported as metrics;
+// synthetic readings are not timed
+bool scd30_read(scd30_handle_t *handle, scd30_data_t *data)
+{
+    static metrics_metric_t *read_time = NULL;
+    static metrics_metric_t *read_errors = NULL;
+    if (!read_time) {
+        read_time = metrics_histogram("naphome_i2c_read_seconds", "sensor=\"scd30\"",
+                                      "Sensor read time over I2C");
+        read_errors = metrics_counter("naphome_i2c_errors_total", "sensor=\"scd30\"",
+                                      "Sensor reads that fell back to synthetic data");
+    }
+
+    bool on_bus = handle && handle->hardware_present;
+    int64_t start = esp_timer_get_time();
+    bool ok = scd30_read_sample(handle, data);
+    if (on_bus) {
+        metrics_observe_since(read_time, start);
+        if (!handle->hardware_present) {
+            metrics_inc(read_errors);
+        }
+    }
+    return ok;
+}
+
 bool scd30_is_hardware_present(scd30_handle_t *handle)
 {
     return handle != NULL && handle->hardware_present;
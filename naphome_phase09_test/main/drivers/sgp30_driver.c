@@ -11,6 +11,8 @@
 #include <string.h>
 #include <math.h>
 #include "driver/i2c.h"
+#include "esp_timer.h"
+#include "metrics.h"
 
 static const char *TAG = "sgp30_driver";
 
@@ -104,7 +106,7 @@ void sgp30_deinit(sgp30_handle_t *handle)
     }
 }
 
-bool sgp30_read(sgp30_handle_t *handle, sgp30_data_t *data)
+static bool sgp30_read_sample(sgp30_handle_t *handle, sgp30_data_t *data)
 {
     if (handle == NULL || data == NULL || !handle->initialized) {
         ESP_LOGE(TAG, "Invalid parameters or not initialized");
@@ -175,6 +177,31 @@ bool sgp30_read(sgp30_handle_t *handle, sgp30_data_t *data)
     return true;
 }
 
+// Bus time (including conversion delay) and failures are exported as metrics;
+// synthetic readings are not timed
+bool sgp30_read(sgp30_handle_t *handle, sgp30_data_t *data)
+{
+    static metrics_metric_t *read_time = NULL;
+    static metrics_metric_t *read_errors = NULL;
+    if (!read_time) {
+        read_time = metrics_histogram("naphome_i2c_read_seconds", "sensor=\"sgp30\"",
+                                      "Sensor read time over I2C");
+        read_errors = metrics_counter("naphome_i2c_errors_total", "sensor=\"sgp30\"",
+                                      "Sensor reads that fell back to synthetic data");
+    }
+
+    bool on_bus = handle && handle->hardware_present;
+    int64_t start = esp_timer_get_time();
+    bool ok = sgp30_read_sample(handle, data);
+    if (on_bus) {
+        metrics_observe_since(read_time, start);
+        if (!handle->hardware_present) {
+            metrics_inc(read_errors);
+        }
+    }
+    return ok;
+}
+
 bool sgp30_is_hardware_present(sgp30_handle_t *handle)
 {
     return handle != NULL && handle->hardware_present;
@@ -11,6 +11,8 @@
 #include <string.h>
 #include <math.h>
 #include "driver/i2c.h"
+#include "esp_timer.h"
+#include "metrics.h"
 
 static const char *TAG = "sht30_driver";
 
@@ -78,7 +80,7 @@ void sht30_deinit(sht30_handle_t *handle)
     }
 }
 
-bool sht30_read(sht30_handle_t *handle, sht30_data_t *data)
+static bool sht30_read_sample(sht30_handle_t *handle, sht30_data_t *data)
 {
     if (handle == NULL || data == NULL || !handle->initialized) {
         ESP_LOGE(TAG, "Invalid parameters or not initialized");
@@ -157,6 +159,31 @@ bool sht30_read(sht30_handle_t *handle, sht30_data_t *data)
     return true;
 }
 
+// Bus time (including conversion delay) and failures are exported as metrics;
+// synthetic readings are not timed
+bool sht30_read(sht30_handle_t *handle, sht30_data_t *data)
+{
+    static metrics_metric_t *read_time = NULL;
+    static metrics_metric_t *read_errors = NULL;
+    if (!read_time) {
+        read_time = metrics_histogram("naphome_i2c_read_seconds", "sensor=\"sht30\"",
+                                      "Sensor read time over I2C");
+        read_errors = metrics_counter("naphome_i2c_errors_total", "sensor=\"sht30\"",
+                                      "Sensor reads that fell back to synthetic data");
+    }
+
+    bool on_bus = handle && handle->hardware_present;
+    int64_t start = esp_timer_get_time();
+    bool ok = sht30_read_sample(handle, data);
+    if (on_bus) {
+        metrics_observe_since(read_time, start);
+        if (!handle->hardware_present) {
+            metrics_inc(read_errors);
+        }
+    }
+    return ok;
+}
+
 bool sht30_is_hardware_present(sht30_handle_t *handle)
 {
     return handle != NULL && handle->hardware_present;
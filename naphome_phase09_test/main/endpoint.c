@@ -0,0 +1,123 @@
+/**
+ * @file endpoint.c
+ * @brief Energy / zero-crossing endpointer with hangover
+ */
+
+#include "endpoint.h"
+#include <math.h>
+
+#define MS_TO_SAMPLES(ms)       ((uint32_t)(ms) * (ENDPOINT_SAMPLE_RATE / 1000))
+#define NO_SPEECH               UINT64_MAX
+
+#define NOISE_INITIAL_DB        40.0f   // ~100 LSB RMS until the floor settles
+#define NOISE_MIN_DB            20.0f   // Floor never tracks below digital silence
+#define NOISE_FALL              0.3f    // Per-frame smoothing towards quieter frames
+#define NOISE_RISE              0.02f   // ... towards louder non-speech frames
+#define NOISE_RISE_SPEECH       0.002f  // ... during speech, to escape a step in noise
+#define UNVOICED_ZCR_MIN        0.25f   // Fricatives: weak but with many zero crossings
+#define UNVOICED_ZCR_MAX        0.70f   // Above this it is hiss
+
+void endpoint_init(endpoint_t *ep)
+{
+    *ep = (endpoint_t){
+        .noise_db = NOISE_INITIAL_DB,
+        .speech_start = NO_SPEECH,
+    };
+}
+
+void endpoint_arm(endpoint_t *ep, uint64_t position, uint64_t preroll_start)
+{
+    ep->armed = true;
+    ep->armed_speech = 0;
+    ep->window_floor = preroll_start;
+    // A command spoken straight after the wake word is already in progress
+    ep->speech_start = ep->in_speech ? ep->segment_start : NO_SPEECH;
+    ep->speech_end = position;
+}
+
+void endpoint_disarm(endpoint_t *ep)
+{
+    ep->armed = false;
+}
+
+static bool frame_is_speech(endpoint_t *ep, const int16_t *samples, size_t count, bool vad_speech)
+{
+    float energy = 0.0f;
+    uint32_t crossings = 0;
+    for (size_t i = 0; i < count; i++) {
+        energy += (float)samples[i] * (float)samples[i];
+        if (i > 0 && (samples[i] < 0) != (samples[i - 1] < 0)) {
+            crossings++;
+        }
+    }
+    float db = 10.0f * log10f(energy / (float)count + 1.0f);
+    float zcr = (float)crossings / (float)count;
+
+    bool voiced = db > ep->noise_db + ENDPOINT_SNR_DB;
+    // Unvoiced consonants only extend a segment, they do not start one
+    bool unvoiced = ep->in_speech && db > ep->noise_db + ENDPOINT_SNR_DB / 2 &&
+                    zcr > UNVOICED_ZCR_MIN && zcr < UNVOICED_ZCR_MAX;
+    bool speech = voiced || unvoiced || vad_speech;
+
+    float rate = speech ? NOISE_RISE_SPEECH : (db < ep->noise_db ? NOISE_FALL : NOISE_RISE);
+    ep->noise_db += (db - ep->noise_db) * rate;
+    if (ep->noise_db < NOISE_MIN_DB) {
+        ep->noise_db = NOISE_MIN_DB;
+    }
+    return speech;
+}
+
+endpoint_event_t endpoint_feed(endpoint_t *ep, uint64_t position, const int16_t *samples,
+                               size_t count, bool vad_speech)
+{
+    if (!samples || count == 0) {
+        return ENDPOINT_NONE;
+    }
+
+    if (frame_is_speech(ep, samples, count, vad_speech)) {
+        ep->speech_run += count;
+        ep->silence_run = 0;
+        if (!ep->in_speech && ep->speech_run >= MS_TO_SAMPLES(ENDPOINT_ONSET_MS)) {
+            ep->in_speech = true;
+            ep->segment_start = position + count - ep->speech_run;
+            if (ep->armed && ep->speech_start == NO_SPEECH) {
+                ep->speech_start = ep->segment_start;
+            }
+        }
+        if (ep->in_speech && ep->armed) {
+            ep->armed_speech += count;
+            ep->speech_end = position + count;
+        }
+        return ENDPOINT_NONE;
+    }
+
+    ep->silence_run += count;
+    ep->speech_run = 0;
+    if (!ep->in_speech || ep->silence_run < MS_TO_SAMPLES(ENDPOINT_HANGOVER_MS)) {
+        return ENDPOINT_NONE;
+    }
+    ep->in_speech = false;
+    if (!ep->armed) {
+        return ENDPOINT_NONE;
+    }
+    if (ep->armed_speech >= MS_TO_SAMPLES(ENDPOINT_MIN_SPEECH_MS)) {
+        ep->armed = false;
+        return ENDPOINT_END;
+    }
+    // Only the tail of the wake word: wait for the command itself
+    ep->speech_start = NO_SPEECH;
+    ep->armed_speech = 0;
+    return ENDPOINT_NONE;
+}
+
+bool endpoint_window(const endpoint_t *ep, uint64_t *start, uint64_t *end)
+{
+    if (ep->speech_start == NO_SPEECH) {
+        return false;
+    }
+    uint64_t lead = MS_TO_SAMPLES(ENDPOINT_LEAD_PAD_MS);
+    uint64_t from = ep->speech_start > lead ? ep->speech_start - lead : 0;
+    *start = from > ep->window_floor ? from : ep->window_floor;
+    *end = ep->speech_end + MS_TO_SAMPLES(ENDPOINT_TRAIL_PAD_MS);
+    return true;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file endpoint.h
+ * @brief End-of-utterance detection for the STT fallback
+ *
+ * Without endpointing the fallback waits for MultiNet's 6 s timeout even when
+ * the user stopped talking long before. The endpointer classifies each AFE
+ * frame as speech or silence from its energy against a tracked noise floor
+ * (plus zero-crossing rate for unvoiced sounds, and the AFE VAD when it is
+ * enabled) and reports the end of the utterance after ENDPOINT_HANGOVER_MS
+ * of trailing silence.
+ *
+ * It is fed every frame so the noise floor is settled when the wake word
+ * fires. endpoint_arm() starts an utterance; speech that was already in
+ * progress (a command spoken straight after the wake word) counts from the
+ * pre-roll. A silence gap right after the wake word does not end the
+ * utterance: ENDPOINT_MIN_SPEECH_MS of speech must follow the arm first.
+ *
+ * endpoint_window() gives the detected speech with short pads, used to trim
+ * leading and trailing silence from the upload.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ENDPOINT_SAMPLE_RATE    16000
+#define ENDPOINT_HANGOVER_MS    700     // Trailing silence that ends an utterance
+#define ENDPOINT_MIN_SPEECH_MS  300     // Speech needed after the wake word before an end counts
+#define ENDPOINT_ONSET_MS       60      // Speech needed to start a segment
+#define ENDPOINT_LEAD_PAD_MS    200     // Kept before the detected speech
+#define ENDPOINT_TRAIL_PAD_MS   300     // Kept after the detected speech
+#define ENDPOINT_SNR_DB         9.0f    // Frame energy above the noise floor that counts as voiced
+
+typedef enum {
+    ENDPOINT_NONE,
+    ENDPOINT_END,               // Armed utterance ended with trailing silence
+} endpoint_event_t;
+
+typedef struct {
+    float noise_db;             // Tracked noise floor
+    bool in_speech;             // Inside a speech segment (hangover included)
+    bool armed;
+    uint32_t speech_run;        // Consecutive speech samples
+    uint32_t silence_run;       // Consecutive silence samples
+    uint32_t armed_speech;      // Speech samples since endpoint_arm()
+    uint64_t segment_start;     // Onset of the current segment
+    uint64_t window_floor;      // Earliest sample the window may include
+    uint64_t speech_start;      // UINT64_MAX until speech is seen while armed
+    uint64_t speech_end;        // One past the last speech sample
+} endpoint_t;
+
+void endpoint_init(endpoint_t *ep);
+
+/**
+ * @brief Start tracking an utterance
+ * @param position Sample position of the next frame
+ * @param preroll_start Earliest sample the speech window may reach back to
+ */
+void endpoint_arm(endpoint_t *ep, uint64_t position, uint64_t preroll_start);
+
+void endpoint_disarm(endpoint_t *ep);
+
+/**
+ * @brief Classify one frame
+ * @param position Sample position of samples[0]
+ * @param vad_speech AFE VAD verdict for the frame (false if VAD is off)
+ * @return ENDPOINT_END once per armed utterance
+ */
+endpoint_event_t endpoint_feed(endpoint_t *ep, uint64_t position, const int16_t *samples,
+                               size_t count, bool vad_speech);
+
+/**
+ * @brief Speech seen while armed, padded, as [*start, *end)
+ * @return false if no speech was detected
+ */
+bool endpoint_window(const endpoint_t *ep, uint64_t *start, uint64_t *end);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,73 @@
+/**
+ * @file event_bus.c
+ * @brief Minimal in-process publish/subscribe bus implementation
+ */
+
+#include "event_bus.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    uint32_t topic_mask;        // 0 marks a free slot
+    event_bus_handler_t handler;
+    void *ctx;
+} subscriber_t;
+
+static subscriber_t subscribers[EVENT_BUS_MAX_SUBSCRIBERS];
+static portMUX_TYPE bus_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t event_bus_subscribe(uint32_t topic_mask, event_bus_handler_t handler, void *ctx)
+{
+    if (!handler || topic_mask == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&bus_lock);
+    for (int i = 0; i < EVENT_BUS_MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].topic_mask == 0) {
+            subscribers[i].handler = handler;
+            subscribers[i].ctx = ctx;
+            subscribers[i].topic_mask = topic_mask;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&bus_lock);
+    return ret;
+}
+
+esp_err_t event_bus_unsubscribe(event_bus_handler_t handler, void *ctx)
+{
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&bus_lock);
+    for (int i = 0; i < EVENT_BUS_MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].topic_mask && subscribers[i].handler == handler && subscribers[i].ctx == ctx) {
+            subscribers[i].topic_mask = 0;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&bus_lock);
+    return ret;
+}
+
+void event_bus_publish(event_bus_topic_t topic, const void *data, size_t len)
+{
+    if (topic >= EVENT_BUS_TOPIC_COUNT) {
+        return;
+    }
+
+    // Snapshot the matching subscribers so handlers run outside the lock
+    subscriber_t targets[EVENT_BUS_MAX_SUBSCRIBERS];
+    int count = 0;
+    portENTER_CRITICAL(&bus_lock);
+    for (int i = 0; i < EVENT_BUS_MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].topic_mask & EVENT_BUS_TOPIC_BIT(topic)) {
+            targets[count++] = subscribers[i];
+        }
+    }
+    portEXIT_CRITICAL(&bus_lock);
+
+    for (int i = 0; i < count; i++) {
+        targets[i].handler(topic, data, len, targets[i].ctx);
+    }
+}
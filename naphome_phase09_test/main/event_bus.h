@@ -0,0 +1,74 @@
+/**
+ * @file event_bus.h
+ * @brief Minimal in-process publish/subscribe bus
+ *
+ * Producers (test runner, telemetry sampler, task_stats) publish typed events
+ * without knowing who consumes them; consumers such as the web dashboard's
+ * push channel subscribe to the topics they care about. Delivery is
+ * synchronous in the publisher's task, so handlers must be short and must
+ * not block: copy what is needed or set a flag and defer the real work.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EVENT_BUS_MAX_SUBSCRIBERS 8
+
+typedef enum {
+    EVENT_BUS_TOPIC_TEST_STATUS = 0,    // event_bus_test_status_t
+    EVENT_BUS_TOPIC_SENSORS,            // telemetry_sample_t
+    EVENT_BUS_TOPIC_METRICS,            // task_stats_snapshot_t
+    EVENT_BUS_TOPIC_COUNT
+} event_bus_topic_t;
+
+#define EVENT_BUS_TOPIC_BIT(topic) (1u << (topic))
+
+typedef struct {
+    int test_num;               // 1-based
+    int status;                 // 0=PASS, 1=WARNING, 2=FAIL, 3=NOT_IMPLEMENTED
+    const char *name;           // Only valid during delivery
+} event_bus_test_status_t;
+
+/**
+ * @brief Receives an event
+ * @param topic Topic the event was published on
+ * @param data Topic-specific payload, only valid during the call
+ * @param len Payload size in bytes
+ * @param ctx Context given to event_bus_subscribe
+ */
+typedef void (*event_bus_handler_t)(event_bus_topic_t topic, const void *data, size_t len, void *ctx);
+
+/**
+ * @brief Register a handler for one or more topics
+ * @param topic_mask EVENT_BUS_TOPIC_BIT() values OR'ed together
+ * @param handler Handler called in the publisher's task
+ * @param ctx Passed to handler
+ * @return ESP_OK, or ESP_ERR_NO_MEM if all subscriber slots are used
+ */
+esp_err_t event_bus_subscribe(uint32_t topic_mask, event_bus_handler_t handler, void *ctx);
+
+/**
+ * @brief Remove a handler registered with the same handler and ctx
+ * @return ESP_OK, or ESP_ERR_NOT_FOUND
+ */
+esp_err_t event_bus_unsubscribe(event_bus_handler_t handler, void *ctx);
+
+/**
+ * @brief Deliver an event to every subscriber of the topic
+ * @param topic Topic
+ * @param data Payload (see event_bus_topic_t for the type)
+ * @param len Payload size in bytes
+ */
+void event_bus_publish(event_bus_topic_t topic, const void *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,418 @@
+/**
+ * @file flac_encoder.c
+ * @brief Fixed-predictor, Rice-coded FLAC frames for mono 16-bit PCM
+ */
+
+#include "flac_encoder.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define MAX_RICE_PARAM      14      // 15 is the escape code, never used
+#define RESIDUAL_CHUNK      64      // Residuals computed per pass over the block
+#define FRAME_OVERHEAD      17      // Header (up to 13), subframe header, padding, CRC-16
+#define STREAM_HEADER       42      // "fLaC", metadata block header, STREAMINFO
+
+static uint8_t crc8_table[256];
+static uint16_t crc16_table[256];
+static bool crc_tables_ready = false;
+
+static void crc_tables_init(void)
+{
+    for (int i = 0; i < 256; i++) {
+        uint8_t c8 = (uint8_t)i;
+        uint16_t c16 = (uint16_t)(i << 8);
+        for (int b = 0; b < 8; b++) {
+            c8 = (c8 & 0x80) ? (uint8_t)((c8 << 1) ^ 0x07) : (uint8_t)(c8 << 1);
+            c16 = (c16 & 0x8000) ? (uint16_t)((c16 << 1) ^ 0x8005) : (uint16_t)(c16 << 1);
+        }
+        crc8_table[i] = c8;
+        crc16_table[i] = c16;
+    }
+    crc_tables_ready = true;
+}
+
+static void flush_out(flac_encoder_t *e)
+{
+    if (e->out_len && e->err == ESP_OK) {
+        e->err = e->write(e->out, e->out_len, e->write_ctx);
+    }
+    e->total += e->out_len;
+    e->out_len = 0;
+}
+
+static void put_byte(flac_encoder_t *e, uint8_t b)
+{
+    e->crc8 = crc8_table[e->crc8 ^ b];
+    e->crc16 = (uint16_t)((e->crc16 << 8) ^ crc16_table[(e->crc16 >> 8) ^ b]);
+    e->out[e->out_len++] = b;
+    if (e->out_len == FLAC_OUT_BUF) {
+        flush_out(e);
+    }
+}
+
+// Append the low n bits of value (n <= 32), most significant first
+static void put_bits(flac_encoder_t *e, uint32_t value, int n)
+{
+    uint32_t mask = n < 32 ? ((1u << n) - 1) : 0xFFFFFFFFu;
+    e->bits = (e->bits << n) | (value & mask);
+    e->bit_count += n;
+    while (e->bit_count >= 8) {
+        e->bit_count -= 8;
+        put_byte(e, (uint8_t)(e->bits >> e->bit_count));
+    }
+}
+
+// Frame numbers use the UTF-8 style variable-length code
+static void put_utf8(flac_encoder_t *e, uint32_t v)
+{
+    if (v < 0x80) {
+        put_bits(e, v, 8);
+        return;
+    }
+    int bytes = v < 0x800 ? 2 : v < 0x10000 ? 3 : v < 0x200000 ? 4 : v < 0x4000000 ? 5 : 6;
+    int shift = 6 * (bytes - 1);
+    put_bits(e, ((0xFF00u >> bytes) & 0xFF) | (v >> shift), 8);
+    while (shift > 0) {
+        shift -= 6;
+        put_bits(e, 0x80 | ((v >> shift) & 0x3F), 8);
+    }
+}
+
+static void put_rice(flac_encoder_t *e, uint32_t u, int k)
+{
+    uint32_t q = u >> k;
+    if (q + 1 + k <= 32) {
+        // q zeros, a one, then the k low bits, in one go
+        put_bits(e, (1u << k) | (u & ((1u << k) - 1)), (int)(q + 1 + k));
+        return;
+    }
+    for (; q >= 32; q -= 32) {
+        put_bits(e, 0, 32);
+    }
+    put_bits(e, 1, (int)q + 1);
+    if (k) {
+        put_bits(e, u, k);
+    }
+}
+
+static inline uint32_t fold(int32_t r)
+{
+    return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+}
+
+// Residual of the fixed predictor of this order for x[from..to); from >= order
+static void fixed_residual(const int16_t *x, size_t from, size_t to, int order, int32_t *out)
+{
+    const int16_t *s = x + from;
+    size_t n = to - from;
+    switch (order) {
+    case 0:
+        for (size_t i = 0; i < n; i++) {
+            out[i] = s[i];
+        }
+        break;
+    case 1:
+        for (size_t i = 0; i < n; i++) {
+            out[i] = s[i] - s[(ptrdiff_t)i - 1];
+        }
+        break;
+    case 2:
+        for (size_t i = 0; i < n; i++) {
+            out[i] = s[i] - 2 * s[(ptrdiff_t)i - 1] + s[(ptrdiff_t)i - 2];
+        }
+        break;
+    case 3:
+        for (size_t i = 0; i < n; i++) {
+            out[i] = s[i] - 3 * s[(ptrdiff_t)i - 1] + 3 * s[(ptrdiff_t)i - 2] - s[(ptrdiff_t)i - 3];
+        }
+        break;
+    default:
+        for (size_t i = 0; i < n; i++) {
+            out[i] = s[i] - 4 * s[(ptrdiff_t)i - 1] + 6 * s[(ptrdiff_t)i - 2] - 4 * s[(ptrdiff_t)i - 3]
+                     + s[(ptrdiff_t)i - 4];
+        }
+        break;
+    }
+}
+
+static uint64_t residual_sum(const int16_t *x, size_t from, size_t to, int order)
+{
+    int32_t r[RESIDUAL_CHUNK];
+    uint64_t sum = 0;
+    for (size_t i = from; i < to; i += RESIDUAL_CHUNK) {
+        size_t m = to - i < RESIDUAL_CHUNK ? to - i : RESIDUAL_CHUNK;
+        fixed_residual(x, i, i + m, order, r);
+        for (size_t j = 0; j < m; j++) {
+            sum += fold(r[j]);
+        }
+    }
+    return sum;
+}
+
+// Predictor order with the smallest absolute residual, all orders compared
+// over the same samples (n > FLAC_MAX_FIXED_ORDER)
+static int choose_order(const int16_t *x, size_t n)
+{
+    uint64_t total[FLAC_MAX_FIXED_ORDER + 1] = { 0 };
+    int32_t p0 = x[3];
+    int32_t p1 = x[3] - x[2];
+    int32_t p2 = x[3] - 2 * x[2] + x[1];
+    int32_t p3 = x[3] - 3 * x[2] + 3 * x[1] - x[0];
+    for (size_t i = 4; i < n; i++) {
+        int32_t e0 = x[i];
+        int32_t e1 = e0 - p0;
+        int32_t e2 = e1 - p1;
+        int32_t e3 = e2 - p2;
+        int32_t e4 = e3 - p3;
+        total[0] += (uint32_t)(e0 < 0 ? -e0 : e0);
+        total[1] += (uint32_t)(e1 < 0 ? -e1 : e1);
+        total[2] += (uint32_t)(e2 < 0 ? -e2 : e2);
+        total[3] += (uint32_t)(e3 < 0 ? -e3 : e3);
+        total[4] += (uint32_t)(e4 < 0 ? -e4 : e4);
+        p0 = e0;
+        p1 = e1;
+        p2 = e2;
+        p3 = e3;
+    }
+    int best = 0;
+    for (int order = 1; order <= FLAC_MAX_FIXED_ORDER; order++) {
+        if (total[order] < total[best]) {
+            best = order;
+        }
+    }
+    return best;
+}
+
+// Rice parameter for m residuals summing to sum (folded). The bit count
+// m * (k + 1) + (sum >> k) is an upper bound on the exact size, so a
+// subframe chosen on it is never larger than estimated.
+static int rice_param(uint32_t m, uint64_t sum, uint64_t *bits)
+{
+    int best = 0;
+    uint64_t best_bits = UINT64_MAX;
+    for (int k = 0; k <= MAX_RICE_PARAM; k++) {
+        uint64_t b = (uint64_t)m * (uint64_t)(k + 1) + (sum >> k);
+        if (b < best_bits) {
+            best_bits = b;
+            best = k;
+        }
+    }
+    *bits = best_bits;
+    return best;
+}
+
+// Partition sums for every order from p_max down to 0, as a binary tree:
+// level p starts at sums[(1 << p) - 1]
+static uint64_t *level(flac_encoder_t *e, int p)
+{
+    return &e->sums[(1 << p) - 1];
+}
+
+static void write_subframe(flac_encoder_t *e, const int16_t *x, size_t n)
+{
+    bool constant = true;
+    for (size_t i = 1; i < n && constant; i++) {
+        constant = (x[i] == x[0]);
+    }
+    if (constant) {
+        put_bits(e, 0x00, 8);   // CONSTANT
+        put_bits(e, (uint16_t)x[0], 16);
+        return;
+    }
+
+    int order = -1;
+    int best_p = 0;
+    uint64_t best_bits = UINT64_MAX;
+    if (n > FLAC_MAX_FIXED_ORDER) {
+        order = choose_order(x, n);
+        int p_max = 0;
+        while (p_max < FLAC_MAX_PARTITION_ORDER && n % (2u << p_max) == 0 && (n >> (p_max + 1)) > (size_t)order) {
+            p_max++;
+        }
+        uint64_t *sums = level(e, p_max);
+        size_t part = n >> p_max;
+        for (size_t j = 0; j < (1u << p_max); j++) {
+            sums[j] = residual_sum(x, j ? j * part : (size_t)order, (j + 1) * part, order);
+        }
+        for (int p = p_max; p >= 0; p--) {
+            uint64_t *s = level(e, p);
+            size_t parts = 1u << p;
+            uint64_t bits = 0;
+            for (size_t j = 0; j < parts; j++) {
+                uint64_t b;
+                rice_param((uint32_t)((n >> p) - (j ? 0 : order)), s[j], &b);
+                bits += 4 + b;
+            }
+            if (bits < best_bits) {
+                best_bits = bits;
+                best_p = p;
+            }
+            if (p > 0) {
+                uint64_t *up = level(e, p - 1);
+                for (size_t j = 0; j < parts / 2; j++) {
+                    up[j] = s[2 * j] + s[2 * j + 1];
+                }
+            }
+        }
+        best_bits += 16 * (uint64_t)order + 2 + 4;
+    }
+
+    if (order < 0 || best_bits >= 16 * (uint64_t)n) {
+        put_bits(e, 0x01 << 1, 8);  // VERBATIM
+        for (size_t i = 0; i < n; i++) {
+            put_bits(e, (uint16_t)x[i], 16);
+        }
+        return;
+    }
+
+    put_bits(e, (0x08 | order) << 1, 8);    // FIXED, this order
+    for (int i = 0; i < order; i++) {
+        put_bits(e, (uint16_t)x[i], 16);    // Warm-up samples
+    }
+    put_bits(e, 0, 2);                      // Rice coding, 4-bit parameters
+    put_bits(e, (uint32_t)best_p, 4);
+    uint64_t *sums = level(e, best_p);
+    size_t part = n >> best_p;
+    int32_t r[RESIDUAL_CHUNK];
+    for (size_t j = 0; j < (1u << best_p); j++) {
+        size_t from = j ? j * part : (size_t)order;
+        size_t to = (j + 1) * part;
+        uint64_t unused;
+        int k = rice_param((uint32_t)(to - from), sums[j], &unused);
+        put_bits(e, (uint32_t)k, 4);
+        for (size_t i = from; i < to; i += RESIDUAL_CHUNK) {
+            size_t m = to - i < RESIDUAL_CHUNK ? to - i : RESIDUAL_CHUNK;
+            fixed_residual(x, i, i + m, order, r);
+            for (size_t t = 0; t < m; t++) {
+                put_rice(e, fold(r[t]), k);
+            }
+        }
+    }
+}
+
+static uint32_t block_size_code(size_t n)
+{
+    for (uint32_t code = 8; code <= 15; code++) {
+        if (n == (256u << (code - 8))) {
+            return code;
+        }
+    }
+    return n <= 256 ? 6 : 7;    // Size follows the header: 8 or 16 bits of n - 1
+}
+
+static uint32_t sample_rate_code(uint32_t rate)
+{
+    switch (rate) {
+    case 8000:  return 4;
+    case 16000: return 5;
+    case 22050: return 6;
+    case 24000: return 7;
+    case 32000: return 8;
+    case 44100: return 9;
+    case 48000: return 10;
+    default:    return 0;   // From STREAMINFO
+    }
+}
+
+static void write_frame(flac_encoder_t *e)
+{
+    const int16_t *x = e->block;
+    size_t n = e->block_len;
+    uint32_t bs_code = block_size_code(n);
+
+    e->crc8 = 0;
+    e->crc16 = 0;
+    put_bits(e, 0xFFF8, 16);    // Sync code, fixed block size stream
+    put_bits(e, bs_code, 4);
+    put_bits(e, sample_rate_code(e->sample_rate), 4);
+    put_bits(e, 0, 4);          // One channel
+    put_bits(e, 4, 3);          // 16 bits per sample
+    put_bits(e, 0, 1);
+    put_utf8(e, e->frame_number);
+    if (bs_code == 6) {
+        put_bits(e, (uint32_t)(n - 1), 8);
+    } else if (bs_code == 7) {
+        put_bits(e, (uint32_t)(n - 1), 16);
+    }
+    put_bits(e, e->crc8, 8);
+
+    write_subframe(e, x, n);
+    if (e->bit_count) {
+        put_bits(e, 0, 8 - e->bit_count);
+    }
+    put_bits(e, e->crc16, 16);
+    e->frame_number++;
+}
+
+esp_err_t flac_encoder_init(flac_encoder_t *enc, uint32_t sample_rate, flac_write_t write, void *ctx)
+{
+    if (!enc || !write || sample_rate == 0 || sample_rate > 655350) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!crc_tables_ready) {
+        crc_tables_init();
+    }
+    enc->block_len = 0;
+    enc->sample_rate = sample_rate;
+    enc->frame_number = 0;
+    enc->bits = 0;
+    enc->bit_count = 0;
+    enc->out_len = 0;
+    enc->total = 0;
+    enc->write = write;
+    enc->write_ctx = ctx;
+    enc->err = ESP_OK;
+
+    static const uint8_t marker[] = { 'f', 'L', 'a', 'C' };
+    for (size_t i = 0; i < sizeof(marker); i++) {
+        put_bits(enc, marker[i], 8);
+    }
+    put_bits(enc, 0x80, 8);     // Last metadata block, STREAMINFO
+    put_bits(enc, 34, 24);
+    put_bits(enc, FLAC_BLOCK_SIZE, 16);     // Minimum block size
+    put_bits(enc, FLAC_BLOCK_SIZE, 16);     // Maximum block size
+    put_bits(enc, 0, 24);                   // Frame sizes: unknown
+    put_bits(enc, 0, 24);
+    put_bits(enc, sample_rate, 20);
+    put_bits(enc, 0, 3);                    // Channels - 1
+    put_bits(enc, 15, 5);                   // Bits per sample - 1
+    put_bits(enc, 0, 4);                    // Total samples: unknown (36 bits)
+    put_bits(enc, 0, 32);
+    for (int i = 0; i < 4; i++) {
+        put_bits(enc, 0, 32);               // MD5: not computed
+    }
+    return enc->err;
+}
+
+esp_err_t flac_encoder_feed(flac_encoder_t *enc, const int16_t *samples, size_t count)
+{
+    while (count > 0 && enc->err == ESP_OK) {
+        size_t room = FLAC_BLOCK_SIZE - enc->block_len;
+        size_t m = count < room ? count : room;
+        memcpy(enc->block + enc->block_len, samples, m * sizeof(int16_t));
+        enc->block_len += m;
+        samples += m;
+        count -= m;
+        if (enc->block_len == FLAC_BLOCK_SIZE) {
+            write_frame(enc);
+            enc->block_len = 0;
+        }
+    }
+    return enc->err;
+}
+
+esp_err_t flac_encoder_finish(flac_encoder_t *enc)
+{
+    if (enc->block_len > 0 && enc->err == ESP_OK) {
+        write_frame(enc);
+        enc->block_len = 0;
+    }
+    flush_out(enc);
+    return enc->err;
+}
+
+size_t flac_max_encoded_size(size_t samples)
+{
+    size_t frames = (samples + FLAC_BLOCK_SIZE - 1) / FLAC_BLOCK_SIZE;
+    return STREAM_HEADER + frames * FRAME_OVERHEAD + samples * sizeof(int16_t);
+}
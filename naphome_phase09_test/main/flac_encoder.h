@@ -0,0 +1,83 @@
+/**
+ * @file flac_encoder.h
+ * @brief Streaming FLAC encoder for mono 16-bit PCM
+ *
+ * Integer-only and constant-memory: samples are gathered into one block of
+ * FLAC_BLOCK_SIZE, and each full block is written as a FLAC frame through a
+ * small output buffer handed to a write callback. Every block is coded
+ * with the best of FLAC's fixed polynomial predictors (orders 0-4) and a
+ * partitioned Rice residual, or as a constant or verbatim subframe when
+ * that is smaller, so the output never exceeds flac_max_encoded_size().
+ *
+ * The stream opens with a STREAMINFO block whose frame sizes, sample count
+ * and MD5 are left "unknown" (zero), as a streaming encoder cannot go back
+ * and fill them in. Errors are sticky: after the first failure every call
+ * returns it.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLAC_BLOCK_SIZE             4096    // Samples per frame (256 ms at 16 kHz)
+#define FLAC_MAX_FIXED_ORDER        4       // Highest fixed predictor tried
+#define FLAC_MAX_PARTITION_ORDER    8       // Up to 256 Rice partitions per block
+#define FLAC_OUT_BUF                256     // Bytes gathered before each write callback
+
+/**
+ * @brief Receives encoded bytes
+ * @return ESP_OK to continue
+ */
+typedef esp_err_t (*flac_write_t)(const uint8_t *data, size_t len, void *ctx);
+
+typedef struct {
+    int16_t block[FLAC_BLOCK_SIZE];
+    size_t block_len;
+    uint32_t sample_rate;
+    uint32_t frame_number;
+    uint64_t sums[(2 << FLAC_MAX_PARTITION_ORDER) - 1];  // Scratch: residual sums per partition, every order
+    uint64_t bits;              // Pending output bits, MSB first
+    int bit_count;
+    uint8_t out[FLAC_OUT_BUF];
+    size_t out_len;
+    size_t total;               // Bytes emitted, including those already written
+    uint8_t crc8;               // Frame header CRC, running
+    uint16_t crc16;             // Frame CRC, running
+    flac_write_t write;
+    void *write_ctx;
+    esp_err_t err;
+} flac_encoder_t;
+
+/**
+ * @brief Start a stream: writes the "fLaC" marker and STREAMINFO
+ * @param enc Encoder (about 13 KB: allocate it, don't put it on a task stack)
+ * @param sample_rate Hz
+ * @param write Called whenever FLAC_OUT_BUF bytes are ready, and on finish
+ * @param ctx Passed to write
+ */
+esp_err_t flac_encoder_init(flac_encoder_t *enc, uint32_t sample_rate, flac_write_t write, void *ctx);
+
+/**
+ * @brief Add samples; each full block is encoded and written
+ */
+esp_err_t flac_encoder_feed(flac_encoder_t *enc, const int16_t *samples, size_t count);
+
+/**
+ * @brief Encode the last partial block and flush
+ */
+esp_err_t flac_encoder_finish(flac_encoder_t *enc);
+
+/**
+ * @brief Most bytes a stream of this many samples can take
+ */
+size_t flac_max_encoded_size(size_t samples);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""
+Compile commands.yaml into the binary speech command registry.
+
+The registry is what command_registry.c loads at boot: the build embeds it
+as the default (--out-c), and the same blob (--out-bin) can be POSTed to
+/api/commands to replace the commands on a running device built with
+CONFIG_NAPHOME_COMMANDS_UPLOAD:
+
+    curl -H "Authorization: Bearer $TOKEN" --data-binary @commands.bin \
+         http://nap.local/api/commands
+
+Layout, little-endian:
+    header   magic "NCMD", u8 version, u8 count, u16 string pool size,
+             u32 CRC-32 of everything after the header
+    entries  count x { u8 id, u8 reserved, u16 phonemes, u16 phrase, u16 intent }
+             string offsets into the pool, 0xFFFF for none
+    pool     NUL-terminated strings
+
+Usage: gen_command_registry.py commands.yaml [--out-bin FILE] [--out-c FILE]
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+try:
+    import yaml
+except ImportError:
+    sys.exit('gen_command_registry.py needs PyYAML (pip install pyyaml)')
+
+MAGIC = b'NCMD'
+VERSION = 1
+MAX_ID = 200            # COMMAND_REGISTRY_MAX_ID
+NO_STRING = 0xFFFF
+
+
+def load_commands(path):
+    with open(path, encoding='utf-8') as f:
+        doc = yaml.safe_load(f)
+    commands = doc.get('commands') if isinstance(doc, dict) else None
+    if not commands:
+        sys.exit('%s: no "commands" list' % path)
+
+    seen = set()
+    for i, cmd in enumerate(commands):
+        where = '%s: command %d' % (path, i)
+        cmd_id = cmd.get('id')
+        if not isinstance(cmd_id, int) or not 0 <= cmd_id < MAX_ID:
+            sys.exit('%s: id must be an integer 0-%d' % (where, MAX_ID - 1))
+        if cmd_id in seen:
+            sys.exit('%s: duplicate id %d' % (where, cmd_id))
+        seen.add(cmd_id)
+        if not cmd.get('phonemes'):
+            sys.exit('%s: missing phonemes' % where)
+    return sorted(commands, key=lambda c: c['id'])
+
+
+def build_blob(commands):
+    pool = bytearray()
+    offsets = {}
+
+    def intern(text):
+        if not text:
+            return NO_STRING
+        text = str(text)
+        if text not in offsets:
+            offsets[text] = len(pool)
+            pool.extend(text.encode('utf-8') + b'\0')
+        if offsets[text] >= NO_STRING:
+            sys.exit('string pool larger than 64 KB')
+        return offsets[text]
+
+    entries = bytearray()
+    for cmd in commands:
+        entries += struct.pack('<BBHHH', cmd['id'], 0, intern(cmd['phonemes']),
+                               intern(cmd.get('phrase')), intern(cmd.get('intent')))
+    if len(commands) > 255:
+        sys.exit('too many commands (max 255)')
+
+    body = bytes(entries + pool)
+    header = MAGIC + struct.pack('<BBHI', VERSION, len(commands), len(pool), zlib.crc32(body))
+    return header + body
+
+
+def write_c(path, blob, source):
+    lines = []
+    for i in range(0, len(blob), 16):
+        lines.append('    ' + ', '.join('0x%02x' % b for b in blob[i:i + 16]) + ',')
+    with open(path, 'w') as f:
+        f.write('// Generated by gen_command_registry.py from %s - do not edit\n\n' % source)
+        f.write('#include <stddef.h>\n#include <stdint.h>\n\n')
+        f.write('const uint8_t command_registry_default[] = {\n%s\n};\n\n' % '\n'.join(lines))
+        f.write('const size_t command_registry_default_len = sizeof(command_registry_default);\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('yaml', help='Command list')
+    parser.add_argument('--out-bin', help='Registry blob for /api/commands')
+    parser.add_argument('--out-c', help='C source embedding the blob as the default registry')
+    args = parser.parse_args()
+    if not args.out_bin and not args.out_c:
+        parser.error('nothing to do: give --out-bin and/or --out-c')
+
+    commands = load_commands(args.yaml)
+    blob = build_blob(commands)
+    if args.out_bin:
+        with open(args.out_bin, 'wb') as f:
+            f.write(blob)
+    if args.out_c:
+        write_c(args.out_c, blob, args.yaml.replace('\\', '/').split('/')[-1])
+    print('command registry: %d commands, %d bytes' % (len(commands), len(blob)))
+
+
+if __name__ == '__main__':
+    main()
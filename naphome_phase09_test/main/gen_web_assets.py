@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""
+Minify and gzip the dashboard files in www/ into a C asset table.
+
+Each asset is stored pre-compressed together with a strong ETag, so the web
+server can answer with Content-Encoding: gzip or 304 Not Modified without
+any work at request time. The minified text is embedded as well, with its
+own ETag, for clients that do not accept gzip. index.html may reference other assets as
+"{{etag:name}}", which is replaced by that asset's version so their URLs
+change whenever their content does and they can be cached indefinitely.
+
+Usage: gen_web_assets.py --out web_assets.c www/index.html www/style.css ...
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+CONTENT_TYPES = {
+    '.html': 'text/html; charset=utf-8',
+    '.css': 'text/css',
+    '.js': 'application/javascript',
+}
+
+CACHE_REVALIDATE = 'no-cache'                            # Entry page: always check the ETag
+CACHE_IMMUTABLE = 'public, max-age=31536000, immutable'  # Versioned by ?v=<etag>
+
+
+def minify_css(text):
+    text = re.sub(r'/\*.*?\*/', '', text, flags=re.S)
+    text = re.sub(r'\s+', ' ', text)
+    text = re.sub(r'\s*([{};,>])\s*', r'\1', text)
+    text = re.sub(r'([{;])\s*([\w-]+)\s*:\s*', r'\1\2:', text)
+    return text.replace(';}', '}').strip()
+
+
+def minify_js(text):
+    # Conservative: newlines are kept so automatic semicolon insertion is unaffected
+    lines = []
+    for line in text.splitlines():
+        line = line.strip()
+        if not line or line.startswith('//'):
+            continue
+        lines.append(line)
+    return '\n'.join(lines)
+
+
+def minify_html(text):
+    text = re.sub(r'<!--.*?-->', '', text, flags=re.S)
+    text = '\n'.join(line.strip() for line in text.splitlines())
+    text = re.sub(r'>\n+<', '><', text)
+    return text.strip()
+
+
+MINIFIERS = {
+    '.html': minify_html,
+    '.css': minify_css,
+    '.js': minify_js,
+}
+
+
+def c_bytes(data):
+    out = []
+    for i in range(0, len(data), 16):
+        out.append('    ' + ', '.join('0x%02x' % b for b in data[i:i + 16]) + ',')
+    return '\n'.join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('--out', required=True, help='Generated C file')
+    parser.add_argument('files', nargs='+', help='Assets; index.html is served at /')
+    args = parser.parse_args()
+
+    # Leaf assets first so the page can embed their versions
+    files = sorted(args.files, key=lambda f: f.endswith('.html'))
+    versions = {}
+    assets = []
+    for path in files:
+        name = os.path.basename(path)
+        ext = os.path.splitext(name)[1]
+        if ext not in CONTENT_TYPES:
+            sys.exit('%s: unsupported asset type %s' % (path, ext))
+        with open(path, encoding='utf-8') as f:
+            raw = f.read()
+        text = MINIFIERS[ext](raw)
+        text = re.sub(r'\{\{etag:([\w.-]+)\}\}', lambda m: versions[m.group(1)], text)
+
+        minified = text.encode('utf-8')
+        version = hashlib.sha1(minified).hexdigest()[:16]
+        versions[name] = version
+        compressed = gzip.compress(minified, compresslevel=9, mtime=0)  # mtime=0: reproducible
+        is_page = ext == '.html'
+        assets.append({
+            'uri': '/' if name == 'index.html' else '/' + name,
+            'type': CONTENT_TYPES[ext],
+            'cache': CACHE_REVALIDATE if is_page else CACHE_IMMUTABLE,
+            'etag': '"%s"' % version,
+            'identity_etag': '"%s-identity"' % version,
+            'data': compressed,
+            'identity': minified,
+            'raw_len': len(raw.encode('utf-8')),
+        })
+        print('web asset %-12s %6d -> %6d minified -> %6d gzip bytes' %
+              (name, len(raw.encode('utf-8')), len(minified), len(compressed)))
+
+    with open(args.out, 'w') as f:
+        f.write('// Generated by gen_web_assets.py from main/www - do not edit\n\n')
+        f.write('#include "web_assets.h"\n\n')
+        for i, a in enumerate(assets):
+            f.write('static const uint8_t asset_%d[] = {\n%s\n};\n\n' % (i, c_bytes(a['data'])))
+            f.write('static const uint8_t asset_%d_identity[] = {\n%s\n};\n\n' % (i, c_bytes(a['identity'])))
+        f.write('const web_asset_t web_assets[] = {\n')
+        for i, a in enumerate(assets):
+            f.write('    { "%s", "%s", "%s", "%s", "%s", asset_%d, sizeof(asset_%d),\n'
+                    '      asset_%d_identity, sizeof(asset_%d_identity), %d },\n' %
+                    (a['uri'], a['type'], a['cache'], a['etag'].replace('"', '\\"'),
+                     a['identity_etag'].replace('"', '\\"'), i, i, i, i, a['raw_len']))
+        f.write('};\n\n')
+        f.write('const size_t web_assets_count = %d;\n' % len(assets))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,251 @@
+/**
+ * @file http_json.c
+ * @brief JSON POSTs to the cloud APIs: send, retry, hedge, stream the response
+ */
+
+#include "http_json.h"
+#include "connectivity.h"
+#include "metrics.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "http_json";
+
+esp_err_t http_send_json(esp_http_client_handle_t client, const char *body, size_t body_len)
+{
+    esp_err_t err = esp_http_client_open(client, body_len);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    
+    int written = esp_http_client_write(client, body, body_len);
+    if (written < 0 || (size_t)written != body_len) {
+        ESP_LOGE(TAG, "HTTP request body write failed (%d of %zu bytes)", written, body_len);
+        esp_http_client_close(client);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    
+    if (esp_http_client_fetch_headers(client) < 0) {
+        ESP_LOGE(TAG, "HTTP response headers not received");
+        esp_http_client_close(client);
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    return ESP_OK;
+}
+
+// A request sent on up to two clients at once; the first to get response
+// headers wins. Each attempt runs in its own task, and an attempt that loses
+// (or fails) cleans up its own client whenever it finishes, possibly after
+// the caller has moved on - hence the reference count and the body copy.
+typedef struct http_hedge http_hedge_t;
+
+typedef struct {
+    http_hedge_t *hedge;
+    int index;
+} hedge_attempt_t;
+
+struct http_hedge {
+    portMUX_TYPE lock;
+    EventGroupHandle_t events;          // Bit i: attempt i finished
+    hedge_attempt_t attempts[2];
+    esp_http_client_handle_t clients[2];
+    esp_err_t results[2];
+    uint32_t started;                   // Bit i: attempt i running or finished
+    uint32_t done;                      // Bit i: attempt i finished
+    int winner;                         // Attempt whose response is used (-1: none yet)
+    int refs;                           // Caller plus running attempts; the last one frees
+    latency_tracker_t *latency;
+    size_t body_len;
+    char body[];
+};
+
+static void hedge_release(http_hedge_t *hedge)
+{
+    portENTER_CRITICAL(&hedge->lock);
+    bool last = (--hedge->refs == 0);
+    portEXIT_CRITICAL(&hedge->lock);
+    if (last) {
+        vEventGroupDelete(hedge->events);
+        free(hedge);
+    }
+}
+
+static void hedge_attempt_task(void *arg)
+{
+    hedge_attempt_t *attempt = (hedge_attempt_t *)arg;
+    http_hedge_t *hedge = attempt->hedge;
+    int i = attempt->index;
+
+    int64_t sent_us = esp_timer_get_time();
+    esp_err_t err = http_send_json(hedge->clients[i], hedge->body, hedge->body_len);
+    uint32_t latency_ms = (uint32_t)((esp_timer_get_time() - sent_us) / 1000);
+
+    portENTER_CRITICAL(&hedge->lock);
+    hedge->results[i] = err;
+    hedge->done |= 1 << i;
+    bool won = (err == ESP_OK && hedge->winner < 0);
+    if (won) {
+        hedge->winner = i;
+    }
+    portEXIT_CRITICAL(&hedge->lock);
+    xEventGroupSetBits(hedge->events, 1 << i);
+
+    // Only the response that is used says how long the API took: a loser
+    // that answers later would push the p95, and so the hedge delay, up
+    if (won) {
+        latency_record(hedge->latency, latency_ms);
+    } else {
+        esp_http_client_cleanup(hedge->clients[i]);
+    }
+    hedge_release(hedge);
+    vTaskDelete(NULL);
+}
+
+static bool hedge_start(http_hedge_t *hedge, int i, esp_http_client_handle_t client)
+{
+    hedge->clients[i] = client;
+    hedge->attempts[i] = (hedge_attempt_t){ .hedge = hedge, .index = i };
+    portENTER_CRITICAL(&hedge->lock);
+    hedge->refs++;
+    hedge->started |= 1 << i;
+    portEXIT_CRITICAL(&hedge->lock);
+    if (xTaskCreatePinnedToCore(hedge_attempt_task, i ? "http_hedge" : "http_send", HTTP_HEDGE_TASK_STACK,
+                                &hedge->attempts[i], 4, NULL, 0) == pdPASS) {
+        return true;
+    }
+    portENTER_CRITICAL(&hedge->lock);
+    hedge->refs--;
+    hedge->started &= ~(1 << i);
+    portEXIT_CRITICAL(&hedge->lock);
+    esp_http_client_cleanup(client);
+    return false;
+}
+
+// http_send_json for an idempotent request: if *client has no response
+// headers after hedge_ms, send the same request on a new client from
+// hedge_config and use whichever answers first. A warm client that fails is retried on a
+// new client the same way. On success *client is the client that answered;
+// on failure it is NULL (every client has been cleaned up).
+static esp_err_t http_send_json_hedged(esp_http_client_handle_t *client, const http_hedge_config_t *hedge_config,
+                                       const char *body, size_t body_len, bool warm, uint32_t hedge_ms,
+                                       latency_tracker_t *latency)
+{
+    http_hedge_t *hedge = calloc(1, sizeof(http_hedge_t) + body_len);
+    EventGroupHandle_t events = hedge ? xEventGroupCreate() : NULL;
+    if (!events) {
+        free(hedge);
+        return http_send_json(*client, body, body_len);
+    }
+    hedge->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    hedge->events = events;
+    hedge->winner = -1;
+    hedge->refs = 1;
+    hedge->latency = latency;
+    hedge->body_len = body_len;
+    memcpy(hedge->body, body, body_len);
+
+    esp_http_client_handle_t primary = *client;
+    *client = NULL;
+    if (!hedge_start(hedge, 0, primary)) {
+        hedge_release(hedge);
+        return ESP_ERR_NO_MEM;
+    }
+
+    EventBits_t bits = xEventGroupWaitBits(events, 1 << 0, pdFALSE, pdTRUE, pdMS_TO_TICKS(hedge_ms));
+    portENTER_CRITICAL(&hedge->lock);
+    bool primary_failed = (bits & (1 << 0)) && hedge->winner < 0;
+    portEXIT_CRITICAL(&hedge->lock);
+    bool hedged = !(bits & (1 << 0));
+    if (hedged || (primary_failed && warm)) {
+        if (hedged) {
+            ESP_LOGI(TAG, "No response after %lu ms (p95), sending again on a new connection", (unsigned long)hedge_ms);
+        } else {
+            ESP_LOGW(TAG, "Pre-warmed connection dropped, reconnecting");
+        }
+        esp_http_client_handle_t second = esp_http_client_init(hedge_config->client);
+        if (second) {
+            esp_http_client_set_header(second, "Content-Type", "application/json");
+            if (hedge_start(hedge, 1, second) && hedged) {
+                metrics_inc(hedge_config->sent);
+            }
+        }
+    }
+
+    // Until an attempt has won or every one started has failed
+    esp_err_t err = ESP_FAIL;
+    while (true) {
+        portENTER_CRITICAL(&hedge->lock);
+        int winner = hedge->winner;
+        bool all_done = (hedge->done == hedge->started);
+        if (winner >= 0) {
+            *client = hedge->clients[winner];
+            err = ESP_OK;
+        } else if (all_done) {
+            err = hedge->results[(hedge->started & (1 << 1)) ? 1 : 0];
+        }
+        portEXIT_CRITICAL(&hedge->lock);
+        if (winner >= 0 || all_done) {
+            if (winner == 1 && hedged) {
+                metrics_inc(hedge_config->won);
+            }
+            break;
+        }
+        xEventGroupWaitBits(events, (1 << 0) | (1 << 1), pdTRUE, pdFALSE, portMAX_DELAY);
+    }
+    hedge_release(hedge);
+    return err;
+}
+
+int http_post_json_streamed(esp_http_client_handle_t *client, const char *body, size_t body_len,
+                            json_reader_t *reader, bool warm, latency_tracker_t *latency,
+                            const http_hedge_config_t *hedge_config)
+{
+    esp_err_t err;
+    uint32_t hedge_ms = hedge_config ? latency_p95_ms(latency) : 0;
+    if (hedge_ms) {
+        err = http_send_json_hedged(client, hedge_config, body, body_len, warm, hedge_ms, latency);
+    } else {
+        int64_t sent_us = esp_timer_get_time();
+        err = http_send_json(*client, body, body_len);
+        if (err != ESP_OK && warm) {
+            ESP_LOGW(TAG, "Pre-warmed connection dropped, reconnecting");
+            esp_http_client_close(*client);
+            sent_us = esp_timer_get_time();
+            err = http_send_json(*client, body, body_len);
+        }
+        if (err == ESP_OK) {
+            latency_record(latency, (uint32_t)((esp_timer_get_time() - sent_us) / 1000));
+        }
+    }
+    if (err != ESP_OK) {
+        if (err == ESP_ERR_HTTP_FETCH_HEADER) {
+            latency_record_timeout(latency);  // Widen the next timeout
+        }
+        if (err != ESP_ERR_INVALID_SIZE) {
+            connectivity_report(false);
+        }
+        return -1;
+    }
+    connectivity_report(true);
+    
+    int status_code = esp_http_client_get_status_code(*client);
+    char chunk[512];
+    int n;
+    while ((n = esp_http_client_read(*client, chunk, sizeof(chunk))) > 0) {
+        if (status_code != 200) {
+            continue;  // Drain error bodies without parsing
+        }
+        if (json_reader_feed(reader, chunk, n) != ESP_OK) {
+            ESP_LOGW(TAG, "Malformed JSON response near byte %zu", reader->offset);
+            break;
+        }
+    }
+    esp_http_client_close(*client);
+    return status_code;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file http_json.h
+ * @brief JSON POSTs to the cloud APIs: send, retry, hedge, stream the response
+ *
+ * The request path shared by STT, LLM and TTS. A client that came from
+ * prewarm may have been dropped by the server while idle, so a failure on
+ * it is retried once on a new connection. Idempotent requests can be
+ * hedged: once the first attempt has waited longer than the API's p95 for
+ * response headers, the same request goes out on a second client and the
+ * first to answer is used. Each attempt runs in its own task; the loser
+ * cleans up its own client whenever it finishes.
+ *
+ * The time from sending to the response headers of the response that is
+ * used feeds the API's latency tracker; outcomes feed connectivity_report().
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "json_reader.h"
+#include "latency_tracker.h"
+#include "metrics.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTTP_HEDGE_TASK_STACK   6144    // One request's TLS handshake and send
+
+typedef struct {
+    const esp_http_client_config_t *client;     // Config for the second client
+    metrics_metric_t *sent;                     // Second requests sent after the p95 (may be NULL)
+    metrics_metric_t *won;                      // Second requests that answered first (may be NULL)
+} http_hedge_config_t;
+
+/**
+ * @brief Send the request line, headers and body, and wait for the response headers
+ *
+ * On failure the connection is closed, so the client can be reused.
+ */
+esp_err_t http_send_json(esp_http_client_handle_t client, const char *body, size_t body_len);
+
+/**
+ * @brief POST a JSON body and stream the response through a JSON reader
+ *        instead of buffering it
+ *
+ * Error bodies are drained without parsing.
+ *
+ * @param client In: the client to send on. Out: the client that answered,
+ *        which the caller cleans up (NULL if a hedged request failed)
+ * @param warm The client came from prewarm and the server may have dropped it
+ * @param latency The API's tracker (may be NULL)
+ * @param hedge_config For idempotent requests; NULL: never hedge
+ * @return HTTP status code, or -1 if the request failed
+ */
+int http_post_json_streamed(esp_http_client_handle_t *client, const char *body, size_t body_len,
+                            json_reader_t *reader, bool warm, latency_tracker_t *latency,
+                            const http_hedge_config_t *hedge_config);
+
+#ifdef __cplusplus
+}
+#endif
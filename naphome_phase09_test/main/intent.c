@@ -0,0 +1,589 @@
+/**
+ * @file intent.c
+ * @brief Intent table compiler: ID jump table plus Aho-Corasick keyword matcher
+ */
+
+#include "intent.h"
+#include "esp_log.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "intent";
+
+#define NO_INTENT   0xFF
+#define NO_NODE     0xFFFF
+
+// Classifier limits
+#define MAX_VOCAB           96      // Distinct words across all keywords
+#define MAX_TOKEN_LEN       16      // Longer words are truncated
+#define MAX_KEYWORD_TOKENS  3       // Words per keyword ("air conditioner" is 2)
+#define MAX_PHRASE_TOKENS   24      // Words considered per transcript
+#define NO_WORD             0xFF
+
+// Trie node; children are a sibling list, which keeps the automaton small
+typedef struct {
+    uint16_t first_child;
+    uint16_t next_sibling;
+    uint16_t fail;
+    char ch;
+    uint64_t output;            // Keywords ending here or at any fail ancestor
+} ac_node_t;
+
+struct intent_table {
+    const intent_def_t *defs;
+    size_t count;
+    uint8_t by_id[INTENT_MAX_COMMAND_ID];           // command_id -> first intent, NO_INTENT if none
+    uint64_t groups[INTENT_MAX_INTENTS][INTENT_MAX_GROUPS];
+    uint8_t num_groups[INTENT_MAX_INTENTS];
+    ac_node_t *nodes;
+    uint16_t num_nodes;
+    const char *keywords[INTENT_MAX_KEYWORDS];      // Lowercased copies, for dedup
+    size_t num_keywords;
+
+    // Word-level view of the keywords for intent_table_classify()
+    char vocab[MAX_VOCAB][MAX_TOKEN_LEN];
+    uint8_t num_vocab;
+    uint8_t keyword_words[INTENT_MAX_KEYWORDS][MAX_KEYWORD_TOKENS];
+    uint8_t keyword_num_words[INTENT_MAX_KEYWORDS];
+    float group_weight[INTENT_MAX_INTENTS][INTENT_MAX_GROUPS];
+    const intent_synonym_t *synonyms;
+    size_t num_synonyms;
+};
+
+static inline char ascii_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+}
+
+static uint16_t ac_child(const intent_table_t *t, uint16_t node, char c)
+{
+    for (uint16_t n = t->nodes[node].first_child; n != NO_NODE; n = t->nodes[n].next_sibling) {
+        if (t->nodes[n].ch == c) {
+            return n;
+        }
+    }
+    return NO_NODE;
+}
+
+// Insert a lowercased keyword, returning its bit index, or -1 when out of room
+static int ac_add_keyword(intent_table_t *t, const char *word, size_t len, size_t max_nodes)
+{
+    for (size_t k = 0; k < t->num_keywords; k++) {
+        if (strlen(t->keywords[k]) == len && memcmp(t->keywords[k], word, len) == 0) {
+            return (int)k;
+        }
+    }
+    if (t->num_keywords >= INTENT_MAX_KEYWORDS) {
+        return -1;
+    }
+    char *copy = strndup(word, len);
+    if (!copy) {
+        return -1;
+    }
+    int bit = (int)t->num_keywords;
+    t->keywords[t->num_keywords++] = copy;
+
+    uint16_t node = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint16_t next = ac_child(t, node, word[i]);
+        if (next == NO_NODE) {
+            if (t->num_nodes >= max_nodes) {
+                return -1;
+            }
+            next = t->num_nodes++;
+            t->nodes[next] = (ac_node_t){
+                .first_child = NO_NODE,
+                .next_sibling = t->nodes[node].first_child,
+                .ch = word[i],
+            };
+            t->nodes[node].first_child = next;
+        }
+        node = next;
+    }
+    t->nodes[node].output |= 1ULL << bit;
+    return bit;
+}
+
+// Breadth-first fail links; outputs are merged so matching never walks fail chains for output
+static esp_err_t ac_link(intent_table_t *t)
+{
+    uint16_t *queue = malloc(t->num_nodes * sizeof(uint16_t));
+    if (!queue) {
+        return ESP_ERR_NO_MEM;
+    }
+    size_t head = 0, tail = 0;
+    for (uint16_t c = t->nodes[0].first_child; c != NO_NODE; c = t->nodes[c].next_sibling) {
+        t->nodes[c].fail = 0;
+        queue[tail++] = c;
+    }
+    while (head < tail) {
+        uint16_t node = queue[head++];
+        for (uint16_t c = t->nodes[node].first_child; c != NO_NODE; c = t->nodes[c].next_sibling) {
+            uint16_t f = t->nodes[node].fail;
+            uint16_t target;
+            while ((target = ac_child(t, f, t->nodes[c].ch)) == NO_NODE && f != 0) {
+                f = t->nodes[f].fail;
+            }
+            t->nodes[c].fail = (target != NO_NODE && target != c) ? target : 0;
+            t->nodes[c].output |= t->nodes[t->nodes[c].fail].output;
+            queue[tail++] = c;
+        }
+    }
+    free(queue);
+    return ESP_OK;
+}
+
+static uint64_t ac_scan(const intent_table_t *t, const char *text)
+{
+    uint64_t found = 0;
+    uint16_t node = 0;
+    for (const char *p = text; *p; p++) {
+        char c = ascii_lower(*p);
+        uint16_t next;
+        while ((next = ac_child(t, node, c)) == NO_NODE && node != 0) {
+            node = t->nodes[node].fail;
+        }
+        node = (next == NO_NODE) ? 0 : next;
+        found |= t->nodes[node].output;
+    }
+    return found;
+}
+
+void intent_table_clear_ids(intent_table_t *table)
+{
+    if (table) {
+        memset(table->by_id, NO_INTENT, sizeof(table->by_id));
+    }
+}
+
+esp_err_t intent_table_set_id(intent_table_t *table, int command_id, const char *name)
+{
+    if (!table || !name || command_id < 0 || command_id >= INTENT_MAX_COMMAND_ID) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < table->count; i++) {
+        if (strcmp(table->defs[i].name, name) == 0) {
+            table->by_id[command_id] = (uint8_t)i;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// ------------------------------------------------------------------------- //
+// Word-level classifier
+// ------------------------------------------------------------------------- //
+
+// Words that carry no intent on their own
+static const char *const stopwords[] = {
+    "a", "an", "the", "is", "are", "was", "be", "it", "its", "s", "to", "of", "for", "in", "at",
+    "please", "can", "could", "would", "will", "you", "i", "my", "some", "this", "that", "here",
+    "now", "right", "currently", "current", "hey", "okay", "ok", "like", "much", "there",
+};
+
+static bool is_stopword(const char *word)
+{
+    for (size_t i = 0; i < sizeof(stopwords) / sizeof(stopwords[0]); i++) {
+        if (strcmp(stopwords[i], word) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Split into lowercase alphanumeric words; returns the number written
+static size_t tokenize(const char *text, char words[][MAX_TOKEN_LEN], size_t max_words)
+{
+    size_t count = 0;
+    const char *p = text;
+    while (*p && count < max_words) {
+        while (*p && !((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9'))) {
+            p++;
+        }
+        size_t len = 0;
+        while ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9')) {
+            if (len < MAX_TOKEN_LEN - 1) {
+                words[count][len++] = ascii_lower(*p);
+            }
+            p++;
+        }
+        if (len > 0) {
+            words[count++][len] = '\0';
+        }
+    }
+    return count;
+}
+
+static int vocab_find(const intent_table_t *t, const char *word)
+{
+    for (int v = 0; v < t->num_vocab; v++) {
+        if (strcmp(t->vocab[v], word) == 0) {
+            return v;
+        }
+    }
+    return -1;
+}
+
+static esp_err_t fuzzy_index(intent_table_t *t)
+{
+    for (size_t k = 0; k < t->num_keywords; k++) {
+        char words[MAX_KEYWORD_TOKENS + 1][MAX_TOKEN_LEN];
+        size_t n = tokenize(t->keywords[k], words, MAX_KEYWORD_TOKENS + 1);
+        if (n == 0 || n > MAX_KEYWORD_TOKENS) {
+            ESP_LOGE(TAG, "Keyword \"%s\" must have 1-%d words", t->keywords[k], MAX_KEYWORD_TOKENS);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        for (size_t w = 0; w < n; w++) {
+            int v = vocab_find(t, words[w]);
+            if (v < 0) {
+                if (t->num_vocab >= MAX_VOCAB) {
+                    ESP_LOGE(TAG, "Too many keyword words (max %d)", MAX_VOCAB);
+                    return ESP_ERR_INVALID_SIZE;
+                }
+                v = t->num_vocab++;
+                memcpy(t->vocab[v], words[w], MAX_TOKEN_LEN);
+            }
+            t->keyword_words[k][w] = (uint8_t)v;
+        }
+        t->keyword_num_words[k] = (uint8_t)n;
+    }
+
+    // Inverse document frequency: groups shared by many intents weigh less
+    for (size_t i = 0; i < t->count; i++) {
+        for (int g = 0; g < t->num_groups[i]; g++) {
+            int df = 0;
+            for (size_t j = 0; j < t->count; j++) {
+                for (int h = 0; h < t->num_groups[j]; h++) {
+                    if (t->groups[j][h] & t->groups[i][g]) {
+                        df++;
+                        break;
+                    }
+                }
+            }
+            t->group_weight[i][g] = logf(1.0f + (float)t->count / (float)df);
+        }
+    }
+    return ESP_OK;
+}
+
+// Levenshtein distance, giving up (returning limit + 1) once it exceeds limit
+static int edit_distance(const char *a, const char *b, int limit)
+{
+    int la = strlen(a), lb = strlen(b);
+    if (abs(la - lb) > limit) {
+        return limit + 1;
+    }
+    int prev[MAX_TOKEN_LEN], cur[MAX_TOKEN_LEN];
+    for (int j = 0; j <= lb; j++) {
+        prev[j] = j;
+    }
+    for (int i = 1; i <= la; i++) {
+        cur[0] = i;
+        int row_min = cur[0];
+        for (int j = 1; j <= lb; j++) {
+            int sub = prev[j - 1] + (a[i - 1] != b[j - 1]);
+            int del = prev[j] + 1;
+            int ins = cur[j - 1] + 1;
+            cur[j] = sub < del ? (sub < ins ? sub : ins) : (del < ins ? del : ins);
+            if (cur[j] < row_min) {
+                row_min = cur[j];
+            }
+        }
+        if (row_min > limit) {
+            return limit + 1;
+        }
+        memcpy(prev, cur, sizeof(int) * (lb + 1));
+    }
+    return prev[lb];
+}
+
+// Map a phrase word to the vocabulary: exact, singular, or a near miss from STT
+static int vocab_match(const intent_table_t *t, const char *word, float *similarity)
+{
+    int v = vocab_find(t, word);
+    if (v >= 0) {
+        *similarity = 1.0f;
+        return v;
+    }
+    size_t len = strlen(word);
+    if (len > 3 && word[len - 1] == 's') {
+        char singular[MAX_TOKEN_LEN];
+        memcpy(singular, word, len - 1);
+        singular[len - 1] = '\0';
+        v = vocab_find(t, singular);
+        if (v >= 0) {
+            *similarity = 1.0f;
+            return v;
+        }
+    }
+    if (len < 4) {
+        return -1;  // Short words are too easy to confuse
+    }
+    int limit = len >= 7 ? 2 : 1;
+    int best = -1, best_dist = limit + 1;
+    for (int i = 0; i < t->num_vocab; i++) {
+        if (strlen(t->vocab[i]) < 4) {
+            continue;
+        }
+        int d = edit_distance(word, t->vocab[i], best_dist - 1);
+        if (d < best_dist) {
+            best = i;
+            best_dist = d;
+        }
+    }
+    if (best >= 0) {
+        *similarity = best_dist == 1 ? 0.9f : 0.8f;
+    }
+    return best;
+}
+
+// Apply the synonym list to one word; returns the number of words produced (0 for fillers)
+static size_t rewrite_word(const intent_table_t *t, const char *word, char out[][MAX_TOKEN_LEN])
+{
+    for (size_t s = 0; s < t->num_synonyms; s++) {
+        if (strcmp(t->synonyms[s].word, word) == 0) {
+            return tokenize(t->synonyms[s].replacement, out, MAX_KEYWORD_TOKENS);
+        }
+    }
+    memcpy(out[0], word, MAX_TOKEN_LEN);
+    return 1;
+}
+
+void intent_table_set_synonyms(intent_table_t *table, const intent_synonym_t *synonyms, size_t count)
+{
+    if (table) {
+        table->synonyms = synonyms;
+        table->num_synonyms = count;
+    }
+}
+
+const intent_def_t *intent_table_classify(const intent_table_t *table, const char *text, float *confidence)
+{
+    if (confidence) {
+        *confidence = 0.0f;
+    }
+    if (!table || !text) {
+        return NULL;
+    }
+
+    // Normalize: tokenize, rewrite synonyms, drop fillers, map to vocabulary
+    char raw[MAX_PHRASE_TOKENS][MAX_TOKEN_LEN];
+    size_t num_raw = tokenize(text, raw, MAX_PHRASE_TOKENS);
+    uint8_t word[MAX_PHRASE_TOKENS];      // Vocabulary index or NO_WORD
+    float sim[MAX_PHRASE_TOKENS];
+    int num_words = 0;
+    int unknown = 0;
+    for (size_t r = 0; r < num_raw; r++) {
+        char expanded[MAX_KEYWORD_TOKENS][MAX_TOKEN_LEN];
+        size_t n = rewrite_word(table, raw[r], expanded);
+        for (size_t e = 0; e < n && num_words < MAX_PHRASE_TOKENS; e++) {
+            if (is_stopword(expanded[e])) {
+                continue;
+            }
+            float s = 0.0f;
+            int v = vocab_match(table, expanded[e], &s);
+            word[num_words] = v < 0 ? NO_WORD : (uint8_t)v;
+            sim[num_words] = s;
+            num_words++;
+            unknown += (v < 0);
+        }
+    }
+    if (num_words == 0 || unknown == num_words) {
+        return NULL;
+    }
+
+    const intent_def_t *best = NULL;
+    float best_score = 0.0f;
+    for (size_t i = 0; i < table->count; i++) {
+        float score = 0.0f, total_weight = 0.0f;
+        uint32_t covered = 0;   // Phrase words explained by this intent
+        for (int g = 0; g < table->num_groups[i]; g++) {
+            float group_best = 0.0f;
+            uint32_t group_covered = 0;
+            uint64_t mask = table->groups[i][g];
+            while (mask) {
+                int k = __builtin_ctzll(mask);
+                mask &= mask - 1;
+                // Every word of the keyword must appear, in any order
+                float kw = 1.0f;
+                uint32_t kw_covered = 0;
+                for (int w = 0; w < table->keyword_num_words[k] && kw > 0.0f; w++) {
+                    float found = 0.0f;
+                    int at = -1;
+                    for (int p = 0; p < num_words; p++) {
+                        if (word[p] == table->keyword_words[k][w] && sim[p] > found) {
+                            found = sim[p];
+                            at = p;
+                        }
+                    }
+                    kw = found < kw ? found : kw;
+                    if (at >= 0) {
+                        kw_covered |= 1u << at;
+                    }
+                }
+                if (kw > group_best) {
+                    group_best = kw;
+                    group_covered = kw_covered;
+                }
+            }
+            score += table->group_weight[i][g] * group_best;
+            total_weight += table->group_weight[i][g];
+            covered |= group_covered;
+        }
+        if (total_weight == 0.0f || covered == 0) {
+            continue;
+        }
+        int explained = __builtin_popcount(covered);
+        score = score / total_weight * (float)explained / (float)(explained + unknown);
+        if (score > best_score) {
+            best_score = score;
+            best = &table->defs[i];
+        }
+    }
+    if (confidence) {
+        *confidence = best_score;
+    }
+    return best;
+}
+
+void intent_table_free(intent_table_t *table)
+{
+    if (!table) {
+        return;
+    }
+    for (size_t k = 0; k < table->num_keywords; k++) {
+        free((void *)table->keywords[k]);
+    }
+    free(table->nodes);
+    free(table);
+}
+
+esp_err_t intent_table_build(intent_table_t **out, const intent_def_t *defs, size_t count)
+{
+    if (!out || (!defs && count > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (count > INTENT_MAX_INTENTS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Upper bound on trie size: one node per keyword character plus the root
+    size_t max_nodes = 1;
+    for (size_t i = 0; i < count; i++) {
+        for (int g = 0; g < INTENT_MAX_GROUPS; g++) {
+            max_nodes += defs[i].keywords[g] ? strlen(defs[i].keywords[g]) : 0;
+        }
+    }
+    if (max_nodes >= NO_NODE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    intent_table_t *t = calloc(1, sizeof(intent_table_t));
+    if (!t) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->nodes = calloc(max_nodes, sizeof(ac_node_t));
+    if (!t->nodes) {
+        free(t);
+        return ESP_ERR_NO_MEM;
+    }
+    t->defs = defs;
+    t->count = count;
+    t->nodes[0].first_child = NO_NODE;
+    t->nodes[0].next_sibling = NO_NODE;
+    t->num_nodes = 1;
+    memset(t->by_id, NO_INTENT, sizeof(t->by_id));
+
+    esp_err_t ret = ESP_OK;
+    for (size_t i = 0; i < count && ret == ESP_OK; i++) {
+        const intent_def_t *def = &defs[i];
+        for (int k = 0; k < def->num_ids && k < INTENT_MAX_IDS; k++) {
+            int id = def->ids[k];
+            if (id < 0 || id >= INTENT_MAX_COMMAND_ID) {
+                ESP_LOGE(TAG, "%s: command id %d out of range", def->name, id);
+                ret = ESP_ERR_INVALID_SIZE;
+                break;
+            }
+            if (t->by_id[id] == NO_INTENT) {
+                t->by_id[id] = (uint8_t)i;  // Earlier intents keep priority
+            }
+        }
+
+        for (int g = 0; g < INTENT_MAX_GROUPS && ret == ESP_OK; g++) {
+            const char *p = def->keywords[g];
+            if (!p) {
+                continue;
+            }
+            uint64_t mask = 0;
+            while (*p) {
+                const char *end = strchr(p, '|');
+                size_t len = end ? (size_t)(end - p) : strlen(p);
+                char word[32];
+                if (len == 0 || len >= sizeof(word)) {
+                    ESP_LOGE(TAG, "%s: bad keyword in \"%s\"", def->name, def->keywords[g]);
+                    ret = ESP_ERR_INVALID_ARG;
+                    break;
+                }
+                for (size_t c = 0; c < len; c++) {
+                    word[c] = ascii_lower(p[c]);
+                }
+                int bit = ac_add_keyword(t, word, len, max_nodes);
+                if (bit < 0) {
+                    ESP_LOGE(TAG, "Too many keywords (max %d)", INTENT_MAX_KEYWORDS);
+                    ret = ESP_ERR_INVALID_SIZE;
+                    break;
+                }
+                mask |= 1ULL << bit;
+                p += len + (end ? 1 : 0);
+            }
+            t->groups[i][t->num_groups[i]++] = mask;
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = ac_link(t);
+    }
+    if (ret == ESP_OK) {
+        ret = fuzzy_index(t);
+    }
+    if (ret != ESP_OK) {
+        intent_table_free(t);
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Compiled %u intents: %u keywords, %u automaton states",
+             (unsigned)count, (unsigned)t->num_keywords, (unsigned)t->num_nodes);
+    *out = t;
+    return ESP_OK;
+}
+
+const intent_def_t *intent_table_match(const intent_table_t *table, int command_id, const char *text)
+{
+    if (!table) {
+        return NULL;
+    }
+    size_t best = table->count;
+    if (command_id >= 0 && command_id < INTENT_MAX_COMMAND_ID && table->by_id[command_id] != NO_INTENT) {
+        best = table->by_id[command_id];
+    }
+
+    // A keyword match only wins over the ID match if it comes earlier in the table
+    uint64_t found = (text && table->num_keywords > 0) ? ac_scan(table, text) : 0;
+    if (found) {
+        for (size_t i = 0; i < best; i++) {
+            int groups = table->num_groups[i];
+            if (groups == 0) {
+                continue;
+            }
+            int g = 0;
+            while (g < groups && (found & table->groups[i][g])) {
+                g++;
+            }
+            if (g == groups) {
+                best = i;
+                break;
+            }
+        }
+    }
+    return best < table->count ? &table->defs[best] : NULL;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file intent.h
+ * @brief Compiled intent table for local voice command dispatch
+ *
+ * Intents are declared as data: the MultiNet command IDs that select them,
+ * up to INTENT_MAX_GROUPS keyword groups that must all appear in the phrase
+ * (each group lists alternatives separated by '|', matched as ASCII
+ * case-insensitive substrings), and a handler. intent_table_build() compiles
+ * a definition array once into
+ *   - a direct command_id -> intent jump table, and
+ *   - an Aho-Corasick automaton over every distinct keyword,
+ * so matching a phrase is a single pass over its characters followed by a
+ * bitmask test per intent, instead of re-scanning the phrase per keyword.
+ *
+ * Table order is priority: the first intent selected by either its ID or its
+ * keywords wins.
+ *
+ * Free-form STT transcripts go through intent_table_classify() instead, which
+ * works on whole words: the phrase is tokenized, synonyms and fillers are
+ * rewritten, and each token is matched to the keyword vocabulary exactly or
+ * within a small edit distance. Every intent is scored by its keyword groups,
+ * weighted so rare groups ("humidity") count more than common ones ("what"),
+ * and scaled by how much of the phrase the intent accounts for, so "what is
+ * the temperature" scores high and "what is the temperature of the sun" does
+ * not.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INTENT_MAX_INTENTS      64      // Definitions per table
+#define INTENT_MAX_KEYWORDS     64      // Distinct keywords per table (one mask bit each)
+#define INTENT_MAX_GROUPS       3       // Keyword groups ANDed per intent
+#define INTENT_MAX_IDS          4       // MultiNet command IDs per intent
+#define INTENT_MAX_COMMAND_ID   200     // Exclusive upper bound of the jump table
+#define INTENT_FUZZY_THRESHOLD  0.8f    // Classifier confidence needed to skip the cloud
+
+typedef struct intent_def intent_def_t;
+
+/**
+ * @brief Runs a matched intent
+ * @param intent The matched definition (for name and arg)
+ * @param command_id MultiNet command ID, or -1 for text-only matches
+ * @param text Recognized phrase, may be NULL
+ * @return true if handled, false to fall back to the cloud path
+ */
+typedef bool (*intent_handler_t)(const intent_def_t *intent, int command_id, const char *text);
+
+struct intent_def {
+    const char *name;
+    int16_t ids[INTENT_MAX_IDS];
+    uint8_t num_ids;
+    const char *keywords[INTENT_MAX_GROUPS];    // e.g. "what|tell me", NULL for unused groups
+    intent_handler_t handler;
+    const void *arg;                            // Handler-specific data
+};
+
+/**
+ * @brief Word rewrite applied before classification
+ *
+ * replacement may be several words ("air conditioner"), or "" to drop a
+ * filler word that should not count against a match ("make", "set").
+ */
+typedef struct {
+    const char *word;
+    const char *replacement;
+} intent_synonym_t;
+
+typedef struct intent_table intent_table_t;
+
+/**
+ * @brief Compile a definition array into a matcher
+ * @param out Receives the table; defs must outlive it
+ * @return ESP_ERR_INVALID_SIZE if a limit above is exceeded
+ */
+esp_err_t intent_table_build(intent_table_t **out, const intent_def_t *defs, size_t count);
+
+void intent_table_free(intent_table_t *table);
+
+/**
+ * @brief Find the highest-priority intent for a recognition result
+ * @param command_id MultiNet command ID, or -1 if there is none
+ * @param text Phrase to scan for keywords, or NULL
+ * @return Matched definition, or NULL
+ */
+const intent_def_t *intent_table_match(const intent_table_t *table, int command_id, const char *text);
+
+/**
+ * @brief Forget every command ID binding, including those from the definitions
+ */
+void intent_table_clear_ids(intent_table_t *table);
+
+/**
+ * @brief Route a command ID to the named intent
+ *
+ * Used to bind IDs from the runtime command registry. The ID is still
+ * subject to table order: a keyword match on an earlier intent wins.
+ *
+ * @return ESP_ERR_NOT_FOUND if no intent has that name
+ */
+esp_err_t intent_table_set_id(intent_table_t *table, int command_id, const char *name);
+
+/**
+ * @brief Install the synonym list used by intent_table_classify()
+ * @param synonyms Lowercase words; must outlive the table
+ */
+void intent_table_set_synonyms(intent_table_t *table, const intent_synonym_t *synonyms, size_t count);
+
+/**
+ * @brief Score a free-form transcript against every intent
+ * @param confidence Receives the best score in [0, 1]
+ * @return Best-scoring intent, or NULL if nothing scored; compare confidence
+ *         with INTENT_FUZZY_THRESHOLD before acting on it
+ */
+const intent_def_t *intent_table_classify(const intent_table_t *table, const char *text, float *confidence);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,470 @@
+/**
+ * @file json_reader.c
+ * @brief Incremental, allocation-free JSON path extractor implementation
+ */
+
+#include "json_reader.h"
+#include <string.h>
+
+enum {
+    ST_VALUE,           // Expecting any value
+    ST_ARRAY_FIRST,     // After '[': value or ']'
+    ST_OBJECT_FIRST,    // After '{': key or '}'
+    ST_OBJECT_KEY,      // After ',' in an object: key
+    ST_COLON,           // After a key
+    ST_AFTER_VALUE,     // Expecting ',' or a closing bracket
+    ST_STRING,
+    ST_ESCAPE,          // After '\' in a string
+    ST_UNICODE,         // Reading the 4 hex digits of \uXXXX
+    ST_LITERAL,         // Number, true, false or null
+    ST_DONE,            // Top-level value complete
+    ST_ERROR,
+};
+
+static bool is_ws(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_literal_char(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+// ---------------------------------------------------------------------------
+// Path matching
+// ---------------------------------------------------------------------------
+
+static esp_err_t compile_path(json_reader_t *r, size_t p, const char *path)
+{
+    const char *s = path;
+    uint8_t n = 0;
+    while (*s) {
+        if (n >= JSON_READER_MAX_SEGMENTS) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        json_reader_segment_t *seg = &r->segments[p][n];
+        if (*s == '[') {
+            s++;
+            if (*s < '0' || *s > '9') {
+                return ESP_ERR_INVALID_ARG;
+            }
+            uint32_t index = 0;
+            while (*s >= '0' && *s <= '9') {
+                index = index * 10 + (*s++ - '0');
+            }
+            if (*s++ != ']') {
+                return ESP_ERR_INVALID_ARG;
+            }
+            seg->is_index = true;
+            seg->index = index;
+        } else {
+            if (*s == '.') {
+                if (n == 0) {
+                    return ESP_ERR_INVALID_ARG;
+                }
+                s++;
+            }
+            const char *start = s;
+            while (*s && *s != '.' && *s != '[') {
+                s++;
+            }
+            if (s == start || s - start > JSON_READER_MAX_KEY) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            seg->is_index = false;
+            seg->key = start;
+            seg->len = s - start;
+        }
+        n++;
+    }
+    if (n == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    r->num_segments[p] = n;
+    return ESP_OK;
+}
+
+// Paths from the enclosing container that continue with the current key
+static uint32_t match_key(const json_reader_t *r)
+{
+    if (r->key_overflow) {
+        return 0;
+    }
+    const json_reader_level_t *top = &r->stack[r->depth - 1];
+    uint8_t level = r->depth - 1;
+    uint32_t mask = 0;
+    for (size_t p = 0; p < r->num_paths; p++) {
+        if (!(top->mask & (1u << p)) || r->num_segments[p] <= level) {
+            continue;
+        }
+        const json_reader_segment_t *seg = &r->segments[p][level];
+        if (!seg->is_index && seg->len == r->key_len && memcmp(seg->key, r->key, r->key_len) == 0) {
+            mask |= 1u << p;
+        }
+    }
+    return mask;
+}
+
+// Paths that reach the value starting at the current position
+static uint32_t match_value(const json_reader_t *r)
+{
+    if (r->depth == 0) {
+        return 0;
+    }
+    const json_reader_level_t *top = &r->stack[r->depth - 1];
+    if (!top->is_array) {
+        return r->pending_mask;
+    }
+    uint8_t level = r->depth - 1;
+    uint32_t mask = 0;
+    for (size_t p = 0; p < r->num_paths; p++) {
+        if (!(top->mask & (1u << p)) || r->num_segments[p] <= level) {
+            continue;
+        }
+        const json_reader_segment_t *seg = &r->segments[p][level];
+        if (seg->is_index && seg->index == top->index) {
+            mask |= 1u << p;
+        }
+    }
+    return mask;
+}
+
+// ---------------------------------------------------------------------------
+// String output
+// ---------------------------------------------------------------------------
+
+static void flush_out(json_reader_t *r, bool done)
+{
+    if (r->match_path >= 0 && (r->out_len > 0 || done)) {
+        r->cb(r->match_path, r->out, r->out_len, done, r->ctx);
+    }
+    r->out_len = 0;
+}
+
+static void emit_byte(json_reader_t *r, char c)
+{
+    if (r->in_key) {
+        if (r->key_len < JSON_READER_MAX_KEY) {
+            r->key[r->key_len++] = c;
+        } else {
+            r->key_overflow = true;
+        }
+        return;
+    }
+    if (r->match_path < 0) {
+        return;  // Unmatched value, only tokenized
+    }
+    r->out[r->out_len++] = c;
+    if (r->out_len == JSON_READER_CHUNK) {
+        flush_out(r, false);
+    }
+}
+
+static void emit_codepoint(json_reader_t *r, uint32_t cp)
+{
+    if (cp < 0x80) {
+        emit_byte(r, cp);
+    } else if (cp < 0x800) {
+        emit_byte(r, 0xC0 | (cp >> 6));
+        emit_byte(r, 0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        emit_byte(r, 0xE0 | (cp >> 12));
+        emit_byte(r, 0x80 | ((cp >> 6) & 0x3F));
+        emit_byte(r, 0x80 | (cp & 0x3F));
+    } else {
+        emit_byte(r, 0xF0 | (cp >> 18));
+        emit_byte(r, 0x80 | ((cp >> 12) & 0x3F));
+        emit_byte(r, 0x80 | ((cp >> 6) & 0x3F));
+        emit_byte(r, 0x80 | (cp & 0x3F));
+    }
+}
+
+// A high surrogate not followed by a low one is replaced with U+FFFD
+static void drop_surrogate(json_reader_t *r)
+{
+    if (r->high_surrogate) {
+        r->high_surrogate = 0;
+        emit_codepoint(r, 0xFFFD);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Tokenizer
+// ---------------------------------------------------------------------------
+
+static void begin_string(json_reader_t *r, bool is_key)
+{
+    r->in_key = is_key;
+    r->key_len = 0;
+    r->key_overflow = false;
+    r->out_len = 0;
+    r->high_surrogate = 0;
+    r->match_path = -1;
+    if (!is_key) {
+        // A string completes a path only if it is that path's last segment
+        uint32_t mask = match_value(r);
+        for (size_t p = 0; p < r->num_paths; p++) {
+            if ((mask & (1u << p)) && r->num_segments[p] == r->depth) {
+                r->match_path = p;
+                break;
+            }
+        }
+    }
+    r->state = ST_STRING;
+}
+
+static void end_value(json_reader_t *r)
+{
+    r->state = r->depth == 0 ? ST_DONE : ST_AFTER_VALUE;
+}
+
+static void end_string(json_reader_t *r)
+{
+    drop_surrogate(r);
+    if (r->in_key) {
+        r->pending_mask = match_key(r);
+        r->in_key = false;
+        r->state = ST_COLON;
+        return;
+    }
+    if (r->match_path >= 0) {
+        flush_out(r, true);
+        r->matches++;
+        r->match_path = -1;
+    }
+    end_value(r);
+}
+
+static bool push(json_reader_t *r, bool is_array)
+{
+    if (r->depth >= JSON_READER_MAX_DEPTH) {
+        return false;
+    }
+    uint32_t mask = r->depth == 0 ? (1u << r->num_paths) - 1 : match_value(r);
+    json_reader_level_t *level = &r->stack[r->depth++];
+    level->is_array = is_array;
+    level->index = 0;
+    level->mask = mask;
+    r->state = is_array ? ST_ARRAY_FIRST : ST_OBJECT_FIRST;
+    return true;
+}
+
+static bool pop(json_reader_t *r, char close)
+{
+    if (r->depth == 0 || r->stack[r->depth - 1].is_array != (close == ']')) {
+        return false;
+    }
+    r->depth--;
+    end_value(r);
+    return true;
+}
+
+static bool start_value(json_reader_t *r, char c)
+{
+    if (c == '{') {
+        return push(r, false);
+    }
+    if (c == '[') {
+        return push(r, true);
+    }
+    if (c == '"') {
+        begin_string(r, false);
+        return true;
+    }
+    if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+        r->state = ST_LITERAL;  // Scalars other than strings are never extracted
+        return true;
+    }
+    return false;
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool step(json_reader_t *r, char c)
+{
+    switch (r->state) {
+        case ST_STRING:
+            if (c == '"') {
+                end_string(r);
+            } else if (c == '\\') {
+                r->state = ST_ESCAPE;
+            } else if ((unsigned char)c < 0x20) {
+                return false;
+            } else {
+                drop_surrogate(r);
+                emit_byte(r, c);
+            }
+            return true;
+
+        case ST_ESCAPE: {
+            char decoded;
+            switch (c) {
+                case '"':  decoded = '"'; break;
+                case '\\': decoded = '\\'; break;
+                case '/':  decoded = '/'; break;
+                case 'b':  decoded = '\b'; break;
+                case 'f':  decoded = '\f'; break;
+                case 'n':  decoded = '\n'; break;
+                case 'r':  decoded = '\r'; break;
+                case 't':  decoded = '\t'; break;
+                case 'u':
+                    r->hex_count = 0;
+                    r->hex_value = 0;
+                    r->state = ST_UNICODE;
+                    return true;
+                default:
+                    return false;
+            }
+            drop_surrogate(r);
+            emit_byte(r, decoded);
+            r->state = ST_STRING;
+            return true;
+        }
+
+        case ST_UNICODE: {
+            int d = hex_digit(c);
+            if (d < 0) {
+                return false;
+            }
+            r->hex_value = (r->hex_value << 4) | d;
+            if (++r->hex_count < 4) {
+                return true;
+            }
+            uint32_t cp = r->hex_value;
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                drop_surrogate(r);
+                r->high_surrogate = cp;
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                if (r->high_surrogate) {
+                    emit_codepoint(r, 0x10000 + ((r->high_surrogate - 0xD800) << 10) + (cp - 0xDC00));
+                    r->high_surrogate = 0;
+                } else {
+                    emit_codepoint(r, 0xFFFD);
+                }
+            } else {
+                drop_surrogate(r);
+                emit_codepoint(r, cp);
+            }
+            r->state = ST_STRING;
+            return true;
+        }
+
+        case ST_LITERAL:
+            if (is_literal_char(c)) {
+                return true;
+            }
+            end_value(r);
+            return step(r, c);  // Re-examine the terminator
+
+        default:
+            break;
+    }
+
+    if (is_ws(c)) {
+        return true;
+    }
+
+    switch (r->state) {
+        case ST_VALUE:
+            return start_value(r, c);
+
+        case ST_ARRAY_FIRST:
+            if (c == ']') {
+                return pop(r, c);
+            }
+            return start_value(r, c);
+
+        case ST_OBJECT_FIRST:
+            if (c == '}') {
+                return pop(r, c);
+            }
+            /* fall through */
+        case ST_OBJECT_KEY:
+            if (c != '"') {
+                return false;
+            }
+            begin_string(r, true);
+            return true;
+
+        case ST_COLON:
+            if (c != ':') {
+                return false;
+            }
+            r->state = ST_VALUE;
+            return true;
+
+        case ST_AFTER_VALUE:
+            if (c == ',') {
+                json_reader_level_t *top = &r->stack[r->depth - 1];
+                if (top->is_array) {
+                    top->index++;
+                    r->state = ST_VALUE;
+                } else {
+                    r->state = ST_OBJECT_KEY;
+                }
+                return true;
+            }
+            if (c == '}' || c == ']') {
+                return pop(r, c);
+            }
+            return false;
+
+        default:
+            return false;  // ST_DONE with trailing data, or ST_ERROR
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+esp_err_t json_reader_init(json_reader_t *r, const char *const *paths, size_t num_paths,
+                           json_reader_cb_t cb, void *ctx)
+{
+    if (!r || !cb || num_paths > JSON_READER_MAX_PATHS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(r, 0, sizeof(*r));
+    for (size_t p = 0; p < num_paths; p++) {
+        if (!paths[p] || compile_path(r, p, paths[p]) != ESP_OK) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    r->num_paths = num_paths;
+    r->cb = cb;
+    r->ctx = ctx;
+    r->match_path = -1;
+    r->state = ST_VALUE;
+    return ESP_OK;
+}
+
+esp_err_t json_reader_feed(json_reader_t *r, const char *data, size_t len)
+{
+    if (r->state == ST_ERROR) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!step(r, data[i])) {
+            r->offset += i;
+            r->state = ST_ERROR;
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+    r->offset += len;
+    return ESP_OK;
+}
+
+esp_err_t json_reader_finish(json_reader_t *r)
+{
+    if (r->state == ST_LITERAL && r->depth == 0) {
+        r->state = ST_DONE;  // Bare top-level number has no terminator
+    }
+    return r->state == ST_DONE ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+}
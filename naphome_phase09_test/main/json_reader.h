@@ -0,0 +1,111 @@
+/**
+ * @file json_reader.h
+ * @brief Incremental, allocation-free JSON path extractor
+ *
+ * A SAX-style tokenizer that accepts a document in arbitrary chunks (e.g.
+ * straight from esp_http_client_read) and reports only the string values at
+ * a handful of requested paths. No DOM is built and nothing is allocated:
+ * the reader keeps a fixed-depth container stack and a small key buffer.
+ * Matched strings are unescaped (including \uXXXX and surrogate pairs to
+ * UTF-8) and delivered in pieces, so values larger than any buffer - such
+ * as base64 audio - can be consumed as they arrive.
+ *
+ * Paths use dots for object keys and [n] for array indices, e.g.
+ * "candidates[0].content.parts[0].text" or "audioContent".
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_READER_MAX_PATHS     4     // Paths per reader
+#define JSON_READER_MAX_SEGMENTS  8     // Keys/indices per path
+#define JSON_READER_MAX_DEPTH     16    // Container nesting
+#define JSON_READER_MAX_KEY       32    // Longer keys never match
+#define JSON_READER_CHUNK         64    // Unescaped bytes per callback
+
+/**
+ * @brief Receives a piece of a matched string value
+ * @param path Index of the matched path in the array given to init
+ * @param data Unescaped bytes (not NUL terminated)
+ * @param len Number of bytes (may be 0 on the final call)
+ * @param done true on the last piece of this value
+ * @param ctx User context
+ */
+typedef void (*json_reader_cb_t)(int path, const char *data, size_t len, bool done, void *ctx);
+
+typedef struct {
+    bool is_index;
+    uint16_t len;               // Key length
+    uint32_t index;             // Array index
+    const char *key;            // Points into the caller's path string
+} json_reader_segment_t;
+
+typedef struct {
+    uint8_t is_array;
+    uint32_t index;             // Current element index (arrays)
+    uint32_t mask;              // Paths whose leading segments match this container
+} json_reader_level_t;
+
+typedef struct {
+    // Compiled paths
+    json_reader_segment_t segments[JSON_READER_MAX_PATHS][JSON_READER_MAX_SEGMENTS];
+    uint8_t num_segments[JSON_READER_MAX_PATHS];
+    size_t num_paths;
+
+    json_reader_cb_t cb;
+    void *ctx;
+
+    // Tokenizer
+    uint8_t state;
+    uint8_t depth;
+    json_reader_level_t stack[JSON_READER_MAX_DEPTH];
+    uint32_t pending_mask;      // Paths matching the key just read
+    bool in_key;                // Current string is an object key
+    int match_path;             // Path receiving the current string, -1 if none
+    uint8_t hex_count;
+    uint32_t hex_value;
+    uint32_t high_surrogate;
+    char key[JSON_READER_MAX_KEY];
+    uint8_t key_len;
+    bool key_overflow;
+    char out[JSON_READER_CHUNK];
+    uint8_t out_len;
+    size_t offset;              // Bytes consumed, for error reports
+    uint32_t matches;           // Matched values delivered
+} json_reader_t;
+
+/**
+ * @brief Compile paths and reset the reader
+ * @param r Reader
+ * @param paths Path expressions (must stay valid while the reader is used)
+ * @param num_paths Number of paths (at most JSON_READER_MAX_PATHS)
+ * @param cb Called with matched string values
+ * @param ctx Passed to cb
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for a malformed or too deep path
+ */
+esp_err_t json_reader_init(json_reader_t *r, const char *const *paths, size_t num_paths,
+                           json_reader_cb_t cb, void *ctx);
+
+/**
+ * @brief Consume the next chunk of the document
+ * @return ESP_OK, or ESP_ERR_INVALID_RESPONSE on malformed JSON
+ */
+esp_err_t json_reader_feed(json_reader_t *r, const char *data, size_t len);
+
+/**
+ * @brief Check that a complete document was consumed
+ * @return ESP_OK if the top-level value is closed
+ */
+esp_err_t json_reader_finish(json_reader_t *r);
+
+#ifdef __cplusplus
+}
+#endif
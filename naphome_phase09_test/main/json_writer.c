@@ -0,0 +1,215 @@
+/**
+ * @file json_writer.c
+ * @brief Allocation-free streaming JSON writer implementation
+ */
+
+#include "json_writer.h"
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+static void put(json_writer_t *w, const char *data, size_t n)
+{
+    while (n > 0 && w->err == ESP_OK) {
+        size_t room = w->cap - w->len;
+        if (room == 0) {
+            if (!w->flush) {
+                w->err = ESP_ERR_NO_MEM;
+                return;
+            }
+            w->err = w->flush(w->buf, w->len, w->flush_ctx);
+            w->len = 0;
+            continue;
+        }
+        size_t chunk = n < room ? n : room;
+        memcpy(w->buf + w->len, data, chunk);
+        w->len += chunk;
+        w->total += chunk;
+        data += chunk;
+        n -= chunk;
+    }
+}
+
+static void putc_(json_writer_t *w, char c)
+{
+    put(w, &c, 1);
+}
+
+// Emit the separator owed before a new value or key
+static void begin_value(json_writer_t *w)
+{
+    if (w->after_key) {
+        w->after_key = false;
+        return;
+    }
+    if (w->depth > 0) {
+        uint16_t bit = 1u << (w->depth - 1);
+        if (w->has_items & bit) {
+            putc_(w, ',');
+        }
+        w->has_items |= bit;
+    }
+}
+
+static void put_escaped(json_writer_t *w, const char *s, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t run = 0;  // Copy unescaped runs in one go
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        put(w, s + run, i - run);
+        run = i + 1;
+        char esc[6] = {'\\', 0};
+        size_t esc_len = 2;
+        switch (c) {
+            case '"':  esc[1] = '"'; break;
+            case '\\': esc[1] = '\\'; break;
+            case '\n': esc[1] = 'n'; break;
+            case '\r': esc[1] = 'r'; break;
+            case '\t': esc[1] = 't'; break;
+            default:
+                esc[1] = 'u';
+                esc[2] = '0';
+                esc[3] = '0';
+                esc[4] = hex[c >> 4];
+                esc[5] = hex[c & 0xF];
+                esc_len = 6;
+                break;
+        }
+        put(w, esc, esc_len);
+    }
+    put(w, s + run, len - run);
+}
+
+void json_writer_init(json_writer_t *w, char *buf, size_t cap, json_writer_flush_t flush, void *ctx)
+{
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->cap = cap;
+    w->flush = flush;
+    w->flush_ctx = ctx;
+    w->err = (buf && cap > 0) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t json_writer_finish(json_writer_t *w)
+{
+    if (w->err == ESP_OK && w->depth != 0) {
+        w->err = ESP_ERR_INVALID_STATE;
+    }
+    if (w->err == ESP_OK && w->flush && w->len > 0) {
+        w->err = w->flush(w->buf, w->len, w->flush_ctx);
+        w->len = 0;
+    }
+    return w->err;
+}
+
+static void open_container(json_writer_t *w, char c)
+{
+    begin_value(w);
+    if (w->depth >= JSON_WRITER_MAX_DEPTH) {
+        w->err = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    putc_(w, c);
+    w->has_items &= ~(1u << w->depth);
+    w->depth++;
+}
+
+static void close_container(json_writer_t *w, char c)
+{
+    if (w->depth == 0) {
+        w->err = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    w->depth--;
+    putc_(w, c);
+}
+
+void json_writer_object_begin(json_writer_t *w) { open_container(w, '{'); }
+void json_writer_object_end(json_writer_t *w)   { close_container(w, '}'); }
+void json_writer_array_begin(json_writer_t *w)  { open_container(w, '['); }
+void json_writer_array_end(json_writer_t *w)    { close_container(w, ']'); }
+
+void json_writer_raw_key(json_writer_t *w, const char *quoted_key, size_t len)
+{
+    begin_value(w);
+    put(w, quoted_key, len);
+    w->after_key = true;
+}
+
+void json_writer_key(json_writer_t *w, const char *key)
+{
+    begin_value(w);
+    putc_(w, '"');
+    put_escaped(w, key, strlen(key));
+    put(w, "\":", 2);
+    w->after_key = true;
+}
+
+void json_writer_string_n(json_writer_t *w, const char *s, size_t len)
+{
+    begin_value(w);
+    putc_(w, '"');
+    put_escaped(w, s, len);
+    putc_(w, '"');
+}
+
+void json_writer_string(json_writer_t *w, const char *s)
+{
+    if (!s) {
+        json_writer_null(w);
+        return;
+    }
+    json_writer_string_n(w, s, strlen(s));
+}
+
+void json_writer_int(json_writer_t *w, int64_t v)
+{
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%lld", (long long)v);
+    begin_value(w);
+    put(w, num, n);
+}
+
+void json_writer_uint(json_writer_t *w, uint64_t v)
+{
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%llu", (unsigned long long)v);
+    begin_value(w);
+    put(w, num, n);
+}
+
+void json_writer_double(json_writer_t *w, double v, int decimals)
+{
+    if (!isfinite(v)) {
+        json_writer_null(w);  // JSON has no NaN/Inf
+        return;
+    }
+    char num[32];
+    int n = snprintf(num, sizeof(num), "%.*f", decimals, v);
+    if (n < 0 || n >= (int)sizeof(num)) {
+        json_writer_null(w);
+        return;
+    }
+    begin_value(w);
+    put(w, num, n);
+}
+
+void json_writer_bool(json_writer_t *w, bool v)
+{
+    begin_value(w);
+    if (v) {
+        put(w, "true", 4);
+    } else {
+        put(w, "false", 5);
+    }
+}
+
+void json_writer_null(json_writer_t *w)
+{
+    begin_value(w);
+    put(w, "null", 4);
+}
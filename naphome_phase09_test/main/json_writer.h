@@ -0,0 +1,100 @@
+/**
+ * @file json_writer.h
+ * @brief Allocation-free streaming JSON writer
+ *
+ * Emits compact JSON straight into a caller-provided buffer. When the buffer
+ * fills, it is handed to an optional flush callback (e.g. an HTTP chunk
+ * sender) and reused, so documents of any size can be produced from a small
+ * stack buffer. Object keys are string literals spliced into their quoted
+ * form at compile time, so writing a key is a single memcpy.
+ *
+ * Errors are sticky: after the first failure every call is a no-op and
+ * json_writer_finish() reports the error.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_WRITER_MAX_DEPTH 16
+
+/**
+ * @brief Receives a full buffer (or the tail on finish)
+ * @return ESP_OK to continue writing
+ */
+typedef esp_err_t (*json_writer_flush_t)(const char *data, size_t len, void *ctx);
+
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+    size_t total;               // Bytes emitted including flushed ones
+    json_writer_flush_t flush;  // NULL: fixed buffer, overflow is an error
+    void *flush_ctx;
+    esp_err_t err;
+    uint8_t depth;
+    bool after_key;             // Next value follows a key, no separator
+    uint16_t has_items;         // Bit per depth: container already has an element
+} json_writer_t;
+
+/**
+ * @brief Prepare a writer
+ * @param w Writer
+ * @param buf Output buffer
+ * @param cap Size of buf
+ * @param flush Called when buf fills (NULL for a fixed buffer)
+ * @param ctx Passed to flush
+ */
+void json_writer_init(json_writer_t *w, char *buf, size_t cap, json_writer_flush_t flush, void *ctx);
+
+/**
+ * @brief Flush any buffered output and check the document is closed
+ * @return ESP_OK, ESP_ERR_NO_MEM if a fixed buffer overflowed, the flush
+ *         callback's error, or ESP_ERR_INVALID_STATE if containers are open
+ */
+esp_err_t json_writer_finish(json_writer_t *w);
+
+void json_writer_object_begin(json_writer_t *w);
+void json_writer_object_end(json_writer_t *w);
+void json_writer_array_begin(json_writer_t *w);
+void json_writer_array_end(json_writer_t *w);
+
+/**
+ * @brief Write a pre-quoted key, e.g. "\"name\":" (use json_key instead)
+ */
+void json_writer_raw_key(json_writer_t *w, const char *quoted_key, size_t len);
+
+/**
+ * @brief Write a key that is only known at run time (escaped)
+ */
+void json_writer_key(json_writer_t *w, const char *key);
+
+void json_writer_string(json_writer_t *w, const char *s);
+void json_writer_string_n(json_writer_t *w, const char *s, size_t len);
+void json_writer_int(json_writer_t *w, int64_t v);
+void json_writer_uint(json_writer_t *w, uint64_t v);
+void json_writer_double(json_writer_t *w, double v, int decimals);
+void json_writer_bool(json_writer_t *w, bool v);
+void json_writer_null(json_writer_t *w);
+
+// Keys must be string literals; the quotes and colon are added at compile time
+#define json_key(w, k)  json_writer_raw_key((w), "\"" k "\":", sizeof("\"" k "\":") - 1)
+
+#define json_kv_string(w, k, v)     do { json_key(w, k); json_writer_string((w), (v)); } while (0)
+#define json_kv_int(w, k, v)        do { json_key(w, k); json_writer_int((w), (v)); } while (0)
+#define json_kv_uint(w, k, v)       do { json_key(w, k); json_writer_uint((w), (v)); } while (0)
+#define json_kv_double(w, k, v, d)  do { json_key(w, k); json_writer_double((w), (v), (d)); } while (0)
+#define json_kv_bool(w, k, v)       do { json_key(w, k); json_writer_bool((w), (v)); } while (0)
+#define json_kv_object(w, k)        do { json_key(w, k); json_writer_object_begin(w); } while (0)
+#define json_kv_array(w, k)         do { json_key(w, k); json_writer_array_begin(w); } while (0)
+
+#ifdef __cplusplus
+}
+#endif
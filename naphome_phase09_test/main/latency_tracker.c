@@ -0,0 +1,136 @@
+/**
+ * @file latency_tracker.c
+ * @brief EWMA and p95 response latency per endpoint, and the timeouts they imply
+ */
+
+#include "latency_tracker.h"
+#include "metrics.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include <stdbool.h>
+#include <string.h>
+
+static const char *TAG = "latency";
+
+#define MAX_TIMEOUT_DOUBLINGS   4       // Consecutive timeouts that keep widening the next one
+
+struct latency_tracker {
+    const char *name;
+    portMUX_TYPE lock;
+    uint32_t samples[LATENCY_WINDOW];   // Ring of recent latencies (ms)
+    uint32_t count;                     // Samples ever recorded
+    int32_t srtt_ms;                    // Smoothed latency
+    int32_t rttvar_ms;                  // Smoothed mean deviation
+    uint32_t misses;                    // Timeouts since the last response
+    metrics_metric_t *timeout_gauge;
+};
+
+static latency_tracker_t trackers[LATENCY_MAX];
+static size_t tracker_count = 0;
+static portMUX_TYPE pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+latency_tracker_t *latency_tracker_create(const char *name, const char *labels)
+{
+    portENTER_CRITICAL(&pool_lock);
+    latency_tracker_t *t = tracker_count < LATENCY_MAX ? &trackers[tracker_count++] : NULL;
+    portEXIT_CRITICAL(&pool_lock);
+    if (!t) {
+        ESP_LOGE(TAG, "No tracker left for %s", name ? name : "?");
+        return NULL;
+    }
+    memset(t, 0, sizeof(*t));
+    t->name = name ? name : "latency";
+    t->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    t->timeout_gauge = metrics_gauge("naphome_cloud_timeout_milliseconds", labels,
+                                     "Timeout the next cloud request will use");
+    return t;
+}
+
+void latency_record(latency_tracker_t *t, uint32_t ms)
+{
+    if (!t) {
+        return;
+    }
+    portENTER_CRITICAL(&t->lock);
+    if (t->count == 0) {
+        t->srtt_ms = (int32_t)ms;
+        t->rttvar_ms = (int32_t)ms / 2;
+    } else {
+        int32_t err = (int32_t)ms - t->srtt_ms;
+        t->srtt_ms += err / 8;
+        t->rttvar_ms += ((err < 0 ? -err : err) - t->rttvar_ms) / 4;
+    }
+    t->samples[t->count % LATENCY_WINDOW] = ms;
+    t->count++;
+    t->misses = 0;
+    portEXIT_CRITICAL(&t->lock);
+}
+
+void latency_record_timeout(latency_tracker_t *t)
+{
+    if (!t) {
+        return;
+    }
+    portENTER_CRITICAL(&t->lock);
+    if (t->misses < MAX_TIMEOUT_DOUBLINGS) {
+        t->misses++;
+    }
+    portEXIT_CRITICAL(&t->lock);
+}
+
+// p95 of a copy of the window (insertion sort: at most LATENCY_WINDOW entries)
+static uint32_t window_p95(const uint32_t *samples, uint32_t n)
+{
+    uint32_t sorted[LATENCY_WINDOW];
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t v = samples[i];
+        uint32_t j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+    return sorted[(n * 95 + 99) / 100 - 1];
+}
+
+uint32_t latency_p95_ms(latency_tracker_t *t)
+{
+    if (!t) {
+        return 0;
+    }
+    uint32_t samples[LATENCY_WINDOW];
+    portENTER_CRITICAL(&t->lock);
+    uint32_t n = t->count < LATENCY_WINDOW ? t->count : LATENCY_WINDOW;
+    memcpy(samples, t->samples, n * sizeof(samples[0]));
+    portEXIT_CRITICAL(&t->lock);
+    return n >= LATENCY_MIN_SAMPLES ? window_p95(samples, n) : 0;
+}
+
+uint32_t latency_timeout_ms(latency_tracker_t *t, uint32_t fixed_ms)
+{
+    if (!t) {
+        return fixed_ms;
+    }
+    uint32_t samples[LATENCY_WINDOW];
+    portENTER_CRITICAL(&t->lock);
+    uint32_t n = t->count < LATENCY_WINDOW ? t->count : LATENCY_WINDOW;
+    memcpy(samples, t->samples, n * sizeof(samples[0]));
+    uint32_t rto = (uint32_t)(t->srtt_ms + 4 * t->rttvar_ms);
+    uint32_t misses = t->misses;
+    portEXIT_CRITICAL(&t->lock);
+
+    uint32_t timeout = fixed_ms;
+    if (n >= LATENCY_MIN_SAMPLES) {
+        uint32_t p95_bound = 3 * window_p95(samples, n);
+        timeout = (rto > p95_bound ? rto : p95_bound) << misses;
+        if (timeout < LATENCY_MIN_TIMEOUT_MS) {
+            timeout = LATENCY_MIN_TIMEOUT_MS;
+        }
+        if (timeout > fixed_ms) {
+            timeout = fixed_ms;
+        }
+    }
+    metrics_gauge_set(t->timeout_gauge, (int32_t)timeout);
+    return timeout;
+}
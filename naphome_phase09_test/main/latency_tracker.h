@@ -0,0 +1,70 @@
+/**
+ * @file latency_tracker.h
+ * @brief Observed response latency per cloud endpoint, driving its timeouts
+ *
+ * Each tracker keeps a smoothed latency and deviation (the EWMA pair TCP
+ * uses for its retransmission timeout, RFC 6298) and the last
+ * LATENCY_WINDOW samples for a p95. From those it derives:
+ *
+ * - a request timeout: max(srtt + 4 * rttvar, 3 * p95), clamped between
+ *   LATENCY_MIN_TIMEOUT_MS and the endpoint's fixed timeout, and doubled
+ *   for each timeout in a row so an endpoint that has really slowed down
+ *   is not cut off for good;
+ * - a hedge delay: the p95, after which a second copy of an idempotent
+ *   request is worth sending.
+ *
+ * Until LATENCY_MIN_SAMPLES responses have been seen the fixed timeout is
+ * used and nothing is hedged. The current timeout is exported as
+ * naphome_cloud_timeout_milliseconds.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LATENCY_MAX                 4       // Trackers latency_tracker_create() can hand out
+#define LATENCY_WINDOW              64      // Recent samples the p95 is taken over
+#define LATENCY_MIN_SAMPLES         8       // Before this, fixed timeouts and no hedging
+#define LATENCY_MIN_TIMEOUT_MS      3000    // Adaptive timeouts never go below this
+
+typedef struct latency_tracker latency_tracker_t;
+
+/**
+ * @brief Set up a tracker. Call at startup, from one task.
+ * @param name For logs
+ * @param labels Metric labels, e.g. "api=\"tts\"" (must stay valid)
+ * @return NULL if all LATENCY_MAX are in use (a NULL tracker records
+ *         nothing and always returns the fixed timeout)
+ */
+latency_tracker_t *latency_tracker_create(const char *name, const char *labels);
+
+/**
+ * @brief A response arrived after ms (request sent to response headers)
+ */
+void latency_record(latency_tracker_t *tracker, uint32_t ms);
+
+/**
+ * @brief A request got no response within its timeout
+ */
+void latency_record_timeout(latency_tracker_t *tracker);
+
+/**
+ * @brief Timeout for the next request
+ * @param fixed_ms The endpoint's configured timeout: used until there are
+ *        enough samples, and the upper bound afterwards
+ */
+uint32_t latency_timeout_ms(latency_tracker_t *tracker, uint32_t fixed_ms);
+
+/**
+ * @brief p95 of recent responses, or 0 if there are too few samples
+ */
+uint32_t latency_p95_ms(latency_tracker_t *tracker);
+
+#ifdef __cplusplus
+}
+#endif
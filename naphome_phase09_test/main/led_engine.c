@@ -0,0 +1,261 @@
+/**
+ * @file led_engine.c
+ * @brief Keyframe compositor and render task for the LED face
+ */
+
+#include "led_engine.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "led_engine";
+
+typedef struct {
+    const led_timeline_t *timeline;
+    int64_t start_ms;
+    // Storage for led_engine_fill()
+    led_keyframe_t fill_key;
+    led_track_t fill_track;
+    led_timeline_t fill;
+} led_layer_state_t;
+
+static led_layer_state_t layers[LED_LAYER_COUNT];
+static portMUX_TYPE layer_lock = portMUX_INITIALIZER_UNLOCKED;
+static size_t led_count = 0;
+static led_engine_push_fn push_frame = NULL;
+static void *push_ctx = NULL;
+static TaskHandle_t render_task = NULL;
+static esp_timer_handle_t frame_timer = NULL;  // Wakes the render task for the next frame
+static uint32_t pushes = 0;
+
+static int64_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+static void wake_renderer(void)
+{
+    if (render_task) {
+        xTaskNotifyGive(render_task);
+    }
+}
+
+static uint8_t lerp(uint8_t a, uint8_t b, uint32_t num, uint32_t den)
+{
+    return (uint8_t)((int32_t)a + ((int32_t)b - (int32_t)a) * (int32_t)num / (int32_t)den);
+}
+
+// Colour of a track at t; *next_ms is how long that colour holds (0 while fading)
+static led_rgb_t track_color(const led_track_t *track, uint32_t t, uint32_t *next_ms)
+{
+    const led_keyframe_t *keys = track->keys;
+    if (t < keys[0].t_ms) {
+        *next_ms = keys[0].t_ms - t;
+        return keys[0].color;
+    }
+    for (size_t i = 0; i + 1 < track->key_count; i++) {
+        const led_keyframe_t *a = &keys[i];
+        const led_keyframe_t *b = &keys[i + 1];
+        if (t >= b->t_ms) {
+            continue;
+        }
+        if (memcmp(&a->color, &b->color, sizeof(led_rgb_t)) == 0) {
+            *next_ms = b->t_ms - t;
+            return a->color;
+        }
+        uint32_t num = t - a->t_ms;
+        uint32_t den = b->t_ms - a->t_ms;
+        *next_ms = 0;
+        return (led_rgb_t){
+            lerp(a->color.r, b->color.r, num, den),
+            lerp(a->color.g, b->color.g, num, den),
+            lerp(a->color.b, b->color.b, num, den),
+        };
+    }
+    *next_ms = LED_ENGINE_STATIC;
+    return keys[track->key_count - 1].color;
+}
+
+uint32_t led_engine_compose(int64_t now, led_rgb_t *frame)
+{
+    uint32_t next = LED_ENGINE_STATIC;
+    uint32_t all = led_count >= 32 ? UINT32_MAX : LED_PIXEL(led_count) - 1;
+    uint32_t covered = 0;  // Pixels already painted by a higher layer
+    memset(frame, 0, led_count * sizeof(*frame));
+
+    // Top layer first: hidden tracks are skipped, so a covered animation
+    // neither costs a frame nor keeps the render task awake
+    portENTER_CRITICAL(&layer_lock);
+    for (int l = LED_LAYER_COUNT - 1; l >= 0 && covered != all; l--) {
+        led_layer_state_t *layer = &layers[l];
+        const led_timeline_t *timeline = layer->timeline;
+        if (!timeline) {
+            continue;
+        }
+
+        uint32_t t = 0;
+        bool timed = timeline->duration_ms > 0;
+        if (timed) {
+            int64_t elapsed = now > layer->start_ms ? now - layer->start_ms : 0;
+            if (timeline->loop) {
+                t = (uint32_t)(elapsed % timeline->duration_ms);
+            } else if (elapsed >= timeline->duration_ms) {
+                layer->timeline = NULL;
+                continue;
+            } else {
+                t = (uint32_t)elapsed;
+                // The layer disappears when it ends
+                uint32_t left = timeline->duration_ms - t;
+                next = left < next ? left : next;
+            }
+        }
+
+        // Later tracks of a layer paint over earlier ones
+        uint32_t painted = 0;
+        for (size_t i = timeline->track_count; i-- > 0;) {
+            const led_track_t *track = &timeline->tracks[i];
+            uint32_t visible = track->pixels & all & ~(covered | painted);
+            if (!visible) {
+                continue;
+            }
+            uint32_t track_next;
+            led_rgb_t color = track_color(track, t, &track_next);
+            if (timed) {
+                if (timeline->loop && track_next == LED_ENGINE_STATIC) {
+                    track_next = timeline->duration_ms - t;  // Wraps to the first key
+                }
+                next = track_next < next ? track_next : next;
+            }
+            for (size_t p = 0; p < led_count; p++) {
+                if (visible & LED_PIXEL(p)) {
+                    frame[p] = color;
+                }
+            }
+            painted |= visible;
+        }
+        covered |= painted;
+    }
+    portEXIT_CRITICAL(&layer_lock);
+    return next;
+}
+
+static void frame_timer_callback(void *arg)
+{
+    wake_renderer();
+}
+
+static void led_engine_task(void *arg)
+{
+    led_rgb_t frame[LED_ENGINE_MAX_LEDS];
+    led_rgb_t shown[LED_ENGINE_MAX_LEDS];
+    bool shown_valid = false;
+
+    while (true) {
+        uint32_t wait_ms = led_engine_compose(now_ms(), frame);
+        if (!shown_valid || memcmp(frame, shown, led_count * sizeof(led_rgb_t)) != 0) {
+            push_frame(push_ctx, frame, led_count);
+            memcpy(shown, frame, led_count * sizeof(led_rgb_t));
+            shown_valid = true;
+            pushes++;
+        }
+
+        if (esp_timer_is_active(frame_timer)) {
+            esp_timer_stop(frame_timer);
+        }
+        if (wait_ms != LED_ENGINE_STATIC) {
+            uint32_t delay_ms = wait_ms > LED_ENGINE_FRAME_MS ? wait_ms : LED_ENGINE_FRAME_MS;
+            esp_timer_start_once(frame_timer, (uint64_t)delay_ms * 1000);
+        }
+        // Timer for the next frame, or a layer change
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+esp_err_t led_engine_init(size_t count, led_engine_push_fn push, void *ctx)
+{
+    if (render_task) {
+        return ESP_OK;
+    }
+    if (count == 0 || count > LED_ENGINE_MAX_LEDS || !push) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    led_count = count;
+    push_frame = push;
+    push_ctx = ctx;
+
+    // esp_timer rather than vTaskDelay: the tick is too coarse for 60 fps
+    const esp_timer_create_args_t timer_args = {
+        .callback = frame_timer_callback,
+        .name = "led_frame",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &frame_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create frame timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    if (xTaskCreatePinnedToCore(led_engine_task, "led_engine", LED_ENGINE_TASK_STACK, NULL,
+                                LED_ENGINE_TASK_PRIORITY, &render_task, 1) != pdPASS) {
+        esp_timer_delete(frame_timer);
+        frame_timer = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void led_engine_play(led_layer_t layer, const led_timeline_t *timeline)
+{
+    if (layer >= LED_LAYER_COUNT) {
+        return;
+    }
+    int64_t now = now_ms();
+    portENTER_CRITICAL(&layer_lock);
+    layers[layer].timeline = timeline;
+    layers[layer].start_ms = now;
+    portEXIT_CRITICAL(&layer_lock);
+    wake_renderer();
+}
+
+void led_engine_fill(led_layer_t layer, led_rgb_t color, uint32_t duration_ms)
+{
+    if (layer >= LED_LAYER_COUNT) {
+        return;
+    }
+    int64_t now = now_ms();
+    portENTER_CRITICAL(&layer_lock);
+    led_layer_state_t *state = &layers[layer];
+    state->fill_key = (led_keyframe_t){ .t_ms = 0, .color = color };
+    state->fill_track = (led_track_t){ .pixels = UINT32_MAX, .keys = &state->fill_key, .key_count = 1 };
+    state->fill = (led_timeline_t){
+        .name = "fill",
+        .tracks = &state->fill_track,
+        .track_count = 1,
+        .duration_ms = duration_ms,
+    };
+    state->timeline = &state->fill;
+    state->start_ms = now;
+    portEXIT_CRITICAL(&layer_lock);
+    wake_renderer();
+}
+
+void led_engine_clear(led_layer_t layer)
+{
+    led_engine_play(layer, NULL);
+}
+
+const led_timeline_t *led_engine_playing(led_layer_t layer)
+{
+    if (layer >= LED_LAYER_COUNT) {
+        return NULL;
+    }
+    portENTER_CRITICAL(&layer_lock);
+    const led_timeline_t *timeline = layers[layer].timeline;
+    portEXIT_CRITICAL(&layer_lock);
+    return timeline;
+}
+
+uint32_t led_engine_pushes(void)
+{
+    return pushes;
+}
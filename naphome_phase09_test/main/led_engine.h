@@ -0,0 +1,111 @@
+/**
+ * @file led_engine.h
+ * @brief Layered keyframe LED animation with a single refresh owner
+ *
+ * Every effect on the face (idle eyes, listening ears, the smile, lights and
+ * test status) is a timeline of keyframes played on its own layer. Layers
+ * are composited bottom to top into a framebuffer: a pixel driven by a track
+ * on a higher layer hides the layers below, pixels no layer drives are off.
+ *
+ * Only the render task talks to the strip. It recomposites at up to
+ * LED_ENGINE_FRAME_MS while a track is fading, sleeps until the next
+ * keyframe while tracks hold, and pushes a frame over RMT only when a pixel
+ * actually changed. led_engine_compose() is the whole renderer and runs
+ * off-target for frame dumps.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LED_ENGINE_MAX_LEDS         32
+#define LED_ENGINE_FRAME_MS         16      // ~60 fps while a track is fading
+#define LED_ENGINE_STATIC           UINT32_MAX  // led_engine_compose(): nothing changes until a layer does
+#define LED_ENGINE_TASK_STACK       3072
+#define LED_ENGINE_TASK_PRIORITY    3
+
+#define LED_PIXEL(i)                (1u << (i))
+
+typedef struct {
+    uint8_t r, g, b;
+} led_rgb_t;
+
+typedef struct {
+    uint32_t t_ms;                  // Offset into the timeline
+    led_rgb_t color;
+} led_keyframe_t;
+
+// Colour of a set of pixels over time, linearly interpolated between keys
+typedef struct {
+    uint32_t pixels;                // LED_PIXEL() mask
+    const led_keyframe_t *keys;     // Ascending t_ms, at least one
+    size_t key_count;
+} led_track_t;
+
+typedef struct {
+    const char *name;
+    const led_track_t *tracks;
+    size_t track_count;
+    uint32_t duration_ms;           // 0 holds the first key of each track
+    bool loop;                      // Otherwise the layer clears itself after duration_ms
+} led_timeline_t;
+
+typedef enum {
+    LED_LAYER_IDLE,                 // Eyes looking around, sleeping, heartbeat
+    LED_LAYER_LIGHTS,               // "Lights on" and colours
+    LED_LAYER_LISTEN,               // Ears while ESP-SR is matching a command
+    LED_LAYER_SMILE,                // Command understood
+    LED_LAYER_STATUS,               // Test results
+    LED_LAYER_COUNT,
+} led_layer_t;
+
+// Writes one composited frame to the hardware
+typedef void (*led_engine_push_fn)(void *ctx, const led_rgb_t *frame, size_t count);
+
+/**
+ * @brief Start the render task; push receives every changed frame
+ */
+esp_err_t led_engine_init(size_t led_count, led_engine_push_fn push, void *ctx);
+
+/**
+ * @brief Play a timeline from its start on a layer (NULL clears the layer)
+ *
+ * The timeline is referenced, not copied: it must outlive the layer.
+ */
+void led_engine_play(led_layer_t layer, const led_timeline_t *timeline);
+
+/**
+ * @brief Show one colour on every pixel of a layer, cleared after duration_ms (0 holds)
+ */
+void led_engine_fill(led_layer_t layer, led_rgb_t color, uint32_t duration_ms);
+
+void led_engine_clear(led_layer_t layer);
+
+/**
+ * @brief Timeline currently on a layer (NULL when clear)
+ */
+const led_timeline_t *led_engine_playing(led_layer_t layer);
+
+/**
+ * @brief Composite all layers at now_ms into frame[led_count]
+ *
+ * Layers whose timeline ended are cleared.
+ * @return Milliseconds until the frame can next change, LED_ENGINE_STATIC if never
+ */
+uint32_t led_engine_compose(int64_t now_ms, led_rgb_t *frame);
+
+/**
+ * @brief Frames pushed to the strip since init
+ */
+uint32_t led_engine_pushes(void);
+
+#ifdef __cplusplus
+}
+#endif
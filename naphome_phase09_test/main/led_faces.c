@@ -0,0 +1,73 @@
+/**
+ * @file led_faces.c
+ * @brief Keyframe timelines for the LED face
+ */
+
+#include "led_faces.h"
+
+#define RGB_OFF         { 0, 0, 0 }
+#define RGB_CYAN        { 0, 255, 255 }
+#define RGB_CYAN_DIM    { 0, 100, 100 }
+#define RGB_GREEN       { 0, 255, 0 }
+
+#define TRACK(mask, keys) { (mask), (keys), sizeof(keys) / sizeof((keys)[0]) }
+#define TIMELINE(name, tracks, duration_ms, loop) \
+    { (name), (tracks), sizeof(tracks) / sizeof((tracks)[0]), (duration_ms), (loop) }
+
+static const led_keyframe_t key_off[] = { { 0, RGB_OFF } };
+static const led_keyframe_t key_cyan[] = { { 0, RGB_CYAN } };
+static const led_keyframe_t key_green[] = { { 0, RGB_GREEN } };
+
+// Idle: eyes look left, then right, cross-fading over 200 ms
+static const led_keyframe_t idle_left_eye[] = {
+    { 0, RGB_CYAN }, { 1300, RGB_CYAN }, { 1500, RGB_CYAN_DIM }, { 2800, RGB_CYAN_DIM }, { 3000, RGB_CYAN },
+};
+static const led_keyframe_t idle_right_eye[] = {
+    { 0, RGB_CYAN_DIM }, { 1300, RGB_CYAN_DIM }, { 1500, RGB_CYAN }, { 2800, RGB_CYAN }, { 3000, RGB_CYAN_DIM },
+};
+static const led_track_t idle_tracks[] = {
+    TRACK(LED_PIXEL(LED_LEFT_EYE), idle_left_eye),
+    TRACK(LED_PIXEL(LED_RIGHT_EYE), idle_right_eye),
+};
+const led_timeline_t led_face_idle = TIMELINE("idle", idle_tracks, 3000, true);
+
+// Alive but not listening: very dim eyes
+static const led_keyframe_t sleep_eyes[] = { { 0, { 0, 20, 20 } } };
+static const led_track_t sleep_tracks[] = { TRACK(FACE_EYES, sleep_eyes) };
+const led_timeline_t led_face_sleeping = TIMELINE("sleeping", sleep_tracks, 0, false);
+
+// Not alive: dim red pulse on every LED
+static const led_keyframe_t dead_pulse[] = {
+    { 0, { 10, 0, 0 } }, { 500, { 50, 0, 0 } }, { 1000, { 10, 0, 0 } },
+};
+static const led_track_t dead_tracks[] = { TRACK(FACE_ALL, dead_pulse) };
+const led_timeline_t led_face_dead = TIMELINE("dead", dead_tracks, 1000, true);
+
+// Wake word: bright eyes, orange-yellow ears pulsing while ESP-SR listens
+static const led_keyframe_t listen_ears[] = {
+    { 0, { 150, 150, 0 } }, { 200, { 255, 150, 0 } }, { 400, { 150, 150, 0 } },
+};
+static const led_track_t listen_tracks[] = {
+    TRACK(FACE_ALL & ~(FACE_EYES | FACE_EARS), key_off),
+    TRACK(FACE_EYES, key_cyan),
+    TRACK(FACE_EARS, listen_ears),
+};
+const led_timeline_t led_face_listen = TIMELINE("listen", listen_tracks, 400, true);
+
+// Command understood: eyes and a green smile for two seconds
+static const led_track_t smile_tracks[] = {
+    TRACK(FACE_ALL & ~(FACE_EYES | FACE_SMILE), key_off),
+    TRACK(FACE_EYES, key_cyan),
+    TRACK(FACE_SMILE, key_green),
+};
+const led_timeline_t led_face_smile = TIMELINE("smile", smile_tracks, 2000, false);
+
+// "Turn on the lights": the whole happy face
+static const led_keyframe_t lights_ears[] = { { 0, { 0, 150, 0 } } };
+static const led_track_t lights_tracks[] = {
+    TRACK(FACE_ALL & ~(FACE_EYES | FACE_EARS | FACE_SMILE), key_off),
+    TRACK(FACE_EYES, key_cyan),
+    TRACK(FACE_EARS, lights_ears),
+    TRACK(FACE_SMILE, key_green),
+};
+const led_timeline_t led_face_lights = TIMELINE("lights", lights_tracks, 0, false);
@@ -0,0 +1,43 @@
+/**
+ * @file led_faces.h
+ * @brief Face layout and the timelines played on the LED engine's layers
+ *
+ * The 12-LED ring is a face: two eyes, two ears and a four-LED smile. The
+ * timelines live here rather than next to their callers so the host
+ * renderer plays exactly what the firmware does.
+ */
+
+#pragma once
+
+#include "led_engine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FACE_LED_COUNT  12
+
+// LED assignments for face pattern
+#define LED_RIGHT_EYE   2   // Right eye (LED 2)
+#define LED_LEFT_EYE    11  // Left eye (LED 11)
+#define LED_EAR_LEFT    4   // Left ear
+#define LED_EAR_RIGHT   9   // Right ear
+#define LED_SMILE_START 5   // Smile start
+#define LED_SMILE_END   8   // Smile end (inclusive)
+
+// Face layout as LED_PIXEL() masks
+#define FACE_ALL        ((1u << FACE_LED_COUNT) - 1)
+#define FACE_EYES       (LED_PIXEL(LED_LEFT_EYE) | LED_PIXEL(LED_RIGHT_EYE))
+#define FACE_EARS       (LED_PIXEL(LED_EAR_LEFT) | LED_PIXEL(LED_EAR_RIGHT))
+#define FACE_SMILE      (((1u << (LED_SMILE_END + 1)) - 1) & ~((1u << LED_SMILE_START) - 1))
+
+extern const led_timeline_t led_face_idle;      // Eyes looking left and right (LED_LAYER_IDLE)
+extern const led_timeline_t led_face_sleeping;  // Alive but not listening (LED_LAYER_IDLE)
+extern const led_timeline_t led_face_dead;      // Not alive (LED_LAYER_IDLE)
+extern const led_timeline_t led_face_listen;    // Wake word heard (LED_LAYER_LISTEN)
+extern const led_timeline_t led_face_smile;     // Command understood, two seconds (LED_LAYER_SMILE)
+extern const led_timeline_t led_face_lights;    // "Turn on the lights" (LED_LAYER_LIGHTS)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,133 @@
+/**
+ * @file local_intents.c
+ * @brief Local voice intents, their colours and the transcript synonyms
+ */
+
+#include "local_intents.h"
+
+static const intent_color_t intent_colors[] = {
+    { "red",    255, 0,   0   },
+    { "green",  0,   255, 0   },
+    { "blue",   0,   0,   255 },
+    { "white",  255, 255, 255 },
+    { "yellow", 255, 255, 0   },
+    { "orange", 255, 165, 0   },
+    { "purple", 128, 0,   128 },
+    { "cyan",   0,   255, 255 },
+};
+
+// MultiNet command IDs are bound to these by name from the command registry
+// (commands.yaml); keyword groups match MultiNet/STT strings. Order is
+// priority when a phrase matches several entries.
+const intent_def_t local_intents[] = {
+    { .name = "demo", .keywords = { "demo" }, .handler = intent_demo },
+    { .name = "play_wav", .keywords = { "playing", "wav" }, .handler = intent_play_wav },
+    { .name = "play_mp3", .keywords = { "playing", "mp3" }, .handler = intent_play_mp3 },
+    { .name = "lights_on", .keywords = { "turn on", "light" }, .handler = intent_lights_on },
+    { .name = "lights_off", .keywords = { "turn off", "light" }, .handler = intent_lights_off },
+    { .name = "color_red", .keywords = { "red" }, .handler = intent_set_color,
+      .arg = &intent_colors[0] },
+    { .name = "color_green", .keywords = { "green" }, .handler = intent_set_color,
+      .arg = &intent_colors[1] },
+    { .name = "color_blue", .keywords = { "blue" }, .handler = intent_set_color,
+      .arg = &intent_colors[2] },
+    { .name = "color_white", .keywords = { "white" }, .handler = intent_set_color,
+      .arg = &intent_colors[3] },
+    { .name = "color_yellow", .keywords = { "yellow" }, .handler = intent_set_color,
+      .arg = &intent_colors[4] },
+    { .name = "color_orange", .keywords = { "orange" }, .handler = intent_set_color,
+      .arg = &intent_colors[5] },
+    { .name = "color_purple", .keywords = { "purple" }, .handler = intent_set_color,
+      .arg = &intent_colors[6] },
+    { .name = "color_cyan", .keywords = { "cyan" }, .handler = intent_set_color,
+      .arg = &intent_colors[7] },
+    { .name = "volume_highest", .keywords = { "highest", "volume" },
+      .handler = intent_say, .arg = "Setting volume to highest." },
+    { .name = "volume_lowest", .keywords = { "lowest", "volume" },
+      .handler = intent_say, .arg = "Setting volume to lowest." },
+    { .name = "volume_up", .keywords = { "increase", "volume" },
+      .handler = intent_say, .arg = "Increasing volume." },
+    { .name = "volume_down", .keywords = { "decrease", "volume" },
+      .handler = intent_say, .arg = "Decreasing volume." },
+    { .name = "background_audio_start", .keywords = { "play|start", "music|background|audio" },
+      .handler = intent_background_audio_start },
+    { .name = "background_audio_stop", .keywords = { "stop|pause", "music|background|audio" },
+      .handler = intent_background_audio_stop },
+    { .name = "tv_on", .keywords = { "turn on", "tv" },
+      .handler = intent_say, .arg = "Turning TV on." },
+    { .name = "tv_off", .keywords = { "turn off", "tv" },
+      .handler = intent_say, .arg = "Turning TV off." },
+    { .name = "ac_on", .keywords = { "turn on", "air conditioner" },
+      .handler = intent_say, .arg = "Turning air conditioner on." },
+    { .name = "ac_off", .keywords = { "turn off", "air conditioner" },
+      .handler = intent_say, .arg = "Turning air conditioner off." },
+    // Sensor queries are text-only: commands 21-31 are AC temperature settings
+    { .name = "temperature", .keywords = { "what|tell me", "temperature" }, .handler = intent_temperature },
+    { .name = "humidity", .keywords = { "what|tell me", "humidity" }, .handler = intent_humidity },
+    { .name = "air_quality", .keywords = { "what|tell me", "air quality|voc" }, .handler = intent_air_quality },
+    { .name = "co2", .keywords = { "what|tell me", "co2" }, .handler = intent_co2 },
+    { .name = "light_level", .keywords = { "what|tell me", "light level|brightness" }, .handler = intent_light_level },
+    { .name = "weather", .keywords = { "what|tell me", "weather" },
+      .handler = intent_say, .arg = "Weather information is not yet implemented." },
+    { .name = "read_sensors", .keywords = { "read sensors" },
+      .handler = intent_say, .arg = "Reading all sensors is not yet implemented." },
+    { .name = "publish_telemetry", .keywords = { "publish telemetry" },
+      .handler = intent_say, .arg = "Telemetry publishing is not yet implemented." },
+    { .name = "music_play", .keywords = { "play", "music" },
+      .handler = intent_say, .arg = "Music playback is not yet implemented." },
+    { .name = "music_stop", .keywords = { "stop", "music" },
+      .handler = intent_say, .arg = "Music stop is not yet implemented." },
+    { .name = "music_pause", .keywords = { "pause", "music" },
+      .handler = intent_say, .arg = "Music pause is not yet implemented." },
+    { .name = "next_song", .keywords = { "next", "song" },
+      .handler = intent_say, .arg = "Next song is not yet implemented." },
+    { .name = "previous_song", .keywords = { "previous", "song" },
+      .handler = intent_say, .arg = "Previous song is not yet implemented." },
+    { .name = "test_audio", .keywords = { "test audio" },
+      .handler = intent_say, .arg = "Audio test is not yet implemented." },
+};
+
+const size_t local_intents_count = sizeof(local_intents) / sizeof(local_intents[0]);
+
+// Rewrites applied to STT transcripts before local classification; "" drops
+// command verbs and nouns that do not change which intent is meant
+const intent_synonym_t local_synonyms[] = {
+    { "how", "what" },
+    { "temp", "temperature" },
+    { "hot", "temperature" },
+    { "warm", "temperature" },
+    { "cold", "temperature" },
+    { "degrees", "temperature" },
+    { "humid", "humidity" },
+    { "moisture", "humidity" },
+    { "carbon", "co2" },
+    { "dioxide", "co2" },
+    { "bright", "brightness" },
+    { "dark", "brightness" },
+    { "lamp", "light" },
+    { "lamps", "light" },
+    { "lighting", "light" },
+    { "television", "tv" },
+    { "ac", "air conditioner" },
+    { "aircon", "air conditioner" },
+    { "louder", "increase volume" },
+    { "quieter", "decrease volume" },
+    { "softer", "decrease volume" },
+    { "track", "song" },
+    { "skip", "next" },
+    { "resume", "play" },
+    { "make", "" },
+    { "set", "" },
+    { "change", "" },
+    { "switch", "" },
+    { "put", "" },
+    { "run", "" },
+    { "show", "" },
+    { "check", "" },
+    { "give", "" },
+    { "get", "" },
+    { "clock", "" },
+    { "room", "" },
+};
+
+const size_t local_synonyms_count = sizeof(local_synonyms) / sizeof(local_synonyms[0]);
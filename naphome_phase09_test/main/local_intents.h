@@ -0,0 +1,47 @@
+/**
+ * @file local_intents.h
+ * @brief The intent table the firmware answers voice commands with
+ *
+ * The definitions are data; the handlers they point to drive the hardware
+ * and live in naphome_test_suite.c. Keeping the table here lets the host
+ * tests compile exactly what the firmware matches against, with handlers of
+ * their own.
+ */
+
+#pragma once
+
+#include "intent.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// arg of the color_* intents
+typedef struct {
+    const char *name;
+    uint8_t r, g, b;
+} intent_color_t;
+
+extern const intent_def_t local_intents[];
+extern const size_t local_intents_count;
+extern const intent_synonym_t local_synonyms[];     // For intent_table_set_synonyms()
+extern const size_t local_synonyms_count;
+
+bool intent_demo(const intent_def_t *intent, int command_id, const char *text);
+bool intent_play_wav(const intent_def_t *intent, int command_id, const char *text);
+bool intent_play_mp3(const intent_def_t *intent, int command_id, const char *text);
+bool intent_lights_on(const intent_def_t *intent, int command_id, const char *text);
+bool intent_lights_off(const intent_def_t *intent, int command_id, const char *text);
+bool intent_set_color(const intent_def_t *intent, int command_id, const char *text);
+bool intent_background_audio_start(const intent_def_t *intent, int command_id, const char *text);
+bool intent_background_audio_stop(const intent_def_t *intent, int command_id, const char *text);
+bool intent_temperature(const intent_def_t *intent, int command_id, const char *text);
+bool intent_humidity(const intent_def_t *intent, int command_id, const char *text);
+bool intent_air_quality(const intent_def_t *intent, int command_id, const char *text);
+bool intent_co2(const intent_def_t *intent, int command_id, const char *text);
+bool intent_light_level(const intent_def_t *intent, int command_id, const char *text);
+bool intent_say(const intent_def_t *intent, int command_id, const char *text);   // arg is the spoken reply
+
+#ifdef __cplusplus
+}
+#endif
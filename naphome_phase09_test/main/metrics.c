@@ -0,0 +1,257 @@
+/**
+ * @file metrics.c
+ * @brief Fixed-memory metrics registry with Prometheus text export
+ */
+
+#include "metrics.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "metrics";
+
+typedef enum {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM,
+} metric_type_t;
+
+struct metrics_metric {
+    const char *name;
+    const char *labels;         // NULL or 'key="value",...'
+    const char *help;
+    metric_type_t type;
+    _Atomic uint32_t value;     // Counter, or gauge bits (int32)
+    _Atomic uint64_t sum_us;    // Histogram sum
+    _Atomic uint32_t buckets[METRICS_HIST_BUCKETS + 1];  // Non-cumulative; last is +Inf
+};
+
+static struct metrics_metric registry[METRICS_MAX_METRICS];
+static _Atomic size_t registry_count = 0;
+static portMUX_TYPE registry_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool same_labels(const char *a, const char *b)
+{
+    if (!a || !b) {
+        return a == b;
+    }
+    return strcmp(a, b) == 0;
+}
+
+static metrics_metric_t *metrics_register(const char *name, const char *labels, const char *help,
+                                          metric_type_t type)
+{
+    metrics_metric_t *m = NULL;
+    bool mismatch = false;
+    portENTER_CRITICAL(&registry_lock);
+    size_t count = atomic_load_explicit(&registry_count, memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(registry[i].name, name) == 0 && same_labels(registry[i].labels, labels)) {
+            m = (registry[i].type == type) ? &registry[i] : NULL;
+            mismatch = !m;
+            break;
+        }
+    }
+    if (!m && !mismatch && count < METRICS_MAX_METRICS) {
+        m = &registry[count];
+        m->name = name;
+        m->labels = labels;
+        m->help = help;
+        m->type = type;
+        // Publish the slot only once it is filled in
+        atomic_store_explicit(&registry_count, count + 1, memory_order_release);
+    }
+    portEXIT_CRITICAL(&registry_lock);
+
+    // Recording into NULL is a no-op, so say why the metric will stay at zero
+    if (mismatch) {
+        ESP_LOGE(TAG, "%s%s%s%s already registered as another type", name, labels ? "{" : "",
+                 labels ? labels : "", labels ? "}" : "");
+    } else if (!m) {
+        ESP_LOGE(TAG, "Registry full (%d metrics): %s%s%s%s not registered", METRICS_MAX_METRICS, name,
+                 labels ? "{" : "", labels ? labels : "", labels ? "}" : "");
+    }
+    return m;
+}
+
+metrics_metric_t *metrics_counter(const char *name, const char *labels, const char *help)
+{
+    return metrics_register(name, labels, help, METRIC_COUNTER);
+}
+
+metrics_metric_t *metrics_gauge(const char *name, const char *labels, const char *help)
+{
+    return metrics_register(name, labels, help, METRIC_GAUGE);
+}
+
+metrics_metric_t *metrics_histogram(const char *name, const char *labels, const char *help)
+{
+    return metrics_register(name, labels, help, METRIC_HISTOGRAM);
+}
+
+// ------------------------------------------------------------------------- //
+// Recording (hot path)
+// ------------------------------------------------------------------------- //
+
+void metrics_inc(metrics_metric_t *m)
+{
+    if (m) {
+        atomic_fetch_add_explicit(&m->value, 1, memory_order_relaxed);
+    }
+}
+
+void metrics_add(metrics_metric_t *m, uint32_t n)
+{
+    if (m) {
+        atomic_fetch_add_explicit(&m->value, n, memory_order_relaxed);
+    }
+}
+
+void metrics_gauge_set(metrics_metric_t *m, int32_t value)
+{
+    if (m) {
+        atomic_store_explicit(&m->value, (uint32_t)value, memory_order_relaxed);
+    }
+}
+
+void metrics_observe_us(metrics_metric_t *m, uint32_t us)
+{
+    if (!m) {
+        return;
+    }
+    // Bucket i counts values <= 2^i us
+    unsigned idx = (us <= 1) ? 0 : 32 - __builtin_clz(us - 1);
+    if (idx > METRICS_HIST_BUCKETS) {
+        idx = METRICS_HIST_BUCKETS;
+    }
+    atomic_fetch_add_explicit(&m->buckets[idx], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&m->sum_us, (uint64_t)us, memory_order_relaxed);
+}
+
+void metrics_observe_since(metrics_metric_t *m, int64_t start_us)
+{
+    int64_t elapsed = esp_timer_get_time() - start_us;
+    metrics_observe_us(m, elapsed < 0 ? 0 : (elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed));
+}
+
+// ------------------------------------------------------------------------- //
+// Prometheus text export
+// ------------------------------------------------------------------------- //
+
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+    metrics_flush_t flush;
+    void *ctx;
+    esp_err_t err;
+} out_t;
+
+static void out_flush(out_t *o)
+{
+    if (o->err == ESP_OK && o->len > 0) {
+        o->err = o->flush(o->buf, o->len, o->ctx);
+        o->len = 0;
+    }
+}
+
+__attribute__((format(printf, 2, 3)))
+static void out_printf(out_t *o, const char *fmt, ...)
+{
+    for (int attempt = 0; attempt < 2 && o->err == ESP_OK; attempt++) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(o->buf + o->len, o->cap - o->len, fmt, args);
+        va_end(args);
+        if (n < 0) {
+            o->err = ESP_FAIL;
+            return;
+        }
+        if ((size_t)n < o->cap - o->len) {
+            o->len += n;
+            return;
+        }
+        out_flush(o);  // Line did not fit: send what we have and retry once
+    }
+    if (o->err == ESP_OK) {
+        o->err = ESP_ERR_INVALID_SIZE;  // A single line is larger than the buffer
+    }
+}
+
+// Microseconds as seconds with six decimals, exactly
+static void out_seconds(out_t *o, uint64_t us)
+{
+    out_printf(o, "%llu.%06lu", (unsigned long long)(us / 1000000), (unsigned long)(us % 1000000));
+}
+
+static void write_histogram(out_t *o, metrics_metric_t *m)
+{
+    const char *labels = m->labels ? m->labels : "";
+    const char *sep = m->labels ? "," : "";
+    uint32_t cumulative = 0;
+    for (int i = 0; i <= METRICS_HIST_BUCKETS; i++) {
+        cumulative += atomic_load_explicit(&m->buckets[i], memory_order_relaxed);
+        out_printf(o, "%s_bucket{%s%sle=\"", m->name, labels, sep);
+        if (i < METRICS_HIST_BUCKETS) {
+            out_seconds(o, 1u << i);
+        } else {
+            out_printf(o, "+Inf");
+        }
+        out_printf(o, "\"} %lu\n", (unsigned long)cumulative);
+    }
+    out_printf(o, "%s_sum%s%s%s ", m->name, m->labels ? "{" : "", labels, m->labels ? "}" : "");
+    out_seconds(o, atomic_load_explicit(&m->sum_us, memory_order_relaxed));
+    out_printf(o, "\n%s_count%s%s%s %lu\n", m->name, m->labels ? "{" : "", labels,
+               m->labels ? "}" : "", (unsigned long)cumulative);
+}
+
+esp_err_t metrics_write_prometheus(char *buf, size_t cap, metrics_flush_t flush, void *ctx)
+{
+    if (!buf || cap == 0 || !flush) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    out_t o = { .buf = buf, .cap = cap, .flush = flush, .ctx = ctx, .err = ESP_OK };
+    static const char *const type_names[] = { "counter", "gauge", "histogram" };
+
+    size_t count = atomic_load_explicit(&registry_count, memory_order_acquire);
+    for (size_t i = 0; i < count && o.err == ESP_OK; i++) {
+        // Families are emitted whole at their first registration: skip later series
+        bool seen = false;
+        for (size_t j = 0; j < i && !seen; j++) {
+            seen = (strcmp(registry[j].name, registry[i].name) == 0);
+        }
+        if (seen) {
+            continue;
+        }
+        out_printf(&o, "# HELP %s %s\n# TYPE %s %s\n", registry[i].name,
+                   registry[i].help ? registry[i].help : "", registry[i].name,
+                   type_names[registry[i].type]);
+
+        for (size_t j = i; j < count; j++) {
+            metrics_metric_t *m = &registry[j];
+            if (strcmp(m->name, registry[i].name) != 0) {
+                continue;
+            }
+            uint32_t value = atomic_load_explicit(&m->value, memory_order_relaxed);
+            switch (m->type) {
+                case METRIC_COUNTER:
+                    out_printf(&o, "%s%s%s%s %lu\n", m->name, m->labels ? "{" : "",
+                               m->labels ? m->labels : "", m->labels ? "}" : "", (unsigned long)value);
+                    break;
+                case METRIC_GAUGE:
+                    out_printf(&o, "%s%s%s%s %ld\n", m->name, m->labels ? "{" : "",
+                               m->labels ? m->labels : "", m->labels ? "}" : "", (long)(int32_t)value);
+                    break;
+                case METRIC_HISTOGRAM:
+                    write_histogram(&o, m);
+                    break;
+            }
+        }
+    }
+    out_flush(&o);
+    return o.err;
+}
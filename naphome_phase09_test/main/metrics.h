@@ -0,0 +1,81 @@
+/**
+ * @file metrics.h
+ * @brief Fixed-memory metrics registry with Prometheus text export
+ *
+ * Counters, gauges and latency histograms live in a static table; nothing is
+ * allocated. Metrics are registered once (typically into a static handle on
+ * first use) and recorded from hot paths with relaxed atomic adds, so
+ * recording is safe from any task and costs well under 100 ns
+ * (host_test/test_metrics measures it).
+ *
+ * Histograms take microseconds and use power-of-two buckets from 1 us to
+ * ~8.4 s; they are exported in seconds as Prometheus cumulative buckets.
+ * The _sum is kept in 64-bit microseconds and does not wrap in practice;
+ * on the 32-bit target that one add is a libatomic critical section.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define METRICS_MAX_METRICS     48      // Registry slots (name + labels pairs)
+#define METRICS_HIST_BUCKETS    24      // Finite buckets: le = 2^0 .. 2^23 us, plus +Inf
+
+typedef struct metrics_metric metrics_metric_t;
+
+/**
+ * @brief Receives buffered Prometheus text
+ * @return ESP_OK to continue
+ */
+typedef esp_err_t (*metrics_flush_t)(const char *data, size_t len, void *ctx);
+
+/**
+ * @brief Register (or look up) a monotonically increasing counter
+ * @param name Metric name, e.g. "naphome_wake_word_total" (must stay valid)
+ * @param labels Constant label set without braces, e.g. "api=\"tts\"", or NULL
+ * @param help One-line description for # HELP
+ * @return Handle, or NULL (logged) if the registry is full or the name and labels
+ *         are taken by another type; recording into NULL is a no-op
+ */
+metrics_metric_t *metrics_counter(const char *name, const char *labels, const char *help);
+
+/**
+ * @brief Register (or look up) a gauge holding the last value set
+ */
+metrics_metric_t *metrics_gauge(const char *name, const char *labels, const char *help);
+
+/**
+ * @brief Register (or look up) a latency histogram fed with microseconds
+ */
+metrics_metric_t *metrics_histogram(const char *name, const char *labels, const char *help);
+
+void metrics_inc(metrics_metric_t *m);
+void metrics_add(metrics_metric_t *m, uint32_t n);
+void metrics_gauge_set(metrics_metric_t *m, int32_t value);
+void metrics_observe_us(metrics_metric_t *m, uint32_t us);
+
+/**
+ * @brief Record the time since start_us (from esp_timer_get_time)
+ */
+void metrics_observe_since(metrics_metric_t *m, int64_t start_us);
+
+/**
+ * @brief Write every registered metric in Prometheus text format 0.0.4
+ * @param buf Scratch buffer
+ * @param cap Size of buf
+ * @param flush Called whenever buf fills and once at the end
+ * @param ctx Passed to flush
+ * @return ESP_OK, or the first error returned by flush
+ */
+esp_err_t metrics_write_prometheus(char *buf, size_t cap, metrics_flush_t flush, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,668 @@
+/**
+ * @file mqtt_publisher.c
+ * @brief QoS1 MQTT publisher with offline store-and-forward queue implementation
+ */
+
+#include "mqtt_publisher.h"
+#include "mqtt_client.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_heap_caps.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "mqtt_pub";
+
+#define PUB_NVS_NAMESPACE   "mqtt_q"
+#define PUB_EARLY_ACKS      MQTT_PUB_MAX_INFLIGHT
+#define PUB_EARLY_ACK_TTL_US (1000 * 1000)  // Unmatched PUBACKs older than this are stray
+#define PUB_HEAD_COMMIT_POPS 8      // Flash reads between commits of the head index
+#define PUB_MSG_ID_SENDING  -1      // Slot reserved, publish call still running
+#define PUB_MSG_ID_RETRY    -2      // Slot waiting to be published again
+#define PUB_DRAINED_BIT     (1 << 0)
+
+typedef struct {
+    uint16_t len;
+    char topic[MQTT_PUB_MAX_TOPIC];
+    uint8_t payload[MQTT_PUB_MAX_PAYLOAD];
+} pub_msg_t;
+
+typedef struct {
+    bool used;
+    int msg_id;                 // esp-mqtt id, or PUB_MSG_ID_SENDING / PUB_MSG_ID_RETRY
+    pub_msg_t msg;
+} pub_inflight_t;
+
+typedef struct {
+    int msg_id;
+    int64_t at_us;
+} pub_early_ack_t;
+
+static mqtt_publisher_config_t pub_config;
+static esp_mqtt_client_handle_t client = NULL;
+static TaskHandle_t pub_task_handle = NULL;
+static SemaphoreHandle_t pub_mutex = NULL;
+static EventGroupHandle_t pub_events = NULL;
+static esp_timer_handle_t reconnect_timer = NULL;
+
+// RAM ring of the newest messages; flash holds older ones that spilled
+static pub_msg_t *ram_queue = NULL;
+static size_t ram_head = 0;
+static size_t ram_count = 0;
+
+static pub_inflight_t *inflight = NULL;
+static size_t inflight_count = 0;
+
+// PUBACKs that arrived before the publishing task recorded the msg_id. The
+// ring overwrites the oldest entry, and entries expire so a stray ack can't
+// match a later publish once esp-mqtt's 16-bit ids wrap.
+static pub_early_ack_t early_acks[PUB_EARLY_ACKS];
+static size_t early_ack_next = 0;
+
+// Flash indices change only on the publisher task, under pub_mutex so stats
+// and the drained check see them consistently; NVS I/O runs without the lock.
+static nvs_handle_t flash_handle = 0;
+static bool flash_ok = false;
+static uint32_t flash_head = 0;     // Sequence number of the oldest stored message
+static uint32_t flash_tail = 0;     // Sequence number of the next message to store
+static uint32_t flash_head_pending = 0;  // Reads since the head index was committed
+static bool flash_spilling = false;      // A message is between RAM and flash
+static uint8_t flash_blob[MQTT_PUB_MAX_TOPIC + MQTT_PUB_MAX_PAYLOAD];  // Publisher task only
+
+static volatile bool connected = false;
+static bool ever_connected = false;
+static int64_t link_down_us = 0;
+static uint32_t backoff_ms = 0;
+
+static mqtt_publisher_stats_t pub_stats = {0};
+
+// ---------------------------------------------------------------------------
+// Flash spill queue (NVS blobs keyed by sequence number modulo the capacity)
+// ---------------------------------------------------------------------------
+
+static void flash_key(uint32_t seq, char *key, size_t key_len)
+{
+    snprintf(key, key_len, "m%lu", (unsigned long)(seq % MQTT_PUB_FLASH_QUEUE_LEN));
+}
+
+static void flash_save_indices(void)
+{
+    nvs_set_u32(flash_handle, "head", flash_head);
+    nvs_set_u32(flash_handle, "tail", flash_tail);
+    nvs_commit(flash_handle);
+    flash_head_pending = 0;
+}
+
+static void flash_open(void)
+{
+    esp_err_t ret = nvs_open(PUB_NVS_NAMESPACE, NVS_READWRITE, &flash_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "NVS unavailable (%s) - queue is RAM only", esp_err_to_name(ret));
+        return;
+    }
+    flash_ok = true;
+    if (nvs_get_u32(flash_handle, "head", &flash_head) != ESP_OK ||
+        nvs_get_u32(flash_handle, "tail", &flash_tail) != ESP_OK ||
+        flash_tail - flash_head > MQTT_PUB_FLASH_QUEUE_LEN) {
+        flash_head = 0;
+        flash_tail = 0;
+        flash_save_indices();
+    }
+    if (flash_tail != flash_head) {
+        ESP_LOGI(TAG, "Resuming %lu messages stored in flash",
+                 (unsigned long)(flash_tail - flash_head));
+    }
+}
+
+// Blob layout: topic, terminator, payload
+static size_t flash_encode(const pub_msg_t *msg)
+{
+    size_t topic_len = strlen(msg->topic) + 1;
+    memcpy(flash_blob, msg->topic, topic_len);
+    memcpy(flash_blob + topic_len, msg->payload, msg->len);
+    return topic_len + msg->len;
+}
+
+/**
+ * Move the oldest RAM message to flash so flash stays strictly older. The
+ * message is copied out under the lock and written without it, so publish
+ * callers never wait for NVS.
+ */
+static bool flash_spill_one(void)
+{
+    xSemaphoreTake(pub_mutex, portMAX_DELAY);
+    if (!flash_ok || ram_count < MQTT_PUB_SPILL_THRESHOLD) {
+        xSemaphoreGive(pub_mutex);
+        return false;
+    }
+    size_t blob_len = flash_encode(&ram_queue[ram_head]);
+    ram_head = (ram_head + 1) % MQTT_PUB_RAM_QUEUE_LEN;
+    ram_count--;
+    if (flash_tail - flash_head >= MQTT_PUB_FLASH_QUEUE_LEN) {
+        // Full: the slot about to be reused holds the oldest message
+        flash_head++;
+        pub_stats.dropped++;
+    }
+    flash_spilling = true;
+    xSemaphoreGive(pub_mutex);
+
+    char key[16];
+    flash_key(flash_tail, key, sizeof(key));
+    esp_err_t ret = nvs_set_blob(flash_handle, key, flash_blob, blob_len);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to spill message to flash: %s", esp_err_to_name(ret));
+    }
+
+    xSemaphoreTake(pub_mutex, portMAX_DELAY);
+    flash_spilling = false;
+    if (ret == ESP_OK) {
+        flash_tail++;
+        pub_stats.spilled++;
+    } else {
+        pub_stats.dropped++;
+    }
+    xSemaphoreGive(pub_mutex);
+    if (ret == ESP_OK) {
+        flash_save_indices();
+    }
+    return ret == ESP_OK;
+}
+
+/**
+ * Read the oldest flash message. The head index is committed every
+ * PUB_HEAD_COMMIT_POPS reads rather than on each one, so after a reboot up
+ * to that many messages may be sent again; QoS1 is at-least-once anyway.
+ */
+static bool flash_pop(pub_msg_t *msg)
+{
+    while (flash_ok && flash_head != flash_tail) {
+        size_t blob_len = sizeof(flash_blob);
+        char key[16];
+        flash_key(flash_head, key, sizeof(key));
+        esp_err_t ret = nvs_get_blob(flash_handle, key, flash_blob, &blob_len);
+
+        size_t topic_len = (ret == ESP_OK) ? strnlen((const char *)flash_blob, MQTT_PUB_MAX_TOPIC) : MQTT_PUB_MAX_TOPIC;
+        bool readable = topic_len < MQTT_PUB_MAX_TOPIC && topic_len < blob_len;
+        if (readable) {
+            memcpy(msg->topic, flash_blob, topic_len + 1);
+            msg->len = blob_len - topic_len - 1;
+            memcpy(msg->payload, flash_blob + topic_len + 1, msg->len);
+        } else {
+            ESP_LOGW(TAG, "Skipping unreadable flash message %s", key);
+        }
+
+        xSemaphoreTake(pub_mutex, portMAX_DELAY);
+        flash_head++;
+        if (!readable) {
+            pub_stats.dropped++;
+        }
+        xSemaphoreGive(pub_mutex);
+        if (++flash_head_pending >= PUB_HEAD_COMMIT_POPS || flash_head == flash_tail) {
+            flash_save_indices();
+        }
+        if (readable) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// Queue (caller holds pub_mutex)
+// ---------------------------------------------------------------------------
+
+static void update_drained_locked(void)
+{
+    if (ram_count == 0 && inflight_count == 0 && !flash_spilling &&
+        (!flash_ok || flash_head == flash_tail)) {
+        xEventGroupSetBits(pub_events, PUB_DRAINED_BIT);
+    } else {
+        xEventGroupClearBits(pub_events, PUB_DRAINED_BIT);
+    }
+}
+
+static bool early_ack_take_locked(int msg_id)
+{
+    int64_t now = esp_timer_get_time();
+    for (size_t i = 0; i < PUB_EARLY_ACKS; i++) {
+        pub_early_ack_t *ack = &early_acks[i];
+        if (ack->msg_id == msg_id && now - ack->at_us < PUB_EARLY_ACK_TTL_US) {
+            ack->msg_id = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void inflight_release_locked(pub_inflight_t *slot)
+{
+    slot->used = false;
+    inflight_count--;
+    pub_stats.acked++;
+}
+
+// ---------------------------------------------------------------------------
+// Connection management
+// ---------------------------------------------------------------------------
+
+static void reconnect_timer_callback(void *arg)
+{
+    ESP_LOGI(TAG, "Reconnecting to broker");
+    esp_mqtt_client_reconnect(client);
+}
+
+static void schedule_reconnect(void)
+{
+    if (esp_timer_is_active(reconnect_timer)) {
+        return;  // Error and disconnect events arrive for the same failure
+    }
+    // +/-25% jitter so devices that lost the same AP don't reconnect in lockstep
+    uint32_t jitter = backoff_ms / 2;
+    uint32_t delay_ms = backoff_ms - backoff_ms / 4 + (jitter ? esp_random() % jitter : 0);
+    ESP_LOGI(TAG, "Broker unavailable, retrying in %lu ms", (unsigned long)delay_ms);
+    esp_timer_start_once(reconnect_timer, (uint64_t)delay_ms * 1000);
+
+    backoff_ms *= 2;
+    if (backoff_ms > pub_config.backoff_max_ms) {
+        backoff_ms = pub_config.backoff_max_ms;
+    }
+}
+
+static void on_link_down(void)
+{
+    xSemaphoreTake(pub_mutex, portMAX_DELAY);
+    connected = false;
+    if (link_down_us == 0) {
+        link_down_us = esp_timer_get_time();
+    }
+    xSemaphoreGive(pub_mutex);
+    schedule_reconnect();
+}
+
+static void on_connected(void)
+{
+    xSemaphoreTake(pub_mutex, portMAX_DELAY);
+    connected = true;
+    backoff_ms = pub_config.backoff_min_ms;
+    if (ever_connected && link_down_us != 0) {
+        pub_stats.reconnects++;
+        pub_stats.last_recovery_ms = (esp_timer_get_time() - link_down_us) / 1000;
+        ESP_LOGI(TAG, "Broker connection recovered after %lu ms",
+                 (unsigned long)pub_stats.last_recovery_ms);
+    } else {
+        ESP_LOGI(TAG, "Connected to broker");
+    }
+    ever_connected = true;
+    link_down_us = 0;
+    // Unacknowledged publishes stay in flight: esp-mqtt's outbox resends them
+    xSemaphoreGive(pub_mutex);
+    xTaskNotifyGive(pub_task_handle);
+}
+
+static void on_published(int msg_id)
+{
+    xSemaphoreTake(pub_mutex, portMAX_DELAY);
+    bool matched = false;
+    for (size_t i = 0; i < MQTT_PUB_MAX_INFLIGHT; i++) {
+        if (inflight[i].used && inflight[i].msg_id == msg_id) {
+            inflight_release_locked(&inflight[i]);
+            matched = true;
+            break;
+        }
+    }
+    if (!matched) {
+        early_acks[early_ack_next].msg_id = msg_id;
+        early_acks[early_ack_next].at_us = esp_timer_get_time();
+        early_ack_next = (early_ack_next + 1) % PUB_EARLY_ACKS;
+    }
+    update_drained_locked();
+    xSemaphoreGive(pub_mutex);
+    xTaskNotifyGive(pub_task_handle);
+}
+
+static void on_deleted(int msg_id)
+{
+    // esp-mqtt gave up on a publish that outlived its outbox; send it again
+    xSemaphoreTake(pub_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < MQTT_PUB_MAX_INFLIGHT; i++) {
+        if (inflight[i].used && inflight[i].msg_id == msg_id) {
+            ESP_LOGW(TAG, "Msg %d expired from the outbox, re-sending", msg_id);
+            inflight[i].msg_id = PUB_MSG_ID_RETRY;
+            pub_stats.retried++;
+            break;
+        }
+    }
+    xSemaphoreGive(pub_mutex);
+    xTaskNotifyGive(pub_task_handle);
+}
+
+static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t)event_data;
+
+    switch ((esp_mqtt_event_id_t)event_id) {
+        case MQTT_EVENT_CONNECTED:
+            on_connected();
+            break;
+        case MQTT_EVENT_DISCONNECTED:
+            on_link_down();
+            break;
+        case MQTT_EVENT_PUBLISHED:
+            on_published(event->msg_id);
+            break;
+        case MQTT_EVENT_DELETED:
+            on_deleted(event->msg_id);
+            break;
+        case MQTT_EVENT_ERROR:
+            ESP_LOGW(TAG, "MQTT error event");
+            break;
+        default:
+            break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Publisher task
+// ---------------------------------------------------------------------------
+
+static pub_inflight_t *inflight_reserve_locked(void)
+{
+    for (size_t i = 0; i < MQTT_PUB_MAX_INFLIGHT; i++) {
+        if (!inflight[i].used) {
+            inflight[i].used = true;
+            inflight[i].msg_id = PUB_MSG_ID_SENDING;
+            inflight_count++;
+            return &inflight[i];
+        }
+    }
+    return NULL;
+}
+
+static void inflight_cancel_locked(pub_inflight_t *slot)
+{
+    slot->used = false;
+    inflight_count--;
+}
+
+static bool inflight_send(pub_inflight_t *slot)
+{
+    // Publish without holding pub_mutex: esp-mqtt may dispatch events
+    // from its own task while this call holds the client lock
+    int msg_id = esp_mqtt_client_publish(client, slot->msg.topic,
+                                         (const char *)slot->msg.payload,
+                                         slot->msg.len, 1, 0);
+
+    xSemaphoreTake(pub_mutex, portMAX_DELAY);
+    if (msg_id < 0) {
+        // Keep the slot so the message goes out first once the link is back
+        slot->msg_id = PUB_MSG_ID_RETRY;
+        pub_stats.retried++;
+    } else {
+        slot->msg_id = msg_id;
+        if (early_ack_take_locked(msg_id)) {
+            inflight_release_locked(slot);
+        }
+    }
+    update_drained_locked();
+    xSemaphoreGive(pub_mutex);
+    return msg_id >= 0;
+}
+
+static bool send_retries(void)
+{
+    while (connected) {
+        xSemaphoreTake(pub_mutex, portMAX_DELAY);
+        pub_inflight_t *slot = NULL;
+        for (size_t i = 0; i < MQTT_PUB_MAX_INFLIGHT; i++) {
+            if (inflight[i].used && inflight[i].msg_id == PUB_MSG_ID_RETRY) {
+                slot = &inflight[i];
+                slot->msg_id = PUB_MSG_ID_SENDING;
+                break;
+            }
+        }
+        xSemaphoreGive(pub_mutex);
+        if (!slot) {
+            return true;
+        }
+        if (!inflight_send(slot)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+static void fill_window(void)
+{
+    // PUBACKs are matched in the event handler
+    while (connected) {
+        xSemaphoreTake(pub_mutex, portMAX_DELAY);
+        pub_inflight_t *slot = NULL;
+        bool from_flash = flash_ok && flash_head != flash_tail;
+        if (inflight_count < pub_config.max_inflight && (from_flash || ram_count > 0)) {
+            slot = inflight_reserve_locked();
+        }
+        if (slot && !from_flash) {
+            slot->msg = ram_queue[ram_head];
+            ram_head = (ram_head + 1) % MQTT_PUB_RAM_QUEUE_LEN;
+            ram_count--;
+        }
+        xSemaphoreGive(pub_mutex);
+        if (!slot) {
+            break;
+        }
+
+        // Flash holds the oldest messages, so it drains first
+        if (from_flash && !flash_pop(&slot->msg)) {
+            xSemaphoreTake(pub_mutex, portMAX_DELAY);
+            inflight_cancel_locked(slot);
+            update_drained_locked();
+            xSemaphoreGive(pub_mutex);
+            continue;
+        }
+        if (!inflight_send(slot)) {
+            break;
+        }
+    }
+}
+
+static void publisher_task(void *pvParameters)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (connected && send_retries()) {
+            fill_window();
+        }
+        // Whatever the window couldn't take moves to flash before RAM overflows
+        while (flash_spill_one()) {
+        }
+
+        xSemaphoreTake(pub_mutex, portMAX_DELAY);
+        update_drained_locked();
+        xSemaphoreGive(pub_mutex);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+esp_err_t mqtt_publisher_start(const mqtt_publisher_config_t *config)
+{
+    if (!config || !config->broker_uri) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (client) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    pub_config = *config;
+    if (pub_config.max_inflight == 0 || pub_config.max_inflight > MQTT_PUB_MAX_INFLIGHT) {
+        pub_config.max_inflight = MQTT_PUB_MAX_INFLIGHT;
+    }
+    if (pub_config.backoff_min_ms == 0) {
+        pub_config.backoff_min_ms = 1000;
+    }
+    if (pub_config.backoff_max_ms < pub_config.backoff_min_ms) {
+        pub_config.backoff_max_ms = pub_config.backoff_min_ms;
+    }
+    backoff_ms = pub_config.backoff_min_ms;
+
+    // Queues are large, prefer PSRAM
+    ram_queue = heap_caps_calloc(MQTT_PUB_RAM_QUEUE_LEN, sizeof(pub_msg_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ram_queue) {
+        ram_queue = calloc(MQTT_PUB_RAM_QUEUE_LEN, sizeof(pub_msg_t));
+    }
+    inflight = heap_caps_calloc(MQTT_PUB_MAX_INFLIGHT, sizeof(pub_inflight_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!inflight) {
+        inflight = calloc(MQTT_PUB_MAX_INFLIGHT, sizeof(pub_inflight_t));
+    }
+    pub_mutex = xSemaphoreCreateMutex();
+    pub_events = xEventGroupCreate();
+    if (!ram_queue || !inflight || !pub_mutex || !pub_events) {
+        ESP_LOGE(TAG, "Failed to allocate publisher state");
+        return ESP_ERR_NO_MEM;
+    }
+
+    flash_open();
+    update_drained_locked();
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = reconnect_timer_callback,
+        .name = "mqtt_reconnect",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &reconnect_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create reconnect timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    esp_mqtt_client_config_t mqtt_cfg = {
+        .broker.address.uri = pub_config.broker_uri,
+        .credentials.client_id = pub_config.client_id,
+        .credentials.username = pub_config.username,
+        .credentials.authentication.password = pub_config.password,
+        .session.keepalive = 30,
+        .session.message_retransmit_timeout = pub_config.ack_timeout_ms,
+        .network.disable_auto_reconnect = true,  // Backoff is driven by reconnect_timer
+        .network.timeout_ms = 5000,
+        .buffer.out_size = MQTT_PUB_MAX_PAYLOAD + MQTT_PUB_MAX_TOPIC + 16,
+    };
+    client = esp_mqtt_client_init(&mqtt_cfg);
+    if (!client) {
+        ESP_LOGE(TAG, "Failed to create MQTT client");
+        return ESP_FAIL;
+    }
+    esp_mqtt_client_register_event(client, MQTT_EVENT_ANY, mqtt_event_handler, NULL);
+
+    BaseType_t created = xTaskCreatePinnedToCore(
+        publisher_task,
+        "mqtt_pub",
+        4096,
+        NULL,
+        3,     // Above sensor sampling, below voice recognition
+        &pub_task_handle,
+        0      // Core 0
+    );
+    if (created != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create publisher task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ret = esp_mqtt_client_start(client);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start MQTT client: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "MQTT publisher started: %s, %zu in flight, %d RAM + %d flash queue slots",
+             pub_config.broker_uri, pub_config.max_inflight,
+             MQTT_PUB_RAM_QUEUE_LEN, MQTT_PUB_FLASH_QUEUE_LEN);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_publisher_publish(const char *topic, const void *data, size_t len)
+{
+    if (!topic || (!data && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strlen(topic) >= MQTT_PUB_MAX_TOPIC || len > MQTT_PUB_MAX_PAYLOAD) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!pub_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Copy straight into the tail slot rather than through a stack buffer.
+    // Spilling to flash happens on the publisher task from
+    // MQTT_PUB_SPILL_THRESHOLD on; the RAM ring only overwrites its oldest
+    // message if that task falls a whole headroom behind.
+    xSemaphoreTake(pub_mutex, portMAX_DELAY);
+    if (ram_count == MQTT_PUB_RAM_QUEUE_LEN) {
+        ram_head = (ram_head + 1) % MQTT_PUB_RAM_QUEUE_LEN;
+        ram_count--;
+        pub_stats.dropped++;
+    }
+    pub_msg_t *slot = &ram_queue[(ram_head + ram_count) % MQTT_PUB_RAM_QUEUE_LEN];
+    strcpy(slot->topic, topic);
+    memcpy(slot->payload, data, len);
+    slot->len = len;
+    ram_count++;
+    pub_stats.enqueued++;
+    update_drained_locked();
+    xSemaphoreGive(pub_mutex);
+
+    xTaskNotifyGive(pub_task_handle);
+    return ESP_OK;
+}
+
+bool mqtt_publisher_is_connected(void)
+{
+    return connected;
+}
+
+bool mqtt_publisher_wait_drained(uint32_t timeout_ms)
+{
+    if (!pub_events) {
+        return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(pub_events, PUB_DRAINED_BIT, pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(timeout_ms));
+    return (bits & PUB_DRAINED_BIT) != 0;
+}
+
+void mqtt_publisher_simulate_link_loss(void)
+{
+    if (!client) {
+        return;
+    }
+    ESP_LOGW(TAG, "Simulating link loss");
+    esp_mqtt_client_disconnect(client);
+    on_link_down();
+}
+
+void mqtt_publisher_get_stats(mqtt_publisher_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (!pub_mutex) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(pub_mutex, portMAX_DELAY);
+    *stats = pub_stats;
+    stats->connected = connected;
+    stats->ram_depth = ram_count;
+    stats->flash_depth = flash_ok ? flash_tail - flash_head : 0;
+    stats->inflight = inflight_count;
+    xSemaphoreGive(pub_mutex);
+}
@@ -0,0 +1,118 @@
+/**
+ * @file mqtt_publisher.h
+ * @brief QoS1 MQTT publisher with offline store-and-forward queue
+ *
+ * Publishing never blocks the caller: messages are copied into a bounded RAM
+ * queue and sent by a dedicated task with several QoS1 publishes in flight at
+ * once. When the RAM queue fills, the publisher task spills the oldest queued
+ * messages to NVS so they survive link loss (and reboots) and are sent first
+ * once the broker is reachable again. Unacknowledged publishes are resent by
+ * esp-mqtt's outbox, and again from here only if the outbox gives up on them.
+ * Reconnects use exponential backoff with jitter.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_PUB_MAX_TOPIC      64      // Including terminator
+#define MQTT_PUB_MAX_PAYLOAD    1024    // Largest message accepted by mqtt_publisher_publish
+#define MQTT_PUB_RAM_QUEUE_LEN  16      // Messages held in RAM
+#define MQTT_PUB_SPILL_THRESHOLD 12     // RAM depth at which the task starts spilling to flash
+#define MQTT_PUB_FLASH_QUEUE_LEN 64     // Messages held in NVS before the oldest are dropped
+#define MQTT_PUB_MAX_INFLIGHT   8       // QoS1 publishes awaiting PUBACK at once
+
+typedef struct {
+    const char *broker_uri;     // e.g. "mqtt://192.168.1.10:1883"
+    const char *client_id;      // NULL lets esp-mqtt derive one from the MAC
+    const char *username;       // Optional
+    const char *password;       // Optional
+    size_t max_inflight;        // 1..MQTT_PUB_MAX_INFLIGHT
+    uint32_t ack_timeout_ms;    // PUBACK wait before esp-mqtt retransmits a publish
+    uint32_t backoff_min_ms;    // First reconnect delay
+    uint32_t backoff_max_ms;    // Reconnect delay cap
+} mqtt_publisher_config_t;
+
+#define MQTT_PUBLISHER_DEFAULT_CONFIG() {       \
+    .broker_uri = NULL,                         \
+    .client_id = NULL,                          \
+    .username = NULL,                           \
+    .password = NULL,                           \
+    .max_inflight = MQTT_PUB_MAX_INFLIGHT,      \
+    .ack_timeout_ms = 10000,                    \
+    .backoff_min_ms = 1000,                     \
+    .backoff_max_ms = 60000,                    \
+}
+
+typedef struct {
+    bool connected;
+    uint32_t enqueued;          // Messages accepted by mqtt_publisher_publish
+    uint32_t acked;             // Messages confirmed by PUBACK
+    uint32_t retried;           // Publishes re-sent after a failed call or outbox expiry
+    uint32_t dropped;           // Messages lost to full queues or unreadable flash
+    uint32_t spilled;           // Messages written to flash
+    uint32_t reconnects;        // Successful connections after the first
+    uint32_t ram_depth;         // Messages currently queued in RAM
+    uint32_t flash_depth;       // Messages currently queued in flash
+    uint32_t inflight;          // Publishes awaiting PUBACK
+    uint32_t last_recovery_ms;  // Disconnect-to-connected time of the last outage
+} mqtt_publisher_stats_t;
+
+/**
+ * @brief Create the client and publisher task and start connecting
+ * @param config Publisher configuration (broker_uri is required)
+ * @return ESP_OK on success
+ */
+esp_err_t mqtt_publisher_start(const mqtt_publisher_config_t *config);
+
+/**
+ * @brief Queue a QoS1 message for publishing
+ *
+ * Copies the payload and returns immediately, whether or not the broker is
+ * currently reachable.
+ *
+ * @param topic Topic (shorter than MQTT_PUB_MAX_TOPIC)
+ * @param data Payload
+ * @param len Payload length (at most MQTT_PUB_MAX_PAYLOAD)
+ * @return ESP_OK if queued, ESP_ERR_INVALID_SIZE if too large,
+ *         ESP_ERR_INVALID_STATE before mqtt_publisher_start
+ */
+esp_err_t mqtt_publisher_publish(const char *topic, const void *data, size_t len);
+
+/**
+ * @brief Check whether the broker connection is up
+ * @return true if connected
+ */
+bool mqtt_publisher_is_connected(void);
+
+/**
+ * @brief Wait until every queued and in-flight message has been acknowledged
+ * @param timeout_ms Maximum time to wait
+ * @return true if the queue drained in time
+ */
+bool mqtt_publisher_wait_drained(uint32_t timeout_ms);
+
+/**
+ * @brief Drop the broker connection as if the link was lost
+ *
+ * Reconnection then follows the normal backoff path, which makes it possible
+ * to measure recovery time and store-and-forward behaviour.
+ */
+void mqtt_publisher_simulate_link_loss(void);
+
+/**
+ * @brief Get publisher counters
+ * @param stats Pointer to stats structure to fill
+ */
+void mqtt_publisher_get_stats(mqtt_publisher_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -25,6 +25,8 @@
 #include <time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_system.h"
@@ -41,6 +43,7 @@
 #include "mbedtls/base64.h"
 #include "cJSON.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 
 #include "led_strip.h"
 #include "bsp_board.h"
@@ -54,6 +57,37 @@
 // Web server for status reporting
 #include "web_server.h"
 
+// Batched sensor telemetry
+#include "telemetry.h"
+#include "task_stats.h"
+#include "event_bus.h"
+#include "metrics.h"
+#include "trace.h"
+#include "intent.h"
+#include "local_intents.h"
+#include "command_registry.h"
+#include "audio_capture.h"
+#include "detect_fsm.h"
+#include "action_executor.h"
+#include "audio_ctl.h"
+#include "led_engine.h"
+#include "led_faces.h"
+#include "boot_seq.h"
+#include "wifi_manager.h"
+#include "connectivity.h"
+#include "prewarm.h"
+#include "circuit_breaker.h"
+#include "latency_tracker.h"
+#include "http_json.h"
+#include "flac_encoder.h"
+#include <stdatomic.h>
+
+// MQTT publisher
+#include "mqtt_publisher.h"
+
+// Streaming JSON response parsing
+#include "json_reader.h"
+
 // ESP-SR includes for voice recognition
 // Note: esp_afe_config.h includes model_path.h which defines srmodel_list_t
 #include "esp_wn_iface.h"
@@ -100,11 +134,88 @@ typedef struct {
 } wav_fmt_t;
 
 // Background audio playback control (declared before functions that use them)
+// Pausing goes through audio_ctl; this only records whether it was ever started
 static volatile bool background_audio_enabled = true;
-static volatile bool background_audio_paused = false;
+
+// Voice path metrics, exported in Prometheus format at /metrics
+static struct {
+    metrics_metric_t *wake_words;
+    metrics_metric_t *command_timeouts;
+    metrics_metric_t *endpointed;
+    metrics_metric_t *wake_to_action_local;
+    metrics_metric_t *wake_to_action_cloud;
+    metrics_metric_t *stt_time;
+    metrics_metric_t *llm_time;
+    metrics_metric_t *tts_time;
+    metrics_metric_t *tts_first_audio;
+    metrics_metric_t *stt_errors;
+    metrics_metric_t *llm_errors;
+    metrics_metric_t *tts_errors;
+    metrics_metric_t *tts_hedges;
+    metrics_metric_t *tts_hedge_wins;
+    metrics_metric_t *llm_avoided;
+    metrics_metric_t *audio_write_time;
+    metrics_metric_t *audio_underruns;
+} voice_metrics;
+
+static int64_t wake_detected_us = 0;   // esp_timer time of the last wake word
+
+static void voice_metrics_init(void)
+{
+    voice_metrics.wake_words = metrics_counter("naphome_wake_word_total", NULL, "Wake words detected");
+    voice_metrics.command_timeouts = metrics_counter("naphome_command_timeout_total", NULL,
+                                                     "MultiNet timeouts after a wake word");
+    voice_metrics.endpointed = metrics_counter("naphome_endpoint_total", NULL,
+                                               "Utterances ended by trailing silence before the MultiNet timeout");
+    voice_metrics.wake_to_action_local = metrics_histogram("naphome_wake_to_action_seconds", "path=\"local\"",
+                                                           "Wake word to start of the resulting action");
+    voice_metrics.wake_to_action_cloud = metrics_histogram("naphome_wake_to_action_seconds", "path=\"cloud\"",
+                                                           "Wake word to start of the resulting action");
+    voice_metrics.stt_time = metrics_histogram("naphome_cloud_request_seconds", "api=\"stt\"", "Cloud API round trip");
+    voice_metrics.llm_time = metrics_histogram("naphome_cloud_request_seconds", "api=\"llm\"", "Cloud API round trip");
+    voice_metrics.tts_time = metrics_histogram("naphome_cloud_request_seconds", "api=\"tts\"", "Cloud API round trip");
+    voice_metrics.tts_first_audio = metrics_histogram("naphome_tts_first_audio_seconds", NULL,
+                                                      "TTS request start to first PCM chunk played");
+    voice_metrics.stt_errors = metrics_counter("naphome_cloud_errors_total", "api=\"stt\"", "Failed cloud API calls");
+    voice_metrics.llm_errors = metrics_counter("naphome_cloud_errors_total", "api=\"llm\"", "Failed cloud API calls");
+    voice_metrics.tts_errors = metrics_counter("naphome_cloud_errors_total", "api=\"tts\"", "Failed cloud API calls");
+    voice_metrics.tts_hedges = metrics_counter("naphome_tts_hedge_total", "result=\"sent\"",
+                                               "TTS requests sent again on a new connection after the p95");
+    voice_metrics.tts_hedge_wins = metrics_counter("naphome_tts_hedge_total", "result=\"won\"",
+                                                   "TTS requests sent again on a new connection after the p95");
+    voice_metrics.llm_avoided = metrics_counter("naphome_llm_avoided_total", NULL,
+                                                "STT transcripts answered by a local intent instead of the LLM");
+    voice_metrics.audio_write_time = metrics_histogram("naphome_audio_write_seconds", NULL,
+                                                       "Time blocked in bsp_audio_play per chunk");
+    voice_metrics.audio_underruns = metrics_counter("naphome_audio_underruns_total", NULL,
+                                                    "Chunks that arrived after queued audio ran out");
+}
+
+// Gaps longer than this between writes are a new stream, not an underrun
+#define AUDIO_UNDERRUN_MAX_GAP_US 250000
+
+// bsp_audio_play for mono 16-bit PCM with write-time and underrun accounting.
+// An underrun is a write that arrives after all previously written audio
+// should already have finished playing.
+static esp_err_t audio_play(const int16_t *data, size_t len, uint32_t sample_rate)
+{
+    static int64_t queued_until_us = 0;
+    int64_t start = esp_timer_get_time();
+    if (queued_until_us > 0 && start > queued_until_us && start - queued_until_us < AUDIO_UNDERRUN_MAX_GAP_US) {
+        metrics_inc(voice_metrics.audio_underruns);
+    }
+    esp_err_t ret = bsp_audio_play(data, len, portMAX_DELAY);
+    metrics_observe_since(voice_metrics.audio_write_time, start);
+    trace_span_since(trace_current(), "audio_play", start);
+    if (sample_rate > 0) {
+        int64_t duration_us = (int64_t)len * 1000000 / (sample_rate * sizeof(int16_t));
+        queued_until_us = (queued_until_us > start ? queued_until_us : start) + duration_us;
+    }
+    return ret;
+}
 
 // Function to parse and play WAV file
-static esp_err_t play_wav_file(const uint8_t *wav_data, size_t wav_len)
+static esp_err_t play_wav_file(const uint8_t *wav_data, size_t wav_len, uint32_t pause_reasons)
 {
     if (!wav_data || wav_len < sizeof(wav_header_t)) {
         ESP_LOGE(TAG, "Invalid WAV data");
@@ -194,8 +305,8 @@ static esp_err_t play_wav_file(const uint8_t *wav_data, size_t wav_len)
     // If WAV is 44.1kHz and codec is 48kHz, audio will play at wrong pitch (high)
     // Always reconfigure to match WAV file's sample rate when ESP-SR is not active
     // CRITICAL: Don't reconfigure if ESP-SR is active (shared I2C bus conflict)
-    // background_audio_paused == true means ESP-SR is listening
-    if (background_audio_paused) {
+    // A listening pause means ESP-SR is matching a command
+    if (audio_ctl_paused(AUDIO_CTL_PAUSE_LISTENING)) {
         ESP_LOGW(TAG, "Skipping codec reconfiguration (ESP-SR active) - WAV pitch may be incorrect");
     } else {
         ESP_LOGI(TAG, "Reconfiguring audio hardware to %u Hz for WAV playback (ensuring correct pitch)", fmt.sample_rate);
@@ -235,34 +346,12 @@ static esp_err_t play_wav_file(const uint8_t *wav_data, size_t wav_len)
     size_t playback_samples = mono_samples;
     bool needs_free_mono = (mono_buffer != NULL);
     
-    // Play audio data in chunks
-    const size_t chunk_size = 2048; // bytes per chunk (larger for 48kHz)
-    const int16_t *audio_data = playback_buffer;
-    size_t samples_remaining = playback_samples;
-    
-    while (samples_remaining > 0) {
-        // Check if background audio should pause (wake word detected)
-        if (background_audio_paused) {
-            // If paused, skip this chunk and check again
-            vTaskDelay(pdMS_TO_TICKS(50));
-            continue;
-        }
-        
-        size_t samples_to_play = (samples_remaining > chunk_size / sizeof(int16_t)) 
-                                 ? chunk_size / sizeof(int16_t) 
-                                 : samples_remaining;
-        size_t bytes_to_play = samples_to_play * sizeof(int16_t);
-        
-        esp_err_t ret = bsp_audio_play(audio_data, bytes_to_play, portMAX_DELAY);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to play audio chunk: %s", esp_err_to_name(ret));
-            if (needs_free_mono && mono_buffer) free(mono_buffer);
-            return ret;
-        }
-        
-        audio_data += samples_to_play;
-        samples_remaining -= samples_to_play;
-        vTaskDelay(pdMS_TO_TICKS(5)); // Small delay between chunks
+    // Play in short slices, blocking while background audio is paused (wake word detected)
+    esp_err_t ret = audio_ctl_play(playback_buffer, playback_samples, fmt.sample_rate, pause_reasons, audio_play);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to play audio chunk: %s", esp_err_to_name(ret));
+        if (needs_free_mono && mono_buffer) free(mono_buffer);
+        return ret;
     }
     
     // Free buffers
@@ -277,7 +366,7 @@ static esp_err_t play_wav_file(const uint8_t *wav_data, size_t wav_len)
 static mp3dec_t mp3d_static;
 static bool mp3d_initialized = false;
 
-static esp_err_t play_mp3_file(const uint8_t *mp3_data, size_t mp3_len)
+static esp_err_t play_mp3_file(const uint8_t *mp3_data, size_t mp3_len, uint32_t pause_reasons)
 {
     if (!mp3_data || mp3_len == 0) {
         ESP_LOGE(TAG, "Invalid MP3 data");
@@ -341,12 +430,6 @@ static esp_err_t play_mp3_file(const uint8_t *mp3_data, size_t mp3_len)
     
     // Decode MP3 frames
     while (mp3_ptr < mp3_end) {
-        // Check if background audio should pause
-        if (background_audio_paused) {
-            vTaskDelay(pdMS_TO_TICKS(50));
-            continue;
-        }
-        
         // Validate pointer before decoding
         if (mp3_ptr >= mp3_end || (mp3_end - mp3_ptr) < 4) {
             break;  // Not enough data remaining
@@ -427,10 +510,8 @@ static esp_err_t play_mp3_file(const uint8_t *mp3_data, size_t mp3_len)
             }
             
             // Play decoded PCM directly at the file's sample rate (no resampling)
-            // Add small delay between chunks to prevent overwhelming the audio system
-            size_t bytes_to_play = mono_samples * sizeof(int16_t);
-            
-            esp_err_t ret = bsp_audio_play(mono_buffer, bytes_to_play, portMAX_DELAY);
+            // Blocks while background audio is paused
+            esp_err_t ret = audio_ctl_play(mono_buffer, mono_samples, info.hz, pause_reasons, audio_play);
             if (ret != ESP_OK) {
                 ESP_LOGW(TAG, "Failed to play PCM chunk: %s", esp_err_to_name(ret));
                 // Continue decoding even if playback fails
@@ -507,21 +588,24 @@ static esp_err_t play_mp3_file(const uint8_t *mp3_data, size_t mp3_len)
 // Forward declarations
 static void background_audio_task(void *pvParameters);
 static void speak_text(const char *text);
+static esp_err_t google_tts_speak(const char *text);
 static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data);
 static esp_err_t check_i2c_available(void);
 static bool is_network_ready(void);
+static esp_err_t generate_and_play_test_tone(int frequency_hz, int duration_ms, int sample_rate);
 
 // Speech command handler - processes voice commands
 bool speech_commands_action_with_string(int command_id, const char *command_string);
+static bool speech_commands_action_with_transcript(const char *transcript);
+
+// How long the welcome sound waits for an IP before skipping the announcement
+#define BG_AUDIO_NETWORK_WAIT_MS 8000
 
 // Background audio playback task - plays WAV once, then MP3 in loop during idle
 static void background_audio_task(void *pvParameters)
 {
     ESP_LOGI(TAG, "Background audio task started");
     
-    // Wait for audio system to be ready
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    
     const uint8_t *welcome_wav = _binary_offline_welcome_wav_start;
     size_t welcome_wav_size = _binary_offline_welcome_wav_end - _binary_offline_welcome_wav_start;
     
@@ -532,24 +616,19 @@ static void background_audio_task(void *pvParameters)
     if (welcome_wav_size > 0) {
         ESP_LOGI(TAG, "Playing welcome WAV file once (%zu bytes)", welcome_wav_size);
         
-        // Wait a bit for system to stabilize
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        
-        // Announce connection to Google Gemini before playing WAV (only if network is ready)
-        // Wait a bit more for network to be fully ready
-        vTaskDelay(pdMS_TO_TICKS(3000));  // Give network more time to stabilize
-        if (is_network_ready()) {
+        // Announce connection to Google Gemini before playing WAV (only if network is ready).
+        // The codec is up (this task is started by the bg_audio boot step); wait for an IP
+        // rather than a fixed delay, and speak inline so the WAV follows the announcement.
+        if (boot_seq_wait_ready(BOOT_READY_NETWORK, BG_AUDIO_NETWORK_WAIT_MS)) {
             ESP_LOGI(TAG, "Announcing Gemini connection before WAV playback...");
-            speak_text("Connected to Google Gemini");
-            // Wait for TTS to complete before playing WAV
-            vTaskDelay(pdMS_TO_TICKS(3000));  // Give TTS time to complete
+            google_tts_speak("Connected to Google Gemini");
         } else {
             ESP_LOGI(TAG, "Network not ready, skipping Gemini announcement");
         }
         
         // Check if paused before playing
-        if (!background_audio_paused) {
-            esp_err_t ret = play_wav_file(welcome_wav, welcome_wav_size);
+        if (!audio_ctl_paused(AUDIO_CTL_PAUSE_ALL)) {
+            esp_err_t ret = play_wav_file(welcome_wav, welcome_wav_size, AUDIO_CTL_PAUSE_ALL);
             if (ret == ESP_OK) {
                 ESP_LOGI(TAG, "Welcome WAV playback complete");
             } else {
@@ -577,9 +656,9 @@ static void background_audio_task(void *pvParameters)
     vTaskDelay(pdMS_TO_TICKS(1000));
     
     // Check if paused before playing
-    if (!background_audio_paused) {
+    if (!audio_ctl_paused(AUDIO_CTL_PAUSE_ALL)) {
         ESP_LOGI(TAG, "Playing MP3 file...");
-        esp_err_t ret = play_mp3_file(mp3_data, mp3_size);
+        esp_err_t ret = play_mp3_file(mp3_data, mp3_size, AUDIO_CTL_PAUSE_ALL);
         
         if (ret == ESP_OK) {
             ESP_LOGI(TAG, "MP3 playback complete");
@@ -605,26 +684,10 @@ const void *regdomain_table __attribute__((weak)) = NULL;
 const void *regulatory_data __attribute__((weak)) = NULL;
 
 // LED control
-#define MAX_LEDS 12
+#define MAX_LEDS FACE_LED_COUNT
 #define LED_STRIP_GPIO 19
 led_strip_handle_t strip = NULL;
 
-// LED assignments for face pattern
-#define LED_RIGHT_EYE   2   // Right eye (LED 2)
-#define LED_LEFT_EYE    11  // Left eye (LED 11)
-#define LED_EAR_LEFT    4   // Left ear
-#define LED_EAR_RIGHT   9   // Right ear
-#define LED_SMILE_START 5   // Smile start
-#define LED_SMILE_END   8   // Smile end (inclusive)
-
-// LED state
-typedef enum {
-    LED_STATE_IDLE = 0,
-    LED_STATE_WAKE_WORD,
-    LED_STATE_COMMAND,
-    LED_STATE_TEST_STATUS
-} led_state_t;
-
 // System status tracking for LED face
 typedef struct {
     bool is_alive;              // System is running
@@ -634,8 +697,6 @@ typedef struct {
     TickType_t last_activity;   // Last activity timestamp
 } system_status_t;
 
-static led_state_t current_led_state = LED_STATE_IDLE;
-static bool eyes_looking_left = true;  // For idle animation
 static system_status_t system_status = {
     .is_alive = true,
     .is_listening = true,
@@ -647,8 +708,7 @@ static system_status_t system_status = {
 // ESP-SR voice recognition
 static const esp_afe_sr_iface_t *afe_handle = NULL;
 static volatile int task_flag = 0;
-static volatile int wakeup_flag = 0;
-volatile bool test_suite_triggered = false;  // Made non-static for web server access
+atomic_bool test_suite_triggered = false;  // Made non-static for web server access; claim with atomic_exchange
 srmodel_list_t *models = NULL;
 
 // I2C port for sensors (using old I2C API to match board initialization)
@@ -667,25 +727,51 @@ typedef enum {
 #define GOOGLE_STT_API_KEY GOOGLE_TTS_API_KEY  // Same key works for STT too
 #define GEMINI_API_KEY GOOGLE_TTS_API_KEY  // Same key works for both
 #define GEMINI_MODEL "gemini-2.0-flash-exp"
-#define GOOGLE_TTS_URL "https://texttospeech.googleapis.com/v1/text:synthesize?key=" GOOGLE_TTS_API_KEY
-#define GOOGLE_STT_URL "https://speech.googleapis.com/v1/speech:recognize?key=" GOOGLE_STT_API_KEY
-#define GEMINI_LLM_URL "https://generativelanguage.googleapis.com/v1beta/models/%s:generateContent?key=%s"
-
-// LED mutex for thread-safe operations
-static SemaphoreHandle_t led_mutex = NULL;
+// Point the hosts at cloud_standin.py to test against a local server
+#define GOOGLE_TTS_HOST "https://texttospeech.googleapis.com"
+#define GOOGLE_STT_HOST "https://speech.googleapis.com"
+#define GEMINI_LLM_HOST "https://generativelanguage.googleapis.com"
+#define GOOGLE_TTS_URL GOOGLE_TTS_HOST "/v1/text:synthesize?key=" GOOGLE_TTS_API_KEY
+#define GOOGLE_STT_URL GOOGLE_STT_HOST "/v1/speech:recognize?key=" GOOGLE_STT_API_KEY
+#define GEMINI_LLM_URL GEMINI_LLM_HOST "/v1beta/models/%s:generateContent?key=%s"
+#define CLOUD_PROBE_TIMEOUT_MS 3000  // Circuit breaker health check (HEAD to the API host)
+// Upper bounds: the timeouts actually used adapt to each API's observed latency
+#define STT_TIMEOUT_MS 15000
+#define LLM_TIMEOUT_MS 30000
+#define TTS_TIMEOUT_MS 15000
+
+// One circuit breaker per cloud API (NULL before boot_wifi: every call allowed)
+static struct {
+    breaker_t *stt;
+    breaker_t *llm;
+    breaker_t *tts;
+} cloud_breakers;
+
+// Response latency per cloud API: adaptive timeouts and the TTS hedge delay
+static struct {
+    latency_tracker_t *stt;
+    latency_tracker_t *llm;
+    latency_tracker_t *tts;
+} cloud_latency;
+
+// MQTT broker, set with idf.py menuconfig (Naphome -> MQTT broker URI)
+#define MQTT_BROKER_URI CONFIG_NAPHOME_MQTT_BROKER_URI
+#define MQTT_TELEMETRY_TOPIC "naphome/telemetry"
+#define MQTT_TEST_TOPIC "naphome/test"
+
+// Only the LED engine's render task writes the strip
+static void led_push_frame(void *ctx, const led_rgb_t *frame, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        // Note: LED_PIXEL_FORMAT_GRB means order is Green, Red, Blue
+        led_strip_set_pixel(strip, i, frame[i].g, frame[i].r, frame[i].b);
+    }
+    led_strip_refresh(strip);
+}
 
 // LED control functions
 static void led_init(void)
 {
-    // Create mutex for LED operations
-    if (led_mutex == NULL) {
-        led_mutex = xSemaphoreCreateMutex();
-        if (led_mutex == NULL) {
-            ESP_LOGE(TAG, "Failed to create LED mutex");
-            return;
-        }
-    }
-    
     led_strip_config_t led_config = {
         .strip_gpio_num = LED_STRIP_GPIO,
         .max_leds = MAX_LEDS,
@@ -700,155 +786,65 @@ static void led_init(void)
     if (ret != ESP_OK || !strip) {
         ESP_LOGE(TAG, "Failed to install WS2812 driver: %s", esp_err_to_name(ret));
         strip = NULL;
-    } else {
-        ESP_LOGI(TAG, "LED strip initialized on GPIO %d", LED_STRIP_GPIO);
-        led_strip_clear(strip);
-        led_strip_refresh(strip);
+        return;
     }
-}
-
-// Clear all LEDs
-static void led_clear_all(void)
-{
-    if (!strip) return;
-    led_strip_clear(strip);
-    led_strip_refresh(strip);
-}
-
-// Set a single LED with RGB color (GRB format for WS2812)
-static void led_set_pixel(uint32_t index, uint8_t r, uint8_t g, uint8_t b)
-{
-    if (!strip || index >= MAX_LEDS) return;
-    // Note: LED_PIXEL_FORMAT_GRB means order is Green, Red, Blue
-    led_strip_set_pixel(strip, index, g, r, b);
-}
-
-// Idle animation: eyes look left then right with smooth transitions (green eyes)
-static void led_idle_animation(void)
-{
-    if (!strip || current_led_state != LED_STATE_IDLE) return;
-    
-    led_clear_all();
-    
-    // Both eyes visible but one brighter to show direction - blue/green (cyan)
-    if (eyes_looking_left) {
-        // Look left: left eye bright, right eye dim
-        led_set_pixel(LED_LEFT_EYE, 0, 255, 255);   // Bright cyan for left eye (LED 11)
-        led_set_pixel(LED_RIGHT_EYE, 0, 100, 100);  // Dim cyan for right eye (LED 2)
-    } else {
-        // Look right: right eye bright, left eye dim
-        led_set_pixel(LED_RIGHT_EYE, 0, 255, 255);   // Bright cyan for right eye (LED 2)
-        led_set_pixel(LED_LEFT_EYE, 0, 100, 100);     // Dim cyan for left eye (LED 11)
+    ESP_LOGI(TAG, "LED strip initialized on GPIO %d", LED_STRIP_GPIO);
+    ret = led_engine_init(MAX_LEDS, led_push_frame, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start LED engine: %s", esp_err_to_name(ret));
     }
-    
-    led_strip_refresh(strip);
-    eyes_looking_left = !eyes_looking_left;  // Toggle for next cycle
 }
 
 // Wake word detected: illuminate ears with pulsing effect
 static void led_wake_word_detected(void)
 {
     if (!strip) return;
-    
-    if (xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        current_led_state = LED_STATE_WAKE_WORD;
-        system_status.is_recognizing = true;
-        system_status.last_activity = xTaskGetTickCount();
-        
-        // Keep eyes visible, add ears
-        led_clear_all();
-        
-        // Illuminate ears (LEDs 4, 9) - bright orange/yellow
-        led_set_pixel(LED_EAR_LEFT, 255, 150, 0);   // Bright orange-yellow
-        led_set_pixel(LED_EAR_RIGHT, 255, 150, 0);
-        
-        // Keep eyes visible - bright blue/green (cyan)
-        led_set_pixel(LED_LEFT_EYE, 0, 255, 255);   // Bright cyan (LED 11)
-        led_set_pixel(LED_RIGHT_EYE, 0, 255, 255);  // Bright cyan (LED 2)
-        
-        led_strip_refresh(strip);
-        xSemaphoreGive(led_mutex);
-        ESP_LOGI(TAG, "Wake word detected - ears illuminated");
-    }
+    system_status.is_recognizing = true;
+    system_status.last_activity = xTaskGetTickCount();
+    led_engine_play(LED_LAYER_LISTEN, &led_face_listen);
+    ESP_LOGI(TAG, "Wake word detected - ears illuminated");
 }
 
-// Command understood: show smile with eyes
+// Command understood: show smile with eyes; the engine returns to the
+// layers below after two seconds
 static void led_command_understood(void)
 {
     if (!strip) return;
-    
-    if (xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        current_led_state = LED_STATE_COMMAND;
-        system_status.is_processing = true;
-        system_status.last_activity = xTaskGetTickCount();
-        
-        // Clear and show happy face: eyes + smile
-        led_clear_all();
-        
-        // Bright eyes (both looking forward) - blue/green (cyan)
-        led_set_pixel(LED_LEFT_EYE, 0, 255, 255);   // Bright cyan (LED 11)
-        led_set_pixel(LED_RIGHT_EYE, 0, 255, 255);  // Bright cyan (LED 2)
-        
-        // Show smile (LEDs 5-8) - bright green
-        for (int i = LED_SMILE_START; i <= LED_SMILE_END; i++) {
-            led_set_pixel(i, 0, 255, 0);  // Bright green smile
-        }
-        
-        led_strip_refresh(strip);
-        xSemaphoreGive(led_mutex);
-        ESP_LOGI(TAG, "Command understood - smile shown");
-        
-        // Return to idle after a delay (handled by animation task)
-        vTaskDelay(pdMS_TO_TICKS(2000));
-        
-        if (xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            current_led_state = LED_STATE_IDLE;
-            system_status.is_recognizing = false;
-            system_status.is_processing = false;
-            xSemaphoreGive(led_mutex);
-        }
-    }
+    system_status.is_processing = true;
+    system_status.last_activity = xTaskGetTickCount();
+    led_engine_play(LED_LAYER_SMILE, &led_face_smile);
+    ESP_LOGI(TAG, "Command understood - smile shown");
 }
 
 static void led_set_status(test_status_t status)
 {
     if (!strip) return;
-    current_led_state = LED_STATE_TEST_STATUS;
     
-    uint8_t r = 0, g = 0, b = 0;
+    led_rgb_t color = { 0, 0, 0 };
     
     switch (status) {
         case TEST_STATUS_PASS:
-            g = 255;  // Green
+            color.g = 255;  // Green
             break;
         case TEST_STATUS_WARNING:
-            r = 255;  // Yellow (red + green)
-            g = 255;
+            color.r = 255;  // Yellow (red + green)
+            color.g = 255;
             break;
         case TEST_STATUS_FAIL:
         case TEST_STATUS_NOT_IMPLEMENTED:
-            r = 255;  // Red
+            color.r = 255;  // Red
             break;
     }
     
-    // Set all LEDs for test status
-    for (uint32_t i = 0; i < MAX_LEDS; i++) {
-        led_strip_set_pixel(strip, i, g, r, b);
-    }
-    led_strip_refresh(strip);
-    ESP_LOGI(TAG, "LED status: %d (R:%d G:%d B:%d)", status, r, g, b);
-    
-    // Return to idle after showing status
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    current_led_state = LED_STATE_IDLE;
+    // All LEDs for one second, then back to idle
+    led_engine_fill(LED_LAYER_STATUS, color, 1000);
+    ESP_LOGI(TAG, "LED status: %d (R:%d G:%d B:%d)", status, color.r, color.g, color.b);
 }
 
-// LED animation task - monitors system status and updates LED face accordingly
+// LED status task - monitors system status and picks the idle face
 static void led_animation_task(void *arg)
 {
-    const TickType_t update_interval = pdMS_TO_TICKS(100);  // Update every 100ms for responsive status
-    const TickType_t idle_animation_interval = pdMS_TO_TICKS(1500);  // 1.5s for eye movement
-    TickType_t last_idle_animation = 0;
+    const TickType_t update_interval = pdMS_TO_TICKS(500);
     TickType_t last_heartbeat = 0;
     
     ESP_LOGI(TAG, "LED status monitoring task started");
@@ -856,69 +852,146 @@ static void led_animation_task(void *arg)
     while (1) {
         TickType_t now = xTaskGetTickCount();
         
-        // Take mutex for thread-safe LED operations
-        if (xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            // Update system status: check if system is alive (heartbeat)
-            if (now - last_heartbeat > pdMS_TO_TICKS(5000)) {
-                // Heartbeat check: if no activity for 5 seconds, mark as not listening
-                if (system_status.last_activity > 0 && 
-                    (now - system_status.last_activity) > pdMS_TO_TICKS(10000)) {
-                    // No activity for 10 seconds - might be stuck, but still alive
-                    system_status.is_listening = false;
-                } else {
-                    system_status.is_listening = true;
-                }
-                last_heartbeat = now;
-            }
-            
-            // Update LED face based on current state and system status
-            if (current_led_state == LED_STATE_IDLE) {
-                // Idle state: show listening status with eye animation
-                if (system_status.is_listening && system_status.is_alive) {
-                    // System is alive and listening - normal idle animation
-                    if (now - last_idle_animation >= idle_animation_interval) {
-                        led_idle_animation();
-                        last_idle_animation = now;
-                    }
-                } else if (!system_status.is_alive) {
-                    // System not alive - dim red pulse
-                    led_clear_all();
-                    uint8_t pulse = (now / pdMS_TO_TICKS(500)) % 2 ? 50 : 10;
-                    for (uint32_t i = 0; i < MAX_LEDS; i++) {
-                        led_set_pixel(i, pulse, 0, 0);  // Dim red
-                    }
-                    led_strip_refresh(strip);
-                } else {
-                    // Not listening but alive - dim cyan eyes (sleeping)
-                    led_clear_all();
-                    led_set_pixel(LED_LEFT_EYE, 0, 20, 20);   // Very dim cyan
-                    led_set_pixel(LED_RIGHT_EYE, 0, 20, 20);
-                    led_strip_refresh(strip);
-                }
-            } else if (current_led_state == LED_STATE_WAKE_WORD) {
-                // Wake word detected - ensure ears are lit (already handled by led_wake_word_detected)
-                // Just refresh to maintain state
-                if (system_status.is_recognizing) {
-                    // Pulsing effect while recognizing
-                    uint8_t pulse = 150 + (105 * ((now / pdMS_TO_TICKS(200)) % 2));
-                    led_set_pixel(LED_EAR_LEFT, pulse, 150, 0);
-                    led_set_pixel(LED_EAR_RIGHT, pulse, 150, 0);
-                    led_strip_refresh(strip);
-                }
-            } else if (current_led_state == LED_STATE_COMMAND) {
-                // Command understood - smile is shown (already handled by led_command_understood)
-                // Just maintain the state
-            } else if (current_led_state == LED_STATE_TEST_STATUS) {
-                // Test status - already set by led_set_status, just maintain
+        // Update system status: check if system is alive (heartbeat)
+        if (now - last_heartbeat > pdMS_TO_TICKS(5000)) {
+            // Heartbeat check: if no activity for 5 seconds, mark as not listening
+            if (system_status.last_activity > 0 && 
+                (now - system_status.last_activity) > pdMS_TO_TICKS(10000)) {
+                // No activity for 10 seconds - might be stuck, but still alive
+                system_status.is_listening = false;
+            } else {
+                system_status.is_listening = true;
             }
-            
-            xSemaphoreGive(led_mutex);
+            last_heartbeat = now;
+        }
+        
+        // Idle layer: eye animation while listening, dim eyes (sleeping)
+        // when alive but not listening, dim red pulse when not alive
+        const led_timeline_t *idle = &led_face_idle;
+        if (!system_status.is_alive) {
+            idle = &led_face_dead;
+        } else if (!system_status.is_listening) {
+            idle = &led_face_sleeping;
+        }
+        if (led_engine_playing(LED_LAYER_IDLE) != idle) {
+            led_engine_play(LED_LAYER_IDLE, idle);
         }
         
         vTaskDelay(update_interval);
     }
 }
 
+// Collects one extracted JSON string into a fixed buffer (truncating)
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+    bool found;
+} json_text_t;
+
+static void json_text_cb(int path, const char *data, size_t len, bool done, void *ctx)
+{
+    json_text_t *text = (json_text_t *)ctx;
+    size_t room = text->cap - 1 - text->len;
+    size_t n = len < room ? len : room;
+    memcpy(text->buf + text->len, data, n);
+    text->len += n;
+    text->buf[text->len] = '\0';
+    if (done) {
+        text->found = true;
+    }
+}
+
+// A response with any status means the API is up; only transport failures
+// (-1) and server errors count against its circuit breaker
+static void cloud_breaker_record(breaker_t *breaker, int status_code)
+{
+    breaker_record(breaker, status_code > 0 && status_code < 500);
+}
+
+// Circuit breaker health probe: HEAD to the API host, answered with any status
+static bool cloud_probe(void *ctx)
+{
+    esp_http_client_config_t config = {
+        .url = (const char *)ctx,
+        .method = HTTP_METHOD_HEAD,
+        .timeout_ms = CLOUD_PROBE_TIMEOUT_MS,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) {
+        return false;
+    }
+    esp_err_t err = esp_http_client_perform(client);
+    esp_http_client_cleanup(client);
+    return err == ESP_OK;
+}
+
+static esp_err_t cloud_breakers_init(void)
+{
+    esp_err_t ret = breaker_init();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    breaker_config_t config = BREAKER_DEFAULT_CONFIG();
+    config.probe = cloud_probe;
+
+    config.name = "stt";
+    config.labels = "api=\"stt\"";
+    config.probe_ctx = (void *)(GOOGLE_STT_HOST "/");
+    cloud_breakers.stt = breaker_create(&config);
+
+    config.name = "llm";
+    config.labels = "api=\"llm\"";
+    config.probe_ctx = (void *)(GEMINI_LLM_HOST "/");
+    cloud_breakers.llm = breaker_create(&config);
+
+    config.name = "tts";
+    config.labels = "api=\"tts\"";
+    config.probe_ctx = (void *)(GOOGLE_TTS_HOST "/");
+    cloud_breakers.tts = breaker_create(&config);
+    return ESP_OK;
+}
+
+static void cloud_latency_init(void)
+{
+    cloud_latency.stt = latency_tracker_create("stt", "api=\"stt\"");
+    cloud_latency.llm = latency_tracker_create("llm", "api=\"llm\"");
+    cloud_latency.tts = latency_tracker_create("tts", "api=\"tts\"");
+}
+
+// Prewarm targets worth connecting to: not those whose circuit is open
+static uint32_t cloud_prewarm_targets(void)
+{
+    uint32_t targets = 0;
+    if (breaker_state(cloud_breakers.stt) != BREAKER_OPEN) {
+        targets |= PREWARM_BIT(PREWARM_STT);
+    }
+    if (breaker_state(cloud_breakers.llm) != BREAKER_OPEN) {
+        targets |= PREWARM_BIT(PREWARM_LLM);
+    }
+    if (breaker_state(cloud_breakers.tts) != BREAKER_OPEN) {
+        targets |= PREWARM_BIT(PREWARM_TTS);
+    }
+    return targets;
+}
+
+// Client for a cloud request: the connection prewarm opened at the wake word
+// when there is one, otherwise a new client. *warm is passed on to
+// http_post_json_streamed, which retries if that connection went stale.
+static esp_http_client_handle_t cloud_client_init(prewarm_target_t target, const esp_http_client_config_t *config,
+                                                  bool *warm)
+{
+    esp_http_client_handle_t client = prewarm_take(target);
+    *warm = (client != NULL);
+    if (!client) {
+        return esp_http_client_init(config);
+    }
+    esp_http_client_set_url(client, config->url);  // Same host: the connection stays open
+    esp_http_client_set_method(client, config->method);
+    esp_http_client_set_timeout_ms(client, config->timeout_ms);
+    return client;
+}
+
 // Gemini LLM function - simple implementation
 static esp_err_t gemini_llm_call(const char *prompt, char *response, size_t response_len)
 {
@@ -932,12 +1005,17 @@ static esp_err_t gemini_llm_call(const char *prompt, char *response, size_t resp
     }
     
     // Verify network is ready
-    wifi_ap_record_t ap_info;
-    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+    if (!is_network_ready()) {
         ESP_LOGW(TAG, "WiFi not connected, skipping LLM call");
         return ESP_ERR_NOT_FINISHED;
     }
     
+    // Known down: fail now instead of waiting out the timeout
+    if (!breaker_allow(cloud_breakers.llm)) {
+        ESP_LOGW(TAG, "Gemini unavailable (circuit open), skipping LLM call");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
     // Build JSON request for Gemini API
     cJSON *root = cJSON_CreateObject();
     cJSON *contents = cJSON_CreateArray();
@@ -965,10 +1043,11 @@ static esp_err_t gemini_llm_call(const char *prompt, char *response, size_t resp
     esp_http_client_config_t config = {
         .url = url,
         .method = HTTP_METHOD_POST,
-        .timeout_ms = 30000,
+        .timeout_ms = latency_timeout_ms(cloud_latency.llm, LLM_TIMEOUT_MS),
     };
     
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+    bool warm;
+    esp_http_client_handle_t client = cloud_client_init(PREWARM_LLM, &config, &warm);
     if (!client) {
         ESP_LOGE(TAG, "Failed to initialize HTTP client");
         free(payload);
@@ -976,132 +1055,124 @@ static esp_err_t gemini_llm_call(const char *prompt, char *response, size_t resp
     }
     
     esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, payload, strlen(payload));
     
-    esp_err_t err = esp_http_client_perform(client);
+    // Only candidates[0].content.parts[0].text is needed, extract it while streaming
+    static const char *const paths[] = {"candidates[0].content.parts[0].text"};
+    json_text_t text = {.buf = response, .cap = response_len};
+    response[0] = '\0';
+    json_reader_t reader;
+    json_reader_init(&reader, paths, 1, json_text_cb, &text);
+    
+    int status_code = http_post_json_streamed(&client, payload, strlen(payload), &reader, warm,
+                                              cloud_latency.llm, NULL);
     free(payload);
+    esp_http_client_cleanup(client);
+    cloud_breaker_record(cloud_breakers.llm, status_code);
     
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-        int content_length = esp_http_client_get_content_length(client);
-        
-        if (status_code == 200 && content_length > 0) {
-            char *buffer = malloc(content_length + 1);
-            if (buffer) {
-                int data_read = esp_http_client_read_response(client, buffer, content_length);
-                if (data_read > 0) {
-                    buffer[data_read] = '\0';
-                    
-                    // Parse JSON response
-                    cJSON *response_json = cJSON_Parse(buffer);
-                    if (response_json) {
-                        cJSON *candidates = cJSON_GetObjectItem(response_json, "candidates");
-                        if (candidates && cJSON_IsArray(candidates) && cJSON_GetArraySize(candidates) > 0) {
-                            cJSON *candidate = cJSON_GetArrayItem(candidates, 0);
-                            if (candidate) {
-                                cJSON *content_obj = cJSON_GetObjectItem(candidate, "content");
-                                if (content_obj) {
-                                    cJSON *parts = cJSON_GetObjectItem(content_obj, "parts");
-                                    if (parts && cJSON_IsArray(parts) && cJSON_GetArraySize(parts) > 0) {
-                                        cJSON *part = cJSON_GetArrayItem(parts, 0);
-                                        if (part) {
-                                            cJSON *text = cJSON_GetObjectItem(part, "text");
-                                            if (text && cJSON_IsString(text)) {
-                                                strncpy(response, text->valuestring, response_len - 1);
-                                                response[response_len - 1] = '\0';
-                                                cJSON_Delete(response_json);
-                                                free(buffer);
-                                                esp_http_client_cleanup(client);
-                                                ESP_LOGI(TAG, "Gemini LLM response: %s", response);
-                                                return ESP_OK;
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                        cJSON_Delete(response_json);
-                    }
-                }
-                free(buffer);
-            }
-        } else {
-            ESP_LOGE(TAG, "HTTP error: status %d", status_code);
-            err = ESP_FAIL;
-        }
-    } else {
-        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
+    if (status_code < 0) {
+        return ESP_FAIL;
     }
-    
-    esp_http_client_cleanup(client);
-    return err;
+    if (status_code != 200) {
+        ESP_LOGE(TAG, "HTTP error: status %d", status_code);
+        return ESP_FAIL;
+    }
+    if (!text.found) {
+        ESP_LOGW(TAG, "Gemini response has no candidate text");
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_LOGI(TAG, "Gemini LLM response: %s", response);
+    return ESP_OK;
 }
 
-// Simple JSON parser to extract audioContent from Google TTS response
-static char* extract_audio_content(const char *json_response, int *audio_len)
+// Streaming decoder for the TTS audioContent field: base64 text arrives from
+// the JSON reader in pieces, is decoded in 4-character groups and played as
+// soon as a PCM chunk fills, so the full response is never held in memory
+#define TTS_B64_CHUNK   256     // Base64 characters per decode (multiple of 4)
+#define TTS_PCM_CHUNK   2048    // PCM bytes per bsp_audio_play call
+#define WAV_HEADER_LEN  44
+#define TTS_SAMPLE_RATE 44100   // Requested from the API as LINEAR16 mono
+#define TTS_NETWORK_WAIT_MS 10000  // How long a queued utterance waits for the internet
+#define OFFLINE_CUE_INTERVAL_MS 10000  // Least time between two "can't speak" cues
+
+typedef struct {
+    char b64[TTS_B64_CHUNK];
+    size_t b64_len;
+    uint8_t pcm[TTS_PCM_CHUNK] __attribute__((aligned(4)));
+    size_t pcm_len;
+    bool header_checked;        // LINEAR16 responses start with a WAV header
+    size_t played;              // PCM bytes sent to the codec
+    int64_t started_us;         // Request start, for time-to-first-audio
+    bool error;
+} tts_stream_t;
+
+static void tts_stream_play(tts_stream_t *stream, bool final)
 {
-    // Look for "audioContent":" in the JSON response
-    const char *start_marker = "\"audioContent\":\"";
-    const char *start = strstr(json_response, start_marker);
-    if (!start) {
-        return NULL;
+    if (!stream->header_checked) {
+        if (stream->pcm_len < WAV_HEADER_LEN && !final) {
+            return;
+        }
+        stream->header_checked = true;
+        if (stream->pcm_len >= WAV_HEADER_LEN && memcmp(stream->pcm, "RIFF", 4) == 0) {
+            stream->pcm_len -= WAV_HEADER_LEN;
+            memmove(stream->pcm, stream->pcm + WAV_HEADER_LEN, stream->pcm_len);
+        }
     }
     
-    start += strlen(start_marker);
-    const char *end = strstr(start, "\"");
-    if (!end) {
-        return NULL;
+    size_t len = stream->pcm_len & ~(size_t)1;  // Whole 16-bit samples only
+    if (len == 0) {
+        return;
     }
-    
-    int base64_len = end - start;
-    char *base64_audio = malloc(base64_len + 1);
-    if (!base64_audio) {
-        return NULL;
+    if (stream->played == 0) {
+        metrics_observe_since(voice_metrics.tts_first_audio, stream->started_us);
+        trace_instant(trace_current(), "tts_first_audio");
     }
-    
-    memcpy(base64_audio, start, base64_len);
-    base64_audio[base64_len] = '\0';
-    
-    // Decode base64
-    size_t decoded_len = 0;
-    mbedtls_base64_decode(NULL, 0, &decoded_len, (const unsigned char *)base64_audio, base64_len);
-    
-    unsigned char *decoded_audio = malloc(decoded_len);
-    if (!decoded_audio) {
-        free(base64_audio);
-        return NULL;
+    audio_play((const int16_t *)stream->pcm, len, TTS_SAMPLE_RATE);
+    stream->played += len;
+    stream->pcm_len -= len;
+    if (stream->pcm_len > 0) {
+        stream->pcm[0] = stream->pcm[len];
     }
-    
-    size_t actual_len = 0;
-    int ret = mbedtls_base64_decode(decoded_audio, decoded_len, &actual_len, 
-                                    (const unsigned char *)base64_audio, base64_len);
-    free(base64_audio);
-    
+}
+
+static void tts_stream_decode(tts_stream_t *stream)
+{
+    if (stream->b64_len == 0 || stream->error) {
+        return;
+    }
+    if (TTS_PCM_CHUNK - stream->pcm_len < (TTS_B64_CHUNK / 4) * 3) {
+        tts_stream_play(stream, false);
+    }
+    size_t decoded = 0;
+    int ret = mbedtls_base64_decode(stream->pcm + stream->pcm_len, TTS_PCM_CHUNK - stream->pcm_len, &decoded,
+                                    (const unsigned char *)stream->b64, stream->b64_len);
     if (ret != 0) {
-        free(decoded_audio);
-        return NULL;
+        ESP_LOGW(TAG, "Invalid base64 in TTS audio (%d)", ret);
+        stream->error = true;
+        return;
     }
-    
-    *audio_len = actual_len;
-    return (char *)decoded_audio;
+    stream->pcm_len += decoded;
+    stream->b64_len = 0;
 }
 
-// Check if WiFi is connected and network is ready
-static bool is_network_ready(void)
+static void tts_audio_cb(int path, const char *data, size_t len, bool done, void *ctx)
 {
-    wifi_ap_record_t ap_info;
-    esp_err_t ret = esp_wifi_sta_get_ap_info(&ap_info);
-    if (ret == ESP_OK) {
-        // Additional check: ensure we have an IP address
-        esp_netif_ip_info_t ip_info;
-        esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-        if (netif && esp_netif_get_ip_info(netif, &ip_info) == ESP_OK) {
-            if (ip_info.ip.addr != 0) {
-                return true;
-            }
+    tts_stream_t *stream = (tts_stream_t *)ctx;
+    for (size_t i = 0; i < len && !stream->error; i++) {
+        if (stream->b64_len == TTS_B64_CHUNK) {
+            tts_stream_decode(stream);
         }
+        stream->b64[stream->b64_len++] = data[i];
     }
-    return false;
+    if (done) {
+        tts_stream_decode(stream);
+        tts_stream_play(stream, true);
+    }
+}
+
+// Check if WiFi is connected and network is ready (cached state, no netif queries)
+static bool is_network_ready(void)
+{
+    return connectivity_has(CONN_IP);
 }
 
 // Google TTS function
@@ -1123,9 +1194,13 @@ static esp_err_t google_tts_speak(const char *text)
         ESP_LOGW(TAG, "Network not ready, skipping TTS for: %s", text);
         return ESP_ERR_INVALID_STATE;
     }
+    if (!breaker_allow(cloud_breakers.tts)) {
+        ESP_LOGW(TAG, "TTS unavailable (circuit open), skipping: %s", text);
+        return ESP_ERR_INVALID_STATE;
+    }
     
     char url[512];
-    snprintf(url, sizeof(url), "https://texttospeech.googleapis.com/v1/text:synthesize?key=%s", GOOGLE_TTS_API_KEY);
+    snprintf(url, sizeof(url), "%s", GOOGLE_TTS_URL);
     
     // Build JSON request (escape quotes in text)
     char json_request[2048];
@@ -1156,78 +1231,94 @@ static esp_err_t google_tts_speak(const char *text)
     esp_http_client_config_t config = {
         .url = url,
         .method = HTTP_METHOD_POST,
-        .timeout_ms = 15000,
+        .timeout_ms = latency_timeout_ms(cloud_latency.tts, TTS_TIMEOUT_MS),
     };
     
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+    bool warm;
+    esp_http_client_handle_t client = cloud_client_init(PREWARM_TTS, &config, &warm);
     if (!client) {
         ESP_LOGE(TAG, "Failed to initialize HTTP client");
         return ESP_FAIL;
     }
     
     esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, json_request, strlen(json_request));
     
-    esp_err_t err = esp_http_client_perform(client);
+    tts_stream_t *stream = calloc(1, sizeof(tts_stream_t));
+    if (!stream) {
+        ESP_LOGE(TAG, "Failed to allocate TTS stream");
+        esp_http_client_cleanup(client);
+        return ESP_ERR_NO_MEM;
+    }
     
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-        int content_length = esp_http_client_get_content_length(client);
-        
-        ESP_LOGI(TAG, "HTTP Status = %d, content_length = %d", status_code, content_length);
-        
-        if (status_code == 200 && content_length > 0) {
-            char *buffer = malloc(content_length + 1);
-            if (buffer) {
-                int data_read = esp_http_client_read_response(client, buffer, content_length);
-                if (data_read > 0) {
-                    buffer[data_read] = '\0';
-                    
-                    // Extract and decode audio content
-                    int audio_len = 0;
-                    char *audio_data = extract_audio_content(buffer, &audio_len);
-                    
-                    if (audio_data && audio_len > 0) {
-                        // Google TTS returns LINEAR16 at 44.1kHz (requested in API call)
-                        // Reconfigure codec to ensure it's at the correct rate for proper pitch
-                        // CRITICAL: Don't reconfigure if ESP-SR is active (shared I2C bus conflict)
-                        // background_audio_paused == true means ESP-SR is listening
-                        const int tts_sample_rate = 44100;
-                        if (background_audio_paused) {
-                            ESP_LOGI(TAG, "Skipping codec reconfiguration (ESP-SR active) - TTS will play at current rate");
-                        } else {
-                            ESP_LOGI(TAG, "Reconfiguring audio hardware to %d Hz for TTS playback", tts_sample_rate);
-                            esp_err_t reconf_ret = bsp_audio_reconfigure_sample_rate(tts_sample_rate, 1, 16);  // Mono, 16-bit
-                            if (reconf_ret != ESP_OK) {
-                                ESP_LOGW(TAG, "Failed to reconfigure sample rate for TTS, continuing anyway");
-                            }
-                        }
-                        
-                        int16_t *pcm_data = (int16_t *)audio_data;
-                        int pcm_samples = audio_len / sizeof(int16_t);
-                        
-                        ESP_LOGI(TAG, "Playing TTS audio: %d samples at %d Hz", pcm_samples, tts_sample_rate);
-                        bsp_audio_play(pcm_data, audio_len, portMAX_DELAY);
-                        
-                        free(audio_data);
-                    } else {
-                        ESP_LOGW(TAG, "Failed to extract audio content from response");
-                    }
-                }
-                free(buffer);
-            }
-        } else {
-            ESP_LOGE(TAG, "HTTP error: status %d", status_code);
-            err = ESP_FAIL;
-        }
+    // Google TTS returns LINEAR16 at 44.1kHz (requested in API call)
+    // Reconfigure codec to ensure it's at the correct rate for proper pitch
+    // before audio starts streaming in
+    // CRITICAL: Don't reconfigure if ESP-SR is active (shared I2C bus conflict)
+    // A listening pause means ESP-SR is matching a command
+    const int tts_sample_rate = TTS_SAMPLE_RATE;
+    if (audio_ctl_paused(AUDIO_CTL_PAUSE_LISTENING)) {
+        ESP_LOGI(TAG, "Skipping codec reconfiguration (ESP-SR active) - TTS will play at current rate");
     } else {
-        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
+        ESP_LOGI(TAG, "Reconfiguring audio hardware to %d Hz for TTS playback", tts_sample_rate);
+        esp_err_t reconf_ret = bsp_audio_reconfigure_sample_rate(tts_sample_rate, 1, 16);  // Mono, 16-bit
+        if (reconf_ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to reconfigure sample rate for TTS, continuing anyway");
+        }
     }
     
+    // audioContent is decoded and played while the response is still arriving
+    static const char *const paths[] = {"audioContent"};
+    json_reader_t reader;
+    json_reader_init(&reader, paths, 1, tts_audio_cb, stream);
+    
+    stream->started_us = esp_timer_get_time();
+    // Synthesis is idempotent: a slow request is hedged with a second one
+    http_hedge_config_t hedge = {
+        .client = &config,
+        .sent = voice_metrics.tts_hedges,
+        .won = voice_metrics.tts_hedge_wins,
+    };
+    int status_code = http_post_json_streamed(&client, json_request, strlen(json_request), &reader, warm,
+                                              cloud_latency.tts, &hedge);
     esp_http_client_cleanup(client);
+    cloud_breaker_record(cloud_breakers.tts, status_code);
+    metrics_observe_since(voice_metrics.tts_time, stream->started_us);
+    trace_span_since(trace_current(), "tts", stream->started_us);
+    
+    esp_err_t err = ESP_OK;
+    if (status_code < 0) {
+        err = ESP_FAIL;
+    } else if (status_code != 200) {
+        ESP_LOGE(TAG, "HTTP error: status %d", status_code);
+        err = ESP_FAIL;
+    } else if (stream->played == 0) {
+        ESP_LOGW(TAG, "Failed to extract audio content from response");
+        err = ESP_ERR_NOT_FOUND;
+    } else {
+        ESP_LOGI(TAG, "Played TTS audio: %zu samples at %d Hz", stream->played / sizeof(int16_t), tts_sample_rate);
+    }
+    
+    if (err != ESP_OK) {
+        metrics_inc(voice_metrics.tts_errors);
+    }
+    free(stream);
     return err;
 }
 
+// Falling two-tone played instead of speech that couldn't be synthesized, at
+// most once per OFFLINE_CUE_INTERVAL_MS so a run of announcements beeps once
+static void play_offline_cue(void)
+{
+    static int64_t last_cue_us = 0;
+    int64_t now = esp_timer_get_time();
+    if (last_cue_us && now - last_cue_us < (int64_t)OFFLINE_CUE_INTERVAL_MS * 1000) {
+        return;
+    }
+    last_cue_us = now;
+    generate_and_play_test_tone(660, 120, TTS_SAMPLE_RATE);
+    generate_and_play_test_tone(440, 200, TTS_SAMPLE_RATE);
+}
+
 // TTS task - runs Google TTS in a separate task to avoid TCP/IP stack issues
 static void tts_task(void *pvParameters)
 {
@@ -1235,30 +1326,20 @@ static void tts_task(void *pvParameters)
     if (text) {
         ESP_LOGI(TAG, "Speaking: %s", text);
         
-        // Wait for network to be ready (check WiFi connection and TCP/IP stack)
-        int retry_count = 0;
-        const int max_retries = 100;  // 10 seconds timeout
-        bool network_ready = false;
-        
-        while (retry_count < max_retries) {
-            wifi_ap_record_t ap_info;
-            esp_err_t wifi_status = esp_wifi_sta_get_ap_info(&ap_info);
-            if (wifi_status == ESP_OK) {
-                // WiFi is connected, but TCP/IP stack might still be initializing
-                // Give it a bit more time
-                vTaskDelay(pdMS_TO_TICKS(500));
-                network_ready = true;
-                ESP_LOGI(TAG, "Network ready, proceeding with TTS");
-                break;
-            }
-            vTaskDelay(pdMS_TO_TICKS(100));  // Wait 100ms
-            retry_count++;
-        }
-        
-        if (network_ready) {
-            google_tts_speak(text);
+        esp_err_t err = ESP_ERR_INVALID_STATE;
+        if (breaker_state(cloud_breakers.tts) == BREAKER_OPEN) {
+            ESP_LOGW(TAG, "TTS unavailable (circuit open), skipping: %s", text);
+        } else if (connectivity_wait(CONN_INTERNET, TTS_NETWORK_WAIT_MS)) {
+            // Woken as soon as the reachability probe (or an earlier cloud
+            // call) has seen the internet; at once when it already has
+            err = google_tts_speak(text);
         } else {
-            ESP_LOGW(TAG, "Network not ready after %d retries, skipping TTS for: %s", max_retries, text);
+            ESP_LOGW(TAG, "Network not ready after %d ms (%s), skipping TTS for: %s", TTS_NETWORK_WAIT_MS,
+                     connectivity_state_name(connectivity_state()), text);
+            breaker_record(cloud_breakers.tts, false);  // So the next utterance doesn't wait again
+        }
+        if (err != ESP_OK && err != ESP_ERR_NOT_FINISHED) {
+            play_offline_cue();
         }
         
         free(text);  // Free the allocated text string
@@ -1302,194 +1383,225 @@ static void say(const char *text)
     speak_text(text);
 }
 
-// WiFi event handler - handles connection events and automatic reconnection
+// IP event handler - the connection itself is wifi_manager's
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
     int32_t event_id, void* event_data) {
-    if (event_base == WIFI_EVENT) {
-        if (event_id == WIFI_EVENT_STA_START) {
-            ESP_LOGI(TAG, "WiFi STA started, connecting...");
-            esp_wifi_connect();
-        } else if (event_id == WIFI_EVENT_STA_DISCONNECTED) {
-            ESP_LOGW(TAG, "WiFi disconnected, attempting to reconnect...");
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            esp_wifi_connect();
-        } else if (event_id == WIFI_EVENT_STA_CONNECTED) {
-            wifi_event_sta_connected_t* event = (wifi_event_sta_connected_t*) event_data;
-            ESP_LOGI(TAG, "WiFi connected to: %s (channel: %d)", event->ssid, event->channel);
-        }
-    } else if (event_base == IP_EVENT) {
-        if (event_id == IP_EVENT_STA_GOT_IP) {
-            ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
-            ESP_LOGI(TAG, "WiFi got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-        }
+    if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
+        ESP_LOGI(TAG, "WiFi got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+        boot_seq_ready(BOOT_READY_NETWORK);
     }
 }
 
 // Forward declaration
 void run_test_suite(void *pvParameters);
 
+// FLAC output gathered in one buffer for the STT request
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+} stt_flac_t;
+
+static esp_err_t stt_flac_write(const uint8_t *data, size_t len, void *ctx)
+{
+    stt_flac_t *flac = (stt_flac_t *)ctx;
+    if (len > flac->cap - flac->len) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(flac->buf + flac->len, data, len);
+    flac->len += len;
+    return ESP_OK;
+}
+
+// recognize request for a clip: the audio FLAC-encoded, then base64-encoded
+// straight into the JSON body (the REST API only takes audio as base64).
+// Speech compresses to about half, so the upload is about half the size of
+// base64 LINEAR16. Returns a PSRAM buffer to free, or NULL.
+static char *stt_request_body(const int16_t *samples, size_t count, size_t *body_len)
+{
+    static const char head[] = "{\"config\":{\"encoding\":\"FLAC\",\"sampleRateHertz\":16000,"
+                               "\"languageCode\":\"en-US\",\"enableAutomaticPunctuation\":true},"
+                               "\"audio\":{\"content\":\"";
+    static const char tail[] = "\"}}";
+    
+    int64_t start_us = esp_timer_get_time();
+    stt_flac_t flac = { .cap = flac_max_encoded_size(count) };
+    flac.buf = heap_caps_malloc(flac.cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    flac_encoder_t *enc = heap_caps_malloc(sizeof(flac_encoder_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    esp_err_t err = (flac.buf && enc) ? ESP_OK : ESP_ERR_NO_MEM;
+    if (err == ESP_OK) {
+        err = flac_encoder_init(enc, CAPTURE_SAMPLE_RATE, stt_flac_write, &flac);
+    }
+    if (err == ESP_OK) {
+        err = flac_encoder_feed(enc, samples, count);
+    }
+    if (err == ESP_OK) {
+        err = flac_encoder_finish(enc);
+    }
+    free(enc);
+    
+    char *body = NULL;
+    if (err == ESP_OK) {
+        size_t b64_len = ((flac.len + 2) / 3) * 4;
+        *body_len = sizeof(head) - 1 + b64_len + sizeof(tail) - 1;
+        body = heap_caps_malloc(*body_len + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (body) {
+            size_t encoded = 0;
+            memcpy(body, head, sizeof(head) - 1);
+            mbedtls_base64_encode((unsigned char *)body + sizeof(head) - 1, b64_len + 1, &encoded, flac.buf, flac.len);
+            memcpy(body + sizeof(head) - 1 + encoded, tail, sizeof(tail));
+        }
+    }
+    if (body) {
+        ESP_LOGI(TAG, "STT audio: %zu bytes PCM -> %zu bytes FLAC in %lld ms", count * sizeof(int16_t), flac.len,
+                 (long long)((esp_timer_get_time() - start_us) / 1000));
+        trace_span_since(trace_current(), "flac", start_us);
+    } else {
+        ESP_LOGE(TAG, "Failed to build STT request (%s)", esp_err_to_name(err == ESP_OK ? ESP_ERR_NO_MEM : err));
+    }
+    free(flac.buf);
+    return body;
+}
+
 // Google STT function - convert audio to text
-static esp_err_t google_stt_recognize(const int16_t *audio_data, size_t audio_len_samples, char *text, size_t text_len)
+// Takes ownership of the clip: it goes back to the capture ring as soon as
+// the request body holds the encoded audio, before the round trip
+static esp_err_t google_stt_recognize(audio_clip_t *clip, char *text, size_t text_len)
 {
+    size_t audio_len_samples = 0;
+    const int16_t *audio_data = audio_clip_samples(clip, &audio_len_samples);
     if (!audio_data || audio_len_samples == 0 || !text || text_len == 0) {
+        audio_clip_release(clip);
         return ESP_ERR_INVALID_ARG;
     }
     
     // Check if API key is configured
     if (strlen(GOOGLE_STT_API_KEY) == 0) {
         ESP_LOGW(TAG, "Google STT API key not configured");
+        audio_clip_release(clip);
         return ESP_ERR_NOT_FINISHED;
     }
     
     // Verify network is ready
-    wifi_ap_record_t ap_info;
-    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+    if (!is_network_ready()) {
         ESP_LOGW(TAG, "WiFi not connected, skipping STT");
+        audio_clip_release(clip);
         return ESP_ERR_NOT_FINISHED;
     }
-    
-    // Google STT expects base64-encoded audio (16-bit PCM, 16kHz, mono)
-    size_t audio_bytes = audio_len_samples * sizeof(int16_t);
-    size_t base64_len = ((audio_bytes + 2) / 3) * 4 + 1;
-    char *base64_audio = malloc(base64_len);
-    if (!base64_audio) {
-        ESP_LOGE(TAG, "Failed to allocate memory for base64 encoding");
-        return ESP_ERR_NO_MEM;
+    if (!breaker_allow(cloud_breakers.stt)) {
+        ESP_LOGW(TAG, "STT unavailable (circuit open), skipping");
+        audio_clip_release(clip);
+        return ESP_ERR_INVALID_STATE;
     }
     
-    // Convert int16_t audio to bytes and base64 encode using mbedtls
-    uint8_t *audio_bytes_ptr = (uint8_t *)audio_data;
-    size_t encoded_len = 0;
-    int ret = mbedtls_base64_encode((unsigned char *)base64_audio, base64_len, &encoded_len, 
-                                    audio_bytes_ptr, audio_bytes);
-    if (ret != 0) {
-        ESP_LOGE(TAG, "Base64 encoding failed: %d", ret);
-        free(base64_audio);
-        return ESP_FAIL;
+    size_t body_len = 0;
+    char *body = stt_request_body(audio_data, audio_len_samples, &body_len);
+    audio_clip_release(clip);
+    if (!body) {
+        return ESP_ERR_NO_MEM;
     }
-    base64_audio[encoded_len] = '\0';
-    
-    // Build JSON request with base64 audio
-    char json_request[8192];  // Larger buffer for base64 audio
-    snprintf(json_request, sizeof(json_request),
-        "{"
-        "\"config\":{"
-        "\"encoding\":\"LINEAR16\","
-        "\"sampleRateHertz\":16000,"
-        "\"languageCode\":\"en-US\","
-        "\"enableAutomaticPunctuation\":true"
-        "},"
-        "\"audio\":{"
-        "\"content\":\"%s\""
-        "}"
-        "}",
-        base64_audio);
     
     char url[512];
-    snprintf(url, sizeof(url), "https://speech.googleapis.com/v1/speech:recognize?key=%s", GOOGLE_STT_API_KEY);
+    snprintf(url, sizeof(url), "%s", GOOGLE_STT_URL);
     
     esp_http_client_config_t config = {
         .url = url,
         .method = HTTP_METHOD_POST,
-        .timeout_ms = 15000,
+        .timeout_ms = latency_timeout_ms(cloud_latency.stt, STT_TIMEOUT_MS),
     };
     
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+    bool warm;
+    esp_http_client_handle_t client = cloud_client_init(PREWARM_STT, &config, &warm);
     if (!client) {
         ESP_LOGE(TAG, "Failed to initialize HTTP client for STT");
-        free(base64_audio);
+        free(body);
         return ESP_FAIL;
     }
     
     esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, json_request, strlen(json_request));
     
-    esp_err_t err = esp_http_client_perform(client);
+    // Only the top transcript is needed, extract it while streaming
+    static const char *const paths[] = {"results[0].alternatives[0].transcript"};
+    json_text_t transcript = {.buf = text, .cap = text_len};
+    text[0] = '\0';
+    json_reader_t reader;
+    json_reader_init(&reader, paths, 1, json_text_cb, &transcript);
     
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-        int content_length = esp_http_client_get_content_length(client);
-        
-        if (status_code == 200 && content_length > 0) {
-            char *response = malloc(content_length + 1);
-            if (response) {
-                int data_read = esp_http_client_read_response(client, response, content_length);
-                response[data_read] = '\0';
-                
-                // Parse JSON response
-                cJSON *root = cJSON_Parse(response);
-                if (root) {
-                    cJSON *results = cJSON_GetObjectItem(root, "results");
-                    if (results && cJSON_IsArray(results)) {
-                        cJSON *first_result = cJSON_GetArrayItem(results, 0);
-                        if (first_result) {
-                            cJSON *alternatives = cJSON_GetObjectItem(first_result, "alternatives");
-                            if (alternatives && cJSON_IsArray(alternatives)) {
-                                cJSON *first_alt = cJSON_GetArrayItem(alternatives, 0);
-                                if (first_alt) {
-                                    cJSON *transcript = cJSON_GetObjectItem(first_alt, "transcript");
-                                    if (transcript && cJSON_IsString(transcript)) {
-                                        strncpy(text, transcript->valuestring, text_len - 1);
-                                        text[text_len - 1] = '\0';
-                                        ESP_LOGI(TAG, "STT recognized: %s", text);
-                                        cJSON_Delete(root);
-                                        free(response);
-                                        free(base64_audio);
-                                        esp_http_client_cleanup(client);
-                                        return ESP_OK;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    cJSON_Delete(root);
-                }
-                free(response);
-            }
-        } else {
-            ESP_LOGE(TAG, "STT HTTP error: %d", status_code);
-        }
-    } else {
-        ESP_LOGE(TAG, "STT HTTP request failed: %s", esp_err_to_name(err));
-    }
-    
-    free(base64_audio);
+    int status_code = http_post_json_streamed(&client, body, body_len, &reader, warm, cloud_latency.stt, NULL);
+    free(body);
     esp_http_client_cleanup(client);
-    return err;
+    cloud_breaker_record(cloud_breakers.stt, status_code);
+    
+    if (status_code < 0) {
+        return ESP_FAIL;
+    }
+    if (status_code != 200) {
+        ESP_LOGE(TAG, "STT HTTP error: %d", status_code);
+        return ESP_FAIL;
+    }
+    if (!transcript.found) {
+        ESP_LOGW(TAG, "STT response has no transcript");
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_LOGI(TAG, "STT recognized: %s", text);
+    return ESP_OK;
 }
 
 // STT/LLM/TTS fallback task
+// Takes ownership of one reference to the captured clip (pvParameters)
 static void stt_llm_tts_task(void *pvParameters)
 {
-    struct {
-        int16_t *audio;
-        size_t audio_len;
-    } *stt_data = (typeof(stt_data))pvParameters;
+    audio_clip_t *clip = (audio_clip_t *)pvParameters;
+    size_t audio_len = 0;
+    const int16_t *audio = audio_clip_samples(clip, &audio_len);
     
-    if (!stt_data || !stt_data->audio || stt_data->audio_len == 0) {
+    if (!audio || audio_len == 0) {
         ESP_LOGE(TAG, "Invalid STT data");
-        if (stt_data) {
-            if (stt_data->audio) free(stt_data->audio);
-            free(stt_data);
-        }
+        audio_clip_release(clip);
         vTaskDelete(NULL);
         return;
     }
     
     ESP_LOGI(TAG, "=== STT/LLM/TTS Fallback Task Started ===");
-    ESP_LOGI(TAG, "Audio buffer: %zu samples (%zu bytes)", stt_data->audio_len, stt_data->audio_len * sizeof(int16_t));
+    // Smile while the fallback runs. led_engine_play() only starts the
+    // timeline, so this must stay non-blocking or it delays the STT request
+    led_command_understood();
+    uint32_t interaction = trace_current();
+    int64_t task_start = esp_timer_get_time();
+    ESP_LOGI(TAG, "Audio clip: %zu samples (%zu bytes)", audio_len, audio_len * sizeof(int16_t));
     
     char transcribed_text[512] = {0};
     ESP_LOGI(TAG, "Sending audio to Google STT...");
-    esp_err_t stt_ret = google_stt_recognize(stt_data->audio, stt_data->audio_len, transcribed_text, sizeof(transcribed_text));
-    
-    if (stt_ret == ESP_OK && strlen(transcribed_text) > 0) {
+    int64_t stt_start = esp_timer_get_time();
+    esp_err_t stt_ret = google_stt_recognize(clip, transcribed_text, sizeof(transcribed_text));
+    metrics_observe_since(voice_metrics.stt_time, stt_start);
+    trace_span_since(interaction, "stt", stt_start);
+    if (stt_ret != ESP_OK) {
+        metrics_inc(voice_metrics.stt_errors);
+    }
+    
+    int64_t local_start = esp_timer_get_time();
+    if (stt_ret == ESP_OK && strlen(transcribed_text) > 0 &&
+        speech_commands_action_with_transcript(transcribed_text)) {
+        ESP_LOGI(TAG, "✓ STT transcript '%s' handled locally, skipping LLM", transcribed_text);
+        prewarm_cancel(PREWARM_BIT(PREWARM_LLM));
+        metrics_inc(voice_metrics.llm_avoided);
+        metrics_observe_us(voice_metrics.wake_to_action_local, (uint32_t)(local_start - wake_detected_us));
+        trace_span_since(interaction, "local_intent", local_start);
+    } else if (stt_ret == ESP_OK && strlen(transcribed_text) > 0) {
         ESP_LOGI(TAG, "✓ STT transcribed: '%s'", transcribed_text);
         
         // Send to LLM
         ESP_LOGI(TAG, "Sending to Gemini LLM: '%s'", transcribed_text);
         char llm_response[1024] = {0};
+        int64_t llm_start = esp_timer_get_time();
         esp_err_t llm_ret = gemini_llm_call(transcribed_text, llm_response, sizeof(llm_response));
+        metrics_observe_since(voice_metrics.llm_time, llm_start);
+        trace_span_since(interaction, "llm", llm_start);
+        if (llm_ret != ESP_OK) {
+            metrics_inc(voice_metrics.llm_errors);
+        }
         
         if (llm_ret == ESP_OK && strlen(llm_response) > 0) {
             ESP_LOGI(TAG, "✓ LLM response: '%s'", llm_response);
@@ -1505,6 +1617,7 @@ static void stt_llm_tts_task(void *pvParameters)
             
             // Send LLM response to TTS
             ESP_LOGI(TAG, "Sending LLM response to TTS...");
+            metrics_observe_since(voice_metrics.wake_to_action_cloud, wake_detected_us);
             speak_text(llm_response);
         } else {
             ESP_LOGW(TAG, "✗ LLM call failed (ret=%s), speaking transcribed text", esp_err_to_name(llm_ret));
@@ -1512,528 +1625,442 @@ static void stt_llm_tts_task(void *pvParameters)
         }
     } else {
         ESP_LOGW(TAG, "✗ STT failed (ret=%s), saying generic response", esp_err_to_name(stt_ret));
+        // With speech recognition known down, TTS usually is too: the queued
+        // reply fails at once and plays the offline cue
         speak_text("I didn't understand that command.");
     }
     
     ESP_LOGI(TAG, "=== STT/LLM/TTS Fallback Task Complete ===");
-    
-    // Cleanup
-    free(stt_data->audio);
-    free(stt_data);
+    trace_span_since(interaction, "stt_llm_tts_task", task_start);
     vTaskDelete(NULL);
 }
 
-// Command handler - matches working example's speech_commands_action_with_string
-// Returns true if command was handled, false if unhandled (should use STT/LLM fallback)
-bool speech_commands_action_with_string(int command_id, const char *command_string)
+// ------------------------------------------------------------------------- //
+// Shared sensors
+// ------------------------------------------------------------------------- //
+
+// One set of sensor handles for the telemetry sampler, voice intents and
+// tests. Nothing closes them: scd30_deinit() stops continuous measurement
+// and bh1750_deinit() powers the chip down, which would leave every other
+// user reading a stopped sensor.
+typedef struct {
+    sht30_handle_t sht30;
+    sgp30_handle_t sgp30;
+    bh1750_handle_t bh1750;
+    scd30_handle_t scd30;
+    uint8_t open_mask;  // TELEMETRY_SENSOR_* bits that initialized
+} telemetry_sensors_t;
+
+#define TELEMETRY_SAMPLE_INTERVAL_MS 30000  // Background sampling period
+#define SENSORS_MAX_AGE_MS          (2 * TELEMETRY_SAMPLE_INTERVAL_MS)  // Older readings are taken again
+
+static telemetry_sensors_t sensors;
+static SemaphoreHandle_t sensors_mutex = NULL;  // Guards sensors and sensors_latest
+static telemetry_sample_t sensors_latest;       // Last sample read by anyone
+static TickType_t sensors_latest_tick = 0;
+
+static void sensors_init(void)
 {
-    printf("Executing command_id: %d, string: %s\n", command_id, command_string ? command_string : "NULL");
+    sensors_mutex = xSemaphoreCreateMutex();
+}
+
+// Initialize sensors that are not open yet (ones that failed are retried)
+// and wait once for the slowest first measurement. Caller holds sensors_mutex.
+static void sensors_open_locked(void)
+{
+    check_i2c_available();
     
-    if (!strip) {
-        printf("LED strip not initialized\n");
-        return false;  // Not handled
+    uint32_t settle_ms = 0;
+    if (!(sensors.open_mask & TELEMETRY_SENSOR_SHT30) && sht30_init(&sensors.sht30, i2c_port, 0)) {
+        sensors.open_mask |= TELEMETRY_SENSOR_SHT30;
+    }
+    if (!(sensors.open_mask & TELEMETRY_SENSOR_SGP30) && sgp30_init(&sensors.sgp30, i2c_port, 0)) {
+        sensors.open_mask |= TELEMETRY_SENSOR_SGP30;
+        settle_ms = 100;  // SGP30 needs time to stabilize
+    }
+    if (!(sensors.open_mask & TELEMETRY_SENSOR_BH1750) && bh1750_init(&sensors.bh1750, i2c_port, 0)) {
+        sensors.open_mask |= TELEMETRY_SENSOR_BH1750;
+        settle_ms = BH1750_MEASURE_DELAY_MS + 50;
+    }
+    if (!(sensors.open_mask & TELEMETRY_SENSOR_SCD30) && scd30_init(&sensors.scd30, i2c_port, 0)) {
+        sensors.open_mask |= TELEMETRY_SENSOR_SCD30;
+        settle_ms = SCD30_MEASURE_DELAY_MS + 500;  // SCD30 needs 2+ seconds
+    }
+    if (settle_ms > 0) {
+        vTaskDelay(pdMS_TO_TICKS(settle_ms));
     }
+}
+
+// Borrow the shared handles, opening any sensor not open yet. Pair with
+// sensors_release(); the handles must not be deinitialized.
+static telemetry_sensors_t *sensors_acquire(void)
+{
+    xSemaphoreTake(sensors_mutex, portMAX_DELAY);
+    sensors_open_locked();
+    return &sensors;
+}
+
+static void sensors_release(void)
+{
+    xSemaphoreGive(sensors_mutex);
+}
+
+// Read every open sensor into a telemetry sample, returns number of sensors read.
+// Caller holds sensors_mutex.
+static int sensors_read_locked(telemetry_sensors_t *sensors, telemetry_sample_t *sample)
+{
+    memset(sample, 0, sizeof(*sample));
+    sample->timestamp = (uint32_t)time(NULL);
     
-    // Helper to check command string content
-    bool string_contains(const char *str, const char *substr) {
-        if (!str || !substr) return false;
-        char str_lower[64], substr_lower[64];
-        int i = 0;
-        while (str[i] && i < 63) {
-            str_lower[i] = (str[i] >= 'A' && str[i] <= 'Z') ? str[i] + 32 : str[i];
-            i++;
-        }
-        str_lower[i] = '\0';
-        i = 0;
-        while (substr[i] && i < 63) {
-            substr_lower[i] = (substr[i] >= 'A' && substr[i] <= 'Z') ? substr[i] + 32 : substr[i];
-            i++;
-        }
-        substr_lower[i] = '\0';
-        return strstr(str_lower, substr_lower) != NULL;
-    }
-    
-    // Handle "demo" or "run the demo" command (ID 0, 32, 33, or string contains "demo")
-    if (command_id == 0 || command_id == 32 || command_id == 33 || (command_string && string_contains(command_string, "demo"))) {
-        printf("Demo command detected! Starting test suite...\n");
-        led_command_understood();  // Show smile
-        speak_text("Running the demo.");
-        if (!test_suite_triggered) {
-            test_suite_triggered = true;
-            xTaskCreatePinnedToCore(
-                run_test_suite,
-                "test_suite",
-                8192,
-                NULL,
-                5,
-                NULL,
-                1
-            );
+    if (sensors->open_mask & TELEMETRY_SENSOR_SHT30) {
+        sht30_data_t sht30_data;
+        if (sht30_read(&sensors->sht30, &sht30_data) && sht30_data.valid) {
+            sample->temperature_c = sht30_data.temperature_c;
+            sample->humidity_rh = sht30_data.humidity_rh;
+            sample->valid_mask |= TELEMETRY_SENSOR_SHT30;
+            if (sht30_is_hardware_present(&sensors->sht30)) sample->hardware_mask |= TELEMETRY_SENSOR_SHT30;
+            ESP_LOGI(TAG, "SHT30: T=%.2f°C, H=%.2f%%", sht30_data.temperature_c, sht30_data.humidity_rh);
         }
-        return true;  // Command handled
     }
     
-    // Handle "playing wav" command
-    if (command_string && string_contains(command_string, "playing") && string_contains(command_string, "wav")) {
-        printf("Playing WAV file command detected!\n");
-        led_command_understood();  // Show smile
-        speak_text("Playing WAV file.");
-        
-        const uint8_t *welcome_wav = _binary_offline_welcome_wav_start;
-        size_t welcome_wav_size = _binary_offline_welcome_wav_end - _binary_offline_welcome_wav_start;
-        if (welcome_wav_size > 0) {
-            ESP_LOGI(TAG, "Playing WAV file (%zu bytes)", welcome_wav_size);
-            esp_err_t play_ret = play_wav_file(welcome_wav, welcome_wav_size);
-            if (play_ret != ESP_OK) {
-                ESP_LOGW(TAG, "Failed to play WAV file: %s", esp_err_to_name(play_ret));
-                speak_text("Failed to play WAV file.");
-            }
-        } else {
-            ESP_LOGW(TAG, "WAV file not embedded");
-            speak_text("WAV file not available.");
+    if (sensors->open_mask & TELEMETRY_SENSOR_SGP30) {
+        sgp30_data_t sgp30_data;
+        if (sgp30_read(&sensors->sgp30, &sgp30_data) && sgp30_data.valid) {
+            sample->tvoc_ppb = sgp30_data.tvoc_ppb;
+            sample->eco2_ppm = sgp30_data.eco2_ppm;
+            sample->valid_mask |= TELEMETRY_SENSOR_SGP30;
+            if (sgp30_is_hardware_present(&sensors->sgp30)) sample->hardware_mask |= TELEMETRY_SENSOR_SGP30;
+            ESP_LOGI(TAG, "SGP30: TVOC=%d ppb, eCO2=%d ppm", sgp30_data.tvoc_ppb, sgp30_data.eco2_ppm);
         }
-        return true;  // Command handled
     }
     
-    // Handle "playing mp3" command
-    if (command_string && string_contains(command_string, "playing") && string_contains(command_string, "mp3")) {
-        printf("Playing MP3 file command detected!\n");
-        led_command_understood();  // Show smile
-        speak_text("Playing MP3 file.");
-        
-        const uint8_t *mp3_data = _binary_Time_mp3_start;
-        size_t mp3_size = _binary_Time_mp3_end - _binary_Time_mp3_start;
-        if (mp3_size > 0) {
-            ESP_LOGI(TAG, "Playing MP3 file (%zu bytes)", mp3_size);
-            esp_err_t play_ret = play_mp3_file(mp3_data, mp3_size);
-            if (play_ret != ESP_OK) {
-                ESP_LOGW(TAG, "Failed to play MP3 file: %s", esp_err_to_name(play_ret));
-                speak_text("Failed to play MP3 file.");
-            }
-        } else {
-            ESP_LOGW(TAG, "MP3 file not embedded");
-            speak_text("MP3 file not available.");
-        }
-        return true;  // Command handled
-    }
-    
-    // Handle light control commands
-    // Based on phoneme mapping: "TkN nN" = "turn on", "TkN eF" = "turn off"
-    // Command ID 13 = "TkN nN jc LiT" = "turn on the light" (ON)
-    // Command ID 14 = "TkN eF jc LiT" = "turn off the light" (OFF)
-    // Command ID 12 = "MdK Mm c KnFm" = "make me a coffee" (not lights)
-    // Command ID 1 = "Sgl c Sel" = "sing a song" (not lights)
-    
-    // Turn lights ON (command_id 13, 17, or string contains "turn on" and "light")
-    if (command_id == 13 || command_id == 17 || 
-        (command_string && string_contains(command_string, "turn on") && string_contains(command_string, "light"))) {
-        printf("Turning lights on\n");
-        led_command_understood();  // Show smile
-        speak_text("Turning lights on.");
-        
-        // Light up all LEDs in green (happy face)
-        if (xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            led_clear_all();
-        // Eyes - bright blue/green (cyan)
-        led_set_pixel(LED_LEFT_EYE, 0, 255, 255);   // Bright cyan (LED 11)
-        led_set_pixel(LED_RIGHT_EYE, 0, 255, 255);  // Bright cyan (LED 2)
-        // Ears
-        led_set_pixel(LED_EAR_LEFT, 0, 150, 0);
-        led_set_pixel(LED_EAR_RIGHT, 0, 150, 0);
-        // Smile
-        for (int i = LED_SMILE_START; i <= LED_SMILE_END; i++) {
-            led_set_pixel(i, 0, 255, 0);
-        }
-        led_strip_refresh(strip);
-        xSemaphoreGive(led_mutex);
-        }
-        current_led_state = LED_STATE_IDLE;  // Keep lights on
-        return true;  // Command handled
-    }
-    
-    // Turn lights OFF (command_id 14, 18, or string contains "turn off" and "light")
-    if (command_id == 14 || command_id == 18 ||
-        (command_string && string_contains(command_string, "turn off") && string_contains(command_string, "light"))) {
-        printf("Turning lights off\n");
-        led_command_understood();  // Show smile
-        speak_text("Turning lights off.");
-        led_clear_all();
-        led_strip_refresh(strip);
-        current_led_state = LED_STATE_IDLE;
-        return true;  // Command handled
-    }
-    
-    // Color commands - set all LEDs to specific color
-    // Command ID 15 = "pdNq jc KcLk To RfD" = "change the clock to red"
-    // Command ID 16 = "pdNq jc KcLk To GRmN" = "change the clock to green"
-    uint8_t r = 0, g = 0, b = 0;
-    const char *color_name = NULL;
-    bool color_set = false;
-    
-    // RED (command_id 15 or string contains "red")
-    if (command_id == 15 || (command_string && string_contains(command_string, "red"))) {
-        r = 255; g = 0; b = 0;
-        color_name = "red";
-        color_set = true;
-    }
-    // GREEN (command_id 16 or string contains "green")
-    else if (command_id == 16 || (command_string && string_contains(command_string, "green"))) {
-        r = 0; g = 255; b = 0;
-        color_name = "green";
-        color_set = true;
-    }
-    // BLUE (command_id 5 or string contains "blue")
-    else if (command_id == 5 || (command_string && string_contains(command_string, "blue"))) {
-        r = 0; g = 0; b = 255;
-        color_name = "blue";
-        color_set = true;
-    }
-    // WHITE (command_id 6 or string contains "white")
-    else if (command_id == 6 || (command_string && string_contains(command_string, "white"))) {
-        r = 255; g = 255; b = 255;
-        color_name = "white";
-        color_set = true;
-    }
-    // YELLOW (command_id 7 or string contains "yellow")
-    else if (command_id == 7 || (command_string && string_contains(command_string, "yellow"))) {
-        r = 255; g = 255; b = 0;
-        color_name = "yellow";
-        color_set = true;
-    }
-    // ORANGE (command_id 8 or string contains "orange")
-    else if (command_id == 8 || (command_string && string_contains(command_string, "orange"))) {
-        r = 255; g = 165; b = 0;
-        color_name = "orange";
-        color_set = true;
-    }
-    // PURPLE (command_id 9 or string contains "purple")
-    else if (command_id == 9 || (command_string && string_contains(command_string, "purple"))) {
-        r = 128; g = 0; b = 128;
-        color_name = "purple";
-        color_set = true;
-    }
-    // CYAN (command_id 10 or string contains "cyan")
-    else if (command_id == 10 || (command_string && string_contains(command_string, "cyan"))) {
-        r = 0; g = 255; b = 255;
-        color_name = "cyan";
-        color_set = true;
-    }
-    
-    if (color_set && color_name) {
-        printf("Setting lights to %s\n", color_name);
-        led_command_understood();  // Show smile
-        char response[64];
-        snprintf(response, sizeof(response), "Setting lights to %s.", color_name);
-        speak_text(response);
-        
-        // Set all LEDs to the color
-        // Use mutex to prevent RMT crash from concurrent access
-        if (xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            led_clear_all();
-        for (int i = 0; i < MAX_LEDS; i++) {
-            led_set_pixel(i, r, g, b);
-        }
-        led_strip_refresh(strip);
-        xSemaphoreGive(led_mutex);
-        }
-        current_led_state = LED_STATE_IDLE;  // Keep color
-        return true;  // Command handled
-    }
-    
-    // Music/Audio controls
-    // Command ID 5 = "hicST VnLYoM" = "highest volume"
-    // Command ID 6 = "LbcST VnLYoM" = "lowest volume"
-    // Command ID 7 = "gNKRmS jc VnLYoM" = "increase the volume"
-    // Command ID 8 = "DgKRmS jc VnLYoM" = "decrease the volume"
-    if (command_id == 5 || (command_string && string_contains(command_string, "highest") && string_contains(command_string, "volume"))) {
-        printf("Setting volume to highest\n");
-        led_command_understood();
-        speak_text("Setting volume to highest.");
-        // TODO: Implement actual volume control via codec
-        ESP_LOGI(TAG, "Volume set to highest (not yet implemented)");
-        return true;  // Command handled
-    }
-    else if (command_id == 6 || (command_string && string_contains(command_string, "lowest") && string_contains(command_string, "volume"))) {
-        printf("Setting volume to lowest\n");
-        led_command_understood();
-        speak_text("Setting volume to lowest.");
-        // TODO: Implement actual volume control via codec
-        ESP_LOGI(TAG, "Volume set to lowest (not yet implemented)");
-        return true;  // Command handled
-    }
-    else if (command_id == 7 || (command_string && string_contains(command_string, "increase") && string_contains(command_string, "volume"))) {
-        printf("Increasing volume\n");
-        led_command_understood();
-        speak_text("Increasing volume.");
-        // TODO: Implement actual volume control via codec
-        ESP_LOGI(TAG, "Volume increased (not yet implemented)");
-        return true;  // Command handled
-    }
-    else if (command_id == 8 || (command_string && string_contains(command_string, "decrease") && string_contains(command_string, "volume"))) {
-        printf("Decreasing volume\n");
-        led_command_understood();
-        speak_text("Decreasing volume.");
-        // TODO: Implement actual volume control via codec
-        ESP_LOGI(TAG, "Volume decreased (not yet implemented)");
-        return true;  // Command handled
-    }
-    
-    // Background audio controls
-    if (command_string && (string_contains(command_string, "play") || string_contains(command_string, "start")) && 
-        (string_contains(command_string, "music") || string_contains(command_string, "background") || string_contains(command_string, "audio"))) {
-        printf("Start background audio\n");
-        led_command_understood();
-        if (!background_audio_enabled) {
-            background_audio_enabled = true;
-            background_audio_paused = false;
-            speak_text("Background audio started.");
-            ESP_LOGI(TAG, "Background audio enabled");
-        } else {
-            background_audio_paused = false;
-            speak_text("Background audio resumed.");
-            ESP_LOGI(TAG, "Background audio resumed");
-        }
-        return true;  // Command handled
-    }
-    
-    if (command_string && (string_contains(command_string, "stop") || string_contains(command_string, "pause")) && 
-        (string_contains(command_string, "music") || string_contains(command_string, "background") || string_contains(command_string, "audio"))) {
-        printf("Stop background audio\n");
-        led_command_understood();
-        background_audio_paused = true;
-        speak_text("Background audio paused.");
-        ESP_LOGI(TAG, "Background audio paused");
-        return true;  // Command handled
-    }
-    
-    // TV controls (can be used for IR blaster)
-    // Command ID 9 = "TkN nN jc TmVm" = "turn on the TV"
-    // Command ID 10 = "TkN eF jc TmVm" = "turn off the TV"
-    if (command_id == 9 || (command_string && string_contains(command_string, "turn on") && string_contains(command_string, "tv"))) {
-        printf("Turning TV on\n");
-        led_command_understood();
-        speak_text("Turning TV on.");
-        // TODO: Implement IR blaster
-        return true;  // Command handled
-    }
-    else if (command_id == 10 || (command_string && string_contains(command_string, "turn off") && string_contains(command_string, "tv"))) {
-        printf("Turning TV off\n");
-        led_command_understood();
-        speak_text("Turning TV off.");
-        // TODO: Implement IR blaster
-        return true;  // Command handled
-    }
-    
-    // Air conditioner controls (can be used for IR blaster)
-    // Command ID 19 = "TkN nN jc fR KcNDgscNk" = "turn on the air conditioner"
-    // Command ID 20 = "TkN eF jc fR KcNDgscNk" = "turn off the air conditioner"
-    if (command_id == 19 || (command_string && string_contains(command_string, "turn on") && string_contains(command_string, "air conditioner"))) {
-        printf("Turning air conditioner on\n");
-        led_command_understood();
-        speak_text("Turning air conditioner on.");
-        // TODO: Implement IR blaster
-        return true;  // Command handled
-    }
-    else if (command_id == 20 || (command_string && string_contains(command_string, "turn off") && string_contains(command_string, "air conditioner"))) {
-        printf("Turning air conditioner off\n");
-        led_command_understood();
-        speak_text("Turning air conditioner off.");
-        // TODO: Implement IR blaster
-        return true;  // Command handled
-    }
-    
-    // Temperature queries (Command IDs 21-31 are temperature settings)
-    // For sensor queries, we'll use string matching since phonemes are for AC temp settings
-    if (command_string && (string_contains(command_string, "what") || string_contains(command_string, "tell me")) && 
-        string_contains(command_string, "temperature")) {
-        printf("Temperature query\n");
-        led_command_understood();
-        
-        // Read from SHT30 sensor
-        check_i2c_available();
-        sht30_handle_t sht30_handle;
-        if (sht30_init(&sht30_handle, i2c_port, 0)) {
-            sht30_data_t sensor_data;
-            if (sht30_read(&sht30_handle, &sensor_data) && sensor_data.valid) {
-                char msg[128];
-                snprintf(msg, sizeof(msg), "The temperature is %.1f degrees Celsius.", sensor_data.temperature_c);
-                speak_text(msg);
-                sht30_deinit(&sht30_handle);
-                return true;
-            }
-            sht30_deinit(&sht30_handle);
+    if (sensors->open_mask & TELEMETRY_SENSOR_BH1750) {
+        bh1750_data_t bh1750_data;
+        if (bh1750_read(&sensors->bh1750, &bh1750_data) && bh1750_data.valid) {
+            sample->lux = bh1750_data.lux;
+            sample->valid_mask |= TELEMETRY_SENSOR_BH1750;
+            if (bh1750_is_hardware_present(&sensors->bh1750)) sample->hardware_mask |= TELEMETRY_SENSOR_BH1750;
+            ESP_LOGI(TAG, "BH1750: Lux=%.2f", bh1750_data.lux);
         }
-        speak_text("Unable to read temperature sensor.");
-        return true;  // Command handled
     }
     
-    if (command_string && (string_contains(command_string, "what") || string_contains(command_string, "tell me")) && 
-        string_contains(command_string, "humidity")) {
-        printf("Humidity query\n");
-        led_command_understood();
-        
-        // Read from SHT30 sensor
-        check_i2c_available();
-        sht30_handle_t sht30_handle;
-        if (sht30_init(&sht30_handle, i2c_port, 0)) {
-            sht30_data_t sensor_data;
-            if (sht30_read(&sht30_handle, &sensor_data) && sensor_data.valid) {
-                char msg[128];
-                snprintf(msg, sizeof(msg), "The humidity is %.1f percent.", sensor_data.humidity_rh);
-                speak_text(msg);
-                sht30_deinit(&sht30_handle);
-                return true;
-            }
-            sht30_deinit(&sht30_handle);
+    if (sensors->open_mask & TELEMETRY_SENSOR_SCD30) {
+        scd30_data_t scd30_data;
+        if (scd30_read(&sensors->scd30, &scd30_data) && scd30_data.valid) {
+            sample->co2_ppm = scd30_data.co2_ppm;
+            sample->scd30_temperature_c = scd30_data.temperature_c;
+            sample->scd30_humidity_rh = scd30_data.humidity_rh;
+            sample->valid_mask |= TELEMETRY_SENSOR_SCD30;
+            if (scd30_is_hardware_present(&sensors->scd30)) sample->hardware_mask |= TELEMETRY_SENSOR_SCD30;
+            ESP_LOGI(TAG, "SCD30: CO2=%.1f ppm, T=%.2f°C, H=%.2f%%", 
+                     scd30_data.co2_ppm, scd30_data.temperature_c, scd30_data.humidity_rh);
         }
-        speak_text("Unable to read humidity sensor.");
-        return true;  // Command handled
     }
     
-    if (command_string && (string_contains(command_string, "what") || string_contains(command_string, "tell me")) && 
-        (string_contains(command_string, "air quality") || string_contains(command_string, "voc"))) {
-        printf("Air quality query\n");
-        led_command_understood();
-        
-        // Read from SGP30 sensor
-        check_i2c_available();
-        sgp30_handle_t sgp30_handle;
-        if (sgp30_init(&sgp30_handle, i2c_port, 0)) {
-            vTaskDelay(pdMS_TO_TICKS(100));  // SGP30 needs time to stabilize
-            sgp30_data_t sensor_data;
-            if (sgp30_read(&sgp30_handle, &sensor_data) && sensor_data.valid) {
-                char msg[128];
-                snprintf(msg, sizeof(msg), "Air quality: TVOC %d parts per billion, eCO2 %d parts per million.", 
-                         sensor_data.tvoc_ppb, sensor_data.eco2_ppm);
-                speak_text(msg);
-                sgp30_deinit(&sgp30_handle);
-                return true;
-            }
-            sgp30_deinit(&sgp30_handle);
-        }
-        speak_text("Unable to read air quality sensor.");
-        return true;  // Command handled
+    return __builtin_popcount(sample->valid_mask);
+}
+
+// Read every sensor now, returns number of sensors read
+static int sensors_read(telemetry_sample_t *sample)
+{
+    telemetry_sensors_t *shared = sensors_acquire();
+    int count = sensors_read_locked(shared, sample);
+    sensors_latest = *sample;
+    sensors_latest_tick = xTaskGetTickCount();
+    sensors_release();
+    return count;
+}
+
+// The latest reading from one sensor: the sampler's if it is recent,
+// otherwise a fresh read. Returns false if the sensor has no valid reading.
+static bool sensors_latest_reading(uint8_t sensor, telemetry_sample_t *sample)
+{
+    xSemaphoreTake(sensors_mutex, portMAX_DELAY);
+    bool recent = (sensors_latest.valid_mask & sensor) &&
+                  xTaskGetTickCount() - sensors_latest_tick < pdMS_TO_TICKS(SENSORS_MAX_AGE_MS);
+    if (recent) {
+        *sample = sensors_latest;
+    }
+    xSemaphoreGive(sensors_mutex);
+    if (!recent) {
+        sensors_read(sample);
     }
+    return (sample->valid_mask & sensor) != 0;
+}
+
+// ------------------------------------------------------------------------- //
+// Local intents
+// ------------------------------------------------------------------------- //
+
+bool intent_demo(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("Demo command detected! Starting test suite...\n");
+    led_command_understood();  // Show smile
+    speak_text("Running the demo.");
+    if (!atomic_exchange(&test_suite_triggered, true)) {
+        xTaskCreatePinnedToCore(
+            run_test_suite,
+            "test_suite",
+            8192,
+            NULL,
+            5,
+            NULL,
+            1
+        );
+    }
+    return true;
+}
+
+bool intent_play_wav(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("Playing WAV file command detected!\n");
+    led_command_understood();  // Show smile
+    speak_text("Playing WAV file.");
     
-    if (command_string && (string_contains(command_string, "what") || string_contains(command_string, "tell me")) && 
-        string_contains(command_string, "co2")) {
-        printf("CO2 level query\n");
-        led_command_understood();
-        
-        // Read from SCD30 sensor
-        check_i2c_available();
-        scd30_handle_t scd30_handle;
-        if (scd30_init(&scd30_handle, i2c_port, 0)) {
-            vTaskDelay(pdMS_TO_TICKS(SCD30_MEASURE_DELAY_MS + 500));  // SCD30 needs 2+ seconds
-            scd30_data_t sensor_data;
-            if (scd30_read(&scd30_handle, &sensor_data) && sensor_data.valid) {
-                char msg[128];
-                snprintf(msg, sizeof(msg), "CO2 level is %.0f parts per million.", sensor_data.co2_ppm);
-                speak_text(msg);
-                scd30_deinit(&scd30_handle);
-                return true;
-            }
-            scd30_deinit(&scd30_handle);
+    const uint8_t *welcome_wav = _binary_offline_welcome_wav_start;
+    size_t welcome_wav_size = _binary_offline_welcome_wav_end - _binary_offline_welcome_wav_start;
+    if (welcome_wav_size > 0) {
+        ESP_LOGI(TAG, "Playing WAV file (%zu bytes)", welcome_wav_size);
+        esp_err_t play_ret = play_wav_file(welcome_wav, welcome_wav_size, AUDIO_CTL_PAUSE_LISTENING);
+        if (play_ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to play WAV file: %s", esp_err_to_name(play_ret));
+            speak_text("Failed to play WAV file.");
         }
-        speak_text("Unable to read CO2 sensor.");
-        return true;  // Command handled
+    } else {
+        ESP_LOGW(TAG, "WAV file not embedded");
+        speak_text("WAV file not available.");
     }
+    return true;
+}
+
+bool intent_play_mp3(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("Playing MP3 file command detected!\n");
+    led_command_understood();  // Show smile
+    speak_text("Playing MP3 file.");
     
-    if (command_string && (string_contains(command_string, "what") || string_contains(command_string, "tell me")) && 
-        (string_contains(command_string, "light level") || string_contains(command_string, "brightness"))) {
-        printf("Light level query\n");
-        led_command_understood();
-        
-        // Read from BH1750 sensor
-        check_i2c_available();
-        bh1750_handle_t bh1750_handle;
-        if (bh1750_init(&bh1750_handle, i2c_port, 0)) {
-            vTaskDelay(pdMS_TO_TICKS(BH1750_MEASURE_DELAY_MS + 50));
-            bh1750_data_t sensor_data;
-            if (bh1750_read(&bh1750_handle, &sensor_data) && sensor_data.valid) {
-                char msg[128];
-                snprintf(msg, sizeof(msg), "The light level is %.0f lux.", sensor_data.lux);
-                speak_text(msg);
-                bh1750_deinit(&bh1750_handle);
-                return true;
-            }
-            bh1750_deinit(&bh1750_handle);
+    const uint8_t *mp3_data = _binary_Time_mp3_start;
+    size_t mp3_size = _binary_Time_mp3_end - _binary_Time_mp3_start;
+    if (mp3_size > 0) {
+        ESP_LOGI(TAG, "Playing MP3 file (%zu bytes)", mp3_size);
+        esp_err_t play_ret = play_mp3_file(mp3_data, mp3_size, AUDIO_CTL_PAUSE_LISTENING);
+        if (play_ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to play MP3 file: %s", esp_err_to_name(play_ret));
+            speak_text("Failed to play MP3 file.");
         }
-        speak_text("Unable to read light sensor.");
-        return true;  // Command handled
+    } else {
+        ESP_LOGW(TAG, "MP3 file not embedded");
+        speak_text("MP3 file not available.");
     }
+    return true;
+}
+
+bool intent_lights_on(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("Turning lights on\n");
+    led_command_understood();  // Show smile
+    speak_text("Turning lights on.");
     
-    if (command_string && (string_contains(command_string, "what") || string_contains(command_string, "tell me")) && 
-        string_contains(command_string, "weather")) {
-        printf("Weather query\n");
-        led_command_understood();
-        speak_text("Weather information is not yet implemented.");
-        // TODO: Implement weather API
-        return true;  // Command handled
+    // Light up the happy face; stays on above the idle eyes
+    led_engine_play(LED_LAYER_LIGHTS, &led_face_lights);
+    return true;
+}
+
+bool intent_lights_off(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("Turning lights off\n");
+    led_command_understood();  // Show smile
+    speak_text("Turning lights off.");
+    led_engine_clear(LED_LAYER_LIGHTS);  // Back to the idle face
+    return true;
+}
+
+bool intent_set_color(const intent_def_t *intent, int command_id, const char *text)
+{
+    const intent_color_t *color = (const intent_color_t *)intent->arg;
+    printf("Setting lights to %s\n", color->name);
+    led_command_understood();  // Show smile
+    char response[64];
+    snprintf(response, sizeof(response), "Setting lights to %s.", color->name);
+    speak_text(response);
+    
+    // Set all LEDs to the color until the lights are turned off
+    led_engine_fill(LED_LAYER_LIGHTS, (led_rgb_t){ color->r, color->g, color->b }, 0);
+    return true;
+}
+
+bool intent_background_audio_start(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("Start background audio\n");
+    led_command_understood();
+    if (!background_audio_enabled) {
+        background_audio_enabled = true;
+        audio_ctl_resume(AUDIO_CTL_PAUSE_USER);
+        speak_text("Background audio started.");
+        ESP_LOGI(TAG, "Background audio enabled");
+    } else {
+        audio_ctl_resume(AUDIO_CTL_PAUSE_USER);
+        speak_text("Background audio resumed.");
+        ESP_LOGI(TAG, "Background audio resumed");
     }
+    return true;
+}
+
+bool intent_background_audio_stop(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("Stop background audio\n");
+    led_command_understood();
+    audio_ctl_pause(AUDIO_CTL_PAUSE_USER);
+    speak_text("Background audio paused.");
+    ESP_LOGI(TAG, "Background audio paused");
+    return true;
+}
+
+bool intent_temperature(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("Temperature query\n");
+    led_command_understood();
     
-    if (command_string && string_contains(command_string, "read sensors")) {
-        printf("Read sensors command\n");
-        led_command_understood();
-        speak_text("Reading all sensors is not yet implemented.");
-        // TODO: Read from all sensors
-        return true;  // Command handled
+    // SHT30 reading from the shared sensors
+    telemetry_sample_t sample;
+    if (sensors_latest_reading(TELEMETRY_SENSOR_SHT30, &sample)) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "The temperature is %.1f degrees Celsius.", sample.temperature_c);
+        speak_text(msg);
+        return true;
     }
+    speak_text("Unable to read temperature sensor.");
+    return true;
+}
+
+bool intent_humidity(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("Humidity query\n");
+    led_command_understood();
     
-    if (command_string && string_contains(command_string, "publish telemetry")) {
-        printf("Publish telemetry command\n");
-        led_command_understood();
-        speak_text("Telemetry publishing is not yet implemented.");
-        // TODO: Publish sensor data to AWS IoT Core
-        return true;  // Command handled
+    // SHT30 reading from the shared sensors
+    telemetry_sample_t sample;
+    if (sensors_latest_reading(TELEMETRY_SENSOR_SHT30, &sample)) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "The humidity is %.1f percent.", sample.humidity_rh);
+        speak_text(msg);
+        return true;
     }
+    speak_text("Unable to read humidity sensor.");
+    return true;
+}
+
+bool intent_air_quality(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("Air quality query\n");
+    led_command_understood();
     
-    if (command_string && (string_contains(command_string, "play") && string_contains(command_string, "music"))) {
-        printf("Play music command\n");
-        led_command_understood();
-        speak_text("Music playback is not yet implemented.");
-        // TODO: Implement audio playback
-        return true;  // Command handled
+    // SGP30 reading from the shared sensors
+    telemetry_sample_t sample;
+    if (sensors_latest_reading(TELEMETRY_SENSOR_SGP30, &sample)) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Air quality: TVOC %d parts per billion, eCO2 %d parts per million.", 
+                 sample.tvoc_ppb, sample.eco2_ppm);
+        speak_text(msg);
+        return true;
     }
+    speak_text("Unable to read air quality sensor.");
+    return true;
+}
+
+bool intent_co2(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("CO2 level query\n");
+    led_command_understood();
     
-    if (command_string && (string_contains(command_string, "stop") && string_contains(command_string, "music"))) {
-        printf("Stop music command\n");
-        led_command_understood();
-        speak_text("Music stop is not yet implemented.");
-        // TODO: Implement audio stop
-        return true;  // Command handled
+    // SCD30 reading from the shared sensors (it measures continuously, so
+    // the sampler's last reading is as good as a new one)
+    telemetry_sample_t sample;
+    if (sensors_latest_reading(TELEMETRY_SENSOR_SCD30, &sample)) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "CO2 level is %.0f parts per million.", sample.co2_ppm);
+        speak_text(msg);
+        return true;
     }
+    speak_text("Unable to read CO2 sensor.");
+    return true;
+}
+
+bool intent_light_level(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("Light level query\n");
+    led_command_understood();
     
-    if (command_string && (string_contains(command_string, "pause") && string_contains(command_string, "music"))) {
-        printf("Pause music command\n");
-        led_command_understood();
-        speak_text("Music pause is not yet implemented.");
-        // TODO: Implement audio pause
-        return true;  // Command handled
+    // BH1750 reading from the shared sensors
+    telemetry_sample_t sample;
+    if (sensors_latest_reading(TELEMETRY_SENSOR_BH1750, &sample)) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "The light level is %.0f lux.", sample.lux);
+        speak_text(msg);
+        return true;
     }
-    
-    if (command_string && (string_contains(command_string, "next") && string_contains(command_string, "song"))) {
-        printf("Next song command\n");
-        led_command_understood();
-        speak_text("Next song is not yet implemented.");
-        // TODO: Implement next track
-        return true;  // Command handled
+    speak_text("Unable to read light sensor.");
+    return true;
+}
+
+// Acknowledge a command that has no implementation yet; arg is the spoken reply
+bool intent_say(const intent_def_t *intent, int command_id, const char *text)
+{
+    printf("%s command\n", intent->name);
+    led_command_understood();
+    speak_text((const char *)intent->arg);
+    // TODO: Implement (volume via codec, IR blaster, weather API, media playback)
+    return true;
+}
+
+static intent_table_t *local_intent_table = NULL;
+
+static void local_intents_init(void)
+{
+    esp_err_t ret = intent_table_build(&local_intent_table, local_intents, local_intents_count);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to compile local intents: %s", esp_err_to_name(ret));
+        return;
     }
+    intent_table_set_synonyms(local_intent_table, local_synonyms, local_synonyms_count);
+}
+
+static void bind_command_intent(const command_entry_t *entry, void *ctx)
+{
+    if (entry->intent &&
+        intent_table_set_id(local_intent_table, entry->id, entry->intent) == ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "Command %u: no local intent named '%s'", entry->id, entry->intent);
+    }
+}
+
+// Route MultiNet command IDs to intents as the active command registry says
+static void local_intents_bind_commands(void)
+{
+    if (!local_intent_table) {
+        return;
+    }
+    intent_table_clear_ids(local_intent_table);
+    command_registry_foreach(bind_command_intent, NULL);
+}
+
+// Command handler - matches working example's speech_commands_action_with_string
+// Returns true if command was handled, false if unhandled (should use STT/LLM fallback)
+bool speech_commands_action_with_string(int command_id, const char *command_string)
+{
+    printf("Executing command_id: %d, string: %s\n", command_id, command_string ? command_string : "NULL");
     
-    if (command_string && (string_contains(command_string, "previous") && string_contains(command_string, "song"))) {
-        printf("Previous song command\n");
-        led_command_understood();
-        speak_text("Previous song is not yet implemented.");
-        // TODO: Implement previous track
-        return true;  // Command handled
+    if (!strip) {
+        printf("LED strip not initialized\n");
+        return false;  // Not handled
     }
     
-    if (command_string && string_contains(command_string, "test audio")) {
-        printf("Test audio command\n");
-        led_command_understood();
-        speak_text("Audio test is not yet implemented.");
-        // TODO: Implement audio test
-        return true;  // Command handled
+    const intent_def_t *intent = intent_table_match(local_intent_table, command_id, command_string);
+    if (intent) {
+        // Handlers block for seconds; run them on the action executor so
+        // the detect task keeps fetching from the AFE
+        ESP_LOGI(TAG, "Intent: %s", intent->name);
+        action_executor_post(intent, command_id, command_string);
+        return true;
     }
     
     // Unhandled command - return false to trigger STT/LLM fallback
@@ -2041,6 +2068,24 @@ bool speech_commands_action_with_string(int command_id, const char *command_stri
     return false;  // Signal that command was not handled
 }
 
+// Run an STT transcript locally if it confidently matches an intent.
+// Returns false to send it to the LLM instead.
+static bool speech_commands_action_with_transcript(const char *transcript)
+{
+    if (!strip) {
+        return false;
+    }
+    float confidence = 0.0f;
+    const intent_def_t *intent = intent_table_classify(local_intent_table, transcript, &confidence);
+    if (!intent || confidence < INTENT_FUZZY_THRESHOLD) {
+        ESP_LOGI(TAG, "No confident local intent (best: %s, %.2f)", intent ? intent->name : "none", confidence);
+        return false;
+    }
+    ESP_LOGI(TAG, "Local intent for transcript: %s (confidence %.2f)", intent->name, confidence);
+    action_executor_post(intent, -1, transcript);
+    return true;
+}
+
 // I2C initialization check for sensors
 // Note: I2C is already initialized by esp_board_init() using the old API
 // We just need to verify it's available and use the same port
@@ -2084,12 +2129,10 @@ static test_status_t test_2_sht30_sensor(void)
     ESP_LOGI(TAG, "Test 2: SHT30 Temperature/Humidity Sensor");
     speak_text("Test 2. SHT30 temperature and humidity sensor.");
     
-    // Check I2C availability (already initialized by board)
-    check_i2c_available();
-    
-    // Initialize SHT30 driver
-    sht30_handle_t sht30_handle;
-    if (!sht30_init(&sht30_handle, i2c_port, 0)) {
+    // Use the shared SHT30 handle (opened once, never deinitialized)
+    telemetry_sensors_t *shared = sensors_acquire();
+    if (!(shared->open_mask & TELEMETRY_SENSOR_SHT30)) {
+        sensors_release();
         ESP_LOGE(TAG, "Failed to initialize SHT30 driver");
         speak_text("Test 2 failed. SHT30 initialization error.");
         led_set_status(TEST_STATUS_FAIL);
@@ -2098,16 +2141,17 @@ static test_status_t test_2_sht30_sensor(void)
     
     // Read sensor data
     sht30_data_t sensor_data;
-    if (!sht30_read(&sht30_handle, &sensor_data)) {
+    bool read_ok = sht30_read(&shared->sht30, &sensor_data);
+    bool hardware_present = sht30_is_hardware_present(&shared->sht30);
+    sensors_release();
+    if (!read_ok) {
         ESP_LOGE(TAG, "Failed to read from SHT30");
         speak_text("Test 2 failed. SHT30 read error.");
-        sht30_deinit(&sht30_handle);
         led_set_status(TEST_STATUS_FAIL);
         return TEST_STATUS_FAIL;
     }
     
     // Validate data
-    bool hardware_present = sht30_is_hardware_present(&sht30_handle);
     bool data_valid = sensor_data.valid;
     bool temp_reasonable = (sensor_data.temperature_c >= -40.0f && sensor_data.temperature_c <= 125.0f);
     bool humidity_reasonable = (sensor_data.humidity_rh >= 0.0f && sensor_data.humidity_rh <= 100.0f);
@@ -2131,9 +2175,8 @@ static test_status_t test_2_sht30_sensor(void)
         speak_text("Test 2 failed. Invalid sensor data.");
     }
     
-    // Set LED status and cleanup
+    // Set LED status
     led_set_status(status);
-    sht30_deinit(&sht30_handle);
     
     ESP_LOGI(TAG, "SHT30 Test: Hardware=%d, Valid=%d, Temp=%.2f°C, Humidity=%.2f%%", 
              hardware_present, data_valid, sensor_data.temperature_c, sensor_data.humidity_rh);
@@ -2146,33 +2189,29 @@ static test_status_t test_3_sgp30_sensor(void)
     ESP_LOGI(TAG, "Test 3: SGP30 VOC Sensor");
     speak_text("Test 3. SGP30 VOC sensor.");
     
-    // Check I2C availability (already initialized by board)
-    check_i2c_available();
-    
-    // Initialize SGP30 driver
-    sgp30_handle_t sgp30_handle;
-    if (!sgp30_init(&sgp30_handle, i2c_port, 0)) {
+    // Use the shared SGP30 handle (opening it waits for the sensor to stabilize)
+    telemetry_sensors_t *shared = sensors_acquire();
+    if (!(shared->open_mask & TELEMETRY_SENSOR_SGP30)) {
+        sensors_release();
         ESP_LOGE(TAG, "Failed to initialize SGP30 driver");
         speak_text("Test 3 failed. SGP30 initialization error.");
         led_set_status(TEST_STATUS_FAIL);
         return TEST_STATUS_FAIL;
     }
     
-    // Wait a bit for sensor to stabilize (SGP30 needs time after init)
-    vTaskDelay(pdMS_TO_TICKS(100));
-    
     // Read sensor data
     sgp30_data_t sensor_data;
-    if (!sgp30_read(&sgp30_handle, &sensor_data)) {
+    bool read_ok = sgp30_read(&shared->sgp30, &sensor_data);
+    bool hardware_present = sgp30_is_hardware_present(&shared->sgp30);
+    sensors_release();
+    if (!read_ok) {
         ESP_LOGE(TAG, "Failed to read from SGP30");
         speak_text("Test 3 failed. SGP30 read error.");
-        sgp30_deinit(&sgp30_handle);
         led_set_status(TEST_STATUS_FAIL);
         return TEST_STATUS_FAIL;
     }
     
     // Validate data
-    bool hardware_present = sgp30_is_hardware_present(&sgp30_handle);
     bool data_valid = sensor_data.valid;
     bool tvoc_reasonable = (sensor_data.tvoc_ppb <= 60000);  // Max TVOC is 60000 ppb
     bool eco2_reasonable = (sensor_data.eco2_ppm <= 60000);  // Max eCO2 is 60000 ppm
@@ -2196,9 +2235,8 @@ static test_status_t test_3_sgp30_sensor(void)
         speak_text("Test 3 failed. Invalid sensor data.");
     }
     
-    // Set LED status and cleanup
+    // Set LED status
     led_set_status(status);
-    sgp30_deinit(&sgp30_handle);
     
     ESP_LOGI(TAG, "SGP30 Test: Hardware=%d, Valid=%d, TVOC=%d ppb, eCO2=%d ppm", 
              hardware_present, data_valid, sensor_data.tvoc_ppb, sensor_data.eco2_ppm);
@@ -2211,33 +2249,29 @@ static test_status_t test_4_bh1750_sensor(void)
     ESP_LOGI(TAG, "Test 4: BH1750 Light Sensor");
     speak_text("Test 4. BH1750 light sensor.");
     
-    // Check I2C availability (already initialized by board)
-    check_i2c_available();
-    
-    // Initialize BH1750 driver
-    bh1750_handle_t bh1750_handle;
-    if (!bh1750_init(&bh1750_handle, i2c_port, 0)) {
+    // Use the shared BH1750 handle (opening it waits for the first measurement)
+    telemetry_sensors_t *shared = sensors_acquire();
+    if (!(shared->open_mask & TELEMETRY_SENSOR_BH1750)) {
+        sensors_release();
         ESP_LOGE(TAG, "Failed to initialize BH1750 driver");
         speak_text("Test 4 failed. BH1750 initialization error.");
         led_set_status(TEST_STATUS_FAIL);
         return TEST_STATUS_FAIL;
     }
     
-    // Wait for measurement to complete
-    vTaskDelay(pdMS_TO_TICKS(BH1750_MEASURE_DELAY_MS + 50));
-    
     // Read sensor data
     bh1750_data_t sensor_data;
-    if (!bh1750_read(&bh1750_handle, &sensor_data)) {
+    bool read_ok = bh1750_read(&shared->bh1750, &sensor_data);
+    bool hardware_present = bh1750_is_hardware_present(&shared->bh1750);
+    sensors_release();
+    if (!read_ok) {
         ESP_LOGE(TAG, "Failed to read from BH1750");
         speak_text("Test 4 failed. BH1750 read error.");
-        bh1750_deinit(&bh1750_handle);
         led_set_status(TEST_STATUS_FAIL);
         return TEST_STATUS_FAIL;
     }
     
     // Validate data
-    bool hardware_present = bh1750_is_hardware_present(&bh1750_handle);
     bool data_valid = sensor_data.valid;
     bool lux_reasonable = (sensor_data.lux >= 0.0f && sensor_data.lux <= 65535.0f);
     
@@ -2258,9 +2292,8 @@ static test_status_t test_4_bh1750_sensor(void)
         speak_text("Test 4 failed. Invalid sensor data.");
     }
     
-    // Set LED status and cleanup
+    // Set LED status
     led_set_status(status);
-    bh1750_deinit(&bh1750_handle);
     
     ESP_LOGI(TAG, "BH1750 Test: Hardware=%d, Valid=%d, Lux=%.2f", 
              hardware_present, data_valid, sensor_data.lux);
@@ -2273,33 +2306,30 @@ static test_status_t test_5_scd30_sensor(void)
     ESP_LOGI(TAG, "Test 5: SCD30 CO2 Sensor");
     speak_text("Test 5. SCD30 CO2 sensor.");
     
-    // Check I2C availability (already initialized by board)
-    check_i2c_available();
-    
-    // Initialize SCD30 driver
-    scd30_handle_t scd30_handle;
-    if (!scd30_init(&scd30_handle, i2c_port, 0)) {
+    // Use the shared SCD30 handle (opening it waits the 2 seconds for the
+    // first measurement; after that it measures continuously)
+    telemetry_sensors_t *shared = sensors_acquire();
+    if (!(shared->open_mask & TELEMETRY_SENSOR_SCD30)) {
+        sensors_release();
         ESP_LOGE(TAG, "Failed to initialize SCD30 driver");
         speak_text("Test 5 failed. SCD30 initialization error.");
         led_set_status(TEST_STATUS_FAIL);
         return TEST_STATUS_FAIL;
     }
     
-    // Wait for measurement to complete (SCD30 needs 2 seconds)
-    vTaskDelay(pdMS_TO_TICKS(SCD30_MEASURE_DELAY_MS + 500));
-    
     // Read sensor data
     scd30_data_t sensor_data;
-    if (!scd30_read(&scd30_handle, &sensor_data)) {
+    bool read_ok = scd30_read(&shared->scd30, &sensor_data);
+    bool hardware_present = scd30_is_hardware_present(&shared->scd30);
+    sensors_release();
+    if (!read_ok) {
         ESP_LOGE(TAG, "Failed to read from SCD30");
         speak_text("Test 5 failed. SCD30 read error.");
-        scd30_deinit(&scd30_handle);
         led_set_status(TEST_STATUS_FAIL);
         return TEST_STATUS_FAIL;
     }
     
     // Validate data
-    bool hardware_present = scd30_is_hardware_present(&scd30_handle);
     bool data_valid = sensor_data.valid;
     bool co2_reasonable = (sensor_data.co2_ppm >= 0.0f && sensor_data.co2_ppm <= 10000.0f);
     bool temp_reasonable = (sensor_data.temperature_c >= -40.0f && sensor_data.temperature_c <= 125.0f);
@@ -2324,9 +2354,8 @@ static test_status_t test_5_scd30_sensor(void)
         speak_text("Test 5 failed. Invalid sensor data.");
     }
     
-    // Set LED status and cleanup
+    // Set LED status
     led_set_status(status);
-    scd30_deinit(&scd30_handle);
     
     ESP_LOGI(TAG, "SCD30 Test: Hardware=%d, Valid=%d, CO2=%.1f ppm, T=%.2f°C, H=%.2f%%", 
              hardware_present, data_valid, sensor_data.co2_ppm, sensor_data.temperature_c, sensor_data.humidity_rh);
@@ -2377,13 +2406,93 @@ static test_status_t test_7_wifi_connectivity(void)
     }
 }
 
+// Both phases stay below MQTT_PUB_SPILL_THRESHOLD queued in RAM, so Test 8
+// times the broker round trips rather than NVS writes
+#define MQTT_TEST_BURST_MESSAGES  50     // Throughput measurement, paced by RAM depth
+#define MQTT_TEST_BURST_DEPTH     (MQTT_PUB_SPILL_THRESHOLD / 2)
+#define MQTT_TEST_OUTAGE_MESSAGES 10     // Published while the link is down
+
+static void mqtt_test_publish(int seq)
+{
+    char payload[64];
+    int len = snprintf(payload, sizeof(payload), "{\"seq\":%d,\"t\":%lld}",
+                       seq, (long long)(esp_timer_get_time() / 1000));
+    mqtt_publisher_publish(MQTT_TEST_TOPIC, payload, len);
+}
+
 static test_status_t test_8_aws_iot_mqtt(void)
 {
     ESP_LOGI(TAG, "Test 8: AWS IoT Core MQTT Connectivity");
     speak_text("Test 8. AWS IoT Core MQTT connectivity.");
     
-    speak_text("This function is not yet implemented.");
-    return TEST_STATUS_NOT_IMPLEMENTED;
+    if (!is_network_ready()) {
+        ESP_LOGW(TAG, "Network not ready, skipping MQTT test");
+        speak_text("Test 8 warning. Network not connected.");
+        return TEST_STATUS_WARNING;
+    }
+    if (strlen(MQTT_BROKER_URI) == 0) {
+        ESP_LOGW(TAG, "No MQTT broker configured, skipping MQTT test");
+        speak_text("Test 8 warning. No MQTT broker configured.");
+        return TEST_STATUS_WARNING;
+    }
+    
+    // Wait for the publisher (started in app_main) to reach the broker
+    for (int i = 0; i < 100 && !mqtt_publisher_is_connected(); i++) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    if (!mqtt_publisher_is_connected()) {
+        ESP_LOGW(TAG, "MQTT broker %s not reachable", MQTT_BROKER_URI);
+        speak_text("Test 8 warning. MQTT broker not reachable.");
+        return TEST_STATUS_WARNING;
+    }
+    
+    mqtt_publisher_stats_t before, after;
+    mqtt_publisher_get_stats(&before);
+    
+    // Throughput: QoS1 messages pipelined up to the in-flight limit, topped
+    // up as the RAM queue drains so none of them spill to flash
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < MQTT_TEST_BURST_MESSAGES; i++) {
+        mqtt_publisher_stats_t depth;
+        mqtt_publisher_get_stats(&depth);
+        while (depth.ram_depth >= MQTT_TEST_BURST_DEPTH && depth.connected) {
+            vTaskDelay(1);
+            mqtt_publisher_get_stats(&depth);
+        }
+        mqtt_test_publish(i);
+    }
+    bool burst_drained = mqtt_publisher_wait_drained(15000);
+    int64_t burst_us = esp_timer_get_time() - start_us;
+    float msgs_per_sec = burst_us > 0 ? MQTT_TEST_BURST_MESSAGES * 1000000.0f / burst_us : 0;
+    ESP_LOGI(TAG, "MQTT burst: %d messages acked in %lld ms (%.1f msg/s)",
+             MQTT_TEST_BURST_MESSAGES, (long long)(burst_us / 1000), msgs_per_sec);
+    
+    // Recovery: drop the link, keep publishing, and wait for store-and-forward
+    mqtt_publisher_simulate_link_loss();
+    for (int i = 0; i < MQTT_TEST_OUTAGE_MESSAGES; i++) {
+        mqtt_test_publish(MQTT_TEST_BURST_MESSAGES + i);
+    }
+    bool outage_drained = mqtt_publisher_wait_drained(30000);
+    
+    mqtt_publisher_get_stats(&after);
+    uint32_t acked = after.acked - before.acked;
+    uint32_t dropped = after.dropped - before.dropped;
+    ESP_LOGI(TAG, "MQTT recovery: %lu ms, acked %lu/%d, dropped %lu, retried %lu, spilled %lu",
+             (unsigned long)after.last_recovery_ms, (unsigned long)acked,
+             MQTT_TEST_BURST_MESSAGES + MQTT_TEST_OUTAGE_MESSAGES,
+             (unsigned long)dropped, (unsigned long)(after.retried - before.retried),
+             (unsigned long)(after.spilled - before.spilled));
+    
+    if (burst_drained && outage_drained && dropped == 0) {
+        speak_text("Test 8 passed. MQTT publishing and reconnect working.");
+        return TEST_STATUS_PASS;
+    } else if (burst_drained) {
+        speak_text("Test 8 warning. MQTT did not recover from link loss.");
+        return TEST_STATUS_WARNING;
+    } else {
+        speak_text("Test 8 failed. MQTT messages were not acknowledged.");
+        return TEST_STATUS_FAIL;
+    }
 }
 
 // Test wake word and commands using TTS
@@ -2456,7 +2565,7 @@ static esp_err_t generate_and_play_test_tone(int frequency_hz, int duration_ms,
     }
     
     // Reconfigure audio to test sample rate if needed
-    if (background_audio_paused) {
+    if (audio_ctl_paused(AUDIO_CTL_PAUSE_LISTENING)) {
         ESP_LOGI(TAG, "Skipping codec reconfiguration (ESP-SR active)");
     } else {
         esp_err_t reconf_ret = bsp_audio_reconfigure_sample_rate(sample_rate, 1, 16);  // Mono, 16-bit
@@ -2467,7 +2576,7 @@ static esp_err_t generate_and_play_test_tone(int frequency_hz, int duration_ms,
     
     // Play the tone
     size_t bytes_to_play = num_samples * sizeof(int16_t);
-    esp_err_t ret = bsp_audio_play(tone_buffer, bytes_to_play, portMAX_DELAY);
+    esp_err_t ret = audio_play(tone_buffer, bytes_to_play, sample_rate);
     
     free(tone_buffer);
     return ret;
@@ -2529,128 +2638,53 @@ static test_status_t test_11_audio_output(void)
     }
 }
 
-static test_status_t test_12_sensor_telemetry(void)
+// Background sampler - reads the shared sensors and feeds the batched telemetry pipeline
+static void telemetry_sampler_task(void *pvParameters)
 {
-    ESP_LOGI(TAG, "Test 12: Sensor Telemetry Publishing");
-    speak_text("Test 12. Sensor telemetry publishing.");
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    
-    // Collect telemetry data from all sensors
-    // Format as JSON and prepare for publishing
-    // Note: AWS IoT MQTT (Test 8) is not implemented, so we'll format and log the data
-    
-    check_i2c_available();
-    cJSON *telemetry = cJSON_CreateObject();
-    bool all_sensors_read = true;
-    int sensors_read_count = 0;
-    
-    // Get timestamp
-    time_t now;
-    time(&now);
-    char timestamp_str[64];
-    snprintf(timestamp_str, sizeof(timestamp_str), "%ld", (long)now);
-    cJSON_AddStringToObject(telemetry, "timestamp", timestamp_str);
-    cJSON_AddStringToObject(telemetry, "device_id", "naphome-0.9");
-    
-    // Read SHT30 (Temperature/Humidity)
-    sht30_handle_t sht30_handle;
-    if (sht30_init(&sht30_handle, i2c_port, 0)) {
-        sht30_data_t sht30_data;
-        if (sht30_read(&sht30_handle, &sht30_data) && sht30_data.valid) {
-            cJSON *sht30_obj = cJSON_CreateObject();
-            cJSON_AddNumberToObject(sht30_obj, "temperature_c", sht30_data.temperature_c);
-            cJSON_AddNumberToObject(sht30_obj, "humidity_rh", sht30_data.humidity_rh);
-            cJSON_AddBoolToObject(sht30_obj, "hardware_present", sht30_is_hardware_present(&sht30_handle));
-            cJSON_AddItemToObject(telemetry, "sht30", sht30_obj);
-            sensors_read_count++;
-            ESP_LOGI(TAG, "SHT30: T=%.2f°C, H=%.2f%%", sht30_data.temperature_c, sht30_data.humidity_rh);
-        } else {
-            all_sensors_read = false;
-        }
-        sht30_deinit(&sht30_handle);
-    } else {
-        all_sensors_read = false;
-    }
+    ESP_LOGI(TAG, "Telemetry sampler started (every %d ms)", TELEMETRY_SAMPLE_INTERVAL_MS);
     
-    // Read SGP30 (VOC/eCO2)
-    sgp30_handle_t sgp30_handle;
-    if (sgp30_init(&sgp30_handle, i2c_port, 0)) {
-        vTaskDelay(pdMS_TO_TICKS(100));  // SGP30 needs time to stabilize
-        sgp30_data_t sgp30_data;
-        if (sgp30_read(&sgp30_handle, &sgp30_data) && sgp30_data.valid) {
-            cJSON *sgp30_obj = cJSON_CreateObject();
-            cJSON_AddNumberToObject(sgp30_obj, "tvoc_ppb", sgp30_data.tvoc_ppb);
-            cJSON_AddNumberToObject(sgp30_obj, "eco2_ppm", sgp30_data.eco2_ppm);
-            cJSON_AddBoolToObject(sgp30_obj, "hardware_present", sgp30_is_hardware_present(&sgp30_handle));
-            cJSON_AddItemToObject(telemetry, "sgp30", sgp30_obj);
-            sensors_read_count++;
-            ESP_LOGI(TAG, "SGP30: TVOC=%d ppb, eCO2=%d ppm", sgp30_data.tvoc_ppb, sgp30_data.eco2_ppm);
-        } else {
-            all_sensors_read = false;
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        telemetry_sample_t sample;
+        if (sensors_read(&sample) > 0) {
+            telemetry_add_sample(&sample);
+            event_bus_publish(EVENT_BUS_TOPIC_SENSORS, &sample, sizeof(sample));
         }
-        sgp30_deinit(&sgp30_handle);
-    } else {
-        all_sensors_read = false;
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(TELEMETRY_SAMPLE_INTERVAL_MS));
     }
-    
-    // Read BH1750 (Light)
-    bh1750_handle_t bh1750_handle;
-    if (bh1750_init(&bh1750_handle, i2c_port, 0)) {
-        vTaskDelay(pdMS_TO_TICKS(BH1750_MEASURE_DELAY_MS + 50));
-        bh1750_data_t bh1750_data;
-        if (bh1750_read(&bh1750_handle, &bh1750_data) && bh1750_data.valid) {
-            cJSON *bh1750_obj = cJSON_CreateObject();
-            cJSON_AddNumberToObject(bh1750_obj, "lux", bh1750_data.lux);
-            cJSON_AddBoolToObject(bh1750_obj, "hardware_present", bh1750_is_hardware_present(&bh1750_handle));
-            cJSON_AddItemToObject(telemetry, "bh1750", bh1750_obj);
-            sensors_read_count++;
-            ESP_LOGI(TAG, "BH1750: Lux=%.2f", bh1750_data.lux);
-        } else {
-            all_sensors_read = false;
-        }
-        bh1750_deinit(&bh1750_handle);
-    } else {
-        all_sensors_read = false;
+}
+
+// Telemetry sink - hands each encoded batch to the MQTT store-and-forward queue
+static void telemetry_mqtt_sink(const uint8_t *data, size_t len, telemetry_format_t format, void *ctx)
+{
+    esp_err_t ret = mqtt_publisher_publish(MQTT_TELEMETRY_TOPIC, data, len);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Telemetry batch not queued for MQTT: %s", esp_err_to_name(ret));
     }
+}
+
+static test_status_t test_12_sensor_telemetry(void)
+{
+    ESP_LOGI(TAG, "Test 12: Sensor Telemetry Publishing");
+    speak_text("Test 12. Sensor telemetry publishing.");
+    vTaskDelay(pdMS_TO_TICKS(1000));
     
-    // Read SCD30 (CO2/Temperature/Humidity)
-    scd30_handle_t scd30_handle;
-    if (scd30_init(&scd30_handle, i2c_port, 0)) {
-        vTaskDelay(pdMS_TO_TICKS(SCD30_MEASURE_DELAY_MS + 500));  // SCD30 needs 2+ seconds
-        scd30_data_t scd30_data;
-        if (scd30_read(&scd30_handle, &scd30_data) && scd30_data.valid) {
-            cJSON *scd30_obj = cJSON_CreateObject();
-            cJSON_AddNumberToObject(scd30_obj, "co2_ppm", scd30_data.co2_ppm);
-            cJSON_AddNumberToObject(scd30_obj, "temperature_c", scd30_data.temperature_c);
-            cJSON_AddNumberToObject(scd30_obj, "humidity_rh", scd30_data.humidity_rh);
-            cJSON_AddBoolToObject(scd30_obj, "hardware_present", scd30_is_hardware_present(&scd30_handle));
-            cJSON_AddItemToObject(telemetry, "scd30", scd30_obj);
-            sensors_read_count++;
-            ESP_LOGI(TAG, "SCD30: CO2=%.1f ppm, T=%.2f°C, H=%.2f%%", 
-                     scd30_data.co2_ppm, scd30_data.temperature_c, scd30_data.humidity_rh);
-        } else {
-            all_sensors_read = false;
-        }
-        scd30_deinit(&scd30_handle);
-    } else {
-        all_sensors_read = false;
-    }
+    // Collect one sample from all sensors and push it through the batched
+    // telemetry pipeline, flushing immediately so the encoded batch is emitted
+    telemetry_sample_t sample;
+    int sensors_read_count = sensors_read(&sample);
     
-    // Format JSON string
-    char *json_string = cJSON_Print(telemetry);
-    if (json_string) {
-        ESP_LOGI(TAG, "Telemetry JSON:\n%s", json_string);
+    if (sensors_read_count > 0) {
+        telemetry_add_sample(&sample);
+        telemetry_flush();
         
-        // TODO: Publish to AWS IoT Core MQTT when Test 8 is implemented
-        // For now, we just log it
-        ESP_LOGI(TAG, "Telemetry data collected from %d sensors", sensors_read_count);
-        ESP_LOGI(TAG, "AWS IoT MQTT not implemented - telemetry logged only");
-        
-        free(json_string);
+        telemetry_stats_t stats;
+        telemetry_get_stats(&stats);
+        ESP_LOGI(TAG, "Telemetry data collected from %d sensors, last batch %lu bytes / %lu samples (%lu us encode)",
+                 sensors_read_count, (unsigned long)stats.last_batch_bytes,
+                 (unsigned long)stats.last_batch_samples, (unsigned long)stats.last_encode_us);
     }
     
-    cJSON_Delete(telemetry);
-    
     // Determine test status
     if (sensors_read_count >= 2) {  // At least 2 sensors working
         char msg[128];
@@ -2713,8 +2747,13 @@ void run_test_suite(void *pvParameters)
         test_status_t status = tests[i].func();
         led_set_status(status);
         
-        // Update web server with test status
-        web_server_update_test_status(i + 1, (int)status, tests[i].name);
+        // Publish the result (the web dashboard pushes it to open browsers)
+        event_bus_test_status_t result = {
+            .test_num = i + 1,
+            .status = (int)status,
+            .name = tests[i].name,
+        };
+        event_bus_publish(EVENT_BUS_TOPIC_TEST_STATUS, &result, sizeof(result));
         
         switch (status) {
             case TEST_STATUS_PASS:
@@ -2789,48 +2828,176 @@ static void feed_Task(void *arg)
     vTaskDelete(NULL);
 }
 
-// Helper function to get expected phonemes for a command ID (for debugging)
-static const char* get_expected_phonemes(int command_id)
-{
-    // Map of command IDs to expected phonemes from sdkconfig
-    // This helps debug phoneme detection issues
-    static const struct {
-        int id;
-        const char *phonemes;
-    } phoneme_map[] = {
-        {0, "TfL Mm c qbK"},           // "turn on my soundbox"
-        {1, "Sgl c Sel"},              // "sing a song"
-        {2, "PLd NoZ paNcL"},          // "play noise panel"
-        {3, "TkN nN Mi StNDBnKS"},     // "turn on my soundbox"
-        {4, "TkN eF Mi StNDBnKS"},     // "turn off my soundbox"
-        {5, "hicST VnLYoM"},           // "highest volume"
-        {6, "LbcST VnLYoM"},           // "lowest volume"
-        {7, "gNKRmS jc VnLYoM"},       // "increase the volume"
-        {8, "DgKRmS jc VnLYoM"},       // "decrease the volume"
-        {9, "TkN nN jc TmVm"},         // "turn on the TV"
-        {10, "TkN eF jc TmVm"},        // "turn off the TV"
-        {11, "MdK Mm c Tm"},            // "make me a tea"
-        {12, "MdK Mm c KnFm"},          // "make me a coffee"
-        {13, "TkN nN jc LiT"},          // "turn on the light"
-        {14, "TkN eF jc LiT"},          // "turn off the light"
-        {15, "pdNq jc KcLk To RfD"},   // "change the clock to red"
-        {16, "pdNq jc KcLk To GRmN"},   // "change the clock to green"
-        {17, "TkN nN eL jc LiTS"},      // "turn on all the lights"
-        {18, "TkN eF eL jc LiTS"},      // "turn off all the lights"
-        {19, "TkN nN jc fR KcNDgscNk"}, // "turn on the air conditioner"
-        {20, "TkN eF jc fR KcNDgscNk"}, // "turn off the air conditioner"
-        {32, "Rn jc DgMmO"},            // "run the demo"
-    };
-    
-    for (int i = 0; i < sizeof(phoneme_map) / sizeof(phoneme_map[0]); i++) {
-        if (phoneme_map[i].id == command_id) {
-            return phoneme_map[i].phonemes;
+// Expected phonemes for a command ID from the command registry (for debugging)
+static const char* get_expected_phonemes(int command_id, char *buf, size_t buf_len)
+{
+    command_entry_t entry;
+    if (command_registry_get(command_id, &entry, buf, buf_len) != ESP_OK) {
+        return "UNKNOWN";
+    }
+    return entry.phonemes;
+}
+
+// Hand capture ring samples [start, end) to the STT/LLM/TTS task
+static void start_stt_fallback(void *ctx, uint64_t start, uint64_t end)
+{
+    audio_clip_t *clip = audio_capture_clip(start, end);
+    if (!clip) {
+        ESP_LOGW(TAG, "✗ No captured audio for STT fallback");
+        prewarm_cancel(PREWARM_ALL);
+        return;
+    }
+    size_t samples = 0;
+    audio_clip_samples(clip, &samples);
+    ESP_LOGI(TAG, "Creating STT/LLM/TTS task with %zu audio samples (%.2f seconds)",
+             samples, (float)samples / CAPTURE_SAMPLE_RATE);
+    BaseType_t task_ret = xTaskCreatePinnedToCore(
+        stt_llm_tts_task,
+        "stt_llm_tts",
+        16384,  // Larger stack for HTTP operations
+        clip,
+        3,  // Lower priority
+        NULL,
+        0   // Core 0
+    );
+    if (task_ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create STT/LLM/TTS task!");
+        audio_clip_release(clip);
+    }
+}
+
+// detect_fsm_t ops backed by ESP-SR
+typedef struct {
+    esp_mn_iface_t *multinet;
+    model_iface_data_t *model_data;
+    esp_afe_sr_data_t *afe_data;
+} detect_ctx_t;
+
+static esp_mn_state_t detect_mn_detect(void *ctx, int16_t *samples)
+{
+    detect_ctx_t *d = ctx;
+    return d->multinet->detect(d->model_data, samples);
+}
+
+static esp_mn_results_t *detect_mn_results(void *ctx)
+{
+    detect_ctx_t *d = ctx;
+    return d->multinet->get_results(d->model_data);
+}
+
+static void detect_mn_clean(void *ctx)
+{
+    detect_ctx_t *d = ctx;
+    d->multinet->clean(d->model_data);
+}
+
+static void detect_enable_wakenet(void *ctx)
+{
+    detect_ctx_t *d = ctx;
+    afe_handle->enable_wakenet(d->afe_data);
+}
+
+// Log the MultiNet results against the registry and run the top command
+static bool detect_run_command(void *ctx, esp_mn_results_t *mn_result)
+{
+    // Enhanced debug output with phoneme information
+    ESP_LOGI(TAG, "=== Local Command Detection Results ===");
+    for (int i = 0; i < mn_result->num; i++) {
+        int cmd_id = mn_result->command_id[i];
+        const char *detected_string = mn_result->string;
+        char expected_buf[192];
+        const char *expected_phonemes = get_expected_phonemes(cmd_id, expected_buf, sizeof(expected_buf));
+        
+        ESP_LOGI(TAG, "TOP %d: command_id=%d, phrase_id=%d, prob=%.3f", 
+                 i+1, cmd_id, mn_result->phrase_id[i], mn_result->prob[i]);
+        ESP_LOGI(TAG, "  Detected phonemes: '%s'", detected_string ? detected_string : "NULL");
+        ESP_LOGI(TAG, "  Expected phonemes: '%s'", expected_phonemes);
+        
+        // Compare detected vs expected
+        if (detected_string && strlen(detected_string) > 0) {
+            if (strcmp(detected_string, expected_phonemes) == 0) {
+                ESP_LOGI(TAG, "  ✓ Phonemes match expected!");
+            } else {
+                ESP_LOGW(TAG, "  ✗ Phoneme mismatch! Detected='%s' vs Expected='%s'", 
+                         detected_string, expected_phonemes);
+            }
+        } else {
+            ESP_LOGW(TAG, "  ⚠ No phonemes detected in result string");
         }
     }
-    return "UNKNOWN";
+    ESP_LOGI(TAG, "=== End Detection Results ===");
+    
+    // Execute the top command (highest probability)
+    bool command_handled = false;
+    system_status.is_processing = true;
+    system_status.last_activity = xTaskGetTickCount();
+    if (mn_result->num > 0) {
+        ESP_LOGI(TAG, "Executing top command: id=%d, phonemes='%s'", 
+                 mn_result->command_id[0], mn_result->string ? mn_result->string : "NULL");
+        int64_t action_start = esp_timer_get_time();
+        trace_span(trace_current(), "multinet", wake_detected_us, action_start);
+        command_handled = speech_commands_action_with_string(mn_result->command_id[0], mn_result->string);
+        trace_span_since(trace_current(), command_handled ? "local_command" : "local_command_unhandled",
+                         action_start);
+        if (command_handled) {
+            metrics_observe_us(voice_metrics.wake_to_action_local, (uint32_t)(action_start - wake_detected_us));
+            // No STT or LLM this time; TTS stays warm for the spoken reply
+            prewarm_cancel(PREWARM_BIT(PREWARM_STT) | PREWARM_BIT(PREWARM_LLM));
+        }
+    }
+    return command_handled;
 }
 
-// ESP-SR detect task - EXACT COPY from working example
+// LEDs, background audio, status and metrics for each detect state change
+static void detect_transition(void *ctx, detect_event_t event, detect_state_t state)
+{
+    switch (event) {
+    case DETECT_EVENT_WAKE:
+        printf("WAKEWORD DETECTED\n");
+        wake_detected_us = esp_timer_get_time();
+        metrics_inc(voice_metrics.wake_words);
+        trace_begin_interaction();
+        // DNS and TLS to the cloud hosts while the user is still speaking
+        prewarm_start(cloud_prewarm_targets());
+        system_status.is_listening = false;
+        system_status.is_recognizing = true;
+        led_wake_word_detected(); // Illuminate ears
+        // Pause background audio when wake word detected
+        audio_ctl_pause(AUDIO_CTL_PAUSE_LISTENING);
+        ESP_LOGI(TAG, "Background audio paused (wake word detected)");
+        break;
+    case DETECT_EVENT_COMMAND:
+        // Resume background audio after command is processed
+        audio_ctl_resume(AUDIO_CTL_PAUSE_LISTENING);
+        system_status.is_listening = true;
+        system_status.is_recognizing = false;
+        system_status.is_processing = false;
+        ESP_LOGI(TAG, "Background audio resumed (command processed)");
+        printf("-----------listening-----------\n");
+        break;
+    case DETECT_EVENT_END_OF_SPEECH:
+    case DETECT_EVENT_TIMEOUT:
+        if (event == DETECT_EVENT_END_OF_SPEECH) {
+            metrics_inc(voice_metrics.endpointed);
+            trace_span_since(trace_current(), "endpoint", wake_detected_us);
+        } else {
+            metrics_inc(voice_metrics.command_timeouts);
+            trace_span_since(trace_current(), "multinet_timeout", wake_detected_us);
+        }
+        led_engine_clear(LED_LAYER_LISTEN);  // Return to idle animation
+        // Resume background audio after command processing
+        audio_ctl_resume(AUDIO_CTL_PAUSE_LISTENING);
+        system_status.is_listening = true;
+        system_status.is_recognizing = false;
+        system_status.is_processing = false;
+        ESP_LOGI(TAG, "Background audio resumed (returning to idle)");
+        printf("\n-----------awaits to be waken up-----------\n");
+        break;
+    }
+    system_status.last_activity = xTaskGetTickCount();
+}
+
+// ESP-SR detect task: fetches AFE results and steps the detect state machine
 static void detect_Task(void *arg)
 {
     esp_afe_sr_data_t *afe_data = arg;
@@ -2840,21 +3007,37 @@ static void detect_Task(void *arg)
     esp_mn_iface_t *multinet = esp_mn_handle_from_name(mn_name);
     model_iface_data_t *model_data = multinet->create(mn_name, 6000);
     int mu_chunksize = multinet->get_samp_chunksize(model_data);
-    esp_mn_commands_update_from_sdkconfig(multinet, model_data); // Add speech commands from sdkconfig (includes ID 32 with phonemes)
-    
-    // Note: Command ID 32 "run the demo" should be loaded from sdkconfig with phonemes "Rn jc DgMmO"
-    // If it's not in sdkconfig, it won't be registered. Check sdkconfig.defaults.esp32s3 for CONFIG_EN_SPEECH_COMMAND_ID32
-    ESP_LOGI(TAG, "Commands loaded from sdkconfig (ID 32 should be 'Rn jc DgMmO' if configured)");
+    // Speech commands come from the runtime registry (main/commands.yaml or
+    // a blob pushed to /api/commands)
+    esp_err_t reg_ret = command_registry_apply(multinet, model_data);
+    if (reg_ret != ESP_OK) {
+        ESP_LOGE(TAG, "No speech commands registered: %s", esp_err_to_name(reg_ret));
+    }
+    local_intents_bind_commands();
     
     assert(mu_chunksize == afe_chunksize);
     //print active speech commands
     ESP_LOGI(TAG, "=== Registered Speech Commands ===");
     multinet->print_active_speech_commands(model_data);
     ESP_LOGI(TAG, "=== End Registered Commands ===");
-    
-    // Verify "run the demo" command is registered
-    ESP_LOGI(TAG, "Checking for 'run the demo' command (ID 32)...");
-    // Note: We can't directly query commands, but print_active_speech_commands should show it
+
+    detect_ctx_t ctx = {
+        .multinet = multinet,
+        .model_data = model_data,
+        .afe_data = afe_data,
+    };
+    const detect_ops_t ops = {
+        .ctx = &ctx,
+        .detect = detect_mn_detect,
+        .get_results = detect_mn_results,
+        .clean = detect_mn_clean,
+        .enable_wakenet = detect_enable_wakenet,
+        .run_command = detect_run_command,
+        .fallback = start_stt_fallback,
+        .transition = detect_transition,
+    };
+    detect_fsm_t fsm;
+    detect_fsm_init(&fsm, &ops);
 
     printf("------------detect start------------\n");
     while (task_flag) {
@@ -2863,252 +3046,18 @@ static void detect_Task(void *arg)
             printf("fetch error!\n");
             break;
         }
-
-        if (res->wakeup_state == WAKENET_DETECTED) {
-            printf("WAKEWORD DETECTED\n");
-            system_status.is_listening = false;
-            system_status.is_recognizing = true;
-            system_status.last_activity = xTaskGetTickCount();
-	        multinet->clean(model_data);
-            led_wake_word_detected(); // Illuminate ears
-            // Pause background audio when wake word detected
-            background_audio_paused = true;
-            ESP_LOGI(TAG, "Background audio paused (wake word detected)");
-        }
-
-        if (res->raw_data_channels == 1 && res->wakeup_state == WAKENET_DETECTED) {
-            wakeup_flag = 1;
-            led_wake_word_detected(); // Illuminate ears
-        } else if (res->raw_data_channels > 1 && res->wakeup_state == WAKENET_CHANNEL_VERIFIED) {
-            // For a multi-channel AFE, it is necessary to wait for the channel to be verified.
-            printf("AFE_FETCH_CHANNEL_VERIFIED, channel index: %d\n", res->trigger_channel_id);
-            wakeup_flag = 1;
-            led_wake_word_detected(); // Illuminate ears
-        }
-
-        if (wakeup_flag == 1) {
-            // Buffer audio during detection for STT fallback
-            static int16_t *audio_buffer = NULL;
-            static size_t audio_buffer_size = 0;
-            static size_t audio_buffer_pos = 0;
-            static bool buffer_initialized = false;
-            const size_t max_audio_samples = 16000 * 5;  // 5 seconds at 16kHz
-            
-            // Initialize buffer on first detection after wake word
-            if (!buffer_initialized) {
-                audio_buffer_size = max_audio_samples;
-                audio_buffer = malloc(audio_buffer_size * sizeof(int16_t));
-                audio_buffer_pos = 0;
-                buffer_initialized = true;
-                ESP_LOGI(TAG, "Audio buffer initialized: %zu samples", audio_buffer_size);
-            }
-            
-            // Buffer audio data (res->data is int16_t array, size is afe_chunksize)
-            if (audio_buffer && audio_buffer_pos + afe_chunksize <= audio_buffer_size) {
-                memcpy(audio_buffer + audio_buffer_pos, res->data, afe_chunksize * sizeof(int16_t));
-                audio_buffer_pos += afe_chunksize;
-            } else if (audio_buffer_pos + afe_chunksize > audio_buffer_size) {
-                ESP_LOGW(TAG, "Audio buffer full! (%zu/%zu samples)", audio_buffer_pos, audio_buffer_size);
-            }
-            
-            esp_mn_state_t mn_state = multinet->detect(model_data, res->data);
-
-            if (mn_state == ESP_MN_STATE_DETECTING) {
-                // Command detection in progress - show progress
-                static int detecting_count = 0;
-                detecting_count++;
-                system_status.is_recognizing = true;
-                system_status.last_activity = xTaskGetTickCount();
-                if (detecting_count == 1) {
-                    ESP_LOGI(TAG, "Command detection started - listening for command...");
-                }
-                if (detecting_count % 20 == 0) {  // Log every 20 iterations to avoid spam
-                    ESP_LOGI(TAG, "Still detecting... (iteration %d)", detecting_count);
-                }
-                continue;
-            }
-
-            if (mn_state == ESP_MN_STATE_DETECTED) {
-                esp_mn_results_t *mn_result = multinet->get_results(model_data);
-                
-                // Enhanced debug output with phoneme information
-                ESP_LOGI(TAG, "=== Local Command Detection Results ===");
-                for (int i = 0; i < mn_result->num; i++) {
-                    int cmd_id = mn_result->command_id[i];
-                    int phrase_id = mn_result->phrase_id[i];
-                    const char *detected_string = mn_result->string;
-                    float prob = mn_result->prob[i];
-                    
-                    // Get expected phonemes for this command ID
-                    const char *expected_phonemes = get_expected_phonemes(cmd_id);
-                    
-                    ESP_LOGI(TAG, "TOP %d: command_id=%d, phrase_id=%d, prob=%.3f", 
-                             i+1, cmd_id, phrase_id, prob);
-                    ESP_LOGI(TAG, "  Detected phonemes: '%s'", detected_string ? detected_string : "NULL");
-                    ESP_LOGI(TAG, "  Expected phonemes: '%s'", expected_phonemes);
-                    
-                    // Compare detected vs expected
-                    if (detected_string && strlen(detected_string) > 0) {
-                        if (strcmp(detected_string, expected_phonemes) == 0) {
-                            ESP_LOGI(TAG, "  ✓ Phonemes match expected!");
-                        } else {
-                            ESP_LOGW(TAG, "  ✗ Phoneme mismatch! Detected='%s' vs Expected='%s'", 
-                                     detected_string, expected_phonemes);
-                        }
-                    } else {
-                        ESP_LOGW(TAG, "  ⚠ No phonemes detected in result string");
-                    }
-                }
-                ESP_LOGI(TAG, "=== End Detection Results ===");
-                
-                // Also print in original format for compatibility
-                for (int i = 0; i < mn_result->num; i++) {
-                    printf("TOP %d, command_id: %d, phrase_id: %d, string: %s, prob: %f\n", 
-                    i+1, mn_result->command_id[i], mn_result->phrase_id[i], mn_result->string, mn_result->prob[i]);
-                }
-                
-                // Execute the top command (highest probability)
-                bool command_handled = false;
-                system_status.is_processing = true;
-                system_status.last_activity = xTaskGetTickCount();
-                if (mn_result->num > 0) {
-                    ESP_LOGI(TAG, "Executing top command: id=%d, phonemes='%s'", 
-                             mn_result->command_id[0], mn_result->string ? mn_result->string : "NULL");
-                    command_handled = speech_commands_action_with_string(mn_result->command_id[0], mn_result->string);
-                }
-                
-                // If command was not handled, use STT/LLM/TTS fallback
-                if (!command_handled && audio_buffer && audio_buffer_pos > 0) {
-                    ESP_LOGI(TAG, "Command not handled locally, using STT/LLM/TTS fallback");
-                    led_command_understood();
-                    
-                    // Create task to handle STT/LLM/TTS (runs on core 0)
-                    struct {
-                        int16_t *audio;
-                        size_t audio_len;
-                    } *stt_data = malloc(sizeof(*stt_data));
-                    if (stt_data) {
-                        stt_data->audio = malloc(audio_buffer_pos * sizeof(int16_t));
-                        if (stt_data->audio) {
-                            memcpy(stt_data->audio, audio_buffer, audio_buffer_pos * sizeof(int16_t));
-                            stt_data->audio_len = audio_buffer_pos;
-                            
-                            xTaskCreatePinnedToCore(
-                                stt_llm_tts_task,
-                                "stt_llm_tts",
-                                16384,  // Larger stack for HTTP operations
-                                stt_data,
-                                3,  // Lower priority
-                                NULL,
-                                0   // Core 0
-                            );
-                        } else {
-                            free(stt_data);
-                        }
-                    }
-                }
-                
-                // Reset audio buffer for next command
-                audio_buffer_pos = 0;
-                buffer_initialized = false;  // Re-initialize on next wake word
-                // Resume background audio after command is processed
-                background_audio_paused = false;
-                system_status.is_listening = true;
-                system_status.is_recognizing = false;
-                system_status.is_processing = false;
-                system_status.last_activity = xTaskGetTickCount();
-                ESP_LOGI(TAG, "Background audio resumed (command processed)");
-                printf("-----------listening-----------\n");
-            }
-
-            if (mn_state == ESP_MN_STATE_TIMEOUT) {
-                esp_mn_results_t *mn_result = multinet->get_results(model_data);
-                ESP_LOGW(TAG, "=== Command Detection Timeout ===");
-                ESP_LOGW(TAG, "Timeout string: '%s'", mn_result->string ? mn_result->string : "NULL");
-                ESP_LOGW(TAG, "Number of results: %d", mn_result->num);
-                
-                // Show all results even on timeout
-                for (int i = 0; i < mn_result->num; i++) {
-                    ESP_LOGW(TAG, "  Result %d: command_id=%d, phrase_id=%d, string='%s', prob=%.3f",
-                             i+1, mn_result->command_id[i], mn_result->phrase_id[i], 
-                             mn_result->string ? mn_result->string : "NULL", mn_result->prob[i]);
-                }
-                ESP_LOGW(TAG, "=== End Timeout Results ===");
-                
-                // Always try STT/LLM fallback on timeout if we have audio
-                // This handles cases like "demo" that aren't recognized locally
-                ESP_LOGI(TAG, "Timeout occurred - checking for audio buffer...");
-                ESP_LOGI(TAG, "Audio buffer pointer: %p, position: %zu", audio_buffer, audio_buffer ? audio_buffer_pos : 0);
-                
-                if (audio_buffer && audio_buffer_pos > 0) {
-                    ESP_LOGI(TAG, "=== TIMEOUT: Using STT/LLM/TTS Fallback ===");
-                    ESP_LOGI(TAG, "Audio buffer: %zu samples (%zu bytes, %.2f seconds)", 
-                             audio_buffer_pos, audio_buffer_pos * sizeof(int16_t), 
-                             (float)audio_buffer_pos / 16000.0f);
-                    led_command_understood();
-                    
-                    struct {
-                        int16_t *audio;
-                        size_t audio_len;
-                    } *stt_data = malloc(sizeof(*stt_data));
-                    if (stt_data) {
-                        stt_data->audio = malloc(audio_buffer_pos * sizeof(int16_t));
-                        if (stt_data->audio) {
-                            memcpy(stt_data->audio, audio_buffer, audio_buffer_pos * sizeof(int16_t));
-                            stt_data->audio_len = audio_buffer_pos;
-                            
-                            ESP_LOGI(TAG, "Creating STT/LLM/TTS task with %zu audio samples", audio_buffer_pos);
-                            BaseType_t task_ret = xTaskCreatePinnedToCore(
-                                stt_llm_tts_task,
-                                "stt_llm_tts",
-                                16384,
-                                stt_data,
-                                3,
-                                NULL,
-                                0
-                            );
-                            if (task_ret != pdPASS) {
-                                ESP_LOGE(TAG, "Failed to create STT/LLM/TTS task!");
-                                free(stt_data->audio);
-                                free(stt_data);
-                            } else {
-                                ESP_LOGI(TAG, "STT/LLM/TTS task created successfully");
-                            }
-                        } else {
-                            ESP_LOGE(TAG, "Failed to allocate memory for audio buffer copy");
-                            free(stt_data);
-                        }
-                    } else {
-                        ESP_LOGE(TAG, "Failed to allocate memory for STT data");
-                    }
-                    // Reset buffer after copying
-                    audio_buffer_pos = 0;
-                    buffer_initialized = false;
-                } else {
-                    ESP_LOGW(TAG, "✗ Timeout but no audio buffer available!");
-                    ESP_LOGW(TAG, "  Buffer pointer: %p, Position: %zu", 
-                             audio_buffer, audio_buffer ? audio_buffer_pos : 0);
-                    ESP_LOGW(TAG, "  This means audio wasn't captured during detection");
-                }
-                
-                afe_handle->enable_wakenet(afe_data);
-                wakeup_flag = 0;
-                if (xSemaphoreTake(led_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-                    current_led_state = LED_STATE_IDLE;  // Return to idle animation
-                    led_clear_all();  // Clear LEDs for idle state
-                    xSemaphoreGive(led_mutex);
-                }
-                // Resume background audio after command processing
-                background_audio_paused = false;
-                system_status.is_listening = true;
-                system_status.is_recognizing = false;
-                system_status.is_processing = false;
-                system_status.last_activity = xTaskGetTickCount();
-                ESP_LOGI(TAG, "Background audio resumed (returning to idle)");
-                printf("\n-----------awaits to be waken up-----------\n");
-                continue;
+        // First frame in: the wake word can be heard from here on
+        boot_seq_ready(BOOT_READY_WAKE);
+
+        // Swap in a registry pushed over HTTP while no command is in flight
+        if (fsm.state == DETECT_IDLE && command_registry_update_pending()) {
+            if (command_registry_apply(multinet, model_data) == ESP_OK) {
+                local_intents_bind_commands();
+                multinet->print_active_speech_commands(model_data);
             }
         }
+
+        detect_fsm_step(&fsm, res, afe_chunksize);
     }
     if (model_data) {
         multinet->destroy(model_data);
@@ -3118,152 +3067,123 @@ static void detect_Task(void *arg)
     vTaskDelete(NULL);
 }
 
-void app_main(void)
+// Boot steps, in the order the workers pick them up when several are runnable:
+// the wake word path (models, board, afe) and Wi-Fi first
+enum {
+    BOOT_STEP_MODELS,
+    BOOT_STEP_BOARD,
+    BOOT_STEP_WIFI,
+    BOOT_STEP_AFE,
+    BOOT_STEP_LED,
+    BOOT_STEP_BG_AUDIO,
+    BOOT_STEP_TASK_STATS,
+    BOOT_STEP_TELEMETRY,
+    BOOT_STEP_WEB,
+    BOOT_STEP_MQTT,
+    BOOT_STEP_COUNT,
+};
+
+static bool nvs_available = false;  // WiFi driver requires NVS for credential storage
+
+static esp_err_t boot_wifi(void)
 {
-    ESP_LOGI(TAG, "Naphome Phase 0.9 Test Suite");
+    if (!nvs_available) {
+        ESP_LOGI(TAG, "NVS not available, skipping WiFi initialization (demo mode)");
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    esp_err_t ret = esp_netif_init();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Network stack init failed: %s, skipping WiFi", esp_err_to_name(ret));
+        return ret;
+    }
+    ret = esp_event_loop_create_default();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Event loop init failed: %s, skipping WiFi", esp_err_to_name(ret));
+        return ret;
+    }
     
-    // Initialize NVS (required for WiFi - WiFi driver stores credentials in NVS)
-    ESP_LOGI(TAG, "Initializing NVS (required for WiFi)...");
-    esp_err_t nvs_ret = nvs_flash_init();
-    if (nvs_ret == ESP_ERR_NVS_NO_FREE_PAGES || nvs_ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_LOGW(TAG, "NVS partition needs erasing, erasing now...");
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        nvs_ret = nvs_flash_init();
-    } else if (nvs_ret == ESP_ERR_NOT_FOUND) {
-        ESP_LOGE(TAG, "NVS partition not found! Check partition table includes NVS partition.");
-        ESP_LOGE(TAG, "NVS init failed: %s - WiFi will not be available", esp_err_to_name(nvs_ret));
+    // Readiness bits follow the Wi-Fi and IP events from here on
+    ret = connectivity_init();
+    if (ret != ESP_OK) {
+        return ret;
     }
-    bool nvs_available = (nvs_ret == ESP_OK);
-    if (!nvs_available) {
-        ESP_LOGE(TAG, "NVS init failed: %s - WiFi will not be available", esp_err_to_name(nvs_ret));
-    } else {
-        ESP_LOGI(TAG, "NVS initialized successfully");
+    
+    // Cloud connections opened at the wake word
+    ret = prewarm_init();
+    if (ret != ESP_OK) {
+        return ret;
     }
+    prewarm_set_target(PREWARM_STT, GOOGLE_STT_HOST, STT_TIMEOUT_MS);
+    prewarm_set_target(PREWARM_LLM, GEMINI_LLM_HOST, LLM_TIMEOUT_MS);
+    prewarm_set_target(PREWARM_TTS, GOOGLE_TTS_HOST, TTS_TIMEOUT_MS);
     
-    // Initialize network stack and WiFi only if NVS is available
-    // WiFi driver requires NVS for credential storage
-    if (nvs_available) {
-        ESP_LOGI(TAG, "NVS initialized, initializing network stack and WiFi...");
-        esp_err_t netif_ret = esp_netif_init();
-        if (netif_ret != ESP_OK) {
-            ESP_LOGW(TAG, "Network stack init failed: %s, skipping WiFi", esp_err_to_name(netif_ret));
-            nvs_available = false;  // Disable WiFi if network stack fails
-        } else {
-            esp_err_t event_ret = esp_event_loop_create_default();
-            if (event_ret != ESP_OK) {
-                ESP_LOGW(TAG, "Event loop init failed: %s, skipping WiFi", esp_err_to_name(event_ret));
-                nvs_available = false;
-            } else {
-                // Give TCP/IP stack time to initialize
-                vTaskDelay(pdMS_TO_TICKS(500));
-                
-                // Initialize WiFi (credentials are hardcoded)
-                ESP_LOGI(TAG, "Initializing WiFi...");
-                esp_netif_t *sta_netif = esp_netif_create_default_wifi_sta();
-                if (!sta_netif) {
-                    ESP_LOGW(TAG, "Failed to create WiFi STA netif, skipping WiFi");
-                    nvs_available = false;
-                } else {
-                    // Register WiFi event handlers for connection status
-                    esp_err_t handler_ret1 = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event_handler, NULL);
-                    esp_err_t handler_ret2 = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, wifi_event_handler, NULL);
-                    if (handler_ret1 != ESP_OK || handler_ret2 != ESP_OK) {
-                        ESP_LOGW(TAG, "Failed to register WiFi event handlers, skipping WiFi");
-                        nvs_available = false;
-                    } else {
-                        wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-                        esp_err_t wifi_init_ret = esp_wifi_init(&cfg);
-                        if (wifi_init_ret != ESP_OK) {
-                            ESP_LOGW(TAG, "WiFi init failed: %s, skipping WiFi", esp_err_to_name(wifi_init_ret));
-                            nvs_available = false;
-                        } else {
-                            esp_err_t mode_ret = esp_wifi_set_mode(WIFI_MODE_STA);
-                            if (mode_ret != ESP_OK) {
-                                ESP_LOGW(TAG, "WiFi set mode failed: %s, skipping WiFi", esp_err_to_name(mode_ret));
-                                nvs_available = false;
-                            } else {
-                                // Set country code to fix regulatory domain linker issue in ESP-IDF 5.4.3
-                                wifi_country_t country = {
-                                    .cc = "US",
-                                    .schan = 1,
-                                    .nchan = 11,
-                                    .policy = WIFI_COUNTRY_POLICY_AUTO,
-                                };
-                                esp_err_t country_ret = esp_wifi_set_country(&country);
-                                if (country_ret != ESP_OK) {
-                                    ESP_LOGW(TAG, "WiFi set country failed: %s, continuing anyway", esp_err_to_name(country_ret));
-                                }
-                                
-                                esp_err_t start_ret = esp_wifi_start();
-                                if (start_ret != ESP_OK) {
-                                    ESP_LOGW(TAG, "WiFi start failed: %s, skipping WiFi", esp_err_to_name(start_ret));
-                                    nvs_available = false;
-                                } else {
-                                    ESP_LOGI(TAG, "WiFi started, connecting...");
-                                    
-                                    // Connect to WiFi
-                                    wifi_config_t wifi_config = {
-                                        .sta = {
-                                            .ssid = "The Chateau",
-                                            .password = "thechateau",
-                                            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
-                                        },
-                                    };
-                                    ESP_LOGI(TAG, "Connecting to WiFi SSID: %s", wifi_config.sta.ssid);
-                                    esp_err_t config_ret = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
-                                    if (config_ret != ESP_OK) {
-                                        ESP_LOGW(TAG, "WiFi config failed: %s", esp_err_to_name(config_ret));
-                                    }
-                                    esp_err_t connect_ret = esp_wifi_connect();
-                                    if (connect_ret != ESP_OK) {
-                                        ESP_LOGW(TAG, "WiFi connect failed: %s", esp_err_to_name(connect_ret));
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    } else {
-        ESP_LOGI(TAG, "NVS not available, skipping WiFi initialization (demo mode)");
+    // Cloud calls fail at once while their API is known to be down, and
+    // time out after a multiple of their observed latency
+    ret = cloud_breakers_init();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    cloud_latency_init();
+    
+    // Boot announces the network once the station has an address
+    ret = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, wifi_event_handler, NULL);
+    if (ret != ESP_OK) {
+        return ret;
     }
     
+    // Credentials are hardcoded; the manager reconnects to the last AP on its channel first
+    wifi_manager_config_t wifi_config = WIFI_MANAGER_DEFAULT_CONFIG();
+    wifi_config.ssid = "The Chateau";
+    wifi_config.password = "thechateau";
+    return wifi_manager_start(&wifi_config);
+}
+
+static esp_err_t boot_models(void)
+{
     // EXACT COPY from working example - no modifications
     models = esp_srmodel_init("model"); // partition label defined in partitions.csv
-    
+    return models ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t boot_board(void)
+{
     // Initialize board hardware (I2C, audio, etc.)
     // This must be called before any other hardware access
-    // Initialize board (audio system) - use 2 channels for ESP-SR input at 16kHz
-    // Playback at 44.1kHz (standard MP3/CD sample rate)
-    ESP_LOGI(TAG, "Initializing board hardware...");
     // Input: 16kHz for ESP-SR, Playback: 44.1kHz for MP3 and TTS (standardized)
-    // Initialize board hardware at 44.1kHz (standard MP3/CD sample rate)
     // This matches MP3 files and Google TTS output, avoiding reconfiguration
-    ESP_ERROR_CHECK(esp_board_init(44100, 2, 16));
+    ESP_LOGI(TAG, "Initializing board hardware...");
+    return esp_board_init(44100, 2, 16);
     // ESP_ERROR_CHECK(esp_sdcard_init("/sdcard", 10));
-    
-    // WAV and TTS disabled per user request
+}
 
+static esp_err_t boot_afe(void)
+{
 #if CONFIG_IDF_TARGET_ESP32
     printf("This demo only support ESP32S3\n");
-    return;
+    return ESP_ERR_NOT_SUPPORTED;
 #else 
     afe_config_t *afe_config = afe_config_init(esp_get_input_format(), models, AFE_TYPE_SR, AFE_MODE_LOW_COST);
     afe_handle = esp_afe_handle_from_config(afe_config);
     esp_afe_sr_data_t *afe_data = afe_handle->create_from_config(afe_config);
     afe_config_free(afe_config);
-#endif
+    if (!afe_data) {
+        return ESP_ERR_NO_MEM;
+    }
 
     task_flag = 1;
     xTaskCreatePinnedToCore(&detect_Task, "detect", 8 * 1024, (void*)afe_data, 5, NULL, 1);
     xTaskCreatePinnedToCore(&feed_Task, "feed", 8 * 1024, (void*)afe_data, 5, NULL, 0);
-    
+    return ESP_OK;
+#endif
+}
+
+static esp_err_t boot_bg_audio(void)
+{
     // Start background audio playback task (plays WAV/MP3 in loop during idle)
     // Runs on core 0 with lower priority so it doesn't interfere with voice recognition
     // Increased stack size for MP3 decoder (minimp3 needs significant stack space)
     ESP_LOGI(TAG, "Starting background audio playback task");
-    xTaskCreatePinnedToCore(
+    if (xTaskCreatePinnedToCore(
         background_audio_task,
         "bg_audio",
         16384,  // Increased stack size for MP3 decoder (was 8192)
@@ -3271,14 +3191,19 @@ void app_main(void)
         2,     // Lower priority than voice recognition tasks
         NULL,
         0      // Core 0
-    );
-    
+    ) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t boot_led(void)
+{
     // Initialize LED strip (always, independent of NVS)
     led_init();
     
-    // Start LED animation task for idle eye movement
-    current_led_state = LED_STATE_IDLE;
-    xTaskCreatePinnedToCore(
+    // Start LED status task; it puts the idle eye animation on the engine
+    if (xTaskCreatePinnedToCore(
         led_animation_task,
         "led_animation",
         2048,
@@ -3286,11 +3211,113 @@ void app_main(void)
         3,
         NULL,
         1
-    );
+    ) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t boot_task_stats(void)
+{
+    // CPU/stack/heap sampler behind /api/status and /api/metrics
+    return task_stats_start(0);
+}
+
+static esp_err_t boot_web(void)
+{
+    return web_server_start();
+}
+
+static esp_err_t boot_telemetry(void)
+{
+    // Batched telemetry pipeline, published over MQTT when the network is up
+    esp_err_t ret = telemetry_init(NULL);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (xTaskCreatePinnedToCore(
+        telemetry_sampler_task,
+        "telemetry",
+        4096,
+        NULL,
+        2,     // Same priority as background audio
+        NULL,
+        0      // Core 0
+    ) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t boot_mqtt(void)
+{
+    if (strlen(MQTT_BROKER_URI) == 0) {
+        ESP_LOGW(TAG, "No MQTT broker configured, telemetry stays local");
+        return ESP_OK;
+    }
+    mqtt_publisher_config_t mqtt_config = MQTT_PUBLISHER_DEFAULT_CONFIG();
+    mqtt_config.broker_uri = MQTT_BROKER_URI;
+    esp_err_t ret = mqtt_publisher_start(&mqtt_config);
+    if (ret == ESP_OK) {
+        telemetry_set_sink(telemetry_mqtt_sink, NULL);
+    }
+    return ret;
+}
+
+void app_main(void)
+{
+    ESP_LOGI(TAG, "Naphome Phase 0.9 Test Suite");
+    boot_seq_init();
     
-    // Initial idle animation
-    if (strip) {
-        led_idle_animation();
+    // Register voice path metrics, tracing, local intents and the capture ring before any task uses them
+    voice_metrics_init();
+    trace_init();
+    local_intents_init();
+    audio_capture_init();
+    action_executor_init();
+    audio_ctl_init();
+    sensors_init();
+    
+    // Initialize NVS (required for WiFi - WiFi driver stores credentials in NVS)
+    ESP_LOGI(TAG, "Initializing NVS (required for WiFi)...");
+    esp_err_t nvs_ret = nvs_flash_init();
+    if (nvs_ret == ESP_ERR_NVS_NO_FREE_PAGES || nvs_ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_LOGW(TAG, "NVS partition needs erasing, erasing now...");
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        nvs_ret = nvs_flash_init();
+    } else if (nvs_ret == ESP_ERR_NOT_FOUND) {
+        ESP_LOGE(TAG, "NVS partition not found! Check partition table includes NVS partition.");
+        ESP_LOGE(TAG, "NVS init failed: %s - WiFi will not be available", esp_err_to_name(nvs_ret));
+    }
+    nvs_available = (nvs_ret == ESP_OK);
+    if (!nvs_available) {
+        ESP_LOGE(TAG, "NVS init failed: %s - WiFi will not be available", esp_err_to_name(nvs_ret));
+    } else {
+        ESP_LOGI(TAG, "NVS initialized successfully");
+    }
+    
+    // Speech commands: registry pushed over HTTP (NVS) or the built-in commands.yaml
+    command_registry_init();
+    
+    // Everything else is a dependency graph run on the boot workers: Wi-Fi
+    // association, model loading and codec init overlap, and the wake word
+    // detector starts as soon as its own inputs are ready
+    static const boot_step_t boot_steps[BOOT_STEP_COUNT] = {
+        [BOOT_STEP_MODELS]     = { "models",     boot_models,     0 },
+        [BOOT_STEP_BOARD]      = { "board",      boot_board,      0 },
+        [BOOT_STEP_WIFI]       = { "wifi",       boot_wifi,       0, BOOT_READY_NETWORK },
+        [BOOT_STEP_AFE]        = { "afe",        boot_afe,        BOOT_DEP(BOOT_STEP_MODELS) | BOOT_DEP(BOOT_STEP_BOARD),
+                                   BOOT_READY_WAKE },
+        [BOOT_STEP_LED]        = { "led",        boot_led,        0 },
+        [BOOT_STEP_BG_AUDIO]   = { "bg_audio",   boot_bg_audio,   BOOT_DEP(BOOT_STEP_BOARD) },
+        [BOOT_STEP_TASK_STATS] = { "task_stats", boot_task_stats, 0 },
+        // Sensors and the web handlers that read them sit on the board's I2C bus
+        [BOOT_STEP_TELEMETRY]  = { "telemetry",  boot_telemetry,  BOOT_DEP(BOOT_STEP_BOARD) },
+        [BOOT_STEP_WEB]        = { "web",        boot_web,        BOOT_DEP(BOOT_STEP_WIFI) | BOOT_DEP(BOOT_STEP_BOARD) },
+        [BOOT_STEP_MQTT]       = { "mqtt",       boot_mqtt,       BOOT_DEP(BOOT_STEP_WIFI) | BOOT_DEP(BOOT_STEP_TELEMETRY) },
+    };
+    if (boot_seq_run(boot_steps, BOOT_STEP_COUNT) != ESP_OK) {
+        ESP_LOGW(TAG, "Boot finished with failed steps, see the table above or /api/boot");
     }
     
     ESP_LOGI(TAG, "Voice recognition initialized. Say 'Hi ESP' followed by 'run the demo' to start the test suite.");
@@ -0,0 +1,296 @@
+/**
+ * @file prewarm.c
+ * @brief Background connection opening for the cloud request hosts
+ */
+
+#include "prewarm.h"
+#include "connectivity.h"
+#include "metrics.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "prewarm";
+
+#define WORK_BIT            (1 << 0)                    // Targets queued or cancelled
+#define DONE_BIT(target)    (1 << (1 + (target)))       // Handshake for target finished
+
+typedef enum {
+    SLOT_IDLE,
+    SLOT_QUEUED,        // prewarm_start() asked, the task hasn't got to it yet
+    SLOT_CONNECTING,
+    SLOT_WARM,          // client holds an open connection
+} slot_state_t;
+
+typedef struct {
+    char url[PREWARM_MAX_URL];
+    int timeout_ms;
+    slot_state_t state;
+    bool cancelled;                     // prewarm_cancel() while connecting
+    esp_http_client_handle_t client;
+    int64_t start_us;                   // Handshake started
+    int64_t connected_us;               // Transport connected (0: not yet)
+    int64_t warm_us;                    // Connection ready for use
+} prewarm_slot_t;
+
+static prewarm_slot_t slots[PREWARM_TARGET_COUNT];
+static SemaphoreHandle_t slot_mutex = NULL;     // Guards slots
+static EventGroupHandle_t prewarm_events = NULL;
+
+static struct {
+    metrics_metric_t *used;
+    metrics_metric_t *wasted;
+    metrics_metric_t *failed;
+    metrics_metric_t *saved;
+} prewarm_metrics;
+
+static esp_err_t prewarm_event_handler(esp_http_client_event_t *evt)
+{
+    prewarm_slot_t *slot = evt->user_data;
+    if (slot && evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+        slot->connected_us = esp_timer_get_time();
+    }
+    return ESP_OK;
+}
+
+// Close a client taken out of its slot (outside slot_mutex: TLS teardown can block)
+static void discard_client(esp_http_client_handle_t client)
+{
+    if (client) {
+        esp_http_client_cleanup(client);
+        metrics_inc(prewarm_metrics.wasted);
+    }
+}
+
+// Detach a warm client that has been open longer than max_age_ms (caller holds slot_mutex)
+static esp_http_client_handle_t detach_if_older_locked(prewarm_slot_t *slot, int64_t now, uint32_t max_age_ms)
+{
+    if (slot->state != SLOT_WARM || now - slot->warm_us < (int64_t)max_age_ms * 1000) {
+        return NULL;
+    }
+    esp_http_client_handle_t client = slot->client;
+    slot->client = NULL;
+    slot->state = SLOT_IDLE;
+    return client;
+}
+
+static void connect_slot(prewarm_target_t target)
+{
+    prewarm_slot_t *slot = &slots[target];
+    esp_http_client_config_t config = {
+        .url = slot->url,
+        .method = HTTP_METHOD_HEAD,
+        .timeout_ms = slot->timeout_ms,
+        .event_handler = prewarm_event_handler,
+        .user_data = slot,
+    };
+    slot->start_us = esp_timer_get_time();
+    slot->connected_us = 0;
+
+    // Any response will do: what matters is the keep-alive connection it leaves open
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    esp_err_t err = client ? esp_http_client_perform(client) : ESP_ERR_NO_MEM;
+    if (client) {
+        esp_http_client_set_user_data(client, NULL);
+    }
+
+    xSemaphoreTake(slot_mutex, portMAX_DELAY);
+    bool cancelled = slot->cancelled;
+    slot->cancelled = false;
+    if (err == ESP_OK && !cancelled) {
+        slot->client = client;
+        slot->warm_us = esp_timer_get_time();
+        slot->state = SLOT_WARM;
+        client = NULL;
+    } else {
+        slot->state = SLOT_IDLE;
+    }
+    xSemaphoreGive(slot_mutex);
+    xEventGroupSetBits(prewarm_events, DONE_BIT(target));
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "%s: %s", slot->url, esp_err_to_name(err));
+        metrics_inc(prewarm_metrics.failed);
+        if (client) {
+            esp_http_client_cleanup(client);
+        }
+    } else if (cancelled) {
+        discard_client(client);
+    } else {
+        ESP_LOGD(TAG, "%s warm in %lld ms", slot->url, (long long)((slot->warm_us - slot->start_us) / 1000));
+    }
+}
+
+static void prewarm_task(void *arg)
+{
+    while (true) {
+        // Sleep until there is work or the oldest warm connection expires
+        TickType_t wait = portMAX_DELAY;
+        int64_t now = esp_timer_get_time();
+        xSemaphoreTake(slot_mutex, portMAX_DELAY);
+        for (int t = 0; t < PREWARM_TARGET_COUNT; t++) {
+            if (slots[t].state == SLOT_WARM) {
+                int64_t left_ms = (slots[t].warm_us + (int64_t)PREWARM_MAX_AGE_MS * 1000 - now) / 1000;
+                TickType_t ticks = left_ms > 0 ? pdMS_TO_TICKS(left_ms) + 1 : 0;
+                wait = ticks < wait ? ticks : wait;
+            }
+        }
+        xSemaphoreGive(slot_mutex);
+        xEventGroupWaitBits(prewarm_events, WORK_BIT, pdTRUE, pdFALSE, wait);
+
+        now = esp_timer_get_time();
+        for (int t = 0; t < PREWARM_TARGET_COUNT; t++) {
+            xSemaphoreTake(slot_mutex, portMAX_DELAY);
+            esp_http_client_handle_t expired = detach_if_older_locked(&slots[t], now, PREWARM_MAX_AGE_MS);
+            bool queued = slots[t].state == SLOT_QUEUED;
+            if (queued) {
+                slots[t].state = SLOT_CONNECTING;
+                xEventGroupClearBits(prewarm_events, DONE_BIT(t));
+            }
+            xSemaphoreGive(slot_mutex);
+
+            discard_client(expired);
+            if (queued) {
+                connect_slot((prewarm_target_t)t);
+            }
+        }
+    }
+}
+
+esp_err_t prewarm_init(void)
+{
+    if (slot_mutex) {
+        return ESP_OK;
+    }
+    slot_mutex = xSemaphoreCreateMutex();
+    prewarm_events = xEventGroupCreate();
+    if (!slot_mutex || !prewarm_events) {
+        return ESP_ERR_NO_MEM;
+    }
+    prewarm_metrics.used = metrics_counter("naphome_prewarm_total", "result=\"used\"",
+                                           "Connections opened at the wake word, by outcome");
+    prewarm_metrics.wasted = metrics_counter("naphome_prewarm_total", "result=\"wasted\"",
+                                             "Connections opened at the wake word, by outcome");
+    prewarm_metrics.failed = metrics_counter("naphome_prewarm_total", "result=\"failed\"",
+                                             "Connections opened at the wake word, by outcome");
+    prewarm_metrics.saved = metrics_histogram("naphome_prewarm_saved_seconds", NULL,
+                                              "Connection setup a request skipped by using a warm connection");
+    if (xTaskCreatePinnedToCore(prewarm_task, "prewarm", PREWARM_TASK_STACK, NULL,
+                                PREWARM_TASK_PRIORITY, NULL, 0) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t prewarm_set_target(prewarm_target_t target, const char *base_url, int timeout_ms)
+{
+    if (!slot_mutex || target >= PREWARM_TARGET_COUNT || !base_url) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(slot_mutex, portMAX_DELAY);
+    int n = snprintf(slots[target].url, sizeof(slots[target].url), "%s/", base_url);
+    slots[target].timeout_ms = timeout_ms;
+    xSemaphoreGive(slot_mutex);
+    return n < (int)sizeof(slots[target].url) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+void prewarm_start(uint32_t targets)
+{
+    if (!slot_mutex || !connectivity_has(CONN_INTERNET)) {
+        return;
+    }
+    esp_http_client_handle_t stale[PREWARM_TARGET_COUNT] = { 0 };
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(slot_mutex, portMAX_DELAY);
+    for (int t = 0; t < PREWARM_TARGET_COUNT; t++) {
+        if (!(targets & PREWARM_BIT(t)) || !slots[t].url[0]) {
+            continue;
+        }
+        stale[t] = detach_if_older_locked(&slots[t], now, PREWARM_REFRESH_MS);
+        if (slots[t].state == SLOT_IDLE) {
+            slots[t].state = SLOT_QUEUED;
+        } else if (slots[t].state == SLOT_CONNECTING) {
+            slots[t].cancelled = false;
+        }
+    }
+    xSemaphoreGive(slot_mutex);
+    xEventGroupSetBits(prewarm_events, WORK_BIT);
+
+    for (int t = 0; t < PREWARM_TARGET_COUNT; t++) {
+        discard_client(stale[t]);
+    }
+}
+
+void prewarm_cancel(uint32_t targets)
+{
+    if (!slot_mutex) {
+        return;
+    }
+    esp_http_client_handle_t open[PREWARM_TARGET_COUNT] = { 0 };
+    xSemaphoreTake(slot_mutex, portMAX_DELAY);
+    for (int t = 0; t < PREWARM_TARGET_COUNT; t++) {
+        if (!(targets & PREWARM_BIT(t))) {
+            continue;
+        }
+        switch (slots[t].state) {
+        case SLOT_QUEUED:
+            slots[t].state = SLOT_IDLE;
+            break;
+        case SLOT_CONNECTING:
+            slots[t].cancelled = true;  // connect_slot() closes it when the handshake ends
+            break;
+        case SLOT_WARM:
+            open[t] = slots[t].client;
+            slots[t].client = NULL;
+            slots[t].state = SLOT_IDLE;
+            break;
+        case SLOT_IDLE:
+            break;
+        }
+    }
+    xSemaphoreGive(slot_mutex);
+
+    for (int t = 0; t < PREWARM_TARGET_COUNT; t++) {
+        discard_client(open[t]);
+    }
+}
+
+esp_http_client_handle_t prewarm_take(prewarm_target_t target)
+{
+    if (!slot_mutex || target >= PREWARM_TARGET_COUNT) {
+        return NULL;
+    }
+    prewarm_slot_t *slot = &slots[target];
+    int64_t asked_us = esp_timer_get_time();
+    xSemaphoreTake(slot_mutex, portMAX_DELAY);
+    if (slot->state == SLOT_QUEUED) {
+        slot->state = SLOT_IDLE;    // Not started: connecting ourselves is no slower
+    } else if (slot->state == SLOT_CONNECTING) {
+        xSemaphoreGive(slot_mutex);
+        xEventGroupWaitBits(prewarm_events, DONE_BIT(target), pdFALSE, pdTRUE, pdMS_TO_TICKS(PREWARM_TAKE_WAIT_MS));
+        xSemaphoreTake(slot_mutex, portMAX_DELAY);
+    }
+
+    esp_http_client_handle_t client = NULL;
+    int64_t saved_us = 0;
+    if (slot->state == SLOT_WARM) {
+        client = slot->client;
+        slot->client = NULL;
+        slot->state = SLOT_IDLE;
+        // The handshake, less whatever part of it we waited for
+        int64_t setup_us = (slot->connected_us ? slot->connected_us : slot->warm_us) - slot->start_us;
+        saved_us = setup_us - (esp_timer_get_time() - asked_us);
+    }
+    xSemaphoreGive(slot_mutex);
+
+    if (client) {
+        metrics_inc(prewarm_metrics.used);
+        metrics_observe_us(prewarm_metrics.saved, saved_us > 0 ? (uint32_t)saved_us : 0);
+    }
+    return client;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file prewarm.h
+ * @brief Speculative cloud connections opened at the wake word
+ *
+ * STT, LLM and TTS requests each start with DNS, TCP and a TLS handshake to
+ * their host. prewarm_start() runs that work in the background as soon as
+ * the wake word is heard, while the user is still speaking: a HEAD request
+ * leaves a keep-alive connection to each host open. The request code then
+ * asks for the client with prewarm_take() and posts over the open
+ * connection, falling back to a fresh client when there is none.
+ *
+ * Connections that turn out not to be needed (the command was handled
+ * locally) are closed with prewarm_cancel(); unused ones are also closed
+ * after PREWARM_MAX_AGE_MS so idle TLS sessions don't hold heap. Outcomes
+ * are exported as naphome_prewarm_total{result=used|wasted|failed} and the
+ * handshake time taken off the request as naphome_prewarm_saved_seconds.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PREWARM_MAX_URL         128
+#define PREWARM_MAX_AGE_MS      30000   // Unused connections are closed after this
+#define PREWARM_REFRESH_MS      10000   // A wake word reopens connections older than this
+#define PREWARM_TAKE_WAIT_MS    3000    // Longest prewarm_take() waits for a handshake in flight
+#define PREWARM_TASK_STACK      8192    // TLS handshake
+#define PREWARM_TASK_PRIORITY   3
+
+typedef enum {
+    PREWARM_STT,
+    PREWARM_LLM,
+    PREWARM_TTS,
+    PREWARM_TARGET_COUNT,
+} prewarm_target_t;
+
+#define PREWARM_BIT(target)     (1u << (target))
+#define PREWARM_ALL             (PREWARM_BIT(PREWARM_TARGET_COUNT) - 1)
+
+esp_err_t prewarm_init(void);
+
+/**
+ * @brief Host a target connects to
+ * @param base_url Scheme, host and optional port, e.g. "https://speech.googleapis.com"
+ * @param timeout_ms Network timeout for the handshake
+ */
+esp_err_t prewarm_set_target(prewarm_target_t target, const char *base_url, int timeout_ms);
+
+/**
+ * @brief Open (or refresh) connections to the targets in the PREWARM_BIT mask
+ *
+ * Returns at once; the handshakes run on the prewarm task, in target order.
+ * Does nothing without network.
+ */
+void prewarm_start(uint32_t targets);
+
+/**
+ * @brief Drop the targets in the mask: queued ones are not opened and open
+ *        ones are closed
+ */
+void prewarm_cancel(uint32_t targets);
+
+/**
+ * @brief Take the warm client for a target
+ *
+ * Waits for a handshake already in flight. The caller owns the client:
+ * point it at the request with esp_http_client_set_url() (same host keeps
+ * the connection) and clean it up as usual. If the server dropped the idle
+ * connection the request fails at open, write or headers; retry it once
+ * after esp_http_client_close(), which reconnects.
+ * @return NULL when nothing is warm; use a fresh client
+ */
+esp_http_client_handle_t prewarm_take(prewarm_target_t target);
+
+#ifdef __cplusplus
+}
+#endif
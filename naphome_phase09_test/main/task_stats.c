@@ -0,0 +1,265 @@
+/**
+ * @file task_stats.c
+ * @brief Periodic per-task and per-core CPU, stack and heap sampler
+ */
+
+#include "task_stats.h"
+#include "event_bus.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_sys.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+static const char *TAG = "task_stats";
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+#define TASK_STATS_HAVE_RUNTIME 1
+#else
+#define TASK_STATS_HAVE_RUNTIME 0
+#endif
+
+static SemaphoreHandle_t stats_mutex = NULL;
+static TaskHandle_t sampler_handle = NULL;
+static uint32_t sample_interval_ms = TASK_STATS_INTERVAL_MS;
+
+// Latest published snapshot and the one being built (only the sampler writes it)
+static task_stats_snapshot_t latest;
+static task_stats_snapshot_t work;
+
+#if TASK_STATS_HAVE_RUNTIME
+// Run-time counters from the previous sample, matched by task handle
+typedef struct {
+    TaskHandle_t handle;
+    configRUN_TIME_COUNTER_TYPE counter;
+} prev_counter_t;
+
+static TaskStatus_t *status_buf = NULL;
+static prev_counter_t *prev_buf = NULL;
+static size_t buf_capacity = 0;
+static size_t prev_count = 0;
+static configRUN_TIME_COUNTER_TYPE prev_total = 0;
+static bool have_prev = false;
+
+static bool ensure_capacity(size_t needed)
+{
+    if (needed <= buf_capacity) {
+        return true;
+    }
+    size_t cap = needed + 4;  // Headroom for tasks created before the next call
+    TaskStatus_t *status = malloc(cap * sizeof(*status));
+    prev_counter_t *prev = malloc(cap * sizeof(*prev));
+    if (!status || !prev) {
+        free(status);
+        free(prev);
+        return false;
+    }
+    if (prev_buf && prev_count > 0) {
+        memcpy(prev, prev_buf, prev_count * sizeof(*prev));
+    }
+    free(status_buf);
+    free(prev_buf);
+    status_buf = status;
+    prev_buf = prev;
+    buf_capacity = cap;
+    return true;
+}
+
+static configRUN_TIME_COUNTER_TYPE counter_delta(const TaskStatus_t *t)
+{
+    for (size_t i = 0; i < prev_count; i++) {
+        if (prev_buf[i].handle == t->xHandle) {
+            // Unsigned subtraction also covers counter wrap-around
+            return t->ulRunTimeCounter - prev_buf[i].counter;
+        }
+    }
+    return t->ulRunTimeCounter;  // Created since the last sample
+}
+
+static int compare_cpu_desc(const void *a, const void *b)
+{
+    float ca = ((const task_stats_task_t *)a)->cpu_percent;
+    float cb = ((const task_stats_task_t *)b)->cpu_percent;
+    return (ca < cb) - (ca > cb);
+}
+
+static float to_percent(configRUN_TIME_COUNTER_TYPE part, configRUN_TIME_COUNTER_TYPE whole)
+{
+    if (whole == 0) {
+        return 0.0f;
+    }
+    float p = (float)part * 100.0f / (float)whole;
+    return p > 100.0f ? 100.0f : p;
+}
+
+static void sample_tasks(task_stats_snapshot_t *s)
+{
+    UBaseType_t n = uxTaskGetNumberOfTasks();
+    if (!ensure_capacity(n)) {
+        ESP_LOGW(TAG, "No memory for %u task entries", (unsigned)n);
+        return;
+    }
+
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    n = uxTaskGetSystemState(status_buf, buf_capacity, &total);
+    if (n == 0) {
+        return;  // More tasks appeared than fit; the next sample grows the buffer
+    }
+    configRUN_TIME_COUNTER_TYPE elapsed = total - prev_total;
+    s->total_tasks = n;
+    s->cpu_valid = have_prev && elapsed > 0;
+
+    // Per-core usage is whatever the core's idle task did not get
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        TaskHandle_t idle = xTaskGetIdleTaskHandleForCore(core);
+        s->core_usage[core] = 0.0f;
+        for (UBaseType_t i = 0; i < n; i++) {
+            if (s->cpu_valid && status_buf[i].xHandle == idle) {
+                s->core_usage[core] = 100.0f - to_percent(counter_delta(&status_buf[i]), elapsed);
+                break;
+            }
+        }
+    }
+
+    // Every task is ranked so the list keeps the busiest ones when it is truncated
+    task_stats_task_t *ranked = malloc(n * sizeof(*ranked));
+    if (ranked) {
+        for (UBaseType_t i = 0; i < n; i++) {
+            const TaskStatus_t *t = &status_buf[i];
+            task_stats_task_t *out = &ranked[i];
+            snprintf(out->name, sizeof(out->name), "%s", t->pcTaskName);
+            out->state = (uint8_t)t->eCurrentState;
+            out->priority = (uint8_t)t->uxCurrentPriority;
+#if CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID
+            out->core_id = (t->xCoreID == tskNO_AFFINITY) ? -1 : (int8_t)t->xCoreID;
+#else
+            out->core_id = -1;
+#endif
+            out->stack_high_water = t->usStackHighWaterMark;  // Bytes: StackType_t is uint8_t on ESP-IDF
+            out->cpu_percent = s->cpu_valid ? to_percent(counter_delta(t), elapsed) : 0.0f;
+        }
+        qsort(ranked, n, sizeof(*ranked), compare_cpu_desc);
+        s->num_tasks = n < TASK_STATS_MAX_TASKS ? n : TASK_STATS_MAX_TASKS;
+        memcpy(s->tasks, ranked, s->num_tasks * sizeof(*ranked));
+        free(ranked);
+    }
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        prev_buf[i].handle = status_buf[i].xHandle;
+        prev_buf[i].counter = status_buf[i].ulRunTimeCounter;
+    }
+    prev_count = n;
+    prev_total = total;
+    have_prev = true;
+}
+#else
+static void sample_tasks(task_stats_snapshot_t *s)
+{
+    // Task listing needs the trace facility; only the count is available
+    s->total_tasks = uxTaskGetNumberOfTasks();
+}
+#endif
+
+static void sample_heap(task_stats_heap_t *h, uint32_t caps)
+{
+    h->free = heap_caps_get_free_size(caps);
+    h->total = heap_caps_get_total_size(caps);
+    h->largest_free_block = heap_caps_get_largest_free_block(caps);
+    h->min_free = heap_caps_get_minimum_free_size(caps);
+}
+
+static void take_sample(void)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t last = work.timestamp_us;
+
+    memset(work.tasks, 0, sizeof(work.tasks));
+    work.num_tasks = 0;
+    work.cpu_valid = false;
+    work.timestamp_us = now;
+    work.interval_ms = last ? (uint32_t)((now - last) / 1000) : 0;
+    work.cpu_freq_mhz = esp_rom_get_cpu_ticks_per_us();
+    sample_tasks(&work);
+    sample_heap(&work.heap_internal, MALLOC_CAP_INTERNAL);
+    sample_heap(&work.heap_spiram, MALLOC_CAP_SPIRAM);
+    sample_heap(&work.heap_dma, MALLOC_CAP_DMA);
+    work.sequence++;
+
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    memcpy(&latest, &work, sizeof(latest));
+    xSemaphoreGive(stats_mutex);
+
+    event_bus_publish(EVENT_BUS_TOPIC_METRICS, &work, sizeof(work));
+}
+
+static void task_stats_task(void *pvParameters)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        take_sample();
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(sample_interval_ms));
+    }
+}
+
+esp_err_t task_stats_start(uint32_t interval_ms)
+{
+    if (sampler_handle) {
+        return ESP_OK;
+    }
+    if (!stats_mutex) {
+        stats_mutex = xSemaphoreCreateMutex();
+        if (!stats_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    sample_interval_ms = interval_ms ? interval_ms : TASK_STATS_INTERVAL_MS;
+
+#if !TASK_STATS_HAVE_RUNTIME
+    ESP_LOGW(TAG, "FreeRTOS run-time stats disabled, CPU usage unavailable");
+#endif
+
+    BaseType_t ret = xTaskCreatePinnedToCore(
+        task_stats_task,
+        "task_stats",
+        3072,
+        NULL,
+        1,     // Lowest priority above idle: sampling must not disturb what it measures
+        &sampler_handle,
+        0      // Core 0
+    );
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create sampler task");
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Sampling every %lu ms", (unsigned long)sample_interval_ms);
+    return ESP_OK;
+}
+
+esp_err_t task_stats_get(task_stats_snapshot_t *out)
+{
+    if (!stats_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    memcpy(out, &latest, sizeof(*out));
+    xSemaphoreGive(stats_mutex);
+    return out->sequence ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+const char *task_stats_state_name(uint8_t state)
+{
+    switch (state) {
+        case eRunning:   return "Running";
+        case eReady:     return "Ready";
+        case eBlocked:   return "Blocked";
+        case eSuspended: return "Suspended";
+        case eDeleted:   return "Deleted";
+        default:         return "Invalid";
+    }
+}
@@ -0,0 +1,84 @@
+/**
+ * @file task_stats.h
+ * @brief Periodic per-task and per-core CPU, stack and heap sampler
+ *
+ * A low-priority task snapshots uxTaskGetSystemState() at a fixed interval
+ * and turns the FreeRTOS run-time counters into CPU percentages over the
+ * last interval: per task, and per core from the idle task of each core.
+ * Each sample also records stack high-water marks and free/largest/minimum
+ * heap for internal RAM, PSRAM and DMA-capable memory. Readers get a copy of
+ * the latest snapshot and never walk the task list themselves.
+ *
+ * CPU figures need CONFIG_FREERTOS_USE_TRACE_FACILITY and
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS; without them the snapshot still
+ * carries heap data and cpu_valid stays false.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TASK_STATS_MAX_TASKS        32      // Tasks beyond this are counted but not listed
+#define TASK_STATS_INTERVAL_MS      2000    // Default sampling interval
+
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    uint8_t state;              // eTaskState
+    uint8_t priority;           // Current priority
+    int8_t core_id;             // Pinned core, -1 for no affinity
+    uint32_t stack_high_water;  // Minimum free stack seen, in bytes
+    float cpu_percent;          // Share of one core over the last interval
+} task_stats_task_t;
+
+typedef struct {
+    uint32_t free;
+    uint32_t total;
+    uint32_t largest_free_block;
+    uint32_t min_free;          // Low-water mark since boot
+} task_stats_heap_t;
+
+typedef struct {
+    uint32_t sequence;          // Incremented per sample, 0 before the first
+    int64_t timestamp_us;       // esp_timer time of the sample
+    uint32_t interval_ms;       // Measured time covered by the CPU figures
+    uint32_t cpu_freq_mhz;
+    bool cpu_valid;             // false until two samples exist or without run-time stats
+    float core_usage[portNUM_PROCESSORS];
+    uint32_t total_tasks;       // Including tasks not listed
+    uint32_t num_tasks;         // Entries used in tasks[]
+    task_stats_task_t tasks[TASK_STATS_MAX_TASKS];
+    task_stats_heap_t heap_internal;
+    task_stats_heap_t heap_spiram;
+    task_stats_heap_t heap_dma;
+} task_stats_snapshot_t;
+
+/**
+ * @brief Start the sampler task
+ * @param interval_ms Sampling interval (0 for TASK_STATS_INTERVAL_MS)
+ * @return ESP_OK on success (also if already running)
+ */
+esp_err_t task_stats_start(uint32_t interval_ms);
+
+/**
+ * @brief Copy the latest snapshot
+ * @param out Snapshot to fill
+ * @return ESP_OK, or ESP_ERR_INVALID_STATE before the first sample
+ */
+esp_err_t task_stats_get(task_stats_snapshot_t *out);
+
+/**
+ * @brief Human-readable name of an eTaskState value
+ */
+const char *task_stats_state_name(uint8_t state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,455 @@
+/**
+ * @file telemetry.c
+ * @brief Batched, compact sensor telemetry pipeline implementation
+ */
+
+#include "telemetry.h"
+#include "json_writer.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+static const char *TAG = "telemetry";
+
+// Worst-case encoded sizes used to decide when a batch must be flushed
+// before appending another sample (CBOR ints are at most 5 bytes, JSON
+// ints at most 11 characters plus a separator). A CBOR sample is a
+// timestamp delta and eight column deltas of up to 5 bytes each, plus two
+// masks of up to 2 bytes: 49.
+#define CBOR_HEADER_MAX   112
+#define CBOR_SAMPLE_MAX   49
+#define JSON_HEADER_MAX   176
+#define JSON_SAMPLE_MAX   132
+
+
+static telemetry_config_t telemetry_config;
+static telemetry_sample_t batch[TELEMETRY_MAX_BATCH_SAMPLES];
+static size_t batch_count = 0;
+static uint8_t encode_buf[TELEMETRY_MAX_BATCH_BYTES];
+static telemetry_stats_t telemetry_stats = {0};
+static SemaphoreHandle_t telemetry_mutex = NULL;
+static esp_timer_handle_t age_timer = NULL;
+
+// ---------------------------------------------------------------------------
+// Minimal CBOR emitter (only the subset a batch needs); JSON goes through
+// json_writer so both formats share the same encode_batch() walk
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+    telemetry_format_t format;
+    json_writer_t json;         // Used when format is TELEMETRY_FORMAT_JSON
+} enc_t;
+
+static void enc_put(enc_t *e, const void *data, size_t n)
+{
+    if (e->overflow || e->len + n > e->cap) {
+        e->overflow = true;
+        return;
+    }
+    memcpy(e->buf + e->len, data, n);
+    e->len += n;
+}
+
+static void cbor_head(enc_t *e, uint8_t major, uint32_t value)
+{
+    uint8_t head[5];
+    size_t n;
+    major <<= 5;
+    if (value < 24) {
+        head[0] = major | value;
+        n = 1;
+    } else if (value <= 0xFF) {
+        head[0] = major | 24;
+        head[1] = value;
+        n = 2;
+    } else if (value <= 0xFFFF) {
+        head[0] = major | 25;
+        head[1] = value >> 8;
+        head[2] = value;
+        n = 3;
+    } else {
+        head[0] = major | 26;
+        head[1] = value >> 24;
+        head[2] = value >> 16;
+        head[3] = value >> 8;
+        head[4] = value;
+        n = 5;
+    }
+    enc_put(e, head, n);
+}
+
+static void enc_map_begin(enc_t *e, size_t pairs)
+{
+    if (e->format == TELEMETRY_FORMAT_CBOR) {
+        cbor_head(e, 5, pairs);
+    } else {
+        json_writer_object_begin(&e->json);
+    }
+}
+
+static void enc_map_end(enc_t *e)
+{
+    // Definite-length CBOR containers need no terminator
+    if (e->format == TELEMETRY_FORMAT_JSON) {
+        json_writer_object_end(&e->json);
+    }
+}
+
+static void enc_array_begin(enc_t *e, size_t count)
+{
+    if (e->format == TELEMETRY_FORMAT_CBOR) {
+        cbor_head(e, 4, count);
+    } else {
+        json_writer_array_begin(&e->json);
+    }
+}
+
+static void enc_array_end(enc_t *e)
+{
+    if (e->format == TELEMETRY_FORMAT_JSON) {
+        json_writer_array_end(&e->json);
+    }
+}
+
+static void enc_str(enc_t *e, const char *s)
+{
+    if (e->format == TELEMETRY_FORMAT_JSON) {
+        json_writer_string(&e->json, s);
+        return;
+    }
+    size_t n = strlen(s);
+    cbor_head(e, 3, n);
+    enc_put(e, s, n);
+}
+
+static void enc_key(enc_t *e, const char *key)
+{
+    if (e->format == TELEMETRY_FORMAT_JSON) {
+        json_writer_key(&e->json, key);
+        return;
+    }
+    enc_str(e, key);
+}
+
+static void enc_int(enc_t *e, int32_t v)
+{
+    if (e->format == TELEMETRY_FORMAT_JSON) {
+        json_writer_int(&e->json, v);
+        return;
+    }
+    if (v >= 0) {
+        cbor_head(e, 0, (uint32_t)v);
+    } else {
+        cbor_head(e, 1, (uint32_t)(-1 - v));
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Columnar batch layout
+// ---------------------------------------------------------------------------
+
+// Columns are quantized to integers: t/h/t2/h2 in hundredths of a degree or
+// percent, the rest in their natural integer unit. A column only holds
+// entries for samples whose valid_mask has the column's sensor bit, and each
+// entry is the delta from the previous entry in that column.
+typedef struct {
+    const char *key;
+    uint8_t sensor;
+    int32_t (*quantize)(const telemetry_sample_t *s);
+} telemetry_column_t;
+
+static int32_t q_temperature(const telemetry_sample_t *s)  { return lroundf(s->temperature_c * 100.0f); }
+static int32_t q_humidity(const telemetry_sample_t *s)     { return lroundf(s->humidity_rh * 100.0f); }
+static int32_t q_tvoc(const telemetry_sample_t *s)         { return s->tvoc_ppb; }
+static int32_t q_eco2(const telemetry_sample_t *s)         { return s->eco2_ppm; }
+static int32_t q_lux(const telemetry_sample_t *s)          { return lroundf(s->lux); }
+static int32_t q_co2(const telemetry_sample_t *s)          { return lroundf(s->co2_ppm); }
+static int32_t q_scd30_temp(const telemetry_sample_t *s)   { return lroundf(s->scd30_temperature_c * 100.0f); }
+static int32_t q_scd30_hum(const telemetry_sample_t *s)    { return lroundf(s->scd30_humidity_rh * 100.0f); }
+
+static const telemetry_column_t columns[] = {
+    {"t",    TELEMETRY_SENSOR_SHT30,  q_temperature},
+    {"h",    TELEMETRY_SENSOR_SHT30,  q_humidity},
+    {"voc",  TELEMETRY_SENSOR_SGP30,  q_tvoc},
+    {"eco2", TELEMETRY_SENSOR_SGP30,  q_eco2},
+    {"lux",  TELEMETRY_SENSOR_BH1750, q_lux},
+    {"co2",  TELEMETRY_SENSOR_SCD30,  q_co2},
+    {"t2",   TELEMETRY_SENSOR_SCD30,  q_scd30_temp},
+    {"h2",   TELEMETRY_SENSOR_SCD30,  q_scd30_hum},
+};
+#define NUM_COLUMNS (sizeof(columns) / sizeof(columns[0]))
+
+static size_t estimate_batch_bytes(size_t samples)
+{
+    size_t dev_len = telemetry_config.device_id ? strlen(telemetry_config.device_id) : 0;
+    if (telemetry_config.format == TELEMETRY_FORMAT_CBOR) {
+        return CBOR_HEADER_MAX + dev_len + samples * CBOR_SAMPLE_MAX;
+    }
+    return JSON_HEADER_MAX + dev_len + samples * JSON_SAMPLE_MAX;
+}
+
+static size_t encode_batch(const telemetry_sample_t *samples, size_t count,
+                           uint8_t *out, size_t out_len, telemetry_format_t format)
+{
+    enc_t e = {
+        .buf = out,
+        .cap = out_len,
+        .format = format,
+    };
+    if (format == TELEMETRY_FORMAT_JSON) {
+        json_writer_init(&e.json, (char *)out, out_len, NULL, NULL);
+    }
+
+    size_t column_counts[NUM_COLUMNS] = {0};
+    size_t present_columns = 0;
+    for (size_t c = 0; c < NUM_COLUMNS; c++) {
+        for (size_t i = 0; i < count; i++) {
+            if (samples[i].valid_mask & columns[c].sensor) {
+                column_counts[c]++;
+            }
+        }
+        if (column_counts[c] > 0) {
+            present_columns++;
+        }
+    }
+
+    enc_map_begin(&e, 7 + present_columns);
+
+    enc_key(&e, "v");
+    enc_int(&e, TELEMETRY_SCHEMA_VERSION);
+    enc_key(&e, "dev");
+    enc_str(&e, telemetry_config.device_id ? telemetry_config.device_id : "");
+    enc_key(&e, "t0");
+    enc_int(&e, (int32_t)samples[0].timestamp);
+    enc_key(&e, "n");
+    enc_int(&e, (int32_t)count);
+
+    // Timestamps as deltas from the previous sample (first delta is 0)
+    enc_key(&e, "ts");
+    enc_array_begin(&e, count);
+    uint32_t prev_ts = samples[0].timestamp;
+    for (size_t i = 0; i < count; i++) {
+        enc_int(&e, (int32_t)(samples[i].timestamp - prev_ts));
+        prev_ts = samples[i].timestamp;
+    }
+    enc_array_end(&e);
+
+    enc_key(&e, "vm");
+    enc_array_begin(&e, count);
+    for (size_t i = 0; i < count; i++) {
+        enc_int(&e, samples[i].valid_mask);
+    }
+    enc_array_end(&e);
+
+    enc_key(&e, "hm");
+    enc_array_begin(&e, count);
+    for (size_t i = 0; i < count; i++) {
+        enc_int(&e, samples[i].hardware_mask);
+    }
+    enc_array_end(&e);
+
+    for (size_t c = 0; c < NUM_COLUMNS; c++) {
+        if (column_counts[c] == 0) {
+            continue;
+        }
+        enc_key(&e, columns[c].key);
+        enc_array_begin(&e, column_counts[c]);
+        int32_t prev = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!(samples[i].valid_mask & columns[c].sensor)) {
+                continue;
+            }
+            int32_t value = columns[c].quantize(&samples[i]);
+            enc_int(&e, value - prev);
+            prev = value;
+        }
+        enc_array_end(&e);
+    }
+
+    enc_map_end(&e);
+    if (format == TELEMETRY_FORMAT_JSON) {
+        return json_writer_finish(&e.json) == ESP_OK ? e.json.len : 0;
+    }
+    return e.overflow ? 0 : e.len;
+}
+
+static void log_sink(const uint8_t *data, size_t len, telemetry_format_t format, void *ctx)
+{
+    if (format == TELEMETRY_FORMAT_JSON) {
+        ESP_LOGI(TAG, "Telemetry batch: %.*s", (int)len, (const char *)data);
+    } else {
+        ESP_LOGI(TAG, "Telemetry batch: %zu bytes CBOR (no sink configured)", len);
+        ESP_LOG_BUFFER_HEXDUMP(TAG, data, len, ESP_LOG_DEBUG);
+    }
+}
+
+static esp_err_t telemetry_flush_locked(void)
+{
+    if (age_timer) {
+        esp_timer_stop(age_timer);  // Not running is fine
+    }
+    if (batch_count == 0) {
+        return ESP_OK;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    size_t len = encode_batch(batch, batch_count, encode_buf, sizeof(encode_buf), telemetry_config.format);
+    uint32_t encode_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    size_t flushed = batch_count;
+    batch_count = 0;
+
+    if (len == 0) {
+        ESP_LOGE(TAG, "Batch of %zu samples does not fit in %zu byte buffer, dropped",
+                 flushed, sizeof(encode_buf));
+        telemetry_stats.dropped++;
+        return ESP_ERR_NO_MEM;
+    }
+
+    telemetry_stats.batches++;
+    telemetry_stats.samples += flushed;
+    telemetry_stats.bytes += len;
+    telemetry_stats.last_batch_samples = flushed;
+    telemetry_stats.last_batch_bytes = len;
+    telemetry_stats.last_encode_us = encode_us;
+
+    ESP_LOGI(TAG, "Flushing %zu samples: %zu bytes (%.1f B/sample) %s, encoded in %lu us",
+             flushed, len, (float)len / flushed,
+             telemetry_config.format == TELEMETRY_FORMAT_CBOR ? "CBOR" : "JSON",
+             (unsigned long)encode_us);
+
+    telemetry_sink_t sink = telemetry_config.sink ? telemetry_config.sink : log_sink;
+    sink(encode_buf, len, telemetry_config.format, telemetry_config.sink_ctx);
+    return ESP_OK;
+}
+
+static void age_timer_callback(void *arg)
+{
+    telemetry_flush();
+}
+
+esp_err_t telemetry_init(const telemetry_config_t *config)
+{
+    if (telemetry_mutex == NULL) {
+        telemetry_mutex = xSemaphoreCreateMutex();
+        if (telemetry_mutex == NULL) {
+            ESP_LOGE(TAG, "Failed to create telemetry mutex");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    telemetry_config_t defaults = TELEMETRY_DEFAULT_CONFIG();
+    xSemaphoreTake(telemetry_mutex, portMAX_DELAY);
+    telemetry_config = config ? *config : defaults;
+    if (telemetry_config.max_samples == 0 || telemetry_config.max_samples > TELEMETRY_MAX_BATCH_SAMPLES) {
+        telemetry_config.max_samples = TELEMETRY_MAX_BATCH_SAMPLES;
+    }
+    if (telemetry_config.max_bytes == 0 || telemetry_config.max_bytes > TELEMETRY_MAX_BATCH_BYTES) {
+        telemetry_config.max_bytes = TELEMETRY_MAX_BATCH_BYTES;
+    }
+    if (estimate_batch_bytes(1) > telemetry_config.max_bytes) {
+        ESP_LOGW(TAG, "max_bytes %zu is below one sample, raising to %zu",
+                 telemetry_config.max_bytes, estimate_batch_bytes(1));
+        telemetry_config.max_bytes = estimate_batch_bytes(1);
+    }
+    batch_count = 0;
+    xSemaphoreGive(telemetry_mutex);
+
+    if (age_timer == NULL && telemetry_config.max_age_ms > 0) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = age_timer_callback,
+            .name = "telemetry_age",
+        };
+        esp_err_t ret = esp_timer_create(&timer_args, &age_timer);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to create age timer: %s - only size thresholds will flush",
+                     esp_err_to_name(ret));
+            age_timer = NULL;
+        }
+    }
+
+    ESP_LOGI(TAG, "Telemetry initialized: %s, flush at %zu samples / %zu bytes / %lu ms",
+             telemetry_config.format == TELEMETRY_FORMAT_CBOR ? "CBOR" : "JSON",
+             telemetry_config.max_samples, telemetry_config.max_bytes,
+             (unsigned long)telemetry_config.max_age_ms);
+    return ESP_OK;
+}
+
+esp_err_t telemetry_add_sample(const telemetry_sample_t *sample)
+{
+    if (!sample) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (telemetry_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(telemetry_mutex, portMAX_DELAY);
+
+    // Flush first if this sample could push the batch past a threshold
+    if (batch_count > 0 &&
+        (batch_count >= telemetry_config.max_samples ||
+         estimate_batch_bytes(batch_count + 1) > telemetry_config.max_bytes)) {
+        telemetry_flush_locked();
+    }
+
+    batch[batch_count++] = *sample;
+    if (batch_count == 1 && age_timer) {
+        esp_timer_start_once(age_timer, (uint64_t)telemetry_config.max_age_ms * 1000);
+    }
+
+    esp_err_t ret = ESP_OK;
+    if (batch_count >= telemetry_config.max_samples) {
+        ret = telemetry_flush_locked();
+    }
+
+    xSemaphoreGive(telemetry_mutex);
+    return ret;
+}
+
+esp_err_t telemetry_flush(void)
+{
+    if (telemetry_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(telemetry_mutex, portMAX_DELAY);
+    esp_err_t ret = telemetry_flush_locked();
+    xSemaphoreGive(telemetry_mutex);
+    return ret;
+}
+
+void telemetry_set_sink(telemetry_sink_t sink, void *ctx)
+{
+    if (telemetry_mutex == NULL) {
+        telemetry_config.sink = sink;
+        telemetry_config.sink_ctx = ctx;
+        return;
+    }
+    xSemaphoreTake(telemetry_mutex, portMAX_DELAY);
+    telemetry_config.sink = sink;
+    telemetry_config.sink_ctx = ctx;
+    xSemaphoreGive(telemetry_mutex);
+}
+
+void telemetry_get_stats(telemetry_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (telemetry_mutex == NULL) {
+        *stats = telemetry_stats;
+        return;
+    }
+    xSemaphoreTake(telemetry_mutex, portMAX_DELAY);
+    *stats = telemetry_stats;
+    xSemaphoreGive(telemetry_mutex);
+}
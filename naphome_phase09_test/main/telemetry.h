@@ -0,0 +1,126 @@
+/**
+ * @file telemetry.h
+ * @brief Batched, compact sensor telemetry pipeline
+ *
+ * Samples are accumulated in RAM and serialized as one batch when a size,
+ * sample-count or age threshold is reached. Batches are columnar and
+ * delta-encoded: each sensor value is quantized to an integer and stored as
+ * the difference from the previous sample, so slowly changing readings
+ * encode to one byte each in CBOR. Compact JSON with the same layout is
+ * available as a debug format.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_MAX_BATCH_SAMPLES 32      // Hard upper bound on samples per batch
+#define TELEMETRY_MAX_BATCH_BYTES   4096    // Size of the static encode buffer
+#define TELEMETRY_SCHEMA_VERSION    1
+
+// Sensor bits used in telemetry_sample_t valid_mask / hardware_mask
+#define TELEMETRY_SENSOR_SHT30  (1 << 0)
+#define TELEMETRY_SENSOR_SGP30  (1 << 1)
+#define TELEMETRY_SENSOR_BH1750 (1 << 2)
+#define TELEMETRY_SENSOR_SCD30  (1 << 3)
+
+typedef enum {
+    TELEMETRY_FORMAT_CBOR = 0,  // Compact columnar CBOR (uplink format)
+    TELEMETRY_FORMAT_JSON = 1,  // Same layout as compact JSON (debug only)
+} telemetry_format_t;
+
+typedef struct {
+    uint32_t timestamp;         // Unix time in seconds
+    uint8_t valid_mask;         // TELEMETRY_SENSOR_* bits with a valid reading
+    uint8_t hardware_mask;      // TELEMETRY_SENSOR_* bits backed by real hardware
+    float temperature_c;        // SHT30
+    float humidity_rh;          // SHT30
+    uint16_t tvoc_ppb;          // SGP30
+    uint16_t eco2_ppm;          // SGP30
+    float lux;                  // BH1750
+    float co2_ppm;              // SCD30
+    float scd30_temperature_c;  // SCD30
+    float scd30_humidity_rh;    // SCD30
+} telemetry_sample_t;
+
+/**
+ * @brief Called with each encoded batch
+ *
+ * Runs with the telemetry lock held, so it must copy the data and return
+ * quickly (e.g. enqueue it for publishing).
+ */
+typedef void (*telemetry_sink_t)(const uint8_t *data, size_t len, telemetry_format_t format, void *ctx);
+
+typedef struct {
+    const char *device_id;      // Stored in every batch header
+    telemetry_format_t format;
+    size_t max_samples;         // Flush when this many samples are queued
+    size_t max_bytes;           // Flush before the encoded batch could exceed this
+    uint32_t max_age_ms;        // Flush when the oldest queued sample is this old
+    telemetry_sink_t sink;      // NULL logs batches instead
+    void *sink_ctx;
+} telemetry_config_t;
+
+#define TELEMETRY_DEFAULT_CONFIG() {            \
+    .device_id = "naphome-0.9",                 \
+    .format = TELEMETRY_FORMAT_CBOR,            \
+    .max_samples = TELEMETRY_MAX_BATCH_SAMPLES, \
+    .max_bytes = 1024,                          \
+    .max_age_ms = 5 * 60 * 1000,                \
+    .sink = NULL,                               \
+    .sink_ctx = NULL,                           \
+}
+
+typedef struct {
+    uint32_t batches;           // Batches flushed
+    uint32_t samples;           // Samples flushed
+    uint32_t bytes;             // Encoded bytes flushed
+    uint32_t dropped;           // Batches lost to encode errors
+    uint32_t last_batch_samples;
+    uint32_t last_batch_bytes;
+    uint32_t last_encode_us;    // Serialization time of the last batch
+} telemetry_stats_t;
+
+/**
+ * @brief Initialize the telemetry pipeline
+ * @param config Pipeline configuration (NULL for TELEMETRY_DEFAULT_CONFIG)
+ * @return ESP_OK on success
+ */
+esp_err_t telemetry_init(const telemetry_config_t *config);
+
+/**
+ * @brief Queue a sample, flushing first if it would exceed a threshold
+ * @param sample Sample to append to the current batch
+ * @return ESP_OK on success
+ */
+esp_err_t telemetry_add_sample(const telemetry_sample_t *sample);
+
+/**
+ * @brief Encode and hand the current batch to the sink
+ * @return ESP_OK on success (including when the batch is empty)
+ */
+esp_err_t telemetry_flush(void);
+
+/**
+ * @brief Replace the batch sink
+ * @param sink Sink callback (NULL logs batches)
+ * @param ctx Opaque pointer passed to the sink
+ */
+void telemetry_set_sink(telemetry_sink_t sink, void *ctx);
+
+/**
+ * @brief Get pipeline counters
+ * @param stats Pointer to stats structure to fill
+ */
+void telemetry_get_stats(telemetry_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
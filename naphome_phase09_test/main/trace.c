@@ -0,0 +1,124 @@
+/**
+ * @file trace.c
+ * @brief Lock-free ring buffer of voice pipeline spans
+ */
+
+#include "trace.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+static const char *TAG = "trace";
+
+typedef struct {
+    // Odd while being written, 2 * (index + 1) once complete
+    _Atomic uint32_t seq;
+    trace_event_t event;
+} trace_slot_t;
+
+static trace_slot_t *ring = NULL;
+static _Atomic uint32_t ring_head = 0;         // Next index to claim
+static _Atomic uint32_t current_interaction = 0;
+
+esp_err_t trace_init(void)
+{
+    if (ring) {
+        return ESP_OK;
+    }
+    trace_slot_t *slots = heap_caps_calloc(TRACE_RING_SIZE, sizeof(trace_slot_t),
+                                           MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!slots) {
+        slots = calloc(TRACE_RING_SIZE, sizeof(trace_slot_t));
+    }
+    if (!slots) {
+        ESP_LOGE(TAG, "Failed to allocate trace ring");
+        return ESP_ERR_NO_MEM;
+    }
+    ring = slots;
+    ESP_LOGI(TAG, "Trace ring: %d events (%u bytes)", TRACE_RING_SIZE,
+             (unsigned)(TRACE_RING_SIZE * sizeof(trace_slot_t)));
+    return ESP_OK;
+}
+
+static void trace_record(uint32_t interaction, const char *name, trace_phase_t phase,
+                         int64_t start_us, uint32_t dur_us)
+{
+    if (!ring) {
+        return;
+    }
+    uint32_t index = atomic_fetch_add_explicit(&ring_head, 1, memory_order_relaxed);
+    trace_slot_t *slot = &ring[index & (TRACE_RING_SIZE - 1)];
+
+    atomic_store_explicit(&slot->seq, 2 * index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->event.name = name;
+    slot->event.interaction = interaction;
+    slot->event.start_us = start_us;
+    slot->event.dur_us = dur_us;
+    slot->event.phase = phase;
+    slot->event.core = (uint8_t)xPortGetCoreID();
+    atomic_store_explicit(&slot->seq, 2 * (index + 1), memory_order_release);
+}
+
+uint32_t trace_begin_interaction(void)
+{
+    uint32_t id = atomic_fetch_add_explicit(&current_interaction, 1, memory_order_relaxed) + 1;
+    if (id == 0) {
+        // Skip 0 on wrap-around; it means "no interaction"
+        id = atomic_fetch_add_explicit(&current_interaction, 1, memory_order_relaxed) + 1;
+    }
+    trace_instant(id, "wake_word");
+    return id;
+}
+
+uint32_t trace_current(void)
+{
+    return atomic_load_explicit(&current_interaction, memory_order_relaxed);
+}
+
+void trace_span(uint32_t interaction, const char *name, int64_t start_us, int64_t end_us)
+{
+    int64_t dur = end_us - start_us;
+    trace_record(interaction, name, TRACE_SPAN, start_us,
+                 dur < 0 ? 0 : (dur > UINT32_MAX ? UINT32_MAX : (uint32_t)dur));
+}
+
+void trace_span_since(uint32_t interaction, const char *name, int64_t start_us)
+{
+    trace_span(interaction, name, start_us, esp_timer_get_time());
+}
+
+void trace_instant(uint32_t interaction, const char *name)
+{
+    trace_record(interaction, name, TRACE_INSTANT, esp_timer_get_time(), 0);
+}
+
+uint32_t trace_foreach(uint32_t interaction, trace_visit_t visit, void *ctx)
+{
+    if (!ring || !visit) {
+        return 0;
+    }
+    uint32_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    uint32_t first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+
+    for (uint32_t index = first; index != head; index++) {
+        trace_slot_t *slot = &ring[index & (TRACE_RING_SIZE - 1)];
+        uint32_t expected = 2 * (index + 1);
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != expected) {
+            continue;   // Still being written, or already overwritten by a newer event
+        }
+        trace_event_t copy = slot->event;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != expected) {
+            continue;   // Overwritten while copying
+        }
+        if (interaction == 0 || copy.interaction == interaction) {
+            visit(&copy, ctx);
+        }
+    }
+    return first;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file trace.h
+ * @brief Per-interaction voice latency tracing
+ *
+ * Every wake word starts a new interaction with its own ID. The stages that
+ * follow (MultiNet, local command, STT, LLM, TTS, audio playback) record
+ * timestamped spans tagged with that ID into a fixed ring buffer. Recording
+ * is lock-free and safe from any task: a writer claims a slot with one
+ * atomic increment and publishes it with a per-slot sequence number, so the
+ * oldest events are overwritten and readers skip slots caught mid-write.
+ *
+ * trace_foreach() walks the retained events oldest first; the web server
+ * serves them as Chrome trace JSON (chrome://tracing, Perfetto) with one
+ * row per interaction.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_RING_SIZE     512     // Events retained, power of two
+
+typedef enum {
+    TRACE_SPAN,                 // Complete event with a duration
+    TRACE_INSTANT,              // Point in time
+} trace_phase_t;
+
+typedef struct {
+    const char *name;           // Stage name, must be a string literal
+    uint32_t interaction;       // 0 outside any interaction
+    int64_t start_us;           // esp_timer time
+    uint32_t dur_us;            // 0 for instants
+    uint8_t phase;              // trace_phase_t
+    uint8_t core;               // Core the event was recorded on
+} trace_event_t;
+
+typedef void (*trace_visit_t)(const trace_event_t *event, void *ctx);
+
+/**
+ * @brief Allocate the ring buffer (PSRAM when available)
+ *
+ * Recording before this succeeds is a no-op.
+ */
+esp_err_t trace_init(void);
+
+/**
+ * @brief Start a new interaction and record a "wake_word" instant
+ * @return The new interaction ID (never 0)
+ */
+uint32_t trace_begin_interaction(void);
+
+/**
+ * @brief ID of the most recent interaction, 0 before the first wake word
+ */
+uint32_t trace_current(void);
+
+/**
+ * @brief Record a span that started at start_us and ends now
+ */
+void trace_span_since(uint32_t interaction, const char *name, int64_t start_us);
+
+/**
+ * @brief Record a span with explicit start and end times
+ */
+void trace_span(uint32_t interaction, const char *name, int64_t start_us, int64_t end_us);
+
+/**
+ * @brief Record a point-in-time event
+ */
+void trace_instant(uint32_t interaction, const char *name);
+
+/**
+ * @brief Visit retained events oldest first
+ * @param interaction Only visit this interaction, or 0 for all
+ * @return Number of events overwritten since boot
+ */
+uint32_t trace_foreach(uint32_t interaction, trace_visit_t visit, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file web_asset_handler.c
+ * @brief Content negotiation and caching for the embedded dashboard assets
+ */
+
+#include "web_asset_handler.h"
+#include "web_assets.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define ACCEPT_ENCODING_MAX 128     // Longer values are judged on their first 127 bytes
+
+// q-value of one Accept-Encoding element ("gzip;q=0.5"); 1 when absent
+static double coding_qvalue(const char *params, const char *end)
+{
+    const char *q = params;
+    while ((q = memchr(q, ';', end - q)) != NULL) {
+        q++;
+        while (q < end && *q == ' ') {
+            q++;
+        }
+        if (end - q > 2 && (q[0] == 'q' || q[0] == 'Q') && q[1] == '=') {
+            return strtod(q + 2, NULL);
+        }
+    }
+    return 1.0;
+}
+
+bool web_asset_accepts_gzip(const char *accept_encoding)
+{
+    if (accept_encoding == NULL) {
+        return false;
+    }
+
+    double gzip_q = -1.0;       // -1: not listed
+    double wildcard_q = -1.0;
+    const char *p = accept_encoding;
+    while (*p) {
+        while (*p == ' ' || *p == ',') {
+            p++;
+        }
+        const char *end = strchr(p, ',');
+        if (end == NULL) {
+            end = p + strlen(p);
+        }
+        size_t name_len = strcspn(p, " ;,");
+        if (name_len > (size_t)(end - p)) {
+            name_len = end - p;
+        }
+        double q = coding_qvalue(p + name_len, end);
+        if ((name_len == 4 && strncasecmp(p, "gzip", 4) == 0) ||
+            (name_len == 6 && strncasecmp(p, "x-gzip", 6) == 0)) {
+            gzip_q = q;
+        } else if (name_len == 1 && *p == '*') {
+            wildcard_q = q;
+        }
+        p = end;
+    }
+    return gzip_q >= 0.0 ? gzip_q > 0.0 : wildcard_q > 0.0;
+}
+
+esp_err_t web_asset_get_handler(httpd_req_t *req)
+{
+    const web_asset_t *asset = req->user_ctx;
+
+    char accept_encoding[ACCEPT_ENCODING_MAX];
+    esp_err_t ret = httpd_req_get_hdr_value_str(req, "Accept-Encoding", accept_encoding, sizeof(accept_encoding));
+    bool gzip = web_asset_accepts_gzip((ret == ESP_OK || ret == ESP_ERR_HTTPD_RESULT_TRUNC) ? accept_encoding : NULL);
+    const char *etag = gzip ? asset->etag : asset->identity_etag;
+
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", asset->cache_control);
+
+    char if_none_match[48];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strcmp(if_none_match, etag) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    httpd_resp_set_type(req, asset->content_type);
+    if (!gzip) {
+        return httpd_resp_send(req, (const char *)asset->identity, asset->identity_len);
+    }
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char *)asset->data, asset->len);
+}
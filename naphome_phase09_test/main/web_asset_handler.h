@@ -0,0 +1,37 @@
+/**
+ * @file web_asset_handler.h
+ * @brief HTTP handler for the embedded dashboard assets
+ *
+ * Picks the gzip or identity copy of a web_asset_t from the request's
+ * Accept-Encoding, answers If-None-Match with 304 and always sends
+ * Vary: Accept-Encoding so caches keep the two copies apart.
+ */
+
+#pragma once
+
+#include "esp_http_server.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Whether an Accept-Encoding value allows a gzip response
+ *
+ * gzip (or x-gzip) must be listed, or covered by "*", with a non-zero
+ * q-value. A missing header means identity only: clients such as curl
+ * omit it and cannot decode gzip.
+ *
+ * @param accept_encoding Header value, or NULL if the request had none
+ */
+bool web_asset_accepts_gzip(const char *accept_encoding);
+
+/**
+ * @brief GET handler for one asset, passed as the URI's user_ctx
+ */
+esp_err_t web_asset_get_handler(httpd_req_t *req);
+
+#ifdef __cplusplus
+}
+#endif
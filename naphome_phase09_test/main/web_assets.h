@@ -0,0 +1,38 @@
+/**
+ * @file web_assets.h
+ * @brief Pre-compressed dashboard assets embedded in flash
+ *
+ * The table is generated at build time by gen_web_assets.py from the files
+ * in main/www: each entry is minified, gzip-compressed and tagged with an
+ * ETag derived from its content. The minified text is kept too, under its
+ * own ETag, for clients that do not send Accept-Encoding: gzip.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *uri;            // Request path, "/" for index.html
+    const char *content_type;
+    const char *cache_control;
+    const char *etag;           // Quoted strong ETag of the gzip stream
+    const char *identity_etag;  // Quoted strong ETag of the minified text
+    const uint8_t *data;        // gzip stream
+    size_t len;                 // Compressed size
+    const uint8_t *identity;    // Minified, uncompressed
+    size_t identity_len;
+    size_t raw_len;             // Size of the source file, for logging
+} web_asset_t;
+
+extern const web_asset_t web_assets[];
+extern const size_t web_assets_count;
+
+#ifdef __cplusplus
+}
+#endif
@@ -17,9 +17,24 @@
 #include "esp_system.h"
 #include "esp_chip_info.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include <string.h>
 #include <stdio.h>
-#include "cJSON.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "json_writer.h"
+#include "task_stats.h"
+#include "telemetry.h"
+#include "event_bus.h"
+#include "web_assets.h"
+#include "web_asset_handler.h"
+#include "metrics.h"
+#include "trace.h"
+#include "command_registry.h"
+#include "boot_seq.h"
+#include "wifi_manager.h"
+#include "connectivity.h"
 
 static const char *TAG = "web_server";
 static httpd_handle_t server_handle = NULL;
@@ -37,7 +52,7 @@ static portMUX_TYPE test_status_mutex = portMUX_INITIALIZER_UNLOCKED;
 
 // External function to trigger test suite
 extern void run_test_suite(void *pvParameters);
-extern volatile bool test_suite_triggered;
+extern atomic_bool test_suite_triggered;
 
 // Test descriptions from TODO
 static const char* test_descriptions[MAX_TESTS] = {
@@ -77,14 +92,12 @@ void web_server_update_test_status(int test_num, int status, const char *test_na
 
 bool web_server_trigger_demo(void)
 {
-    // Check if demo is already running
-    if (test_suite_triggered) {
+    // Claim the test suite; fails if the demo is already running (voice or web)
+    if (atomic_exchange(&test_suite_triggered, true)) {
         ESP_LOGW(TAG, "Demo already running, cannot start another");
         return false;
     }
     
-    // Trigger the test suite
-    test_suite_triggered = true;
     xTaskCreate(
         run_test_suite,
         "test_suite",
@@ -98,361 +111,28 @@ bool web_server_trigger_demo(void)
     return true;
 }
 
-// HTML page with embedded JavaScript for auto-refresh
-static const char* status_html = 
-"<!DOCTYPE html>"
-"<html>"
-"<head>"
-"<meta charset='UTF-8'>"
-"<meta name='viewport' content='width=device-width, initial-scale=1.0'>"
-"<title>Naphome Status - nap.local</title>"
-"<style>"
-"* { margin: 0; padding: 0; box-sizing: border-box; }"
-"body { font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif; background: #1a1a1a; color: #e0e0e0; padding: 20px; }"
-".container { max-width: 1400px; margin: 0 auto; }"
-"h1 { color: #4CAF50; margin-bottom: 10px; text-align: center; }"
-".subtitle { text-align: center; color: #888; margin-bottom: 30px; }"
-".grid { display: grid; grid-template-columns: repeat(auto-fit, minmax(300px, 1fr)); gap: 20px; margin-bottom: 20px; }"
-".card { background: #2a2a2a; border-radius: 8px; padding: 20px; box-shadow: 0 2px 8px rgba(0,0,0,0.3); }"
-".card h2 { color: #4CAF50; margin-bottom: 15px; font-size: 1.2em; border-bottom: 2px solid #4CAF50; padding-bottom: 5px; }"
-".stat { display: flex; justify-content: space-between; margin: 10px 0; padding: 8px; background: #1a1a1a; border-radius: 4px; }"
-".stat-label { font-weight: 600; color: #bbb; }"
-".stat-value { color: #4CAF50; font-family: 'Courier New', monospace; }"
-".progress-bar { width: 100%; height: 20px; background: #1a1a1a; border-radius: 10px; overflow: hidden; margin: 5px 0; }"
-".progress-fill { height: 100%; background: linear-gradient(90deg, #4CAF50, #8BC34A); transition: width 0.3s; }"
-".progress-fill.warning { background: linear-gradient(90deg, #FF9800, #FFC107); }"
-".progress-fill.danger { background: linear-gradient(90deg, #F44336, #E91E63); }"
-".task-table { width: 100%; border-collapse: collapse; margin-top: 10px; }"
-".task-table th { background: #1a1a1a; padding: 10px; text-align: left; color: #4CAF50; border-bottom: 2px solid #4CAF50; }"
-".task-table td { padding: 8px; border-bottom: 1px solid #333; }"
-".task-table tr:hover { background: #333; }"
-".core-badge { display: inline-block; padding: 4px 8px; border-radius: 4px; font-size: 0.85em; margin-left: 5px; }"
-".core-0 { background: #2196F3; color: white; }"
-".core-1 { background: #FF9800; color: white; }"
-".refresh-info { text-align: center; color: #666; margin-top: 20px; font-size: 0.9em; }"
-"</style>"
-"</head>"
-"<body>"
-"<div class='container'>"
-"<h1>🤖 Naphome Status Dashboard</h1>"
-"<p class='subtitle'>Real-time MCU Monitoring - nap.local</p>"
-"<div class='grid'>"
-"<div class='card'>"
-"<h2>System Information</h2>"
-"<div class='stat'><span class='stat-label'>Chip Model:</span><span class='stat-value' id='chip-model'>-</span></div>"
-"<div class='stat'><span class='stat-label'>Cores:</span><span class='stat-value' id='cores'>-</span></div>"
-"<div class='stat'><span class='stat-label'>Revision:</span><span class='stat-value' id='revision'>-</span></div>"
-"<div class='stat'><span class='stat-label'>CPU Frequency:</span><span class='stat-value' id='cpu-freq'>-</span></div>"
-"<div class='stat'><span class='stat-label'>Uptime:</span><span class='stat-value' id='uptime'>-</span></div>"
-"</div>"
-"<div class='card'>"
-"<h2>Memory Usage</h2>"
-"<div class='stat'><span class='stat-label'>Free Heap:</span><span class='stat-value' id='free-heap'>-</span></div>"
-"<div class='stat'><span class='stat-label'>Largest Free Block:</span><span class='stat-value' id='largest-block'>-</span></div>"
-"<div class='stat'><span class='stat-label'>Min Free Ever:</span><span class='stat-value' id='min-free'>-</span></div>"
-"<div class='progress-bar'><div class='progress-fill' id='heap-progress' style='width: 0%'></div></div>"
-"<div class='stat'><span class='stat-label'>PSRAM Free:</span><span class='stat-value' id='psram-free'>-</span></div>"
-"<div class='stat'><span class='stat-label'>PSRAM Total:</span><span class='stat-value' id='psram-total'>-</span></div>"
-"</div>"
-"<div class='card'>"
-"<h2>CPU Usage</h2>"
-"<div class='stat'><span class='stat-label'>Core 0 Usage:</span><span class='stat-value' id='core0-usage'>-</span></div>"
-"<div class='progress-bar'><div class='progress-fill' id='core0-progress' style='width: 0%'></div></div>"
-"<div class='stat'><span class='stat-label'>Core 1 Usage:</span><span class='stat-value' id='core1-usage'>-</span></div>"
-"<div class='progress-bar'><div class='progress-fill' id='core1-progress' style='width: 0%'></div></div>"
-"</div>"
-"</div>"
-"<div class='card'>"
-"<h2>Running Tasks</h2>"
-"<table class='task-table'>"
-"<thead>"
-"<tr>"
-"<th>Task Name</th>"
-"<th>State</th>"
-"<th>Priority</th>"
-"<th>Stack High Water</th>"
-"<th>Core</th>"
-"</tr>"
-"</thead>"
-"<tbody id='task-list'>"
-"<tr><td colspan='5' style='text-align: center;'>Loading...</td></tr>"
-"</tbody>"
-"</table>"
-"</div>"
-"<div class='card'>"
-"<h2>Phase 0.9 Test Status</h2>"
-"<div style='margin-bottom: 15px; text-align: center;'>"
-"<button id='run-demo-btn' onclick='runDemo()' style='background: #4CAF50; color: white; border: none; padding: 12px 24px; border-radius: 6px; font-size: 16px; font-weight: bold; cursor: pointer; margin-bottom: 15px;'>🚀 Run Demo / Test Suite</button>"
-"<div id='demo-status' style='color: #888; font-size: 0.9em; margin-bottom: 10px;'></div>"
-"</div>"
-"<div style='margin-bottom: 15px;'>"
-"<div class='stat'><span class='stat-label'>Tests Passed:</span><span class='stat-value' id='tests-passed'>-</span></div>"
-"<div class='stat'><span class='stat-label'>Tests Warning:</span><span class='stat-value' id='tests-warning'>-</span></div>"
-"<div class='stat'><span class='stat-label'>Tests Failed:</span><span class='stat-value' id='tests-failed'>-</span></div>"
-"<div class='stat'><span class='stat-label'>Not Implemented:</span><span class='stat-value' id='tests-notimpl'>-</span></div>"
-"</div>"
-"<table class='task-table'>"
-"<thead>"
-"<tr>"
-"<th>#</th>"
-"<th>Test Name</th>"
-"<th>Status</th>"
-"</tr>"
-"</thead>"
-"<tbody id='test-list'>"
-"<tr><td colspan='3' style='text-align: center;'>Loading...</td></tr>"
-"</tbody>"
-"</table>"
-"</div>"
-"<div class='card' style='grid-column: 1 / -1;'>"
-"<h2>📊 GitHub Activity Dashboard</h2>"
-"<div id='github-loading' style='text-align: center; color: #888; padding: 20px;'>Loading GitHub activity...</div>"
-"<div id='github-dashboard' style='display: none;'>"
-"<div class='grid' style='grid-template-columns: repeat(auto-fit, minmax(200px, 1fr)); margin-bottom: 20px;'>"
-"<div class='stat' style='flex-direction: column; text-align: center; background: #1a1a1a; padding: 15px; border-radius: 6px;'>"
-"<div style='font-size: 2em; color: #4CAF50; font-weight: bold;' id='github-commits'>-</div>"
-"<div style='color: #bbb; margin-top: 5px;'>Commits</div>"
-"</div>"
-"<div class='stat' style='flex-direction: column; text-align: center; background: #1a1a1a; padding: 15px; border-radius: 6px;'>"
-"<div style='font-size: 2em; color: #2196F3; font-weight: bold;' id='github-prs'>-</div>"
-"<div style='color: #bbb; margin-top: 5px;'>Pull Requests</div>"
-"</div>"
-"<div class='stat' style='flex-direction: column; text-align: center; background: #1a1a1a; padding: 15px; border-radius: 6px;'>"
-"<div style='font-size: 2em; color: #FF9800; font-weight: bold;' id='github-issues'>-</div>"
-"<div style='color: #bbb; margin-top: 5px;'>Issues</div>"
-"</div>"
-"<div class='stat' style='flex-direction: column; text-align: center; background: #1a1a1a; padding: 15px; border-radius: 6px;'>"
-"<div style='font-size: 2em; color: #9C27B0; font-weight: bold;' id='github-repos'>-</div>"
-"<div style='color: #bbb; margin-top: 5px;'>Repositories</div>"
-"</div>"
-"</div>"
-"<div style='margin-top: 20px;'>"
-"<h3 style='color: #4CAF50; margin-bottom: 10px; font-size: 1em;'>Recent Activity</h3>"
-"<div id='github-activity-list' style='max-height: 300px; overflow-y: auto;'>"
-"<div style='text-align: center; color: #888; padding: 20px;'>Loading activity...</div>"
-"</div>"
-"</div>"
-"<div style='margin-top: 20px; padding: 15px; background: #1a1a1a; border-radius: 6px;'>"
-"<h3 style='color: #4CAF50; margin-bottom: 10px; font-size: 1em;'>Contribution Heatmap (Last 30 Days)</h3>"
-"<div id='github-heatmap' style='display: flex; flex-wrap: wrap; gap: 4px; justify-content: center;'>"
-"</div>"
-"</div>"
-"</div>"
-"</div>"
-"<p class='refresh-info'>Auto-refreshing every 2 seconds | GitHub activity updates every 30 seconds</p>"
-"</div>"
-"<script>"
-"function formatBytes(bytes) {"
-"  if (bytes < 1024) return bytes + ' B';"
-"  if (bytes < 1024*1024) return (bytes/1024).toFixed(2) + ' KB';"
-"  return (bytes/(1024*1024)).toFixed(2) + ' MB';"
-"}"
-"function formatTime(seconds) {"
-"  const days = Math.floor(seconds / 86400);"
-"  const hours = Math.floor((seconds % 86400) / 3600);"
-"  const mins = Math.floor((seconds % 3600) / 60);"
-"  const secs = seconds % 60;"
-"  if (days > 0) return days + 'd ' + hours + 'h ' + mins + 'm';"
-"  if (hours > 0) return hours + 'h ' + mins + 'm ' + secs + 's';"
-"  return mins + 'm ' + secs + 's';"
-"}"
-"function updateStatus() {"
-"  fetch('/api/status')"
-"    .then(response => response.json())"
-"    .then(data => {"
-"      // System Info"
-"      document.getElementById('chip-model').textContent = data.system.chip_model || '-';"
-"      document.getElementById('cores').textContent = data.system.cores || '-';"
-"      document.getElementById('revision').textContent = data.system.revision || '-';"
-"      document.getElementById('cpu-freq').textContent = (data.system.cpu_freq_mhz || 0) + ' MHz';"
-"      document.getElementById('uptime').textContent = formatTime(data.system.uptime_seconds || 0);"
-"      // Memory"
-"      const freeHeap = data.memory.free_heap || 0;"
-"      const totalHeap = data.memory.total_heap || 0;"
-"      const heapUsed = totalHeap - freeHeap;"
-"      const heapPercent = totalHeap > 0 ? (heapUsed / totalHeap * 100) : 0;"
-"      document.getElementById('free-heap').textContent = formatBytes(freeHeap);"
-"      document.getElementById('largest-block').textContent = formatBytes(data.memory.largest_free_block || 0);"
-"      document.getElementById('min-free').textContent = formatBytes(data.memory.min_free_heap || 0);"
-"      const heapProgress = document.getElementById('heap-progress');"
-"      heapProgress.style.width = heapPercent + '%';"
-"      if (heapPercent > 80) heapProgress.className = 'progress-fill danger';"
-"      else if (heapPercent > 60) heapProgress.className = 'progress-fill warning';"
-"      else heapProgress.className = 'progress-fill';"
-"      document.getElementById('psram-free').textContent = formatBytes(data.memory.psram_free || 0);"
-"      document.getElementById('psram-total').textContent = formatBytes(data.memory.psram_total || 0);"
-"      // CPU Usage"
-"      const core0Usage = data.cpu.core0_usage || 0;"
-"      const core1Usage = data.cpu.core1_usage || 0;"
-"      document.getElementById('core0-usage').textContent = core0Usage.toFixed(1) + '%';"
-"      document.getElementById('core1-usage').textContent = core1Usage.toFixed(1) + '%';"
-"      const core0Progress = document.getElementById('core0-progress');"
-"      const core1Progress = document.getElementById('core1-progress');"
-"      core0Progress.style.width = core0Usage + '%';"
-"      core1Progress.style.width = core1Usage + '%';"
-"      if (core0Usage > 80) core0Progress.className = 'progress-fill danger';"
-"      else if (core0Usage > 60) core0Progress.className = 'progress-fill warning';"
-"      else core0Progress.className = 'progress-fill';"
-"      if (core1Usage > 80) core1Progress.className = 'progress-fill danger';"
-"      else if (core1Usage > 60) core1Progress.className = 'progress-fill warning';"
-"      else core1Progress.className = 'progress-fill';"
-"      // Tasks"
-"      const taskList = document.getElementById('task-list');"
-"      if (data.tasks && data.tasks.length > 0) {"
-"        taskList.innerHTML = data.tasks.map(task => {"
-"          const stateNames = {'Running': '🟢 Running', 'Ready': '🟡 Ready', 'Blocked': '🔴 Blocked', 'Suspended': '⚪ Suspended'};"
-"          const state = stateNames[task.state] || task.state;"
-"          const coreBadge = task.core_id >= 0 ? `<span class='core-badge core-${task.core_id}'>Core ${task.core_id}</span>` : '<span class=\"core-badge\">Any</span>';"
-"          return `<tr>"
-"            <td>${task.name || 'Unknown'}</td>"
-"            <td>${state}</td>"
-"            <td>${task.priority || '-'}</td>"
-"            <td>${formatBytes(task.stack_high_water || 0)}</td>"
-"            <td>${coreBadge}</td>"
-"          </tr>`;"
-"        }).join('');"
-"      } else {"
-"        taskList.innerHTML = '<tr><td colspan=\"5\" style=\"text-align: center;\">No tasks found</td></tr>';"
-"      }"
-"      // Test Status"
-"      if (data.tests) {"
-"        let passCount = 0, warnCount = 0, failCount = 0, notImplCount = 0;"
-"        const testList = document.getElementById('test-list');"
-"        if (data.tests.length > 0) {"
-"          testList.innerHTML = data.tests.map((test, idx) => {"
-"            const statusNames = {"
-"              0: '<span style=\"color: #4CAF50; font-weight: bold;\">✅ PASS</span>',"
-"              1: '<span style=\"color: #FF9800; font-weight: bold;\">⚠️ WARNING</span>',"
-"              2: '<span style=\"color: #F44336; font-weight: bold;\">❌ FAIL</span>',"
-"              3: '<span style=\"color: #888; font-weight: bold;\">⚪ NOT IMPLEMENTED</span>'"
-"            };"
-"            const status = statusNames[test.status] || '<span>Unknown</span>';"
-"            if (test.status === 0) passCount++;"
-"            else if (test.status === 1) warnCount++;"
-"            else if (test.status === 2) failCount++;"
-"            else if (test.status === 3) notImplCount++;"
-"            return `<tr>"
-"              <td>${idx + 1}</td>"
-"              <td>${test.name || 'Test ' + (idx + 1)}</td>"
-"              <td>${status}</td>"
-"            </tr>`;"
-"          }).join('');"
-"        } else {"
-"          testList.innerHTML = '<tr><td colspan=\"3\" style=\"text-align: center;\">No test data available</td></tr>';"
-"        }"
-"        document.getElementById('tests-passed').textContent = passCount;"
-"        document.getElementById('tests-warning').textContent = warnCount;"
-"        document.getElementById('tests-failed').textContent = failCount;"
-"        document.getElementById('tests-notimpl').textContent = notImplCount;"
-"      }"
-"    })"
-"    .catch(error => {"
-"      console.error('Error fetching status:', error);"
-"    });"
-"}"
-"function runDemo() {"
-"  const btn = document.getElementById('run-demo-btn');"
-"  const status = document.getElementById('demo-status');"
-"  btn.disabled = true;"
-"  btn.textContent = 'Starting Demo...';"
-"  status.textContent = 'Triggering demo/test suite...';"
-"  fetch('/api/demo/run', { method: 'POST' })"
-"    .then(response => response.json())"
-"    .then(data => {"
-"      if (data.success) {"
-"        status.textContent = '✅ Demo started! Tests are running...';"
-"        status.style.color = '#4CAF50';"
-"        setTimeout(() => {"
-"          btn.disabled = false;"
-"          btn.textContent = '🚀 Run Demo / Test Suite';"
-"          status.textContent = '';"
-"        }, 5000);"
-"      } else {"
-"        status.textContent = '⚠️ ' + (data.message || 'Demo already running or failed to start');"
-"        status.style.color = '#FF9800';"
-"        btn.disabled = false;"
-"        btn.textContent = '🚀 Run Demo / Test Suite';"
-"      }"
-"    })"
-"    .catch(error => {"
-"      status.textContent = '❌ Error: ' + error.message;"
-"      status.style.color = '#F44336';"
-"      btn.disabled = false;"
-"      btn.textContent = '🚀 Run Demo / Test Suite';"
-"    });"
-"}"
-"// Update immediately and then every 2 seconds"
-"updateStatus();"
-"let githubUpdateInterval = null;"
-"function updateGitHubActivity() {"
-"  fetch('/api/github')"
-"    .then(response => response.json())"
-"    .then(data => {"
-"      if (data.error) {"
-"        document.getElementById('github-loading').textContent = 'GitHub data unavailable: ' + data.error;"
-"        return;"
-"      }"
-"      document.getElementById('github-loading').style.display = 'none';"
-"      document.getElementById('github-dashboard').style.display = 'block';"
-"      "
-"      // Update stats"
-"      document.getElementById('github-commits').textContent = data.commits || 0;"
-"      document.getElementById('github-prs').textContent = data.pull_requests || 0;"
-"      document.getElementById('github-issues').textContent = data.issues || 0;"
-"      document.getElementById('github-repos').textContent = data.repositories || 0;"
-"      "
-"      // Update activity list"
-"      const activityList = document.getElementById('github-activity-list');"
-"      if (data.recent_activity && data.recent_activity.length > 0) {"
-"        activityList.innerHTML = data.recent_activity.map(activity => {"
-"          const date = new Date(activity.date).toLocaleDateString();"
-"          const icon = activity.type === 'commit' ? '💾' : activity.type === 'pr' ? '🔀' : activity.type === 'issue' ? '📝' : '⭐';"
-"          return `<div style='padding: 10px; margin: 5px 0; background: #2a2a2a; border-radius: 4px; border-left: 3px solid #4CAF50;'>"
-"            <div style='display: flex; justify-content: space-between; align-items: center;'>"
-"              <div><span style='font-size: 1.2em; margin-right: 8px;'>${icon}</span><strong>${activity.title}</strong></div>"
-"              <div style='color: #888; font-size: 0.9em;'>${date}</div>"
-"            </div>"
-"            ${activity.repo ? `<div style='color: #bbb; font-size: 0.85em; margin-top: 5px; margin-left: 28px;'>${activity.repo}</div>` : ''}"
-"          </div>`;"
-"        }).join('');"
-"      } else {"
-"        activityList.innerHTML = '<div style=\"text-align: center; color: #888; padding: 20px;\">No recent activity</div>';"
-"      }"
-"      "
-"      // Update heatmap"
-"      const heatmap = document.getElementById('github-heatmap');"
-"      if (data.heatmap && data.heatmap.length > 0) {"
-"        heatmap.innerHTML = data.heatmap.map(day => {"
-"          const intensity = Math.min(day.count / 10, 1);"
-"          const opacity = 0.3 + (intensity * 0.7);"
-"          const color = day.count === 0 ? '#161b22' : day.count < 3 ? '#0e4429' : day.count < 6 ? '#006d32' : day.count < 10 ? '#26a641' : '#39d353';"
-"          return `<div style='width: 12px; height: 12px; background: ${color}; border-radius: 2px; opacity: ${opacity};' title='${day.date}: ${day.count} contributions'></div>`;"
-"        }).join('');"
-"      } else {"
-"        heatmap.innerHTML = '<div style=\"text-align: center; color: #888; padding: 10px;\">No contribution data available</div>';"
-"      }"
-"    })"
-"    .catch(error => {"
-"      console.error('GitHub activity fetch error:', error);"
-"      document.getElementById('github-loading').textContent = 'Failed to load GitHub activity';"
-"    });"
-"}"
-"setInterval(updateStatus, 2000);"
-"// Update GitHub activity every 30 seconds"
-"updateGitHubActivity();"
-"if (!githubUpdateInterval) {"
-"  githubUpdateInterval = setInterval(updateGitHubActivity, 30000);"
-"}"
-"</script>"
-"</body>"
-"</html>";
-
-// Handler for root path - serve HTML page
-static esp_err_t root_get_handler(httpd_req_t *req)
-{
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, status_html, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+// JSON responses are streamed through a small stack buffer in HTTP chunks
+#define JSON_CHUNK_SIZE 512
+
+static esp_err_t json_chunk_flush(const char *data, size_t len, void *ctx)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+static void json_response_begin(httpd_req_t *req, json_writer_t *w, char *buf, size_t buf_len)
+{
+    httpd_resp_set_type(req, "application/json");
+    json_writer_init(w, buf, buf_len, json_chunk_flush, req);
+}
+
+static esp_err_t json_response_end(httpd_req_t *req, json_writer_t *w)
+{
+    esp_err_t ret = json_writer_finish(w);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "JSON response for %s failed: %s", req->uri, esp_err_to_name(ret));
+    }
+    httpd_resp_send_chunk(req, NULL, 0);  // Terminating chunk
+    return ret;
 }
 
 // Handler for /api/demo/run - trigger demo
@@ -466,47 +146,72 @@ static esp_err_t api_demo_run_handler(httpd_req_t *req)
     
     bool success = web_server_trigger_demo();
     
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddBoolToObject(response, "success", success);
+    // Small fixed document, no chunking needed
+    char buf[96];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), NULL, NULL);
+    json_writer_object_begin(&w);
+    json_kv_bool(&w, "success", success);
     if (!success) {
-        cJSON_AddStringToObject(response, "message", "Demo already running or failed to start");
+        json_kv_string(&w, "message", "Demo already running or failed to start");
     } else {
-        cJSON_AddStringToObject(response, "message", "Demo started successfully");
+        json_kv_string(&w, "message", "Demo started successfully");
+    }
+    json_writer_object_end(&w);
+    if (json_writer_finish(&w) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, NULL);
+        return ESP_FAIL;
     }
     
-    char *json_string = cJSON_Print(response);
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json_string, strlen(json_string));
-    
-    free(json_string);
-    cJSON_Delete(response);
+    httpd_resp_send(req, buf, w.len);
     
     return ESP_OK;
 }
 
-// Handler for /api/status - return JSON status
-static esp_err_t api_status_handler(httpd_req_t *req)
+// Sampler snapshot shared by the handlers below. They all run on the single
+// httpd task, so one static copy keeps ~1 KB off its small stack.
+static task_stats_snapshot_t stats_snapshot;
+
+static void write_heap_caps(json_writer_t *w, const task_stats_heap_t *h)
+{
+    json_writer_object_begin(w);
+    json_kv_uint(w, "free", h->free);
+    json_kv_uint(w, "total", h->total);
+    json_kv_uint(w, "largest_free_block", h->largest_free_block);
+    json_kv_uint(w, "min_free", h->min_free);
+    json_writer_object_end(w);
+}
+
+// Dashboard sections, used to build both /api/status and WebSocket deltas
+#define STATUS_SECTION_SYSTEM   (1u << 0)   // system, memory, tasks, cpu (refreshed by task_stats)
+#define STATUS_SECTION_SENSORS  (1u << 1)
+#define STATUS_SECTION_TESTS    (1u << 2)
+#define STATUS_SECTION_ALL      (STATUS_SECTION_SYSTEM | STATUS_SECTION_SENSORS | STATUS_SECTION_TESTS)
+#define STATUS_TESTS_ALL        ((1u << MAX_TESTS) - 1)
+
+// Latest sensor reading published on the event bus
+static telemetry_sample_t latest_sensors;
+static bool have_sensors = false;
+static portMUX_TYPE sensors_mutex = portMUX_INITIALIZER_UNLOCKED;
+
+static void write_system_section(json_writer_t *w)
 {
-    cJSON *root = cJSON_CreateObject();
-    cJSON *system = cJSON_CreateObject();
-    cJSON *memory = cJSON_CreateObject();
-    cJSON *cpu = cJSON_CreateObject();
-    cJSON *tasks = cJSON_CreateArray();
-    cJSON *tests = cJSON_CreateArray();
+    task_stats_snapshot_t *snap = &stats_snapshot;
+    bool have_stats = (task_stats_get(snap) == ESP_OK);
 
     // System information
     esp_chip_info_t chip_info;
     esp_chip_info(&chip_info);
     
     const char* chip_model = "ESP32-S3";
-    cJSON_AddStringToObject(system, "chip_model", chip_model);
-    cJSON_AddNumberToObject(system, "cores", chip_info.cores);
-    cJSON_AddNumberToObject(system, "revision", chip_info.revision);
-    // Get CPU frequency (use default for now - can be read from sdkconfig)
-    cJSON_AddNumberToObject(system, "cpu_freq_mhz", 240);  // Default 240MHz for ESP32-S3
-    
-    // Get uptime (use FreeRTOS tick count)
-    cJSON_AddNumberToObject(system, "uptime_seconds", xTaskGetTickCount() * portTICK_PERIOD_MS / 1000);
+    json_kv_object(w, "system");
+    json_kv_string(w, "chip_model", chip_model);
+    json_kv_uint(w, "cores", chip_info.cores);
+    json_kv_uint(w, "revision", chip_info.revision);
+    json_kv_uint(w, "cpu_freq_mhz", have_stats ? snap->cpu_freq_mhz : 0);
+    json_kv_uint(w, "uptime_seconds", esp_timer_get_time() / 1000000);
+    json_writer_object_end(w);
 
     // Memory information
     size_t free_heap = esp_get_free_heap_size();
@@ -517,85 +222,433 @@ static esp_err_t api_status_handler(httpd_req_t *req)
     heap_caps_get_info(&heap_info, MALLOC_CAP_DEFAULT);
     size_t total_heap = heap_info.total_free_bytes + heap_info.total_allocated_bytes;
     
-    cJSON_AddNumberToObject(memory, "free_heap", free_heap);
-    cJSON_AddNumberToObject(memory, "total_heap", total_heap);
-    cJSON_AddNumberToObject(memory, "largest_free_block", largest_free);
-    cJSON_AddNumberToObject(memory, "min_free_heap", min_free);
+    json_kv_object(w, "memory");
+    json_kv_uint(w, "free_heap", free_heap);
+    json_kv_uint(w, "total_heap", total_heap);
+    json_kv_uint(w, "largest_free_block", largest_free);
+    json_kv_uint(w, "min_free_heap", min_free);
     
     // PSRAM information (if available)
     size_t psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
     size_t psram_total = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
-    cJSON_AddNumberToObject(memory, "psram_free", psram_free);
-    cJSON_AddNumberToObject(memory, "psram_total", psram_total);
-
-    // CPU usage (simplified - calculate based on idle task runtime)
-    // Note: This is a simplified calculation. For accurate CPU usage, 
-    // you'd need to enable FreeRTOS run-time stats
-    float core0_usage = 0.0f;
-    float core1_usage = 0.0f;
-    
-    // Get task information
-    // Note: Detailed task info requires CONFIG_FREERTOS_USE_TRACE_FACILITY
-    // For now, we'll create a simplified task list
-    UBaseType_t num_tasks = uxTaskGetNumberOfTasks();
-    
-    // Create a basic task entry showing system is running
-    // In a full implementation, you'd enable FreeRTOS trace facility
-    // and use uxTaskGetSystemState() to get detailed task info
-    cJSON *task = cJSON_CreateObject();
-    cJSON_AddStringToObject(task, "name", "System");
-    cJSON_AddStringToObject(task, "state", "Running");
-    cJSON_AddNumberToObject(task, "priority", 1);
-    cJSON_AddNumberToObject(task, "stack_high_water", 0);
-    cJSON_AddNumberToObject(task, "core_id", 0);
-    cJSON_AddItemToArray(tasks, task);
-    
-    // Add entry showing total task count
-    task = cJSON_CreateObject();
-    char task_count_str[32];
-    snprintf(task_count_str, sizeof(task_count_str), "Total Tasks: %d", num_tasks);
-    cJSON_AddStringToObject(task, "name", task_count_str);
-    cJSON_AddStringToObject(task, "state", "-");
-    cJSON_AddNumberToObject(task, "priority", 0);
-    cJSON_AddNumberToObject(task, "stack_high_water", 0);
-    cJSON_AddNumberToObject(task, "core_id", -1);
-    cJSON_AddItemToArray(tasks, task);
-    
-    cJSON_AddNumberToObject(cpu, "core0_usage", core0_usage);
-    cJSON_AddNumberToObject(cpu, "core1_usage", core1_usage);
+    json_kv_uint(w, "psram_free", psram_free);
+    json_kv_uint(w, "psram_total", psram_total);
+    if (have_stats) {
+        json_key(w, "internal");
+        write_heap_caps(w, &snap->heap_internal);
+        json_key(w, "spiram");
+        write_heap_caps(w, &snap->heap_spiram);
+        json_key(w, "dma");
+        write_heap_caps(w, &snap->heap_dma);
+    }
+    json_writer_object_end(w);
+
+    // Tasks, busiest first, with CPU share over the last sampling interval
+    json_kv_array(w, "tasks");
+    for (uint32_t i = 0; have_stats && i < snap->num_tasks; i++) {
+        const task_stats_task_t *t = &snap->tasks[i];
+        json_writer_object_begin(w);
+        json_kv_string(w, "name", t->name);
+        json_kv_string(w, "state", task_stats_state_name(t->state));
+        json_kv_uint(w, "priority", t->priority);
+        json_kv_uint(w, "stack_high_water", t->stack_high_water);
+        json_kv_int(w, "core_id", t->core_id);
+        json_kv_double(w, "cpu_percent", t->cpu_percent, 1);
+        json_writer_object_end(w);
+    }
+    json_writer_array_end(w);
 
-    // Test status information
+    json_kv_object(w, "cpu");
+    json_kv_bool(w, "valid", have_stats && snap->cpu_valid);
+    json_kv_double(w, "core0_usage", have_stats ? snap->core_usage[0] : 0.0, 1);
+    json_kv_double(w, "core1_usage", have_stats && portNUM_PROCESSORS > 1 ? snap->core_usage[portNUM_PROCESSORS - 1] : 0.0, 1);
+    json_kv_uint(w, "interval_ms", have_stats ? snap->interval_ms : 0);
+    json_kv_uint(w, "total_tasks", have_stats ? snap->total_tasks : uxTaskGetNumberOfTasks());
+    json_writer_object_end(w);
+}
+
+static void write_sensors_section(json_writer_t *w)
+{
+    telemetry_sample_t sample;
+    portENTER_CRITICAL(&sensors_mutex);
+    bool valid = have_sensors;
+    sample = latest_sensors;
+    portEXIT_CRITICAL(&sensors_mutex);
+
+    json_kv_object(w, "sensors");
+    if (valid) {
+        json_kv_uint(w, "timestamp", sample.timestamp);
+        if (sample.valid_mask & TELEMETRY_SENSOR_SHT30) {
+            json_kv_double(w, "temperature_c", sample.temperature_c, 2);
+            json_kv_double(w, "humidity_rh", sample.humidity_rh, 2);
+        }
+        if (sample.valid_mask & TELEMETRY_SENSOR_SGP30) {
+            json_kv_uint(w, "tvoc_ppb", sample.tvoc_ppb);
+            json_kv_uint(w, "eco2_ppm", sample.eco2_ppm);
+        }
+        if (sample.valid_mask & TELEMETRY_SENSOR_BH1750) {
+            json_kv_double(w, "lux", sample.lux, 1);
+        }
+        if (sample.valid_mask & TELEMETRY_SENSOR_SCD30) {
+            json_kv_double(w, "co2_ppm", sample.co2_ppm, 1);
+        }
+    }
+    json_writer_object_end(w);
+}
+
+// Writes the tests whose bit is set in tests_mask, each tagged with test_num
+static void write_tests_section(json_writer_t *w, uint32_t tests_mask)
+{
+    // Copied out so nothing is sent inside the critical section
+    test_status_info_t statuses[MAX_TESTS];
     portENTER_CRITICAL(&test_status_mutex);
+    memcpy(statuses, test_statuses, sizeof(statuses));
+    portEXIT_CRITICAL(&test_status_mutex);
+
+    json_kv_array(w, "tests");
     for (int i = 0; i < MAX_TESTS; i++) {
-        cJSON *test = cJSON_CreateObject();
-        cJSON_AddNumberToObject(test, "test_num", i + 1);
-        if (test_statuses[i].has_status) {
-            cJSON_AddStringToObject(test, "name", test_statuses[i].name);
-            cJSON_AddNumberToObject(test, "status", test_statuses[i].status);
+        if (!(tests_mask & (1u << i))) {
+            continue;
+        }
+        json_writer_object_begin(w);
+        json_kv_int(w, "test_num", i + 1);
+        if (statuses[i].has_status) {
+            json_kv_string(w, "name", statuses[i].name);
+            json_kv_int(w, "status", statuses[i].status);
         } else {
-            cJSON_AddStringToObject(test, "name", test_descriptions[i]);
-            cJSON_AddNumberToObject(test, "status", 3);  // 3 = TEST_STATUS_NOT_IMPLEMENTED
+            json_kv_string(w, "name", test_descriptions[i]);
+            json_kv_int(w, "status", 3);  // 3 = TEST_STATUS_NOT_IMPLEMENTED
         }
-        cJSON_AddItemToArray(tests, test);
+        json_writer_object_end(w);
     }
-    portEXIT_CRITICAL(&test_status_mutex);
+    json_writer_array_end(w);
+}
 
-    cJSON_AddItemToObject(root, "system", system);
-    cJSON_AddItemToObject(root, "memory", memory);
-    cJSON_AddItemToObject(root, "cpu", cpu);
-    cJSON_AddItemToObject(root, "tasks", tasks);
-    cJSON_AddItemToObject(root, "tests", tests);
+static void write_status_sections(json_writer_t *w, uint32_t sections, uint32_t tests_mask)
+{
+    if (sections & STATUS_SECTION_SYSTEM) {
+        write_system_section(w);
+    }
+    if (sections & STATUS_SECTION_SENSORS) {
+        write_sensors_section(w);
+    }
+    if (sections & STATUS_SECTION_TESTS) {
+        write_tests_section(w, tests_mask);
+    }
+}
 
-    char *json_string = cJSON_Print(root);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json_string, strlen(json_string));
-    
-    free(json_string);
-    cJSON_Delete(root);
+// Handler for /api/status - return JSON status
+static esp_err_t api_status_handler(httpd_req_t *req)
+{
+    char buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(req, &w, buf, sizeof(buf));
+    json_writer_object_begin(&w);
+    write_status_sections(&w, STATUS_SECTION_ALL, STATUS_TESTS_ALL);
+    json_writer_object_end(&w);
+    json_response_end(req, &w);
     
     return ESP_OK;
 }
 
+// Handler for /api/metrics - compact sampler output for frequent polling.
+// Tasks are rows of [name, cpu%, stack_high_water, core, priority].
+static esp_err_t api_metrics_handler(httpd_req_t *req)
+{
+    task_stats_snapshot_t *snap = &stats_snapshot;
+    if (task_stats_get(snap) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No samples yet");
+        return ESP_OK;
+    }
+
+    char buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(req, &w, buf, sizeof(buf));
+    json_writer_object_begin(&w);
+    json_kv_uint(&w, "seq", snap->sequence);
+    json_kv_int(&w, "t_ms", snap->timestamp_us / 1000);
+    json_kv_uint(&w, "interval_ms", snap->interval_ms);
+    json_kv_uint(&w, "cpu_mhz", snap->cpu_freq_mhz);
+    json_kv_bool(&w, "cpu_valid", snap->cpu_valid);
+    json_kv_array(&w, "cores");
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        json_writer_double(&w, snap->core_usage[core], 1);
+    }
+    json_writer_array_end(&w);
+
+    // [free, largest_free_block, min_free] per capability
+    const task_stats_heap_t *heaps[] = { &snap->heap_internal, &snap->heap_spiram, &snap->heap_dma };
+    json_kv_array(&w, "heap");
+    for (size_t i = 0; i < sizeof(heaps) / sizeof(heaps[0]); i++) {
+        json_writer_array_begin(&w);
+        json_writer_uint(&w, heaps[i]->free);
+        json_writer_uint(&w, heaps[i]->largest_free_block);
+        json_writer_uint(&w, heaps[i]->min_free);
+        json_writer_array_end(&w);
+    }
+    json_writer_array_end(&w);
+
+    json_kv_array(&w, "tasks");
+    for (uint32_t i = 0; i < snap->num_tasks; i++) {
+        const task_stats_task_t *t = &snap->tasks[i];
+        json_writer_array_begin(&w);
+        json_writer_string(&w, t->name);
+        json_writer_double(&w, t->cpu_percent, 1);
+        json_writer_uint(&w, t->stack_high_water);
+        json_writer_int(&w, t->core_id);
+        json_writer_uint(&w, t->priority);
+        json_writer_array_end(&w);
+    }
+    json_writer_array_end(&w);
+    json_writer_object_end(&w);
+    json_response_end(req, &w);
+
+    return ESP_OK;
+}
+
+// Handler for /metrics - Prometheus text exposition of every registered metric
+static esp_err_t prometheus_metrics_handler(httpd_req_t *req)
+{
+    static metrics_metric_t *heap_free = NULL;
+    static metrics_metric_t *heap_min_free = NULL;
+    static bool registered = false;
+    if (!registered) {
+        // Once only: a full registry returns NULL, and retrying every scrape would log every scrape
+        registered = true;
+        heap_free = metrics_gauge("naphome_heap_free_bytes", "caps=\"internal\"",
+                                  "Free internal heap");
+        heap_min_free = metrics_gauge("naphome_heap_min_free_bytes", "caps=\"internal\"",
+                                      "Lowest free internal heap since boot");
+    }
+    metrics_gauge_set(heap_free, (int32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    metrics_gauge_set(heap_min_free, (int32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+
+    char buf[JSON_CHUNK_SIZE];
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    esp_err_t ret = metrics_write_prometheus(buf, sizeof(buf), json_chunk_flush, req);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Metrics export failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+typedef struct {
+    json_writer_t *w;
+    uint32_t last_interaction;
+} trace_json_ctx_t;
+
+static void trace_event_to_json(const trace_event_t *e, void *ctx)
+{
+    trace_json_ctx_t *t = (trace_json_ctx_t *)ctx;
+    json_writer_t *w = t->w;
+
+    // Name the row of each interaction (tid) as it first appears
+    if (e->interaction != t->last_interaction) {
+        char row_name[24];
+        snprintf(row_name, sizeof(row_name), "interaction %lu", (unsigned long)e->interaction);
+        json_writer_object_begin(w);
+        json_kv_string(w, "name", "thread_name");
+        json_kv_string(w, "ph", "M");
+        json_kv_uint(w, "pid", 1);
+        json_kv_uint(w, "tid", e->interaction);
+        json_kv_object(w, "args");
+        json_kv_string(w, "name", row_name);
+        json_writer_object_end(w);
+        json_writer_object_end(w);
+        t->last_interaction = e->interaction;
+    }
+
+    json_writer_object_begin(w);
+    json_kv_string(w, "name", e->name);
+    json_kv_string(w, "cat", "voice");
+    if (e->phase == TRACE_SPAN) {
+        json_kv_string(w, "ph", "X");
+        json_kv_int(w, "ts", e->start_us);
+        json_kv_uint(w, "dur", e->dur_us);
+    } else {
+        json_kv_string(w, "ph", "i");
+        json_kv_string(w, "s", "t");
+        json_kv_int(w, "ts", e->start_us);
+    }
+    json_kv_uint(w, "pid", 1);
+    json_kv_uint(w, "tid", e->interaction);
+    json_kv_object(w, "args");
+    json_kv_uint(w, "core", e->core);
+    json_writer_object_end(w);
+    json_writer_object_end(w);
+}
+
+// Handler for /api/trace - voice pipeline spans as Chrome trace JSON.
+// ?id=N limits the output to one interaction.
+static esp_err_t api_trace_handler(httpd_req_t *req)
+{
+    uint32_t interaction = 0;
+    char query[32];
+    char value[12];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "id", value, sizeof(value)) == ESP_OK) {
+        interaction = (uint32_t)strtoul(value, NULL, 10);
+    }
+
+    char buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(req, &w, buf, sizeof(buf));
+    json_writer_object_begin(&w);
+    json_kv_string(&w, "displayTimeUnit", "ms");
+    json_kv_array(&w, "traceEvents");
+    trace_json_ctx_t ctx = { .w = &w, .last_interaction = UINT32_MAX };
+    uint32_t dropped = trace_foreach(interaction, trace_event_to_json, &ctx);
+    json_writer_array_end(&w);
+    json_kv_object(&w, "otherData");
+    json_kv_uint(&w, "current_interaction", trace_current());
+    json_kv_uint(&w, "dropped_events", dropped);
+    json_writer_object_end(&w);
+    json_writer_object_end(&w);
+    return json_response_end(req, &w);
+}
+
+static void boot_record_to_json(const boot_record_t *record, void *ctx)
+{
+    json_writer_t *w = ctx;
+    json_writer_object_begin(w);
+    json_kv_string(w, "name", record->name);
+    json_kv_string(w, "state", boot_state_name(record->state));
+    if (record->state == BOOT_STEP_FAILED || record->state == BOOT_STEP_SKIPPED) {
+        json_kv_string(w, "error", esp_err_to_name(record->err));
+    }
+    if (record->start_us) {
+        json_kv_double(w, "start_ms", record->start_us / 1000.0, 1);
+        json_kv_double(w, "duration_ms", (record->end_us - record->start_us) / 1000.0, 1);
+        json_kv_int(w, "core", record->core);
+    }
+    json_writer_object_end(w);
+}
+
+// Handler for /api/boot - init step timings and readiness milestones since power-on,
+// plus how the station connected
+static esp_err_t api_boot_handler(httpd_req_t *req)
+{
+    char buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(req, &w, buf, sizeof(buf));
+    json_writer_object_begin(&w);
+    json_kv_array(&w, "steps");
+    boot_seq_foreach(boot_record_to_json, &w);
+    json_writer_array_end(&w);
+    wifi_manager_stats_t wifi;
+    wifi_manager_get_stats(&wifi);
+    json_kv_object(&w, "wifi");
+    json_kv_bool(&w, "connected", wifi.connected);
+    json_kv_string(&w, "network", connectivity_state_name(connectivity_state()));
+    json_kv_bool(&w, "fast", wifi.fast);
+    json_kv_uint(&w, "channel", wifi.channel);
+    json_kv_uint(&w, "last_connect_ms", wifi.last_connect_ms);
+    json_kv_uint(&w, "fast_attempts", wifi.fast_attempts);
+    json_kv_uint(&w, "fast_hits", wifi.fast_hits);
+    json_kv_uint(&w, "full_scans", wifi.full_scans);
+    json_kv_uint(&w, "reconnects", wifi.reconnects);
+    json_writer_object_end(&w);
+    json_writer_object_end(&w);
+    return json_response_end(req, &w);
+}
+
+static void command_entry_to_json(const command_entry_t *entry, void *ctx)
+{
+    json_writer_t *w = ctx;
+    json_writer_object_begin(w);
+    json_kv_uint(w, "id", entry->id);
+    json_kv_string(w, "phrase", entry->phrase ? entry->phrase : "");
+    json_kv_string(w, "phonemes", entry->phonemes);
+    json_key(w, "intent");
+    if (entry->intent) {
+        json_writer_string(w, entry->intent);
+    } else {
+        json_writer_null(w);
+    }
+    json_writer_object_end(w);
+}
+
+// Handler for GET /api/commands - speech command registry
+static esp_err_t api_commands_get_handler(httpd_req_t *req)
+{
+    char buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(req, &w, buf, sizeof(buf));
+    json_writer_object_begin(&w);
+    json_kv_bool(&w, "update_pending", command_registry_update_pending());
+    json_kv_array(&w, "commands");
+    command_registry_foreach(command_entry_to_json, &w);
+    json_writer_array_end(&w);
+    json_writer_object_end(&w);
+    return json_response_end(req, &w);
+}
+
+#if CONFIG_NAPHOME_COMMANDS_UPLOAD
+// True if the request carries "Authorization: Bearer <CONFIG_NAPHOME_API_TOKEN>".
+// The comparison does not stop at the first differing byte.
+static bool api_request_authorized(httpd_req_t *req)
+{
+    static const char prefix[] = "Bearer ";
+    const char *token = CONFIG_NAPHOME_API_TOKEN;
+    size_t token_len = strlen(token);
+    char auth[96];
+    if (token_len == 0 || token_len > sizeof(auth) - sizeof(prefix) ||
+        httpd_req_get_hdr_value_str(req, "Authorization", auth, sizeof(auth)) != ESP_OK ||
+        strncmp(auth, prefix, sizeof(prefix) - 1) != 0 ||
+        strlen(auth) != sizeof(prefix) - 1 + token_len) {
+        return false;
+    }
+    uint8_t diff = 0;
+    for (size_t i = 0; i < token_len; i++) {
+        diff |= (uint8_t)(auth[sizeof(prefix) - 1 + i] ^ token[i]);
+    }
+    return diff == 0;
+}
+
+// Handler for POST /api/commands - replace the registry with a blob built by
+// gen_command_registry.py --out-bin; applied by the detect task when idle
+static esp_err_t api_commands_post_handler(httpd_req_t *req)
+{
+    if (!api_request_authorized(req)) {
+        ESP_LOGW(TAG, "Refused unauthorized command registry upload");
+        httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+        httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Missing or wrong API token");
+        return ESP_OK;
+    }
+    if (req->content_len == 0 || req->content_len > COMMAND_REGISTRY_MAX_BLOB) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Registry blob missing or too large");
+        return ESP_OK;
+    }
+    uint8_t *blob = malloc(req->content_len);
+    if (!blob) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, NULL);
+        return ESP_OK;
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+        int n = httpd_req_recv(req, (char *)blob + received, req->content_len - received);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (n <= 0) {
+            free(blob);
+            return ESP_FAIL;
+        }
+        received += n;
+    }
+
+    esp_err_t ret = command_registry_store(blob, received);
+    free(blob);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Rejected command registry: %s", esp_err_to_name(ret));
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, esp_err_to_name(ret));
+        return ESP_OK;
+    }
+    return api_commands_get_handler(req);
+}
+#endif
+
 // HTTP client event handler for GitHub API requests
 static esp_err_t github_http_event_handler(esp_http_client_event_t *evt)
 {
@@ -638,61 +691,303 @@ static esp_err_t api_github_handler(httpd_req_t *req)
     // In a full implementation, this would fetch from GitHub API
     // Using GraphQL or REST API with authentication
     
-    cJSON *root = cJSON_CreateObject();
+    char buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(req, &w, buf, sizeof(buf));
+    json_writer_object_begin(&w);
     
     // Mock GitHub activity data (replace with real API call)
     // TODO: Implement GitHub GraphQL API call using esp_http_client
-    cJSON_AddNumberToObject(root, "commits", 42);
-    cJSON_AddNumberToObject(root, "pull_requests", 8);
-    cJSON_AddNumberToObject(root, "issues", 5);
-    cJSON_AddNumberToObject(root, "repositories", 12);
+    json_kv_int(&w, "commits", 42);
+    json_kv_int(&w, "pull_requests", 8);
+    json_kv_int(&w, "issues", 5);
+    json_kv_int(&w, "repositories", 12);
     
     // Recent activity array
-    cJSON *recent_activity = cJSON_CreateArray();
+    json_kv_array(&w, "recent_activity");
     
     // Add some mock recent activities
-    cJSON *activity1 = cJSON_CreateObject();
-    cJSON_AddStringToObject(activity1, "type", "commit");
-    cJSON_AddStringToObject(activity1, "title", "Fixed MP3 playback stack overflow");
-    cJSON_AddStringToObject(activity1, "repo", "Naphome-0.9");
-    cJSON_AddStringToObject(activity1, "date", "2024-12-06T22:00:00Z");
-    cJSON_AddItemToArray(recent_activity, activity1);
+    json_writer_object_begin(&w);
+    json_kv_string(&w, "type", "commit");
+    json_kv_string(&w, "title", "Fixed MP3 playback stack overflow");
+    json_kv_string(&w, "repo", "Naphome-0.9");
+    json_kv_string(&w, "date", "2024-12-06T22:00:00Z");
+    json_writer_object_end(&w);
     
-    cJSON *activity2 = cJSON_CreateObject();
-    cJSON_AddStringToObject(activity2, "type", "pr");
-    cJSON_AddStringToObject(activity2, "title", "Added GitHub activity dashboard");
-    cJSON_AddStringToObject(activity2, "repo", "Naphome-0.9");
-    cJSON_AddStringToObject(activity2, "date", "2024-12-06T21:30:00Z");
-    cJSON_AddItemToArray(recent_activity, activity2);
+    json_writer_object_begin(&w);
+    json_kv_string(&w, "type", "pr");
+    json_kv_string(&w, "title", "Added GitHub activity dashboard");
+    json_kv_string(&w, "repo", "Naphome-0.9");
+    json_kv_string(&w, "date", "2024-12-06T21:30:00Z");
+    json_writer_object_end(&w);
     
-    cJSON_AddItemToObject(root, "recent_activity", recent_activity);
+    json_writer_array_end(&w);
     
     // Heatmap data (last 30 days)
-    cJSON *heatmap = cJSON_CreateArray();
+    json_kv_array(&w, "heatmap");
     // Generate mock heatmap data
     for (int i = 29; i >= 0; i--) {
-        cJSON *day = cJSON_CreateObject();
         // Generate date string (simplified)
         char date_str[32];
         snprintf(date_str, sizeof(date_str), "2024-12-%02d", 7 - i);
-        cJSON_AddStringToObject(day, "date", date_str);
+        json_writer_object_begin(&w);
+        json_kv_string(&w, "date", date_str);
         // Random contribution count (0-15)
         int count = (i % 7 == 0) ? 5 + (i % 3) : (i % 3);
-        cJSON_AddNumberToObject(day, "count", count);
-        cJSON_AddItemToArray(heatmap, day);
+        json_kv_int(&w, "count", count);
+        json_writer_object_end(&w);
     }
-    cJSON_AddItemToObject(root, "heatmap", heatmap);
-    
-    char *json_string = cJSON_Print(root);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json_string, strlen(json_string));
+    json_writer_array_end(&w);
     
-    free(json_string);
-    cJSON_Delete(root);
+    json_writer_object_end(&w);
+    json_response_end(req, &w);
     
     return ESP_OK;
 }
 
+// ------------------------------------------------------------------------- //
+// WebSocket push: full snapshot on connect, then only changed sections
+// ------------------------------------------------------------------------- //
+
+#define WS_MAX_CLIENTS      4       // Leaves sockets for plain HTTP (max_open_sockets = 7)
+#define WS_MIN_INTERVAL_MS  1000    // Per-client rate limit
+#define WS_PUSH_PERIOD_MS   250     // How often pending updates are checked
+#define WS_FRAME_SIZE       6144    // Largest update (a snapshot with a full task list)
+#define WS_MAX_RX           64      // Clients only listen; larger frames close the socket
+
+typedef struct {
+    bool used;
+    int fd;
+    uint32_t sections;          // STATUS_SECTION_* not yet sent
+    uint32_t tests;             // Test bits not yet sent
+    int64_t last_sent_us;       // 0 until the snapshot has gone out
+} ws_client_t;
+
+static ws_client_t ws_clients[WS_MAX_CLIENTS];
+static portMUX_TYPE ws_mutex = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t ws_push_timer = NULL;
+static volatile bool ws_push_queued = false;
+static char *ws_frame_buf = NULL;  // Only touched from the httpd task
+
+static void ws_mark_dirty(uint32_t sections, uint32_t tests)
+{
+    portENTER_CRITICAL(&ws_mutex);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (ws_clients[i].used) {
+            ws_clients[i].sections |= sections;
+            ws_clients[i].tests |= tests;
+        }
+    }
+    portEXIT_CRITICAL(&ws_mutex);
+}
+
+static void ws_remove_client(int idx)
+{
+    portENTER_CRITICAL(&ws_mutex);
+    ws_clients[idx].used = false;
+    portEXIT_CRITICAL(&ws_mutex);
+}
+
+// close_fn for every session: a WebSocket client's slot is freed when its
+// socket closes, not when it is next due, so a new client can take the slot
+// and a socket reusing the fd number is not pushed to twice
+static void ws_session_closed(httpd_handle_t hd, int sockfd)
+{
+    portENTER_CRITICAL(&ws_mutex);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (ws_clients[i].used && ws_clients[i].fd == sockfd) {
+            ws_clients[i].used = false;
+        }
+    }
+    portEXIT_CRITICAL(&ws_mutex);
+    close(sockfd);
+}
+
+// Build the update for one client's pending sections; returns the length or 0
+static size_t ws_build_update(uint32_t sections, uint32_t tests, bool snapshot)
+{
+    json_writer_t w;
+    json_writer_init(&w, ws_frame_buf, WS_FRAME_SIZE, NULL, NULL);
+    json_writer_object_begin(&w);
+    json_kv_string(&w, "type", snapshot ? "snapshot" : "delta");
+    write_status_sections(&w, sections, tests);
+    json_writer_object_end(&w);
+    if (json_writer_finish(&w) != ESP_OK) {
+        ESP_LOGW(TAG, "WebSocket update larger than %d bytes, dropped", WS_FRAME_SIZE);
+        return 0;
+    }
+    return w.len;
+}
+
+// Runs on the httpd task via httpd_queue_work
+static void ws_push_work(void *arg)
+{
+    ws_push_queued = false;
+    if (!ws_frame_buf) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    // Clients with the same pending set share one encoded frame
+    uint32_t built_sections = 0, built_tests = 0;
+    bool built_snapshot = false;
+    size_t built_len = 0;
+
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        portENTER_CRITICAL(&ws_mutex);
+        ws_client_t c = ws_clients[i];
+        bool snapshot = (c.last_sent_us == 0);
+        bool due = c.used && c.sections != 0 &&
+                   (snapshot || now - c.last_sent_us >= (int64_t)WS_MIN_INTERVAL_MS * 1000);
+        if (due) {
+            ws_clients[i].sections = 0;
+            ws_clients[i].tests = 0;
+            ws_clients[i].last_sent_us = now;
+        }
+        portEXIT_CRITICAL(&ws_mutex);
+        if (!due) {
+            continue;
+        }
+
+        if (httpd_ws_get_fd_info(server_handle, c.fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            ws_remove_client(i);  // Socket closed since the last push
+            continue;
+        }
+
+        if (built_len == 0 || c.sections != built_sections || c.tests != built_tests ||
+            snapshot != built_snapshot) {
+            built_len = ws_build_update(c.sections, c.tests, snapshot);
+            built_sections = c.sections;
+            built_tests = c.tests;
+            built_snapshot = snapshot;
+        }
+        if (built_len == 0) {
+            continue;
+        }
+
+        httpd_ws_frame_t frame = {
+            .final = true,
+            .type = HTTPD_WS_TYPE_TEXT,
+            .payload = (uint8_t *)ws_frame_buf,
+            .len = built_len,
+        };
+        if (httpd_ws_send_frame_async(server_handle, c.fd, &frame) != ESP_OK) {
+            ESP_LOGD(TAG, "WebSocket client %d gone", c.fd);
+            ws_remove_client(i);
+        }
+    }
+}
+
+static void ws_queue_push(void)
+{
+    if (ws_push_queued || !server_handle) {
+        return;
+    }
+    ws_push_queued = true;
+    if (httpd_queue_work(server_handle, ws_push_work, NULL) != ESP_OK) {
+        ws_push_queued = false;
+    }
+}
+
+// Periodic check so rate-limited updates still go out once the client is due
+static void ws_push_timer_cb(void *arg)
+{
+    bool pending = false;
+    portENTER_CRITICAL(&ws_mutex);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (ws_clients[i].used && ws_clients[i].sections) {
+            pending = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&ws_mutex);
+    if (pending) {
+        ws_queue_push();
+    }
+}
+
+// Handler for /ws - registers push clients; incoming frames are ignored
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        // Handshake completed: queue the full snapshot for this client
+        if (!ws_frame_buf) {
+            ws_frame_buf = heap_caps_malloc(WS_FRAME_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            if (!ws_frame_buf) {
+                ws_frame_buf = malloc(WS_FRAME_SIZE);
+            }
+            if (!ws_frame_buf) {
+                return ESP_ERR_NO_MEM;
+            }
+        }
+
+        int fd = httpd_req_to_sockfd(req);
+        int slot = -1;
+        portENTER_CRITICAL(&ws_mutex);
+        for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+            if (!ws_clients[i].used) {
+                ws_clients[i] = (ws_client_t){
+                    .used = true,
+                    .fd = fd,
+                    .sections = STATUS_SECTION_ALL,
+                    .tests = STATUS_TESTS_ALL,
+                    .last_sent_us = 0,
+                };
+                slot = i;
+                break;
+            }
+        }
+        portEXIT_CRITICAL(&ws_mutex);
+        if (slot < 0) {
+            ESP_LOGW(TAG, "Too many WebSocket clients, rejecting fd %d", fd);
+            return ESP_FAIL;  // Closes the socket; the page falls back to polling
+        }
+        ESP_LOGI(TAG, "WebSocket client %d connected", fd);
+        ws_queue_push();
+        return ESP_OK;
+    }
+
+    uint8_t rx[WS_MAX_RX];
+    httpd_ws_frame_t frame = { .payload = rx };
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);  // Length only
+    if (ret != ESP_OK || frame.len == 0) {
+        return ret;
+    }
+    if (frame.len > sizeof(rx)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return httpd_ws_recv_frame(req, &frame, frame.len);
+}
+
+// Event bus subscriber: records what changed, the push happens on the httpd task
+static void web_server_bus_handler(event_bus_topic_t topic, const void *data, size_t len, void *ctx)
+{
+    switch (topic) {
+        case EVENT_BUS_TOPIC_TEST_STATUS: {
+            const event_bus_test_status_t *evt = data;
+            web_server_update_test_status(evt->test_num, evt->status, evt->name);
+            if (evt->test_num >= 1 && evt->test_num <= MAX_TESTS) {
+                ws_mark_dirty(STATUS_SECTION_TESTS, 1u << (evt->test_num - 1));
+            }
+            break;
+        }
+        case EVENT_BUS_TOPIC_SENSORS:
+            if (len == sizeof(telemetry_sample_t)) {
+                portENTER_CRITICAL(&sensors_mutex);
+                memcpy(&latest_sensors, data, sizeof(latest_sensors));
+                have_sensors = true;
+                portEXIT_CRITICAL(&sensors_mutex);
+                ws_mark_dirty(STATUS_SECTION_SENSORS, 0);
+            }
+            break;
+        case EVENT_BUS_TOPIC_METRICS:
+            ws_mark_dirty(STATUS_SECTION_SYSTEM, 0);  // Re-read from task_stats when sent
+            break;
+        default:
+            break;
+    }
+}
+
 // Web server task - runs in separate thread
 static void web_server_task(void *pvParameters)
 {
@@ -727,8 +1022,9 @@ static void web_server_task(void *pvParameters)
     // Configure HTTP server
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 80;
-    config.max_uri_handlers = 10;
+    config.max_uri_handlers = 16;
     config.max_open_sockets = 7;
+    config.close_fn = ws_session_closed;
 
     ret = httpd_start(&server_handle, &config);
     if (ret != ESP_OK) {
@@ -739,12 +1035,15 @@ static void web_server_task(void *pvParameters)
     }
 
     // Register URI handlers
-    httpd_uri_t root_uri = {
-        .uri = "/",
-        .method = HTTP_GET,
-        .handler = root_get_handler,
-    };
-    httpd_register_uri_handler(server_handle, &root_uri);
+    for (size_t i = 0; i < web_assets_count; i++) {
+        httpd_uri_t asset_uri = {
+            .uri = web_assets[i].uri,
+            .method = HTTP_GET,
+            .handler = web_asset_get_handler,
+            .user_ctx = (void *)&web_assets[i],
+        };
+        httpd_register_uri_handler(server_handle, &asset_uri);
+    }
 
     httpd_uri_t api_status_uri = {
         .uri = "/api/status",
@@ -753,6 +1052,50 @@ static void web_server_task(void *pvParameters)
     };
     httpd_register_uri_handler(server_handle, &api_status_uri);
 
+    httpd_uri_t api_metrics_uri = {
+        .uri = "/api/metrics",
+        .method = HTTP_GET,
+        .handler = api_metrics_handler,
+    };
+    httpd_register_uri_handler(server_handle, &api_metrics_uri);
+
+    httpd_uri_t prometheus_uri = {
+        .uri = "/metrics",
+        .method = HTTP_GET,
+        .handler = prometheus_metrics_handler,
+    };
+    httpd_register_uri_handler(server_handle, &prometheus_uri);
+
+    httpd_uri_t api_trace_uri = {
+        .uri = "/api/trace",
+        .method = HTTP_GET,
+        .handler = api_trace_handler,
+    };
+    httpd_register_uri_handler(server_handle, &api_trace_uri);
+
+    httpd_uri_t api_boot_uri = {
+        .uri = "/api/boot",
+        .method = HTTP_GET,
+        .handler = api_boot_handler,
+    };
+    httpd_register_uri_handler(server_handle, &api_boot_uri);
+
+    httpd_uri_t api_commands_get_uri = {
+        .uri = "/api/commands",
+        .method = HTTP_GET,
+        .handler = api_commands_get_handler,
+    };
+    httpd_register_uri_handler(server_handle, &api_commands_get_uri);
+
+#if CONFIG_NAPHOME_COMMANDS_UPLOAD
+    httpd_uri_t api_commands_post_uri = {
+        .uri = "/api/commands",
+        .method = HTTP_POST,
+        .handler = api_commands_post_handler,
+    };
+    httpd_register_uri_handler(server_handle, &api_commands_post_uri);
+#endif
+
     httpd_uri_t api_demo_run_uri = {
         .uri = "/api/demo/run",
         .method = HTTP_POST,
@@ -767,6 +1110,22 @@ static void web_server_task(void *pvParameters)
     };
     httpd_register_uri_handler(server_handle, &api_github_uri);
 
+    httpd_uri_t ws_uri = {
+        .uri = "/ws",
+        .method = HTTP_GET,
+        .handler = ws_handler,
+        .is_websocket = true,
+    };
+    httpd_register_uri_handler(server_handle, &ws_uri);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = ws_push_timer_cb,
+        .name = "ws_push",
+    };
+    if (esp_timer_create(&timer_args, &ws_push_timer) == ESP_OK) {
+        esp_timer_start_periodic(ws_push_timer, WS_PUSH_PERIOD_MS * 1000);
+    }
+
     ESP_LOGI(TAG, "Web server started on port 80");
     
     // Get and log IP address
@@ -792,6 +1151,15 @@ esp_err_t web_server_start(void)
         ESP_LOGW(TAG, "Web server already running");
         return ESP_OK;
     }
+
+    // Test results, sensor readings and metrics arrive over the event bus
+    static bool bus_subscribed = false;
+    if (!bus_subscribed) {
+        uint32_t topics = EVENT_BUS_TOPIC_BIT(EVENT_BUS_TOPIC_TEST_STATUS) |
+                          EVENT_BUS_TOPIC_BIT(EVENT_BUS_TOPIC_SENSORS) |
+                          EVENT_BUS_TOPIC_BIT(EVENT_BUS_TOPIC_METRICS);
+        bus_subscribed = (event_bus_subscribe(topics, web_server_bus_handler, NULL) == ESP_OK);
+    }
     
     // Start web server in separate task
     BaseType_t ret = xTaskCreatePinnedToCore(
@@ -819,8 +1187,16 @@ esp_err_t web_server_stop(void)
         return ESP_OK;
     }
 
+    if (ws_push_timer) {
+        esp_timer_stop(ws_push_timer);
+        esp_timer_delete(ws_push_timer);
+        ws_push_timer = NULL;
+    }
     httpd_stop(server_handle);
     server_handle = NULL;
+    portENTER_CRITICAL(&ws_mutex);
+    memset(ws_clients, 0, sizeof(ws_clients));
+    portEXIT_CRITICAL(&ws_mutex);
     mdns_free();
 
     ESP_LOGI(TAG, "Web server stopped");
@@ -0,0 +1,408 @@
+/**
+ * @file wifi_manager.c
+ * @brief Fast station connect from an NVS-cached AP, scan fallback, timed reconnects
+ */
+
+#include "wifi_manager.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "nvs.h"
+#include <string.h>
+
+static const char *TAG = "wifi_mgr";
+
+#define WIFI_CONNECTED_BIT  (1 << 0)
+#define CACHE_NVS_KEY       "ap"
+#define CACHE_VERSION       1
+
+// Last AP that gave us an address
+typedef struct {
+    uint32_t version;
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_cache_t;
+
+static wifi_manager_config_t mgr_config;
+static EventGroupHandle_t wifi_events = NULL;
+static esp_timer_handle_t reconnect_timer = NULL;
+static esp_timer_handle_t cache_timer = NULL;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Touched by the event loop and the reconnect timer, never at the same time:
+// the timer only runs while the station is idle after a disconnect. The
+// cache writer copies `cache` under stats_lock.
+static wifi_cache_t cache;
+static bool cache_valid = false;
+static bool fast_pending = false;       // Current attempt is the directed one
+static uint8_t joined_bssid[6];         // AP of the current association
+static uint8_t joined_channel = 0;
+static bool ever_connected = false;
+static uint32_t backoff_ms = 0;
+static int64_t connect_start_us = 0;    // Connect request or link loss, 0 while connected
+
+static wifi_manager_stats_t mgr_stats = {0};
+
+// ---------------------------------------------------------------------------
+// AP cache
+// ---------------------------------------------------------------------------
+
+static void cache_load(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(WIFI_MANAGER_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(cache);
+    if (nvs_get_blob(handle, CACHE_NVS_KEY, &cache, &len) == ESP_OK && len == sizeof(cache) &&
+        cache.version == CACHE_VERSION && strcmp(cache.ssid, mgr_config.ssid) == 0 &&
+        cache.channel >= 1 && cache.channel <= 14) {
+        cache_valid = true;
+        ESP_LOGI(TAG, "Cached AP " MACSTR " on channel %u", MAC2STR(cache.bssid), cache.channel);
+    }
+    nvs_close(handle);
+}
+
+// Runs on the esp_timer task: a commit can stall for an erase, which the
+// default event loop must never wait on
+static void cache_persist(void *arg)
+{
+    portENTER_CRITICAL(&stats_lock);
+    wifi_cache_t snapshot = cache;
+    portEXIT_CRITICAL(&stats_lock);
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(WIFI_MANAGER_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, CACHE_NVS_KEY, &snapshot, sizeof(snapshot));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "AP not cached: %s", esp_err_to_name(ret));
+    }
+}
+
+static void cache_store(const uint8_t *bssid, uint8_t channel)
+{
+    if (cache_valid && cache.channel == channel && memcmp(cache.bssid, bssid, sizeof(cache.bssid)) == 0) {
+        return;  // Flash is only written when the AP changes
+    }
+    portENTER_CRITICAL(&stats_lock);
+    memset(&cache, 0, sizeof(cache));
+    cache.version = CACHE_VERSION;
+    strncpy(cache.ssid, mgr_config.ssid, sizeof(cache.ssid) - 1);
+    memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+    cache.channel = channel;
+    portEXIT_CRITICAL(&stats_lock);
+    cache_valid = true;
+
+    // A write still pending picks up the entry just updated
+    if (!esp_timer_is_active(cache_timer)) {
+        esp_timer_start_once(cache_timer, 0);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Connecting
+// ---------------------------------------------------------------------------
+
+static esp_err_t apply_sta_config(bool fast)
+{
+    wifi_config_t wifi_config = {
+        .sta = {
+            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
+        },
+    };
+    strncpy((char *)wifi_config.sta.ssid, mgr_config.ssid, sizeof(wifi_config.sta.ssid));
+    if (mgr_config.password) {
+        strncpy((char *)wifi_config.sta.password, mgr_config.password, sizeof(wifi_config.sta.password));
+    }
+    if (fast) {
+        // Probe one channel for one BSSID instead of sweeping all 13
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+        wifi_config.sta.channel = cache.channel;
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, cache.bssid, sizeof(wifi_config.sta.bssid));
+    } else {
+        wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        wifi_config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    }
+    return esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+}
+
+static void start_attempt(bool fast)
+{
+    fast_pending = fast;
+    portENTER_CRITICAL(&stats_lock);
+    mgr_stats.fast = fast;
+    if (fast) {
+        mgr_stats.fast_attempts++;
+    } else {
+        mgr_stats.full_scans++;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (connect_start_us == 0) {
+        connect_start_us = esp_timer_get_time();
+    }
+    esp_err_t ret = apply_sta_config(fast);
+    if (ret == ESP_OK) {
+        ret = esp_wifi_connect();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Connect request failed: %s", esp_err_to_name(ret));
+    }
+}
+
+static void reconnect_timer_callback(void *arg)
+{
+    start_attempt(cache_valid);
+}
+
+static void schedule_reconnect(void)
+{
+    if (esp_timer_is_active(reconnect_timer)) {
+        return;
+    }
+    // +/-25% jitter so devices that lost the same AP don't reconnect in lockstep
+    uint32_t jitter = backoff_ms / 2;
+    uint32_t delay_ms = backoff_ms - backoff_ms / 4 + (jitter ? esp_random() % jitter : 0);
+    ESP_LOGI(TAG, "Reconnecting in %lu ms", (unsigned long)delay_ms);
+    esp_timer_start_once(reconnect_timer, (uint64_t)delay_ms * 1000);
+
+    backoff_ms *= 2;
+    if (backoff_ms > mgr_config.backoff_max_ms) {
+        backoff_ms = mgr_config.backoff_max_ms;
+    }
+}
+
+static void on_disconnected(const wifi_event_sta_disconnected_t *event)
+{
+    bool was_connected = xEventGroupGetBits(wifi_events) & WIFI_CONNECTED_BIT;
+    xEventGroupClearBits(wifi_events, WIFI_CONNECTED_BIT);
+    portENTER_CRITICAL(&stats_lock);
+    mgr_stats.connected = false;
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (was_connected) {
+        ESP_LOGW(TAG, "Disconnected (reason %d)", event->reason);
+        connect_start_us = esp_timer_get_time();
+    }
+    if (fast_pending) {
+        // The cached AP moved or is gone: scan right away rather than back off
+        ESP_LOGI(TAG, "Cached AP not reachable (reason %d), scanning", event->reason);
+        start_attempt(false);
+        return;
+    }
+    schedule_reconnect();
+}
+
+static void on_connected(const wifi_event_sta_connected_t *event)
+{
+    ESP_LOGI(TAG, "Associated with %.*s (" MACSTR ", channel %d)", event->ssid_len, (const char *)event->ssid,
+             MAC2STR(event->bssid), event->channel);
+    memcpy(joined_bssid, event->bssid, sizeof(joined_bssid));
+    joined_channel = event->channel;
+    portENTER_CRITICAL(&stats_lock);
+    mgr_stats.channel = event->channel;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+static void on_got_ip(const ip_event_got_ip_t *event)
+{
+    uint32_t elapsed_ms = connect_start_us ? (uint32_t)((esp_timer_get_time() - connect_start_us) / 1000) : 0;
+    ESP_LOGI(TAG, "Got IP " IPSTR " %lu ms after %s", IP2STR(&event->ip_info.ip), (unsigned long)elapsed_ms,
+             fast_pending ? "a directed connect" : "a full scan");
+
+    portENTER_CRITICAL(&stats_lock);
+    mgr_stats.connected = true;
+    mgr_stats.last_connect_ms = elapsed_ms;
+    if (fast_pending) {
+        mgr_stats.fast_hits++;
+    }
+    if (ever_connected) {
+        mgr_stats.reconnects++;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    cache_store(joined_bssid, joined_channel);
+    ever_connected = true;
+    fast_pending = false;
+    connect_start_us = 0;
+    backoff_ms = mgr_config.backoff_min_ms;
+    xEventGroupSetBits(wifi_events, WIFI_CONNECTED_BIT);
+}
+
+// Runs on the default event loop: nothing here may block
+static void wifi_manager_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (event_base == WIFI_EVENT) {
+        switch (event_id) {
+        case WIFI_EVENT_STA_START:
+            start_attempt(cache_valid);
+            break;
+        case WIFI_EVENT_STA_CONNECTED:
+            on_connected(event_data);
+            break;
+        case WIFI_EVENT_STA_DISCONNECTED:
+            on_disconnected(event_data);
+            break;
+        default:
+            break;
+        }
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        on_got_ip(event_data);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+static esp_err_t apply_static_ip(esp_netif_t *netif)
+{
+    esp_netif_ip_info_t ip_info = {
+        .ip.addr = esp_ip4addr_aton(mgr_config.static_ip),
+        .gw.addr = mgr_config.gateway ? esp_ip4addr_aton(mgr_config.gateway) : 0,
+        .netmask.addr = esp_ip4addr_aton(mgr_config.netmask ? mgr_config.netmask : "255.255.255.0"),
+    };
+    esp_err_t ret = esp_netif_dhcpc_stop(netif);
+    if (ret != ESP_OK && ret != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED) {
+        return ret;
+    }
+    ret = esp_netif_set_ip_info(netif, &ip_info);
+    if (ret == ESP_OK && mgr_config.dns) {
+        esp_netif_dns_info_t dns = {
+            .ip.u_addr.ip4.addr = esp_ip4addr_aton(mgr_config.dns),
+            .ip.type = ESP_IPADDR_TYPE_V4,
+        };
+        ret = esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+    return ret;
+}
+
+esp_err_t wifi_manager_start(const wifi_manager_config_t *config)
+{
+    if (!config || !config->ssid || strlen(config->ssid) > 32) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (wifi_events) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    mgr_config = *config;
+    if (mgr_config.backoff_min_ms == 0) {
+        mgr_config.backoff_min_ms = 250;
+    }
+    if (mgr_config.backoff_max_ms < mgr_config.backoff_min_ms) {
+        mgr_config.backoff_max_ms = mgr_config.backoff_min_ms;
+    }
+    backoff_ms = mgr_config.backoff_min_ms;
+
+    wifi_events = xEventGroupCreate();
+    if (!wifi_events) {
+        return ESP_ERR_NO_MEM;
+    }
+    const esp_timer_create_args_t timer_args = {
+        .callback = reconnect_timer_callback,
+        .name = "wifi_reconnect",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &reconnect_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    const esp_timer_create_args_t cache_timer_args = {
+        .callback = cache_persist,
+        .name = "wifi_cache",
+    };
+    ret = esp_timer_create(&cache_timer_args, &cache_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    cache_load();
+
+    esp_netif_t *sta_netif = esp_netif_create_default_wifi_sta();
+    if (!sta_netif) {
+        ESP_LOGW(TAG, "Failed to create WiFi STA netif");
+        return ESP_FAIL;
+    }
+    if (mgr_config.static_ip) {
+        ret = apply_static_ip(sta_netif);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Static IP %s not applied: %s", mgr_config.static_ip, esp_err_to_name(ret));
+            return ret;
+        }
+    }
+    ret = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_manager_event_handler, NULL);
+    if (ret == ESP_OK) {
+        ret = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, wifi_manager_event_handler, NULL);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to register WiFi event handlers");
+        return ret;
+    }
+
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ret = esp_wifi_init(&cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "WiFi init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    // Each attempt rewrites the station config; keep that out of flash
+    esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    ret = esp_wifi_set_mode(WIFI_MODE_STA);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "WiFi set mode failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    // Set country code to fix regulatory domain linker issue in ESP-IDF 5.4.3
+    wifi_country_t country = {
+        .cc = "US",
+        .schan = 1,
+        .nchan = 11,
+        .policy = WIFI_COUNTRY_POLICY_AUTO,
+    };
+    esp_err_t country_ret = esp_wifi_set_country(&country);
+    if (country_ret != ESP_OK) {
+        ESP_LOGW(TAG, "WiFi set country failed: %s, continuing anyway", esp_err_to_name(country_ret));
+    }
+
+    // WIFI_EVENT_STA_START makes the first connect attempt
+    ESP_LOGI(TAG, "Connecting to %s (%s)", mgr_config.ssid, cache_valid ? "cached AP first" : "full scan");
+    ret = esp_wifi_start();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "WiFi start failed: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+bool wifi_manager_connected(void)
+{
+    return wifi_events && (xEventGroupGetBits(wifi_events) & WIFI_CONNECTED_BIT);
+}
+
+bool wifi_manager_wait_connected(uint32_t timeout_ms)
+{
+    if (!wifi_events) {
+        return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(wifi_events, WIFI_CONNECTED_BIT, pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(timeout_ms));
+    return bits & WIFI_CONNECTED_BIT;
+}
+
+void wifi_manager_get_stats(wifi_manager_stats_t *stats)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *stats = mgr_stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
@@ -0,0 +1,87 @@
+/**
+ * @file wifi_manager.h
+ * @brief Station connection manager with cached fast connect and backoff
+ *
+ * The channel and BSSID of the last AP that gave us an address are kept in
+ * NVS. The next connect goes straight to that AP on that channel instead of
+ * scanning all channels, and falls back to a full scan (strongest AP for the
+ * SSID) if it isn't there. With DHCP, CONFIG_LWIP_DHCP_RESTORE_LAST_IP has
+ * lwIP persist the lease and request it again, skipping DHCPDISCOVER; a
+ * static address skips DHCP altogether.
+ *
+ * After a disconnect, reconnects are scheduled on an esp_timer with jittered
+ * exponential backoff, so nothing blocks the default event loop; the AP cache
+ * is committed to NVS from an esp_timer callback for the same reason. The
+ * station state is published in an event group: wait with
+ * wifi_manager_wait_connected().
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WIFI_MANAGER_NVS_NAMESPACE  "wifi_mgr"
+
+typedef struct {
+    const char *ssid;
+    const char *password;
+    const char *static_ip;      // NULL: DHCP. Strings must outlive the manager.
+    const char *gateway;        // Static IP only
+    const char *netmask;        // Static IP only
+    const char *dns;            // Static IP only, optional
+    uint32_t backoff_min_ms;    // First reconnect delay
+    uint32_t backoff_max_ms;    // Reconnect delay cap
+} wifi_manager_config_t;
+
+#define WIFI_MANAGER_DEFAULT_CONFIG() {         \
+    .ssid = NULL,                               \
+    .password = NULL,                           \
+    .static_ip = NULL,                          \
+    .gateway = NULL,                            \
+    .netmask = NULL,                            \
+    .dns = NULL,                                \
+    .backoff_min_ms = 250,                      \
+    .backoff_max_ms = 8000,                     \
+}
+
+typedef struct {
+    bool connected;
+    bool fast;                  // The current or last association used the cached AP
+    uint8_t channel;
+    uint32_t fast_attempts;     // Directed connects to the cached AP
+    uint32_t fast_hits;         // ...that got an address
+    uint32_t full_scans;        // Connects that scanned all channels
+    uint32_t reconnects;        // Connections after the first
+    uint32_t last_connect_ms;   // Connect request or link loss to IP, last connection
+} wifi_manager_stats_t;
+
+/**
+ * @brief Create the station netif, start Wi-Fi and begin connecting
+ *
+ * esp_netif_init() and the default event loop must already exist.
+ * @return ESP_OK once the driver is started; the address arrives later
+ */
+esp_err_t wifi_manager_start(const wifi_manager_config_t *config);
+
+/**
+ * @brief Whether the station currently has an IP address
+ */
+bool wifi_manager_connected(void);
+
+/**
+ * @brief Wait for the station to have an IP address
+ * @return false on timeout or before wifi_manager_start
+ */
+bool wifi_manager_wait_connected(uint32_t timeout_ms);
+
+void wifi_manager_get_stats(wifi_manager_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,256 @@
+function formatBytes(bytes) {
+  if (bytes < 1024) return bytes + ' B';
+  if (bytes < 1024*1024) return (bytes/1024).toFixed(2) + ' KB';
+  return (bytes/(1024*1024)).toFixed(2) + ' MB';
+}
+function formatTime(seconds) {
+  const days = Math.floor(seconds / 86400);
+  const hours = Math.floor((seconds % 86400) / 3600);
+  const mins = Math.floor((seconds % 3600) / 60);
+  const secs = seconds % 60;
+  if (days > 0) return days + 'd ' + hours + 'h ' + mins + 'm';
+  if (hours > 0) return hours + 'h ' + mins + 'm ' + secs + 's';
+  return mins + 'm ' + secs + 's';
+}
+function render(data) {
+      // System Info
+      document.getElementById('chip-model').textContent = data.system.chip_model || '-';
+      document.getElementById('cores').textContent = data.system.cores || '-';
+      document.getElementById('revision').textContent = data.system.revision || '-';
+      document.getElementById('cpu-freq').textContent = (data.system.cpu_freq_mhz || 0) + ' MHz';
+      document.getElementById('uptime').textContent = formatTime(data.system.uptime_seconds || 0);
+      // Memory
+      const freeHeap = data.memory.free_heap || 0;
+      const totalHeap = data.memory.total_heap || 0;
+      const heapUsed = totalHeap - freeHeap;
+      const heapPercent = totalHeap > 0 ? (heapUsed / totalHeap * 100) : 0;
+      document.getElementById('free-heap').textContent = formatBytes(freeHeap);
+      document.getElementById('largest-block').textContent = formatBytes(data.memory.largest_free_block || 0);
+      document.getElementById('min-free').textContent = formatBytes(data.memory.min_free_heap || 0);
+      const heapProgress = document.getElementById('heap-progress');
+      heapProgress.style.width = heapPercent + '%';
+      if (heapPercent > 80) heapProgress.className = 'progress-fill danger';
+      else if (heapPercent > 60) heapProgress.className = 'progress-fill warning';
+      else heapProgress.className = 'progress-fill';
+      document.getElementById('psram-free').textContent = formatBytes(data.memory.psram_free || 0);
+      document.getElementById('psram-total').textContent = formatBytes(data.memory.psram_total || 0);
+      // CPU Usage
+      const core0Usage = data.cpu.core0_usage || 0;
+      const core1Usage = data.cpu.core1_usage || 0;
+      document.getElementById('core0-usage').textContent = core0Usage.toFixed(1) + '%';
+      document.getElementById('core1-usage').textContent = core1Usage.toFixed(1) + '%';
+      const core0Progress = document.getElementById('core0-progress');
+      const core1Progress = document.getElementById('core1-progress');
+      core0Progress.style.width = core0Usage + '%';
+      core1Progress.style.width = core1Usage + '%';
+      if (core0Usage > 80) core0Progress.className = 'progress-fill danger';
+      else if (core0Usage > 60) core0Progress.className = 'progress-fill warning';
+      else core0Progress.className = 'progress-fill';
+      if (core1Usage > 80) core1Progress.className = 'progress-fill danger';
+      else if (core1Usage > 60) core1Progress.className = 'progress-fill warning';
+      else core1Progress.className = 'progress-fill';
+      // Sensors
+      if (data.sensors) {
+        const readings = Object.entries(data.sensors).filter(([key]) => key !== 'timestamp');
+        document.getElementById('sensor-list').innerHTML = readings.length > 0 ?
+          readings.map(([key, value]) => `<div class='stat'><span class='stat-label'>${key}</span><span class='stat-value'>${value}</span></div>`).join('') :
+          '<div class="stat"><span class="stat-label">No readings yet</span></div>';
+      }
+      // Tasks
+      const taskList = document.getElementById('task-list');
+      if (data.tasks && data.tasks.length > 0) {
+        taskList.innerHTML = data.tasks.map(task => {
+          const stateNames = {'Running': '🟢 Running', 'Ready': '🟡 Ready', 'Blocked': '🔴 Blocked', 'Suspended': '⚪ Suspended'};
+          const state = stateNames[task.state] || task.state;
+          const coreBadge = task.core_id >= 0 ? `<span class='core-badge core-${task.core_id}'>Core ${task.core_id}</span>` : '<span class="core-badge">Any</span>';
+          return `<tr>
+            <td>${task.name || 'Unknown'}</td>
+            <td>${state}</td>
+            <td>${task.priority || '-'}</td>
+            <td>${formatBytes(task.stack_high_water || 0)}</td>
+            <td>${(task.cpu_percent || 0).toFixed(1)}%</td>
+            <td>${coreBadge}</td>
+          </tr>`;
+        }).join('');
+      } else {
+        taskList.innerHTML = '<tr><td colspan="6" style="text-align: center;">No tasks found</td></tr>';
+      }
+      // Test Status
+      if (data.tests) {
+        let passCount = 0, warnCount = 0, failCount = 0, notImplCount = 0;
+        const testList = document.getElementById('test-list');
+        if (data.tests.length > 0) {
+          testList.innerHTML = data.tests.map((test, idx) => {
+            const statusNames = {
+              0: '<span style="color: #4CAF50; font-weight: bold;">✅ PASS</span>',
+              1: '<span style="color: #FF9800; font-weight: bold;">⚠️ WARNING</span>',
+              2: '<span style="color: #F44336; font-weight: bold;">❌ FAIL</span>',
+              3: '<span style="color: #888; font-weight: bold;">⚪ NOT IMPLEMENTED</span>'
+            };
+            const status = statusNames[test.status] || '<span>Unknown</span>';
+            if (test.status === 0) passCount++;
+            else if (test.status === 1) warnCount++;
+            else if (test.status === 2) failCount++;
+            else if (test.status === 3) notImplCount++;
+            return `<tr>
+              <td>${idx + 1}</td>
+              <td>${test.name || 'Test ' + (idx + 1)}</td>
+              <td>${status}</td>
+            </tr>`;
+          }).join('');
+        } else {
+          testList.innerHTML = '<tr><td colspan="3" style="text-align: center;">No test data available</td></tr>';
+        }
+        document.getElementById('tests-passed').textContent = passCount;
+        document.getElementById('tests-warning').textContent = warnCount;
+        document.getElementById('tests-failed').textContent = failCount;
+        document.getElementById('tests-notimpl').textContent = notImplCount;
+      }
+}
+// Latest full status; WebSocket deltas replace sections and individual tests
+let state = null;
+function applyUpdate(msg) {
+  if (msg.type === 'snapshot' || !state) {
+    state = msg;
+  } else {
+    Object.keys(msg).forEach(key => {
+      if (key === 'tests') {
+        msg.tests.forEach(test => { state.tests[test.test_num - 1] = test; });
+      } else if (key !== 'type') {
+        state[key] = msg[key];
+      }
+    });
+  }
+  render(state);
+}
+function updateStatus() {
+  fetch('/api/status')
+    .then(response => response.json())
+    .then(data => {
+      state = data;
+      render(data);
+    })
+    .catch(error => {
+      console.error('Error fetching status:', error);
+    });
+}
+// Polling is the fallback while the push channel is down
+let pollTimer = null;
+function startPolling() {
+  if (!pollTimer) {
+    updateStatus();
+    pollTimer = setInterval(updateStatus, 2000);
+  }
+}
+function stopPolling() {
+  if (pollTimer) {
+    clearInterval(pollTimer);
+    pollTimer = null;
+  }
+}
+function connectPush() {
+  if (!('WebSocket' in window)) {
+    startPolling();
+    return;
+  }
+  const ws = new WebSocket('ws://' + location.host + '/ws');
+  ws.onopen = () => stopPolling();
+  ws.onmessage = event => applyUpdate(JSON.parse(event.data));
+  ws.onclose = () => {
+    startPolling();
+    setTimeout(connectPush, 10000);
+  };
+}
+function runDemo() {
+  const btn = document.getElementById('run-demo-btn');
+  const status = document.getElementById('demo-status');
+  btn.disabled = true;
+  btn.textContent = 'Starting Demo...';
+  status.textContent = 'Triggering demo/test suite...';
+  fetch('/api/demo/run', { method: 'POST' })
+    .then(response => response.json())
+    .then(data => {
+      if (data.success) {
+        status.textContent = '✅ Demo started! Tests are running...';
+        status.style.color = '#4CAF50';
+        setTimeout(() => {
+          btn.disabled = false;
+          btn.textContent = '🚀 Run Demo / Test Suite';
+          status.textContent = '';
+        }, 5000);
+      } else {
+        status.textContent = '⚠️ ' + (data.message || 'Demo already running or failed to start');
+        status.style.color = '#FF9800';
+        btn.disabled = false;
+        btn.textContent = '🚀 Run Demo / Test Suite';
+      }
+    })
+    .catch(error => {
+      status.textContent = '❌ Error: ' + error.message;
+      status.style.color = '#F44336';
+      btn.disabled = false;
+      btn.textContent = '🚀 Run Demo / Test Suite';
+    });
+}
+// Poll until the push channel delivers its first snapshot
+startPolling();
+connectPush();
+let githubUpdateInterval = null;
+function updateGitHubActivity() {
+  fetch('/api/github')
+    .then(response => response.json())
+    .then(data => {
+      if (data.error) {
+        document.getElementById('github-loading').textContent = 'GitHub data unavailable: ' + data.error;
+        return;
+      }
+      document.getElementById('github-loading').style.display = 'none';
+      document.getElementById('github-dashboard').style.display = 'block';
+      
+      // Update stats
+      document.getElementById('github-commits').textContent = data.commits || 0;
+      document.getElementById('github-prs').textContent = data.pull_requests || 0;
+      document.getElementById('github-issues').textContent = data.issues || 0;
+      document.getElementById('github-repos').textContent = data.repositories || 0;
+      
+      // Update activity list
+      const activityList = document.getElementById('github-activity-list');
+      if (data.recent_activity && data.recent_activity.length > 0) {
+        activityList.innerHTML = data.recent_activity.map(activity => {
+          const date = new Date(activity.date).toLocaleDateString();
+          const icon = activity.type === 'commit' ? '💾' : activity.type === 'pr' ? '🔀' : activity.type === 'issue' ? '📝' : '⭐';
+          return `<div style='padding: 10px; margin: 5px 0; background: #2a2a2a; border-radius: 4px; border-left: 3px solid #4CAF50;'>
+            <div style='display: flex; justify-content: space-between; align-items: center;'>
+              <div><span style='font-size: 1.2em; margin-right: 8px;'>${icon}</span><strong>${activity.title}</strong></div>
+              <div style='color: #888; font-size: 0.9em;'>${date}</div>
+            </div>
+            ${activity.repo ? `<div style='color: #bbb; font-size: 0.85em; margin-top: 5px; margin-left: 28px;'>${activity.repo}</div>` : ''}
+          </div>`;
+        }).join('');
+      } else {
+        activityList.innerHTML = '<div style="text-align: center; color: #888; padding: 20px;">No recent activity</div>';
+      }
+      
+      // Update heatmap
+      const heatmap = document.getElementById('github-heatmap');
+      if (data.heatmap && data.heatmap.length > 0) {
+        heatmap.innerHTML = data.heatmap.map(day => {
+          const intensity = Math.min(day.count / 10, 1);
+          const opacity = 0.3 + (intensity * 0.7);
+          const color = day.count === 0 ? '#161b22' : day.count < 3 ? '#0e4429' : day.count < 6 ? '#006d32' : day.count < 10 ? '#26a641' : '#39d353';
+          return `<div style='width: 12px; height: 12px; background: ${color}; border-radius: 2px; opacity: ${opacity};' title='${day.date}: ${day.count} contributions'></div>`;
+        }).join('');
+      } else {
+        heatmap.innerHTML = '<div style="text-align: center; color: #888; padding: 10px;">No contribution data available</div>';
+      }
+    })
+    .catch(error => {
+      console.error('GitHub activity fetch error:', error);
+      document.getElementById('github-loading').textContent = 'Failed to load GitHub activity';
+    });
+}
+// Update GitHub activity every 30 seconds
+updateGitHubActivity();
+if (!githubUpdateInterval) {
+  githubUpdateInterval = setInterval(updateGitHubActivity, 30000);
+}